@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    eth_dma_host.h
+  * @brief   Host model of the ETH MAC DMA engine, on top of the ETH register
+  *          block of host_sim.h.
+  *
+  *          The real stm32f7xx_hal_eth.c drives the model: it builds the
+  *          chained descriptor lists pointed to by DMARDLAR/DMATDLAR, the
+  *          model plays the DMA side of the OWN protocol. Everything is
+  *          synchronous: a frame "arrives" in HostEthDma_Receive(), queued
+  *          TX descriptors are sent by HostEthDma_Transmit(), DMASR events
+  *          reach the driver through HostEthDma_Interrupt().
+  *          Descriptors hold 32-bit addresses: the host image is linked
+  *          -no-pie and DMA buffers must be static.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ETH_DMA_HOST_H
+#define __ETH_DMA_HOST_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*HostEthDma_SinkTypeDef)(const uint8_t *frame, uint32_t length);
+
+/* Exported functions ------------------------------------------------------- */
+void HostEthDma_Reset(void);
+void HostEthDma_SetSink(HostEthDma_SinkTypeDef sink);
+void HostEthDma_SetAddressFilter(uint32_t enable);
+uint32_t HostEthDma_Receive(const uint8_t *frame, uint32_t length);
+uint32_t HostEthDma_Transmit(void);
+uint32_t HostEthDma_Interrupt(void (*handler)(void));
+uint32_t HostEthDma_ReadMissed(void);
+uint32_t HostEthDma_RxFree(void);
+
+void HostEthDma_PtpSetDrift(int32_t ppb);
+void HostEthDma_PtpAdvance(uint32_t ns);
+void HostEthDma_PtpCommand(void);
+uint64_t HostEthDma_PtpTime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ETH_DMA_HOST_H */
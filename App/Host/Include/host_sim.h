@@ -0,0 +1,297 @@
+/**
+  ******************************************************************************
+  * @file    host_sim.h
+  * @brief   Host (x86-64 Linux) register model of the STM32F746 peripherals.
+  *
+  *          This header is force-included (gcc -include) in front of every
+  *          translation unit of the "host" build. It replaces the Cortex-M7
+  *          intrinsics of cmsis_gcc.h by portable C, pulls in the device
+  *          header once and then remaps the peripheral instance macros
+  *          (GPIOB, RCC, USART1, SCB, ...) onto plain RAM register blocks, so
+  *          the LL drivers and App/Src run unmodified on the build machine.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_SIM_H
+#define __HOST_SIM_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* CMSIS compiler layer ------------------------------------------------------*/
+/* Claim the cmsis_gcc.h include guard: its inline assembly is ARM only. */
+#define __CMSIS_GCC_H
+
+#define __ASM                                  __asm
+#define __INLINE                               inline
+#define __STATIC_INLINE                        static inline
+#define __STATIC_FORCEINLINE                   __attribute__((always_inline)) static inline
+#define __NO_RETURN                            __attribute__((__noreturn__))
+#define __USED                                 __attribute__((used))
+#define __WEAK                                 __attribute__((weak))
+#define __PACKED                               __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT                        struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION                         union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)                           __attribute__((aligned(x)))
+#define __RESTRICT                             __restrict
+#define __UNALIGNED_UINT16_READ(addr)          (*(const uint16_t *)(const void *)(addr))
+#define __UNALIGNED_UINT16_WRITE(addr, val)    (void)(*(uint16_t *)(void *)(addr) = (val))
+#define __UNALIGNED_UINT32_READ(addr)          (*(const uint32_t *)(const void *)(addr))
+#define __UNALIGNED_UINT32_WRITE(addr, val)    (void)(*(uint32_t *)(void *)(addr) = (val))
+
+/* Simulated core registers (PRIMASK, BASEPRI, CONTROL, stack pointers, ...) */
+typedef struct
+{
+  uint32_t PRIMASK;
+  uint32_t FAULTMASK;
+  uint32_t BASEPRI;
+  uint32_t CONTROL;
+  uint32_t IPSR;
+  uint32_t MSP;
+  uint32_t PSP;
+  uint32_t FPSCR;
+  uint32_t WFI_Count;           /*!< Number of __WFI() executed */
+  void (*WFI_Hook)(void);       /*!< Run by __WFI() when set: the event that ends the sleep */
+} HostSim_Core_TypeDef;
+
+extern HostSim_Core_TypeDef HostSim_Core;
+
+__STATIC_FORCEINLINE void __enable_irq(void)                { HostSim_Core.PRIMASK = 0U; }
+__STATIC_FORCEINLINE void __disable_irq(void)               { HostSim_Core.PRIMASK = 1U; }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)           { return HostSim_Core.PRIMASK; }
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t priMask)   { HostSim_Core.PRIMASK = priMask; }
+__STATIC_FORCEINLINE void __enable_fault_irq(void)          { HostSim_Core.FAULTMASK = 0U; }
+__STATIC_FORCEINLINE void __disable_fault_irq(void)         { HostSim_Core.FAULTMASK = 1U; }
+__STATIC_FORCEINLINE uint32_t __get_FAULTMASK(void)         { return HostSim_Core.FAULTMASK; }
+__STATIC_FORCEINLINE void __set_FAULTMASK(uint32_t mask)    { HostSim_Core.FAULTMASK = mask; }
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void)           { return HostSim_Core.BASEPRI; }
+__STATIC_FORCEINLINE void __set_BASEPRI(uint32_t basePri)   { HostSim_Core.BASEPRI = basePri & 0xFFU; }
+__STATIC_FORCEINLINE void __set_BASEPRI_MAX(uint32_t basePri)
+{
+  basePri &= 0xFFU;
+  if ((basePri != 0U) && ((HostSim_Core.BASEPRI == 0U) || (basePri < HostSim_Core.BASEPRI)))
+  {
+    HostSim_Core.BASEPRI = basePri;
+  }
+}
+__STATIC_FORCEINLINE uint32_t __get_CONTROL(void)           { return HostSim_Core.CONTROL; }
+__STATIC_FORCEINLINE void __set_CONTROL(uint32_t control)   { HostSim_Core.CONTROL = control; }
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)              { return HostSim_Core.IPSR; }
+__STATIC_FORCEINLINE uint32_t __get_xPSR(void)              { return HostSim_Core.IPSR; }
+__STATIC_FORCEINLINE uint32_t __get_APSR(void)              { return 0U; }
+__STATIC_FORCEINLINE uint32_t __get_MSP(void)               { return HostSim_Core.MSP; }
+__STATIC_FORCEINLINE void __set_MSP(uint32_t topOfStack)    { HostSim_Core.MSP = topOfStack; }
+__STATIC_FORCEINLINE uint32_t __get_PSP(void)               { return HostSim_Core.PSP; }
+__STATIC_FORCEINLINE void __set_PSP(uint32_t topOfStack)    { HostSim_Core.PSP = topOfStack; }
+__STATIC_FORCEINLINE uint32_t __get_FPSCR(void)             { return HostSim_Core.FPSCR; }
+__STATIC_FORCEINLINE void __set_FPSCR(uint32_t fpscr)       { HostSim_Core.FPSCR = fpscr; }
+
+#define __NOP()                                __asm volatile ("nop")
+#define __WFI()                                ((void)HostSim_Core.WFI_Count++, \
+                                                (HostSim_Core.WFI_Hook != 0) ? HostSim_Core.WFI_Hook() : (void)0)
+#define __WFE()                                ((void)0)
+#define __SEV()                                ((void)0)
+#define __BKPT(value)                          __builtin_trap()
+#define __CLZ(value)                           (uint8_t)(((value) == 0U) ? 32U : (uint32_t)__builtin_clz(value))
+
+__STATIC_FORCEINLINE void __ISB(void)                       { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_FORCEINLINE void __DSB(void)                       { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_FORCEINLINE void __DMB(void)                       { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value)         { return __builtin_bswap32(value); }
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value)
+{
+  return ((value & 0xFF00FF00U) >> 8) | ((value & 0x00FF00FFU) << 8);
+}
+__STATIC_FORCEINLINE int16_t __REVSH(int16_t value)         { return (int16_t)__builtin_bswap16((uint16_t)value); }
+__STATIC_FORCEINLINE uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+  op2 %= 32U;
+  return (op2 == 0U) ? op1 : ((op1 >> op2) | (op1 << (32U - op2)));
+}
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0U;
+  for (uint32_t i = 0U; i < 32U; i++)
+  {
+    result = (result << 1) | (value & 1U);
+    value >>= 1;
+  }
+  return result;
+}
+
+/* Exclusive monitor: single-core host, the store always succeeds. */
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t *addr)                 { return *addr; }
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) { *addr = value; return 0U; }
+__STATIC_FORCEINLINE void __CLREX(void)                                          { }
+
+/* Device header -------------------------------------------------------------*/
+#include "stm32f7xx.h"
+
+/* Cache maintenance: the inline functions of core_cm7.h were expanded against
+   the real SCB address, and the host has no cache to maintain. */
+#define SCB_EnableICache()                              ((void)0)
+#define SCB_DisableICache()                             ((void)0)
+#define SCB_InvalidateICache()                          ((void)0)
+#define SCB_EnableDCache()                              ((void)0)
+#define SCB_DisableDCache()                             ((void)0)
+#define SCB_InvalidateDCache()                          ((void)0)
+#define SCB_CleanDCache()                               ((void)0)
+#define SCB_CleanInvalidateDCache()                     ((void)0)
+#define SCB_InvalidateDCache_by_Addr(addr, dsize)       ((void)(addr), (void)(dsize))
+#define SCB_CleanDCache_by_Addr(addr, dsize)            ((void)(addr), (void)(dsize))
+#define SCB_CleanInvalidateDCache_by_Addr(addr, dsize)  ((void)(addr), (void)(dsize))
+
+/* MPU programming, the same goes for mpu_armv7.h: no memory attributes to apply */
+#define ARM_MPU_Enable(ctrl)                            ((void)(ctrl))
+#define ARM_MPU_Disable()                               ((void)0)
+#define ARM_MPU_SetRegion(rbar, rasr)                   ((void)(rbar), (void)(rasr))
+#define ARM_MPU_ClrRegion(rnr)                          ((void)(rnr))
+#define ARM_MPU_Load(table, cnt)                        ((void)(table), (void)(cnt))
+
+/* Simulated peripherals -----------------------------------------------------*/
+/* OTG FS core: global, device and endpoint registers, PCGCCTL at 0xE00 and
+   the FIFO windows at 0x1000 * (n + 1), endpoints 0 to 5 */
+#define HOST_SIM_USB_OTG_SIZE   0x7000U
+/* LTDC global registers and the two layers at 0x84 and 0x104 */
+#define HOST_SIM_LTDC_SIZE      0x200U
+/* SDRAM heap of the linker script, _ssdram_heap to _esdram_heap (sdram.c);
+   no suffix, the assembler reads it too */
+#define HOST_SIM_SDRAM_SIZE     0x800000
+
+extern FLASH_TypeDef   HostSim_FLASH;
+extern PWR_TypeDef     HostSim_PWR;
+extern RCC_TypeDef     HostSim_RCC;
+extern SYSCFG_TypeDef  HostSim_SYSCFG;
+extern EXTI_TypeDef    HostSim_EXTI;
+extern GPIO_TypeDef    HostSim_GPIOA;
+extern GPIO_TypeDef    HostSim_GPIOB;
+extern GPIO_TypeDef    HostSim_GPIOC;
+extern USART_TypeDef   HostSim_USART1;
+extern ETH_TypeDef     HostSim_ETH;
+extern DMA2D_TypeDef   HostSim_DMA2D;
+extern uint32_t        HostSim_LTDC[HOST_SIM_LTDC_SIZE / 4U];
+extern FMC_Bank5_6_TypeDef HostSim_FMC_Bank5_6;
+extern uint8_t         HostSim_SDRAM[HOST_SIM_SDRAM_SIZE];
+extern uint32_t        HostSim_USB_OTG_FS[HOST_SIM_USB_OTG_SIZE / 4U];
+extern SCnSCB_Type     HostSim_SCnSCB;
+extern SCB_Type        HostSim_SCB;
+extern SysTick_Type    HostSim_SysTick;
+extern NVIC_Type       HostSim_NVIC;
+extern DWT_Type        HostSim_DWT;
+extern CoreDebug_Type  HostSim_CoreDebug;
+extern MPU_Type        HostSim_MPU;
+extern FPU_Type        HostSim_FPU;
+
+#undef  FLASH
+#define FLASH           (&HostSim_FLASH)
+#undef  PWR
+#define PWR             (&HostSim_PWR)
+#undef  RCC
+#define RCC             (&HostSim_RCC)
+#undef  SYSCFG
+#define SYSCFG          (&HostSim_SYSCFG)
+#undef  EXTI
+#define EXTI            (&HostSim_EXTI)
+#undef  GPIOA
+#define GPIOA           (&HostSim_GPIOA)
+#undef  GPIOB
+#define GPIOB           (&HostSim_GPIOB)
+#undef  GPIOC
+#define GPIOC           (&HostSim_GPIOC)
+#undef  USART1
+#define USART1          (&HostSim_USART1)
+#undef  ETH
+#define ETH             (&HostSim_ETH)
+/* stm32f7xx_hal_eth.c reaches the MAC address registers from the base
+   address as a 32-bit integer: fine, the host image is linked -no-pie */
+#undef  ETH_MAC_BASE
+#define ETH_MAC_BASE    ((uint32_t)(uintptr_t)&HostSim_ETH)
+#undef  DMA2D
+#define DMA2D           (&HostSim_DMA2D)
+/* stm32f7xx_hal_ltdc.c reaches the layers from the base address as a
+   32-bit integer too */
+#undef  LTDC
+#define LTDC            ((LTDC_TypeDef *)(uintptr_t)HostSim_LTDC)
+#undef  LTDC_Layer1
+#define LTDC_Layer1     ((LTDC_Layer_TypeDef *)(uintptr_t)&HostSim_LTDC[0x84U / 4U])
+#undef  LTDC_Layer2
+#define LTDC_Layer2     ((LTDC_Layer_TypeDef *)(uintptr_t)&HostSim_LTDC[0x104U / 4U])
+#undef  FMC_Bank5_6
+#define FMC_Bank5_6     (&HostSim_FMC_Bank5_6)
+/* stm32f7xx_ll_usb.c does the same with USBx_BASE for every register */
+#undef  USB_OTG_FS
+#define USB_OTG_FS      ((USB_OTG_GlobalTypeDef *)(uintptr_t)HostSim_USB_OTG_FS)
+#undef  SCnSCB
+#define SCnSCB          (&HostSim_SCnSCB)
+#undef  SCB
+#define SCB             (&HostSim_SCB)
+#undef  SysTick
+#define SysTick         (&HostSim_SysTick)
+#undef  NVIC
+#define NVIC            (&HostSim_NVIC)
+#undef  DWT
+#define DWT             (&HostSim_DWT)
+#undef  CoreDebug
+#define CoreDebug       (&HostSim_CoreDebug)
+#undef  MPU
+#define MPU             (&HostSim_MPU)
+#undef  FPU
+#define FPU             (&HostSim_FPU)
+
+/* NVIC: the core_cm7.h inlines were expanded against the real NVIC and SCB,
+   the CMSIS names are pointed at the simulated blocks instead */
+__STATIC_FORCEINLINE void HostSim_NVIC_SetPriorityGrouping(uint32_t priorityGroup)
+{
+  HostSim_SCB.AIRCR = (HostSim_SCB.AIRCR & ~SCB_AIRCR_PRIGROUP_Msk)
+                      | ((priorityGroup & 7U) << SCB_AIRCR_PRIGROUP_Pos);
+}
+__STATIC_FORCEINLINE uint32_t HostSim_NVIC_GetPriorityGrouping(void)
+{
+  return (HostSim_SCB.AIRCR & SCB_AIRCR_PRIGROUP_Msk) >> SCB_AIRCR_PRIGROUP_Pos;
+}
+__STATIC_FORCEINLINE void HostSim_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  HostSim_NVIC.ISER[(uint32_t)IRQn >> 5] |= 1UL << ((uint32_t)IRQn & 0x1FU);
+}
+__STATIC_FORCEINLINE void HostSim_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  HostSim_NVIC.ISER[(uint32_t)IRQn >> 5] &= ~(1UL << ((uint32_t)IRQn & 0x1FU));
+}
+__STATIC_FORCEINLINE void HostSim_NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+  uint8_t value = (uint8_t)((priority << (8U - __NVIC_PRIO_BITS)) & 0xFFU);
+
+  if ((int32_t)IRQn >= 0)
+  {
+    HostSim_NVIC.IP[(uint32_t)IRQn] = value;
+  }
+  else
+  {
+    HostSim_SCB.SHPR[((uint32_t)IRQn & 0xFU) - 4U] = value;
+  }
+}
+
+#undef  NVIC_SetPriorityGrouping
+#define NVIC_SetPriorityGrouping    HostSim_NVIC_SetPriorityGrouping
+#undef  NVIC_GetPriorityGrouping
+#define NVIC_GetPriorityGrouping    HostSim_NVIC_GetPriorityGrouping
+#undef  NVIC_EnableIRQ
+#define NVIC_EnableIRQ              HostSim_NVIC_EnableIRQ
+#undef  NVIC_DisableIRQ
+#define NVIC_DisableIRQ             HostSim_NVIC_DisableIRQ
+#undef  NVIC_SetPriority
+#define NVIC_SetPriority            HostSim_NVIC_SetPriority
+
+/* Exported functions ------------------------------------------------------- */
+void HostSim_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_SIM_H */
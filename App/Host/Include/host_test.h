@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * @file    host_test.h
+  * @brief   Shared pieces of the host checks and benchmarks.
+  *
+  *          host_main.c runs the rows of its benchTable; the checks and the
+  *          benchmarks of a module live in App/Host/Src/host_<module>.c,
+  *          the simulated peripherals several of them drive in
+  *          host_<peripheral>.c. A module's checks run first in its first
+  *          row; Bench_Expect() aborts the run on a mismatch.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "gfx_engine.h"
+#include "lcd_fb.h"
+#include "eth_pbuf.h"
+#include "kernel.h"
+#include "usb_msc.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define BENCH_ETH_CAPTURE       8U      /* frames sent kept by Bench_EthSink() */
+#define BENCH_USB_NO_PACKET     0xFFFFFFFFU /* IN_ep[0].xfer_len before a setup: nothing queued yet */
+#define BENCH_USB_STALL         (-1)
+#define BENCH_FB_WIDTH          64U     /* RGB565 panel of the framebuffer checks */
+#define BENCH_FB_HEIGHT         32U
+#define BENCH_FB_BYTES          (BENCH_FB_WIDTH * BENCH_FB_HEIGHT * 2U)
+#define BENCH_FB_MEMORY         ((3U * BENCH_FB_BYTES) + LCD_FB_ALIGN)
+
+/* Exported variables --------------------------------------------------------*/
+/* host_eth.c */
+extern ETH_HandleTypeDef benchEth;
+extern uint8_t benchEthMac[6];
+extern uint8_t benchEthCapture[BENCH_ETH_CAPTURE][ETH_PBUF_SIZE];
+extern uint32_t benchEthCaptureLength[BENCH_ETH_CAPTURE];
+extern uint32_t benchEthCaptured;
+extern uint32_t benchEthIfScheduled;
+extern Kernel_TaskTypeDef *benchEthIfTask;     /* notified by the schedule callback when set */
+extern uint32_t benchEthIfFlood;        /* frames brought in by the frames handled, at line rate */
+extern uint32_t benchEthIfHold;
+extern EthPbuf_TypeDef *benchEthIfHeld[ETH_PBUF_COUNT];
+extern uint32_t benchEthIfHeldCount;
+extern uint32_t benchPtpActive;
+extern uint32_t benchNetActive;
+extern const uint8_t benchNetPeerMac[6];
+
+/* host_usb.c */
+extern PCD_HandleTypeDef benchUsb;
+extern uint32_t benchUsbPackets;        /* IN packets of the last control read, zero-length ones included */
+
+/* host_lcd_fb.c */
+extern LTDC_HandleTypeDef benchFbLtdc;
+
+/* Exported functions ------------------------------------------------------- */
+/* host_main.c */
+void Bench_Expect(const char *module, int condition, const char *what);
+uint64_t Host_NowNs(void);
+void Host_PutChar(char c);
+
+/* host_eth.c */
+void Bench_EthSink(const uint8_t *frame, uint32_t length);
+void Bench_EthStart(void);
+uint32_t Bench_EthFrame(uint8_t *frame, uint32_t length, uint32_t seed);
+void Bench_EthIfStart(void);
+void Bench_EthIfReleaseHeld(void);
+uint32_t Bench_EthIpFrame(uint8_t *frame, uint8_t protocol, uint32_t payload);
+uint16_t Bench_InetCheck(const uint8_t *data, uint32_t length, uint32_t sum);
+
+/* host_usb.c */
+void Bench_UsbStart(const UsbMsc_StorageTypeDef *msc);
+int Bench_UsbControl(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+		uint16_t wLength, uint8_t *data);
+
+/* host_gfx_engine.c */
+void Bench_GfxRun(void);
+void Bench_GfxSet(const GfxEngine_BufferTypeDef *buffer, uint32_t x, uint32_t y, uint32_t pixel);
+
+/* host_lcd_fb.c */
+void Bench_FbRefresh(void);
+HAL_StatusTypeDef Bench_FbPanel(uint32_t width, uint32_t height, uint8_t *memory, uint32_t size,
+	uint32_t count);
+HAL_StatusTypeDef Bench_FbInit(uint32_t count, uint32_t size);
+
+/* Benchmarks, the rows of benchTable */
+void Bench_Profile_Record(uint32_t iterations);
+void Bench_TimerWheel_StartStop(uint32_t iterations);
+void Bench_TimerWheel_Advance(uint32_t iterations);
+void Bench_Timebase_Poll(uint32_t iterations);
+void Bench_RingBuffer_Spsc(uint32_t iterations);
+void Bench_Frame_RoundTrip(uint32_t iterations);
+void Bench_MpuRegions_Build(uint32_t iterations);
+void Bench_DmaBuffer_AllocFree(uint32_t iterations);
+void Bench_BenchCore_Iterate(uint32_t iterations);
+void Bench_Kernel_Yield(uint32_t iterations);
+void Bench_Kernel_Notify(uint32_t iterations);
+void Bench_Kernel_Delay(uint32_t iterations);
+void Bench_CrcStream_Table(uint32_t iterations);
+void Bench_CrcStream_Bitwise(uint32_t iterations);
+void Bench_EthPbuf_Rx(uint32_t iterations);
+void Bench_EthPbuf_Tx(uint32_t iterations);
+void Bench_EthIf_IrqPerFrame(uint32_t iterations);
+void Bench_EthIf_Flood(uint32_t iterations);
+void Bench_EthIf_Checksum(uint32_t iterations);
+void Bench_Ptp_Exchange(uint32_t iterations);
+void Bench_Net_UdpSend(uint32_t iterations);
+void Bench_EthFilter_Hash(uint32_t iterations);
+void Bench_UsbCdc_Write(uint32_t iterations);
+void Bench_UsbFifo_Plan(uint32_t iterations);
+void Bench_UsbFifo_Copy(uint32_t iterations);
+void Bench_UsbMsc_Read(uint32_t iterations);
+void Bench_BlockDev_Log(uint32_t iterations);
+void Bench_GfxEngine_Queue(uint32_t iterations);
+void Bench_GfxSoft_Blend(uint32_t iterations);
+void Bench_LcdFb_Flip(uint32_t iterations);
+void Bench_Damage_Patterns(uint32_t iterations);
+void Bench_LcdComp_Drag(uint32_t iterations);
+void Bench_Sdram_CalcTiming(uint32_t iterations);
+void Bench_MemHeap_AllocFree(uint32_t iterations);
+void Bench_QspiFlash_ParseSfdp(uint32_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_TEST_H */
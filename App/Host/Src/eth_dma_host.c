@@ -0,0 +1,812 @@
+/**
+  ******************************************************************************
+  * @file    eth_dma_host.c
+  * @brief   Host model of the ETH MAC DMA engine (RM0385 chapter 38.6).
+  *
+  *          Only the chained descriptor mode used by the HAL is modelled.
+  *          Receive fills the descriptors owned by the DMA from the current
+  *          RX pointer, a frame that does not fit the owned buffers is
+  *          dropped as the MAC would: RBUS raised, missed frame counter
+  *          incremented, wrapping to zero with OMFC set. Transmit walks the
+  *          owned TX descriptors and hands each complete frame to the sink.
+  *          The 4-byte FCS is counted in the RX frame length and written as
+  *          zeros.
+  *          The checksum engine (MACCR.IPCO) is modelled for IPv4: it
+  *          checks TCP/UDP/ICMP frames on receive, reported in RDES4 with
+  *          enhanced descriptors, and fills in the checksums selected by
+  *          the first TX descriptor's CIC field on transmit. Fragments and
+  *          IPv6 bypass it.
+  *          The time stamp unit counts HCLK cycles of SystemCoreClock, off
+  *          by the drift set with HostEthDma_PtpSetDrift(), as the time
+  *          given to HostEthDma_PtpAdvance() elapses: fine update adds
+  *          PTPTSAR to a 32-bit accumulator each cycle and PTPSSIR ns on
+  *          each carry, coarse update PTPSSIR ns per cycle. Subseconds are
+  *          nanoseconds (digital rollover), the binary rollover is not
+  *          modelled. The initialize, update and addend commands complete
+  *          in HostEthDma_PtpCommand(), called as time passes and from
+  *          HAL_GetTick(); an update with the add/subtract bit
+  *          set is read the way HAL_ETH_PTP_AddTimeOffset() writes it.
+  *          Received frames are time stamped by the TSSARFE/TSSPTPOEFE
+  *          filter (RDES6 ns, RDES7 seconds, RDES0 bit 7 TSV), transmitted
+  *          ones by TTSE in their first descriptor (TDES6/TDES7 of the last,
+  *          TTSS).
+  *          The destination address filter (MACFFR, MAC addresses 0 to
+  *          3, hash table) is modelled once HostEthDma_SetAddressFilter()
+  *          turns it on; it is off by default, the benches feed frames with
+  *          random addresses. The source address filter is not modelled.
+  *          Loopback (MACCR.LM) takes the frames sent back into the
+  *          receiver instead of the sink, once the TX ring walk is over;
+  *          the checksum and time stamp paths see them both ways.
+  *          DMASR is write-1-to-clear: the model keeps the pending status
+  *          itself and shows it in DMASR with a reserved marker bit set. A
+  *          driver write replaces the marker, so at its next entry point
+  *          the model reads the value left in DMASR as the bits cleared.
+  *          One write per step is seen, the interrupt handler is therefore
+  *          given one event at a time.
+  *          DMAMFBOCR clears on read, a read plain memory cannot see: the
+  *          driver reads it through HostEthDma_ReadMissed() in the host
+  *          build, ETH->DMAMFBOCR shows the counters without clearing them,
+  *          as a debugger would. The FIFO overflow counter is not modelled.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "stm32f7xx_hal.h"
+#include "eth_dma_host.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HOST_ETH_DMA_FCS_SIZE       4U
+#define HOST_ETH_DMA_FL_SHIFT       16U     /* ETH_DMARXDESC_FL position, private to the HAL */
+#define HOST_ETH_DMA_MAX_FRAME      ETH_DMATXDESC_TBS1
+#define HOST_ETH_DMA_MAX_DESC       1024U   /* ring walk bound, catches a broken chain */
+#define HOST_ETH_DMA_SHOWN          (1UL << 31) /* DMASR reserved bit, never written by a driver */
+#define HOST_ETH_DMA_RDES0_ESA      (1UL << 0)  /* enhanced descriptors: extended status in RDES4 */
+#define HOST_ETH_DMA_RDES0_TSV      (1UL << 7)  /* time stamp valid, IPV4HCE without time stamps */
+#define HOST_ETH_DMA_IP             14U     /* IPv4 header offset, untagged frames only */
+#define HOST_ETH_DMA_PROTO_ICMP     1U
+#define HOST_ETH_DMA_PROTO_TCP      6U
+#define HOST_ETH_DMA_PROTO_UDP      17U
+#define HOST_ETH_DMA_PTP_TYPE       0x88F7U
+#define HOST_ETH_DMA_NS_PER_S       1000000000ULL
+#define HOST_ETH_DMA_LOOPBACK       16U     /* frames looped back per HostEthDma_Transmit(), the rest lost */
+
+/* Private macro -------------------------------------------------------------*/
+#define HOST_ETH_DMA_DESC(addr)     ((ETH_DMADescTypeDef *)(uintptr_t)(addr))
+#define HOST_ETH_DMA_BUFFER(addr)   ((uint8_t *)(uintptr_t)(addr))
+
+/* Private variables ---------------------------------------------------------*/
+static ETH_DMADescTypeDef *hostEthRxCurrent;
+static ETH_DMADescTypeDef *hostEthTxCurrent;
+static uint32_t hostEthRxList;
+static uint32_t hostEthTxList;
+static uint32_t hostEthStatus;                  /* pending DMASR events */
+static uint32_t hostEthMissed;                  /* DMAMFBOCR */
+static HostEthDma_SinkTypeDef hostEthSink;
+static uint32_t hostEthAddressFilter;
+static uint8_t hostEthTxFrame[HOST_ETH_DMA_MAX_FRAME];
+static uint8_t hostEthLoopback[HOST_ETH_DMA_LOOPBACK][HOST_ETH_DMA_MAX_FRAME];
+static uint32_t hostEthLoopbackLength[HOST_ETH_DMA_LOOPBACK];
+
+/* Time stamp unit */
+static uint64_t hostEthPtpTime;                 /* ns */
+static uint32_t hostEthPtpAccumulator;
+static uint32_t hostEthPtpAddend;               /* latched by TSARU */
+static double hostEthPtpCycles;                 /* HCLK cycles not counted yet */
+static int32_t hostEthPtpDrift;                 /* HCLK error, ppb */
+
+/* Private functions ---------------------------------------------------------*/
+/* A new list address restarts the DMA at its first descriptor */
+static void HostEthDma_Sync(void)
+{
+	if (ETH->DMARDLAR != hostEthRxList)
+	{
+		hostEthRxList = ETH->DMARDLAR;
+		hostEthRxCurrent = HOST_ETH_DMA_DESC(hostEthRxList);
+	}
+	if (ETH->DMATDLAR != hostEthTxList)
+	{
+		hostEthTxList = ETH->DMATDLAR;
+		hostEthTxCurrent = HOST_ETH_DMA_DESC(hostEthTxList);
+	}
+}
+
+static void HostEthDma_Show(void)
+{
+	ETH->DMASR = hostEthStatus | HOST_ETH_DMA_SHOWN;
+	ETH->DMAMFBOCR = hostEthMissed;
+}
+
+/* Take the DMASR bits cleared by the driver since the model last wrote it */
+static void HostEthDma_Acknowledge(void)
+{
+	if ((ETH->DMASR & HOST_ETH_DMA_SHOWN) == 0U)
+	{
+		hostEthStatus &= ~ETH->DMASR;
+	}
+	HostEthDma_Show();
+}
+
+/* IEEE 802.3 CRC-32, bit by bit */
+static uint32_t HostEthDma_Crc32(const uint8_t *data, uint32_t length)
+{
+	uint32_t crc = 0xFFFFFFFFU;
+
+	for (uint32_t i = 0U; i < length; i++)
+	{
+		crc ^= data[i];
+		for (uint32_t bit = 0U; bit < 8U; bit++)
+		{
+			crc = (crc >> 1) ^ (((crc & 1U) != 0U) ? 0xEDB88320U : 0U);
+		}
+	}
+	return ~crc;
+}
+
+/* MAC address register pair against a destination address, MBC bytes masked */
+static uint32_t HostEthDma_Perfect(uint32_t high, uint32_t low, const uint8_t *address)
+{
+	uint8_t slot[6];
+
+	slot[0] = (uint8_t)low;
+	slot[1] = (uint8_t)(low >> 8);
+	slot[2] = (uint8_t)(low >> 16);
+	slot[3] = (uint8_t)(low >> 24);
+	slot[4] = (uint8_t)high;
+	slot[5] = (uint8_t)(high >> 8);
+	for (uint32_t i = 0U; i < 6U; i++)
+	{
+		if (((high & (1UL << (24U + i))) == 0U) && (slot[i] != address[i]))
+		{
+			return 0U;
+		}
+	}
+	return 1U;
+}
+
+/* Destination address filter (RM0385 38.5.6), 1 if the frame passes */
+static uint32_t HostEthDma_AddressMatch(const uint8_t *frame)
+{
+	static const uint8_t broadcast[6] = { 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU };
+	const uint32_t high[3] = { ETH->MACA1HR, ETH->MACA2HR, ETH->MACA3HR };
+	const uint32_t low[3] = { ETH->MACA1LR, ETH->MACA2LR, ETH->MACA3LR };
+	uint32_t ffr = ETH->MACFFR;
+	uint32_t perfect;
+	uint32_t hashed;
+	uint32_t bin;
+
+	if ((ffr & (ETH_MACFFR_RA | ETH_MACFFR_PM)) != 0U)
+	{
+		return 1U;
+	}
+	if (memcmp(frame, broadcast, sizeof(broadcast)) == 0)
+	{
+		return (ffr & ETH_MACFFR_BFD) == 0U;
+	}
+	if (((frame[0] & 0x01U) != 0U) && ((ffr & ETH_MACFFR_PAM) != 0U))
+	{
+		return 1U;
+	}
+
+	perfect = HostEthDma_Perfect(ETH->MACA0HR & 0xFFFFU, ETH->MACA0LR, frame);
+	for (uint32_t i = 0U; i < 3U; i++)
+	{
+		if (((high[i] & (ETH_MACA1HR_AE | ETH_MACA1HR_SA)) == ETH_MACA1HR_AE)
+				&& HostEthDma_Perfect(high[i], low[i], frame))
+		{
+			perfect = 1U;
+		}
+	}
+	if ((ffr & (((frame[0] & 0x01U) != 0U) ? ETH_MACFFR_HM : ETH_MACFFR_HU)) == 0U)
+	{
+		return perfect;
+	}
+	bin = __RBIT(HostEthDma_Crc32(frame, 6U)) >> 26;
+	hashed = ((((bin >= 32U) ? ETH->MACHTHR : ETH->MACHTLR) >> (bin & 31U)) & 1U) != 0U;
+	return hashed || (((ffr & ETH_MACFFR_HPF) != 0U) && perfect);
+}
+
+/* Ones' complement sum of big-endian 16-bit words, not folded */
+static uint32_t HostEthDma_Sum(const uint8_t *data, uint32_t length, uint32_t sum)
+{
+	for (uint32_t i = 0U; (i + 1U) < length; i += 2U)
+	{
+		sum += ((uint32_t)data[i] << 8) | data[i + 1U];
+	}
+	if ((length & 1U) != 0U)
+	{
+		sum += (uint32_t)data[length - 1U] << 8;
+	}
+	return sum;
+}
+
+static uint16_t HostEthDma_Fold(uint32_t sum)
+{
+	while ((sum >> 16) != 0U)
+	{
+		sum = (sum & 0xFFFFU) + (sum >> 16);
+	}
+	return (uint16_t)sum;
+}
+
+/* The IPv4 datagram of a frame: header length and total length, 0 if the
+   frame is not IPv4 or its lengths do not fit */
+static uint32_t HostEthDma_Ipv4(const uint8_t *frame, uint32_t length, uint32_t *headerLength)
+{
+	const uint8_t *ip = &frame[HOST_ETH_DMA_IP];
+	uint32_t total;
+
+	if ((length < (HOST_ETH_DMA_IP + 20U)) || (frame[12] != 0x08U) || (frame[13] != 0x00U)
+			|| ((ip[0] >> 4) != 4U))
+	{
+		return 0U;
+	}
+	*headerLength = (ip[0] & 0x0FU) * 4U;
+	total = ((uint32_t)ip[2] << 8) | ip[3];
+	if ((*headerLength < 20U) || (total < *headerLength) || ((HOST_ETH_DMA_IP + total) > length))
+	{
+		return 0U;
+	}
+	return total;
+}
+
+/* TCP/UDP/ICMP checksum field offset in the segment, 0 for other payloads
+   and fragments, which the engine does not touch */
+static uint32_t HostEthDma_Segment(const uint8_t *ip, uint32_t total, uint32_t headerLength)
+{
+	uint32_t field;
+
+	if (((ip[6] & 0x3FU) | ip[7]) != 0U)
+	{
+		return 0U;
+	}
+	switch (ip[9])
+	{
+	case HOST_ETH_DMA_PROTO_ICMP: field = 2U; break;
+	case HOST_ETH_DMA_PROTO_TCP: field = 16U; break;
+	case HOST_ETH_DMA_PROTO_UDP: field = 6U; break;
+	default: return 0U;
+	}
+	return ((total - headerLength) >= (field + 2U)) ? field : 0U;
+}
+
+/* TCP/UDP/ICMP sum over the segment, with the pseudo-header except for ICMP */
+static uint32_t HostEthDma_SegmentSum(const uint8_t *ip, uint32_t total, uint32_t headerLength)
+{
+	uint32_t sum = HostEthDma_Sum(&ip[headerLength], total - headerLength, 0U);
+
+	if (ip[9] != HOST_ETH_DMA_PROTO_ICMP)
+	{
+		sum = HostEthDma_Sum(&ip[12], 8U, sum) + ip[9] + (total - headerLength);
+	}
+	return sum;
+}
+
+/* Receive side of the checksum engine: RDES4 */
+static uint32_t HostEthDma_RxChecksum(const uint8_t *frame, uint32_t length)
+{
+	const uint8_t *ip = &frame[HOST_ETH_DMA_IP];
+	uint32_t headerLength;
+	uint32_t total = HostEthDma_Ipv4(frame, length, &headerLength);
+	uint32_t field;
+	uint32_t status;
+
+	if (total == 0U)
+	{
+		/* Ethertype IPv4 with a broken header is a header error */
+		if ((frame[12] == 0x08U) && (frame[13] == 0x00U))
+		{
+			return ETH_DMAPTPRXDESC_IPV4PR | ETH_DMAPTPRXDESC_IPHE;
+		}
+		return 0U;
+	}
+	status = ETH_DMAPTPRXDESC_IPV4PR;
+	if (HostEthDma_Fold(HostEthDma_Sum(ip, headerLength, 0U)) != 0xFFFFU)
+	{
+		status |= ETH_DMAPTPRXDESC_IPHE;
+	}
+	field = HostEthDma_Segment(ip, total, headerLength);
+	if (field == 0U)
+	{
+		return status;
+	}
+	status |= (ip[9] == HOST_ETH_DMA_PROTO_UDP) ? ETH_DMAPTPRXDESC_IPPT_UDP
+		: (ip[9] == HOST_ETH_DMA_PROTO_TCP) ? ETH_DMAPTPRXDESC_IPPT_TCP : ETH_DMAPTPRXDESC_IPPT_ICMP;
+	/* A zero UDP checksum means none */
+	if (((ip[9] != HOST_ETH_DMA_PROTO_UDP) || ((ip[headerLength + 6U] | ip[headerLength + 7U]) != 0U))
+			&& (HostEthDma_Fold(HostEthDma_SegmentSum(ip, total, headerLength)) != 0xFFFFU))
+	{
+		status |= ETH_DMAPTPRXDESC_IPPE;
+	}
+	return status;
+}
+
+static void HostEthDma_Store(uint8_t *field, uint32_t sum)
+{
+	uint16_t checksum = (uint16_t)~HostEthDma_Fold(sum);
+
+	field[0] = (uint8_t)(checksum >> 8);
+	field[1] = (uint8_t)checksum;
+}
+
+/* Transmit side of the checksum engine, CIC of the first descriptor */
+static void HostEthDma_TxChecksum(uint8_t *frame, uint32_t length, uint32_t control)
+{
+	uint8_t *ip = &frame[HOST_ETH_DMA_IP];
+	uint32_t headerLength;
+	uint32_t total;
+	uint32_t field;
+
+	if ((control == ETH_DMATXDESC_CIC_BYPASS)
+			|| ((total = HostEthDma_Ipv4(frame, length, &headerLength)) == 0U))
+	{
+		return;
+	}
+	ip[10] = 0U;
+	ip[11] = 0U;
+	HostEthDma_Store(&ip[10], HostEthDma_Sum(ip, headerLength, 0U));
+
+	field = HostEthDma_Segment(ip, total, headerLength);
+	if ((control == ETH_DMATXDESC_CIC_IPV4HEADER) || (field == 0U))
+	{
+		return;
+	}
+	field += headerLength;
+	if (control == ETH_DMATXDESC_CIC_TCPUDPICMP_FULL)
+	{
+		/* Otherwise the field holds the pseudo-header sum, software's part */
+		ip[field] = 0U;
+		ip[field + 1U] = 0U;
+		HostEthDma_Store(&ip[field], HostEthDma_SegmentSum(ip, total, headerLength));
+	}
+	else
+	{
+		HostEthDma_Store(&ip[field], HostEthDma_Sum(&ip[headerLength], total - headerLength, 0U));
+	}
+	if ((ip[9] == HOST_ETH_DMA_PROTO_UDP) && ((ip[field] | ip[field + 1U]) == 0U))
+	{
+		ip[field] = 0xFFU;
+		ip[field + 1U] = 0xFFU;
+	}
+}
+
+static void HostEthDma_PtpShow(void)
+{
+	ETH->PTPTSHR = (uint32_t)(hostEthPtpTime / HOST_ETH_DMA_NS_PER_S);
+	ETH->PTPTSLR = (uint32_t)(hostEthPtpTime % HOST_ETH_DMA_NS_PER_S);
+}
+
+/* Received frames the TSSARFE/TSSPTPOEFE/TSSEME/TSSMRME filter stamps */
+static uint32_t HostEthDma_PtpSnapshot(const uint8_t *frame, uint32_t length)
+{
+	uint32_t control = ETH->PTPTSCR;
+	uint32_t type;
+
+	if ((control & ETH_PTPTSCR_TSE) == 0U)
+	{
+		return 0U;
+	}
+	if ((control & ETH_PTPTSCR_TSSARFE) != 0U)
+	{
+		return 1U;
+	}
+	if (((control & ETH_PTPTSCR_TSSPTPOEFE) == 0U) || (length <= HOST_ETH_DMA_IP)
+			|| ((((uint32_t)frame[12] << 8) | frame[13]) != HOST_ETH_DMA_PTP_TYPE))
+	{
+		return 0U;
+	}
+	type = frame[HOST_ETH_DMA_IP] & 0x0FU;
+	if ((control & ETH_PTPTSCR_TSSEME) != 0U)
+	{
+		/* Event messages of the port's role: Sync for a slave, Delay_Req for a master */
+		return type == (((control & ETH_PTPTSCR_TSSMRME) != 0U) ? 1U : 0U);
+	}
+	return (type == 0U) || (type == 1U) || (type == 8U) || (type == 9U);
+}
+
+static void HostEthDma_Missed(void)
+{
+	if ((hostEthMissed & ETH_DMAMFBOCR_MFC) == ETH_DMAMFBOCR_MFC)
+	{
+		hostEthMissed = (hostEthMissed & ~ETH_DMAMFBOCR_MFC) | ETH_DMAMFBOCR_OMFC;
+	}
+	else
+	{
+		hostEthMissed++;
+	}
+	hostEthStatus |= ETH_DMASR_RBUS;
+}
+
+/**
+ * @brief  Forget the descriptor pointers and pending events, as after a
+ *         reset of the MAC.
+ * @retval None
+ */
+void HostEthDma_Reset(void)
+{
+	hostEthRxCurrent = NULL;
+	hostEthTxCurrent = NULL;
+	hostEthRxList = 0U;
+	hostEthTxList = 0U;
+	hostEthStatus = 0U;
+	hostEthMissed = 0U;
+	HostEthDma_Show();
+	hostEthPtpTime = 0U;
+	hostEthPtpAccumulator = 0U;
+	hostEthPtpAddend = 0U;
+	hostEthPtpCycles = 0.0;
+	HostEthDma_PtpShow();
+}
+
+/**
+ * @brief  Set the receiver of transmitted frames (the wire).
+ * @param  sink: called once per frame, NULL drops them
+ * @retval None
+ */
+void HostEthDma_SetSink(HostEthDma_SinkTypeDef sink)
+{
+	hostEthSink = sink;
+}
+
+/**
+ * @brief  Model the destination address filter or pass every frame.
+ * @param  enable: 0 to pass every frame
+ * @retval None
+ */
+void HostEthDma_SetAddressFilter(uint32_t enable)
+{
+	hostEthAddressFilter = enable;
+}
+
+/**
+ * @brief  A frame arrives from the wire.
+ * @param  frame: destination MAC onwards, without FCS
+ * @param  length: bytes
+ * @retval 1 if stored in the RX ring, 0 if dropped (receiver stopped,
+ *         address filtered, not enough descriptors owned by the DMA or,
+ *         unless DMAOMR.DTCEFD is set, a checksum error)
+ */
+uint32_t HostEthDma_Receive(const uint8_t *frame, uint32_t length)
+{
+	ETH_DMADescTypeDef *desc;
+	uint32_t total = length + HOST_ETH_DMA_FCS_SIZE;
+	uint32_t room = 0U;
+	uint32_t offset = 0U;
+	uint32_t extended = 0U;
+	uint32_t stamp;
+	uint32_t status;
+
+	if (((ETH->DMAOMR & ETH_DMAOMR_SR) == 0U)
+			|| ((hostEthAddressFilter != 0U) && !HostEthDma_AddressMatch(frame)))
+	{
+		return 0U;
+	}
+	HostEthDma_Sync();
+	HostEthDma_Acknowledge();
+
+	if ((ETH->MACCR & ETH_MACCR_IPCO) != 0U)
+	{
+		extended = HostEthDma_RxChecksum(frame, length);
+		if (((extended & (ETH_DMAPTPRXDESC_IPHE | ETH_DMAPTPRXDESC_IPPE)) != 0U)
+				&& ((ETH->DMAOMR & ETH_DMAOMR_DTCEFD) == 0U))
+		{
+			HostEthDma_Show();
+			return 0U;
+		}
+	}
+
+	stamp = HostEthDma_PtpSnapshot(frame, length);
+
+	/* All or nothing: the MAC has no partial delivery either */
+	desc = hostEthRxCurrent;
+	for (uint32_t i = 0U; (room < total) && (i < HOST_ETH_DMA_MAX_DESC); i++)
+	{
+		if ((desc->DESC0 & ETH_DMARXDESC_OWN) == 0U)
+		{
+			break;
+		}
+		room += desc->DESC1 & ETH_DMARXDESC_RBS1;
+		desc = HOST_ETH_DMA_DESC(desc->DESC3);
+	}
+	if (room < total)
+	{
+		HostEthDma_Missed();
+		HostEthDma_Show();
+		return 0U;
+	}
+
+	desc = hostEthRxCurrent;
+	status = ETH_DMARXDESC_FS;
+	while (offset < total)
+	{
+		uint8_t *buffer = HOST_ETH_DMA_BUFFER(desc->DESC2);
+		uint32_t chunk = desc->DESC1 & ETH_DMARXDESC_RBS1;
+
+		if (chunk > (total - offset))
+		{
+			chunk = total - offset;
+		}
+		for (uint32_t i = 0U; i < chunk; i++)
+		{
+			buffer[i] = ((offset + i) < length) ? frame[offset + i] : 0U;
+		}
+		offset += chunk;
+
+		if (offset == total)
+		{
+			status |= ETH_DMARXDESC_LS | (total << HOST_ETH_DMA_FL_SHIFT);
+			if ((extended & ETH_DMAPTPRXDESC_IPHE) != 0U)
+			{
+				/* Bit 7 is TSV while the time stamp unit runs */
+				status |= ETH_DMARXDESC_ES | (((ETH->PTPTSCR & ETH_PTPTSCR_TSE) == 0U) ? ETH_DMARXDESC_IPV4HCE : 0U);
+			}
+			if (stamp != 0U)
+			{
+				desc->DESC6 = (uint32_t)(hostEthPtpTime % HOST_ETH_DMA_NS_PER_S);
+				desc->DESC7 = (uint32_t)(hostEthPtpTime / HOST_ETH_DMA_NS_PER_S);
+				status |= HOST_ETH_DMA_RDES0_TSV;
+			}
+			if ((ETH->DMABMR & ETH_DMABMR_EDE) != 0U)
+			{
+				desc->DESC4 = extended;
+				status |= HOST_ETH_DMA_RDES0_ESA;
+			}
+			if ((desc->DESC1 & ETH_DMARXDESC_DIC) == 0U)
+			{
+				hostEthStatus |= ETH_DMASR_RS;
+			}
+		}
+		/* Status and OWN clear in one write, the order the DMA closes a descriptor */
+		desc->DESC0 = status;
+		status = 0U;
+		desc = HOST_ETH_DMA_DESC(desc->DESC3);
+	}
+	hostEthRxCurrent = desc;
+	HostEthDma_Show();
+
+	return 1U;
+}
+
+/**
+ * @brief  Send the frames queued in the TX ring to the sink, or back to
+ *         the receiver in loopback mode.
+ * @retval frames sent
+ */
+uint32_t HostEthDma_Transmit(void)
+{
+	uint32_t frames = 0U;
+	uint32_t length = 0U;
+	uint32_t control = ETH_DMATXDESC_CIC_BYPASS;
+	uint32_t stamp = 0U;
+	uint32_t looped = 0U;
+
+	if ((ETH->DMAOMR & ETH_DMAOMR_ST) == 0U)
+	{
+		return 0U;
+	}
+	HostEthDma_Sync();
+	HostEthDma_Acknowledge();
+
+	while ((hostEthTxCurrent->DESC0 & ETH_DMATXDESC_OWN) != 0U)
+	{
+		ETH_DMADescTypeDef *desc = hostEthTxCurrent;
+		uint32_t size = desc->DESC1 & ETH_DMATXDESC_TBS1;
+
+		if ((desc->DESC0 & ETH_DMATXDESC_FS) != 0U)
+		{
+			length = 0U;
+			control = desc->DESC0 & ETH_DMATXDESC_CIC;
+			stamp = desc->DESC0 & ETH_DMATXDESC_TTSE;
+		}
+		if ((length + size) <= sizeof(hostEthTxFrame))
+		{
+			memcpy(&hostEthTxFrame[length], HOST_ETH_DMA_BUFFER(desc->DESC2), size);
+			length += size;
+		}
+
+		desc->DESC0 &= ~(ETH_DMATXDESC_OWN | ETH_DMATXDESC_ES);
+		hostEthTxCurrent = HOST_ETH_DMA_DESC(desc->DESC3);
+
+		if ((desc->DESC0 & ETH_DMATXDESC_LS) != 0U)
+		{
+			if ((desc->DESC0 & ETH_DMATXDESC_IC) != 0U)
+			{
+				hostEthStatus |= ETH_DMASR_TS;
+			}
+			if ((ETH->MACCR & ETH_MACCR_IPCO) != 0U)
+			{
+				HostEthDma_TxChecksum(hostEthTxFrame, length, control);
+			}
+			if ((stamp != 0U) && ((ETH->PTPTSCR & ETH_PTPTSCR_TSE) != 0U))
+			{
+				desc->DESC6 = (uint32_t)(hostEthPtpTime % HOST_ETH_DMA_NS_PER_S);
+				desc->DESC7 = (uint32_t)(hostEthPtpTime / HOST_ETH_DMA_NS_PER_S);
+				desc->DESC0 |= ETH_DMATXDESC_TTSS;
+			}
+			if ((ETH->MACCR & ETH_MACCR_LM) != 0U)
+			{
+				if (looped < HOST_ETH_DMA_LOOPBACK)
+				{
+					memcpy(hostEthLoopback[looped], hostEthTxFrame, length);
+					hostEthLoopbackLength[looped++] = length;
+				}
+			}
+			else if (hostEthSink != NULL)
+			{
+				hostEthSink(hostEthTxFrame, length);
+			}
+			frames++;
+		}
+	}
+	HostEthDma_Show();
+
+	/* After the walk: a receive in the middle would take the DMASR write */
+	for (uint32_t i = 0U; i < looped; i++)
+	{
+		(void)HostEthDma_Receive(hostEthLoopback[i], hostEthLoopbackLength[i]);
+	}
+
+	return frames;
+}
+
+/**
+ * @brief  Take the pending DMA events whose interrupt is enabled in DMAIER.
+ * @note   DMAIER and DMASR share the bit positions. Each event is shown
+ *         alone in DMASR with its summary bit, like a tail-chained
+ *         interrupt per event, and stays pending unless the handler clears
+ *         it. Events with a masked enable stay pending, a driver has to
+ *         clear them before unmasking or take the interrupt at once.
+ * @param  handler: ETH interrupt handler
+ * @retval handler calls
+ */
+uint32_t HostEthDma_Interrupt(void (*handler)(void))
+{
+	static const uint32_t event[] = { ETH_DMASR_RS, ETH_DMASR_TS, ETH_DMASR_RBUS };
+	uint32_t delivered = 0U;
+
+	HostEthDma_Acknowledge();
+	for (uint32_t i = 0U; i < (sizeof(event) / sizeof(event[0])); i++)
+	{
+		uint32_t summary = (event[i] == ETH_DMASR_RBUS) ? ETH_DMASR_AIS : ETH_DMASR_NIS;
+
+		if (((hostEthStatus & event[i]) != 0U) && ((ETH->DMAIER & event[i]) != 0U)
+				&& ((ETH->DMAIER & summary) != 0U))
+		{
+			hostEthStatus |= summary;
+			ETH->DMASR = event[i] | summary | HOST_ETH_DMA_SHOWN;
+			handler();
+			HostEthDma_Acknowledge();
+			delivered++;
+		}
+	}
+
+	return delivered;
+}
+
+/**
+ * @brief  Read DMAMFBOCR the way the driver does, clearing the counters.
+ * @retval register value
+ */
+uint32_t HostEthDma_ReadMissed(void)
+{
+	uint32_t missed = hostEthMissed;
+
+	hostEthMissed = 0U;
+	ETH->DMAMFBOCR = 0U;
+	return missed;
+}
+
+/**
+ * @brief  Descriptors ready for reception, from the current RX pointer on.
+ * @retval count
+ */
+uint32_t HostEthDma_RxFree(void)
+{
+	ETH_DMADescTypeDef *desc;
+	uint32_t count = 0U;
+
+	HostEthDma_Sync();
+	desc = hostEthRxCurrent;
+	while ((desc != NULL) && ((desc->DESC0 & ETH_DMARXDESC_OWN) != 0U) && (count < HOST_ETH_DMA_MAX_DESC))
+	{
+		count++;
+		desc = HOST_ETH_DMA_DESC(desc->DESC3);
+		if (desc == hostEthRxCurrent)
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief  Set the error of the clock the time stamp unit counts.
+ * @param  ppb: HCLK frequency error, parts per billion, positive is fast
+ * @retval None
+ */
+void HostEthDma_PtpSetDrift(int32_t ppb)
+{
+	hostEthPtpDrift = ppb;
+}
+
+/**
+ * @brief  Let time pass for the time stamp unit.
+ * @param  ns: true time elapsed
+ * @retval None
+ */
+void HostEthDma_PtpAdvance(uint32_t ns)
+{
+	double cycles = hostEthPtpCycles
+		+ (((double)ns * SystemCoreClock * (1.0 + (hostEthPtpDrift * 1e-9))) / (double)HOST_ETH_DMA_NS_PER_S);
+	uint64_t whole = (uint64_t)cycles;
+	uint32_t increment = ETH->PTPSSIR & ETH_PTPSSIR_STSSI;
+
+	HostEthDma_PtpCommand();
+	hostEthPtpCycles = cycles - (double)whole;
+	if ((ETH->PTPTSCR & ETH_PTPTSCR_TSE) == 0U)
+	{
+		return;
+	}
+	if ((ETH->PTPTSCR & ETH_PTPTSCR_TSFCU) != 0U)
+	{
+		uint64_t sum = hostEthPtpAccumulator + (whole * hostEthPtpAddend);
+
+		hostEthPtpAccumulator = (uint32_t)sum;
+		hostEthPtpTime += (sum >> 32) * increment;
+	}
+	else
+	{
+		hostEthPtpTime += whole * increment;
+	}
+	HostEthDma_PtpShow();
+}
+
+/**
+ * @brief  Complete the pending time stamp unit commands: TSSTI, TSSTU and
+ *         TSARU of PTPTSCR.
+ * @retval None
+ */
+void HostEthDma_PtpCommand(void)
+{
+	uint32_t control = ETH->PTPTSCR;
+	uint32_t high = ETH->PTPTSHUR;
+	uint32_t low = ETH->PTPTSLUR & ETH_PTPTSLUR_TSUSS;
+
+	if ((control & ETH_PTPTSCR_TSE) == 0U)
+	{
+		return;
+	}
+	if ((control & ETH_PTPTSCR_TSSTI) != 0U)
+	{
+		hostEthPtpTime = ((uint64_t)high * HOST_ETH_DMA_NS_PER_S) + low;
+	}
+	if ((control & ETH_PTPTSCR_TSSTU) != 0U)
+	{
+		if ((ETH->PTPTSLUR & ETH_PTPTSLUR_TSUPNS) != 0U)
+		{
+			/* Subtract: seconds as 2^32 - s, nanoseconds as 10^9 - ns */
+			hostEthPtpTime -= ((uint64_t)(0U - high) * HOST_ETH_DMA_NS_PER_S) + (HOST_ETH_DMA_NS_PER_S - low);
+		}
+		else
+		{
+			hostEthPtpTime += ((uint64_t)high * HOST_ETH_DMA_NS_PER_S) + low;
+		}
+	}
+	if ((control & ETH_PTPTSCR_TSARU) != 0U)
+	{
+		hostEthPtpAddend = ETH->PTPTSAR;
+	}
+	ETH->PTPTSCR = control & ~(ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU | ETH_PTPTSCR_TSARU);
+	HostEthDma_PtpShow();
+}
+
+/**
+ * @brief  Time of the time stamp unit.
+ * @retval ns
+ */
+uint64_t HostEthDma_PtpTime(void)
+{
+	return hostEthPtpTime;
+}
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    host_bench_core.c
+  * @brief   Host checks and benchmarks of bench_core.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bench_core.h"
+#include "host_test.h"
+
+/* Exported functions --------------------------------------------------------*/
+/* Whole benchmark iterations, checked against a reference run */
+void Bench_BenchCore_Iterate(uint32_t iterations)
+{
+	uint16_t reference = 0;
+	uint16_t crc = 0;
+
+	for (uint32_t i = 0; i < 10U; i++)
+	{
+		reference = BenchCore_Iterate(reference);
+	}
+
+	/* iterations counts thousandths of a benchmark iteration */
+	iterations = (iterations + 999U) / 1000U;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		crc = BenchCore_Iterate(crc);
+		Bench_Expect("BenchCore", (i != 9U) || (crc == reference), "deterministic");
+	}
+}
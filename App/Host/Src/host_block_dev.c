@@ -0,0 +1,412 @@
+/**
+  ******************************************************************************
+  * @file    host_block_dev.c
+  * @brief   Host checks and benchmarks of block_dev.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "block_dev.h"
+#include "dma_buffer.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_BLOCK_CARD_BLOCKS 1024U   /* file-backed card */
+#define BENCH_BLOCK_CACHE_LINES 8U
+#define BENCH_BLOCK_BATCH       6U      /* requests queued at once in the random mix */
+#define BENCH_BLOCK_MAX_COUNT   12U     /* blocks per random request, across lines */
+#define BENCH_BLOCK_ROUNDS      3000U
+
+/* Private variables ---------------------------------------------------------*/
+static FILE *benchBlockCard;
+static uint8_t benchBlockCache[BENCH_BLOCK_CACHE_LINES * BLOCK_DEV_LINE_SIZE] __attribute__((aligned(DMA_BUFFER_LINE)));
+static uint32_t benchBlockDefer;        /* 1: completions wait for the host loop */
+static uint32_t benchBlockPending;      /* operation started, its completion not reported */
+static uint8_t *benchBlockBuffer;
+static uint32_t benchBlockFirst;
+static uint32_t benchBlockCount;
+static uint32_t benchBlockWriting;
+static uint32_t benchBlockBusy;         /* operations to refuse busy */
+static uint32_t benchBlockFailAt;       /* operation number to fail, 0: none */
+static uint32_t benchBlockOps;          /* operations started */
+static uint32_t benchBlockCommands[2];  /* reads, writes started */
+
+/* Private functions ---------------------------------------------------------*/
+/* File-backed card: an operation moves its blocks from or to the file
+   when it completes, as the DMA would, either from within the call or
+   when the host loop of Bench_BlockWait() reports it */
+static HAL_StatusTypeDef Bench_BlockCapacity(uint32_t *blocks)
+{
+	*blocks = BENCH_BLOCK_CARD_BLOCKS;
+	return HAL_OK;
+}
+
+static void Bench_BlockComplete(void)
+{
+	HAL_StatusTypeDef status = (benchBlockOps == benchBlockFailAt) ? HAL_ERROR : HAL_OK;
+	size_t length = benchBlockCount * BLOCK_DEV_BLOCK_SIZE;
+
+	benchBlockPending = 0U;
+	if (status == HAL_OK)
+	{
+		Bench_Expect("BlockDev", fseek(benchBlockCard, (long)(benchBlockFirst * BLOCK_DEV_BLOCK_SIZE), SEEK_SET) == 0,
+			"card seek");
+		if (benchBlockWriting != 0U)
+		{
+			Bench_Expect("BlockDev", fwrite(benchBlockBuffer, 1, length, benchBlockCard) == length, "card write");
+		}
+		else
+		{
+			Bench_Expect("BlockDev", fread(benchBlockBuffer, 1, length, benchBlockCard) == length, "card read");
+		}
+	}
+	BlockDev_DeviceDone(status);
+}
+
+static HAL_StatusTypeDef Bench_BlockStart(uint8_t *buffer, uint32_t block, uint32_t count, uint32_t writing)
+{
+	Bench_Expect("BlockDev", benchBlockPending == 0U, "one device operation at a time");
+	Bench_Expect("BlockDev", (count != 0U) && (block + count <= BENCH_BLOCK_CARD_BLOCKS)
+		&& (block / BLOCK_DEV_LINE_BLOCKS == (block + count - 1U) / BLOCK_DEV_LINE_BLOCKS), "within one line");
+	if (benchBlockBusy != 0U)
+	{
+		benchBlockBusy--;
+		return HAL_BUSY;
+	}
+	benchBlockOps++;
+	benchBlockCommands[writing]++;
+	benchBlockBuffer = buffer;
+	benchBlockFirst = block;
+	benchBlockCount = count;
+	benchBlockWriting = writing;
+	benchBlockPending = 1U;
+	if (benchBlockDefer == 0U)
+	{
+		Bench_BlockComplete();
+	}
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef Bench_BlockRead(uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	return Bench_BlockStart(buffer, block, count, 0U);
+}
+
+static HAL_StatusTypeDef Bench_BlockWrite(const uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	return Bench_BlockStart((uint8_t *)buffer, block, count, 1U);
+}
+
+static const BlockDev_DeviceTypeDef benchBlockDevice =
+{
+	.capacity = Bench_BlockCapacity,
+	.read = Bench_BlockRead,
+	.write = Bench_BlockWrite
+};
+
+/* Request callback: arg is an int, -1 until done */
+static void Bench_BlockDone(HAL_StatusTypeDef status, void *arg)
+{
+	*(int *)arg = (int)status;
+}
+
+/* Device completions and polls until the request is done, then until the
+   device is idle, read-ahead and write-behind included */
+static int Bench_BlockWait(volatile int *result)
+{
+	uint32_t idle = 0;
+
+	for (;;)
+	{
+		if (benchBlockPending != 0U)
+		{
+			Bench_BlockComplete();
+			idle = 0;
+		}
+		else if (*result >= 0)
+		{
+			return *result;
+		}
+		else
+		{
+			Bench_Expect("BlockDev", ++idle < 8U, "request stuck");
+			BlockDev_Poll();
+		}
+	}
+}
+
+static int Bench_BlockWriteWait(const uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	int result = -1;
+
+	Bench_Expect("BlockDev", BlockDev_Write(buffer, block, count, Bench_BlockDone, &result) == HAL_OK, "write queued");
+	return Bench_BlockWait(&result);
+}
+
+static int Bench_BlockReadWait(uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	int result = -1;
+
+	Bench_Expect("BlockDev", BlockDev_Read(buffer, block, count, Bench_BlockDone, &result) == HAL_OK, "read queued");
+	return Bench_BlockWait(&result);
+}
+
+static int Bench_BlockFlushWait(void)
+{
+	int result = -1;
+
+	Bench_Expect("BlockDev", BlockDev_Flush(Bench_BlockDone, &result) == HAL_OK, "flush queued");
+	return Bench_BlockWait(&result);
+}
+
+/* Card file against the reference image */
+static int Bench_BlockCardIs(const uint8_t *image)
+{
+	static uint8_t card[BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE];
+
+	return (fseek(benchBlockCard, 0, SEEK_SET) == 0) && (fread(card, 1, sizeof(card), benchBlockCard) == sizeof(card))
+		&& (memcmp(card, image, sizeof(card)) == 0);
+}
+
+static void Bench_BlockStart_Card(uint8_t *image)
+{
+	benchBlockDefer = 1U;
+	benchBlockPending = 0U;
+	benchBlockBusy = 0U;
+	benchBlockFailAt = 0U;
+	benchBlockOps = 0U;
+	benchBlockCommands[0] = benchBlockCommands[1] = 0U;
+	if (benchBlockCard == NULL)
+	{
+		benchBlockCard = tmpfile();
+		Bench_Expect("BlockDev", benchBlockCard != NULL, "card file");
+	}
+	for (uint32_t i = 0; i < BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE; i++)
+	{
+		image[i] = (uint8_t)(i * 13U + i / BLOCK_DEV_BLOCK_SIZE);
+	}
+	Bench_Expect("BlockDev", (fseek(benchBlockCard, 0, SEEK_SET) == 0) && (fwrite(image, 1,
+		BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE, benchBlockCard) == BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE),
+		"card image");
+}
+
+static void Bench_BlockRecord(uint8_t *block, uint32_t record)
+{
+	memset(block, (int)(record & 0xFFU), BLOCK_DEV_BLOCK_SIZE);
+	memcpy(block, &record, sizeof(record));
+}
+
+/* Logger writes, read-ahead, partial lines, a random mix against a
+   reference image, device errors and a full queue */
+static void Bench_BlockDev_Check(void)
+{
+	static uint8_t image[BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE];
+	static uint8_t buffers[BENCH_BLOCK_BATCH][BENCH_BLOCK_MAX_COUNT * BLOCK_DEV_BLOCK_SIZE];
+	static uint8_t expected[BENCH_BLOCK_BATCH][BENCH_BLOCK_MAX_COUNT * BLOCK_DEV_BLOCK_SIZE];
+	uint8_t *block = buffers[0];
+	BlockDev_StatsTypeDef stats;
+	int results[BLOCK_DEV_QUEUE_DEPTH];
+	uint32_t counts[BENCH_BLOCK_BATCH];
+	uint32_t kinds[BENCH_BLOCK_BATCH];
+	uint32_t seed = 5U;
+
+	Bench_BlockStart_Card(image);
+	Bench_Expect("BlockDev", (BlockDev_Init(&benchBlockDevice, &benchBlockCache[1], sizeof(benchBlockCache) - 32U) == HAL_ERROR)
+		&& (BlockDev_Init(&benchBlockDevice, benchBlockCache, BLOCK_DEV_LINE_SIZE) == HAL_ERROR)
+		&& (BlockDev_GetBlockCount() == 0U), "cache misaligned or too small");
+	Bench_Expect("BlockDev", (BlockDev_Init(&benchBlockDevice, benchBlockCache, sizeof(benchBlockCache)) == HAL_OK)
+		&& (BlockDev_GetBlockCount() == BENCH_BLOCK_CARD_BLOCKS), "init");
+	Bench_Expect("BlockDev", (BlockDev_Read(block, BENCH_BLOCK_CARD_BLOCKS, 1, NULL, NULL) == HAL_ERROR)
+		&& (BlockDev_Write(block, BENCH_BLOCK_CARD_BLOCKS - 1U, 2, NULL, NULL) == HAL_ERROR)
+		&& (BlockDev_Read(block, 0, 0, NULL, NULL) == HAL_ERROR), "out of the medium");
+
+	/* Logger: one record per block, done at once; each line goes out in
+	   one write once full, not one write per record */
+	for (uint32_t i = 0; i < 64U; i++)
+	{
+		int result = -1;
+
+		Bench_BlockRecord(block, i);
+		memcpy(&image[(96U + i) * BLOCK_DEV_BLOCK_SIZE], block, BLOCK_DEV_BLOCK_SIZE);
+		Bench_Expect("BlockDev", (BlockDev_Write(block, 96U + i, 1, Bench_BlockDone, &result) == HAL_OK) && (result == HAL_OK),
+			"record written into the cache");
+		(void)Bench_BlockWait(&result);
+	}
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && (benchBlockCommands[1] == 8U), "logger: 8 writes");
+	Bench_Expect("BlockDev", Bench_BlockCardIs(image), "logger records on the card");
+
+	/* The same block over and over: one write at the flush */
+	for (uint32_t i = 0; i < 50U; i++)
+	{
+		Bench_BlockRecord(block, 1000U + i);
+		Bench_Expect("BlockDev", Bench_BlockWriteWait(block, 5, 1) == HAL_OK, "rewrite");
+	}
+	memcpy(&image[5U * BLOCK_DEV_BLOCK_SIZE], block, BLOCK_DEV_BLOCK_SIZE);
+	BlockDev_GetStats(&stats);
+	Bench_Expect("BlockDev", (benchBlockCommands[1] == 8U) && (stats.merged == 49U), "rewrites held in the cache");
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && (benchBlockCommands[1] == 9U)
+		&& Bench_BlockCardIs(image), "rewrites flushed at once");
+
+	/* Two dirty runs of a line: two writes */
+	for (uint32_t i = 0; i < 3U; i++)
+	{
+		uint32_t at = (i == 2U) ? 205U : (200U + i);
+
+		Bench_BlockRecord(block, 2000U + i);
+		memcpy(&image[at * BLOCK_DEV_BLOCK_SIZE], block, BLOCK_DEV_BLOCK_SIZE);
+		Bench_Expect("BlockDev", Bench_BlockWriteWait(block, at, 1) == HAL_OK, "run write");
+	}
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && (benchBlockCommands[1] == 11U)
+		&& Bench_BlockCardIs(image), "dirty runs");
+	Bench_Expect("BlockDev", Bench_BlockFlushWait() == HAL_OK, "flush of a clean cache");
+
+	/* Sequential reader: one miss, the following lines read ahead */
+	Bench_Expect("BlockDev", BlockDev_Init(&benchBlockDevice, benchBlockCache, sizeof(benchBlockCache)) == HAL_OK, "re-init");
+	for (uint32_t i = 0; i < 64U; i++)
+	{
+		Bench_Expect("BlockDev", (Bench_BlockReadWait(block, 400U + i, 1) == HAL_OK)
+			&& (memcmp(block, &image[(400U + i) * BLOCK_DEV_BLOCK_SIZE], BLOCK_DEV_BLOCK_SIZE) == 0), "sequential read");
+	}
+	BlockDev_GetStats(&stats);
+	Bench_Expect("BlockDev", (stats.fills == 10U) && (stats.aheadFills == 9U) && (stats.hits == 64U)
+		&& (benchBlockCommands[0] == 10U), "read-ahead");
+
+	/* Lines partly written: the fills only read the blocks missing */
+	Bench_Expect("BlockDev", BlockDev_Init(&benchBlockDevice, benchBlockCache, sizeof(benchBlockCache)) == HAL_OK, "re-init");
+	for (uint32_t i = 0; i < 3U; i++)
+	{
+		uint32_t at = (i == 2U) ? 532U : (520U + i);
+
+		Bench_BlockRecord(block, 3000U + i);
+		memcpy(&image[at * BLOCK_DEV_BLOCK_SIZE], block, BLOCK_DEV_BLOCK_SIZE);
+		Bench_Expect("BlockDev", Bench_BlockWriteWait(block, at, 1) == HAL_OK, "partial write");
+	}
+	Bench_Expect("BlockDev", (Bench_BlockReadWait(block, 520, 16) == HAL_OK)
+		&& (memcmp(block, &image[520U * BLOCK_DEV_BLOCK_SIZE], 16U * BLOCK_DEV_BLOCK_SIZE) == 0), "partial read");
+	BlockDev_GetStats(&stats);
+	Bench_Expect("BlockDev", (stats.fills == 3U) && (stats.fillBlocks == 6U + 4U + 3U), "fills of the missing runs");
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && Bench_BlockCardIs(image), "partial lines flushed");
+
+	/* Random mix: batches queued at once, more lines than the cache holds,
+	   the device now and then busy */
+	for (uint32_t round = 0; round < BENCH_BLOCK_ROUNDS; round++)
+	{
+		uint32_t batch;
+
+		seed = seed * 1664525U + 1013904223U;
+		batch = 1U + (seed >> 24) % BENCH_BLOCK_BATCH;
+		for (uint32_t k = 0; k < batch; k++)
+		{
+			uint32_t at;
+
+			seed = seed * 1664525U + 1013904223U;
+			counts[k] = 1U + (seed >> 8) % BENCH_BLOCK_MAX_COUNT;
+			at = (seed >> 12) % (BENCH_BLOCK_CARD_BLOCKS - counts[k] + 1U);
+			kinds[k] = (seed >> 28) % 8U;
+			benchBlockBusy = ((seed & 0x1FU) == 0U) ? 2U : 0U;
+			results[k] = -1;
+			if (kinds[k] == 0U)
+			{
+				Bench_Expect("BlockDev", BlockDev_Flush(Bench_BlockDone, &results[k]) == HAL_OK, "random flush");
+			}
+			else if (kinds[k] < 4U)
+			{
+				for (uint32_t i = 0; i < counts[k] * BLOCK_DEV_BLOCK_SIZE; i++)
+				{
+					buffers[k][i] = (uint8_t)((seed >> (i & 15U)) ^ i);
+				}
+				memcpy(&image[at * BLOCK_DEV_BLOCK_SIZE], buffers[k], counts[k] * BLOCK_DEV_BLOCK_SIZE);
+				Bench_Expect("BlockDev", BlockDev_Write(buffers[k], at, counts[k], Bench_BlockDone, &results[k]) == HAL_OK,
+					"random write");
+			}
+			else
+			{
+				/* Served in order: the image as it is now, later writes not */
+				memcpy(expected[k], &image[at * BLOCK_DEV_BLOCK_SIZE], counts[k] * BLOCK_DEV_BLOCK_SIZE);
+				Bench_Expect("BlockDev", BlockDev_Read(buffers[k], at, counts[k], Bench_BlockDone, &results[k]) == HAL_OK,
+					"random read");
+			}
+		}
+		for (uint32_t k = 0; k < batch; k++)
+		{
+			Bench_Expect("BlockDev", Bench_BlockWait(&results[k]) == HAL_OK, "random request");
+			Bench_Expect("BlockDev", (kinds[k] < 4U)
+				|| (memcmp(buffers[k], expected[k], counts[k] * BLOCK_DEV_BLOCK_SIZE) == 0), "random read data");
+		}
+	}
+	benchBlockBusy = 0U;
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && Bench_BlockCardIs(image), "random mix on the card");
+
+	/* A write-back failing: reported by the flush, the blocks lost, the
+	   next flush clean again */
+	Bench_BlockRecord(block, 4000U);
+	Bench_Expect("BlockDev", Bench_BlockWriteWait(block, 700, 1) == HAL_OK, "write to fail");
+	benchBlockFailAt = benchBlockOps + 1U;
+	Bench_Expect("BlockDev", Bench_BlockFlushWait() == HAL_ERROR, "flush reports the failed write-back");
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && Bench_BlockCardIs(image), "failed blocks lost");
+	Bench_Expect("BlockDev", (Bench_BlockReadWait(block, 700, 1) == HAL_OK)
+		&& (memcmp(block, &image[700U * BLOCK_DEV_BLOCK_SIZE], BLOCK_DEV_BLOCK_SIZE) == 0), "read back from the card");
+
+	/* A fill failing: that read fails, the next one is filled again */
+	Bench_Expect("BlockDev", BlockDev_Init(&benchBlockDevice, benchBlockCache, sizeof(benchBlockCache)) == HAL_OK, "re-init");
+	benchBlockFailAt = benchBlockOps + 1U;
+	Bench_Expect("BlockDev", Bench_BlockReadWait(block, 900, 2) == HAL_ERROR, "read error");
+	Bench_Expect("BlockDev", (Bench_BlockReadWait(block, 900, 2) == HAL_OK)
+		&& (memcmp(block, &image[900U * BLOCK_DEV_BLOCK_SIZE], 2U * BLOCK_DEV_BLOCK_SIZE) == 0), "read after error");
+
+	/* Queue full behind a read waiting for its fill */
+	for (uint32_t k = 0; k < BLOCK_DEV_QUEUE_DEPTH; k++)
+	{
+		results[k] = -1;
+		Bench_Expect("BlockDev", BlockDev_Read(buffers[k % BENCH_BLOCK_BATCH], k * 2U * BLOCK_DEV_LINE_BLOCKS, 1,
+			Bench_BlockDone, &results[k]) == HAL_OK, "read queued");
+	}
+	Bench_Expect("BlockDev", BlockDev_Flush(NULL, NULL) == HAL_BUSY, "queue full");
+	for (uint32_t k = 0; k < BLOCK_DEV_QUEUE_DEPTH; k++)
+	{
+		Bench_Expect("BlockDev", Bench_BlockWait(&results[k]) == HAL_OK, "queued read");
+	}
+
+	BlockDev_GetStats(&stats);
+	Bench_Expect("BlockDev", (stats.errors == 1U) && (stats.busy == 0U), "counters since the last init");
+
+	/* Completions from within the device call */
+	benchBlockDefer = 0U;
+	for (uint32_t i = 0; i < 2U * BLOCK_DEV_LINE_BLOCKS; i++)
+	{
+		Bench_BlockRecord(block, 5000U + i);
+		memcpy(&image[(800U + i) * BLOCK_DEV_BLOCK_SIZE], block, BLOCK_DEV_BLOCK_SIZE);
+		Bench_Expect("BlockDev", Bench_BlockWriteWait(block, 800U + i, 1) == HAL_OK, "immediate write");
+	}
+	Bench_Expect("BlockDev", (Bench_BlockFlushWait() == HAL_OK) && Bench_BlockCardIs(image), "immediate completions");
+	benchBlockDefer = 1U;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Logger records of one block each, the card completing at once: cost of
+   a record with the write-back of the full lines */
+void Bench_BlockDev_Log(uint32_t iterations)
+{
+	static uint8_t image[BENCH_BLOCK_CARD_BLOCKS * BLOCK_DEV_BLOCK_SIZE];
+	uint8_t record[BLOCK_DEV_BLOCK_SIZE];
+	uint32_t writes;
+
+	Bench_BlockDev_Check();
+
+	Bench_BlockStart_Card(image);
+	benchBlockDefer = 0U;
+	Bench_Expect("BlockDev", BlockDev_Init(&benchBlockDevice, benchBlockCache, sizeof(benchBlockCache)) == HAL_OK,
+		"bench init");
+	memset(record, 0x5A, sizeof(record));
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		(void)BlockDev_Write(record, i % BENCH_BLOCK_CARD_BLOCKS, 1, NULL, NULL);
+	}
+	(void)BlockDev_Flush(NULL, NULL);
+	writes = benchBlockCommands[1];
+	Bench_Expect("BlockDev", writes == (iterations + BLOCK_DEV_LINE_BLOCKS - 1U) / BLOCK_DEV_LINE_BLOCKS, "bench writes");
+	printf("  %lu records in %lu card writes\n", (unsigned long)iterations, (unsigned long)writes);
+}
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    host_crc_stream.c
+  * @brief   Host checks and benchmarks of crc_stream.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "crc_stream.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_CRC_SIZE          4096U
+
+/* Private variables ---------------------------------------------------------*/
+static CrcStream_TableTypeDef benchCrcTable;
+static uint8_t benchCrcData[BENCH_CRC_SIZE + 8U];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Check every engine against the catalogue check values ("123456789")
+ *         and chunked against one-shot on random data.
+ */
+static void Bench_CrcStream_Check(void)
+{
+	static const struct
+	{
+		const CrcStream_ConfigTypeDef *config;
+		uint32_t check;
+	} vector[] =
+	{
+		{ &crcStreamCrc32,       0xCBF43926UL },
+		{ &crcStreamCrc32C,      0xE3069283UL },
+		{ &crcStreamCrc32Mpeg2,  0x0376E6E7UL },
+		{ &crcStreamCrc16Ccitt,  0x29B1U },
+		{ &crcStreamCrc16Modbus, 0x4B37U },
+		{ &crcStreamCrc8,        0xF4U },
+	};
+	static CrcStream_TableTypeDef table;
+	CrcStream_TypeDef stream;
+	uint32_t seed = 5;
+
+	for (uint32_t i = 0; i < BENCH_CRC_SIZE; i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		benchCrcData[i] = (uint8_t)(seed >> 24);
+	}
+
+	for (size_t v = 0; v < sizeof(vector) / sizeof(vector[0]); v++)
+	{
+		CrcStream_TableInit(&table, vector[v].config);
+		Bench_Expect("CrcStream", CrcStream_Compute(vector[v].config, &table, "123456789", 9U) == vector[v].check,
+			"check value, slice-by-8");
+		Bench_Expect("CrcStream", CrcStream_Compute(vector[v].config, NULL, "123456789", 9U) == vector[v].check,
+			"check value, bitwise");
+
+		/* Odd chunk sizes and alignments through both engines */
+		uint32_t reference = CrcStream_Compute(vector[v].config, NULL, benchCrcData, BENCH_CRC_SIZE);
+		CrcStream_Begin(&stream, vector[v].config, &table);
+		for (uint32_t offset = 0, chunk = 1; offset < BENCH_CRC_SIZE; offset += chunk, chunk = chunk * 3U % 97U + 1U)
+		{
+			CrcStream_Update(&stream, benchCrcData + offset,
+				(offset + chunk > BENCH_CRC_SIZE) ? (BENCH_CRC_SIZE - offset) : chunk);
+		}
+		Bench_Expect("CrcStream", CrcStream_Final(&stream) == reference, "chunked equals one-shot");
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_CrcStream_Table(uint32_t iterations)
+{
+	uint32_t crc = 0;
+
+	Bench_CrcStream_Check();
+	CrcStream_TableInit(&benchCrcTable, &crcStreamCrc32);
+
+	/* iterations counts bytes, CRC-32 over an unaligned 4 KB block */
+	for (uint32_t done = 0; done < iterations; done += BENCH_CRC_SIZE)
+	{
+		uint32_t length = (iterations - done < BENCH_CRC_SIZE) ? (iterations - done) : BENCH_CRC_SIZE;
+
+		crc ^= CrcStream_Compute(&crcStreamCrc32, &benchCrcTable, benchCrcData + 1, length);
+	}
+	__asm__ volatile ("" : : "r" (crc));
+}
+
+void Bench_CrcStream_Bitwise(uint32_t iterations)
+{
+	uint32_t crc = 0;
+
+	/* iterations counts bytes */
+	for (uint32_t done = 0; done < iterations; done += BENCH_CRC_SIZE)
+	{
+		uint32_t length = (iterations - done < BENCH_CRC_SIZE) ? (iterations - done) : BENCH_CRC_SIZE;
+
+		crc ^= CrcStream_Compute(&crcStreamCrc32, NULL, benchCrcData, length);
+	}
+	__asm__ volatile ("" : : "r" (crc));
+}
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    host_damage.c
+  * @brief   Host checks and benchmarks of damage.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "damage.h"
+#include "host_test.h"
+#include "lcd_comp.h"
+
+/* Private functions ---------------------------------------------------------*/
+/* Marks rect, clipped, in a width-wide bitmap; pixels newly marked */
+static uint32_t Bench_DamageMark(uint8_t *bitmap, uint32_t width, uint32_t height, const Damage_RectTypeDef *rect)
+{
+	uint32_t marked = 0U;
+
+	for (uint32_t y = rect->y; (y < rect->y + rect->height) && (y < height); y++)
+	{
+		for (uint32_t x = rect->x; (x < rect->x + rect->width) && (x < width); x++)
+		{
+			marked += (bitmap[(y * width) + x] == 0U) ? 1U : 0U;
+			bitmap[(y * width) + x] = 1U;
+		}
+	}
+	return marked;
+}
+
+/* Damage of a frame of a typical UI on an 800x480 screen; rectangles */
+static uint32_t Bench_DamagePattern(uint32_t pattern, uint32_t frame, uint32_t *seed, Damage_RectTypeDef *rects)
+{
+	uint32_t count = 0U;
+
+	switch (pattern)
+	{
+	case 0U:
+		/* Text cursor blinking along a line, clock ticking */
+		rects[count++] = (Damage_RectTypeDef){ 20U + ((frame * 7U) % 760U), 100U + (((frame / 100U) % 10U) * 24U), 2U,
+			20U };
+		rects[count++] = (Damage_RectTypeDef){ 700U, 4U, 96U, 24U };
+		break;
+	case 1U:
+		/* Icon dragged: where it was, where it is */
+		for (uint32_t f = frame; f <= frame + 1U; f++)
+		{
+			rects[count++] = (Damage_RectTypeDef){ 40U + ((f * 6U) % 680U), 60U + ((f * 4U) % 340U), 64U, 64U };
+		}
+		break;
+	case 2U:
+		/* List scrolled: its rows and its scroll bar */
+		for (uint32_t row = 0; row < 8U; row++)
+		{
+			rects[count++] = (Damage_RectTypeDef){ 0U, 60U + (row * 50U), 392U, 50U };
+		}
+		rects[count++] = (Damage_RectTypeDef){ 392U, 60U, 8U, 400U };
+		break;
+	case 3U:
+		/* Progress bar growing, its percentage, a spinner */
+		rects[count++] = (Damage_RectTypeDef){ 100U + ((frame % 150U) * 2U), 400U, 2U, 20U };
+		rects[count++] = (Damage_RectTypeDef){ 420U, 400U, 40U, 20U };
+		rects[count++] = (Damage_RectTypeDef){ 700U, 380U, 48U, 48U };
+		break;
+	default:
+		/* Widgets anywhere */
+		*seed = *seed * 1664525U + 1013904223U;
+		count = 1U + ((*seed >> 24) % 16U);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			*seed = *seed * 1664525U + 1013904223U;
+			rects[i].x = (*seed >> 8) % 800U;
+			rects[i].y = (*seed >> 20) % 480U;
+			*seed = *seed * 1664525U + 1013904223U;
+			rects[i].width = 8U + ((*seed >> 8) % 128U);
+			rects[i].height = 8U + ((*seed >> 20) % 128U);
+		}
+		break;
+	}
+	return count;
+}
+
+/* Merging, tiles and clipping by hand, then random damage: the list covers
+   all of it, within the screen, on the tiles */
+static void Bench_Damage_Check(void)
+{
+	static uint8_t bitmap[120][200];
+	Damage_TypeDef damage;
+	uint32_t seed = 3U;
+
+	Damage_Init(&damage, 100U, 50U, 16U);
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 3U, 5U, 2U, 2U });
+	Bench_Expect("Damage", (damage.count == 1U) && (damage.rects[0].x == 0U) && (damage.rects[0].y == 0U)
+		&& (damage.rects[0].width == 16U) && (damage.rects[0].height == 16U), "grown to a tile");
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 10U, 10U, 10U, 10U });
+	Bench_Expect("Damage", (damage.count == 1U) && (damage.rects[0].width == 32U) && (damage.rects[0].height == 32U)
+		&& (damage.merges == 1U), "overlap merged");
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 90U, 40U, 20U, 20U });
+	Bench_Expect("Damage", (damage.count == 2U) && (damage.rects[1].x == 80U) && (damage.rects[1].y == 32U)
+		&& (damage.rects[1].width == 20U) && (damage.rects[1].height == 18U), "apart, clipped to the screen");
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 100U, 0U, 5U, 5U });
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 0U, 0U, 0U, 5U });
+	Bench_Expect("Damage", damage.count == 2U, "off screen and empty ignored");
+	Damage_Add(&damage, &(Damage_RectTypeDef){ 0U, 0U, 0xFFFFFFFFU, 0xFFFFFFFFU });
+	Bench_Expect("Damage", (damage.count == 1U) && (Damage_Area(&damage) == 100U * 50U), "all merged");
+
+	Damage_Init(&damage, 1000U, 1000U, 1U);
+	for (uint32_t i = 0; i <= DAMAGE_MAX_RECTS; i++)
+	{
+		Damage_Add(&damage, &(Damage_RectTypeDef){ i * 50U, i * 50U, 1U, 1U });
+	}
+	Bench_Expect("Damage", (damage.count == DAMAGE_MAX_RECTS) && (damage.forced == 1U)
+		&& (Damage_Area(&damage) == ((DAMAGE_MAX_RECTS - 1U) + (51U * 51U))), "full list, closest pair merged");
+
+	for (uint32_t round = 0; round < 2000U; round++)
+	{
+		Damage_RectTypeDef added[40];
+		uint32_t tile = 1U << (round % 5U);
+		uint32_t count;
+
+		seed = seed * 1664525U + 1013904223U;
+		count = 1U + ((seed >> 24) % 40U);
+		Damage_Init(&damage, 200U, 120U, tile);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			seed = seed * 1664525U + 1013904223U;
+			added[i].x = (seed >> 8) % 220U;
+			added[i].y = (seed >> 20) % 130U;
+			seed = seed * 1664525U + 1013904223U;
+			added[i].width = (seed >> 8) % 60U;
+			added[i].height = (seed >> 20) % 40U;
+			Damage_Add(&damage, &added[i]);
+		}
+		memset(bitmap, 0, sizeof(bitmap));
+		Bench_Expect("Damage", damage.count <= DAMAGE_MAX_RECTS, "count");
+		for (uint32_t i = 0; i < damage.count; i++)
+		{
+			const Damage_RectTypeDef *r = &damage.rects[i];
+
+			Bench_Expect("Damage", (r->width != 0U) && (r->height != 0U) && (r->x + r->width <= 200U)
+				&& (r->y + r->height <= 120U) && ((r->x % tile) == 0U) && ((r->y % tile) == 0U)
+				&& ((((r->x + r->width) % tile) == 0U) || (r->x + r->width == 200U))
+				&& ((((r->y + r->height) % tile) == 0U) || (r->y + r->height == 120U)), "rectangle on the tiles");
+			(void)Bench_DamageMark(&bitmap[0][0], 200U, 120U, r);
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Bench_Expect("Damage", (added[i].width == 0U) || (added[i].height == 0U)
+				|| (Bench_DamageMark(&bitmap[0][0], 200U, 120U, &added[i]) == 0U), "damage covered");
+		}
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Rectangles added under typical UI damage; what the merged list redraws
+   against the pixels damaged */
+void Bench_Damage_Patterns(uint32_t iterations)
+{
+	static const char *const names[] = { "cursor+clock", "icon drag", "list scroll", "progress", "random widgets" };
+	static uint8_t bitmap[480][800];
+	Damage_RectTypeDef rects[DAMAGE_MAX_RECTS + 1U];
+	Damage_TypeDef damage;
+	uint32_t seed = 5U;
+	uint32_t added = 0U;
+
+	Bench_Damage_Check();
+
+	Damage_Init(&damage, 800U, 480U, LCD_COMP_TILE);
+	for (uint32_t frame = 0; added < iterations; frame++)
+	{
+		uint32_t count = Bench_DamagePattern(frame % 5U, frame / 5U, &seed, rects);
+
+		Damage_Clear(&damage);
+		for (uint32_t i = 0; (i < count) && (added < iterations); i++, added++)
+		{
+			Damage_Add(&damage, &rects[i]);
+		}
+	}
+
+	for (uint32_t pattern = 0; pattern < 5U; pattern++)
+	{
+		uint64_t exact = 0U;
+		uint64_t redrawn = 0U;
+		uint32_t listed = 0U;
+
+		for (uint32_t frame = 0; frame < 64U; frame++)
+		{
+			uint32_t count = Bench_DamagePattern(pattern, frame, &seed, rects);
+
+			Damage_Clear(&damage);
+			memset(bitmap, 0, sizeof(bitmap));
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Damage_Add(&damage, &rects[i]);
+				exact += Bench_DamageMark(&bitmap[0][0], 800U, 480U, &rects[i]);
+			}
+			redrawn += Damage_Area(&damage);
+			listed += damage.count;
+		}
+		printf("  %-14s %5.1f rects, %5.1f%% of the screen redrawn, %.2fx the pixels damaged\n", names[pattern],
+			(double)listed / 64.0, (double)redrawn * 100.0 / (64.0 * 800.0 * 480.0), (double)redrawn / (double)exact);
+	}
+}
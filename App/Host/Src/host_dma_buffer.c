@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    host_dma_buffer.c
+  * @brief   Host checks and benchmarks of dma_buffer.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dma_buffer.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_DMA_SLOTS         16U
+
+/* Exported functions --------------------------------------------------------*/
+/* 16 slots reallocated at random sizes up to 1536 bytes */
+void Bench_DmaBuffer_AllocFree(uint32_t iterations)
+{
+	static DmaBuffer_PoolTypeDef pool;
+	static uint8_t memory[DMA_BUFFER_POOL_MAX_LINES * DMA_BUFFER_LINE] __attribute__((aligned(DMA_BUFFER_LINE)));
+	uint8_t *slot[BENCH_DMA_SLOTS] = { NULL };
+	uint32_t seed = 11;
+
+	DmaBuffer_PoolInit(&pool, memory, sizeof(memory), DMA_BUFFER_WRITE_BACK);
+
+	/* iterations counts alloc/free pairs on a fragmenting mix of sizes */
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		uint32_t index = (seed >> 24) % BENCH_DMA_SLOTS;
+
+		DmaBuffer_PoolFree(&pool, slot[index]);
+		slot[index] = DmaBuffer_PoolAlloc(&pool, 1U + ((seed >> 8) % 1536U));
+		Bench_Expect("DmaBuffer", (slot[index] == NULL) || (((uintptr_t)slot[index] & (DMA_BUFFER_LINE - 1U)) == 0U),
+			"buffer line aligned");
+	}
+
+	for (uint32_t i = 0; i < BENCH_DMA_SLOTS; i++)
+	{
+		DmaBuffer_PoolFree(&pool, slot[i]);
+	}
+	Bench_Expect("DmaBuffer", (pool.freeLines == pool.lines) && (DmaBuffer_PoolAlloc(&pool, sizeof(memory)) == memory),
+		"pool whole again");
+}
@@ -0,0 +1,190 @@
+/**
+  ******************************************************************************
+  * @file    host_eth.c
+  * @brief   Simulated Ethernet shared by the host checks: the HAL ETH driver,
+  *          alone or under eth_if.c, on the DMA model of eth_dma_host.c, the
+  *          frames sent captured. The interface hands what it receives to
+  *          the PTP or network stack under test, else holds or frees it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "dma_buffer.h"
+#include "eth_dma_host.h"
+#include "eth_if.h"
+#include "eth_pbuf.h"
+#include "host_test.h"
+#include "kernel.h"
+#include "net.h"
+#include "ptp.h"
+
+/* Exported variables --------------------------------------------------------*/
+ETH_HandleTypeDef benchEth;
+ETH_DMADescTypeDef benchEthRxDesc[ETH_RX_DESC_CNT];
+ETH_DMADescTypeDef benchEthTxDesc[ETH_TX_DESC_CNT];
+uint8_t benchEthMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+uint8_t benchEthCapture[BENCH_ETH_CAPTURE][ETH_PBUF_SIZE];
+uint32_t benchEthCaptureLength[BENCH_ETH_CAPTURE];
+uint32_t benchEthCaptured;
+uint32_t benchEthIfScheduled;
+Kernel_TaskTypeDef *benchEthIfTask;
+uint32_t benchEthIfFlood;
+uint32_t benchEthIfHold;
+EthPbuf_TypeDef *benchEthIfHeld[ETH_PBUF_COUNT];
+uint32_t benchEthIfHeldCount;
+uint32_t benchPtpActive;
+uint32_t benchNetActive;
+const uint8_t benchNetPeerMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_EthIfSchedule(void)
+{
+	benchEthIfScheduled++;
+	if (benchEthIfTask != NULL)
+	{
+		Kernel_Notify(benchEthIfTask);
+	}
+}
+
+static void Bench_EthIfReceive(EthPbuf_TypeDef *frame)
+{
+	if (benchEthIfFlood != 0U)
+	{
+		/* Line rate: the next frame is already in when one is handled */
+		benchEthIfFlood--;
+		(void)HostEthDma_Receive(frame->payload, frame->length);
+	}
+	if ((benchPtpActive != 0U) && (frame->payload[12] == 0x88U) && (frame->payload[13] == 0xF7U))
+	{
+		Ptp_Receive(frame);
+	}
+	else if (benchNetActive != 0U)
+	{
+		Net_Receive(frame);
+	}
+	else if (benchEthIfHold != 0U)
+	{
+		benchEthIfHeld[benchEthIfHeldCount++] = frame;
+	}
+	else
+	{
+		EthPbuf_Free(frame);
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_EthSink(const uint8_t *frame, uint32_t length)
+{
+	uint32_t slot = benchEthCaptured % BENCH_ETH_CAPTURE;
+
+	memcpy(benchEthCapture[slot], frame, length);
+	benchEthCaptureLength[slot] = length;
+	benchEthCaptured++;
+}
+
+/* The real HAL ETH driver on the DMA model of eth_dma_host.c */
+void Bench_EthStart(void)
+{
+	HostEthDma_Reset();
+	HostEthDma_SetSink(Bench_EthSink);
+	benchEthCaptured = 0;
+	EthPbuf_Init();
+
+	memset(&benchEth, 0, sizeof(benchEth));
+	benchEth.Instance = ETH;
+	benchEth.Init.MACAddr = benchEthMac;
+	benchEth.Init.MediaInterface = HAL_ETH_RMII_MODE;
+	benchEth.Init.RxDesc = benchEthRxDesc;
+	benchEth.Init.TxDesc = benchEthTxDesc;
+	benchEth.Init.RxBuffLen = ETH_PBUF_SIZE;
+	Bench_Expect("EthPbuf", HAL_ETH_Init(&benchEth) == HAL_OK, "ETH init");
+	Bench_Expect("EthPbuf", EthPbuf_Attach(&benchEth) == HAL_OK, "pool attached to the RX descriptors");
+	Bench_Expect("EthPbuf", HAL_ETH_Start_IT(&benchEth) == HAL_OK, "ETH start");
+}
+
+uint32_t Bench_EthFrame(uint8_t *frame, uint32_t length, uint32_t seed)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		frame[i] = (uint8_t)(seed >> 24);
+	}
+	return length;
+}
+
+/* The interface as main.c starts it, on the DMA model */
+void Bench_EthIfStart(void)
+{
+	HostEthDma_Reset();
+	HostEthDma_SetSink(Bench_EthSink);
+	benchEthCaptured = 0;
+	benchEthIfScheduled = 0;
+	benchEthIfTask = NULL;
+	benchEthIfFlood = 0;
+	benchEthIfHold = 0;
+	benchEthIfHeldCount = 0;
+	DmaBuffer_Init();
+	EthPbuf_Init();
+	Bench_Expect("EthIf", EthIf_Init(benchEthMac, Bench_EthIfReceive, Bench_EthIfSchedule) == HAL_OK, "start");
+}
+
+void Bench_EthIfReleaseHeld(void)
+{
+	while (benchEthIfHeldCount != 0U)
+	{
+		EthPbuf_Free(benchEthIfHeld[--benchEthIfHeldCount]);
+	}
+	benchEthIfHold = 0;
+}
+
+/* IPv4 192.168.1.2 -> 192.168.1.1 to the bench MAC, checksums left zero */
+uint32_t Bench_EthIpFrame(uint8_t *frame, uint8_t protocol, uint32_t payload)
+{
+	uint32_t header = (protocol == 6U) ? 20U : 8U;
+	uint32_t total = 20U + header + payload;
+	uint8_t *ip = &frame[14];
+	uint8_t *l4 = &ip[20];
+
+	memset(frame, 0, 14U + total);
+	memcpy(frame, benchEthMac, sizeof(benchEthMac));
+	memcpy(&frame[6], benchEthMac, sizeof(benchEthMac));
+	frame[11] = 0x02U;
+	frame[12] = 0x08U;
+	ip[0] = 0x45U;
+	ip[2] = (uint8_t)(total >> 8);
+	ip[3] = (uint8_t)total;
+	ip[8] = 64U;
+	ip[9] = protocol;
+	ip[12] = 192U; ip[13] = 168U; ip[14] = 1U; ip[15] = 2U;
+	ip[16] = 192U; ip[17] = 168U; ip[18] = 1U; ip[19] = 1U;
+	switch (protocol)
+	{
+	case 1U:                            /* echo request */
+		l4[0] = 8U;
+		break;
+	case 6U:
+		l4[1] = 80U; l4[3] = 80U; l4[12] = 0x50U; l4[13] = 0x18U;
+		break;
+	default:
+		l4[1] = 7U; l4[3] = 7U;
+		l4[4] = (uint8_t)((header + payload) >> 8);
+		l4[5] = (uint8_t)(header + payload);
+		break;
+	}
+	Bench_EthFrame(&l4[header], payload, protocol);
+	return 14U + total;
+}
+
+/* RFC 1071 check, independent of the MAC model: 0 if the sum is all ones */
+uint16_t Bench_InetCheck(const uint8_t *data, uint32_t length, uint32_t sum)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		sum += ((i & 1U) == 0U) ? ((uint32_t)data[i] << 8) : data[i];
+	}
+	sum = (sum & 0xFFFFU) + (sum >> 16);
+	sum = (sum & 0xFFFFU) + (sum >> 16);
+	return (uint16_t)~sum;
+}
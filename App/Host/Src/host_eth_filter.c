@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    host_eth_filter.c
+  * @brief   Host checks and benchmarks of eth_filter.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "eth_dma_host.h"
+#include "eth_filter.h"
+#include "eth_if.h"
+#include "eth_pbuf.h"
+#include "host_test.h"
+
+/* Private functions ---------------------------------------------------------*/
+/* IEEE 802.3 CRC-32 bit by bit, apart from crc_stream.c */
+static uint32_t Bench_Crc32(const uint8_t *data, uint32_t length)
+{
+	uint32_t crc = 0xFFFFFFFFU;
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		crc ^= data[i];
+		for (uint32_t bit = 0; bit < 8U; bit++)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+		}
+	}
+	return ~crc;
+}
+
+/* A 64-byte frame to an address: 1 if the MAC model let it in */
+static uint32_t Bench_FilterPass(const uint8_t *destination, uint16_t type, uint16_t tag)
+{
+	static uint8_t frame[64];
+	uint32_t passed;
+
+	Bench_EthFrame(frame, sizeof(frame), type);
+	memcpy(frame, destination, 6U);
+	memcpy(&frame[6], benchNetPeerMac, 6U);
+	frame[12] = (uint8_t)(type >> 8);
+	frame[13] = (uint8_t)type;
+	frame[14] = (uint8_t)(tag >> 8);
+	frame[15] = (uint8_t)tag;
+	passed = HostEthDma_Receive(frame, sizeof(frame));
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+	EthIf_Poll(ETH_IF_POLL_BUDGET);
+	return passed;
+}
+
+static void Bench_EthFilter_Check(void)
+{
+	/* Bins from an outside CRC-32 (Python binascii) */
+	static const struct
+	{
+		uint8_t address[6];
+		uint8_t bin;
+	} vectors[] =
+	{
+		{ { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x01 }, 32U },
+		{ { 0x01, 0x1B, 0x19, 0x00, 0x00, 0x00 }, 0U },
+		{ { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E }, 30U },
+		{ { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 }, 1U },
+		{ { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 }, 31U },
+		{ { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, 0U },
+	};
+	static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	uint8_t unicast[12][6];
+	uint8_t multicast[6][6];
+	uint8_t address[6];
+	EthFilter_StatsTypeDef stats;
+
+	for (uint32_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+	{
+		Bench_Expect("EthFilter", EthFilter_Hash(vectors[i].address) == vectors[i].bin, "hash vector");
+	}
+	for (uint32_t i = 0; i < 1000U; i++)
+	{
+		Bench_EthFrame(address, sizeof(address), i);
+		Bench_Expect("EthFilter", EthFilter_Hash(address) == (__RBIT(Bench_Crc32(address, 6U)) >> 26), "hash against bitwise CRC");
+	}
+
+	/* 02:00:00:00:00:xx bins 31 8 18 35 57 46 52 22 12 27 1, 01:00:5e:00:00:xx bins 32 55 45 28 6 */
+	for (uint32_t i = 0; i < 12U; i++)
+	{
+		memcpy(unicast[i], benchEthMac, 6U);
+		unicast[i][5] = (uint8_t)(i + 1U);
+	}
+	for (uint32_t i = 0; i < 6U; i++)
+	{
+		memcpy(multicast[i], vectors[0].address, 6U);
+		multicast[i][5] = (uint8_t)(i + 1U);
+	}
+
+	Bench_EthIfStart();
+	HostEthDma_SetAddressFilter(1U);
+	Bench_Expect("EthFilter", ((ETH->MACFFR & (ETH_MACFFR_PM | ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_PAM | ETH_MACFFR_BFD)) == 0U)
+		&& ((ETH->MACA1HR & ETH_MACA1HR_AE) == 0U), "filter empty");
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x88B5U, 0U) && Bench_FilterPass(broadcast, 0x88B5U, 0U)
+		&& !Bench_FilterPass(unicast[6], 0x88B5U, 0U) && !Bench_FilterPass(multicast[0], 0x88B5U, 0U),
+		"station and broadcast only");
+
+	/* Perfect slots, unicast first */
+	Bench_Expect("EthFilter", (EthFilter_Subscribe(multicast[0]) == HAL_OK) && (EthFilter_Subscribe(unicast[6]) == HAL_OK)
+		&& (EthFilter_Subscribe(multicast[1]) == HAL_OK), "subscribe");
+	Bench_Expect("EthFilter", (ETH->MACA1HR == (ETH_MACA1HR_AE | 0x0700U)) && (ETH->MACA1LR == 0x00000002U)
+		&& (ETH->MACA2HR == (ETH_MACA1HR_AE | 0x0100U)) && (ETH->MACA2LR == 0x005E0001U)
+		&& ((ETH->MACFFR & (ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_HPF)) == 0U), "perfect slots");
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[6], 0x88B5U, 0U) && Bench_FilterPass(multicast[0], 0x88B5U, 0U)
+		&& Bench_FilterPass(multicast[1], 0x88B5U, 0U) && !Bench_FilterPass(multicast[2], 0x88B5U, 0U), "perfect match");
+
+	/* Multicast overflow: hashed, unicast still perfect */
+	Bench_Expect("EthFilter", (EthFilter_Subscribe(multicast[2]) == HAL_OK) && (EthFilter_Subscribe(multicast[3]) == HAL_OK),
+		"subscribe hashed");
+	EthFilter_GetStats(&stats);
+	Bench_Expect("EthFilter", ((ETH->MACFFR & (ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_HPF)) == (ETH_MACFFR_HM | ETH_MACFFR_HPF))
+		&& (ETH->MACHTHR == (1UL << (45U - 32U))) && (ETH->MACHTLR == (1UL << 28U))
+		&& (stats.perfect == 3U) && (stats.hashed == 2U) && (stats.hashTable[0] == ETH->MACHTHR), "hash multicast");
+	Bench_Expect("EthFilter", Bench_FilterPass(multicast[2], 0x88B5U, 0U) && Bench_FilterPass(multicast[3], 0x88B5U, 0U)
+		&& Bench_FilterPass(multicast[0], 0x88B5U, 0U) && !Bench_FilterPass(multicast[4], 0x88B5U, 0U)
+		&& Bench_FilterPass(unicast[0], 0x88B5U, 0U) && !Bench_FilterPass(unicast[10], 0x88B5U, 0U), "hash match");
+
+	/* A freed slot goes to the next address, reference counts */
+	Bench_Expect("EthFilter", EthFilter_Unsubscribe(multicast[0]) == HAL_OK, "unsubscribe");
+	Bench_Expect("EthFilter", !Bench_FilterPass(multicast[0], 0x88B5U, 0U) && Bench_FilterPass(multicast[2], 0x88B5U, 0U)
+		&& (ETH->MACHTHR == 0U) && (ETH->MACHTLR == (1UL << 28U)), "slot reassigned");
+	Bench_Expect("EthFilter", (EthFilter_Subscribe(multicast[1]) == HAL_OK) && (EthFilter_Unsubscribe(multicast[1]) == HAL_OK)
+		&& Bench_FilterPass(multicast[1], 0x88B5U, 0U), "still subscribed once");
+	Bench_Expect("EthFilter", (EthFilter_Unsubscribe(multicast[1]) == HAL_OK) && !Bench_FilterPass(multicast[1], 0x88B5U, 0U)
+		&& (EthFilter_Unsubscribe(multicast[1]) == HAL_ERROR), "last subscription dropped");
+
+	/* Unicast overflow: hash unicast, the station address still perfect */
+	for (uint32_t i = 7U; i < 10U; i++)
+	{
+		Bench_Expect("EthFilter", EthFilter_Subscribe(unicast[i]) == HAL_OK, "subscribe unicast");
+	}
+	Bench_Expect("EthFilter", ((ETH->MACFFR & (ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_HPF))
+		== (ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_HPF)), "hash unicast");
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x88B5U, 0U) && Bench_FilterPass(unicast[9], 0x88B5U, 0U)
+		&& Bench_FilterPass(multicast[2], 0x88B5U, 0U) && !Bench_FilterPass(unicast[10], 0x88B5U, 0U), "unicast hashed");
+
+	/* Broadcast, promiscuous, a full table */
+	EthFilter_SetBroadcast(0U);
+	Bench_Expect("EthFilter", !Bench_FilterPass(broadcast, 0x88B5U, 0U), "broadcast dropped");
+	EthFilter_SetBroadcast(1U);
+	EthFilter_SetPromiscuous(1U);
+	Bench_Expect("EthFilter", Bench_FilterPass(broadcast, 0x88B5U, 0U) && Bench_FilterPass(unicast[10], 0x88B5U, 0U)
+		&& Bench_FilterPass(multicast[4], 0x88B5U, 0U), "promiscuous");
+	EthFilter_SetPromiscuous(0U);
+	for (uint32_t i = 6U; i < ETH_FILTER_MAX_ADDRESSES; i++)
+	{
+		address[0] = 0x01U; address[1] = 0x00U; address[2] = 0x5EU; address[3] = 0x7FU; address[4] = 0x00U;
+		address[5] = (uint8_t)i;
+		Bench_Expect("EthFilter", EthFilter_Subscribe(address) == HAL_OK, "fill");
+	}
+	Bench_Expect("EthFilter", EthFilter_Subscribe(multicast[5]) == HAL_ERROR, "table full");
+	EthFilter_GetStats(&stats);
+	Bench_Expect("EthFilter", (stats.addresses == ETH_FILTER_MAX_ADDRESSES) && (stats.perfect == 3U), "full stats");
+
+	/* VLAN: the MAC marks, EthIf drops other IDs */
+	EthFilter_SetVlan(100U);
+	Bench_Expect("EthFilter", ETH->MACVLANTR == (ETH_MACVLANTR_VLANTC | 100U), "VLAN tag register");
+	benchEthIfHold = 1U;
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x8100U, 200U) && (benchEthIfHeldCount == 0U), "other VLAN dropped");
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x8100U, 0xE000U | 100U) && (benchEthIfHeldCount == 1U), "our VLAN");
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x88B5U, 0U) && (benchEthIfHeldCount == 2U), "untagged");
+	Bench_EthIfReleaseHeld();
+	EthFilter_SetVlan(0U);
+	Bench_Expect("EthFilter", Bench_FilterPass(unicast[0], 0x8100U, 200U) && (ETH->MACVLANTR == 0U), "any VLAN");
+	EthFilter_GetStats(&stats);
+	Bench_Expect("EthFilter", stats.vlanDropped == 1U, "VLAN stats");
+
+	HostEthDma_SetAddressFilter(0U);
+	Bench_Expect("EthFilter", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "filter pbufs released");
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_EthFilter_Hash(uint32_t iterations)
+{
+	uint8_t address[6] = { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x00 };
+	uint32_t bins = 0;
+
+	Bench_EthFilter_Check();
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		address[4] = (uint8_t)(i >> 8);
+		address[5] = (uint8_t)i;
+		bins += EthFilter_Hash(address);
+	}
+	__asm__ volatile ("" : : "r" (bins));
+}
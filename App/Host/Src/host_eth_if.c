@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+  * @file    host_eth_if.c
+  * @brief   Host checks and benchmarks of eth_if.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "eth_dma_host.h"
+#include "eth_if.h"
+#include "eth_pbuf.h"
+#include "host_test.h"
+#include "kernel.h"
+#include "kernel_port.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_ETH_FLOOD_BURST   12U     /* frames arriving between two runs of the poll task */
+#define BENCH_ETH_UDP_PAYLOAD   22U     /* 64-byte frame with the FCS */
+#define BENCH_ETH_FLOOD_FRAMES  1024U   /* line rate frames of the kernel check */
+#define BENCH_ETH_TASK_STACK    16384U  /* words, glibc stdio needs a deep stack */
+
+/* Private variables ---------------------------------------------------------*/
+static Kernel_TaskTypeDef benchEthIfPollTask;
+static Kernel_TaskTypeDef benchEthIfAppTask;
+static uint32_t benchEthIfStack[2][BENCH_ETH_TASK_STACK] __attribute__((aligned(8)));
+static uint32_t benchEthIfAppRuns;      /* of the lower priority task, during the flood */
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_EthIf_Check(void)
+{
+	static uint8_t frame[64];
+	EthIf_StatsTypeDef stats;
+	EthPbuf_TypeDef *pbuf;
+
+	Bench_EthIfStart();
+	Bench_EthFrame(frame, sizeof(frame), 3U);
+
+	/* Low load: one interrupt and one poll per frame */
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+		Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 1U, "RX interrupt");
+		Bench_Expect("EthIf", benchEthIfScheduled == i + 1U, "poll scheduled");
+		Bench_Expect("EthIf", EthIf_Poll(ETH_IF_POLL_BUDGET) == ETH_IF_POLL_DONE, "poll done");
+	}
+	Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 0U, "nothing pending");
+
+	/* Burst: the first frame masks, the next nine raise no interrupt */
+	for (uint32_t i = 0; i < 10U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+		Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == (i == 0U), "masked while polling");
+	}
+	Bench_Expect("EthIf", EthIf_Poll(4U) == ETH_IF_POLL_AGAIN, "budget 1");
+	Bench_Expect("EthIf", EthIf_Poll(4U) == ETH_IF_POLL_AGAIN, "budget 2");
+	Bench_Expect("EthIf", EthIf_Poll(4U) == ETH_IF_POLL_DONE, "burst drained");
+	Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 0U, "status of the masked frames cleared");
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == 14U) && (stats.irqs == 5U) && (stats.rxBurstMax == 10U)
+		&& (stats.budgetExhausted == 2U) && (benchEthIfScheduled == 5U), "burst stats");
+
+	/* Flood past the ring: the DMA drops the excess, the poll counts it */
+	for (uint32_t i = 0; i < ETH_RX_DESC_CNT + 8U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+		HostEthDma_Interrupt(EthIf_IRQHandler);
+	}
+	while (EthIf_Poll(ETH_IF_POLL_BUDGET) != ETH_IF_POLL_DONE)
+	{
+	}
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == 14U + ETH_RX_DESC_CNT) && (stats.rxMissed == 8U)
+		&& (stats.irqs == 6U) && (stats.rxBufferUnavailable == 0U), "flood drops");
+	Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 0U, "RBUS of the masked flood cleared");
+	Bench_Expect("EthIf", HostEthDma_RxFree() == ETH_RX_DESC_CNT, "ring refilled after flood");
+
+	/* Starved pool: interrupts stay masked until the ring is whole again */
+	benchEthIfHold = 1U;
+	while ((pbuf = EthPbuf_Alloc()) != NULL)
+	{
+		benchEthIfHeld[benchEthIfHeldCount++] = pbuf;
+	}
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+		HostEthDma_Interrupt(EthIf_IRQHandler);
+	}
+	Bench_Expect("EthIf", EthIf_Poll(ETH_IF_POLL_BUDGET) == ETH_IF_POLL_STARVED, "poll starved");
+	HostEthDma_Receive(frame, sizeof(frame));
+	Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 0U, "masked while starved");
+	Bench_EthIfReleaseHeld();
+	Bench_Expect("EthIf", EthIf_Poll(ETH_IF_POLL_BUDGET) == ETH_IF_POLL_DONE, "recovered from starvation");
+	Bench_Expect("EthIf", HostEthDma_RxFree() == ETH_RX_DESC_CNT, "ring rebuilt");
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == 19U + ETH_RX_DESC_CNT) && (stats.starved == 1U), "starvation stats");
+
+	/* TX completion interrupt: the poll reclaims the sent frames */
+	for (uint32_t i = 0; i < 3U; i++)
+	{
+		pbuf = EthPbuf_Alloc();
+		pbuf->length = pbuf->totalLength = (uint16_t)Bench_EthFrame(pbuf->payload, 60U, i);
+		Bench_Expect("EthIf", EthIf_Transmit(pbuf) == HAL_OK, "EthIf transmit");
+	}
+	Bench_Expect("EthIf", HostEthDma_Transmit() == 3U, "EthIf frames on the wire");
+	Bench_Expect("EthIf", HostEthDma_Interrupt(EthIf_IRQHandler) == 1U, "TX interrupt");
+	Bench_Expect("EthIf", EthIf_Poll(ETH_IF_POLL_BUDGET) == ETH_IF_POLL_DONE, "TX poll");
+	Bench_Expect("EthIf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "TX frames reclaimed");
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.txFrames == 3U) && (benchEthCaptured == 3U), "TX stats");
+
+	/* A flood the polls never drain: each one reads the counter, so a wrap
+	   between two polls is counted through the overflow bit */
+	for (uint32_t i = 0; i < ETH_RX_DESC_CNT + ETH_DMAMFBOCR_MFC + 4U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+	}
+	Bench_Expect("EthIf", ETH->DMAMFBOCR == (ETH_DMAMFBOCR_OMFC | 3U), "missed frame counter wrapped");
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+	Bench_Expect("EthIf", EthIf_Poll(1U) == ETH_IF_POLL_AGAIN, "flood poll 1");
+	for (uint32_t i = 0; i < 1U + ETH_DMAMFBOCR_MFC + 4U; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+	}
+	Bench_Expect("EthIf", EthIf_Poll(1U) == ETH_IF_POLL_AGAIN, "flood poll 2");
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", stats.rxMissed == 8U + (2U * (ETH_DMAMFBOCR_MFC + 4U)), "missed frames of every poll");
+	while (EthIf_Poll(ETH_IF_POLL_BUDGET) != ETH_IF_POLL_DONE)
+	{
+	}
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == 20U + (2U * ETH_RX_DESC_CNT))
+		&& (stats.rxMissed == 8U + (2U * (ETH_DMAMFBOCR_MFC + 4U))), "flood drained");
+}
+
+/* The ETH task of main.c */
+static void Bench_EthIfPollTask(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		Kernel_NotifyWait(KERNEL_WAIT_FOREVER);
+		EthIf_Drain(ETH_IF_POLL_BUDGET);
+	}
+}
+
+/* An application task below it, starting the flood */
+static void Bench_EthIfAppTask(void *arg)
+{
+	static uint8_t frame[64];
+
+	(void)arg;
+
+	Bench_EthFrame(frame, sizeof(frame), 5U);
+	benchEthIfFlood = BENCH_ETH_FLOOD_FRAMES;
+	for (uint32_t i = 0; i < ETH_RX_DESC_CNT; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+	}
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+
+	for (;;)
+	{
+		if ((benchEthIfFlood == 0U) && (HostEthDma_RxFree() == ETH_RX_DESC_CNT))
+		{
+			KernelPort_HostStop();
+		}
+		if (benchEthIfFlood != 0U)
+		{
+			benchEthIfAppRuns++;
+		}
+		Kernel_Delay(1U);
+	}
+}
+
+/* Sustained flood: the polls leave the CPU to the tasks below between budgets */
+static void Bench_EthIf_FloodCheck(void)
+{
+	EthIf_StatsTypeDef stats;
+
+	Bench_EthIfStart();
+	benchEthIfAppRuns = 0;
+	Kernel_Init();
+	Kernel_TaskCreate(&benchEthIfPollTask, "eth", Bench_EthIfPollTask, NULL, 8U,
+		benchEthIfStack[0], BENCH_ETH_TASK_STACK);
+	Kernel_TaskCreate(&benchEthIfAppTask, "app", Bench_EthIfAppTask, NULL, 1U,
+		benchEthIfStack[1], BENCH_ETH_TASK_STACK);
+	benchEthIfTask = &benchEthIfPollTask;
+	Kernel_Start();
+	benchEthIfTask = NULL;
+
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == ETH_RX_DESC_CNT + BENCH_ETH_FLOOD_FRAMES) && (stats.rxMissed == 0U),
+		"flood received");
+	Bench_Expect("EthIf", benchEthIfAppRuns >= (BENCH_ETH_FLOOD_FRAMES / ETH_IF_POLL_BUDGET) - 1U,
+		"lower priority task runs during a flood");
+}
+
+/* A poll task run once per burst, arrivals as fast as the burst size says */
+static void Bench_EthIfRx(uint32_t iterations, uint32_t burst, const uint8_t *frame, uint32_t length)
+{
+	EthIf_StatsTypeDef stats;
+	uint32_t polling = 0;
+
+	Bench_EthIfStart();
+
+	for (uint32_t done = 0; done < iterations; )
+	{
+		for (uint32_t i = 0; (i < burst) && (done < iterations); i++, done++)
+		{
+			HostEthDma_Receive(frame, length);
+		}
+		HostEthDma_Interrupt(EthIf_IRQHandler);
+		if (benchEthIfScheduled != 0U)
+		{
+			benchEthIfScheduled = 0;
+			polling = 1U;
+		}
+		if (polling != 0U)
+		{
+			polling = (EthIf_Poll(ETH_IF_POLL_BUDGET) != ETH_IF_POLL_DONE);
+		}
+	}
+	while ((polling != 0U) && (EthIf_Poll(ETH_IF_POLL_BUDGET) != ETH_IF_POLL_DONE))
+	{
+	}
+
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames + stats.rxMissed == iterations) && (stats.irqs != 0U),
+		"every frame received or counted missed");
+	printf("  burst %-3lu %6.2f frames/irq  %lu missed\n", (unsigned long)burst,
+		(double)stats.rxFrames / (double)stats.irqs, (unsigned long)stats.rxMissed);
+}
+
+static void Bench_EthIf_ChecksumCheck(void)
+{
+	static const uint8_t protocols[] = { 17U, 6U, 1U };
+	static uint8_t frame[ETH_PBUF_SIZE];
+	EthIf_StatsTypeDef stats;
+	EthPbuf_TypeDef *pbuf;
+	uint32_t length;
+	uint32_t rxBytes = 64U;
+	uint32_t txBytes = 0;
+
+	Bench_EthIfStart();
+	Bench_Expect("EthIf", (ETH->DMAOMR & ETH_DMAOMR_DTCEFD) != 0U, "checksum error frames passed up");
+
+	for (uint32_t i = 0; i < sizeof(protocols); i++)
+	{
+		const uint8_t *sent = benchEthCapture[i];
+		const uint8_t *ip = &sent[14];
+		uint32_t segment;
+
+		/* TX: the MAC fills in both checksums */
+		pbuf = EthPbuf_Alloc();
+		length = Bench_EthIpFrame(pbuf->payload, protocols[i], 100U + i);
+		pbuf->length = pbuf->totalLength = (uint16_t)length;
+		txBytes += length;
+		rxBytes += 3U * length;
+		Bench_Expect("EthIf", EthIf_Transmit(pbuf) == HAL_OK, "offload transmit");
+		Bench_Expect("EthIf", HostEthDma_Transmit() == 1U, "offload frame on the wire");
+		segment = length - 34U;
+		Bench_Expect("EthIf", (Bench_InetCheck(ip, 20U, 0U) == 0U) && ((ip[10] | ip[11]) != 0U), "IP header checksum inserted");
+		Bench_Expect("EthIf", Bench_InetCheck(&ip[20], segment,
+			(protocols[i] == 1U) ? 0U : (0xC0A8U + 0x0102U + 0xC0A8U + 0x0101U + protocols[i] + segment)) == 0U,
+			"payload checksum inserted");
+
+		/* RX: good, then a damaged payload, then a damaged header */
+		memcpy(frame, sent, length);
+		benchEthIfHold = 1U;
+		for (uint32_t damage = 0; damage < 3U; damage++)
+		{
+			if (damage == 1U)
+			{
+				frame[length - 1U] ^= 0x01U;
+			}
+			if (damage == 2U)
+			{
+				frame[length - 1U] ^= 0x01U;
+				frame[14U + 8U] ^= 0x01U;
+			}
+			Bench_Expect("EthIf", HostEthDma_Receive(frame, length) == 1U, "offload receive");
+			HostEthDma_Interrupt(EthIf_IRQHandler);
+			Bench_Expect("EthIf", EthIf_Poll(ETH_IF_POLL_BUDGET) == ETH_IF_POLL_DONE, "offload poll");
+			Bench_Expect("EthIf", benchEthIfHeldCount == 1U, "only the good frame delivered");
+		}
+		Bench_Expect("EthIf", benchEthIfHeld[0]->flags == (ETH_PBUF_FLAG_IP_CSUM_OK | ETH_PBUF_FLAG_L4_CSUM_OK),
+			"checksums checked good");
+		Bench_EthIfReleaseHeld();
+		HostEthDma_Interrupt(EthIf_IRQHandler);
+		EthIf_Poll(ETH_IF_POLL_BUDGET);
+	}
+
+	/* Not IP: nothing checked, nothing to skip */
+	benchEthIfHold = 1U;
+	HostEthDma_Receive(frame, Bench_EthFrame(frame, 64U, 3U));
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+	EthIf_Poll(ETH_IF_POLL_BUDGET);
+	Bench_Expect("EthIf", (benchEthIfHeldCount == 1U) && (benchEthIfHeld[0]->flags == 0U), "non-IP frame");
+	Bench_EthIfReleaseHeld();
+
+	EthIf_GetStats(&stats);
+	Bench_Expect("EthIf", (stats.rxFrames == 10U) && (stats.rxChecksumOk == 3U) && (stats.rxChecksumErrors == 6U)
+		&& (stats.rxErrors == 0U) && (stats.txFrames == 3U) && (stats.txBytes == txBytes)
+		&& (stats.rxBytes == rxBytes), "offload stats");
+	Bench_Expect("EthIf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "offload pbufs released");
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_EthIf_IrqPerFrame(uint32_t iterations)
+{
+	static uint8_t frame[64];
+
+	Bench_EthIf_Check();
+	Bench_EthIfRx(iterations, 1U, frame, Bench_EthFrame(frame, sizeof(frame), 1U));
+}
+
+void Bench_EthIf_Flood(uint32_t iterations)
+{
+	static uint8_t frame[64];
+
+	Bench_EthIf_FloodCheck();
+	Bench_EthIfRx(iterations, BENCH_ETH_FLOOD_BURST, frame, Bench_EthFrame(frame, sizeof(frame), 1U));
+}
+
+void Bench_EthIf_Checksum(uint32_t iterations)
+{
+	static uint8_t frame[ETH_PBUF_SIZE];
+	EthPbuf_TypeDef *pbuf;
+	uint32_t length;
+
+	Bench_EthIf_ChecksumCheck();
+
+	/* A UDP frame as the MAC sends it, checksummed, received back */
+	Bench_EthIfStart();
+	pbuf = EthPbuf_Alloc();
+	length = Bench_EthIpFrame(pbuf->payload, 17U, BENCH_ETH_UDP_PAYLOAD);
+	pbuf->length = pbuf->totalLength = (uint16_t)length;
+	Bench_Expect("EthIf", (EthIf_Transmit(pbuf) == HAL_OK) && (HostEthDma_Transmit() == 1U), "UDP frame sent");
+	memcpy(frame, benchEthCapture[0], length);
+	Bench_EthIfRx(iterations, 1U, frame, length);
+}
@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file    host_eth_pbuf.c
+  * @brief   Host checks and benchmarks of eth_pbuf.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "eth_dma_host.h"
+#include "eth_pbuf.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_ETH_HEADER        42U     /* Ethernet + IPv4 + UDP */
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_EthPbuf_Check(void)
+{
+	static uint8_t frame[ETH_PBUF_SIZE];
+	static const uint16_t lengths[] = { 60, 64, 590, 1514 };
+	ETH_TxPacketConfig txConfig = { 0 };
+	EthPbuf_TypeDef *held[ETH_PBUF_COUNT];
+	EthPbuf_TypeDef *pbuf;
+	uint32_t heldCount = 0;
+	void *app;
+
+	Bench_EthStart();
+	Bench_Expect("EthPbuf", HostEthDma_RxFree() == ETH_RX_DESC_CNT, "RX ring built");
+	Bench_Expect("EthPbuf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "pool after start");
+
+	/* Frames land in pool buffers and come back as pbufs, the ring refills */
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		Bench_EthFrame(frame, lengths[i], (uint32_t)i);
+		Bench_Expect("EthPbuf", HostEthDma_Receive(frame, lengths[i]) == 1U, "frame received");
+		Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) == HAL_OK, "ReadData");
+		pbuf = app;
+		Bench_Expect("EthPbuf", (pbuf->next == NULL) && (pbuf->length == lengths[i])
+			&& (pbuf->totalLength == lengths[i]) && (pbuf->refCount == 1U), "RX pbuf");
+		Bench_Expect("EthPbuf", memcmp(pbuf->payload, frame, lengths[i]) == 0, "RX data");
+		EthPbuf_Free(pbuf);
+		Bench_Expect("EthPbuf", HostEthDma_RxFree() == ETH_RX_DESC_CNT, "RX ring refilled");
+		Bench_Expect("EthPbuf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "RX pbuf returned");
+	}
+	Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) != HAL_OK, "RX ring empty");
+
+	/* A full ring drops at the MAC, the missed frame counter says so */
+	for (uint32_t i = 0; i <= ETH_RX_DESC_CNT; i++)
+	{
+		Bench_EthFrame(frame, 64U, i);
+		Bench_Expect("EthPbuf", HostEthDma_Receive(frame, 64U) == (i < ETH_RX_DESC_CNT), "ring fill");
+	}
+	Bench_Expect("EthPbuf", (ETH->DMAMFBOCR & ETH_DMAMFBOCR_MFC) == 1U, "missed frame counted");
+	for (uint32_t i = 0; i < ETH_RX_DESC_CNT; i++)
+	{
+		Bench_EthFrame(frame, 64U, i);
+		Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) == HAL_OK, "ring drain");
+		Bench_Expect("EthPbuf", memcmp(((EthPbuf_TypeDef *)app)->payload, frame, 64U) == 0, "ring order");
+		EthPbuf_Free(app);
+	}
+
+	/* The counter clears on read */
+	Bench_Expect("EthPbuf", HostEthDma_ReadMissed() == 1U, "missed frame counter read");
+	Bench_Expect("EthPbuf", (HostEthDma_ReadMissed() == 0U) && (ETH->DMAMFBOCR == 0U),
+		"missed frame counter cleared");
+
+	/* Starved pool: descriptors stay unbuilt, rebuilt by the next ReadData */
+	while ((pbuf = EthPbuf_Alloc()) != NULL)
+	{
+		held[heldCount++] = pbuf;
+	}
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		Bench_Expect("EthPbuf", HostEthDma_Receive(frame, 100U) == 1U, "starve receive");
+		Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) == HAL_OK, "starve read");
+		held[heldCount++] = app;
+	}
+	Bench_Expect("EthPbuf", HostEthDma_RxFree() == ETH_RX_DESC_CNT - 4U, "starved ring");
+	Bench_Expect("EthPbuf", EthPbuf_GetMinFree() == 0U, "pool low-water mark");
+	while (heldCount != 0U)
+	{
+		EthPbuf_Free(held[--heldCount]);
+	}
+	Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) != HAL_OK, "no frame after starvation");
+	Bench_Expect("EthPbuf", HostEthDma_RxFree() == ETH_RX_DESC_CNT, "ring rebuilt");
+
+	/* One payload behind four headers: two descriptors and one reference per frame */
+	EthPbuf_TypeDef *payload = EthPbuf_Alloc();
+	payload->length = payload->totalLength = (uint16_t)Bench_EthFrame(payload->payload, 1000U, 77U);
+	txConfig.Attributes = ETH_TX_PACKETS_FEATURES_CRCPAD;
+	txConfig.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		EthPbuf_TypeDef *header = EthPbuf_Alloc();
+
+		header->length = header->totalLength = (uint16_t)Bench_EthFrame(header->payload, BENCH_ETH_HEADER, i);
+		EthPbuf_Ref(payload);
+		EthPbuf_Cat(header, payload);
+		Bench_Expect("EthPbuf", header->totalLength == BENCH_ETH_HEADER + 1000U, "chain length");
+		Bench_Expect("EthPbuf", EthPbuf_Transmit(&benchEth, &txConfig, header) == HAL_OK, "transmit");
+	}
+	EthPbuf_Free(payload);
+	Bench_Expect("EthPbuf", payload->refCount == 4U, "payload shared");
+	Bench_Expect("EthPbuf", HostEthDma_Transmit() == 4U, "frames on the wire");
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		Bench_EthFrame(frame, BENCH_ETH_HEADER, i);
+		Bench_Expect("EthPbuf", (benchEthCaptureLength[i] == BENCH_ETH_HEADER + 1000U)
+			&& (memcmp(benchEthCapture[i], frame, BENCH_ETH_HEADER) == 0)
+			&& (memcmp(benchEthCapture[i] + BENCH_ETH_HEADER, payload->payload, 1000U) == 0), "TX gather");
+	}
+	HAL_ETH_ReleaseTxPacket(&benchEth);
+	Bench_Expect("EthPbuf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "TX pbufs released");
+
+	/* A full TX ring refuses the frame and leaves it to the caller */
+	for (uint32_t i = 0; ; i++)
+	{
+		pbuf = EthPbuf_Alloc();
+		pbuf->length = pbuf->totalLength = 60U;
+		if (EthPbuf_Transmit(&benchEth, &txConfig, pbuf) != HAL_OK)
+		{
+			Bench_Expect("EthPbuf", (i == ETH_TX_DESC_CNT) && (pbuf->refCount == 1U), "TX ring full");
+			EthPbuf_Free(pbuf);
+			break;
+		}
+	}
+	Bench_Expect("EthPbuf", HostEthDma_Transmit() == ETH_TX_DESC_CNT, "TX ring sent");
+	HAL_ETH_ReleaseTxPacket(&benchEth);
+	Bench_Expect("EthPbuf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "TX ring released");
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_EthPbuf_Rx(uint32_t iterations)
+{
+	uint8_t frame[64];
+	void *app;
+
+	Bench_EthPbuf_Check();
+	Bench_EthStart();
+	Bench_EthFrame(frame, sizeof(frame), 1U);
+
+	/* DMA model store, HAL_ETH_ReadData() with descriptor refill, free */
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		HostEthDma_Receive(frame, sizeof(frame));
+		Bench_Expect("EthPbuf", HAL_ETH_ReadData(&benchEth, &app) == HAL_OK, "frame read");
+		EthPbuf_Free(app);
+	}
+}
+
+void Bench_EthPbuf_Tx(uint32_t iterations)
+{
+	ETH_TxPacketConfig txConfig = { 0 };
+	EthPbuf_TypeDef *payload;
+
+	Bench_EthStart();
+	HostEthDma_SetSink(NULL);
+	payload = EthPbuf_Alloc();
+	payload->length = payload->totalLength = 256U;
+	txConfig.Attributes = ETH_TX_PACKETS_FEATURES_CRCPAD;
+	txConfig.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+
+	/* Header pbuf + shared payload, DMA model send, release */
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		EthPbuf_TypeDef *header = EthPbuf_Alloc();
+
+		header->length = header->totalLength = BENCH_ETH_HEADER;
+		EthPbuf_Ref(payload);
+		EthPbuf_Cat(header, payload);
+		Bench_Expect("EthPbuf", EthPbuf_Transmit(&benchEth, &txConfig, header) == HAL_OK, "chain sent");
+		HostEthDma_Transmit();
+		HAL_ETH_ReleaseTxPacket(&benchEth);
+	}
+	EthPbuf_Free(payload);
+	Bench_Expect("EthPbuf", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "every pbuf sent released");
+}
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    host_frame.c
+  * @brief   Host checks and benchmarks of frame.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "frame.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_FRAME_MAX         300U
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t benchFrameBytes;        /* payload bytes decoded, one more per frame */
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_FrameReceived(void *context, const uint8_t *payload, uint32_t length)
+{
+	const uint8_t *expected = context;
+
+	Bench_Expect("Frame", memcmp(payload, expected, length) == 0, "payload decoded");
+	benchFrameBytes += length + 1U;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Random frames encoded and pushed to the decoder in two pieces */
+void Bench_Frame_RoundTrip(uint32_t iterations)
+{
+	static uint8_t payload[BENCH_FRAME_MAX];
+	static uint8_t encoded[FRAME_ENCODED_MAX(BENCH_FRAME_MAX)];
+	static uint8_t decoded[BENCH_FRAME_MAX];
+	Frame_DecoderTypeDef decoder;
+	uint32_t seed = 7;
+	uint32_t frames = 0;
+	uint32_t bytes = 0;
+
+	Frame_DecoderInit(&decoder, decoded, sizeof(decoded));
+	benchFrameBytes = 0;
+
+	/* iterations counts payload bytes, with zeros and 254-byte runs mixed in */
+	while (bytes < iterations)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		uint32_t length = (seed >> 8) % BENCH_FRAME_MAX;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			seed = seed * 1664525U + 1013904223U;
+			payload[i] = ((seed >> 28) == 0U) ? 0U : (uint8_t)(seed >> 16);
+		}
+
+		uint32_t size = Frame_Encode(payload, length, encoded, sizeof(encoded));
+		uint32_t split = (size > 1U) ? (seed % size) : 0U;
+		Frame_DecoderPush(&decoder, encoded, split, Bench_FrameReceived, payload);
+		Frame_DecoderPush(&decoder, &encoded[split], size - split, Bench_FrameReceived, payload);
+
+		frames++;
+		bytes += length + 1U;
+	}
+
+	Bench_Expect("Frame", (decoder.frames == frames) && (decoder.errors == 0U) && (benchFrameBytes == bytes),
+		"every frame decoded");
+}
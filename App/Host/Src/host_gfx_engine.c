@@ -0,0 +1,436 @@
+/**
+  ******************************************************************************
+  * @file    host_gfx_engine.c
+  * @brief   Host checks and benchmarks of gfx_engine.c and gfx_soft.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "gfx_engine.h"
+#include "gfx_soft.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_GFX_WIDTH         40U     /* random mix surfaces, even for the 4-bit formats */
+#define BENCH_GFX_HEIGHT        24U
+#define BENCH_GFX_BATCH         8U      /* commands queued at once in the random mix */
+#define BENCH_GFX_ROUNDS        300U
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_GfxMarker(void *arg)
+{
+	(*(uint32_t *)arg)++;
+}
+
+/* Reference pixel access, independent of gfx_soft: little-endian host */
+static uint32_t Bench_GfxGet(const GfxEngine_BufferTypeDef *buffer, uint32_t x, uint32_t y)
+{
+	uint32_t bits = GfxSoft_Bits(buffer->format);
+	uint32_t index = (y * buffer->width) + x;
+	const uint8_t *base = buffer->address;
+	uint32_t pixel = 0U;
+
+	if (bits == 4U)
+	{
+		return (base[index / 2U] >> ((index % 2U) * 4U)) & 0xFU;
+	}
+	memcpy(&pixel, &base[index * (bits / 8U)], bits / 8U);
+	return pixel;
+}
+
+/* Fill, copy, convert and blend of one command, pixel by pixel */
+static void Bench_GfxReference(uint32_t op, const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t color, const uint32_t *clut)
+{
+	for (uint32_t j = 0; j < rect->height; j++)
+	{
+		for (uint32_t i = 0; i < rect->width; i++)
+		{
+			uint32_t fg;
+			uint32_t pixel;
+
+			if (op == 0U)
+			{
+				Bench_GfxSet(dst, rect->x + i, rect->y + j, GfxSoft_FromArgb(color, dst->format));
+				continue;
+			}
+			pixel = Bench_GfxGet(src, rect->x + i, rect->y + j);
+			if (op == 1U)
+			{
+				Bench_GfxSet(dst, x + i, y + j, pixel);
+				continue;
+			}
+			fg = GfxSoft_ToArgb(pixel, src->format, clut, color);
+			if ((color >> 24) != 0xFFU)
+			{
+				fg = ((((fg >> 24) * (color >> 24)) / 255U) << 24) | (fg & 0x00FFFFFFU);
+			}
+			if (op == 3U)
+			{
+				fg = GfxSoft_Blend(fg, GfxSoft_ToArgb(Bench_GfxGet(dst, x + i, y + j), dst->format, NULL, 0U));
+			}
+			Bench_GfxSet(dst, x + i, y + j, GfxSoft_FromArgb(fg, dst->format));
+		}
+	}
+}
+
+/* Pixel rules against values worked out by hand */
+static void Bench_GfxSoft_Check(void)
+{
+	uint32_t clut[256];
+
+	Bench_Expect("GfxSoft", (GfxSoft_FromArgb(0x80FF8040U, GFX_ARGB8888) == 0x80FF8040U)
+		&& (GfxSoft_FromArgb(0x80FF8040U, GFX_RGB888) == 0x00FF8040U)
+		&& (GfxSoft_FromArgb(0x80FF8040U, GFX_RGB565) == 0xFC08U)
+		&& (GfxSoft_FromArgb(0x80FF8040U, GFX_ARGB1555) == 0xFE08U)
+		&& (GfxSoft_FromArgb(0x7FFF8040U, GFX_ARGB1555) == 0x7E08U)
+		&& (GfxSoft_FromArgb(0x80FF8040U, GFX_ARGB4444) == 0x8F84U), "output conversion truncates");
+	memset(clut, 0, sizeof(clut));
+	clut[0x0AU] = 0xAB123456U;
+	clut[0xA0U] = 0x01ABCDEFU;
+	Bench_Expect("GfxSoft", (GfxSoft_ToArgb(0xF808U, GFX_RGB565, clut, 0U) == 0xFFFF0042U)
+		&& (GfxSoft_ToArgb(0x07E0U, GFX_RGB565, clut, 0U) == 0xFF00FF00U)
+		&& (GfxSoft_ToArgb(0x7FFFU, GFX_ARGB1555, clut, 0U) == 0x00FFFFFFU)
+		&& (GfxSoft_ToArgb(0x8421U, GFX_ARGB1555, clut, 0U) == 0xFF080808U)
+		&& (GfxSoft_ToArgb(0x8F84U, GFX_ARGB4444, clut, 0U) == 0x88FF8844U)
+		&& (GfxSoft_ToArgb(0x123456U, GFX_RGB888, clut, 0U) == 0xFF123456U)
+		&& (GfxSoft_ToArgb(0x0AU, GFX_L8, clut, 0U) == 0xAB123456U)
+		&& (GfxSoft_ToArgb(0x0AU, GFX_L4, clut, 0U) == 0xAB123456U)
+		&& (GfxSoft_ToArgb(0x3AU, GFX_AL44, clut, 0U) == 0x33123456U)
+		&& (GfxSoft_ToArgb(0x40A0U, GFX_AL88, clut, 0U) == 0x40ABCDEFU)
+		&& (GfxSoft_ToArgb(0x40U, GFX_A8, clut, 0xFF00FF00U) == 0x4000FF00U)
+		&& (GfxSoft_ToArgb(0x1U, GFX_A4, clut, 0x00112233U) == 0x11112233U), "input expansion");
+	Bench_Expect("GfxSoft", (GfxSoft_Blend(0x80FF0000U, 0xFF0000FFU) == 0xFF80007FU)
+		&& (GfxSoft_Blend(0x80FF0000U, 0x800000FFU) == 0xC0AA0055U)
+		&& (GfxSoft_Blend(0x4000FF00U, 0xFF000000U) == 0xFF004000U)
+		&& (GfxSoft_Blend(0xFF123456U, 0x80FFFFFFU) == 0xFF123456U)
+		&& (GfxSoft_Blend(0x00123456U, 0x80654321U) == 0x80654321U)
+		&& (GfxSoft_Blend(0x00FFFFFFU, 0x00FFFFFFU) == 0U), "blend");
+}
+
+/* Golden images, queue limits, markers, errors and a random mix against
+   the reference, the DMA2D model and the software mode */
+static void Bench_GfxEngine_Check(void)
+{
+	static uint16_t rgb565[4][8];
+	static uint8_t rgb888[2][4][3];
+	static uint32_t argb[2][8];
+	static uint8_t l8[2][8];
+	static uint8_t l4[2][4];
+	static uint8_t l4Copy[3][4];
+	static uint8_t clutRgb[4][3] = { { 0x33, 0x22, 0x11 }, { 0x66, 0x55, 0x44 }, { 0x99, 0x88, 0x77 }, { 0, 0, 0 } };
+	static uint8_t a4[4] = { 0x1F, 0x80, 0, 0 };
+	static uint8_t images[3][BENCH_GFX_HEIGHT * BENCH_GFX_WIDTH * 4U];  /* source, destination, reference */
+	static uint8_t software[BENCH_GFX_HEIGHT * BENCH_GFX_WIDTH * 4U];
+	static uint8_t clutSource[256 * 4];
+	uint32_t refClut[256];
+	GfxEngine_BufferTypeDef dst565 = { rgb565, 8, 4, GFX_RGB565 };
+	GfxEngine_BufferTypeDef dst888 = { rgb888, 4, 2, GFX_RGB888 };
+	GfxEngine_BufferTypeDef dst8888 = { argb, 8, 2, GFX_ARGB8888 };
+	GfxEngine_BufferTypeDef srcL8 = { l8, 8, 2, GFX_L8 };
+	GfxEngine_BufferTypeDef srcL4 = { l4, 8, 2, GFX_L4 };
+	GfxEngine_BufferTypeDef dstL4 = { l4Copy, 8, 3, GFX_L4 };
+	GfxEngine_BufferTypeDef srcA4 = { a4, 8, 1, GFX_A4 };
+	GfxEngine_RectTypeDef rect;
+	GfxEngine_StatsTypeDef stats;
+	uint32_t marks = 0U;
+	uint32_t seed = 21U;
+
+	Bench_GfxSoft_Check();
+	Bench_Expect("GfxEngine", (GfxEngine_Init(2U) == HAL_ERROR) && (GfxEngine_Init(GFX_ENGINE_HARDWARE) == HAL_OK)
+		&& GfxEngine_IsIdle(), "init");
+
+	/* Fill: the rectangle only, in the buffer format */
+	rect = (GfxEngine_RectTypeDef){ 2, 1, 4, 2 };
+	Bench_Expect("GfxEngine", GfxEngine_Fill(&dst565, &rect, 0x80FF8040U) == HAL_OK, "fill RGB565");
+	rect = (GfxEngine_RectTypeDef){ 1, 1, 3, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Fill(&dst888, &rect, 0x80FF8040U) == HAL_OK, "fill RGB888");
+	Bench_GfxRun();
+	for (uint32_t y = 0; y < 4U; y++)
+	{
+		for (uint32_t x = 0; x < 8U; x++)
+		{
+			uint32_t inside = (x >= 2U) && (x < 6U) && (y >= 1U) && (y < 3U);
+
+			Bench_Expect("GfxEngine", rgb565[y][x] == (inside ? 0xFC08U : 0U), "RGB565 fill image");
+		}
+	}
+	Bench_Expect("GfxEngine", (rgb888[1][0][0] == 0U) && (rgb888[1][1][0] == 0x40U) && (rgb888[1][1][1] == 0x80U)
+		&& (rgb888[1][1][2] == 0xFFU) && (rgb888[1][3][2] == 0xFFU) && (rgb888[0][1][0] == 0U), "RGB888 fill image");
+
+	/* RGB888 CLUT, L8 converted to ARGB8888 */
+	for (uint32_t i = 0; i < 8U; i++)
+	{
+		l8[1][i] = (uint8_t)(i % 3U);
+	}
+	rect = (GfxEngine_RectTypeDef){ 0, 1, 8, 1 };
+	Bench_Expect("GfxEngine", (GfxEngine_LoadClut(clutRgb, 3, GFX_RGB888) == HAL_OK)
+		&& (GfxEngine_Convert(&dst8888, 0, 0, &srcL8, &rect, 0xFFFFFFFFU) == HAL_OK), "L8 convert");
+	/* A4, low nibble first, in the color given, alpha combined */
+	rect = (GfxEngine_RectTypeDef){ 0, 0, 4, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Convert(&dst8888, 4, 1, &srcA4, &rect, 0x8000FF00U) == HAL_OK, "A4 convert");
+	Bench_GfxRun();
+	Bench_Expect("GfxEngine", (argb[0][0] == 0xFF112233U) && (argb[0][1] == 0xFF445566U) && (argb[0][2] == 0xFF778899U)
+		&& (argb[0][7] == 0xFF445566U), "L8 image");
+	Bench_Expect("GfxEngine", (argb[1][4] == 0x8000FF00U) && (argb[1][5] == 0x0800FF00U) && (argb[1][6] == 0x0000FF00U)
+		&& (argb[1][7] == 0x4400FF00U) && (argb[1][3] == 0U), "A4 image");
+
+	/* Blends over RGB565: ARGB8888 half transparent, opaque combined with
+	   a half alpha, A8 in a color */
+	rgb565[0][0] = 0x001FU;
+	rgb565[0][1] = 0x001FU;
+	argb[0][0] = 0x80FF0000U;
+	argb[0][1] = 0xFFFF0000U;
+	rect = (GfxEngine_RectTypeDef){ 0, 0, 1, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Blend(&dst565, 0, 0, &dst8888, &rect, 0xFF000000U) == HAL_OK, "blend");
+	rect = (GfxEngine_RectTypeDef){ 1, 0, 1, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Blend(&dst565, 1, 0, &dst8888, &rect, 0x80000000U) == HAL_OK, "blend combined");
+	Bench_GfxRun();
+	Bench_Expect("GfxEngine", (rgb565[0][0] == 0x800FU) && (rgb565[0][1] == 0x800FU) && (rgb565[0][2] == 0U), "blend image");
+
+	/* L4 copy: nibbles moved, the ones around left alone */
+	l4[0][1] = 0x21;
+	l4[0][2] = 0x43;
+	l4[1][1] = 0x65;
+	l4[1][2] = 0x87;
+	rect = (GfxEngine_RectTypeDef){ 2, 0, 3, 2 };
+	l4Copy[2][2] = 0xF0;
+	Bench_Expect("GfxEngine", GfxEngine_Copy(&dstL4, 2, 1, &srcL4, &rect) == HAL_OK, "L4 copy");
+	Bench_GfxRun();
+	Bench_Expect("GfxEngine", (l4Copy[1][1] == 0x21U) && (l4Copy[1][2] == 0x03U) && (l4Copy[2][1] == 0x65U)
+		&& (l4Copy[2][2] == 0xF7U) && (l4Copy[0][1] == 0U) && (l4Copy[1][0] == 0U), "L4 image");
+
+	/* Commands refused */
+	rect = (GfxEngine_RectTypeDef){ 1, 0, 2, 1 };
+	Bench_Expect("GfxEngine", (GfxEngine_Copy(&dstL4, 0, 0, &srcL4, &rect) == HAL_ERROR)
+		&& (GfxEngine_Fill(&srcL8, &rect, 0U) == HAL_ERROR)
+		&& (GfxEngine_Convert(&srcL8, 0, 0, &dst8888, &rect, 0U) == HAL_ERROR)
+		&& (GfxEngine_Copy(&dst565, 0, 0, &dst8888, &rect) == HAL_ERROR)
+		&& (GfxEngine_LoadClut(clutRgb, 257, GFX_RGB888) == HAL_ERROR)
+		&& (GfxEngine_LoadClut(clutRgb, 4, GFX_RGB565) == HAL_ERROR), "format or alignment refused");
+	rect = (GfxEngine_RectTypeDef){ 5, 0, 4, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Fill(&dst565, &rect, 0U) == HAL_ERROR, "out of the buffer");
+	rect = (GfxEngine_RectTypeDef){ 0, 0, 0, 1 };
+	Bench_Expect("GfxEngine", GfxEngine_Fill(&dst565, &rect, 0U) == HAL_ERROR, "empty rectangle");
+	rect = (GfxEngine_RectTypeDef){ 0, 0, 2, 2 };
+	Bench_Expect("GfxEngine", GfxEngine_Blend(&dst565, 7, 0, &dst8888, &rect, 0U) == HAL_ERROR, "destination too small");
+
+	/* Queue full while the DMA2D runs the first command; the marker after
+	   the redraw called once it is all done */
+	Bench_Expect("GfxEngine", (GfxEngine_Marker(Bench_GfxMarker, &marks) == HAL_OK) && (marks == 1U), "marker when idle");
+	rect = (GfxEngine_RectTypeDef){ 0, 0, 1, 1 };
+	for (uint32_t i = 0; i < GFX_ENGINE_QUEUE_DEPTH - 1U; i++)
+	{
+		Bench_Expect("GfxEngine", GfxEngine_Fill(&dst565, &rect, i) == HAL_OK, "fill queued");
+	}
+	Bench_Expect("GfxEngine", (GfxEngine_Marker(Bench_GfxMarker, &marks) == HAL_OK)
+		&& (GfxEngine_Marker(Bench_GfxMarker, &marks) == HAL_BUSY) && (marks == 1U) && !GfxEngine_IsIdle(),
+		"queue full");
+	/* The first command ends in a configuration error: counted, the next
+	   one started */
+	DMA2D->CR &= ~DMA2D_CR_START;
+	DMA2D->ISR = DMA2D_ISR_CEIF;
+	GfxEngine_IRQHandler();
+	DMA2D->ISR &= ~DMA2D->IFCR;
+	Bench_Expect("GfxEngine", (DMA2D->CR & DMA2D_CR_START) != 0U, "next command started after an error");
+	Bench_GfxRun();
+	GfxEngine_GetStats(&stats);
+	Bench_Expect("GfxEngine", (marks == 2U) && (rgb565[0][0] == GfxSoft_FromArgb(GFX_ENGINE_QUEUE_DEPTH - 2U, GFX_RGB565))
+		&& (stats.errors == 1U) && (stats.full == 1U) && (stats.maxDepth == GFX_ENGINE_QUEUE_DEPTH)
+		&& (stats.markers == 2U) && (stats.cluts == 1U), "queue counters");
+
+	/* Random mix, batches queued at once, the same one on the DMA2D model
+	   and in software */
+	for (uint32_t engine = 0; engine < 2U; engine++)
+	{
+		uint32_t mixSeed = seed;
+
+		Bench_Expect("GfxEngine", GfxEngine_Init((engine == 0U) ? GFX_ENGINE_HARDWARE : GFX_ENGINE_SOFTWARE) == HAL_OK,
+			"mix init");
+		memset(refClut, 0, sizeof(refClut));
+		for (uint32_t i = 0; i < sizeof(images[1]); i++)
+		{
+			images[1][i] = (uint8_t)(i * 7U);
+		}
+		memcpy(images[2], images[1], sizeof(images[1]));
+		for (uint32_t round = 0; round < BENCH_GFX_ROUNDS; round++)
+		{
+			uint32_t batch;
+			uint32_t entries;
+			uint32_t format;
+
+			/* New source pixels and CLUT while the engine is idle */
+			for (uint32_t i = 0; i < sizeof(images[0]); i++)
+			{
+				mixSeed = mixSeed * 1664525U + 1013904223U;
+				images[0][i] = (uint8_t)(mixSeed >> 24);
+			}
+			memcpy(clutSource, images[0], sizeof(clutSource));
+			mixSeed = mixSeed * 1664525U + 1013904223U;
+			entries = (round == 0U) ? 256U : (1U + (mixSeed >> 8) % 256U);
+			format = (mixSeed >> 4) & 1U;
+			for (uint32_t i = 0; i < entries; i++)
+			{
+				refClut[i] = (format == GFX_RGB888) ? (0xFF000000U | clutSource[i * 3U] | ((uint32_t)clutSource[(i * 3U) + 1U] << 8)
+					| ((uint32_t)clutSource[(i * 3U) + 2U] << 16))
+					: ((uint32_t)clutSource[i * 4U] | ((uint32_t)clutSource[(i * 4U) + 1U] << 8)
+					| ((uint32_t)clutSource[(i * 4U) + 2U] << 16) | ((uint32_t)clutSource[(i * 4U) + 3U] << 24));
+			}
+			Bench_Expect("GfxEngine", GfxEngine_LoadClut(clutSource, entries, format) == HAL_OK, "mix CLUT");
+
+			batch = 1U + (mixSeed >> 16) % BENCH_GFX_BATCH;
+			for (uint32_t k = 0; k < batch; k++)
+			{
+				GfxEngine_BufferTypeDef src = { images[0], BENCH_GFX_WIDTH, BENCH_GFX_HEIGHT, 0 };
+				GfxEngine_BufferTypeDef dst = { images[1], BENCH_GFX_WIDTH, BENCH_GFX_HEIGHT, 0 };
+				GfxEngine_BufferTypeDef ref = { images[2], BENCH_GFX_WIDTH, BENCH_GFX_HEIGHT, 0 };
+				uint32_t op;
+				uint32_t x;
+				uint32_t y;
+				uint32_t color;
+				HAL_StatusTypeDef status;
+
+				mixSeed = mixSeed * 1664525U + 1013904223U;
+				op = (mixSeed >> 28) % 4U;
+				src.format = (mixSeed >> 20) % GFX_FORMATS;
+				dst.format = (op == 1U) ? src.format : ((mixSeed >> 16) % GFX_OUTPUT_FORMATS);
+				ref.format = dst.format;
+				rect.width = 1U + (mixSeed >> 8) % BENCH_GFX_WIDTH;
+				rect.height = 1U + (mixSeed >> 2) % BENCH_GFX_HEIGHT;
+				mixSeed = mixSeed * 1664525U + 1013904223U;
+				rect.x = (mixSeed >> 8) % (BENCH_GFX_WIDTH - rect.width + 1U);
+				rect.y = (mixSeed >> 16) % (BENCH_GFX_HEIGHT - rect.height + 1U);
+				x = (mixSeed >> 20) % (BENCH_GFX_WIDTH - rect.width + 1U);
+				y = (mixSeed >> 4) % (BENCH_GFX_HEIGHT - rect.height + 1U);
+				if ((GfxSoft_Bits(src.format) == 4U) && (op != 0U))
+				{
+					rect.x &= ~1U;
+					x &= ~1U;
+				}
+				mixSeed = mixSeed * 1664525U + 1013904223U;
+				color = ((mixSeed & 3U) == 0U) ? (mixSeed | 0xFF000000U) : mixSeed;
+				switch (op)
+				{
+				case 0U:
+					status = GfxEngine_Fill(&dst, &rect, color);
+					break;
+				case 1U:
+					status = GfxEngine_Copy(&dst, x, y, &src, &rect);
+					break;
+				case 2U:
+					status = GfxEngine_Convert(&dst, x, y, &src, &rect, color);
+					break;
+				default:
+					status = GfxEngine_Blend(&dst, x, y, &src, &rect, color);
+					break;
+				}
+				Bench_Expect("GfxEngine", status == HAL_OK, "mix command");
+				Bench_GfxReference(op, &ref, x, y, &src, &rect, color, refClut);
+			}
+			Bench_Expect("GfxEngine", GfxEngine_Marker(Bench_GfxMarker, &marks) == HAL_OK, "mix marker");
+			Bench_GfxRun();
+			Bench_Expect("GfxEngine", memcmp(images[1], images[2], sizeof(images[1])) == 0, "mix image");
+		}
+		if (engine == 0U)
+		{
+			memcpy(software, images[1], sizeof(software));
+		}
+		else
+		{
+			Bench_Expect("GfxEngine", memcmp(software, images[1], sizeof(software)) == 0, "software image as the DMA2D one");
+		}
+		GfxEngine_GetStats(&stats);
+		Bench_Expect("GfxEngine", (stats.errors == 0U) && (stats.cluts == BENCH_GFX_ROUNDS)
+			&& (stats.markers == BENCH_GFX_ROUNDS) && (stats.commands == stats.transfers + (2U * BENCH_GFX_ROUNDS)),
+			"mix counters");
+	}
+	Bench_Expect("GfxEngine", marks == 2U + (2U * BENCH_GFX_ROUNDS), "markers called");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* DMA2D model: each transfer or CLUT load started runs at once in
+   gfx_soft, its interrupt is taken right after; IFCR writes clear ISR */
+void Bench_GfxRun(void)
+{
+	for (uint32_t i = 0; GfxEngine_IsIdle() == 0U; i++)
+	{
+		Bench_Expect("GfxEngine", i <= GFX_ENGINE_QUEUE_DEPTH, "engine stuck");
+		GfxSoft_Execute(DMA2D);
+		GfxEngine_IRQHandler();
+		DMA2D->ISR &= ~DMA2D->IFCR;
+	}
+}
+
+void Bench_GfxSet(const GfxEngine_BufferTypeDef *buffer, uint32_t x, uint32_t y, uint32_t pixel)
+{
+	uint32_t bits = GfxSoft_Bits(buffer->format);
+	uint32_t index = (y * buffer->width) + x;
+	uint8_t *base = buffer->address;
+
+	if (bits == 4U)
+	{
+		uint32_t shift = (index % 2U) * 4U;
+
+		base[index / 2U] = (uint8_t)((base[index / 2U] & ~(0xFU << shift)) | ((pixel & 0xFU) << shift));
+		return;
+	}
+	memcpy(&base[index * (bits / 8U)], &pixel, bits / 8U);
+}
+
+/* CPU cost of a fill handed to the DMA2D: queued, then its completion
+   interrupt, the DMA2D model not drawing */
+void Bench_GfxEngine_Queue(uint32_t iterations)
+{
+	static uint16_t frame[BENCH_GFX_HEIGHT][BENCH_GFX_WIDTH];
+	GfxEngine_BufferTypeDef dst = { frame, BENCH_GFX_WIDTH, BENCH_GFX_HEIGHT, GFX_RGB565 };
+	GfxEngine_RectTypeDef rect = { 0, 0, 16, 16 };
+
+	Bench_GfxEngine_Check();
+
+	HostSim_Reset();
+	(void)GfxEngine_Init(GFX_ENGINE_HARDWARE);
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		rect.x = i % (BENCH_GFX_WIDTH - 16U);
+		(void)GfxEngine_Fill(&dst, &rect, i);
+		DMA2D->CR &= ~DMA2D_CR_START;
+		DMA2D->ISR = DMA2D_ISR_TCIF;
+		GfxEngine_IRQHandler();
+	}
+	Bench_Expect("GfxEngine", GfxEngine_IsIdle(), "bench idle");
+}
+
+/* Software blends of 16x16 ARGB8888 over RGB565, one iteration a pixel:
+   the CPU time each DMA2D blend saves */
+void Bench_GfxSoft_Blend(uint32_t iterations)
+{
+	static uint32_t sprite[16][16];
+	static uint16_t frame[BENCH_GFX_HEIGHT][BENCH_GFX_WIDTH];
+	GfxEngine_BufferTypeDef src = { sprite, 16, 16, GFX_ARGB8888 };
+	GfxEngine_BufferTypeDef dst = { frame, BENCH_GFX_WIDTH, BENCH_GFX_HEIGHT, GFX_RGB565 };
+	GfxEngine_RectTypeDef rect = { 0, 0, 16, 16 };
+	GfxEngine_StatsTypeDef stats;
+	uint32_t blends = (iterations + 255U) / 256U;
+	uint64_t start;
+	uint64_t elapsed;
+
+	for (uint32_t i = 0; i < 256U; i++)
+	{
+		sprite[i / 16U][i % 16U] = (i << 24) | (i * 0x010203U);
+	}
+	(void)GfxEngine_Init(GFX_ENGINE_SOFTWARE);
+	start = Host_NowNs();
+	for (uint32_t i = 0; i < blends; i++)
+	{
+		(void)GfxEngine_Blend(&dst, i % (BENCH_GFX_WIDTH - 16U), i % (BENCH_GFX_HEIGHT - 16U), &src, &rect,
+			0xFFFFFFFFU);
+	}
+	elapsed = Host_NowNs() - start;
+	GfxEngine_GetStats(&stats);
+	Bench_Expect("GfxEngine", stats.pixels == blends * 256U, "bench pixels");
+	printf("  %lu blends, %.1f Mpixel/s on the CPU\n", (unsigned long)blends,
+		(double)stats.pixels * 1000.0 / (double)(elapsed + 1U));
+}
@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * @file    host_kernel.c
+  * @brief   Host checks and benchmarks of kernel.c, and the idle hook of
+  *          the host kernel.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "kernel.h"
+#include "kernel_port.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_KERNEL_TASKS      8U
+#define BENCH_KERNEL_STACK      16384U  /* words, glibc stdio needs a deep stack */
+
+/* Private variables ---------------------------------------------------------*/
+static Kernel_TaskTypeDef benchTask[BENCH_KERNEL_TASKS];
+static uint32_t benchTaskStack[BENCH_KERNEL_TASKS][BENCH_KERNEL_STACK] __attribute__((aligned(8)));
+static uint32_t benchKernelCount;
+static uint32_t benchKernelLimit;
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_KernelCreate(uint32_t index, Kernel_EntryTypeDef entry, uint32_t priority)
+{
+	Kernel_TaskCreate(&benchTask[index], "bench", entry, &benchTask[index], priority,
+		benchTaskStack[index], BENCH_KERNEL_STACK);
+}
+
+static void Bench_KernelCheckStacks(uint32_t tasks)
+{
+	for (uint32_t i = 0; i < tasks; i++)
+	{
+		uint32_t free = Kernel_GetStackFree(&benchTask[i]);
+
+		Bench_Expect("Kernel", (free != 0U) && (free < BENCH_KERNEL_STACK * sizeof(uint32_t)),
+			"stack watermark in range");
+	}
+}
+
+static void Bench_YieldTask(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		if (++benchKernelCount >= benchKernelLimit)
+		{
+			KernelPort_HostStop();
+		}
+		Kernel_Yield();
+	}
+}
+
+static void Bench_WaiterTask(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		Bench_Expect("Kernel", Kernel_NotifyWait(KERNEL_WAIT_FOREVER) == 1U, "one notification per wake-up");
+		benchKernelCount++;
+	}
+}
+
+static void Bench_NotifierTask(void *arg)
+{
+	(void)arg;
+
+	for (uint32_t i = 0; i < benchKernelLimit; i++)
+	{
+		/* The waiter has the higher priority: it runs before Notify returns */
+		Kernel_Notify(&benchTask[0]);
+		Bench_Expect("Kernel", benchKernelCount == i + 1U, "notify preempts for the waiter");
+	}
+	KernelPort_HostStop();
+}
+
+static void Bench_DelayTask(void *arg)
+{
+	Kernel_TaskTypeDef *task = arg;
+	uint32_t delay = 1U + (uint32_t)(task - benchTask) % 5U;
+
+	for (;;)
+	{
+		uint32_t start = Kernel_GetTick();
+
+		Kernel_Delay(delay);
+		Bench_Expect("Kernel", Kernel_GetTick() - start == delay, "delay wakes on its tick");
+		if (++benchKernelCount >= benchKernelLimit)
+		{
+			KernelPort_HostStop();
+		}
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Idle hook of the host kernel: time only passes when all tasks
+ *         are blocked, one tick per call.
+ */
+void Kernel_IdleHook(uint32_t ticks)
+{
+	Bench_Expect("Kernel", ticks != KERNEL_WAIT_FOREVER, "no deadlock, a task waits with a timeout");
+	KernelPort_HostAdvance((ticks != 0U) ? 1U : 0U);
+}
+
+void Bench_Kernel_Yield(uint32_t iterations)
+{
+	/* iterations counts context switches between two equal priority tasks */
+	benchKernelCount = 0;
+	benchKernelLimit = iterations;
+	Kernel_Init();
+	Bench_KernelCreate(0, Bench_YieldTask, 2U);
+	Bench_KernelCreate(1, Bench_YieldTask, 2U);
+	Kernel_Start();
+
+	Bench_Expect("Kernel", (benchTask[0].switches + benchTask[1].switches >= iterations)
+		&& (benchTask[0].switches <= benchTask[1].switches + 1U), "fair round robin");
+	Bench_KernelCheckStacks(2U);
+}
+
+void Bench_Kernel_Notify(uint32_t iterations)
+{
+	/* iterations counts notify/wake/wait round trips (two switches each) */
+	benchKernelCount = 0;
+	benchKernelLimit = iterations;
+	Kernel_Init();
+	Bench_KernelCreate(0, Bench_WaiterTask, 3U);
+	Bench_KernelCreate(1, Bench_NotifierTask, 2U);
+	Kernel_Start();
+	Bench_KernelCheckStacks(2U);
+}
+
+void Bench_Kernel_Delay(uint32_t iterations)
+{
+	/* iterations counts timeouts expiring, tasks of mixed priorities and delays */
+	benchKernelCount = 0;
+	benchKernelLimit = iterations;
+	Kernel_Init();
+	for (uint32_t i = 0; i < BENCH_KERNEL_TASKS; i++)
+	{
+		Bench_KernelCreate(i, Bench_DelayTask, 1U + (i % 3U));
+	}
+	Kernel_Start();
+	Bench_KernelCheckStacks(BENCH_KERNEL_TASKS);
+}
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+  * @file    host_lcd_comp.c
+  * @brief   Host checks and benchmarks of lcd_comp.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "gfx_engine.h"
+#include "host_test.h"
+#include "lcd_comp.h"
+#include "lcd_fb.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_COMP_WIDTH        480U    /* compositor throughput panel */
+#define BENCH_COMP_HEIGHT       272U
+
+/* Private functions ---------------------------------------------------------*/
+/* The scene drawn whole into dst, the surfaces set as given */
+static void Bench_CompReference(const GfxEngine_BufferTypeDef *dst, uint32_t background,
+	const LcdComp_SurfaceTypeDef *surfaces, const uint8_t *set)
+{
+	GfxEngine_RectTypeDef all = { 0, 0, dst->width, dst->height };
+
+	(void)GfxEngine_Fill(dst, &all, background);
+	for (uint32_t i = 0; i < LCD_COMP_MAX_SURFACES; i++)
+	{
+		const LcdComp_SurfaceTypeDef *s = &surfaces[i];
+		GfxEngine_RectTypeDef part;
+
+		if ((set[i] == 0U) || (s->x >= dst->width) || (s->y >= dst->height))
+		{
+			continue;
+		}
+		part.x = 0U;
+		part.y = 0U;
+		part.width = (s->x + s->image.width <= dst->width) ? s->image.width : (dst->width - s->x);
+		part.height = (s->y + s->image.height <= dst->height) ? s->image.height : (dst->height - s->y);
+		if (s->mode == LCD_COMP_BLEND)
+		{
+			(void)GfxEngine_Blend(dst, s->x, s->y, &s->image, &part, s->color);
+		}
+		else
+		{
+			(void)GfxEngine_Convert(dst, s->x, s->y, &s->image, &part, s->color);
+		}
+	}
+}
+
+/* Partial redraws against whole ones through random scene changes, two and
+   three buffers; the sprite window clipped and moved in the blanking */
+static void Bench_LcdComp_Check(void)
+{
+	static uint16_t opaque565[16][32];
+	static uint32_t opaque8888[16][16];
+	static uint32_t translucent[12][24];
+	static uint8_t glyph[16][16];
+	static uint32_t sprite[16][16];
+	static uint16_t reference[BENCH_FB_HEIGHT][BENCH_FB_WIDTH];
+	GfxEngine_BufferTypeDef referenceBuffer = { reference, BENCH_FB_WIDTH, BENCH_FB_HEIGHT, GFX_RGB565 };
+	GfxEngine_BufferTypeDef spriteBuffer = { sprite, 16, 16, GFX_ARGB8888 };
+	LcdComp_SurfaceTypeDef surfaces[LCD_COMP_MAX_SURFACES];
+	uint8_t set[LCD_COMP_MAX_SURFACES];
+	LcdComp_StatsTypeDef stats;
+	LcdComp_StatsTypeDef before;
+	uint32_t background = 0xFF204060U;
+	uint32_t seed = 17U;
+
+	for (uint32_t i = 0; i < sizeof(opaque565) / sizeof(uint16_t); i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		(&opaque565[0][0])[i] = (uint16_t)(seed >> 16);
+		(&opaque8888[0][0])[i % 256U] = seed;
+		(&translucent[0][0])[i % 288U] = seed ^ 0x5A5A5A5AU;
+		(&glyph[0][0])[i % 256U] = (uint8_t)(seed >> 24);
+	}
+	memset(surfaces, 0, sizeof(surfaces));
+	surfaces[0] = (LcdComp_SurfaceTypeDef){ { opaque565, 32, 16, GFX_RGB565 }, 8, 8, LCD_COMP_OPAQUE, 0xFFFFFFFFU };
+	surfaces[1] = (LcdComp_SurfaceTypeDef){ { opaque8888, 16, 16, GFX_ARGB8888 }, 16, 0, LCD_COMP_OPAQUE,
+		0xFFFFFFFFU };
+	surfaces[2] = (LcdComp_SurfaceTypeDef){ { translucent, 24, 12, GFX_ARGB8888 }, 30, 10, LCD_COMP_BLEND,
+		0xC0FFFFFFU };
+	surfaces[3] = (LcdComp_SurfaceTypeDef){ { glyph, 16, 16, GFX_A8 }, 44, 14, LCD_COMP_BLEND, 0xFF00FF00U };
+	memset(set, 0, sizeof(set));
+
+	Bench_Expect("LcdComp", (Bench_FbInit(1, BENCH_FB_MEMORY) == HAL_ERROR)
+		&& (LcdComp_Init(&benchFbLtdc, background) == HAL_ERROR) && (LcdComp_Render() == HAL_ERROR), "no lcd_fb");
+	Bench_Expect("LcdComp", (Bench_FbInit(2, BENCH_FB_MEMORY) == HAL_OK) && (GfxEngine_Init(GFX_ENGINE_SOFTWARE) == HAL_OK)
+		&& (LcdComp_Init(&benchFbLtdc, background) == HAL_OK), "init");
+	Bench_Expect("LcdComp", (LcdComp_SetSurface(LCD_COMP_MAX_SURFACES, &surfaces[0]) == HAL_ERROR)
+		&& (LcdComp_MoveSurface(1, 0, 0) == HAL_ERROR), "surface not valid");
+
+	/* First frames whole, then the damage only, both buffers kept up to
+	   date */
+	Bench_Expect("LcdComp", LcdComp_Render() == HAL_OK, "first frame");
+	Bench_FbRefresh();
+	LcdComp_GetStats(&stats);
+	Bench_Expect("LcdComp", (stats.frames == 1U) && (stats.pixels == BENCH_FB_WIDTH * BENCH_FB_HEIGHT) && (stats.fills == 1U)
+		&& (LcdComp_Render() == HAL_OK), "first frame whole");
+	LcdComp_GetStats(&stats);
+	Bench_Expect("LcdComp", stats.idle == 1U, "nothing to redraw");
+	set[1] = 1U;
+	Bench_Expect("LcdComp", LcdComp_SetSurface(1, &surfaces[1]) == HAL_OK, "set");
+	Bench_Expect("LcdComp", LcdComp_Render() == HAL_OK, "second buffer");
+	Bench_FbRefresh();
+	LcdComp_GetStats(&before);
+	Bench_Expect("LcdComp", before.pixels == 2U * BENCH_FB_WIDTH * BENCH_FB_HEIGHT, "second buffer whole");
+	surfaces[1].x = 32;
+	surfaces[1].y = 16;
+	Bench_Expect("LcdComp", LcdComp_MoveSurface(1, 32, 16) == HAL_OK, "move");
+	Bench_Expect("LcdComp", LcdComp_Render() == HAL_OK, "render moved");
+	Bench_FbRefresh();
+	LcdComp_GetStats(&stats);
+	Bench_Expect("LcdComp", (stats.pixels - before.pixels == 2U * 16U * 16U) && (stats.rects - before.rects == 2U)
+		&& (stats.fills - before.fills == 1U) && (stats.copies - before.copies == 1U), "where it was, where it is");
+	Bench_CompReference(&referenceBuffer, background, surfaces, set);
+	Bench_Expect("LcdComp", memcmp(LcdFb_GetFront()->address, reference, sizeof(reference)) == 0, "moved frame");
+
+	/* Sprite on layer 2: window clipped at the left and the bottom, moved
+	   in the blanking, layer 1 not damaged */
+	LTDC->SRCR = 0U;
+	Bench_Expect("LcdComp", (LcdComp_MoveSprite(0, 0) == HAL_ERROR)
+		&& (LcdComp_SetSprite(&(GfxEngine_BufferTypeDef){ sprite, 16, 16, GFX_L4 }, 0, 0) == HAL_ERROR), "no sprite");
+	Bench_Expect("LcdComp", LcdComp_SetSprite(&spriteBuffer, -4, 20) == HAL_OK, "sprite");
+	Bench_Expect("LcdComp", (LTDC_Layer2->WHPCR == ((0U + 4U + 1U) | ((12U + 4U) << 16)))
+		&& (LTDC_Layer2->WVPCR == ((20U + 2U + 1U) | ((BENCH_FB_HEIGHT + 2U) << 16)))
+		&& (LTDC_Layer2->CFBAR == (uint32_t)(uintptr_t)&sprite[0][4])
+		&& (LTDC_Layer2->CFBLR == (((16U * 4U) << 16) | ((12U * 4U) + 3U)))
+		&& (LTDC_Layer2->CFBLNR == BENCH_FB_HEIGHT - 20U) && ((LTDC_Layer2->CR & LTDC_LxCR_LEN) != 0U)
+		&& (LTDC->SRCR == LTDC_SRCR_VBR), "sprite window clipped, reloaded in the blanking");
+	Bench_FbRefresh();
+	Bench_Expect("LcdComp", (LcdComp_MoveSprite(50, -6) == HAL_OK) && (LTDC_Layer2->CFBAR == (uint32_t)(uintptr_t)&sprite[6][0])
+		&& (LTDC_Layer2->WHPCR == ((50U + 4U + 1U) | ((BENCH_FB_WIDTH + 4U) << 16)))
+		&& (LTDC_Layer2->CFBLNR == 10U), "sprite clipped at the top and the right");
+	Bench_FbRefresh();
+	Bench_Expect("LcdComp", (LcdComp_MoveSprite(BENCH_FB_WIDTH, 0) == HAL_OK) && ((LTDC_Layer2->CR & LTDC_LxCR_LEN) == 0U)
+		&& (LcdComp_MoveSprite(3, 3) == HAL_OK) && ((LTDC_Layer2->CR & LTDC_LxCR_LEN) != 0U), "sprite off screen");
+	Bench_FbRefresh();
+	Bench_Expect("LcdComp", LcdComp_Render() == HAL_OK, "render after the sprite");
+	LcdComp_GetStats(&stats);
+	Bench_Expect("LcdComp", (stats.idle == 2U) && (stats.spriteMoves == 4U), "sprite moves redraw nothing");
+	Bench_Expect("LcdComp", (LcdComp_SetSprite(NULL, 0, 0) == HAL_OK) && ((LTDC_Layer2->CR & LTDC_LxCR_LEN) == 0U),
+		"sprite hidden");
+	Bench_FbRefresh();
+
+	/* Random scene changes */
+	for (uint32_t count = 2U; count <= LCD_FB_MAX_BUFFERS; count++)
+	{
+		Bench_Expect("LcdComp", (Bench_FbInit(count, BENCH_FB_MEMORY) == HAL_OK)
+			&& (LcdComp_Init(&benchFbLtdc, background) == HAL_OK), "random init");
+		memset(set, 0, sizeof(set));
+		for (uint32_t step = 0; step < 3000U; step++)
+		{
+			uint32_t id;
+
+			seed = seed * 1664525U + 1013904223U;
+			id = (seed >> 8) % 4U;
+			switch ((seed >> 28) % 4U)
+			{
+			case 0U:
+				set[id] ^= 1U;
+				Bench_Expect("LcdComp", LcdComp_SetSurface(id, (set[id] != 0U) ? &surfaces[id] : NULL) == HAL_OK, "random set");
+				break;
+			case 1U:
+				if (set[id] != 0U)
+				{
+					surfaces[id].x = (seed >> 12) % (BENCH_FB_WIDTH + 8U);
+					surfaces[id].y = (seed >> 20) % (BENCH_FB_HEIGHT + 8U);
+					Bench_Expect("LcdComp", LcdComp_MoveSurface(id, surfaces[id].x, surfaces[id].y) == HAL_OK, "random move");
+				}
+				break;
+			case 2U:
+			{
+				/* A pixel of the surface drawn into */
+				LcdComp_SurfaceTypeDef *s = &surfaces[id];
+				uint32_t x = (seed >> 12) % s->image.width;
+				uint32_t y = (seed >> 20) % s->image.height;
+
+				Bench_GfxSet(&s->image, x, y, seed * 2654435761U);
+				LcdComp_Invalidate(&(GfxEngine_RectTypeDef){ s->x + x, s->y + y, 1, 1 });
+				break;
+			}
+			default:
+				Bench_Expect("LcdComp", LcdComp_Render() == HAL_OK, "random render");
+				Bench_FbRefresh();
+				Bench_CompReference(&referenceBuffer, background, surfaces, set);
+				Bench_Expect("LcdComp", memcmp(LcdFb_GetFront()->address, reference, sizeof(reference)) == 0,
+					"partial redraw as the whole one");
+				break;
+			}
+		}
+		LcdComp_GetStats(&stats);
+		Bench_Expect("LcdComp", (stats.frames > 100U) && (stats.errors == 0U) && (stats.stalls == 0U)
+			&& (stats.pixels < stats.frames * BENCH_FB_WIDTH * BENCH_FB_HEIGHT), "random counters");
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* A 48x48 icon dragged over a 480x272 wallpaper, composited in software:
+   the pixels a frame redraws */
+void Bench_LcdComp_Drag(uint32_t iterations)
+{
+	static uint8_t memory[(2U * BENCH_COMP_WIDTH * BENCH_COMP_HEIGHT * 2U) + LCD_FB_ALIGN];
+	static uint16_t wallpaper[BENCH_COMP_HEIGHT][BENCH_COMP_WIDTH];
+	static uint32_t icon[48][48];
+	LcdComp_SurfaceTypeDef back = { { wallpaper, BENCH_COMP_WIDTH, BENCH_COMP_HEIGHT, GFX_RGB565 }, 0, 0,
+		LCD_COMP_OPAQUE, 0xFFFFFFFFU };
+	LcdComp_SurfaceTypeDef drag = { { icon, 48, 48, GFX_ARGB8888 }, 0, 0, LCD_COMP_BLEND, 0xFFFFFFFFU };
+	LcdComp_StatsTypeDef stats;
+	uint32_t frames = (iterations / 256U) + 2U;
+	uint64_t start;
+	uint64_t elapsed;
+
+	Bench_LcdComp_Check();
+
+	HostSim_Reset();
+	for (uint32_t i = 0; i < 48U * 48U; i++)
+	{
+		(&icon[0][0])[i] = ((i % 48U) << 26) | (i * 0x00010305U);
+	}
+	Bench_Expect("LcdComp", (Bench_FbPanel(BENCH_COMP_WIDTH, BENCH_COMP_HEIGHT, memory, sizeof(memory), 2) == HAL_OK)
+		&& (GfxEngine_Init(GFX_ENGINE_SOFTWARE) == HAL_OK) && (LcdComp_Init(&benchFbLtdc, 0xFF000000U) == HAL_OK)
+		&& (LcdComp_SetSurface(0, &back) == HAL_OK) && (LcdComp_SetSurface(1, &drag) == HAL_OK), "bench init");
+	start = Host_NowNs();
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		(void)LcdComp_MoveSurface(1, (i * 5U) % (BENCH_COMP_WIDTH - 48U), (i * 3U) % (BENCH_COMP_HEIGHT - 48U));
+		(void)LcdComp_Render();
+		Bench_FbRefresh();
+	}
+	elapsed = Host_NowNs() - start;
+	LcdComp_GetStats(&stats);
+	Bench_Expect("LcdComp", (stats.frames == frames) && (stats.errors == 0U), "bench frames");
+	printf("  %lu frames, %.1f%% of the pixels of full redraws, %.1f us a frame on the CPU\n", (unsigned long)frames,
+		(double)stats.pixels * 100.0 / ((double)frames * BENCH_COMP_WIDTH * BENCH_COMP_HEIGHT),
+		(double)elapsed / 1000.0 / (double)frames);
+}
@@ -0,0 +1,271 @@
+/**
+  ******************************************************************************
+  * @file    host_lcd_fb.c
+  * @brief   Host checks and benchmarks of lcd_fb.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "gfx_engine.h"
+#include "host_test.h"
+#include "lcd_fb.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_FB_STEPS          20000U
+
+/* Exported variables --------------------------------------------------------*/
+LTDC_HandleTypeDef benchFbLtdc;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t benchFbMemory[BENCH_FB_MEMORY + 1U] __attribute__((aligned(LCD_FB_ALIGN)));
+static uint32_t benchFbFreed;
+static uint32_t benchFbShown;           /* address the LTDC scans out, its shadow registers reloaded */
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_FbFreed(void)
+{
+	benchFbFreed++;
+}
+
+/* LTDC model: a flag raised, the interrupt taken, the flags written to ICR
+   by the HAL cleared */
+static void Bench_FbInterrupt(uint32_t flag)
+{
+	LTDC->ISR |= flag;
+	LcdFb_IRQHandler();
+	LTDC->ISR &= ~LTDC->ICR;
+	LTDC->ICR = 0U;
+}
+
+/* Frame number in the first pixels of a buffer */
+static uint32_t Bench_FbFrame(uint32_t address)
+{
+	uint32_t frame;
+
+	memcpy(&frame, (const void *)(uintptr_t)address, sizeof(frame));
+	return frame;
+}
+
+static void Bench_FbPresentMarker(void *arg)
+{
+	Bench_Expect("LcdFb", LcdFb_Present(arg) == HAL_OK, "present from the DMA2D marker");
+}
+
+/* Buffer states through double and triple buffering, dropped and late
+   frames, a frame drawn by the DMA2D, and a random schedule against the
+   rules of a tear-free flip */
+static void Bench_LcdFb_Check(void)
+{
+	GfxEngine_BufferTypeDef *drawing[LCD_FB_MAX_BUFFERS];
+	GfxEngine_BufferTypeDef *a;
+	GfxEngine_BufferTypeDef *b;
+	GfxEngine_BufferTypeDef *c;
+	const GfxEngine_BufferTypeDef *front;
+	GfxEngine_RectTypeDef rect = { 0, 0, BENCH_FB_WIDTH, BENCH_FB_HEIGHT };
+	LcdFb_StatsTypeDef stats;
+	uint32_t frame = 0U;
+	uint32_t seed = 9U;
+
+	Bench_Expect("LcdFb", (Bench_FbInit(1, BENCH_FB_MEMORY) == HAL_ERROR) && (Bench_FbInit(4, BENCH_FB_MEMORY) == HAL_ERROR)
+		&& (LcdFb_Acquire() == NULL) && (LcdFb_GetFront() == NULL), "buffer count");
+	Bench_Expect("LcdFb", Bench_FbInit(3, 3U * BENCH_FB_BYTES) == HAL_ERROR, "memory too small, alignment counted");
+
+	/* Double buffering */
+	Bench_Expect("LcdFb", Bench_FbInit(2, BENCH_FB_MEMORY) == HAL_OK, "init");
+	front = LcdFb_GetFront();
+	Bench_Expect("LcdFb", (front != NULL) && (((uintptr_t)front->address % LCD_FB_ALIGN) == 0U)
+		&& (benchFbShown == (uint32_t)(uintptr_t)front->address)
+		&& (LTDC->LIPCR == 2U + BENCH_FB_HEIGHT - LCD_FB_FLIP_LINES) && ((LTDC->IER & LTDC_IER_LIE) != 0U)
+		&& (front->width == BENCH_FB_WIDTH) && (front->format == GFX_RGB565), "first buffer on screen");
+	a = LcdFb_Acquire();
+	Bench_Expect("LcdFb", (a != NULL) && (LcdFb_GetState(a) == LCD_FB_DRAWING) && (LcdFb_Acquire() == NULL)
+		&& ((uint8_t *)a->address >= (uint8_t *)front->address + BENCH_FB_BYTES), "second buffer drawn");
+	Bench_FbRefresh();
+	Bench_Expect("LcdFb", LcdFb_Present(front) == HAL_ERROR, "present of the buffer on screen");
+	Bench_Expect("LcdFb", (LcdFb_Present(a) == HAL_OK) && (LcdFb_GetState(a) == LCD_FB_READY)
+		&& (LcdFb_Present(a) == HAL_ERROR), "present");
+	Bench_Expect("LcdFb", benchFbShown == (uint32_t)(uintptr_t)front->address, "no flip before the line event");
+	Bench_FbInterrupt(LTDC_ISR_LIF);
+	Bench_Expect("LcdFb", (LcdFb_GetState(a) == LCD_FB_PENDING) && (LcdFb_GetFront() == front)
+		&& ((LTDC->SRCR & LTDC_SRCR_VBR) != 0U) && ((LTDC->IER & LTDC_IER_LIE) != 0U), "flip asked for the blanking");
+	LTDC->SRCR = 0U;
+	benchFbShown = LTDC_Layer1->CFBAR;
+	Bench_FbInterrupt(LTDC_ISR_RRIF);
+	LcdFb_GetStats(&stats);
+	Bench_Expect("LcdFb", (LcdFb_GetFront() == a) && (benchFbShown == (uint32_t)(uintptr_t)a->address)
+		&& (benchFbFreed == 1U) && (stats.refreshes == 2U) && (stats.late == 1U) && (stats.flips == 1U)
+		&& (stats.frameTime[1] == 1U), "flipped in the blanking, the old buffer freed");
+	b = LcdFb_Acquire();
+	Bench_Expect("LcdFb", (b == front) && (LcdFb_Present(b) == HAL_OK), "old buffer drawn again");
+	Bench_FbRefresh();
+	Bench_Expect("LcdFb", (LcdFb_GetFront() == b) && (LcdFb_GetState(a) == LCD_FB_FREE), "second flip");
+
+	/* Triple buffering: the renderer runs ahead, the newest frame wins */
+	Bench_Expect("LcdFb", Bench_FbInit(3, BENCH_FB_MEMORY) == HAL_OK, "init");
+	front = LcdFb_GetFront();
+	a = LcdFb_Acquire();
+	b = LcdFb_Acquire();
+	Bench_Expect("LcdFb", (a != NULL) && (b != NULL) && (LcdFb_Acquire() == NULL), "two buffers drawn");
+	Bench_Expect("LcdFb", (LcdFb_Present(a) == HAL_OK) && (LcdFb_Present(b) == HAL_OK) && (LcdFb_GetState(a) == LCD_FB_FREE)
+		&& (benchFbFreed == 1U), "frame replaced before shown");
+	c = LcdFb_Acquire();
+	Bench_Expect("LcdFb", c == a, "dropped buffer drawn again");
+	Bench_FbRefresh();
+	LcdFb_GetStats(&stats);
+	Bench_Expect("LcdFb", (LcdFb_GetFront() == b) && (LcdFb_GetState(front) == LCD_FB_FREE) && (stats.dropped == 1U)
+		&& (stats.flips == 1U) && (stats.frameTime[0] == 1U), "newest frame shown");
+
+	/* FIFO underruns counted, the interrupt kept on */
+	Bench_FbInterrupt(LTDC_ISR_FUIF);
+	Bench_FbInterrupt(LTDC_ISR_FUIF);
+	LcdFb_GetStats(&stats);
+	Bench_Expect("LcdFb", (stats.errors == 2U) && ((LTDC->IER & LTDC_IER_FUIE) != 0U), "underruns");
+
+	/* Frame N + 1 drawn by the DMA2D while frame N is scanned out,
+	   presented by a marker behind the fill */
+	Bench_Expect("LcdFb", GfxEngine_Init(GFX_ENGINE_HARDWARE) == HAL_OK, "gfx init");
+	Bench_Expect("LcdFb", (GfxEngine_Fill(c, &rect, 0xFF00FF00U) == HAL_OK)
+		&& (GfxEngine_Marker(Bench_FbPresentMarker, c) == HAL_OK) && (LcdFb_GetState(c) == LCD_FB_DRAWING),
+		"frame queued");
+	Bench_FbRefresh();
+	Bench_Expect("LcdFb", LcdFb_GetFront() == b, "frame still drawn");
+	Bench_GfxRun();
+	Bench_Expect("LcdFb", LcdFb_GetState(c) == LCD_FB_READY, "frame presented by the marker");
+	Bench_FbRefresh();
+	Bench_Expect("LcdFb", (LcdFb_GetFront() == c)
+		&& (((uint16_t *)c->address)[(BENCH_FB_WIDTH * BENCH_FB_HEIGHT) - 1U] == 0x07E0U), "DMA2D frame on screen");
+
+	/* Random schedule: frames drawn at any pace, presented in the order
+	   drawn; the buffer scanned out is never drawn into, changes in the
+	   blanking only and its frames only go forward */
+	for (uint32_t count = 2U; count <= LCD_FB_MAX_BUFFERS; count++)
+	{
+		uint32_t drawn = 0U;
+		uint32_t lastShown = 0U;
+
+		memset(benchFbMemory, 0, sizeof(benchFbMemory));
+		Bench_Expect("LcdFb", Bench_FbInit(count, BENCH_FB_MEMORY) == HAL_OK, "random init");
+		for (uint32_t step = 0; step < BENCH_FB_STEPS; step++)
+		{
+			uint32_t shownBefore = benchFbShown;
+			uint32_t action;
+
+			seed = seed * 1664525U + 1013904223U;
+			action = (seed >> 28) % 4U;
+			if (action <= 1U)
+			{
+				a = LcdFb_Acquire();
+				if (a != NULL)
+				{
+					Bench_Expect("LcdFb", (uint32_t)(uintptr_t)a->address != benchFbShown, "acquired buffer not on screen");
+					frame++;
+					memcpy(a->address, &frame, sizeof(frame));
+					drawing[drawn++] = a;
+				}
+			}
+			else if (action == 2U)
+			{
+				if (drawn != 0U)
+				{
+					Bench_Expect("LcdFb", LcdFb_Present(drawing[0]) == HAL_OK, "random present");
+					drawn--;
+					memmove(&drawing[0], &drawing[1], drawn * sizeof(drawing[0]));
+				}
+			}
+			else
+			{
+				Bench_FbRefresh();
+			}
+			LcdFb_GetStats(&stats);
+			front = LcdFb_GetFront();
+			Bench_Expect("LcdFb", (front != NULL) && (benchFbShown == (uint32_t)(uintptr_t)front->address),
+				"the buffer scanned out is the one the LTDC reads");
+			Bench_Expect("LcdFb", (benchFbShown == shownBefore) || (action == 3U), "flip in the blanking only");
+			Bench_Expect("LcdFb", Bench_FbFrame(benchFbShown) >= lastShown, "frames go forward");
+			lastShown = Bench_FbFrame(benchFbShown);
+			for (uint32_t i = 0; i < drawn; i++)
+			{
+				Bench_Expect("LcdFb", LcdFb_GetState(drawing[i]) == LCD_FB_DRAWING, "buffers drawn kept");
+			}
+			Bench_Expect("LcdFb", stats.presented - stats.flips - stats.dropped <= 2U, "one frame READY, one PENDING at most");
+			Bench_Expect("LcdFb", stats.frameTime[0] + stats.frameTime[1] + stats.frameTime[2] + stats.frameTime[3]
+				== stats.flips, "frame times");
+		}
+		LcdFb_GetStats(&stats);
+		Bench_Expect("LcdFb", (stats.flips > BENCH_FB_STEPS / 16U) && (stats.late != 0U) && (stats.errors == 0U)
+			&& ((count == 2U) ? (stats.dropped == 0U) : (stats.dropped != 0U)), "random counters");
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* One refresh of the panel: the line event near the end of the active
+   area, then the vertical blanking, the shadow registers reloaded if the
+   LTDC was asked to. benchFbShown is the address the LTDC reads from. */
+void Bench_FbRefresh(void)
+{
+	Bench_FbInterrupt(LTDC_ISR_LIF);
+	if ((LTDC->SRCR & LTDC_SRCR_VBR) != 0U)
+	{
+		LTDC->SRCR = 0U;
+		benchFbShown = LTDC_Layer1->CFBAR;
+		Bench_FbInterrupt(LTDC_ISR_RRIF);
+	}
+}
+
+/* width x height RGB565 panel on LTDC layer 1 */
+HAL_StatusTypeDef Bench_FbPanel(uint32_t width, uint32_t height, uint8_t *memory, uint32_t size,
+	uint32_t count)
+{
+	LTDC_LayerCfgTypeDef layer;
+	HAL_StatusTypeDef status;
+
+	memset(&benchFbLtdc, 0, sizeof(benchFbLtdc));
+	benchFbLtdc.Instance = LTDC;
+	benchFbLtdc.Init.AccumulatedHBP = 4;
+	benchFbLtdc.Init.AccumulatedVBP = 2;
+	benchFbLtdc.Init.AccumulatedActiveW = 4 + width;
+	benchFbLtdc.Init.AccumulatedActiveH = 2 + height;
+	benchFbLtdc.Init.TotalWidth = 8 + width;
+	benchFbLtdc.Init.TotalHeigh = 4 + height;
+	memset(&layer, 0, sizeof(layer));
+	layer.WindowX1 = width;
+	layer.WindowY1 = height;
+	layer.PixelFormat = LTDC_PIXEL_FORMAT_RGB565;
+	layer.Alpha = 255;
+	layer.BlendingFactor1 = LTDC_BLENDING_FACTOR1_CA;
+	layer.BlendingFactor2 = LTDC_BLENDING_FACTOR2_CA;
+	layer.ImageWidth = width;
+	layer.ImageHeight = height;
+	benchFbFreed = 0U;
+	status = LcdFb_Init(&benchFbLtdc, &layer, 0, memory, size, count, Bench_FbFreed);
+	benchFbShown = LTDC_Layer1->CFBAR;
+	return status;
+}
+
+/* BENCH_FB_WIDTH x BENCH_FB_HEIGHT panel, the buffers from an odd address
+   of benchFbMemory */
+HAL_StatusTypeDef Bench_FbInit(uint32_t count, uint32_t size)
+{
+	return Bench_FbPanel(BENCH_FB_WIDTH, BENCH_FB_HEIGHT, &benchFbMemory[1], size, count);
+}
+
+/* A frame acquired, presented and flipped every refresh: the CPU cost of
+   the flip, both interrupts included */
+void Bench_LcdFb_Flip(uint32_t iterations)
+{
+	LcdFb_StatsTypeDef stats;
+
+	Bench_LcdFb_Check();
+
+	HostSim_Reset();
+	Bench_Expect("LcdFb", Bench_FbInit(2, BENCH_FB_MEMORY) == HAL_OK, "bench init");
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		(void)LcdFb_Present(LcdFb_Acquire());
+		Bench_FbRefresh();
+	}
+	LcdFb_GetStats(&stats);
+	Bench_Expect("LcdFb", (stats.flips == iterations) && (stats.frameTime[0] == iterations), "bench flips");
+}
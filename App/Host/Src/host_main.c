@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * @file    host_main.c
+  * @brief   Entry point of the host build: driver hot-path microbenchmarks
+  *          run against the simulated register blocks of host_sim.c.
+  *          The checks and benchmarks of the larger modules live in
+  *          host_<module>.c, see host_test.h.
+  *
+  *          Usage: STM32F746ZG_APP_host [iterations]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stm32f7xx_ll_bus.h"
+#include "stm32f7xx_ll_gpio.h"
+#include "stm32f7xx_ll_usart.h"
+
+#include "profile.h"
+#include "host_test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	const char *name;
+	void (*run)(uint32_t iterations);
+} HostBench_TypeDef;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Bench_GPIO_TogglePin(uint32_t iterations);
+static void Bench_GPIO_SetResetPin(uint32_t iterations);
+static void Bench_GPIO_Init(uint32_t iterations);
+static void Bench_USART_TransmitData8(uint32_t iterations);
+
+/* Private variables ---------------------------------------------------------*/
+static const HostBench_TypeDef benchTable[] =
+{
+	{ "LL_GPIO_TogglePin",        Bench_GPIO_TogglePin },
+	{ "LL_GPIO_Set/ResetOutput",  Bench_GPIO_SetResetPin },
+	{ "LL_GPIO_Init",             Bench_GPIO_Init },
+	{ "LL_USART_TransmitData8",   Bench_USART_TransmitData8 },
+	{ "Profile_Record",           Bench_Profile_Record },
+	{ "TimerWheel_Start/Stop",    Bench_TimerWheel_StartStop },
+	{ "TimerWheel_Advance(1)",    Bench_TimerWheel_Advance },
+	{ "Timebase tick+poll",       Bench_Timebase_Poll },
+	{ "RingBuffer SPSC (byte)",   Bench_RingBuffer_Spsc },
+	{ "Frame COBS round trip",    Bench_Frame_RoundTrip },
+	{ "MpuRegions_Build",         Bench_MpuRegions_Build },
+	{ "DmaBuffer alloc/free",     Bench_DmaBuffer_AllocFree },
+	{ "BenchCore_Iterate/1000",   Bench_BenchCore_Iterate },
+	{ "Kernel_Yield switch",      Bench_Kernel_Yield },
+	{ "Kernel_Notify preempt",    Bench_Kernel_Notify },
+	{ "Kernel_Delay wake-up",     Bench_Kernel_Delay },
+	{ "CrcStream slice-by-8/byte", Bench_CrcStream_Table },
+	{ "CrcStream bitwise/byte",   Bench_CrcStream_Bitwise },
+	{ "EthPbuf RX 64B zero-copy", Bench_EthPbuf_Rx },
+	{ "EthPbuf TX hdr+payload",   Bench_EthPbuf_Tx },
+	{ "EthIf RX 64B irq/frame",   Bench_EthIf_IrqPerFrame },
+	{ "EthIf RX 64B flood NAPI",  Bench_EthIf_Flood },
+	{ "EthIf RX UDP csum offload", Bench_EthIf_Checksum },
+	{ "EthFilter_Hash",           Bench_EthFilter_Hash },
+	{ "Ptp two-step E2E/frame",   Bench_Ptp_Exchange },
+	{ "Net UDP 1472B batch send", Bench_Net_UdpSend },
+	{ "UsbCdc 64B write+complete", Bench_UsbCdc_Write },
+	{ "UsbMsc READ(10) per block", Bench_UsbMsc_Read },
+	{ "UsbFifo_Plan CDC HS",      Bench_UsbFifo_Plan },
+	{ "USB FIFO copy, 5 EP types", Bench_UsbFifo_Copy },
+	{ "BlockDev 1-block record",  Bench_BlockDev_Log },
+	{ "GfxEngine fill via DMA2D", Bench_GfxEngine_Queue },
+	{ "GfxSoft blend/pixel (CPU)", Bench_GfxSoft_Blend },
+	{ "LcdFb present+flip/frame", Bench_LcdFb_Flip },
+	{ "Damage_Add UI patterns",   Bench_Damage_Patterns },
+	{ "LcdComp drag 48x48 icon",  Bench_LcdComp_Drag },
+	{ "Sdram_CalcTiming",         Bench_Sdram_CalcTiming },
+	{ "MemHeap alloc/free mixed", Bench_MemHeap_AllocFree },
+	{ "QspiFlash_ParseSfdp",      Bench_QspiFlash_ParseSfdp },
+};
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_GPIO_TogglePin(uint32_t iterations)
+{
+	while (iterations--)
+	{
+		LL_GPIO_TogglePin(GPIOB, LL_GPIO_PIN_0);
+	}
+}
+
+static void Bench_GPIO_SetResetPin(uint32_t iterations)
+{
+	while (iterations--)
+	{
+		LL_GPIO_SetOutputPin(GPIOB, LL_GPIO_PIN_7);
+		LL_GPIO_ResetOutputPin(GPIOB, LL_GPIO_PIN_7);
+	}
+}
+
+static void Bench_GPIO_Init(uint32_t iterations)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	gpioConfig.Pin = LL_GPIO_PIN_14;
+	gpioConfig.Mode = LL_GPIO_MODE_OUTPUT;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_UP;
+
+	while (iterations--)
+	{
+		LL_GPIO_Init(GPIOB, &gpioConfig);
+	}
+}
+
+static void Bench_USART_TransmitData8(uint32_t iterations)
+{
+	uint8_t data = 0;
+
+	while (iterations--)
+	{
+		while (!LL_USART_IsActiveFlag_TXE(USART1)){}
+		LL_USART_TransmitData8(USART1, data++);
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+uint64_t Host_NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+void Host_PutChar(char c)
+{
+	putchar(c);
+}
+
+/**
+ * @brief  Abort the run when a host check fails.
+ * @param  module: name printed in front of the message
+ * @param  condition: 0 on a failure
+ * @param  what: the failed check
+ * @retval None
+ */
+void Bench_Expect(const char *module, int condition, const char *what)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "%s check failed: %s\n", module, what);
+		abort();
+	}
+}
+
+/**
+ * @brief  Host application entry point.
+ * @retval int
+ */
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = 10000000U;
+
+	if (argc > 1)
+	{
+		iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	for (size_t i = 0; i < sizeof(benchTable) / sizeof(benchTable[0]); i++)
+	{
+		HostSim_Reset();
+		LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOB);
+		LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1);
+
+		uint64_t start = Host_NowNs();
+		benchTable[i].run(iterations);
+		uint64_t elapsed = Host_NowNs() - start;
+
+		printf("%-28s %10lu iter  %8.3f ns/iter\n", benchTable[i].name,
+			(unsigned long)iterations, (double)elapsed / (double)iterations);
+	}
+
+	Profile_Dump(Host_PutChar);
+
+	return 0;
+}
+
+#ifdef USE_FULL_ASSERT
+/**
+ * @brief  Reports the name of the source file and the source line number
+ *         where the assert_param error has occurred.
+ * @param  file: pointer to the source file name
+ * @param  line: assert_param error line source number
+ * @retval None
+ */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+	fprintf(stderr, "assert_failed: %s:%lu\n", (const char *)file, (unsigned long)line);
+	abort();
+}
+#endif /* USE_FULL_ASSERT */
@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * @file    host_mem_heap.c
+  * @brief   Host checks and benchmarks of mem_heap.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mem_heap.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_HEAP_SIZE         65536U  /* MemHeap checks and bench */
+#define BENCH_HEAP_SLOTS        64U
+#define BENCH_HEAP_ROUNDS       20000U
+
+/* Private functions ---------------------------------------------------------*/
+/* Every block in address order: sizes add up to the heap, each knows its
+   neighbour, no two free ones touch, the free list and the counter agree */
+static void Bench_MemHeapWalk(MemHeap_TypeDef *heap)
+{
+	uint32_t offset = 0;
+	uint32_t prevSize = 0;
+	uint32_t prevFree = 0;
+	uint32_t freeBlocks = 0;
+	uint32_t freeBytes = 0;
+	uint32_t listed = 0;
+
+	while (offset < heap->size)
+	{
+		MemHeap_BlockTypeDef *block = (MemHeap_BlockTypeDef *)(heap->memory + offset);
+		uint32_t size = block->size & ~1U;
+		uint32_t free = ((block->size & 1U) == 0U) ? 1U : 0U;
+
+		Bench_Expect("MemHeap", (size >= MEM_HEAP_ALIGN) && ((size % MEM_HEAP_ALIGN) == 0U), "block size");
+		Bench_Expect("MemHeap", block->prevSize == prevSize, "previous size");
+		Bench_Expect("MemHeap", !(free && prevFree), "adjacent free blocks");
+		if (free)
+		{
+			freeBlocks++;
+			freeBytes += size;
+		}
+		prevSize = size;
+		prevFree = free;
+		offset += size;
+	}
+	Bench_Expect("MemHeap", offset == heap->size, "blocks cover the heap");
+	for (MemHeap_BlockTypeDef *block = heap->freeList; block != NULL; block = block->next)
+	{
+		Bench_Expect("MemHeap", ((block->size & 1U) == 0U) && (listed < freeBlocks), "free list");
+		listed++;
+	}
+	Bench_Expect("MemHeap", (listed == freeBlocks) && (freeBytes == heap->freeBytes), "free count");
+}
+
+static void Bench_MemHeap_Check(void)
+{
+	static uint8_t memory[BENCH_HEAP_SIZE + MEM_HEAP_ALIGN];
+	static uint8_t *slots[BENCH_HEAP_SLOTS];
+	static uint32_t sizes[BENCH_HEAP_SLOTS];
+	MemHeap_TypeDef heap;
+	MemHeap_StatsTypeDef stats;
+	uint32_t seed = 0x4D454D48U;
+	uint32_t count = 0;
+
+	/* A misaligned region loses its ends */
+	MemHeap_Init(&heap, &memory[1], BENCH_HEAP_SIZE);
+	MemHeap_GetStats(&heap, &stats);
+	Bench_Expect("MemHeap", (stats.size == (BENCH_HEAP_SIZE - MEM_HEAP_ALIGN)) && (stats.freeBlocks == 1U)
+		&& (stats.largestFree == (stats.size - MEM_HEAP_ALIGN)), "init");
+	Bench_Expect("MemHeap", (MemHeap_Alloc(&heap, 0U) == NULL) && (MemHeap_Alloc(&heap, BENCH_HEAP_SIZE) == NULL),
+		"zero and oversize");
+	MemHeap_GetStats(&heap, &stats);
+	Bench_Expect("MemHeap", (stats.failures == 1U) && (stats.allocs == 0U), "zero is no failure");
+
+	/* Random sizes allocated and freed, each buffer filled with its own
+	   pattern and found intact when freed */
+	memset(slots, 0, sizeof(slots));
+	for (uint32_t step = 0; step < BENCH_HEAP_ROUNDS; step++)
+	{
+		uint32_t slot;
+
+		seed = seed * 1664525U + 1013904223U;
+		slot = (seed >> 8) % BENCH_HEAP_SLOTS;
+		if (slots[slot] == NULL)
+		{
+			sizes[slot] = 1U + ((seed >> 16) % ((seed & 0x80000000U) ? 4096U : 256U));
+			slots[slot] = MemHeap_Alloc(&heap, sizes[slot]);
+			if (slots[slot] != NULL)
+			{
+				Bench_Expect("MemHeap", ((uintptr_t)slots[slot] % MEM_HEAP_ALIGN) == 0U, "alignment");
+				memset(slots[slot], (int)slot, sizes[slot]);
+				count++;
+			}
+		}
+		else
+		{
+			for (uint32_t i = 0; i < sizes[slot]; i++)
+			{
+				Bench_Expect("MemHeap", slots[slot][i] == (uint8_t)slot, "buffer overwritten");
+			}
+			MemHeap_Free(&heap, slots[slot]);
+			slots[slot] = NULL;
+		}
+		if ((step % 64U) == 0U)
+		{
+			Bench_MemHeapWalk(&heap);
+		}
+	}
+	Bench_Expect("MemHeap", count > (BENCH_HEAP_ROUNDS / 4U), "random allocations");
+	for (uint32_t slot = 0; slot < BENCH_HEAP_SLOTS; slot++)
+	{
+		MemHeap_Free(&heap, slots[slot]);
+		slots[slot] = NULL;
+	}
+	Bench_MemHeapWalk(&heap);
+	MemHeap_GetStats(&heap, &stats);
+	Bench_Expect("MemHeap", (stats.freeBlocks == 1U) && (stats.freeBytes == stats.size)
+		&& (stats.allocs == stats.frees), "all coalesced");
+
+	/* Exhausted by 1 KB blocks, every other one freed: no room for 2 KB */
+	{
+		static uint8_t *blocks[BENCH_HEAP_SIZE / 1024U];
+		uint32_t n = 0;
+
+		while ((n < (BENCH_HEAP_SIZE / 1024U)) && ((blocks[n] = MemHeap_Alloc(&heap, 1024U)) != NULL))
+		{
+			n++;
+		}
+		Bench_Expect("MemHeap", n > ((BENCH_HEAP_SIZE / 1024U) - 4U), "filled");
+		for (uint32_t i = 0; i < n; i += 2U)
+		{
+			MemHeap_Free(&heap, blocks[i]);
+		}
+		Bench_MemHeapWalk(&heap);
+		Bench_Expect("MemHeap", MemHeap_Alloc(&heap, 2048U) == NULL, "fragmented");
+		for (uint32_t i = 1; i < n; i += 2U)
+		{
+			MemHeap_Free(&heap, blocks[i]);
+		}
+		Bench_MemHeapWalk(&heap);
+		MemHeap_GetStats(&heap, &stats);
+		Bench_Expect("MemHeap", (stats.freeBlocks == 1U) && (stats.minFreeBytes < (2U * 1024U)), "refilled");
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Frame buffers and packet buffers of mixed sizes coming and going */
+void Bench_MemHeap_AllocFree(uint32_t iterations)
+{
+	static uint8_t memory[BENCH_HEAP_SIZE];
+	static void *slots[BENCH_HEAP_SLOTS];
+	MemHeap_TypeDef heap;
+	MemHeap_StatsTypeDef stats;
+	uint32_t seed = 12345U;
+
+	Bench_MemHeap_Check();
+
+	MemHeap_Init(&heap, memory, sizeof(memory));
+	memset(slots, 0, sizeof(slots));
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t slot;
+
+		seed = seed * 1664525U + 1013904223U;
+		slot = (seed >> 8) % BENCH_HEAP_SLOTS;
+		if (slots[slot] == NULL)
+		{
+			slots[slot] = MemHeap_Alloc(&heap, 32U + ((seed >> 20) % 1536U));
+		}
+		else
+		{
+			MemHeap_Free(&heap, slots[slot]);
+			slots[slot] = NULL;
+		}
+	}
+	MemHeap_GetStats(&heap, &stats);
+	printf("  %lu allocs, %lu failures, %lu free blocks, %lu bytes largest free\n", (unsigned long)stats.allocs,
+		(unsigned long)stats.failures, (unsigned long)stats.freeBlocks, (unsigned long)stats.largestFree);
+}
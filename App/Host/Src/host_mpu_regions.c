@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    host_mpu_regions.c
+  * @brief   Host checks and benchmarks of mpu_regions.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mpu_regions.h"
+#include "host_test.h"
+
+/* Exported functions --------------------------------------------------------*/
+/* The region table of SRAM2 and SRAM1 */
+void Bench_MpuRegions_Build(uint32_t iterations)
+{
+	static const MpuRegions_DescTypeDef desc[] =
+	{
+		/* SRAM2, naturally aligned power of two */
+		{ SRAM2_BASE, 16U * 1024U, MPU_REGIONS_NORMAL_NONCACHEABLE, ARM_MPU_AP_FULL, 1U, 1U },
+		/* SRAM1 (192K), 256K region with the first two 32K eighths disabled */
+		{ SRAM1_BASE, 192U * 1024U, MPU_REGIONS_NORMAL_WRITE_BACK, ARM_MPU_AP_FULL, 0U, 0U },
+	};
+	static const MpuRegions_DescTypeDef unaligned =
+		{ SRAM1_BASE + 16U, 32U, MPU_REGIONS_DEVICE, ARM_MPU_AP_FULL, 1U, 0U };
+	ARM_MPU_Region_t table[2];
+
+	Bench_Expect("MpuRegions", MpuRegions_Build(desc, 2U, 0U, table) == 2U, "two regions");
+	Bench_Expect("MpuRegions", (table[0].RBAR == (SRAM2_BASE | MPU_RBAR_VALID_Msk | 0U)) && (table[0].RASR == 0x130C001BUL),
+		"aligned region");
+	Bench_Expect("MpuRegions", (table[1].RBAR == (RAMDTCM_BASE | MPU_RBAR_VALID_Msk | 1U)) && (table[1].RASR == 0x030B0323UL),
+		"256K region from the DTCM base, two eighths off");
+	Bench_Expect("MpuRegions", MpuRegions_Build(&unaligned, 1U, 0U, table) == 0U, "unaligned region refused");
+	Bench_Expect("MpuRegions", MpuRegions_Build(desc, 2U, 7U, table) == 0U, "regions past the last refused");
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		MpuRegions_Build(desc, 2U, 0U, table);
+		__asm__ volatile ("" : : "r" (table) : "memory");
+	}
+}
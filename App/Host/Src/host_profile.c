@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    host_profile.c
+  * @brief   Host checks and benchmarks of profile.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "profile.h"
+#include "host_test.h"
+
+/* Private functions ---------------------------------------------------------*/
+/* count samples of cycles through the probe, the simulated CYCCNT moved
+   as the profiled code would */
+static void Bench_ProfileFeed(uint32_t cycles, uint32_t count)
+{
+	while (count--)
+	{
+		uint32_t start = Profile_GetCycles();
+
+		HostSim_DWT.CYCCNT += cycles;
+		Profile_Record(PROFILE_ID_GPIO_TOGGLE, Profile_GetCycles() - start);
+	}
+}
+
+static int Bench_ProfileIs(uint32_t count, uint32_t min, uint32_t max, uint32_t p50, uint32_t p99)
+{
+	Profile_StatsTypeDef stats;
+
+	Profile_GetStats(PROFILE_ID_GPIO_TOGGLE, &stats);
+	return (stats.count == count) && (stats.min == min) && (stats.max == max) && (stats.p50 == p50)
+		&& (stats.p99 == p99);
+}
+
+/* Known samples read back: the exact buckets under 4 cycles, the 4 sub
+   buckets of an octave ([8, 9], [10, 11], [12, 13]), percentiles on a
+   bucket edge and clamped to [min, max], the top bucket */
+static void Bench_Profile_Check(void)
+{
+	Profile_StatsTypeDef stats;
+
+	Profile_Init();
+	Profile_GetStats(PROFILE_ID_GPIO_TOGGLE, &stats);
+	Bench_Expect("Profile", (stats.count == 0U) && (stats.min == 0U) && (stats.max == 0U) && (stats.total == 0U),
+		"empty probe");
+
+	Bench_ProfileFeed(0U, 1U);
+	Bench_ProfileFeed(1U, 1U);
+	Bench_ProfileFeed(2U, 1U);
+	Bench_ProfileFeed(3U, 1U);
+	Bench_Expect("Profile", Bench_ProfileIs(4U, 0U, 3U, 1U, 3U), "exact buckets");
+
+	Profile_Reset();
+	Bench_ProfileFeed(8U, 1U);
+	Bench_ProfileFeed(9U, 98U);
+	Bench_ProfileFeed(1000U, 1U);
+	Bench_Expect("Profile", Bench_ProfileIs(100U, 8U, 1000U, 9U, 9U), "p99 on the last sample of a bucket");
+	Bench_ProfileFeed(1000U, 1U);
+	Profile_GetStats(PROFILE_ID_GPIO_TOGGLE, &stats);
+	Bench_Expect("Profile", Bench_ProfileIs(101U, 8U, 1000U, 9U, 1000U) && (stats.total == 8U + (98U * 9U) + 2000U),
+		"p99 bucket [896, 1023] clamped to max");
+
+	Profile_Reset();
+	Bench_ProfileFeed(11U, 50U);
+	Bench_ProfileFeed(12U, 50U);
+	Bench_Expect("Profile", Bench_ProfileIs(100U, 11U, 12U, 11U, 12U), "p50 on the edge of [10, 11]");
+	Bench_ProfileFeed(12U, 1U);
+	Bench_Expect("Profile", Bench_ProfileIs(101U, 11U, 12U, 12U, 12U), "p50 past the edge, [12, 13] clamped");
+
+	Profile_Reset();
+	Bench_ProfileFeed(UINT32_MAX, 2U);
+	Profile_GetStats(PROFILE_ID_GPIO_TOGGLE, &stats);
+	Bench_Expect("Profile", Bench_ProfileIs(2U, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX)
+		&& (stats.total == 2ULL * UINT32_MAX), "top bucket");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Samples of 100 cycles with a long tail, as a busy probe would see */
+void Bench_Profile_Record(uint32_t iterations)
+{
+	uint32_t seed = 1;
+
+	Bench_Profile_Check();
+	Profile_Init();
+	while (iterations--)
+	{
+		/* Simulated CYCCNT: 100 cycles nominal with a long exponential-ish tail */
+		seed = seed * 1664525U + 1013904223U;
+		uint32_t start = Profile_GetCycles();
+		HostSim_DWT.CYCCNT += 100U + ((seed >> 24) << ((seed >> 8) & 7U));
+		Profile_Record(PROFILE_ID_GPIO_TOGGLE, Profile_GetCycles() - start);
+	}
+}
@@ -0,0 +1,352 @@
+/**
+  ******************************************************************************
+  * @file    host_ptp.c
+  * @brief   Host checks and benchmarks of ptp.c and ptp_servo.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "eth_dma_host.h"
+#include "eth_if.h"
+#include "eth_pbuf.h"
+#include "host_test.h"
+#include "ptp.h"
+#include "ptp_servo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_PTP_EPOCH         1700000000ULL /* s, master time at the start */
+#define BENCH_PTP_DRIFT         30000   /* ppb, slave HCLK error */
+#define BENCH_PTP_DELAY         600U    /* ns, cable and PHYs, each way */
+#define BENCH_PTP_SYNC_RESIDENCE 250    /* ns, transparent clock, Sync */
+#define BENCH_PTP_REQ_RESIDENCE 125     /* ns, transparent clock, Delay_Req */
+#define BENCH_PTP_GAP           20000U  /* ns between two frames of an exchange */
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t benchPtpMaster[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x99 };
+static uint64_t benchPtpTrue;
+static uint16_t benchPtpSequence;
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Bench_PtpMessage(uint8_t *frame, uint8_t type, uint16_t sequence, uint16_t flags,
+	int64_t correction, uint64_t timestamp, int8_t logInterval, const uint8_t *requesting)
+{
+	uint32_t length = (type == PTP_MSG_ANNOUNCE) ? 64U : ((type == PTP_MSG_DELAY_RESP) ? 54U : 44U);
+	uint64_t seconds = timestamp / 1000000000ULL;
+	uint32_t nanoseconds = (uint32_t)(timestamp % 1000000000ULL);
+	uint64_t field = (uint64_t)correction << 16;
+	uint8_t *p = &frame[14];
+
+	memset(frame, 0, 14U + length);
+	frame[0] = 0x01U; frame[1] = 0x1BU; frame[2] = 0x19U;
+	memcpy(&frame[6], benchPtpMaster, sizeof(benchPtpMaster));
+	frame[12] = 0x88U;
+	frame[13] = 0xF7U;
+	p[0] = type;
+	p[1] = 2U;
+	p[3] = (uint8_t)length;
+	p[6] = (uint8_t)(flags >> 8);
+	p[7] = (uint8_t)flags;
+	for (uint32_t i = 0; i < 8U; i++)
+	{
+		p[8U + i] = (uint8_t)(field >> (56U - (8U * i)));
+	}
+	memcpy(&p[20], benchPtpMaster, 3U);
+	p[23] = 0xFFU; p[24] = 0xFEU;
+	memcpy(&p[25], &benchPtpMaster[3], 3U);
+	p[29] = 1U;
+	p[30] = (uint8_t)(sequence >> 8);
+	p[31] = (uint8_t)sequence;
+	p[33] = (uint8_t)logInterval;
+	for (uint32_t i = 0; i < 6U; i++)
+	{
+		p[34U + i] = (uint8_t)(seconds >> (40U - (8U * i)));
+	}
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		p[40U + i] = (uint8_t)(nanoseconds >> (24U - (8U * i)));
+	}
+	if (requesting != NULL)
+	{
+		memcpy(&p[44], requesting, 10U);
+	}
+	return 14U + length;
+}
+
+static int64_t Bench_PtpAbs(int64_t value)
+{
+	return (value < 0) ? -value : value;
+}
+
+static void Bench_Ptp_ParseCheck(void)
+{
+	/* Follow_Up: 1.5 ns correction, precise origin 1700000000.5 s */
+	static const uint8_t followUp[44] =
+	{
+		0x08, 0x02, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x80, 0x00,
+		0x00, 0x00, 0x00, 0x00,
+		0x00, 0x80, 0xC2, 0xFF, 0xFE, 0x12, 0x34, 0x56, 0x00, 0x01,
+		0x12, 0x34, 0x02, 0xFD,
+		0x00, 0x00, 0x65, 0x53, 0xF1, 0x00, 0x1D, 0xCD, 0x65, 0x00
+	};
+	static const uint8_t requesting[10] = { 0x02, 0x00, 0x00, 0xFF, 0xFE, 0x00, 0x00, 0x01, 0x00, 0x01 };
+	uint8_t data[sizeof(followUp)];
+	uint8_t frame[128];
+	Ptp_MessageTypeDef message;
+	uint32_t length;
+
+	Bench_Expect("Ptp", Ptp_ParseMessage(followUp, sizeof(followUp), &message) == 1U, "Follow_Up parsed");
+	Bench_Expect("Ptp", (message.type == PTP_MSG_FOLLOW_UP) && (message.length == 44U) && (message.domain == 0U)
+		&& (message.flags == 0U) && (message.correction == 1) && (message.sequenceId == 0x1234U)
+		&& (message.logInterval == -3) && (message.source.portNumber == 1U)
+		&& (message.source.clockIdentity[0] == 0x00U) && (message.source.clockIdentity[7] == 0x56U)
+		&& (message.timestamp == 1700000000500000000LL), "Follow_Up fields");
+
+	/* -1.5 ns floors to -2 */
+	memcpy(data, followUp, sizeof(data));
+	memset(&data[8], 0xFF, 6U);
+	data[13] = 0xFEU;
+	Bench_Expect("Ptp", (Ptp_ParseMessage(data, sizeof(data), &message) == 1U) && (message.correction == -2),
+		"negative correction");
+
+	Bench_Expect("Ptp", Ptp_ParseMessage(followUp, sizeof(followUp) - 1U, &message) == 0U, "truncated buffer");
+	data[1] = 0x01U;
+	Bench_Expect("Ptp", Ptp_ParseMessage(data, sizeof(data), &message) == 0U, "PTPv1 rejected");
+	memcpy(data, followUp, sizeof(data));
+	data[3] = 0x22U;
+	Bench_Expect("Ptp", Ptp_ParseMessage(data, sizeof(data), &message) == 0U, "messageLength short of the body");
+	data[0] = 0x0DU;
+	Bench_Expect("Ptp", Ptp_ParseMessage(data, sizeof(data), &message) == 1U, "other message types pass");
+
+	length = Bench_PtpMessage(frame, PTP_MSG_DELAY_RESP, 7U, 0U, -125, 1000000000123ULL, 0, requesting);
+	Bench_Expect("Ptp", (Ptp_ParseMessage(&frame[14], length - 14U, &message) == 1U)
+		&& (message.type == PTP_MSG_DELAY_RESP) && (message.sequenceId == 7U) && (message.correction == -125)
+		&& (message.timestamp == 1000000000123LL) && (message.requesting.portNumber == 1U)
+		&& (memcmp(message.requesting.clockIdentity, requesting, 8U) == 0), "Delay_Resp fields");
+	Bench_Expect("Ptp", Ptp_ParseMessage(&frame[14], length - 15U, &message) == 0U, "Delay_Resp truncated");
+}
+
+/* Offset traces from a reference clock, the ground truth known */
+static void Bench_PtpServo_Check(void)
+{
+	PtpServo_TypeDef servo;
+	int64_t offset = 3000;
+	int32_t ppb = 0;
+	uint32_t seed = 1U;
+	int64_t worst = 0;
+
+	/* Open loop: 50 ppm fast, 1 ms off: the second sample asks for a step */
+	PtpServo_Init(&servo, 0);
+	Bench_Expect("Ptp", PtpServo_Sample(&servo, 1000000, 1000000000LL, &ppb) == PTP_SERVO_UNLOCKED, "first sample stored");
+	Bench_Expect("Ptp", (PtpServo_Sample(&servo, 1050000, 2000000000LL, &ppb) == PTP_SERVO_JUMP) && (ppb == -50000),
+		"drift estimate and step");
+	Bench_Expect("Ptp", PtpServo_Sample(&servo, 25000, 3000000000LL, &ppb) == PTP_SERVO_UNLOCKED,
+		"locked servo past the step threshold restarts");
+
+	/* 2 ppm slow from a close start: no step, the estimate is kept */
+	PtpServo_Init(&servo, -3);
+	PtpServo_Sample(&servo, 100, 0, &ppb);
+	Bench_Expect("Ptp", (PtpServo_Sample(&servo, -150, 125000000LL, &ppb) == PTP_SERVO_LOCKED) && (ppb == 2000),
+		"small offset locks at once");
+	PtpServo_Reset(&servo);
+	Bench_Expect("Ptp", (servo.drift == (-2000LL << 16)) && (servo.count == 0U), "reset keeps the drift");
+
+	/* Closed loop, 8 samples/s: 25 ppm fast oscillator, +-40 ns measurement noise */
+	PtpServo_Init(&servo, -3);
+	ppb = 0;
+	for (uint32_t k = 0; k < 800U; k++)
+	{
+		int64_t measured;
+
+		seed = seed * 1664525U + 1013904223U;
+		measured = offset + (int64_t)(seed >> 24) * 80 / 255 - 40;
+		switch (PtpServo_Sample(&servo, measured, (int64_t)k * 125000000LL, &ppb))
+		{
+		case PTP_SERVO_JUMP:
+			offset -= measured;
+			break;
+		default:
+			break;
+		}
+		if ((k >= 400U) && (Bench_PtpAbs(offset) > worst))
+		{
+			worst = Bench_PtpAbs(offset);
+		}
+		offset += (25000 + (int64_t)ppb) / 8;
+	}
+	Bench_Expect("Ptp", (servo.state == PTP_SERVO_LOCKED) && (worst < 120), "closed loop offset");
+	Bench_Expect("Ptp", (ppb > -25100) && (ppb < -24900), "closed loop frequency");
+}
+
+/* The bench master: true time since the start plus the epoch */
+static uint64_t Bench_PtpMasterTime(void)
+{
+	return (BENCH_PTP_EPOCH * 1000000000ULL) + benchPtpTrue;
+}
+
+static void Bench_PtpAdvance(uint32_t ns)
+{
+	benchPtpTrue += ns;
+	HostEthDma_PtpAdvance(ns);
+}
+
+static void Bench_PtpDeliver(const uint8_t *frame, uint32_t length)
+{
+	Bench_Expect("Ptp", HostEthDma_Receive(frame, length) == 1U, "PTP frame received");
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+	EthIf_Poll(ETH_IF_POLL_BUDGET);
+}
+
+/* Two-step Sync/Follow_Up, then the Delay_Req/Delay_Resp it triggers; a
+   transparent clock adds residence times to both directions */
+static void Bench_PtpExchange(uint32_t period, int8_t logInterval)
+{
+	static uint8_t frame[128];
+	uint64_t start = benchPtpTrue;
+	uint32_t captured;
+	uint64_t t1;
+	uint32_t length;
+
+	benchPtpSequence++;
+	t1 = Bench_PtpMasterTime();
+	length = Bench_PtpMessage(frame, PTP_MSG_SYNC, benchPtpSequence, PTP_FLAG_TWO_STEP,
+		BENCH_PTP_SYNC_RESIDENCE, 0U, logInterval, NULL);
+	Bench_PtpAdvance(BENCH_PTP_DELAY + BENCH_PTP_SYNC_RESIDENCE);
+	Bench_PtpDeliver(frame, length);
+
+	length = Bench_PtpMessage(frame, PTP_MSG_FOLLOW_UP, benchPtpSequence, 0U, 0, t1, logInterval, NULL);
+	Bench_PtpAdvance(BENCH_PTP_GAP);
+	captured = benchEthCaptured;
+	Bench_PtpDeliver(frame, length);
+
+	Bench_PtpAdvance(BENCH_PTP_GAP);
+	HostEthDma_Transmit();
+	if (benchEthCaptured != captured)
+	{
+		const uint8_t *request = &benchEthCapture[captured % BENCH_ETH_CAPTURE][14];
+		uint64_t t4;
+
+		Bench_Expect("Ptp", (benchEthCaptureLength[captured % BENCH_ETH_CAPTURE] == 14U + PTP_DELAY_REQ_SIZE)
+			&& (request[-2] == 0x88U) && (request[0] == PTP_MSG_DELAY_REQ), "Delay_Req sent");
+		Bench_PtpAdvance(BENCH_PTP_DELAY + BENCH_PTP_REQ_RESIDENCE);
+		t4 = Bench_PtpMasterTime();
+		Bench_PtpAdvance(BENCH_PTP_GAP);
+		length = Bench_PtpMessage(frame, PTP_MSG_DELAY_RESP, (uint16_t)((request[30] << 8) | request[31]), 0U,
+			BENCH_PTP_REQ_RESIDENCE, t4, logInterval, &request[20]);
+		Bench_PtpDeliver(frame, length);
+	}
+	Bench_PtpAdvance(period - (uint32_t)(benchPtpTrue - start));
+}
+
+static void Bench_PtpAnnounce(void)
+{
+	static uint8_t frame[128];
+
+	Bench_PtpDeliver(frame, Bench_PtpMessage(frame, PTP_MSG_ANNOUNCE, benchPtpSequence, 0U, 0, 0U, 1, NULL));
+}
+
+/* The slave as main.c starts it, HCLK BENCH_PTP_DRIFT off */
+static void Bench_PtpStart(void)
+{
+	SystemCoreClock = 216000000U;
+	HostEthDma_PtpSetDrift(BENCH_PTP_DRIFT);
+	Bench_EthIfStart();
+	benchPtpTrue = 0U;
+	benchPtpSequence = 0U;
+	Bench_Expect("Ptp", Ptp_Init() == HAL_OK, "Ptp_Init");
+	benchPtpActive = 1U;
+}
+
+static void Bench_PtpStop(void)
+{
+	benchPtpActive = 0U;
+	HostEthDma_SetAddressFilter(0U);
+	HostEthDma_PtpSetDrift(0);
+	SystemCoreClock = 16000000U;
+}
+
+static void Bench_Ptp_Check(void)
+{
+	Ptp_StatsTypeDef stats;
+	int64_t error;
+	uint32_t k;
+
+	Bench_PtpServo_Check();
+	Bench_Ptp_ParseCheck();
+
+	Bench_PtpStart();
+	HostEthDma_SetAddressFilter(1U);
+	Bench_Expect("Ptp", ((ETH->MACFFR & ETH_MACFFR_PAM) == 0U) && (ETH->MACA1HR == ETH_MACA1HR_AE)
+		&& (ETH->MACA1LR == 0x00191B01U), "PTP group address in a perfect filter slot");
+	Bench_Expect("Ptp", (ETH->PTPTSCR & (ETH_PTPTSCR_TSE | ETH_PTPTSCR_TSFCU | ETH_PTPTSCR_TSSSR)) ==
+		(ETH_PTPTSCR_TSE | ETH_PTPTSCR_TSFCU | ETH_PTPTSCR_TSSSR), "time stamp unit running");
+
+	/* No master yet: Sync ignored, nothing sent */
+	Bench_PtpExchange(1000000000U, 0);
+	Ptp_GetStats(&stats);
+	Bench_Expect("Ptp", (stats.state == PTP_STATE_LISTENING) && (stats.syncs == 0U) && (stats.delayReqs == 0U)
+		&& (stats.ignored == 2U), "no master");
+
+	/* 1700000000 s apart and 30 ppm: one step, then the PI loop */
+	for (k = 1U; k <= 60U; k++)
+	{
+		Bench_PtpAnnounce();
+		Bench_PtpExchange(1000000000U, 0);
+		Ptp_Tick(k * 1000U);
+	}
+	Ptp_GetStats(&stats);
+	error = Ptp_GetTime() - (int64_t)Bench_PtpMasterTime();
+	Bench_Expect("Ptp", (stats.state == PTP_STATE_SLAVE) && (stats.steps == 1U), "locked after one step");
+	Bench_Expect("Ptp", (stats.syncs == 60U) && (stats.followUps == 60U) && (stats.delayResps == stats.delayReqs)
+		&& (stats.txTimestampMissing == 0U) && (stats.announces == 60U), "message counts");
+	Bench_Expect("Ptp", (stats.pathDelay >= (int64_t)BENCH_PTP_DELAY - 10) && (stats.pathDelay <= (int64_t)BENCH_PTP_DELAY + 10),
+		"path delay");
+	Bench_Expect("Ptp", (Bench_PtpAbs(stats.offset) < 50) && (Bench_PtpAbs(error) < 100), "offset from the master");
+	Bench_Expect("Ptp", (stats.ppb > -BENCH_PTP_DRIFT - 50) && (stats.ppb < -BENCH_PTP_DRIFT + 50), "frequency");
+	Bench_Expect("Ptp", (stats.samples == 58U) && (stats.offsetMin <= stats.offsetMean)
+		&& (stats.offsetMean <= stats.offsetMax), "offset statistics");
+
+	Ptp_ClearStats();
+	Ptp_GetStats(&stats);
+	Bench_Expect("Ptp", (stats.samples == 0U) && (stats.offsetRms == 0U) && (stats.syncs == 60U), "statistics cleared");
+
+	/* Announce receipt timeout: 3 intervals of 2 s, the last Announce a tick ago */
+	Ptp_Tick((k - 1U) * 1000U + 5000U);
+	Ptp_GetStats(&stats);
+	Bench_Expect("Ptp", stats.state == PTP_STATE_SLAVE, "master kept within the timeout");
+	Ptp_Tick((k - 1U) * 1000U + 6000U);
+	Ptp_GetStats(&stats);
+	Bench_Expect("Ptp", stats.state == PTP_STATE_LISTENING, "master dropped");
+
+	HostEthDma_Interrupt(EthIf_IRQHandler);
+	EthIf_Poll(ETH_IF_POLL_BUDGET);
+	Bench_Expect("Ptp", EthPbuf_GetFree() == ETH_PBUF_COUNT - ETH_RX_DESC_CNT, "PTP pbufs released");
+	Bench_PtpStop();
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_Ptp_Exchange(uint32_t iterations)
+{
+	Ptp_StatsTypeDef stats;
+
+	Bench_Ptp_Check();
+
+	/* Locked at 8 Sync/s, then one iteration per frame of the exchange */
+	Bench_PtpStart();
+	Bench_PtpAnnounce();
+	for (uint32_t k = 0; k < 160U; k++)
+	{
+		Bench_PtpExchange(125000000U, -3);
+	}
+	Ptp_ClearStats();
+	for (uint32_t k = 0; k < (iterations + 3U) / 4U; k++)
+	{
+		Bench_PtpExchange(125000000U, -3);
+	}
+	Ptp_GetStats(&stats);
+	Bench_Expect("Ptp", (stats.state == PTP_STATE_SLAVE) && (stats.steps == 1U) && (stats.jitter < 20U)
+		&& (Bench_PtpAbs(stats.offsetMean) < 20), "bench locked");
+	Bench_PtpStop();
+}
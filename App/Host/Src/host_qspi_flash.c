@@ -0,0 +1,274 @@
+/**
+  ******************************************************************************
+  * @file    host_qspi_flash.c
+  * @brief   Host checks and benchmarks of qspi_flash.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "host_test.h"
+#include "qspi_flash.h"
+
+/* Private variables ---------------------------------------------------------*/
+/* N25Q128A, JESD216: 16 MB, 3-byte, DTR, 1-4-4 EBh (1 mode, 9 dummy clocks),
+   1-1-4 6Bh, 4 KB 20h and 64 KB D8h erase */
+static const uint32_t benchQspiBfptA[9] =
+{
+	0xFFF92001U, 0x07FFFFFFU, 0x6B08EB29U, 0xBB423B08U, 0xFFFFFFEEU,
+	0xFFFF0000U, 0xFFFF0000U, 0xD810200CU, 0x00000000U
+};
+
+/* MX25L51245G, JESD216B: 64 MB, 3 or 4-byte entered by B7h, 1-4-4 EBh
+   (2 mode, 4 dummy clocks), 4/32/64 KB erase, QE in SR1 bit 6 */
+static const uint32_t benchQspiBfptB[16] =
+{
+	0xFFF320E5U, 0x1FFFFFFFU, 0x6B08EB44U, 0xBB043B08U, 0xFFFFFFEEU,
+	0xFFFF0000U, 0xFFFF0000U, 0x520F200CU, 0x0000D810U, 0x00FF8224U,
+	0xF5F64081U, 0x38A5A2EDU, 0xB03000EBU, 0xFF7C9300U, 0xFFA2F27AU,
+	0x21C07C3FU
+};
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_QspiPut32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+/* SFDP header: signature, revision 1.minor, headers - 1, access protocol */
+static void Bench_QspiSignature(uint8_t *sfdp, uint32_t minor, uint32_t headers)
+{
+	memset(sfdp, 0xFF, QSPI_FLASH_SFDP_SIZE);
+	Bench_QspiPut32(&sfdp[0], 0x50444653U);
+	sfdp[4] = (uint8_t)minor;
+	sfdp[5] = 1U;
+	sfdp[6] = (uint8_t)(headers - 1U);
+	sfdp[7] = 0xFFU;
+}
+
+static void Bench_QspiHeader(uint8_t *sfdp, uint32_t index, uint32_t id, uint32_t revision, uint32_t dwords,
+		uint32_t pointer)
+{
+	uint8_t *header = &sfdp[8U * (index + 1U)];
+
+	header[0] = (uint8_t)id;
+	header[1] = (uint8_t)revision;
+	header[2] = (uint8_t)(revision >> 8);
+	header[3] = (uint8_t)dwords;
+	Bench_QspiPut32(&header[4], pointer);
+	header[7] = (uint8_t)(id >> 8);
+}
+
+static void Bench_QspiTable(uint8_t *sfdp, uint32_t pointer, const uint32_t *dword, uint32_t dwords)
+{
+	for (uint32_t i = 0; i < dwords; i++)
+	{
+		Bench_QspiPut32(&sfdp[pointer + (4U * i)], dword[i]);
+	}
+}
+
+static void Bench_QspiImageA(uint8_t *sfdp)
+{
+	Bench_QspiSignature(sfdp, 0U, 1U);
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0100U, 9U, 0x30U);
+	Bench_QspiTable(sfdp, 0x30U, benchQspiBfptA, 9U);
+}
+
+/* Basic table, 4-byte address instruction table and a vendor table */
+static void Bench_QspiImageB(uint8_t *sfdp)
+{
+	static const uint32_t fourByte[2] = { 0xFFFFFFFFU, 0xFFFFFFFFU };
+	static const uint32_t vendor[1] = { 0x12345678U };
+
+	Bench_QspiSignature(sfdp, 6U, 3U);
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0106U, 16U, 0x30U);
+	Bench_QspiHeader(sfdp, 1U, 0xFF84U, 0x0100U, 2U, 0x70U);
+	Bench_QspiHeader(sfdp, 2U, 0x00C2U, 0x0100U, 1U, 0x78U);
+	Bench_QspiTable(sfdp, 0x30U, benchQspiBfptB, 16U);
+	Bench_QspiTable(sfdp, 0x70U, fourByte, 2U);
+	Bench_QspiTable(sfdp, 0x78U, vendor, 1U);
+}
+
+/* QspiFlash_ParseSfdp() on the tables of two parts and broken ones, and
+   QspiFlash_CalcRead() against the settings worked out by hand */
+static void Bench_QspiFlash_Check(void)
+{
+	uint8_t sfdp[QSPI_FLASH_SFDP_SIZE];
+	uint32_t bfpt[16];
+	QspiFlash_SfdpTypeDef info;
+	QspiFlash_SfdpTypeDef infoB;
+	QspiFlash_ReadTypeDef read;
+	QspiFlash_ConfigTypeDef config;
+
+	Bench_QspiImageA(sfdp);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK, "N25Q128A table");
+	Bench_Expect("QspiFlash", (info.revision == 0x0100U) && (info.size == (16U * 1024U * 1024U)) && (info.pageSize == 256U)
+		&& (info.eraseSize == 4096U) && (info.eraseOpcode == 0x20U), "N25Q128A geometry");
+	Bench_Expect("QspiFlash", (info.addressBytes == QSPI_FLASH_ADDRESS_3) && (info.enter4Byte == QSPI_FLASH_ENTER4_NONE)
+		&& (info.quadEnable == 0U) && (info.dtr == 1U), "N25Q128A address, QE, DTR");
+	Bench_Expect("QspiFlash", (info.read144Opcode == 0xEBU) && (info.read144ModeClocks == 1U) && (info.read144DummyClocks == 9U)
+		&& (info.read114Opcode == 0x6BU) && (info.read114ModeClocks == 0U) && (info.read114DummyClocks == 8U),
+		"N25Q128A fast reads");
+
+	/* 216 MHz: quad I/O DTR at 54 MHz, else quad I/O SDR at 108 MHz with the
+	   odd mode clock counted as a dummy one */
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&qspiFlashN25q128a, &info, 216000000U, &read) == HAL_OK, "N25Q128A DTR");
+	Bench_Expect("QspiFlash", (read.init.ClockPrescaler == 3U) && (read.clockHz == 54000000U)
+		&& (read.init.SampleShifting == QSPI_SAMPLE_SHIFTING_NONE) && (read.init.FlashSize == 23U)
+		&& (read.init.ChipSelectHighTime == QSPI_CS_HIGH_TIME_3_CYCLE) && (read.size == (16U * 1024U * 1024U)),
+		"N25Q128A DTR controller");
+	Bench_Expect("QspiFlash", (read.command.Instruction == 0xEDU) && (read.command.DummyCycles == 8U)
+		&& (read.command.DdrMode == QSPI_DDR_MODE_ENABLE) && (read.command.AddressMode == QSPI_ADDRESS_4_LINES)
+		&& (read.command.AddressSize == QSPI_ADDRESS_24_BITS) && (read.command.DataMode == QSPI_DATA_4_LINES)
+		&& (read.enter4Byte == QSPI_FLASH_ENTER4_NONE), "N25Q128A DTR command");
+	config = qspiFlashN25q128a;
+	config.dtrOpcode = 0U;
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&config, &info, 216000000U, &read) == HAL_OK, "N25Q128A SDR");
+	Bench_Expect("QspiFlash", (read.init.ClockPrescaler == 1U) && (read.clockHz == 108000000U)
+		&& (read.init.SampleShifting == QSPI_SAMPLE_SHIFTING_HALFCYCLE)
+		&& (read.init.ChipSelectHighTime == QSPI_CS_HIGH_TIME_6_CYCLE), "N25Q128A SDR controller");
+	Bench_Expect("QspiFlash", (read.command.Instruction == 0xEBU) && (read.command.DummyCycles == 10U)
+		&& (read.command.AlternateByteMode == QSPI_ALTERNATE_BYTES_NONE)
+		&& (read.command.DdrMode == QSPI_DDR_MODE_DISABLE), "N25Q128A SDR command");
+	info.read144Opcode = 0U;
+	Bench_Expect("QspiFlash", (QspiFlash_CalcRead(&config, &info, 216000000U, &read) == HAL_OK)
+		&& (read.command.Instruction == 0x6BU) && (read.command.AddressMode == QSPI_ADDRESS_1_LINE)
+		&& (read.command.DummyCycles == 8U), "quad output fallback");
+	info.read114Opcode = 0U;
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&config, &info, 216000000U, &read) != HAL_OK, "no quad read");
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&qspiFlashN25q128a, &info, 216000000U, &read) == HAL_OK, "DTR needs no SDR read");
+	config = qspiFlashN25q128a;
+	config.maxClockHz = 800000U;
+	config.dtrOpcode = 0U;
+	(void)QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info);
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&config, &info, 216000000U, &read) != HAL_OK, "divider over 256");
+	config.maxClockHz = 108000000U;
+	config.csHighNs = 200U;
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&config, &info, 216000000U, &read) != HAL_OK, "chip select high over 8 clocks");
+	config.csHighNs = 1U;
+	Bench_Expect("QspiFlash", (QspiFlash_CalcRead(&config, &info, 216000000U, &read) == HAL_OK)
+		&& (read.init.ChipSelectHighTime == QSPI_CS_HIGH_TIME_1_CYCLE), "chip select high of 1 clock at least");
+	info.read144DummyClocks = 31U;
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&config, &info, 216000000U, &read) != HAL_OK, "dummy clocks over 31");
+
+	/* MX25L51245G at 216 MHz: 72 MHz, 4-byte addressing entered by B7h, the
+	   2 mode clocks one alternate byte */
+	Bench_QspiImageB(sfdp);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &infoB) == HAL_OK, "MX25L51245G table");
+	Bench_Expect("QspiFlash", (infoB.revision == 0x0106U) && (infoB.size == (64U * 1024U * 1024U)) && (infoB.pageSize == 256U)
+		&& (infoB.eraseSize == 4096U) && (infoB.eraseOpcode == 0x20U), "MX25L51245G geometry");
+	Bench_Expect("QspiFlash", (infoB.addressBytes == QSPI_FLASH_ADDRESS_3_OR_4) && (infoB.enter4Byte == QSPI_FLASH_ENTER4_B7)
+		&& (infoB.quadEnable == 2U) && (infoB.dtr == 0U), "MX25L51245G address, QE, DTR");
+	Bench_Expect("QspiFlash", (infoB.read144Opcode == 0xEBU) && (infoB.read144ModeClocks == 2U)
+		&& (infoB.read144DummyClocks == 4U), "MX25L51245G fast read");
+	Bench_Expect("QspiFlash", QspiFlash_CalcRead(&qspiFlashMx25l51245g, &infoB, 216000000U, &read) == HAL_OK, "MX25L51245G read");
+	Bench_Expect("QspiFlash", (read.init.ClockPrescaler == 2U) && (read.clockHz == 72000000U) && (read.init.FlashSize == 25U)
+		&& (read.init.ChipSelectHighTime == QSPI_CS_HIGH_TIME_3_CYCLE) && (read.size == (64U * 1024U * 1024U))
+		&& (read.enter4Byte == QSPI_FLASH_ENTER4_B7), "MX25L51245G controller");
+	Bench_Expect("QspiFlash", (read.command.Instruction == 0xEBU) && (read.command.AddressSize == QSPI_ADDRESS_32_BITS)
+		&& (read.command.AlternateByteMode == QSPI_ALTERNATE_BYTES_4_LINES)
+		&& (read.command.AlternateBytesSize == QSPI_ALTERNATE_BYTES_8_BITS) && (read.command.AlternateBytes == 0xFFU)
+		&& (read.command.DummyCycles == 4U), "MX25L51245G command");
+	/* A DTR command of the config is not used when the part has no DTR */
+	Bench_Expect("QspiFlash", (QspiFlash_CalcRead(&qspiFlashN25q128a, &infoB, 216000000U, &read) == HAL_OK)
+		&& (read.command.DdrMode == QSPI_DDR_MODE_DISABLE) && (read.command.Instruction == 0xEBU), "no DTR in the part");
+	infoB.read144ModeClocks = 3U;
+	Bench_Expect("QspiFlash", (QspiFlash_CalcRead(&qspiFlashMx25l51245g, &infoB, 216000000U, &read) == HAL_OK)
+		&& (read.command.AlternateByteMode == QSPI_ALTERNATE_BYTES_NONE) && (read.command.DummyCycles == 7U),
+		"odd mode clocks as dummy ones");
+
+	/* Before DWORD16 a 3 or 4-byte part enters 4-byte mode after a write enable */
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0105U, 15U, 0x30U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK)
+		&& (info.enter4Byte == QSPI_FLASH_ENTER4_WREN_B7) && (info.quadEnable == 2U), "15-DWORD table");
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0100U, 9U, 0x30U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK) && (info.pageSize == 256U)
+		&& (info.quadEnable == 0U) && (info.enter4Byte == QSPI_FLASH_ENTER4_WREN_B7), "JESD216 defaults");
+	/* No entry method: only the first 16 MB are mapped */
+	memcpy(bfpt, benchQspiBfptB, sizeof(bfpt));
+	bfpt[15] = 0x00C07C3FU;
+	Bench_QspiImageB(sfdp);
+	Bench_QspiTable(sfdp, 0x30U, bfpt, 16U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK)
+		&& (info.enter4Byte == QSPI_FLASH_ENTER4_NONE), "no 4-byte entry");
+	Bench_Expect("QspiFlash", (QspiFlash_CalcRead(&qspiFlashMx25l51245g, &info, 216000000U, &read) == HAL_OK)
+		&& (read.size == (16U * 1024U * 1024U)) && (read.init.FlashSize == 23U)
+		&& (read.command.AddressSize == QSPI_ADDRESS_24_BITS), "3-byte part above 16 MB");
+
+	/* Of two basic tables the later revision, wherever its header */
+	Bench_QspiImageB(sfdp);
+	sfdp[6] = 3U;
+	Bench_QspiHeader(sfdp, 3U, 0xFF00U, 0x0100U, 9U, 0x80U);
+	Bench_QspiTable(sfdp, 0x80U, benchQspiBfptA, 9U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK) && (info.revision == 0x0106U)
+		&& (info.size == (64U * 1024U * 1024U)), "later basic table");
+	Bench_QspiHeader(sfdp, 3U, 0xFF00U, 0x0200U, 9U, 0x80U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK) && (info.revision == 0x0106U),
+		"basic table of major revision 2 ignored");
+
+	/* 2^N bits density, DWORD1 4 KB erase when DWORD8-9 are empty */
+	memcpy(bfpt, benchQspiBfptA, sizeof(benchQspiBfptA));
+	bfpt[1] = 0x8000001DU;
+	bfpt[7] = 0U;
+	Bench_QspiImageA(sfdp);
+	Bench_QspiTable(sfdp, 0x30U, bfpt, 9U);
+	Bench_Expect("QspiFlash", (QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK)
+		&& (info.size == (64U * 1024U * 1024U)) && (info.eraseSize == 4096U) && (info.eraseOpcode == 0x20U),
+		"2^N density, DWORD1 erase");
+	bfpt[1] = 0x80000023U;
+	Bench_QspiTable(sfdp, 0x30U, bfpt, 9U);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "density over 2^34 bits");
+	bfpt[1] = 0x07FFFFFEU;
+	Bench_QspiTable(sfdp, 0x30U, bfpt, 9U);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "density not in bytes");
+	bfpt[1] = benchQspiBfptA[1];
+	bfpt[0] |= 0x3U << 17;
+	Bench_QspiTable(sfdp, 0x30U, bfpt, 9U);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "reserved address bytes");
+
+	/* Broken images */
+	Bench_QspiImageA(sfdp);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, 0x30U + 36U, &info) == HAL_OK, "table up to the end");
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, 0x30U + 35U, &info) != HAL_OK, "table beyond the end");
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, 15U, &info) != HAL_OK, "truncated header");
+	sfdp[5] = 2U;
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "SFDP major revision 2");
+	Bench_QspiImageA(sfdp);
+	sfdp[0] = 'X';
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "signature");
+	Bench_QspiImageA(sfdp);
+	Bench_QspiHeader(sfdp, 0U, 0xFF84U, 0x0100U, 9U, 0x30U);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "no basic table");
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0100U, 8U, 0x30U);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "basic table under 9 DWORDs");
+	Bench_QspiHeader(sfdp, 0U, 0xFF00U, 0x0100U, 9U, 0xFFFFFCU);
+	Bench_Expect("QspiFlash", QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) != HAL_OK, "pointer out of the image");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* What QspiFlash_Init() does between reading the tables and programming the
+   controller, at every HCLK of the range */
+void Bench_QspiFlash_ParseSfdp(uint32_t iterations)
+{
+	uint8_t sfdp[QSPI_FLASH_SFDP_SIZE];
+	QspiFlash_SfdpTypeDef info;
+	QspiFlash_ReadTypeDef read;
+	uint32_t sum = 0;
+
+	Bench_QspiFlash_Check();
+
+	Bench_QspiImageB(sfdp);
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		if ((QspiFlash_ParseSfdp(sfdp, sizeof(sfdp), &info) == HAL_OK)
+				&& (QspiFlash_CalcRead(&qspiFlashMx25l51245g, &info, 100000000U + ((i % 117U) * 1000000U), &read) == HAL_OK))
+		{
+			sum += read.init.ClockPrescaler;
+		}
+	}
+	__asm__ volatile ("" : : "r" (sum));
+}
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    host_ring_buffer.c
+  * @brief   Host checks and benchmarks of ring_buffer.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+
+#include "ring_buffer.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_RING_SIZE         1024U
+
+/* Private variables ---------------------------------------------------------*/
+static RingBuffer_TypeDef benchRing;
+static uint8_t benchRingStorage[BENCH_RING_SIZE];
+
+/* Private functions ---------------------------------------------------------*/
+static void *Bench_RingProducer(void *arg)
+{
+	uint32_t total = *(const uint32_t *)arg;
+	uint32_t sent = 0;
+	uint8_t chunk[97];
+
+	while (sent < total)
+	{
+		uint32_t length = 1U + (sent % sizeof(chunk));
+		if (length > total - sent)
+		{
+			length = total - sent;
+		}
+		for (uint32_t i = 0; i < length; i++)
+		{
+			chunk[i] = (uint8_t)((sent + i) % 251U);
+		}
+
+		uint32_t done = 0;
+		while (done < length)
+		{
+			uint32_t written = RingBuffer_Write(&benchRing, &chunk[done], length - done);
+			if (written == 0U)
+			{
+				/* Ring full: let the consumer run on single-CPU hosts */
+				sched_yield();
+			}
+			done += written;
+		}
+		sent += length;
+	}
+	return NULL;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* A producer thread against the consumer, copy and zero-copy reads
+   alternating; iterations counts bytes */
+void Bench_RingBuffer_Spsc(uint32_t iterations)
+{
+	pthread_t producer;
+	uint32_t received = 0;
+	uint8_t chunk[61];
+
+	RingBuffer_Init(&benchRing, benchRingStorage, sizeof(benchRingStorage));
+	pthread_create(&producer, NULL, Bench_RingProducer, &iterations);
+
+	/* Consumer alternates copy reads and zero-copy block reads */
+	while (received < iterations)
+	{
+		uint8_t *block;
+		uint32_t length;
+
+		if ((received & 1U) != 0U)
+		{
+			length = RingBuffer_GetReadBlock(&benchRing, &block);
+		}
+		else
+		{
+			length = RingBuffer_Read(&benchRing, chunk, sizeof(chunk));
+			block = chunk;
+		}
+
+		for (uint32_t i = 0; i < length; i++)
+		{
+			Bench_Expect("RingBuffer", block[i] == (uint8_t)((received + i) % 251U), "bytes in order");
+		}
+		if (block != chunk)
+		{
+			RingBuffer_Consume(&benchRing, length);
+		}
+		if (length == 0U)
+		{
+			sched_yield();
+		}
+		received += length;
+	}
+
+	pthread_join(producer, NULL);
+}
@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file    host_sdram.c
+  * @brief   Host checks and benchmarks of sdram.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mem_heap.h"
+#include "sdram.h"
+
+/* Private functions ---------------------------------------------------------*/
+/* Sdram_CalcTiming() against the clocks worked out from the datasheets by
+   hand, its limits, and the registers Sdram_Init() leaves behind */
+static void Bench_Sdram_Check(void)
+{
+	Sdram_TimingTypeDef timing;
+	Sdram_ConfigTypeDef config;
+	MemHeap_StatsTypeDef heapStats;
+	uint32_t coreClock = SystemCoreClock;
+	uint8_t *buffer;
+
+	/* MT48LC4M32B2 at 216 MHz: SDCLK 108 MHz, tWR stretched to tRAS - tRCD */
+	Bench_Expect("Sdram", Sdram_CalcTiming(&sdramMt48lc4m32b2, 216000000U, &timing) == HAL_OK, "MT48LC4M32B2 216 MHz");
+	Bench_Expect("Sdram", (timing.clockHz == 108000000U) && (timing.init.SDClockPeriod == FMC_SDRAM_CLOCK_PERIOD_2),
+		"SDCLK 108 MHz");
+	Bench_Expect("Sdram", (timing.timing.LoadToActiveDelay == 2U) && (timing.timing.ExitSelfRefreshDelay == 8U)
+		&& (timing.timing.SelfRefreshTime == 5U) && (timing.timing.RowCycleDelay == 7U)
+		&& (timing.timing.WriteRecoveryTime == 3U) && (timing.timing.RPDelay == 2U)
+		&& (timing.timing.RCDDelay == 2U), "108 MHz delays");
+	Bench_Expect("Sdram", (timing.refreshCount == 1667U) && (timing.modeRegister == 0x230U)
+		&& (timing.size == (8U * 1024U * 1024U)), "108 MHz refresh, mode, size");
+
+	/* At 200 MHz: SDCLK 100 MHz */
+	Bench_Expect("Sdram", (Sdram_CalcTiming(&sdramMt48lc4m32b2, 200000000U, &timing) == HAL_OK)
+		&& (timing.clockHz == 100000000U) && (timing.timing.SelfRefreshTime == 5U)
+		&& (timing.timing.RowCycleDelay == 6U) && (timing.timing.WriteRecoveryTime == 3U)
+		&& (timing.timing.ExitSelfRefreshDelay == 7U) && (timing.refreshCount == 1542U), "100 MHz");
+
+	/* A CAS latency 2 grade limited to 100 MHz: HCLK/3, tWR stretched to tRAS - tRCD */
+	config = sdramMt48lc4m32b2;
+	config.casLatency = 2U;
+	config.maxClockHz = 100000000U;
+	Bench_Expect("Sdram", (Sdram_CalcTiming(&config, 216000000U, &timing) == HAL_OK)
+		&& (timing.init.SDClockPeriod == FMC_SDRAM_CLOCK_PERIOD_3) && (timing.clockHz == 72000000U)
+		&& (timing.timing.SelfRefreshTime == 4U) && (timing.timing.RowCycleDelay == 5U)
+		&& (timing.timing.WriteRecoveryTime == 2U) && (timing.timing.ExitSelfRefreshDelay == 6U)
+		&& (timing.timing.RCDDelay == 2U) && (timing.timing.RPDelay == 2U)
+		&& (timing.refreshCount == 1105U) && (timing.modeRegister == 0x220U), "CL2 72 MHz");
+
+	Bench_Expect("Sdram", (Sdram_CalcTiming(&sdramIs42s32800g, 216000000U, &timing) == HAL_OK)
+		&& (timing.size == (16U * 1024U * 1024U)), "IS42S32800G size");
+	Bench_Expect("Sdram", (Sdram_CalcTiming(&sdramIs42s16400j, 216000000U, &timing) == HAL_OK)
+		&& (timing.timing.RowCycleDelay == 7U) && (timing.timing.WriteRecoveryTime == 3U), "IS42S16400J");
+
+	/* What the controller cannot do */
+	config = sdramMt48lc4m32b2;
+	config.maxClockHz = 50000000U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "SDCLK above the part");
+	config = sdramMt48lc4m32b2;
+	config.tXSR = 200U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "delay over 16 clocks");
+	config = sdramMt48lc4m32b2;
+	config.refreshRows = 512U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "refresh count over 13 bits");
+	Bench_Expect("Sdram", Sdram_CalcTiming(&sdramMt48lc4m32b2, 6000000U, &timing) != HAL_OK, "refresh count under 41");
+	Bench_Expect("Sdram", (Sdram_CalcTiming(&sdramMt48lc4m32b2, 8000000U, &timing) == HAL_OK)
+		&& (timing.refreshCount == 42U), "refresh count at 8 MHz");
+	config = sdramMt48lc4m32b2;
+	config.rowBits = 14U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "row bits");
+	config = sdramMt48lc4m32b2;
+	config.busWidth = 24U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "bus width");
+	config = sdramMt48lc4m32b2;
+	config.autoRefreshes = 0U;
+	Bench_Expect("Sdram", Sdram_CalcTiming(&config, 216000000U, &timing) != HAL_OK, "auto refreshes");
+
+	/* The registers, the last command, the heap over the simulated part */
+	HostSim_Reset();
+	SystemCoreClock = 216000000U;
+	Bench_Expect("Sdram", Sdram_Init(&sdramMt48lc4m32b2) == HAL_OK, "init");
+	SystemCoreClock = coreClock;
+	Bench_Expect("Sdram", (RCC->AHB3ENR & RCC_AHB3ENR_FMCEN) != 0U, "FMC clock");
+	Bench_Expect("Sdram", (FMC_Bank5_6->SDCR[0] == 0x19D4U) && (FMC_Bank5_6->SDTR[0] == 0x01126471U), "SDCR1, SDTR1");
+	Bench_Expect("Sdram", FMC_Bank5_6->SDRTR == (1667U << 1), "SDRTR");
+	Bench_Expect("Sdram", FMC_Bank5_6->SDCMR == (FMC_SDRAM_CMD_LOAD_MODE | FMC_SDRAM_CMD_TARGET_BANK1
+		| (0x230U << FMC_SDCMR_MRD_Pos)), "load mode register last");
+	Sdram_GetHeapStats(&heapStats);
+	Bench_Expect("Sdram", heapStats.size == HOST_SIM_SDRAM_SIZE, "heap over the whole part");
+	buffer = Sdram_Alloc(1024U * 1024U);
+	Bench_Expect("Sdram", (buffer != NULL) && (buffer >= HostSim_SDRAM)
+		&& ((buffer + (1024U * 1024U)) <= (HostSim_SDRAM + HOST_SIM_SDRAM_SIZE))
+		&& (((uintptr_t)buffer % MEM_HEAP_ALIGN) == 0U), "alloc in the part");
+	memset(buffer, 0x5A, 1024U * 1024U);
+	Sdram_Free(buffer);
+	Sdram_GetHeapStats(&heapStats);
+	Bench_Expect("Sdram", (heapStats.freeBlocks == 1U) && (heapStats.freeBytes == HOST_SIM_SDRAM_SIZE)
+		&& (heapStats.allocs == 1U) && (heapStats.frees == 1U), "free");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* The controller registers for an HCLK swept over its range */
+void Bench_Sdram_CalcTiming(uint32_t iterations)
+{
+	Sdram_TimingTypeDef timing;
+	uint32_t sum = 0;
+
+	Bench_Sdram_Check();
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		if (Sdram_CalcTiming(&sdramMt48lc4m32b2, 100000000U + ((i % 117U) * 1000000U), &timing) == HAL_OK)
+		{
+			sum += timing.refreshCount;
+		}
+	}
+	__asm__ volatile ("" : : "r" (sum));
+}
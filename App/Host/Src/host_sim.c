@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    host_sim.c
+  * @brief   Register blocks backing the host (x86-64 Linux) peripheral model.
+  *
+  *          Registers are plain memory: writes are stored, reads return the
+  *          last value written. Status flags that firmware busy-waits on
+  *          (oscillator/PLL ready, clock switch status, USART TXE/TC) are
+  *          preset by HostSim_Reset() so start-up code never blocks.
+  *          Self-clearing command bits the HAL polls with a timeout (ETH
+  *          DMABMR.SR, the PTPTSCR time stamp unit commands) complete on the
+  *          next HAL_GetTick() read.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "host_sim.h"
+#include "eth_dma_host.h"
+
+/* Private variables ---------------------------------------------------------*/
+HostSim_Core_TypeDef HostSim_Core;
+
+FLASH_TypeDef   HostSim_FLASH;
+PWR_TypeDef     HostSim_PWR;
+RCC_TypeDef     HostSim_RCC;
+SYSCFG_TypeDef  HostSim_SYSCFG;
+EXTI_TypeDef    HostSim_EXTI;
+GPIO_TypeDef    HostSim_GPIOA;
+GPIO_TypeDef    HostSim_GPIOB;
+GPIO_TypeDef    HostSim_GPIOC;
+USART_TypeDef   HostSim_USART1;
+ETH_TypeDef     HostSim_ETH;
+DMA2D_TypeDef   HostSim_DMA2D;
+uint32_t        HostSim_LTDC[HOST_SIM_LTDC_SIZE / 4U];
+FMC_Bank5_6_TypeDef HostSim_FMC_Bank5_6;
+uint8_t         HostSim_SDRAM[HOST_SIM_SDRAM_SIZE] __attribute__((aligned(64)));
+uint32_t        HostSim_USB_OTG_FS[HOST_SIM_USB_OTG_SIZE / 4U];
+SCnSCB_Type     HostSim_SCnSCB;
+SCB_Type        HostSim_SCB;
+SysTick_Type    HostSim_SysTick;
+NVIC_Type       HostSim_NVIC;
+DWT_Type        HostSim_DWT;
+CoreDebug_Type  HostSim_CoreDebug;
+MPU_Type        HostSim_MPU;
+FPU_Type        HostSim_FPU;
+
+static uint32_t hostSimHalTick;
+
+/* The linker script symbols bounding the SDRAM heap, over HostSim_SDRAM */
+#define HOST_SIM_STRING(x)      #x
+#define HOST_SIM_EXPAND(x)      HOST_SIM_STRING(x)
+__asm__(".globl _ssdram_heap\n\t.set _ssdram_heap, HostSim_SDRAM\n\t"
+		".globl _esdram_heap\n\t.set _esdram_heap, HostSim_SDRAM + " HOST_SIM_EXPAND(HOST_SIM_SDRAM_SIZE));
+
+/* Private functions ---------------------------------------------------------*/
+static void HostSim_GPIO_Reset(GPIO_TypeDef *GPIOx, uint32_t moder, uint32_t ospeedr, uint32_t pupdr)
+{
+	memset((void *)GPIOx, 0, sizeof(*GPIOx));
+	GPIOx->MODER   = moder;
+	GPIOx->OSPEEDR = ospeedr;
+	GPIOx->PUPDR   = pupdr;
+}
+
+/**
+ * @brief  Put every simulated register block in its reset state.
+ * @note   Values follow RM0385 reset values, except for the ready/status
+ *         flags listed in the file header which read as already set.
+ * @retval None
+ */
+void HostSim_Reset(void)
+{
+	memset(&HostSim_Core, 0, sizeof(HostSim_Core));
+
+	memset((void *)&HostSim_FLASH, 0, sizeof(HostSim_FLASH));
+	memset((void *)&HostSim_PWR, 0, sizeof(HostSim_PWR));
+	HostSim_PWR.CR1  = 0x0000C000U;
+	/* Over-drive ready and switch ready so LL_PWR polling loops exit */
+	HostSim_PWR.CSR1 = PWR_CSR1_ODRDY | PWR_CSR1_ODSWRDY | PWR_CSR1_VOSRDY;
+
+	memset((void *)&HostSim_RCC, 0, sizeof(HostSim_RCC));
+	HostSim_RCC.CR      = RCC_CR_HSION | RCC_CR_HSIRDY | (16U << RCC_CR_HSITRIM_Pos)
+						| RCC_CR_HSERDY | RCC_CR_PLLRDY | RCC_CR_PLLI2SRDY | RCC_CR_PLLSAIRDY;
+	HostSim_RCC.PLLCFGR = 0x24003010U;
+	/* Clock switch status reports the PLL, the source SystemClock_Config selects */
+	HostSim_RCC.CFGR    = RCC_CFGR_SWS_PLL;
+	HostSim_RCC.CSR     = RCC_CSR_LSIRDY;
+	HostSim_RCC.BDCR    = RCC_BDCR_LSERDY;
+
+	memset((void *)&HostSim_SYSCFG, 0, sizeof(HostSim_SYSCFG));
+	memset((void *)&HostSim_EXTI, 0, sizeof(HostSim_EXTI));
+
+	HostSim_GPIO_Reset(&HostSim_GPIOA, 0xA8000000U, 0x0C000000U, 0x64000000U);
+	HostSim_GPIO_Reset(&HostSim_GPIOB, 0x00000280U, 0x000000C0U, 0x00000100U);
+	HostSim_GPIO_Reset(&HostSim_GPIOC, 0x00000000U, 0x00000000U, 0x00000000U);
+
+	memset((void *)&HostSim_USART1, 0, sizeof(HostSim_USART1));
+	/* Transmitter always idle: TDR writes complete immediately */
+	HostSim_USART1.ISR = USART_ISR_TXE | USART_ISR_TC | USART_ISR_TEACK;
+
+	memset((void *)&HostSim_ETH, 0, sizeof(HostSim_ETH));
+	HostSim_ETH.DMABMR = 0x00002101U;
+
+	memset((void *)&HostSim_DMA2D, 0, sizeof(HostSim_DMA2D));
+	memset(HostSim_LTDC, 0, sizeof(HostSim_LTDC));
+	memset((void *)&HostSim_FMC_Bank5_6, 0, sizeof(HostSim_FMC_Bank5_6));
+
+	memset(HostSim_USB_OTG_FS, 0, sizeof(HostSim_USB_OTG_FS));
+	/* AHB master idle, core reset done: the HAL PCD calls made after
+	   HAL_PCD_Init() never wait on them */
+	USB_OTG_FS->GRSTCTL = USB_OTG_GRSTCTL_AHBIDL;
+
+	memset((void *)&HostSim_SCnSCB, 0, sizeof(HostSim_SCnSCB));
+	memset((void *)&HostSim_SCB, 0, sizeof(HostSim_SCB));
+	*(uint32_t *)&HostSim_SCB.CPUID = 0x411FC270U;
+	HostSim_SCB.AIRCR = 0xFA050000U;
+	memset((void *)&HostSim_SysTick, 0, sizeof(HostSim_SysTick));
+	memset((void *)&HostSim_NVIC, 0, sizeof(HostSim_NVIC));
+	memset((void *)&HostSim_DWT, 0, sizeof(HostSim_DWT));
+	HostSim_DWT.CTRL = 4UL << DWT_CTRL_NUMCOMP_Pos;
+	memset((void *)&HostSim_CoreDebug, 0, sizeof(HostSim_CoreDebug));
+	memset((void *)&HostSim_MPU, 0, sizeof(HostSim_MPU));
+	*(uint32_t *)&HostSim_MPU.TYPE = 8UL << MPU_TYPE_DREGION_Pos;
+	memset((void *)&HostSim_FPU, 0, sizeof(HostSim_FPU));
+}
+
+/**
+ * @brief  HAL time base of the host: one millisecond per read.
+ * @note   The HAL reads the tick only in its delay and timeout loops, each
+ *         read stands for the time the hardware needs to finish a command.
+ * @retval tick
+ */
+uint32_t HAL_GetTick(void)
+{
+	HostSim_ETH.DMABMR &= ~ETH_DMABMR_SR;
+	HostEthDma_PtpCommand();
+	return ++hostSimHalTick;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    host_timebase.c
+  * @brief   Host checks and benchmarks of timebase.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "timebase.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_TIMEBASE_TIMERS   64U     /* periodic timers of the tick benchmark */
+
+/* Private variables ---------------------------------------------------------*/
+static TimerWheel_TimerTypeDef benchTimebaseTimer[BENCH_TIMEBASE_TIMERS];
+static uint32_t benchTimebaseExpired;
+static uint32_t benchTimebaseWrap;      /* 1: the stretch ran out before the wake-up */
+static uint32_t benchTimebaseCycles;    /* SysTick cycles slept, since the wrap if any */
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_TimebaseExpired(void *arg)
+{
+	(void)arg;
+	benchTimebaseExpired++;
+}
+
+/* The wake-up of a Timebase_IdleFor() sleep on the simulated SysTick:
+   LOAD holds the stretch, VAL is set benchTimebaseCycles below it */
+static void Bench_TimebaseWake(void)
+{
+	if (benchTimebaseWrap != 0U)
+	{
+		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	}
+	SysTick->VAL = SysTick->LOAD - benchTimebaseCycles;
+}
+
+/* Tickless idle accounting: the cycles of the current tick spent before
+   the sleep, early wake-ups, the whole stretch and the cycles after its wrap */
+static void Bench_Timebase_Check(void)
+{
+	static TimerWheel_TimerTypeDef timer;
+	uint32_t cycles;
+	uint32_t wfi;
+
+	memset(&timer, 0, sizeof(timer));
+	benchTimebaseExpired = 0;
+	Timebase_Init();
+	cycles = SysTick->LOAD + 1U;
+	Timebase_StartTimer(&timer, 10U, 0, Bench_TimebaseExpired, NULL);
+	HostSim_Core.WFI_Hook = Bench_TimebaseWake;
+
+	/* 0.7 tick gone before the sleep, woken 0.5 tick in */
+	SysTick->VAL = (cycles * 3U) / 10U;
+	benchTimebaseWrap = 0;
+	benchTimebaseCycles = cycles / 2U;
+	Timebase_IdleFor(UINT32_MAX);
+	Bench_Expect("Timebase", Timebase_GetTick() == 1U, "early wake across a tick boundary");
+	Bench_Expect("Timebase", (SysTick->LOAD == cycles - 1U) && ((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0U)
+		&& (__get_PRIMASK() == 0U), "SysTick restarted");
+
+	/* The wheel stays a tick behind, the next expiry counts from the tick
+	   count: 0.2 tick gone, woken 0.5 tick in */
+	Bench_Expect("Timebase", Timebase_TicksToNextExpiry() == 9U, "expiry while the wheel is behind");
+	SysTick->VAL = (cycles * 8U) / 10U;
+	Timebase_IdleFor(UINT32_MAX);
+	Bench_Expect("Timebase", Timebase_GetTick() == 1U, "early wake within the tick");
+
+	/* Up to the timer, 9 ticks, then 1.2 tick after the wrap */
+	SysTick->VAL = (cycles * 3U) / 10U;
+	benchTimebaseWrap = 1U;
+	benchTimebaseCycles = (cycles * 6U) / 5U;
+	Timebase_IdleFor(UINT32_MAX);
+	Bench_Expect("Timebase", (Timebase_GetTick() == 11U) && ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) == 0U),
+		"whole stretch");
+	wfi = HostSim_Core.WFI_Count;
+	Timebase_IdleFor(UINT32_MAX);
+	Bench_Expect("Timebase", (Timebase_TicksToNextExpiry() == 0U) && (HostSim_Core.WFI_Count == wfi)
+		&& (Timebase_GetTick() == 11U), "no sleep with a timer due");
+	Timebase_Poll();
+	Bench_Expect("Timebase", (benchTimebaseExpired == 1U) && !TimerWheel_IsActive(&timer), "timer run");
+
+	/* Bounded by maxTicks */
+	Timebase_StartTimer(&timer, 50U, 0, Bench_TimebaseExpired, NULL);
+	benchTimebaseCycles = 0;
+	Timebase_IdleFor(3U);
+	Bench_Expect("Timebase", Timebase_GetTick() == 14U, "maxTicks");
+	Timebase_Poll();
+
+	/* The tick elapsed while stopping SysTick: left to the interrupt */
+	SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+	wfi = HostSim_Core.WFI_Count;
+	Timebase_IdleFor(UINT32_MAX);
+	Bench_Expect("Timebase", (HostSim_Core.WFI_Count == wfi) && ((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0U)
+		&& (Timebase_GetTick() == 14U), "tick pending at the stop");
+	SCB->ICSR = 0;
+	Timebase_IRQHandler();
+	Bench_Expect("Timebase", Timebase_GetTick() == 15U, "tick counted by the interrupt");
+
+	Timebase_StopTimer(&timer);
+	HostSim_Core.WFI_Hook = NULL;
+	Bench_Expect("Timebase", benchTimebaseExpired == 1U, "stopped timer");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* A tick and the poll of the timer task, 64 periodic timers of 1 to 64
+   ticks armed */
+void Bench_Timebase_Poll(uint32_t iterations)
+{
+	Bench_Timebase_Check();
+	memset(benchTimebaseTimer, 0, sizeof(benchTimebaseTimer));
+	Timebase_Init();
+	for (uint32_t i = 0; i < BENCH_TIMEBASE_TIMERS; i++)
+	{
+		Timebase_StartTimer(&benchTimebaseTimer[i], i + 1U, i + 1U, Bench_TimebaseExpired, NULL);
+	}
+
+	benchTimebaseExpired = 0;
+	while (iterations--)
+	{
+		Timebase_IRQHandler();
+		Timebase_Poll();
+	}
+}
@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    host_timer_wheel.c
+  * @brief   Host checks and benchmarks of timer_wheel.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "timer_wheel.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_TIMERS            1024U
+#define BENCH_TIMER_CHECKS      256U    /* timers of the expiry check, delays up to 2^20 ticks */
+
+/* Private variables ---------------------------------------------------------*/
+static TimerWheel_TypeDef benchWheel;
+static TimerWheel_TimerTypeDef benchTimer[BENCH_TIMERS];
+static uint32_t benchExpired;
+static uint32_t benchTimerDue[BENCH_TIMER_CHECKS];
+static uint32_t benchTimerFires[BENCH_TIMER_CHECKS];
+static uint32_t benchTimerFiredAt[BENCH_TIMER_CHECKS];
+
+/* Private functions ---------------------------------------------------------*/
+static void Bench_TimerExpired(void *arg)
+{
+	(void)arg;
+	benchExpired++;
+}
+
+/* arg: the timer, an entry of benchTimer */
+static void Bench_TimerFired(void *arg)
+{
+	uint32_t index = (uint32_t)((TimerWheel_TimerTypeDef *)arg - benchTimer);
+
+	benchTimerFires[index]++;
+	benchTimerFiredAt[index] = TimerWheel_GetTicks(&benchWheel);
+}
+
+/* arg: a timer to stop, due on the same tick */
+static void Bench_TimerStopper(void *arg)
+{
+	TimerWheel_Stop(&benchWheel, (TimerWheel_TimerTypeDef *)arg);
+	benchExpired++;
+}
+
+/* Timers on every level fire once on their expiry tick, across the 32-bit
+   wrap; TicksToNextExpiry() never overshoots the first one; then periodic
+   reloads and stopped timers */
+static void Bench_TimerWheel_Check(void)
+{
+	static const uint32_t delays[] = { 0U, 1U, 2U, 63U, 64U, 65U, 4095U, 4096U, 4097U, 262143U, 262144U, 1048576U };
+	uint32_t seed = 7U;
+	uint32_t pending = BENCH_TIMER_CHECKS;
+
+	memset(benchTimer, 0, sizeof(benchTimer));
+	memset(benchTimerFires, 0, sizeof(benchTimerFires));
+	TimerWheel_Init(&benchWheel, 0xFFFFF000U);
+	Bench_Expect("TimerWheel", TimerWheel_TicksToNextExpiry(&benchWheel) == TIMER_WHEEL_NO_EXPIRY, "empty wheel");
+	for (uint32_t i = 0; i < BENCH_TIMER_CHECKS; i++)
+	{
+		uint32_t delay;
+
+		seed = seed * 1664525U + 1013904223U;
+		delay = (i < sizeof(delays) / sizeof(delays[0])) ? delays[i] : 1U + ((seed >> 12) >> (seed & 15U));
+		benchTimerDue[i] = 0xFFFFF000U + ((delay == 0U) ? 1U : delay);
+		TimerWheel_Start(&benchWheel, &benchTimer[i], delay, 0, Bench_TimerFired, &benchTimer[i]);
+	}
+
+	while (pending != 0U)
+	{
+		uint32_t now = TimerWheel_GetTicks(&benchWheel);
+		uint32_t next = TimerWheel_TicksToNextExpiry(&benchWheel);
+		uint32_t first = UINT32_MAX;
+		uint32_t fires = 0;
+
+		for (uint32_t i = 0; i < BENCH_TIMER_CHECKS; i++)
+		{
+			if ((benchTimerFires[i] == 0U) && (benchTimerDue[i] - now < first))
+			{
+				first = benchTimerDue[i] - now;
+			}
+		}
+		Bench_Expect("TimerWheel", (next != 0U) && (next <= first), "next expiry after the first due timer");
+		TimerWheel_Advance(&benchWheel, next - 1U);
+		for (uint32_t i = 0; i < BENCH_TIMER_CHECKS; i++)
+		{
+			fires += benchTimerFires[i];
+		}
+		Bench_Expect("TimerWheel", fires == BENCH_TIMER_CHECKS - pending, "timer fired before the next expiry");
+
+		seed = seed * 1664525U + 1013904223U;
+		TimerWheel_Advance(&benchWheel, 1U + ((seed >> 16) % 300U));
+		pending = 0;
+		for (uint32_t i = 0; i < BENCH_TIMER_CHECKS; i++)
+		{
+			pending += (benchTimerFires[i] == 0U);
+		}
+	}
+	for (uint32_t i = 0; i < BENCH_TIMER_CHECKS; i++)
+	{
+		Bench_Expect("TimerWheel", (benchTimerFires[i] == 1U) && (benchTimerFiredAt[i] == benchTimerDue[i])
+			&& !TimerWheel_IsActive(&benchTimer[i]), "one-shot fired once on its expiry tick");
+	}
+	Bench_Expect("TimerWheel", TimerWheel_TicksToNextExpiry(&benchWheel) == TIMER_WHEEL_NO_EXPIRY, "wheel emptied");
+
+	/* Every 7 ticks from 5 on, over the wrap; 2 stopped by 1 on their
+	   common tick, 3 stopped before */
+	memset(benchTimerFires, 0, sizeof(benchTimerFires));
+	benchExpired = 0;
+	TimerWheel_Init(&benchWheel, 0xFFFFFFF0U);
+	TimerWheel_Start(&benchWheel, &benchTimer[0], 5U, 7U, Bench_TimerFired, &benchTimer[0]);
+	TimerWheel_Start(&benchWheel, &benchTimer[2], 30U, 0, Bench_TimerFired, &benchTimer[2]);
+	TimerWheel_Start(&benchWheel, &benchTimer[1], 30U, 0, Bench_TimerStopper, &benchTimer[2]);
+	TimerWheel_Start(&benchWheel, &benchTimer[3], 20U, 0, Bench_TimerFired, &benchTimer[3]);
+	TimerWheel_Stop(&benchWheel, &benchTimer[3]);
+	Bench_Expect("TimerWheel", !TimerWheel_IsActive(&benchTimer[3]) && (TimerWheel_TicksToNextExpiry(&benchWheel) == 5U),
+		"stopped timer");
+	for (uint32_t tick = 0; tick < 100U; tick++)
+	{
+		TimerWheel_Advance(&benchWheel, 1U);
+	}
+	Bench_Expect("TimerWheel", (benchTimerFires[0] == 14U) && (benchTimerFiredAt[0] == 0xFFFFFFF0U + 96U)
+		&& TimerWheel_IsActive(&benchTimer[0]), "periodic reload");
+	Bench_Expect("TimerWheel", TimerWheel_TicksToNextExpiry(&benchWheel) == 3U, "next periodic expiry");
+	Bench_Expect("TimerWheel", (benchExpired == 1U) && (benchTimerFires[2] == 0U) && (benchTimerFires[3] == 0U),
+		"stopped timers never fire");
+	TimerWheel_Stop(&benchWheel, &benchTimer[0]);
+	Bench_Expect("TimerWheel", TimerWheel_TicksToNextExpiry(&benchWheel) == TIMER_WHEEL_NO_EXPIRY, "periodic stopped");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Random starts and stops over every level of the wheel */
+void Bench_TimerWheel_StartStop(uint32_t iterations)
+{
+	uint32_t seed = 1;
+
+	Bench_TimerWheel_Check();
+	memset(benchTimer, 0, sizeof(benchTimer));
+	TimerWheel_Init(&benchWheel, 0);
+	while (iterations--)
+	{
+		/* Delays spread over every wheel level */
+		seed = seed * 1664525U + 1013904223U;
+		TimerWheel_TimerTypeDef *timer = &benchTimer[seed % BENCH_TIMERS];
+		if (TimerWheel_IsActive(timer))
+		{
+			TimerWheel_Stop(&benchWheel, timer);
+		}
+		else
+		{
+			TimerWheel_Start(&benchWheel, timer, seed >> (seed & 31U), 0, Bench_TimerExpired, NULL);
+		}
+	}
+}
+
+/* 1024 periodic timers, periods up to 1000 ticks, across the 32-bit wrap */
+void Bench_TimerWheel_Advance(uint32_t iterations)
+{
+	memset(benchTimer, 0, sizeof(benchTimer));
+	TimerWheel_Init(&benchWheel, 0xFFFFF000U);     /* cross the 32-bit wrap */
+	for (uint32_t i = 0; i < BENCH_TIMERS; i++)
+	{
+		TimerWheel_Start(&benchWheel, &benchTimer[i], i + 1U, (i % 1000U) + 1U, Bench_TimerExpired, NULL);
+	}
+
+	benchExpired = 0;
+	while (iterations--)
+	{
+		TimerWheel_Advance(&benchWheel, 1);
+	}
+}
@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * @file    host_usb.c
+  * @brief   USB device fixture of the host checks: the FS core as HAL_PCD_Init()
+  *          leaves it, and control transfers driven from the host side.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "dma_buffer.h"
+#include "host_test.h"
+#include "usb_cdc.h"
+#include "usb_device.h"
+#include "usb_msc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_USB_SERIAL        "0123456789ABCDEF0123456789ABCDE" /* 64-byte string descriptor */
+
+/* Exported variables --------------------------------------------------------*/
+PCD_HandleTypeDef benchUsb;
+uint32_t benchUsbPackets;        /* IN packets of the last control read, zero-length ones included */
+
+/* Exported functions --------------------------------------------------------*/
+/* The PCD handle as HAL_PCD_Init() leaves it for the FS core: its core
+   reset and FIFO flushes wait on bits the register model never clears.
+   msc: storage to start the mass storage class on, NULL for CDC */
+void Bench_UsbStart(const UsbMsc_StorageTypeDef *msc)
+{
+	static uint32_t pools;
+	memset(&benchUsb, 0, sizeof(benchUsb));
+	benchUsb.Instance = USB_OTG_FS;
+	benchUsb.Init.dev_endpoints = USB_DEVICE_MAX_ENDPOINTS;
+	benchUsb.Init.speed = PCD_SPEED_FULL;
+	benchUsb.Init.phy_itface = PCD_PHY_EMBEDDED;
+	benchUsb.Init.ep0_mps = USB_DEVICE_EP0_MPS;
+	benchUsb.State = HAL_PCD_STATE_READY;
+	for (uint8_t i = 0; i < 16U; i++)
+	{
+		benchUsb.IN_ep[i].is_in = 1U;
+		benchUsb.IN_ep[i].num = i;
+		benchUsb.IN_ep[i].tx_fifo_num = i;
+		benchUsb.OUT_ep[i].num = i;
+	}
+
+	/* The classes take their buffers once: the pools are set up once too */
+	if (pools == 0U)
+	{
+		DmaBuffer_Init();
+		pools = 1U;
+	}
+	if (msc == NULL)
+	{
+		Bench_Expect("USB", UsbCdc_Init(&benchUsb, BENCH_USB_SERIAL) == HAL_OK, "init");
+	}
+	else
+	{
+		Bench_Expect("USB", UsbMsc_Init(&benchUsb, msc, BENCH_USB_SERIAL) == HAL_OK, "init");
+	}
+	/* Bus reset, full speed enumerated */
+	HAL_PCD_ResetCallback(&benchUsb);
+}
+
+/**
+ * @brief  One control transfer from the host side, every stage completed
+ *         the way the HAL PCD interrupt handler reports it.
+ * @param  data: OUT data stage, or the IN data stage destination
+ * @retval IN data stage length, 0 for OUT ones, BENCH_USB_STALL
+ */
+int Bench_UsbControl(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+		uint16_t wLength, uint8_t *data)
+{
+	const uint8_t setup[8] = { bmRequestType, bRequest, (uint8_t)wValue, (uint8_t)(wValue >> 8),
+		(uint8_t)wIndex, (uint8_t)(wIndex >> 8), (uint8_t)wLength, (uint8_t)(wLength >> 8) };
+	UsbDevice_StatsTypeDef stats;
+	uint32_t stalls;
+	uint32_t done = 0;
+
+	UsbDevice_GetStats(&stats);
+	stalls = stats.stalls;
+	benchUsbPackets = 0;
+	memcpy(benchUsb.Setup, setup, sizeof(setup));
+	benchUsb.IN_ep[0].xfer_len = BENCH_USB_NO_PACKET;
+	HAL_PCD_SetupStageCallback(&benchUsb);
+
+	if (((bmRequestType & USB_REQ_DIR_IN) == 0U) && (wLength != 0U))
+	{
+		while (done < wLength)
+		{
+			uint32_t chunk = (wLength - done < USB_DEVICE_EP0_MPS) ? (wLength - done) : USB_DEVICE_EP0_MPS;
+
+			UsbDevice_GetStats(&stats);
+			if (stats.stalls != stalls)
+			{
+				return BENCH_USB_STALL;
+			}
+			memcpy(benchUsb.OUT_ep[0].xfer_buff, &data[done], chunk);
+			benchUsb.OUT_ep[0].xfer_count = chunk;
+			done += chunk;
+			HAL_PCD_DataOutStageCallback(&benchUsb, 0U);
+		}
+		done = 0;
+	}
+
+	UsbDevice_GetStats(&stats);
+	if (stats.stalls != stalls)
+	{
+		return BENCH_USB_STALL;
+	}
+	/* IN packets until the device arms the status OUT stage instead; a
+	   status IN stage is the zero-length packet of an OUT request */
+	while (benchUsb.IN_ep[0].xfer_len != BENCH_USB_NO_PACKET)
+	{
+		uint32_t length = benchUsb.IN_ep[0].xfer_len;
+
+		Bench_Expect("USB", length <= USB_DEVICE_EP0_MPS, "endpoint 0 packet size");
+		if ((bmRequestType & USB_REQ_DIR_IN) != 0U)
+		{
+			if (length != 0U)
+			{
+				memcpy(&data[done], benchUsb.IN_ep[0].xfer_buff, length);
+			}
+			done += length;
+			benchUsbPackets++;
+		}
+		benchUsb.IN_ep[0].xfer_len = BENCH_USB_NO_PACKET;
+		HAL_PCD_DataInStageCallback(&benchUsb, 0U);
+	}
+	if ((bmRequestType & USB_REQ_DIR_IN) != 0U)
+	{
+		Bench_Expect("USB", benchUsb.OUT_ep[0].xfer_len == 0U, "status OUT stage armed");
+		benchUsb.OUT_ep[0].xfer_count = 0;
+		HAL_PCD_DataOutStageCallback(&benchUsb, 0U);
+	}
+	return (int)done;
+}
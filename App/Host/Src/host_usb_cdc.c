@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file    host_usb_cdc.c
+  * @brief   Host checks and benchmarks of usb_cdc.c and usb_device.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "host_test.h"
+#include "usb_cdc.h"
+#include "usb_device.h"
+
+/* Private functions ---------------------------------------------------------*/
+/* Bulk OUT transfer of length bytes, a counting pattern from seed */
+static void Bench_UsbBulkOut(uint32_t length, uint8_t seed)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		benchUsb.OUT_ep[1].xfer_buff[i] = (uint8_t)(seed + i);
+	}
+	benchUsb.OUT_ep[1].xfer_count = length;
+	HAL_PCD_DataOutStageCallback(&benchUsb, 1U);
+}
+
+/* Enumerate and configure as a host driver does, then the class */
+static void Bench_UsbCdc_Check(void)
+{
+	static const uint8_t lineCoding[7] = { 0x00, 0x10, 0x0E, 0x00, 0x02, 0x02, 0x07 };    /* 921600 7E2 */
+	uint8_t data[USB_CDC_RX_BUFFER_SIZE];
+	uint8_t *buffer[2];
+	const uint8_t *descriptor;
+	UsbCdc_LineCodingTypeDef coding;
+	UsbCdc_StatsTypeDef stats;
+	UsbDevice_StatsTypeDef deviceStats;
+	uint32_t count;
+
+	Bench_UsbStart(NULL);
+	/* usb_fifo.h plan: 8 bulk packets each way, 4 words of the 320 left */
+	Bench_Expect("UsbCdc", (USB_OTG_FS->GRXFSIZ == 154U) && (USB_OTG_FS->DIEPTXF0_HNPTXFSIZ == ((16U << 16) | 154U))
+		&& (USB_OTG_FS->DIEPTXF[0] == ((128U << 16) | 170U)) && (USB_OTG_FS->DIEPTXF[1] == ((16U << 16) | 298U)),
+		"FIFO RAM partition");
+	Bench_Expect("UsbCdc", UsbDevice_GetState() == USB_DEVICE_STATE_DEFAULT, "default after reset");
+
+	/* Windows asks for 64 bytes of the device descriptor first */
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0100, 0, 64, data) == 18)
+		&& (data[0] == 18U) && (data[1] == USB_DESC_DEVICE) && (data[4] == 0x02U) && (data[7] == 64U)
+		&& (data[8] == 0x83U) && (data[9] == 0x04U) && (data[17] == 1U), "device descriptor");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x00, USB_REQ_SET_ADDRESS, 23, 0, 0, NULL) == 0)
+		&& ((((USB_OTG_DeviceTypeDef *)((uintptr_t)USB_OTG_FS + USB_OTG_DEVICE_BASE))->DCFG & USB_OTG_DCFG_DAD) == (23U << 4))
+		&& (UsbDevice_GetState() == USB_DEVICE_STATE_ADDRESSED), "SET_ADDRESS");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x00, USB_REQ_SET_ADDRESS, 128, 0, 0, NULL) == BENCH_USB_STALL,
+		"address out of range");
+
+	/* Configuration: header first, then all of it */
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 9, data) == 9)
+		&& (data[2] == USB_CDC_CONFIG_LENGTH) && (data[3] == 0U) && (data[4] == 2U), "configuration header");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 255, data) == USB_CDC_CONFIG_LENGTH)
+		&& (benchUsbPackets == 2U), "configuration descriptor");
+	count = 0;
+	descriptor = NULL;
+	while ((descriptor = UsbDevice_FindDescriptor(data, USB_CDC_CONFIG_LENGTH, descriptor, USB_DESC_ENDPOINT)) != NULL)
+	{
+		Bench_Expect("UsbCdc", (descriptor[4] == ((descriptor[2] == USB_CDC_EP_NOTIFY) ? 16U : 64U)) && (descriptor[5] == 0U),
+			"full-speed packet sizes");
+		count++;
+	}
+	Bench_Expect("UsbCdc", count == 3U, "three endpoints");
+	count = 0;
+	descriptor = NULL;
+	while ((descriptor = UsbDevice_FindDescriptor(data, USB_CDC_CONFIG_LENGTH, descriptor, USB_DESC_CS_INTERFACE)) != NULL)
+	{
+		count++;
+	}
+	Bench_Expect("UsbCdc", count == 4U, "CDC functional descriptors");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 64, data) == 64)
+		&& (benchUsbPackets == 1U), "configuration cut at wLength");
+
+	/* Strings: a 64-byte one ends with a zero-length packet */
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0300, 0, 255, data) == 4)
+		&& (data[2] == 0x09U) && (data[3] == 0x04U), "LANGID");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0302, 0x0409, 255, data) == 58)
+		&& (data[0] == 58U) && (data[1] == USB_DESC_STRING) && (data[2] == 'S') && (data[3] == 0U)
+		&& (data[56] == 't'), "product string");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0303, 0x0409, 255, data) == 64)
+		&& (benchUsbPackets == 2U) && (data[62] == 'E'), "serial string and its ZLP");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0304, 0x0409, 255, data) == BENCH_USB_STALL,
+		"no string 4");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0600, 0, 10, data) == BENCH_USB_STALL,
+		"no qualifier on a full-speed only device");
+
+	/* Class requests need the configured state */
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x21, USB_CDC_SET_LINE_CODING, 0, 0, 7, (uint8_t *)lineCoding)
+		== BENCH_USB_STALL, "class request while addressed");
+	Bench_Expect("UsbCdc", UsbCdc_Write(data, 1) == 0U, "write before configuration");
+
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x00, USB_REQ_SET_CONFIGURATION, 1, 0, 0, NULL) == 0)
+		&& (UsbDevice_GetState() == USB_DEVICE_STATE_CONFIGURED), "SET_CONFIGURATION");
+	Bench_Expect("UsbCdc", (benchUsb.IN_ep[1].maxpacket == 64U) && (benchUsb.IN_ep[1].type == EP_TYPE_BULK)
+		&& (benchUsb.OUT_ep[1].maxpacket == 64U) && (benchUsb.OUT_ep[1].type == EP_TYPE_BULK)
+		&& (benchUsb.IN_ep[2].maxpacket == 16U) && (benchUsb.IN_ep[2].type == EP_TYPE_INTR)
+		&& (UsbDevice_MaxPacket(USB_CDC_EP_IN) == 64U) && (UsbDevice_MaxPacket(0x83) == 0U), "endpoints opened");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_CONFIGURATION, 0, 0, 1, data) == 1) && (data[0] == 1U),
+		"GET_CONFIGURATION");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x80, USB_REQ_GET_STATUS, 0, 0, 2, data) == 2) && (data[0] == 0U),
+		"bus powered");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x81, USB_REQ_GET_INTERFACE, 0, 1, 1, data) == 1) && (data[0] == 0U),
+		"GET_INTERFACE");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x01, USB_REQ_SET_INTERFACE, 1, 1, 0, NULL) == BENCH_USB_STALL,
+		"no alternate setting");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x81, USB_REQ_GET_INTERFACE, 0, 2, 1, data) == BENCH_USB_STALL,
+		"no interface 2");
+
+	/* Endpoint halt, set and cleared by the host */
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x02, USB_REQ_SET_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_CDC_EP_IN, 0, NULL) == 0)
+		&& (Bench_UsbControl(0x82, USB_REQ_GET_STATUS, 0, USB_CDC_EP_IN, 2, data) == 2) && (data[0] == 1U),
+		"endpoint halted");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x02, USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_CDC_EP_IN, 0, NULL) == 0)
+		&& (Bench_UsbControl(0x82, USB_REQ_GET_STATUS, 0, USB_CDC_EP_IN, 2, data) == 2) && (data[0] == 0U),
+		"endpoint halt cleared");
+
+	/* Line coding and control line state, as a terminal opens the port */
+	UsbCdc_GetLineCoding(&coding);
+	Bench_Expect("UsbCdc", (coding.baudrate == 115200U) && (coding.dataBits == 8U) && (coding.parity == 0U)
+		&& (coding.stopBits == 0U), "115200 8N1 by default");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x21, USB_CDC_SET_LINE_CODING, 0, 0, 7, (uint8_t *)lineCoding) == 0,
+		"SET_LINE_CODING");
+	UsbCdc_GetLineCoding(&coding);
+	Bench_Expect("UsbCdc", (coding.baudrate == 921600U) && (coding.dataBits == 7U) && (coding.parity == 2U)
+		&& (coding.stopBits == 2U), "line coding kept");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0xA1, USB_CDC_GET_LINE_CODING, 0, 0, 7, data) == 7)
+		&& (memcmp(data, lineCoding, 7) == 0), "GET_LINE_CODING");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x21, USB_CDC_SET_LINE_CODING, 0, 0, 6, data) == BENCH_USB_STALL,
+		"short line coding");
+	Bench_Expect("UsbCdc", UsbCdc_IsOpen() == 0U, "closed before DTR");
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x21, USB_CDC_SET_CONTROL_LINE_STATE, 3, 0, 0, NULL) == 0)
+		&& (UsbCdc_IsOpen() != 0U), "DTR set");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x21, 0x42, 0, 0, 0, NULL) == BENCH_USB_STALL, "unknown class request");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x21, USB_CDC_SEND_BREAK, 0, 1, 0, NULL) == BENCH_USB_STALL,
+		"class request to the data interface");
+
+	/* RX: the buffers take turns, the next one armed before the copy */
+	buffer[0] = benchUsb.OUT_ep[1].xfer_buff;
+	Bench_Expect("UsbCdc", (buffer[0] != NULL) && (benchUsb.OUT_ep[1].xfer_len == USB_CDC_RX_BUFFER_SIZE), "OUT armed");
+	Bench_UsbBulkOut(100U, 0U);
+	buffer[1] = benchUsb.OUT_ep[1].xfer_buff;
+	Bench_Expect("UsbCdc", (buffer[1] != buffer[0]) && (UsbCdc_Read(data, sizeof(data)) == 100U) && (data[99] == 99U),
+		"ping-pong");
+	Bench_UsbBulkOut(0U, 0U);
+	Bench_Expect("UsbCdc", benchUsb.OUT_ep[1].xfer_buff == buffer[0], "zero-length transfer");
+
+	/* Two full buffers fill the RX ring, the next two are held and the
+	   endpoint stops: the host gets NAKs, nothing is lost */
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		Bench_UsbBulkOut(USB_CDC_RX_BUFFER_SIZE, (uint8_t)(i * 16U));
+	}
+	UsbCdc_GetStats(&stats);
+	count = stats.rxTransfers;
+	Bench_Expect("UsbCdc", stats.rxHeld == 2U, "buffers held");
+	/* A spurious completion finds no buffer to fill */
+	HAL_PCD_DataOutStageCallback(&benchUsb, 1U);
+	UsbCdc_GetStats(&stats);
+	Bench_Expect("UsbCdc", stats.rxTransfers == count, "endpoint not armed");
+	for (uint32_t i = 0; i < 4U; i++)
+	{
+		Bench_Expect("UsbCdc", (UsbCdc_Read(data, USB_CDC_RX_BUFFER_SIZE) == USB_CDC_RX_BUFFER_SIZE)
+			&& (data[0] == (uint8_t)(i * 16U)) && (data[USB_CDC_RX_BUFFER_SIZE - 1U] == (uint8_t)(i * 16U + 1023U)),
+			"held data in order");
+		Bench_Expect("UsbCdc", (benchUsb.OUT_ep[1].xfer_buff == buffer[0]) || (benchUsb.OUT_ep[1].xfer_buff == buffer[1]),
+			"rearmed by the read");
+	}
+	Bench_Expect("UsbCdc", UsbCdc_Read(data, sizeof(data)) == 0U, "RX drained");
+
+	/* TX: a transfer ending on a packet boundary gets a zero-length packet */
+	memset(data, 0x5A, sizeof(data));
+	Bench_Expect("UsbCdc", (UsbCdc_Write(data, 128) == 128U) && (benchUsb.IN_ep[1].xfer_len == 128U)
+		&& (memcmp(benchUsb.IN_ep[1].xfer_buff, data, 128) == 0), "IN transfer");
+	Bench_Expect("UsbCdc", UsbCdc_Write(data, 100) == 100U, "queued behind");
+	HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+	Bench_Expect("UsbCdc", benchUsb.IN_ep[1].xfer_len == 100U, "chained");
+	HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+	Bench_Expect("UsbCdc", UsbCdc_Write(data, 64) == 64U, "next write");
+	HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+	Bench_Expect("UsbCdc", benchUsb.IN_ep[1].xfer_len == 0U, "zero-length packet");
+	HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+	UsbCdc_GetStats(&stats);
+	Bench_Expect("UsbCdc", (stats.txBytes == 292U) && (stats.txTransfers == 3U) && (stats.txZlps == 1U)
+		&& (stats.rxBytes == 100U + 4U * USB_CDC_RX_BUFFER_SIZE) && (stats.lineCodings == 1U), "class counters");
+
+	/* Deconfigured: the port closes */
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x00, USB_REQ_SET_CONFIGURATION, 0, 0, 0, NULL) == 0)
+		&& (UsbDevice_GetState() == USB_DEVICE_STATE_ADDRESSED) && (UsbCdc_IsOpen() == 0U)
+		&& (UsbCdc_Write(data, 1) == 0U) && (UsbDevice_MaxPacket(USB_CDC_EP_IN) == 0U), "deconfigured");
+	Bench_Expect("UsbCdc", Bench_UsbControl(0x00, USB_REQ_SET_CONFIGURATION, 2, 0, 0, NULL) == BENCH_USB_STALL,
+		"no configuration 2");
+
+	UsbDevice_GetStats(&deviceStats);
+	Bench_Expect("UsbCdc", (deviceStats.resets == 1U) && (deviceStats.configurations == 1U) && (deviceStats.stalls == 10U),
+		"device counters");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* Writes of one packet, each completed with its zero-length packet */
+void Bench_UsbCdc_Write(uint32_t iterations)
+{
+	uint8_t data[64];
+
+	Bench_UsbCdc_Check();
+
+	Bench_UsbStart(NULL);
+	Bench_Expect("UsbCdc", (Bench_UsbControl(0x00, USB_REQ_SET_ADDRESS, 1, 0, 0, NULL) == 0)
+		&& (Bench_UsbControl(0x00, USB_REQ_SET_CONFIGURATION, 1, 0, 0, NULL) == 0), "bench configure");
+	memset(data, 0x33, sizeof(data));
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		(void)UsbCdc_Write(data, sizeof(data));
+		HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+		HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+	}
+	Bench_Expect("UsbCdc", benchUsb.IN_ep[1].xfer_len == 0U, "bench ZLP");
+}
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    host_usb_fifo.c
+  * @brief   Host checks and benchmarks of usb_fifo.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "host_test.h"
+#include "usb_fifo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_USB_FIFO_PLANS    2000U   /* random endpoint lists checked against the plan rules */
+
+/* Private functions ---------------------------------------------------------*/
+static int Bench_UsbFifoIs(const UsbFifo_PlanTypeDef *plan, uint16_t rx, uint16_t tx0, uint16_t tx1, uint16_t tx2,
+		uint16_t used)
+{
+	return (plan->rxWords == rx) && (plan->txWords[0] == tx0) && (plan->txWords[1] == tx1)
+		&& (plan->txWords[2] == tx2) && (plan->txWords[3] == 0U) && (plan->txWords[4] == 0U)
+		&& (plan->txWords[5] == 0U) && (plan->usedWords == used);
+}
+
+/* Layouts worked out by hand from the RM0385 rules, then random endpoint
+   lists against the rules themselves */
+static void Bench_UsbFifo_Check(void)
+{
+	static const UsbFifo_EndpointTypeDef cdcFs[] =
+	{
+		{ 0x82, EP_TYPE_INTR, 16 }, { 0x01, EP_TYPE_BULK, 64 }, { 0x81, EP_TYPE_BULK, 64 }
+	};
+	static const UsbFifo_EndpointTypeDef cdcHs[] =
+	{
+		{ 0x82, EP_TYPE_INTR, 16 }, { 0x01, EP_TYPE_BULK, 512 }, { 0x81, EP_TYPE_BULK, 512 }
+	};
+	static const UsbFifo_EndpointTypeDef audio[] =
+	{
+		{ 0x81, EP_TYPE_ISOC, 192 }, { 0x82, EP_TYPE_BULK, 64 }, { 0x02, EP_TYPE_BULK, 64 }
+	};
+	static const UsbFifo_EndpointTypeDef highBandwidth[] =
+	{
+		{ 0x81, EP_TYPE_ISOC, 1024 | (2U << 11) }
+	};
+	static const UsbFifo_EndpointTypeDef isoFs[] =
+	{
+		{ 0x81, EP_TYPE_ISOC, 1023 }, { 0x82, EP_TYPE_INTR, 8 }
+	};
+	static const UsbFifo_EndpointTypeDef badNumber[] = { { 0x86, EP_TYPE_BULK, 64 } };
+	static const UsbFifo_EndpointTypeDef twice[] = { { 0x81, EP_TYPE_BULK, 64 }, { 0x81, EP_TYPE_INTR, 8 } };
+	UsbFifo_EndpointTypeDef endpoints[2U * (USB_FIFO_MAX_ENDPOINTS - 1U)];
+	UsbFifo_PlanTypeDef plan;
+	uint32_t seed = 1U;
+
+	/* CDC at full speed: RX 35 words for one packet, 17 more per packet */
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, cdcFs, 3, USB_FIFO_FS_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 35U + 7U * 17U, 16U, 8U * 16U, 16U, 314U), "CDC FS");
+	/* CDC at high speed with the DMA: 3 packets in, 4 out, then no room */
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, cdcHs, 3, USB_FIFO_HS_WORDS - USB_FIFO_HS_DMA_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 147U + 2U * 129U, 16U, 4U * 128U, 16U, 949U), "CDC HS");
+	/* Isochronous first: 3 packets before bulk gets its 4th */
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, audio, 3, USB_FIFO_FS_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 35U + 3U * 17U, 16U, 3U * 48U, 4U * 16U, 310U), "isochronous priority");
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, highBandwidth, 1, USB_FIFO_HS_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 33U, 16U, 768U, 0U, 817U), "high-bandwidth isochronous");
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, isoFs, 2, USB_FIFO_FS_WORDS, &plan) == HAL_ERROR)
+		&& (plan.usedWords == 0U) && (plan.rxWords == 0U), "1023-byte packets do not fit at full speed");
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(64, isoFs, 2, USB_FIFO_HS_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 33U, 16U, 3U * 256U, 16U, 833U), "1023-byte packets at high speed");
+	Bench_Expect("UsbFifo", UsbFifo_Plan(64, badNumber, 1, USB_FIFO_HS_WORDS, &plan) == HAL_ERROR, "endpoint 6");
+	Bench_Expect("UsbFifo", UsbFifo_Plan(64, twice, 2, USB_FIFO_HS_WORDS, &plan) == HAL_ERROR, "IN endpoint twice");
+	Bench_Expect("UsbFifo", UsbFifo_Plan(0, NULL, 0, USB_FIFO_FS_WORDS, &plan) == HAL_ERROR, "bMaxPacketSize0");
+	Bench_Expect("UsbFifo", (UsbFifo_Plan(8, NULL, 0, USB_FIFO_FS_WORDS, &plan) == HAL_OK)
+		&& Bench_UsbFifoIs(&plan, 5U + 8U + 3U + 2U + 1U, 16U, 0U, 0U, 35U), "endpoint 0 only");
+
+	for (uint32_t i = 0; i < BENCH_USB_FIFO_PLANS; i++)
+	{
+		uint32_t count = 0;
+		uint32_t ram = (i & 1U) ? USB_FIFO_HS_WORDS : USB_FIFO_FS_WORDS;
+		uint32_t sum;
+		uint32_t outs = 1;
+		uint32_t largest = 16;
+
+		for (uint32_t n = 1; n < USB_FIFO_MAX_ENDPOINTS; n++)
+		{
+			for (uint32_t in = 0; in < 2U; in++)
+			{
+				seed = seed * 1103515245U + 12345U;
+				if (((seed >> 16) & 3U) == 0U)
+				{
+					continue;
+				}
+				endpoints[count].address = (uint8_t)(n | (in << 7));
+				endpoints[count].type = (uint8_t)(1U + ((seed >> 20) % 3U));
+				endpoints[count].maxPacket = (uint16_t)(8U << ((seed >> 24) % ((i & 1U) ? 7U : 4U)));
+				if (endpoints[count].maxPacket > 1024U)
+				{
+					endpoints[count].maxPacket = 1024U;
+				}
+				if (in == 0U)
+				{
+					outs++;
+					if (UsbFifo_PacketWords(endpoints[count].maxPacket) > largest)
+					{
+						largest = UsbFifo_PacketWords(endpoints[count].maxPacket);
+					}
+				}
+				count++;
+			}
+		}
+		if (UsbFifo_Plan(64, endpoints, count, ram, &plan) != HAL_OK)
+		{
+			Bench_Expect("UsbFifo", plan.usedWords == 0U, "zeroed on error");
+			continue;
+		}
+		sum = plan.rxWords;
+		Bench_Expect("UsbFifo", plan.rxWords >= 5U + 8U + largest + 1U + 2U * outs + 1U, "RX FIFO rule");
+		for (uint32_t n = 0; n < USB_FIFO_MAX_ENDPOINTS; n++)
+		{
+			sum += plan.txWords[n];
+		}
+		for (uint32_t k = 0; k < count; k++)
+		{
+			if ((endpoints[k].address & 0x80U) != 0U)
+			{
+				uint32_t words = plan.txWords[endpoints[k].address & 0x0FU];
+
+				Bench_Expect("UsbFifo", (words >= USB_FIFO_MIN_TX_WORDS)
+					&& (words >= UsbFifo_PacketWords(endpoints[k].maxPacket))
+					&& ((endpoints[k].type != EP_TYPE_INTR) || (words == USB_FIFO_MIN_TX_WORDS)
+						|| (words == UsbFifo_PacketWords(endpoints[k].maxPacket))), "TX FIFO rule");
+			}
+		}
+		Bench_Expect("UsbFifo", (sum == plan.usedWords) && (sum <= ram), "plan within the RAM");
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+void Bench_UsbFifo_Plan(uint32_t iterations)
+{
+	static const UsbFifo_EndpointTypeDef cdcHs[] =
+	{
+		{ 0x82, EP_TYPE_INTR, 16 }, { 0x01, EP_TYPE_BULK, 512 }, { 0x81, EP_TYPE_BULK, 512 }
+	};
+	UsbFifo_PlanTypeDef plan;
+	uint32_t used = 0;
+
+	Bench_UsbFifo_Check();
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		(void)UsbFifo_Plan(64, cdcHs, 3, USB_FIFO_HS_WORDS - (i & 15U), &plan);
+		used += plan.usedWords;
+	}
+	Bench_Expect("UsbFifo", used != 0U, "plans made");
+}
+
+/* ll_usb FIFO copy, CPU only as on the FS core: USB_WritePacket() loads
+   packets of each endpoint type as the TX FIFO empty interrupt does, as
+   many as the planned FIFO holds per interrupt, USB_ReadPacket() pops
+   them off the RX FIFO */
+void Bench_UsbFifo_Copy(uint32_t iterations)
+{
+	static const struct
+	{
+		const char *name;
+		uint8_t type;
+		uint16_t maxPacket;
+		uint32_t ramWords;
+	} types[] =
+	{
+		{ "control 64B FS",   EP_TYPE_CTRL, 64,   USB_FIFO_FS_WORDS },
+		{ "interrupt 64B FS", EP_TYPE_INTR, 64,   USB_FIFO_FS_WORDS },
+		{ "bulk 64B FS",      EP_TYPE_BULK, 64,   USB_FIFO_FS_WORDS },
+		{ "bulk 512B HS",     EP_TYPE_BULK, 512,  USB_FIFO_HS_WORDS },
+		{ "isoc 1023B HS",    EP_TYPE_ISOC, 1023, USB_FIFO_HS_WORDS },
+	};
+	static uint8_t packet[1024] __attribute__((aligned(4)));
+	UsbFifo_PlanTypeDef plan;
+
+	for (uint32_t t = 0; t < sizeof(types) / sizeof(types[0]); t++)
+	{
+		const UsbFifo_EndpointTypeDef endpoints[2] =
+		{
+			{ 0x81, types[t].type, types[t].maxPacket }, { 0x01, types[t].type, types[t].maxPacket }
+		};
+		uint32_t perFill;
+		uint32_t count = (types[t].type == EP_TYPE_CTRL) ? 0U : 2U;
+		uint64_t start;
+		double inNs;
+		double outNs;
+
+		Bench_Expect("UsbFifo", UsbFifo_Plan(types[t].maxPacket > 64U ? 64U : types[t].maxPacket, endpoints, count,
+			types[t].ramWords, &plan) == HAL_OK, "copy bench plan");
+		perFill = plan.txWords[count ? 1U : 0U] / UsbFifo_PacketWords(types[t].maxPacket);
+
+		start = Host_NowNs();
+		for (uint32_t i = 0; i < iterations; i += perFill)
+		{
+			for (uint32_t k = 0; k < perFill; k++)
+			{
+				(void)USB_WritePacket(USB_OTG_FS, packet, 1U, types[t].maxPacket, 0U);
+			}
+		}
+		inNs = (double)(Host_NowNs() - start);
+
+		start = Host_NowNs();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			(void)USB_ReadPacket(USB_OTG_FS, packet, types[t].maxPacket);
+		}
+		outNs = (double)(Host_NowNs() - start);
+
+		printf("  %-17s %u pkt/FIFO  IN %7.1f MB/s  OUT %7.1f MB/s\n", types[t].name, (unsigned)perFill,
+			(double)iterations * types[t].maxPacket * 1000.0 / inNs,
+			(double)iterations * types[t].maxPacket * 1000.0 / outNs);
+	}
+}
@@ -0,0 +1,450 @@
+/**
+  ******************************************************************************
+  * @file    host_usb_msc.c
+  * @brief   Host checks and benchmarks of usb_msc.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "usb_device.h"
+#include "usb_msc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_MSC_BLOCKS        256U    /* RAM disk */
+#define BENCH_MSC_HALTED        (-1)    /* no CSW: the IN endpoint halted */
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t benchMscDisk[BENCH_MSC_BLOCKS * USB_MSC_BLOCK_SIZE];
+static uint32_t benchMscPresent;        /* medium in */
+static uint32_t benchMscDefer;          /* 1: completions wait for the host loop */
+static uint32_t benchMscPending;        /* operation started, its completion not reported */
+static HAL_StatusTypeDef benchMscResult;
+static uint32_t benchMscBusy;           /* operations to refuse busy */
+static uint32_t benchMscFailAt;         /* operation number to fail, 0: none */
+static uint32_t benchMscOps;            /* operations started */
+static uint32_t benchMscTag;
+
+/* Private functions ---------------------------------------------------------*/
+/* RAM disk standing in for the SD card. A completion is reported from
+   within the call, or with benchMscDefer left pending for the host loop
+   of Bench_MscRun(), as the SDMMC interrupt would */
+static HAL_StatusTypeDef Bench_MscCapacity(uint32_t *blocks)
+{
+	*blocks = BENCH_MSC_BLOCKS;
+	return (benchMscPresent != 0U) ? HAL_OK : HAL_ERROR;
+}
+
+static HAL_StatusTypeDef Bench_MscAccept(uint32_t block, uint32_t count)
+{
+	Bench_Expect("UsbMsc", (count != 0U) && ((count * USB_MSC_BLOCK_SIZE) <= USB_MSC_SLOT_SIZE)
+		&& ((block + count) <= BENCH_MSC_BLOCKS), "storage range");
+	Bench_Expect("UsbMsc", benchMscPending == 0U, "one storage operation at a time");
+	if (benchMscBusy != 0U)
+	{
+		benchMscBusy--;
+		return HAL_BUSY;
+	}
+	benchMscOps++;
+	return (benchMscOps == benchMscFailAt) ? HAL_ERROR : HAL_OK;
+}
+
+static HAL_StatusTypeDef Bench_MscFinish(HAL_StatusTypeDef result)
+{
+	if (benchMscDefer != 0U)
+	{
+		benchMscResult = result;
+		benchMscPending = 1U;
+	}
+	else
+	{
+		UsbMsc_StorageDone(result);
+	}
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef Bench_MscRead(uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	HAL_StatusTypeDef result = Bench_MscAccept(block, count);
+
+	if (result == HAL_BUSY)
+	{
+		return HAL_BUSY;
+	}
+	if (result == HAL_OK)
+	{
+		memcpy(buffer, &benchMscDisk[block * USB_MSC_BLOCK_SIZE], count * USB_MSC_BLOCK_SIZE);
+	}
+	return Bench_MscFinish(result);
+}
+
+static HAL_StatusTypeDef Bench_MscWrite(const uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	HAL_StatusTypeDef result = Bench_MscAccept(block, count);
+
+	if (result == HAL_BUSY)
+	{
+		return HAL_BUSY;
+	}
+	if (result == HAL_OK)
+	{
+		memcpy(&benchMscDisk[block * USB_MSC_BLOCK_SIZE], buffer, count * USB_MSC_BLOCK_SIZE);
+	}
+	return Bench_MscFinish(result);
+}
+
+static const UsbMsc_StorageTypeDef benchMscStorage =
+{
+	.capacity = Bench_MscCapacity,
+	.read = Bench_MscRead,
+	.write = Bench_MscWrite
+};
+
+static uint32_t Bench_MscGet32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* CBW from the host, into the buffer armed on the bulk OUT endpoint */
+static void Bench_MscSendCbw(const uint8_t *cb, uint32_t cbLength, uint32_t dataLength, uint32_t in)
+{
+	uint8_t *cbw = benchUsb.OUT_ep[1].xfer_buff;
+
+	Bench_Expect("UsbMsc", benchUsb.OUT_ep[1].xfer_len == USB_MSC_COMMAND_SIZE, "CBW armed");
+	memset(cbw, 0, 31);
+	cbw[0] = 0x55;                      /* "USBC" */
+	cbw[1] = 0x53;
+	cbw[2] = 0x42;
+	cbw[3] = 0x43;
+	benchMscTag++;
+	memcpy(&cbw[4], &benchMscTag, 4);
+	memcpy(&cbw[8], &dataLength, 4);
+	cbw[12] = (in != 0U) ? 0x80 : 0x00;
+	cbw[14] = (uint8_t)cbLength;
+	memcpy(&cbw[15], cb, cbLength);
+
+	benchUsb.IN_ep[1].xfer_len = BENCH_USB_NO_PACKET;
+	benchUsb.OUT_ep[1].xfer_len = BENCH_USB_NO_PACKET;
+	benchUsb.OUT_ep[1].xfer_count = 31;
+	HAL_PCD_DataOutStageCallback(&benchUsb, 1U);
+}
+
+/**
+ * @brief  Data and status stages of a command from the host side. A
+ *         pending storage completion is always reported first: the slot
+ *         it fills goes on while the other one is still on the bus.
+ * @param  dataLength: dCBWDataTransferLength
+ * @param  in: data stage direction
+ * @param  data: data stage source or destination
+ * @param  residue: set to dCSWDataResidue
+ * @retval bCSWStatus, BENCH_MSC_HALTED
+ */
+static int Bench_MscRun(uint32_t dataLength, uint32_t in, uint8_t *data, uint32_t *residue)
+{
+	PCD_EPTypeDef *epIn = &benchUsb.IN_ep[1];
+	PCD_EPTypeDef *epOut = &benchUsb.OUT_ep[1];
+	uint32_t done = 0;
+	uint32_t dataDone = (dataLength == 0U);
+	uint32_t idle = 0;
+
+	for (;;)
+	{
+		if (benchMscPending != 0U)
+		{
+			benchMscPending = 0U;
+			UsbMsc_StorageDone(benchMscResult);
+			idle = 0;
+			continue;
+		}
+		if (epIn->is_stall != 0U)
+		{
+			return BENCH_MSC_HALTED;
+		}
+		if ((in == 0U) && (dataDone == 0U) && (epOut->is_stall != 0U))
+		{
+			/* The device takes no more: clear the halt, then the CSW */
+			Bench_Expect("UsbMsc", Bench_UsbControl(0x02, USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_MSC_EP_OUT,
+				0, NULL) == 0, "OUT halt cleared");
+			dataDone = 1;
+			continue;
+		}
+		if ((in == 0U) && (dataDone == 0U) && (epOut->xfer_len != BENCH_USB_NO_PACKET))
+		{
+			uint32_t chunk = (epOut->xfer_len < dataLength - done) ? epOut->xfer_len : (dataLength - done);
+
+			memcpy(epOut->xfer_buff, &data[done], chunk);
+			done += chunk;
+			dataDone = (done == dataLength);
+			epOut->xfer_len = BENCH_USB_NO_PACKET;
+			epOut->xfer_count = chunk;
+			HAL_PCD_DataOutStageCallback(&benchUsb, 1U);
+			idle = 0;
+			continue;
+		}
+		if (epIn->xfer_len != BENCH_USB_NO_PACKET)
+		{
+			uint32_t length = epIn->xfer_len;
+
+			if ((in != 0U) && (dataDone == 0U))
+			{
+				/* Data until dataLength or a short packet */
+				Bench_Expect("UsbMsc", length <= dataLength - done, "IN data within dCBWDataTransferLength");
+				if (length != 0U)
+				{
+					memcpy(&data[done], epIn->xfer_buff, length);
+				}
+				done += length;
+				dataDone = ((length % USB_OTG_FS_MAX_PACKET_SIZE) != 0U) || (length == 0U) || (done == dataLength);
+				epIn->xfer_len = BENCH_USB_NO_PACKET;
+				HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+				idle = 0;
+				continue;
+			}
+
+			Bench_Expect("UsbMsc", (length == 13U) && (Bench_MscGet32(epIn->xfer_buff) == 0x53425355U)
+				&& (Bench_MscGet32(&epIn->xfer_buff[4]) == benchMscTag), "CSW");
+			Bench_Expect("UsbMsc", dataDone != 0U, "CSW after the data stage");
+			*residue = Bench_MscGet32(&epIn->xfer_buff[8]);
+			length = epIn->xfer_buff[12];
+			epIn->xfer_len = BENCH_USB_NO_PACKET;
+			HAL_PCD_DataInStageCallback(&benchUsb, 1U);
+			Bench_Expect("UsbMsc", epOut->xfer_len == USB_MSC_COMMAND_SIZE, "next CBW armed");
+			return (int)length;
+		}
+
+		/* Nothing moves but the retry timer */
+		Bench_Expect("UsbMsc", ++idle < 8U, "BOT stalled");
+		UsbMsc_Poll();
+	}
+}
+
+static int Bench_MscCommand(const uint8_t *cb, uint32_t cbLength, uint32_t dataLength, uint32_t in, uint8_t *data,
+		uint32_t *residue)
+{
+	Bench_MscSendCbw(cb, cbLength, dataLength, in);
+	return Bench_MscRun(dataLength, in, data, residue);
+}
+
+/* READ(10)/WRITE(10) of count blocks from block, the host expecting
+   dataLength bytes */
+static int Bench_MscReadWrite(uint8_t operation, uint32_t block, uint32_t count, uint32_t dataLength, uint8_t *data,
+		uint32_t *residue)
+{
+	const uint8_t cb[10] = { operation, 0, (uint8_t)(block >> 24), (uint8_t)(block >> 16), (uint8_t)(block >> 8),
+		(uint8_t)block, 0, (uint8_t)(count >> 8), (uint8_t)count, 0 };
+
+	return Bench_MscCommand(cb, sizeof(cb), dataLength, operation == 0x28, data, residue);
+}
+
+static void Bench_MscExpectSense(uint8_t key, uint8_t asc, const char *what)
+{
+	static const uint8_t requestSense[6] = { 0x03, 0, 0, 0, 18, 0 };
+	uint8_t sense[18];
+	uint32_t residue;
+
+	Bench_Expect("UsbMsc", (Bench_MscCommand(requestSense, sizeof(requestSense), sizeof(sense), 1U, sense, &residue) == 0)
+		&& (residue == 0U) && (sense[0] == 0x70U) && (sense[2] == key) && (sense[12] == asc), what);
+}
+
+/* Enumerate, then the SCSI commands a host driver issues, the pipelined
+   transfers and the BOT error cases on the RAM disk */
+static void Bench_UsbMsc_Check(void)
+{
+	static const uint8_t inquiry[6] = { 0x12, 0, 0, 0, 36, 0 };
+	static const uint8_t testUnitReady[6] = { 0x00, 0, 0, 0, 0, 0 };
+	static const uint8_t readCapacity[10] = { 0x25, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	static const uint8_t readFormatCapacities[10] = { 0x23, 0, 0, 0, 0, 0, 0, 0, 12, 0 };
+	static const uint8_t modeSense[6] = { 0x1A, 0, 0x3F, 0, 4, 0 };
+	static const uint8_t startStop[6] = { 0x1B, 0, 0, 0, 1, 0 };
+	static const uint8_t unknown[6] = { 0xC5, 0, 0, 0, 0, 0 };
+	static uint8_t pattern[20U * USB_MSC_BLOCK_SIZE];
+	static uint8_t data[20U * USB_MSC_BLOCK_SIZE];
+	uint8_t cb[6];
+	const uint8_t *descriptor;
+	uint32_t residue;
+	uint32_t count;
+	UsbMsc_StatsTypeDef before;
+	UsbMsc_StatsTypeDef stats;
+
+	benchMscPresent = 0;
+	benchMscDefer = 1;
+	benchMscPending = 0;
+	benchMscBusy = 0;
+	benchMscFailAt = 0;
+	benchMscOps = 0;
+	Bench_UsbStart(&benchMscStorage);
+	Bench_Expect("UsbMsc", Bench_UsbControl(0x00, USB_REQ_SET_ADDRESS, 5, 0, 0, NULL) == 0, "address");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 255, data) == USB_MSC_CONFIG_LENGTH)
+		&& (data[4] == 1U), "configuration descriptor");
+	descriptor = UsbDevice_FindDescriptor(data, USB_MSC_CONFIG_LENGTH, NULL, USB_DESC_INTERFACE);
+	Bench_Expect("UsbMsc", (descriptor != NULL) && (descriptor[4] == 2U) && (descriptor[5] == 0x08U) && (descriptor[6] == 0x06U)
+		&& (descriptor[7] == 0x50U), "mass storage, SCSI, bulk-only");
+	count = 0;
+	for (descriptor = UsbDevice_FindDescriptor(data, USB_MSC_CONFIG_LENGTH, NULL, USB_DESC_ENDPOINT); descriptor != NULL;
+		descriptor = UsbDevice_FindDescriptor(data, USB_MSC_CONFIG_LENGTH, descriptor, USB_DESC_ENDPOINT))
+	{
+		Bench_Expect("UsbMsc", (descriptor[3] == EP_TYPE_BULK) && (descriptor[4] == 64U), "bulk endpoints");
+		count++;
+	}
+	Bench_Expect("UsbMsc", count == 2U, "two endpoints");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0x00, USB_REQ_SET_CONFIGURATION, 1, 0, 0, NULL) == 0)
+		&& (benchUsb.OUT_ep[1].xfer_len == USB_MSC_COMMAND_SIZE), "CBW armed once configured");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0xA1, USB_MSC_GET_MAX_LUN, 0, 0, 1, data) == 1) && (data[0] == 0U),
+		"one logical unit");
+	Bench_Expect("UsbMsc", Bench_UsbControl(0xA1, USB_MSC_GET_MAX_LUN, 1, 0, 1, data) == BENCH_USB_STALL,
+		"GET_MAX_LUN wValue");
+
+	/* INQUIRY, exact and with room to spare: the short answer ends the data stage */
+	Bench_Expect("UsbMsc", (Bench_MscCommand(inquiry, sizeof(inquiry), 36U, 1U, data, &residue) == 0) && (residue == 0U)
+		&& (data[0] == 0x00U) && (data[1] == 0x80U) && (memcmp(&data[8], "STMicro ", 8) == 0), "INQUIRY");
+	memcpy(cb, inquiry, sizeof(cb));
+	cb[4] = 255;
+	Bench_Expect("UsbMsc", (Bench_MscCommand(cb, sizeof(cb), 255U, 1U, data, &residue) == 0) && (residue == 255U - 36U),
+		"INQUIRY residue");
+	cb[1] = 0x01;
+	Bench_Expect("UsbMsc", (Bench_MscCommand(cb, sizeof(cb), 255U, 1U, data, &residue) == 1) && (residue == 255U),
+		"INQUIRY vital product data");
+	Bench_MscExpectSense(0x05, 0x24, "sense invalid field");
+
+	/* No medium, then the medium in */
+	Bench_Expect("UsbMsc", Bench_MscCommand(testUnitReady, sizeof(testUnitReady), 0U, 0U, NULL, &residue) == 1,
+		"TEST UNIT READY without a medium");
+	Bench_MscExpectSense(0x02, 0x3A, "sense medium not present");
+	Bench_MscExpectSense(0x00, 0x00, "sense cleared once read");
+	Bench_Expect("UsbMsc", (Bench_MscCommand(readCapacity, sizeof(readCapacity), 8U, 1U, data, &residue) == 1)
+		&& (residue == 8U), "READ CAPACITY without a medium");
+	benchMscPresent = 1;
+	Bench_Expect("UsbMsc", Bench_MscCommand(testUnitReady, sizeof(testUnitReady), 0U, 0U, NULL, &residue) == 0,
+		"TEST UNIT READY");
+	Bench_Expect("UsbMsc", (Bench_MscCommand(readCapacity, sizeof(readCapacity), 8U, 1U, data, &residue) == 0)
+		&& (data[0] == 0U) && (data[3] == BENCH_MSC_BLOCKS - 1U) && (data[6] == 0x02U) && (data[7] == 0U),
+		"READ CAPACITY");
+	Bench_Expect("UsbMsc", (Bench_MscCommand(readFormatCapacities, sizeof(readFormatCapacities), 12U, 1U, data, &residue) == 0)
+		&& (data[3] == 8U) && (data[6] == 0x01U) && (data[7] == 0U) && (data[8] == 0x02U) && (data[10] == 0x02U),
+		"READ FORMAT CAPACITIES");
+	Bench_Expect("UsbMsc", (Bench_MscCommand(modeSense, sizeof(modeSense), 4U, 1U, data, &residue) == 0) && (data[0] == 3U)
+		&& (data[2] == 0U), "MODE SENSE(6), writable");
+	Bench_Expect("UsbMsc", Bench_MscCommand(startStop, sizeof(startStop), 0U, 0U, NULL, &residue) == 0, "START STOP UNIT");
+	Bench_Expect("UsbMsc", Bench_MscCommand(unknown, sizeof(unknown), 0U, 0U, NULL, &residue) == 1, "unknown command");
+	Bench_MscExpectSense(0x05, 0x20, "sense invalid command");
+
+	/* Write then read back through both slots, the storage completing
+	   while the other slot is on the bus */
+	for (uint32_t i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)(i * 7U + i / USB_MSC_BLOCK_SIZE);
+	}
+	UsbMsc_GetStats(&before);
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x2A, 10, 20, sizeof(pattern), pattern, &residue) == 0) && (residue == 0U)
+		&& (memcmp(&benchMscDisk[10U * USB_MSC_BLOCK_SIZE], pattern, sizeof(pattern)) == 0), "WRITE(10)");
+	memset(data, 0, sizeof(data));
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 10, 20, sizeof(data), data, &residue) == 0) && (residue == 0U)
+		&& (memcmp(data, pattern, sizeof(pattern)) == 0), "READ(10)");
+	UsbMsc_GetStats(&stats);
+	Bench_Expect("UsbMsc", (stats.writeBlocks - before.writeBlocks == 20U) && (stats.readBlocks - before.readBlocks == 20U),
+		"blocks counted");
+	Bench_Expect("UsbMsc", stats.overlapped - before.overlapped == 4U, "storage and bus overlapped");
+
+	/* Completions from within the storage call */
+	benchMscDefer = 0;
+	memset(data, 0, sizeof(data));
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x2A, 100, 3, 3U * USB_MSC_BLOCK_SIZE, pattern, &residue) == 0)
+		&& (Bench_MscReadWrite(0x28, 100, 3, 3U * USB_MSC_BLOCK_SIZE, data, &residue) == 0)
+		&& (memcmp(data, pattern, 3U * USB_MSC_BLOCK_SIZE) == 0), "immediate completions");
+	benchMscDefer = 1;
+
+	/* A busy storage is retried from the poll */
+	UsbMsc_GetStats(&before);
+	benchMscBusy = 3;
+	memset(data, 0, sizeof(data));
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 10, 20, sizeof(data), data, &residue) == 0)
+		&& (memcmp(data, pattern, sizeof(pattern)) == 0), "READ(10) storage busy");
+	UsbMsc_GetStats(&stats);
+	Bench_Expect("UsbMsc", stats.retries - before.retries == 3U, "retries");
+
+	/* Out of range: nothing moves, IN ends with a zero-length packet, OUT halts */
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 250, 10, 10U * USB_MSC_BLOCK_SIZE, data, &residue) == 1)
+		&& (residue == 10U * USB_MSC_BLOCK_SIZE), "READ(10) out of range");
+	Bench_MscExpectSense(0x05, 0x21, "sense out of range");
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x2A, 255, 2, 2U * USB_MSC_BLOCK_SIZE, pattern, &residue) == 1)
+		&& (residue == 2U * USB_MSC_BLOCK_SIZE) && (benchUsb.OUT_ep[1].is_stall == 0U), "WRITE(10) out of range");
+
+	/* Medium errors: the second read fails, the first slot still goes out;
+	   the first write fails, the slot being received completes, OUT halts */
+	benchMscOps = 0;
+	benchMscFailAt = 2;
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 10, 20, sizeof(data), data, &residue) == 1)
+		&& (residue == sizeof(data) - USB_MSC_SLOT_SIZE) && (memcmp(data, pattern, USB_MSC_SLOT_SIZE) == 0),
+		"READ(10) medium error");
+	Bench_MscExpectSense(0x03, 0x11, "sense read error");
+	benchMscOps = 0;
+	benchMscFailAt = 1;
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x2A, 10, 20, sizeof(pattern), pattern, &residue) == 1)
+		&& (residue == sizeof(pattern) - 2U * USB_MSC_SLOT_SIZE), "WRITE(10) medium error");
+	Bench_MscExpectSense(0x03, 0x0C, "sense write error");
+	benchMscFailAt = 0;
+
+	/* Host and device disagreeing on the data stage */
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 0, 8, USB_MSC_BLOCK_SIZE, data, &residue) == 2)
+		&& (residue == USB_MSC_BLOCK_SIZE), "host expects less: phase error");
+	Bench_Expect("UsbMsc", Bench_MscCommand((const uint8_t[10]){ 0x28, 0, 0, 0, 0, 0, 0, 0, 1, 0 }, 10, USB_MSC_BLOCK_SIZE,
+		0U, pattern, &residue) == 2, "data the wrong way: phase error");
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 10, 1, 2U * USB_MSC_BLOCK_SIZE, data, &residue) == 0)
+		&& (residue == USB_MSC_BLOCK_SIZE) && (memcmp(data, pattern, USB_MSC_BLOCK_SIZE) == 0),
+		"host expects more: zero-length packet");
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 0, 0, 0U, NULL, &residue) == 0) && (residue == 0U), "no block");
+
+	/* CBW not valid: both halted, CLEAR_FEATURE does not lift it, a BOT reset does */
+	Bench_MscSendCbw(testUnitReady, 0U, 0U, 0U);
+	Bench_Expect("UsbMsc", Bench_MscRun(0U, 0U, NULL, &residue) == BENCH_MSC_HALTED, "CBW not valid");
+	Bench_Expect("UsbMsc", (benchUsb.IN_ep[1].is_stall != 0U) && (benchUsb.OUT_ep[1].is_stall != 0U), "both halted");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0x02, USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_MSC_EP_IN, 0, NULL) == 0)
+		&& (Bench_UsbControl(0x82, USB_REQ_GET_STATUS, 0, USB_MSC_EP_IN, 2, data) == 2) && (data[0] == 1U),
+		"halt kept until the reset");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0x21, USB_MSC_RESET, 0, 0, 0, NULL) == 0)
+		&& (benchUsb.OUT_ep[1].xfer_len == USB_MSC_COMMAND_SIZE), "BOT reset");
+	Bench_Expect("UsbMsc", (Bench_UsbControl(0x02, USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_MSC_EP_IN, 0, NULL) == 0)
+		&& (Bench_UsbControl(0x02, USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT, USB_MSC_EP_OUT, 0, NULL) == 0)
+		&& (benchUsb.IN_ep[1].is_stall == 0U) && (benchUsb.OUT_ep[1].is_stall == 0U), "halts cleared");
+	Bench_Expect("UsbMsc", Bench_MscCommand(inquiry, sizeof(inquiry), 36U, 1U, data, &residue) == 0, "INQUIRY after reset");
+
+	/* Reset with a read in flight: the next command waits for its completion */
+	Bench_MscSendCbw((const uint8_t[10]){ 0x28, 0, 0, 0, 0, 10, 0, 0, 20, 0 }, 10, sizeof(data), 1U);
+	Bench_Expect("UsbMsc", benchMscPending != 0U, "read in flight");
+	Bench_Expect("UsbMsc", Bench_UsbControl(0x21, USB_MSC_RESET, 0, 0, 0, NULL) == 0, "BOT reset in flight");
+	memset(data, 0, sizeof(data));
+	Bench_Expect("UsbMsc", (Bench_MscReadWrite(0x28, 11, 1, USB_MSC_BLOCK_SIZE, data, &residue) == 0)
+		&& (memcmp(data, &pattern[USB_MSC_BLOCK_SIZE], USB_MSC_BLOCK_SIZE) == 0), "READ(10) after reset");
+
+	UsbMsc_GetStats(&stats);
+	Bench_Expect("UsbMsc", (stats.invalid == 1U) && (stats.resets == 2U) && (stats.phaseErrors == 2U) && (stats.failed == 8U),
+		"command counters");
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* READ(10) of 64 KB at a time, the RAM disk completions deferred as the
+   SD card interrupt reports them */
+void Bench_UsbMsc_Read(uint32_t iterations)
+{
+	static uint8_t data[128U * USB_MSC_BLOCK_SIZE];
+	uint32_t residue;
+	uint32_t blocks = 0;
+	uint64_t start;
+
+	Bench_UsbMsc_Check();
+
+	start = Host_NowNs();
+	while (blocks < iterations)
+	{
+		uint32_t count = (iterations - blocks < 128U) ? (iterations - blocks) : 128U;
+
+		Bench_Expect("UsbMsc", Bench_MscReadWrite(0x28, 0, count, count * USB_MSC_BLOCK_SIZE, data, &residue) == 0,
+			"bench READ(10)");
+		blocks += count;
+	}
+	printf("  %.1f MB/s through the slots, bus and storage copies included\n",
+		(double)iterations * USB_MSC_BLOCK_SIZE * 1000.0 / (double)(Host_NowNs() - start));
+}
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    kernel_port_host.c
+  * @brief   Host port of the kernel on ucontext: runs the scheduler core,
+  *          ready queue and timeout list of kernel.c unchanged.
+  *
+  *          There are no interrupts on the host: a switch requested by the
+  *          core is done at once with swapcontext(), time only advances
+  *          through KernelPort_HostAdvance() (typically from the idle hook).
+  *          Single host thread only.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "kernel.h"
+#include "kernel_port.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ucontext_t hostMainContext;
+static void (*hostTaskExit)(void);
+static uint32_t hostTick;
+
+/* Private functions ---------------------------------------------------------*/
+static void KernelPort_HostEntry(void)
+{
+	/* The switch that started this task was made inside a critical section */
+	__enable_irq();
+	kernelCurrent->entry(kernelCurrent->arg);
+	hostTaskExit();
+}
+
+void KernelPort_StackInit(Kernel_TaskTypeDef *task, void (*exit)(void))
+{
+	hostTaskExit = exit;
+	if (getcontext(&task->context) != 0)
+	{
+		perror("getcontext");
+		abort();
+	}
+	task->context.uc_stack.ss_sp = task->stack;
+	task->context.uc_stack.ss_size = task->stackWords * sizeof(uint32_t);
+	task->context.uc_link = NULL;
+	makecontext(&task->context, KernelPort_HostEntry, 0);
+	task->sp = task->stack + task->stackWords;
+}
+
+void KernelPort_Start(void)
+{
+	swapcontext(&hostMainContext, &kernelCurrent->context);
+}
+
+void KernelPort_Switch(void)
+{
+	Kernel_TaskTypeDef *previous = kernelCurrent;
+
+	Kernel_SwitchContext();
+	swapcontext(&previous->context, &kernelCurrent->context);
+}
+
+uint32_t KernelPort_GetTick(void)
+{
+	return hostTick;
+}
+
+/**
+ * @brief  Return from Kernel_Start() to its caller, from any task.
+ * @retval None
+ */
+void KernelPort_HostStop(void)
+{
+	swapcontext(&kernelCurrent->context, &hostMainContext);
+}
+
+/**
+ * @brief  Advance the kernel time, the host stand-in for SysTick.
+ * @param  ticks: elapsed ticks
+ * @retval None
+ */
+void KernelPort_HostAdvance(uint32_t ticks)
+{
+	hostTick += ticks;
+}
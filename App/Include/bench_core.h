@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    bench_core.h
+  * @brief   CoreMark-style CPU benchmark for the flash interface settings.
+  *
+  *          One iteration runs the three CoreMark kernel types on small
+  *          data sets: linked-list reverse/search/sort, int16 matrix
+  *          arithmetic and a number-parsing state machine, folded into a
+  *          CRC-16 so no work can be optimized away. BenchCore_Report()
+  *          times it with the DWT cycle counter under every combination of
+  *          I-cache, ART accelerator and flash prefetch, for the flash bus
+  *          the image is linked for (make FLASH_BUS=AXIM|ITCM).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BENCH_CORE_H
+#define __BENCH_CORE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define BENCH_CORE_ITERATIONS       200U    /*!< per measured configuration */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*BenchCore_PutCharTypeDef)(char c);
+
+/* Exported functions ------------------------------------------------------- */
+uint16_t BenchCore_Iterate(uint16_t seed);
+uint32_t BenchCore_Measure(uint32_t iterations, uint16_t *crc);
+void BenchCore_Report(uint32_t bootCycles, BenchCore_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_CORE_H */
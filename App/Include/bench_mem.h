@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file    bench_mem.h
+  * @brief   External SDRAM bandwidth benchmark.
+  *
+  *          BenchMem_Report() measures, over a window of the SDRAM heap
+  *          64 times the size of the D-cache, with the DWT cycle counter:
+  *          CPU sequential reads and writes, memcpy() from SRAM, random word
+  *          reads, and SRAM to SDRAM copies by a DMA2 stream driven from its
+  *          registers and by HAL_SDRAM_Write_DMA(), under each MPU mapping
+  *          of the SDRAM: non-cacheable, write-through and write-back.
+  *          Writes are timed until the data is in the SDRAM, cache clean
+  *          included. Sdram_Init() comes first.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BENCH_MEM_H
+#define __BENCH_MEM_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define BENCH_MEM_WINDOW            (256U * 1024U)  /*!< SDRAM bytes, power of two */
+#define BENCH_MEM_BLOCK             (16U * 1024U)   /*!< SRAM source, one DMA transfer */
+#define BENCH_MEM_RANDOM_READS      16384U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*BenchMem_PutCharTypeDef)(char c);
+
+/* Exported functions ------------------------------------------------------- */
+void BenchMem_Report(BenchMem_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_MEM_H */
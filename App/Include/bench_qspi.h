@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file    bench_qspi.h
+  * @brief   External QSPI flash read benchmark.
+  *
+  *          BenchQspi_Report() measures, over a window of the part, with the
+  *          DWT cycle counter: memory-mapped sequential reads, memcpy() to
+  *          SRAM and random word reads, non-cacheable then write-through
+  *          cached, against indirect reads of the FIFO by the CPU and by
+  *          HAL_QSPI_Receive_DMA(); then a function run from the internal
+  *          flash and executed in place from the QSPI flash. QspiFlash_Init()
+  *          comes first.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BENCH_QSPI_H
+#define __BENCH_QSPI_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define BENCH_QSPI_WINDOW           (1024U * 1024U) /*!< bytes of the part, power of two */
+#define BENCH_QSPI_BLOCK            (16U * 1024U)   /*!< SRAM destination, one indirect read */
+#define BENCH_QSPI_RANDOM_READS     4096U
+#define BENCH_QSPI_KERNEL_WORDS     4096U           /*!< input of the executed in place function */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*BenchQspi_PutCharTypeDef)(char c);
+
+/* Exported functions ------------------------------------------------------- */
+void BenchQspi_Report(BenchQspi_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_QSPI_H */
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    block_dev.h
+  * @brief   Block device layer over an asynchronous multi-block device (the
+  *          SD card): a request queue in front of a write-back cache of
+  *          BLOCK_DEV_LINE_BLOCKS-block lines.
+  *
+  *          - Writes are copied into the cache and complete at once; blocks
+  *            of a line written several times, or one after the other, go
+  *            to the device together as one multi-block write (CMD25) when
+  *            the line is evicted, when it is full and the queue is idle,
+  *            or at a flush;
+  *          - a read miss fills the blocks of the line it lacks with one
+  *            multi-block read (CMD18); reads following on from the last
+  *            one start BLOCK_DEV_READ_AHEAD lines of read-ahead while the
+  *            queue is idle;
+  *          - lines are replaced least recently used first, clean ones
+  *            before dirty ones;
+  *          - BlockDev_Flush() is a barrier: it completes once every write
+  *            queued before it is on the device, and reports whether a
+  *            write-back failed since the previous flush.
+  *
+  *          Requests are served in order. The done callback of a request
+  *          is called from the device completion interrupt, or from within
+  *          the call itself when the cache alone serves it. A device busy
+  *          with the previous operation (a card still programming) answers
+  *          HAL_BUSY: BlockDev_Poll(), from a periodic timer, tries again.
+  *
+  *          The cache buffer is given to BlockDev_Init(), internal SRAM or
+  *          SDRAM; the device DMA moves the lines in place.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BLOCK_DEV_H
+#define __BLOCK_DEV_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define BLOCK_DEV_BLOCK_SIZE        512U
+#define BLOCK_DEV_LINE_BLOCKS       8U      /*!< blocks per cache line, at most 32 */
+#define BLOCK_DEV_LINE_SIZE         (BLOCK_DEV_LINE_BLOCKS * BLOCK_DEV_BLOCK_SIZE)
+#define BLOCK_DEV_MAX_LINES         32U     /*!< lines used of a larger cache buffer */
+#define BLOCK_DEV_QUEUE_DEPTH       16U     /*!< requests waiting, the one served included */
+#define BLOCK_DEV_READ_AHEAD        2U      /*!< lines read ahead of a sequential reader */
+#define BLOCK_DEV_POLL_MS           1U      /*!< BlockDev_Poll() period */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*BlockDev_DoneTypeDef)(HAL_StatusTypeDef status, void *arg);
+typedef void (*BlockDev_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	/**
+	 * @brief  Medium size.
+	 * @param  blocks: set to the number of BLOCK_DEV_BLOCK_SIZE blocks
+	 * @retval HAL_OK, HAL_ERROR without a medium
+	 */
+	HAL_StatusTypeDef (*capacity)(uint32_t *blocks);
+	/**
+	 * @brief  Start a multi-block read or write, at most one line.
+	 * @retval HAL_OK: BlockDev_DeviceDone() to come; HAL_BUSY: not started,
+	 *         try again; HAL_ERROR
+	 */
+	HAL_StatusTypeDef (*read)(uint8_t *buffer, uint32_t block, uint32_t count);
+	HAL_StatusTypeDef (*write)(const uint8_t *buffer, uint32_t block, uint32_t count);
+} BlockDev_DeviceTypeDef;
+
+typedef struct
+{
+	uint32_t reads;                     /*!< read requests */
+	uint32_t writes;                    /*!< write requests */
+	uint32_t flushes;
+	uint32_t hits;                      /*!< blocks read from the cache */
+	uint32_t merged;                    /*!< block writes onto a block not written back yet */
+	uint32_t fills;                     /*!< device reads, read misses and read-ahead */
+	uint32_t fillBlocks;
+	uint32_t aheadFills;                /*!< of the fills, read-ahead ones */
+	uint32_t writebacks;                /*!< device writes */
+	uint32_t writebackBlocks;
+	uint32_t busy;                      /*!< device operations refused busy */
+	uint32_t errors;                    /*!< device operations ended in error */
+} BlockDev_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef BlockDev_Init(const BlockDev_DeviceTypeDef *device, uint8_t *cache, uint32_t size);
+uint32_t BlockDev_GetBlockCount(void);
+HAL_StatusTypeDef BlockDev_Read(uint8_t *buffer, uint32_t block, uint32_t count, BlockDev_DoneTypeDef done,
+		void *arg);
+HAL_StatusTypeDef BlockDev_Write(const uint8_t *buffer, uint32_t block, uint32_t count, BlockDev_DoneTypeDef done,
+		void *arg);
+HAL_StatusTypeDef BlockDev_Flush(BlockDev_DoneTypeDef done, void *arg);
+void BlockDev_DeviceDone(HAL_StatusTypeDef status);
+void BlockDev_Poll(void);
+void BlockDev_GetStats(BlockDev_StatsTypeDef *stats);
+void BlockDev_Dump(BlockDev_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLOCK_DEV_H */
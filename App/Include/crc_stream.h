@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    crc_stream.h
+  * @brief   Streaming CRC: CRC peripheral fed by memory-to-memory DMA, with
+  *          a bit-exact software engine (slice-by-8 tables or bitwise).
+  *
+  *          Any CRC of the Rocksoft model (width, poly, init, refin/refout,
+  *          xorout) is described by a CrcStream_ConfigTypeDef; the common
+  *          ones are predefined. A stream accepts chunks of any length and
+  *          alignment; on the peripheral a large chunk is transferred by
+  *          DMA2 Stream0 and CrcStream_Update() returns while it runs, the
+  *          chunk must stay untouched until the next call on any stream.
+  *          Streams may be interleaved, the peripheral state is saved and
+  *          restored through the INIT register on each switch.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRC_STREAM_H
+#define __CRC_STREAM_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define CRC_STREAM_DMA_MIN          64U     /*!< shorter chunks are fed by the CPU */
+
+#ifndef CRC_STREAM_HARDWARE
+#ifdef HOST_BUILD
+#define CRC_STREAM_HARDWARE         0       /*!< no CRC/DMA2 model on the host */
+#else
+#define CRC_STREAM_HARDWARE         1
+#endif
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t poly;                      /*!< normal form, without the x^width term */
+	uint32_t init;
+	uint32_t xorOut;
+	uint8_t width;                      /*!< 1 to 32, the peripheral handles 7, 8, 16 and 32 */
+	uint8_t reflectIn;
+	uint8_t reflectOut;
+} CrcStream_ConfigTypeDef;
+
+typedef struct
+{
+	const CrcStream_ConfigTypeDef *config;
+	uint32_t entry[8][256];             /*!< slice-by-8 tables, 8 KB */
+} CrcStream_TableTypeDef;
+
+typedef enum
+{
+	CRC_STREAM_PERIPHERAL = 0,
+	CRC_STREAM_TABLE,
+	CRC_STREAM_BITWISE
+} CrcStream_EngineTypeDef;
+
+typedef struct
+{
+	const CrcStream_ConfigTypeDef *config;
+	const CrcStream_TableTypeDef *table;
+	CrcStream_EngineTypeDef engine;
+	uint32_t state;                     /*!< CRC register, in the form of the engine */
+	uint32_t length;                    /*!< bytes fed so far */
+	uint8_t pending[3];                 /*!< unaligned tail of the last DMA chunk */
+	uint8_t pendingLength;
+} CrcStream_TypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern const CrcStream_ConfigTypeDef crcStreamCrc32;        /*!< IEEE 802.3, zlib */
+extern const CrcStream_ConfigTypeDef crcStreamCrc32C;       /*!< Castagnoli, iSCSI */
+extern const CrcStream_ConfigTypeDef crcStreamCrc32Mpeg2;   /*!< STM32 CRC reset configuration */
+extern const CrcStream_ConfigTypeDef crcStreamCrc16Ccitt;   /*!< CCITT-FALSE */
+extern const CrcStream_ConfigTypeDef crcStreamCrc16Modbus;
+extern const CrcStream_ConfigTypeDef crcStreamCrc8;         /*!< SMBus */
+
+/* Exported functions ------------------------------------------------------- */
+void CrcStream_Init(void);
+void CrcStream_TableInit(CrcStream_TableTypeDef *table, const CrcStream_ConfigTypeDef *config);
+
+void CrcStream_Begin(CrcStream_TypeDef *stream, const CrcStream_ConfigTypeDef *config,
+		const CrcStream_TableTypeDef *table);
+void CrcStream_Update(CrcStream_TypeDef *stream, const void *data, uint32_t length);
+uint32_t CrcStream_Final(CrcStream_TypeDef *stream);
+uint32_t CrcStream_Compute(const CrcStream_ConfigTypeDef *config, const CrcStream_TableTypeDef *table,
+		const void *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRC_STREAM_H */
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    damage.h
+  * @brief   Damage tracking: the parts of a screen to redraw as a short list
+  *          of rectangles.
+  *
+  *          A rectangle added is clipped to the screen and grown to the tile
+  *          grid, then merged with every rectangle of the list whose
+  *          bounding box with it is no larger than the two areas added up:
+  *          overlapping and adjacent damage becomes one redraw, damage far
+  *          apart stays apart. A full list merges the pair growing the least.
+  *          The list covers all that was added; rectangles of it may still
+  *          overlap, redrawn twice, which a redraw from the scene tolerates.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DAMAGE_H
+#define __DAMAGE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DAMAGE_MAX_RECTS            16U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+} Damage_RectTypeDef;
+
+typedef struct
+{
+	Damage_RectTypeDef rects[DAMAGE_MAX_RECTS];
+	uint32_t count;
+	uint32_t width;                 /*!< screen */
+	uint32_t height;
+	uint32_t tile;                  /*!< power of two, 1: no rounding */
+	uint32_t merges;                /*!< rectangles merged into another */
+	uint32_t forced;                /*!< merges of a full list */
+} Damage_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void Damage_Init(Damage_TypeDef *damage, uint32_t width, uint32_t height, uint32_t tile);
+void Damage_Add(Damage_TypeDef *damage, const Damage_RectTypeDef *rect);
+void Damage_AddAll(Damage_TypeDef *damage);
+uint32_t Damage_Area(const Damage_TypeDef *damage);
+
+static inline void Damage_Clear(Damage_TypeDef *damage)
+{
+	damage->count = 0U;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DAMAGE_H */
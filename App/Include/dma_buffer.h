@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    dma_buffer.h
+  * @brief   Cache-coherent DMA buffer allocator.
+  *
+  *          Buffers are handed out in 32-byte cache lines from two pools:
+  *          - coherent: SRAM2, mapped non-cacheable (or write-through) by the
+  *            MPU, no cache maintenance needed before a DMA transfer;
+  *          - cached: normal write-back RAM, DmaBuffer_PrepareTx/PrepareRx/
+  *            CompleteRx clean and invalidate around each handoff.
+  *          The handoff functions accept any address and do what the memory
+  *          it lives in requires, so drivers call them unconditionally.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DMA_BUFFER_H
+#define __DMA_BUFFER_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DMA_BUFFER_LINE             32U     /*!< Cortex-M7 D-cache line */
+#define DMA_BUFFER_POOL_MAX_LINES   512U
+#define DMA_BUFFER_COHERENT_SIZE    8192U   /*!< bytes taken from SRAM2 */
+#define DMA_BUFFER_CACHED_SIZE      16384U
+
+#ifndef DMA_BUFFER_SRAM2_WRITE_THROUGH
+#define DMA_BUFFER_SRAM2_WRITE_THROUGH  0   /*!< 1: map SRAM2 write-through instead of non-cacheable */
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	DMA_BUFFER_NONCACHEABLE = 0,
+	DMA_BUFFER_WRITE_THROUGH,
+	DMA_BUFFER_WRITE_BACK
+} DmaBuffer_CacheTypeDef;
+
+typedef struct
+{
+	uint8_t *memory;
+	uint32_t lines;
+	DmaBuffer_CacheTypeDef cache;
+	uint32_t freeLines;
+	uint32_t used[DMA_BUFFER_POOL_MAX_LINES / 32U];
+	uint32_t start[DMA_BUFFER_POOL_MAX_LINES / 32U];    /*!< first line of each allocation */
+} DmaBuffer_PoolTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void DmaBuffer_PoolInit(DmaBuffer_PoolTypeDef *pool, void *memory, uint32_t size, DmaBuffer_CacheTypeDef cache);
+void *DmaBuffer_PoolAlloc(DmaBuffer_PoolTypeDef *pool, uint32_t size);
+void DmaBuffer_PoolFree(DmaBuffer_PoolTypeDef *pool, void *buffer);
+
+void DmaBuffer_Init(void);
+void *DmaBuffer_Alloc(uint32_t size);
+void *DmaBuffer_AllocCached(uint32_t size);
+void DmaBuffer_Free(void *buffer);
+uint32_t DmaBuffer_FreeBytes(void);
+
+void DmaBuffer_PrepareTx(const void *buffer, uint32_t length);
+void DmaBuffer_PrepareRx(void *buffer, uint32_t length);
+void DmaBuffer_CompleteRx(void *buffer, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DMA_BUFFER_H */
@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    eth_filter.h
+  * @brief   ETH MAC receive address filter: the MAC drops the frames no
+  *          subscriber asked for before they reach the DMA.
+  *
+  *          Subscribers add destination addresses, unicast or multicast,
+  *          each reference counted. The station address keeps MAC address
+  *          0; the first ETH_FILTER_PERFECT_SLOTS subscriptions, unicast
+  *          ones first, take perfect filter slots MAC address 1 to 3. The
+  *          rest go to the 64-bin hash table, hash unicast or hash
+  *          multicast turned on only for the kind that overflowed: a frame
+  *          then passes on a perfect match or on its bin (HPF). A bin is
+  *          the top 6 bits of the bit-reversed IEEE CRC-32 of the address,
+  *          bin 32 and up in MACHTHR; other addresses sharing a bin pass
+  *          too, the stack above still checks.
+  *          Broadcast and promiscuous mode are switches of their own.
+  *          One VLAN can be selected: its ID goes to the MAC VLAN tag
+  *          register, which on this MAC only marks matching frames, so
+  *          EthIf drops the frames tagged with another ID through
+  *          EthFilter_Accept(). Untagged frames are not affected.
+  *          Every change rebuilds the whole register set and writes it
+  *          with interrupts masked, each register once.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ETH_FILTER_H
+#define __ETH_FILTER_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "eth_pbuf.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define ETH_FILTER_MAX_ADDRESSES    16U     /*!< subscribed addresses, the station address apart */
+#define ETH_FILTER_PERFECT_SLOTS    3U      /*!< MAC address 1 to 3 */
+#define ETH_FILTER_HASH_BINS        64U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*EthFilter_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint32_t addresses;                 /*!< distinct subscribed addresses */
+	uint32_t perfect;                   /*!< of them in perfect filter slots */
+	uint32_t hashed;                    /*!< of them in the hash table */
+	uint32_t hashTable[2];              /*!< MACHTHR, MACHTLR as programmed */
+	uint32_t updates;                   /*!< register set rewrites */
+	uint32_t vlanDropped;               /*!< frames dropped by EthFilter_Accept() */
+} EthFilter_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void EthFilter_Init(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef EthFilter_Subscribe(const uint8_t *address);
+HAL_StatusTypeDef EthFilter_Unsubscribe(const uint8_t *address);
+void EthFilter_SetBroadcast(uint32_t enable);
+void EthFilter_SetPromiscuous(uint32_t enable);
+void EthFilter_SetVlan(uint16_t vlanId);
+uint32_t EthFilter_Accept(const EthPbuf_TypeDef *frame);
+uint32_t EthFilter_Hash(const uint8_t *address);
+void EthFilter_GetStats(EthFilter_StatsTypeDef *stats);
+void EthFilter_Dump(EthFilter_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ETH_FILTER_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    eth_if.h
+  * @brief   ETH network interface: the HAL ETH driver on the pbuf pool, with
+  *          NAPI-style polled reception.
+  *
+  *          The first RX or TX completion interrupt masks the DMA RX, TX and
+  *          RX-buffer-unavailable interrupts and asks for a poll. EthIf_Poll(),
+  *          run from a task, reclaims the sent frames, drains
+  *          HAL_ETH_ReadData() up to a budget and unmasks the interrupts
+  *          only once the RX ring is empty. At low load every frame still
+  *          gets its interrupt; under a flood the interrupt rate drops to
+  *          one per drained ring and the exception entry/exit cost is
+  *          spread over the whole burst.
+  *
+  *          Checksums are always offloaded. The MAC inserts the IPv4 header
+  *          and TCP/UDP/ICMP checksums of every transmitted frame and checks
+  *          those of every received one; frames it finds wrong are counted
+  *          and dropped here, and the handler sees the verdict in the
+  *          frame's ETH_PBUF_FLAG_x_CSUM_OK flags: the stack skips its
+  *          software checksum where they are set.
+  *
+  *          The RX handler runs in the poll context and owns the frame it is
+  *          given. EthIf_Poll() must be called from a single task,
+  *          EthIf_Transmit() from any task.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ETH_IF_H
+#define __ETH_IF_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "eth_pbuf.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define ETH_IF_IRQ_PRIORITY         6U
+#define ETH_IF_POLL_BUDGET          16U     /*!< frames per EthIf_Poll(), half the RX ring */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*EthIf_RxHandlerTypeDef)(EthPbuf_TypeDef *frame);
+typedef void (*EthIf_ScheduleTypeDef)(void);
+typedef void (*EthIf_PutCharTypeDef)(char c);
+
+typedef enum
+{
+	ETH_IF_POLL_DONE = 0,               /*!< ring empty, interrupts unmasked */
+	ETH_IF_POLL_AGAIN,                  /*!< budget used up, poll again after giving up the CPU */
+	ETH_IF_POLL_STARVED                 /*!< pool too low to refill the ring, poll again later */
+} EthIf_PollTypeDef;
+
+typedef struct
+{
+	uint32_t irqs;                      /*!< ETH interrupts taken */
+	uint32_t polls;                     /*!< EthIf_Poll() calls */
+	uint32_t budgetExhausted;           /*!< polls ended by the budget */
+	uint32_t starved;                   /*!< polls ended by an empty pool */
+	uint32_t rxFrames;                  /*!< frames taken from the RX ring, dropped ones included */
+	uint32_t rxBytes;                   /*!< their bytes, FCS excluded */
+	uint32_t rxBurstMax;                /*!< most frames received between two unmasks */
+	uint32_t rxChecksumOk;              /*!< frames with a checksum checked good by the MAC */
+	uint32_t rxChecksumErrors;          /*!< frames dropped: IP header or payload checksum wrong */
+	uint32_t rxErrors;                  /*!< frames dropped: damaged, see ETH_PBUF_FLAG_RX_ERROR */
+	uint32_t rxMissed;                  /*!< frames dropped by the DMA: no free descriptor */
+	uint32_t rxOverflows;               /*!< frames dropped in the RX FIFO (overruns) */
+	uint32_t rxBufferUnavailable;       /*!< DMA receive suspensions (RBUS) */
+	uint32_t txFrames;
+	uint32_t txBytes;
+	uint32_t txBusy;                    /*!< EthIf_Transmit(), EthIf_TransmitBatch() stopped by a full TX ring */
+} EthIf_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef EthIf_Init(const uint8_t *macAddress, EthIf_RxHandlerTypeDef rxHandler,
+		EthIf_ScheduleTypeDef schedule);
+EthIf_PollTypeDef EthIf_Poll(uint32_t budget);
+void EthIf_Drain(uint32_t budget);
+HAL_StatusTypeDef EthIf_Transmit(EthPbuf_TypeDef *frame);
+uint32_t EthIf_TransmitBatch(EthPbuf_TypeDef *const *frames, uint32_t count);
+ETH_HandleTypeDef *EthIf_GetHandle(void);
+void EthIf_GetStats(EthIf_StatsTypeDef *stats);
+void EthIf_Dump(EthIf_PutCharTypeDef putChar);
+
+void EthIf_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ETH_IF_H */
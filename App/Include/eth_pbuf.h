@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    eth_pbuf.h
+  * @brief   Zero-copy packet buffers for the ETH MAC: a fixed pool of
+  *          reference-counted, cache-line aligned frame buffers the HAL ETH
+  *          driver receives into and transmits from.
+  *
+  *          A pbuf describes one data area of ETH_PBUF_SIZE bytes, a frame
+  *          is a chain of pbufs linked by next. Reference counting follows
+  *          lwIP: EthPbuf_Free() drops one reference of the head and walks
+  *          on only through the pbufs it releases, so a chain holds one
+  *          reference on each member and a buffer shared by several frames
+  *          (a common payload behind per-frame headers) takes one per frame.
+  *          The data areas are cacheable SRAM1, maintained through
+  *          dma_buffer.h at each DMA handoff; the headers live in DTCM, off
+  *          the lines the DMA writes.
+  *          EthPbuf_Attach() installs the RX allocate/link and TX free hooks
+  *          of a HAL ETH handle: HAL_ETH_ReadData() then returns a pbuf
+  *          chain, EthPbuf_Transmit() queues one as a scatter-gather
+  *          ETH_BufferTypeDef list and HAL_ETH_ReleaseTxPacket() drops its
+  *          reference once sent.
+  *          The head of a received frame carries the receive status of its
+  *          last descriptor in flags: the checksum engine's verdict on the
+  *          IPv4 header and TCP/UDP/ICMP payload, and the MAC error bits.
+  *          HAL_ETH_GetRxDataErrorCode() only keeps the last frame's.
+  *          On transmit, flags asks for a time stamp of the frame.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ETH_PBUF_H
+#define __ETH_PBUF_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define ETH_PBUF_SIZE               1536U   /*!< data bytes, a full frame in 48 cache lines */
+#define ETH_PBUF_COUNT              80U     /*!< RX ring + TX ring + 16 held by the application, 120 KB */
+#define ETH_PBUF_TX_SEGMENTS        8U      /*!< pbufs per transmitted frame */
+
+#define ETH_PBUF_FLAG_IP_CSUM_OK    0x0001U /*!< IPv4 header checksum checked good by the MAC */
+#define ETH_PBUF_FLAG_L4_CSUM_OK    0x0002U /*!< TCP/UDP/ICMP checksum checked good by the MAC */
+#define ETH_PBUF_FLAG_CSUM_ERROR    0x0004U /*!< IP header or payload checksum wrong */
+#define ETH_PBUF_FLAG_RX_ERROR      0x0008U /*!< damaged frame: CRC, overflow, watchdog, descriptor error */
+#define ETH_PBUF_FLAG_RX_TIMESTAMP  0x0010U /*!< the MAC time stamped the frame, see HAL_ETH_PTP_GetRxTimestamp() */
+#define ETH_PBUF_FLAG_TX_TIMESTAMP  0x0020U /*!< set by the sender: time stamp the frame on transmit */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct EthPbuf
+{
+	struct EthPbuf *next;               /*!< next pbuf of the frame, NULL on the last */
+	uint8_t *payload;                   /*!< first valid byte, inside the data area */
+	uint16_t length;                    /*!< valid bytes at payload */
+	uint16_t totalLength;               /*!< bytes of this pbuf and the ones after it */
+	volatile uint16_t refCount;         /*!< 0: in the free list */
+	uint16_t index;                     /*!< slot in the pool */
+	uint16_t flags;                     /*!< ETH_PBUF_FLAG_x of the frame, on its head */
+} EthPbuf_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void EthPbuf_Init(void);
+EthPbuf_TypeDef *EthPbuf_Alloc(void);
+void EthPbuf_Ref(EthPbuf_TypeDef *pbuf);
+void EthPbuf_Free(EthPbuf_TypeDef *pbuf);
+void EthPbuf_Cat(EthPbuf_TypeDef *head, EthPbuf_TypeDef *tail);
+HAL_StatusTypeDef EthPbuf_Header(EthPbuf_TypeDef *pbuf, int32_t size);
+uint32_t EthPbuf_GetFree(void);
+uint32_t EthPbuf_GetMinFree(void);
+
+HAL_StatusTypeDef EthPbuf_Attach(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef EthPbuf_Transmit(ETH_HandleTypeDef *heth, ETH_TxPacketConfig *config, EthPbuf_TypeDef *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ETH_PBUF_H */
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    frame.h
+  * @brief   COBS framing for the serial link.
+  *
+  *          Each frame is COBS-encoded (no 0x00 inside, at most one byte of
+  *          overhead per 254) and terminated by a 0x00 delimiter, so the
+  *          receiver resynchronizes on the next delimiter after any error.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FRAME_DELIMITER                 0x00U
+
+/* Exported macro ------------------------------------------------------------*/
+/** Worst-case encoded size of a payload, delimiter included */
+#define FRAME_ENCODED_MAX(length)       ((length) + ((length) / 254U) + 2U)
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Frame_HandlerTypeDef)(void *context, const uint8_t *payload, uint32_t length);
+
+typedef struct
+{
+	uint8_t *buffer;                /*!< decoded payload storage */
+	uint32_t size;
+	uint32_t length;                /*!< bytes decoded in the current frame */
+	uint8_t code;                   /*!< current COBS block code, 0 at frame start */
+	uint8_t remaining;              /*!< data bytes left in the current block */
+	uint8_t discard;                /*!< drop bytes until the next delimiter */
+	uint32_t frames;
+	uint32_t errors;                /*!< malformed or oversized frames */
+} Frame_DecoderTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t Frame_Encode(const uint8_t *payload, uint32_t length, uint8_t *out, uint32_t outSize);
+void Frame_DecoderInit(Frame_DecoderTypeDef *decoder, uint8_t *buffer, uint32_t size);
+void Frame_DecoderPush(Frame_DecoderTypeDef *decoder, const uint8_t *data, uint32_t length,
+		Frame_HandlerTypeDef handler, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_H */
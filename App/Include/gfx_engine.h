@@ -0,0 +1,103 @@
+/**
+  ******************************************************************************
+  * @file    gfx_engine.h
+  * @brief   2D graphics engine on the DMA2D: fills, copies, pixel format
+  *          conversions, alpha blends and CLUT loads queued in a ring of
+  *          GFX_ENGINE_QUEUE_DEPTH commands.
+  *
+  *          A command is checked and turned into its register image when it
+  *          is queued; the DMA2D transfer complete interrupt programs the
+  *          next one, so a redraw of many rectangles is queued in one go and
+  *          the CPU never waits on the DMA2D. Commands run in order: a
+  *          marker queued after a redraw calls back once all of it is in
+  *          memory, from the DMA2D interrupt, or from within the call when
+  *          the engine is idle. A full queue answers HAL_BUSY.
+  *
+  *          The engine can run in software instead (GFX_ENGINE_SOFTWARE):
+  *          gfx_soft renders each command with the CPU, in the context of
+  *          the call that queued it, for the throughput comparisons.
+  *
+  *          The DMA2D bypasses the D-cache: buffers sit in memory the MPU
+  *          makes write-through or non-cacheable.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __GFX_ENGINE_H
+#define __GFX_ENGINE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "gfx_soft.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define GFX_ENGINE_QUEUE_DEPTH      32U     /*!< commands waiting, the one running included */
+#define GFX_ENGINE_IRQ_PRIORITY     8U
+#define GFX_ENGINE_MAX_WIDTH        0x3FFFU /*!< NLR.PL and the line offsets */
+#define GFX_ENGINE_MAX_HEIGHT       0xFFFFU /*!< NLR.NL */
+
+/* GfxEngine_Init() modes */
+#define GFX_ENGINE_HARDWARE         0U
+#define GFX_ENGINE_SOFTWARE         1U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*GfxEngine_DoneTypeDef)(void *arg);
+typedef void (*GfxEngine_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	void *address;                      /*!< first pixel, 4-bit formats: low nibble of the byte */
+	uint32_t width;                     /*!< pixels per line, the pitch */
+	uint32_t height;
+	uint32_t format;                    /*!< GFX_ARGB8888 .. GFX_A4 */
+} GfxEngine_BufferTypeDef;
+
+typedef struct
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+} GfxEngine_RectTypeDef;
+
+typedef struct
+{
+	uint32_t commands;                  /*!< queued */
+	uint32_t transfers;                 /*!< fills, copies, conversions and blends done */
+	uint32_t pixels;                    /*!< of the transfers done */
+	uint32_t cluts;                     /*!< CLUT loads done */
+	uint32_t markers;
+	uint32_t full;                      /*!< commands refused, queue full */
+	uint32_t errors;                    /*!< configuration, transfer or CLUT access errors */
+	uint32_t maxDepth;                  /*!< queue high-water mark */
+} GfxEngine_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef GfxEngine_Init(uint32_t mode);
+HAL_StatusTypeDef GfxEngine_Fill(const GfxEngine_BufferTypeDef *dst, const GfxEngine_RectTypeDef *rect,
+		uint32_t argb);
+HAL_StatusTypeDef GfxEngine_Copy(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect);
+HAL_StatusTypeDef GfxEngine_Convert(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t color);
+HAL_StatusTypeDef GfxEngine_Blend(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t color);
+HAL_StatusTypeDef GfxEngine_LoadClut(const void *clut, uint32_t entries, uint32_t format);
+HAL_StatusTypeDef GfxEngine_Marker(GfxEngine_DoneTypeDef done, void *arg);
+uint32_t GfxEngine_IsIdle(void);
+void GfxEngine_IRQHandler(void);
+void GfxEngine_GetStats(GfxEngine_StatsTypeDef *stats);
+void GfxEngine_Dump(GfxEngine_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GFX_ENGINE_H */
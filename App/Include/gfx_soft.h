@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    gfx_soft.h
+  * @brief   Software DMA2D: runs the transfer or CLUT load programmed into a
+  *          DMA2D register block with the CPU, bit-exact with the hardware.
+  *
+  *          It is the reference the DMA2D output is checked against in the
+  *          host golden-image tests, and the CPU side of the throughput
+  *          comparisons. Rules followed (RM0385 DMA2D):
+  *          - an input pixel is expanded to ARGB8888 copying the high bits
+  *            of each component into its low ones (5 bits: c << 3 | c >> 2,
+  *            4 bits: c * 17), a 1-bit alpha giving 0 or 255; L8, L4, AL44
+  *            and AL88 go through the CLUT, A8 and A4 take the layer color;
+  *          - the alpha mode then keeps, replaces or combines the alpha,
+  *            combined as alpha * ALPHA / 255, truncated;
+  *          - blending follows the RM0385 formula in integer arithmetic:
+  *            aMult = aFG * aBG / 255, aOut = aFG + aBG - aMult,
+  *            C = (CFG * aFG + CBG * aBG - CBG * aMult) / aOut;
+  *          - output conversion truncates each component.
+  *
+  *          Memory layout: little-endian words, RGB888 as the bytes B, G,
+  *          R, 4-bit pixels low nibble first, AL44 and AL88 alpha in the
+  *          high half.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __GFX_SOFT_H
+#define __GFX_SOFT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Color modes, the DMA2D CM field values: the first five are output modes
+   too (DMA2D_OUTPUT_*), the others input only */
+#define GFX_ARGB8888                0U
+#define GFX_RGB888                  1U
+#define GFX_RGB565                  2U
+#define GFX_ARGB1555                3U
+#define GFX_ARGB4444                4U
+#define GFX_L8                      5U
+#define GFX_AL44                    6U
+#define GFX_AL88                    7U
+#define GFX_L4                      8U
+#define GFX_A8                      9U
+#define GFX_A4                      10U
+#define GFX_FORMATS                 11U
+#define GFX_OUTPUT_FORMATS          5U
+
+/* DMA2D_CR MODE values */
+#define GFX_MODE_M2M                0U      /*!< copy, no conversion */
+#define GFX_MODE_M2M_PFC            1U      /*!< copy with pixel format conversion */
+#define GFX_MODE_M2M_BLEND          2U      /*!< foreground over background */
+#define GFX_MODE_R2M                3U      /*!< fill with OCOLR */
+
+/* DMA2D_FGPFCCR AM values */
+#define GFX_ALPHA_KEEP              0U
+#define GFX_ALPHA_REPLACE           1U
+#define GFX_ALPHA_COMBINE           2U
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t GfxSoft_Bits(uint32_t format);
+uint32_t GfxSoft_ToArgb(uint32_t pixel, uint32_t format, const volatile uint32_t *clut, uint32_t color);
+uint32_t GfxSoft_FromArgb(uint32_t argb, uint32_t format);
+uint32_t GfxSoft_Blend(uint32_t foreground, uint32_t background);
+void GfxSoft_Execute(DMA2D_TypeDef *dma2d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GFX_SOFT_H */
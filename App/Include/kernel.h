@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    kernel.h
+  * @brief   Small priority-based preemptive task kernel.
+  *
+  *          - 32 priorities, higher number runs first, 0 is the idle task;
+  *            the ready queue is a bitmap plus one FIFO ring per priority,
+  *            the next task is found with a single CLZ;
+  *          - equal priorities are time-sliced round robin on every tick;
+  *          - Kernel_Delay() and Kernel_NotifyWait() timeouts are kept in
+  *            one list sorted by wake-up tick;
+  *          - stacks are filled with KERNEL_STACK_FILL at creation so the
+  *            unused depth can be measured at run time.
+  *          The context switch itself lives in the port: PendSV with lazy
+  *          FPU stacking on the Cortex-M7 (kernel_port.c), ucontext on the
+  *          host (App/Host/Src/kernel_port_host.c).
+  *
+  *          Kernel_Tick() and Kernel_Notify() may be called from interrupts
+  *          at any priority, everything else from tasks only.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_H
+#define __KERNEL_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#ifdef HOST_BUILD
+#include <ucontext.h>
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define KERNEL_PRIORITIES           32U
+#define KERNEL_IDLE_PRIORITY        0U
+#define KERNEL_WAIT_FOREVER         UINT32_MAX
+#define KERNEL_STACK_FILL           0xA5A5A5A5UL
+#ifdef HOST_BUILD
+#define KERNEL_IDLE_STACK_WORDS     4096U   /* host libc needs far more than the target */
+#else
+#define KERNEL_IDLE_STACK_WORDS     256U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Kernel_EntryTypeDef)(void *arg);
+typedef void (*Kernel_PutCharTypeDef)(char c);
+
+typedef enum
+{
+	KERNEL_TASK_READY = 0,
+	KERNEL_TASK_DELAYED,                /*!< Kernel_Delay() */
+	KERNEL_TASK_WAITING,                /*!< Kernel_NotifyWait() */
+	KERNEL_TASK_DONE                    /*!< entry function returned */
+} Kernel_StateTypeDef;
+
+typedef struct Kernel_Task
+{
+	uint32_t *sp;                       /*!< saved stack pointer, first member: used by the PendSV handler */
+	struct Kernel_Task *next;           /*!< ready ring of the priority */
+	struct Kernel_Task *prev;
+	struct Kernel_Task *timeoutNext;    /*!< timeout list, sorted by wakeTick */
+	struct Kernel_Task *link;           /*!< all created tasks, for Kernel_Dump() */
+	uint32_t wakeTick;
+	uint32_t priority;
+	Kernel_StateTypeDef state;
+	uint32_t notify;                    /*!< pending notifications */
+	uint32_t *stack;                    /*!< lowest address of the stack */
+	uint32_t stackWords;
+	Kernel_EntryTypeDef entry;
+	void *arg;
+	const char *name;
+	uint32_t switches;                  /*!< times the task was switched in */
+#ifdef HOST_BUILD
+	ucontext_t context;
+#endif
+} Kernel_TaskTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void Kernel_Init(void);
+void Kernel_TaskCreate(Kernel_TaskTypeDef *task, const char *name, Kernel_EntryTypeDef entry, void *arg,
+		uint32_t priority, uint32_t *stack, uint32_t stackWords);
+void Kernel_Start(void);
+Kernel_TaskTypeDef *Kernel_GetCurrent(void);
+Kernel_TaskTypeDef *Kernel_GetIdleTask(void);
+uint32_t Kernel_GetTick(void);
+
+void Kernel_Yield(void);
+void Kernel_Delay(uint32_t ticks);
+uint32_t Kernel_NotifyWait(uint32_t timeout);
+void Kernel_Notify(Kernel_TaskTypeDef *task);
+void Kernel_Tick(void);
+uint32_t Kernel_TicksToNextTimeout(void);
+uint32_t Kernel_GetStackFree(const Kernel_TaskTypeDef *task);
+void Kernel_Dump(Kernel_PutCharTypeDef putChar);
+
+void Kernel_IdleHook(uint32_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL_H */
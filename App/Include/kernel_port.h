@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    kernel_port.h
+  * @brief   Interface between the kernel core (kernel.c) and its context
+  *          switch port: kernel_port.c on the Cortex-M7, kernel_port_host.c
+  *          (ucontext) on the host.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_PORT_H
+#define __KERNEL_PORT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "kernel.h"
+
+/* Exported variables --------------------------------------------------------*/
+extern Kernel_TaskTypeDef *volatile kernelCurrent;  /*!< running task */
+extern Kernel_TaskTypeDef *volatile kernelNext;     /*!< task to switch to */
+
+/* Exported functions ------------------------------------------------------- */
+/* Provided by the core to the port */
+void Kernel_SwitchContext(void);
+
+/* Provided by the port to the core */
+void KernelPort_StackInit(Kernel_TaskTypeDef *task, void (*exit)(void));
+void KernelPort_Start(void);
+void KernelPort_Switch(void);
+uint32_t KernelPort_GetTick(void);
+
+#ifdef HOST_BUILD
+void KernelPort_HostStop(void);
+void KernelPort_HostAdvance(uint32_t ticks);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL_PORT_H */
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    lcd_comp.h
+  * @brief   Partial-refresh compositor of the two LTDC layers.
+  *
+  *          Layer 1 is the scene, drawn into the lcd_fb buffers: a background
+  *          color under up to LCD_COMP_MAX_SURFACES surfaces, in id order,
+  *          copied (LCD_COMP_OPAQUE) or alpha blended (LCD_COMP_BLEND) by the
+  *          DMA2D. A surface set, moved or invalidated damages the screen;
+  *          LcdComp_Render() redraws the damage only, merged and grown to
+  *          LCD_COMP_TILE tiles, into the buffer acquired, then presents it.
+  *          Each buffer keeps the damage of the frames drawn into the others
+  *          since it was drawn, so it is brought up to date, not redrawn.
+  *
+  *          Layer 2 is the sprite: an image of its own the LTDC blends over
+  *          layer 1, moved with the window registers in the vertical
+  *          blanking, layer 1 neither redrawn nor damaged.
+  *
+  *          LcdFb_Init() comes first; the compositor is called from one
+  *          thread, the renderer.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LCD_COMP_H
+#define __LCD_COMP_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "damage.h"
+#include "gfx_engine.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define LCD_COMP_MAX_SURFACES       8U
+#define LCD_COMP_TILE               16U     /*!< damage granularity, pixels */
+#define LCD_COMP_SPRITE_LAYER       1U      /*!< LTDC layer 2 */
+
+/* LcdComp_SurfaceTypeDef modes */
+#define LCD_COMP_OPAQUE             0U      /*!< covers what is under */
+#define LCD_COMP_BLEND              1U      /*!< blended over what is under, its alpha */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*LcdComp_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	GfxEngine_BufferTypeDef image;      /*!< all of it drawn, held while set */
+	uint32_t x;                         /*!< screen position, the part off screen clipped */
+	uint32_t y;
+	uint32_t mode;                      /*!< LCD_COMP_OPAQUE, LCD_COMP_BLEND */
+	uint32_t color;                     /*!< as GfxEngine_Convert(): alpha, color of A8 and A4 */
+} LcdComp_SurfaceTypeDef;
+
+typedef struct
+{
+	uint32_t frames;                    /*!< rendered and presented */
+	uint32_t idle;                      /*!< renders with no damage, no frame */
+	uint32_t busy;                      /*!< renders with no buffer free */
+	uint32_t rects;                     /*!< redrawn */
+	uint32_t pixels;                    /*!< redrawn, of the rectangles */
+	uint32_t fills;
+	uint32_t copies;                    /*!< copies and conversions */
+	uint32_t blends;
+	uint32_t stalls;                    /*!< DMA2D commands retried, queue full */
+	uint32_t errors;                    /*!< DMA2D commands refused */
+	uint32_t spriteMoves;
+} LcdComp_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef LcdComp_Init(LTDC_HandleTypeDef *hltdc, uint32_t background);
+HAL_StatusTypeDef LcdComp_SetSurface(uint32_t id, const LcdComp_SurfaceTypeDef *surface);
+HAL_StatusTypeDef LcdComp_MoveSurface(uint32_t id, uint32_t x, uint32_t y);
+void LcdComp_Invalidate(const GfxEngine_RectTypeDef *rect);
+HAL_StatusTypeDef LcdComp_Render(void);
+HAL_StatusTypeDef LcdComp_SetSprite(const GfxEngine_BufferTypeDef *image, int32_t x, int32_t y);
+HAL_StatusTypeDef LcdComp_MoveSprite(int32_t x, int32_t y);
+void LcdComp_GetStats(LcdComp_StatsTypeDef *stats);
+void LcdComp_Dump(LcdComp_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_COMP_H */
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    lcd_fb.h
+  * @brief   LTDC framebuffer manager: two or three buffers of one layer,
+  *          flipped in the vertical blanking, never while scanned out.
+  *
+  *          A buffer goes FREE -> DRAWING (LcdFb_Acquire()) -> READY
+  *          (LcdFb_Present()) -> PENDING -> SCANNING -> FREE:
+  *          - the line event, LCD_FB_FLIP_LINES before the end of the active
+  *            area, writes the address of the newest READY buffer into the
+  *            layer shadow registers and asks for a vertical blanking
+  *            reload: it is PENDING;
+  *          - the reload interrupt, at the start of the blanking, makes it
+  *            SCANNING and frees the one scanned out until then.
+  *          Frame N + 1 is drawn while frame N is scanned out; with three
+  *          buffers the renderer never waits for the blanking, a frame
+  *          presented while another is READY replacing it (dropped).
+  *
+  *          LcdFb_Present() may be called from any context, typically a
+  *          GfxEngine_Marker() callback queued after the DMA2D commands
+  *          drawing the frame. The freed callback, from the reload
+  *          interrupt, tells the renderer a buffer can be acquired.
+  *
+  *          HAL_LTDC_Init() with the panel timings comes first; the buffers
+  *          live in external SDRAM, given to LcdFb_Init().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LCD_FB_H
+#define __LCD_FB_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "gfx_engine.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define LCD_FB_MAX_BUFFERS          3U
+#define LCD_FB_ALIGN                64U     /*!< buffer start, SDRAM burst and DMA2D friendly */
+#define LCD_FB_FLIP_LINES           8U      /*!< line event this many lines before the end of the active area */
+#define LCD_FB_IRQ_PRIORITY         4U      /*!< above the peripherals, the flip has LCD_FB_FLIP_LINES lines */
+#define LCD_FB_HISTOGRAM            4U      /*!< frames on screen 1, 2, 3, 4 or more refreshes */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	LCD_FB_FREE = 0,
+	LCD_FB_DRAWING,
+	LCD_FB_READY,
+	LCD_FB_PENDING,
+	LCD_FB_SCANNING
+} LcdFb_StateTypeDef;
+
+typedef void (*LcdFb_FreedTypeDef)(void);
+typedef void (*LcdFb_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint32_t refreshes;                 /*!< line events, one a refresh */
+	uint32_t presented;
+	uint32_t flips;                     /*!< frames put on screen */
+	uint32_t dropped;                   /*!< frames READY replaced by a newer one, never shown */
+	uint32_t late;                      /*!< refreshes repeating a frame while the next one was drawn */
+	uint32_t deferred;                  /*!< flips put off a refresh, the LTDC handle locked */
+	uint32_t errors;                    /*!< FIFO underruns and transfer errors */
+	uint32_t frameTime[LCD_FB_HISTOGRAM]; /*!< frames by refreshes on screen */
+	uint32_t renderMin;                 /*!< DWT cycles from LcdFb_Acquire() to LcdFb_Present() */
+	uint32_t renderMax;
+	uint32_t renderLast;
+} LcdFb_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef LcdFb_Init(LTDC_HandleTypeDef *hltdc, const LTDC_LayerCfgTypeDef *layer, uint32_t layerIdx,
+		uint8_t *memory, uint32_t size, uint32_t count, LcdFb_FreedTypeDef freed);
+GfxEngine_BufferTypeDef *LcdFb_Acquire(void);
+HAL_StatusTypeDef LcdFb_Present(const GfxEngine_BufferTypeDef *buffer);
+const GfxEngine_BufferTypeDef *LcdFb_GetFront(void);
+LcdFb_StateTypeDef LcdFb_GetState(const GfxEngine_BufferTypeDef *buffer);
+void LcdFb_IRQHandler(void);
+void LcdFb_GetStats(LcdFb_StatsTypeDef *stats);
+void LcdFb_Dump(LcdFb_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_FB_H */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    mem_heap.h
+  * @brief   General purpose heap over a caller-provided memory region.
+  *
+  *          Blocks of any size are carved first fit from a free list and
+  *          merged with their free neighbours when released (boundary
+  *          tags). Block headers take one cache line and payloads start on
+  *          the next, so no allocation shares a D-cache line with another
+  *          block: every buffer handed out is safe for DMA with the
+  *          dma_buffer.h handoff calls.
+  *
+  *          The free list is walked with interrupts masked: meant for large,
+  *          long-lived buffers (frame buffers, caches, tables), not per-packet
+  *          allocation.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MEM_HEAP_H
+#define __MEM_HEAP_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define MEM_HEAP_ALIGN              32U     /*!< Cortex-M7 D-cache line, header size and payload alignment */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct MemHeap_Block
+{
+	uint32_t size;                      /*!< bytes, header included, multiple of MEM_HEAP_ALIGN; bit 0: used */
+	uint32_t prevSize;                  /*!< of the block before in memory, 0 for the first */
+	struct MemHeap_Block *next;         /*!< free list, free blocks only */
+	struct MemHeap_Block *prev;
+} MemHeap_BlockTypeDef;
+
+typedef struct
+{
+	uint8_t *memory;
+	uint32_t size;
+	MemHeap_BlockTypeDef *freeList;
+	uint32_t freeBytes;                 /*!< headers of the free blocks included */
+	uint32_t minFreeBytes;              /*!< low-water mark */
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+} MemHeap_TypeDef;
+
+typedef struct
+{
+	uint32_t size;                      /*!< of the region, aligned */
+	uint32_t freeBytes;
+	uint32_t minFreeBytes;
+	uint32_t largestFree;               /*!< payload of the largest free block */
+	uint32_t freeBlocks;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+} MemHeap_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void MemHeap_Init(MemHeap_TypeDef *heap, void *memory, uint32_t size);
+void *MemHeap_Alloc(MemHeap_TypeDef *heap, uint32_t size);
+void MemHeap_Free(MemHeap_TypeDef *heap, void *buffer);
+void MemHeap_GetStats(MemHeap_TypeDef *heap, MemHeap_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEM_HEAP_H */
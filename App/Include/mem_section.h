@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    mem_section.h
+  * @brief   Placement of code and data in the tightly coupled memories.
+  *
+  *          ITCM_TEXT   code copied to ITCM (0x00000000) by the startup,
+  *                      zero wait state, no flash/ART/I-cache involvement
+  *          DTCM_DATA   initialized data in DTCM (0x20000000)
+  *          DTCM_BSS    zero-initialized data in DTCM
+  *          SRAM2_DMA   uninitialized DMA buffers in SRAM2, mapped
+  *                      non-cacheable by dma_buffer.c
+  *          SDRAM_DATA  uninitialized data in the external SDRAM (0xC0000000),
+  *                      not to be touched before Sdram_Init()
+  *          QSPI_TEXT   cold code executed in place from the QSPI flash
+  *                      (0x90000000), not to be called before
+  *                      QspiFlash_Init() nor during its indirect accesses
+  *          QSPI_RODATA constant data read in place from the QSPI flash,
+  *                      same rules; fonts, images, tables
+  *
+  *          The sections are laid out by Build/Linker/stm32f746zg_flash.ld;
+  *          Build/Scripts/map_check.py verifies the result. Code in ITCM
+  *          reaches flash through linker veneers, keep it to leaf-heavy paths.
+  *          The QSPI content is written by the programmer's external loader,
+  *          not by the startup.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MEM_SECTION_H
+#define __MEM_SECTION_H
+
+#ifdef HOST_BUILD
+/* One flat memory on the host */
+#define ITCM_TEXT
+#define DTCM_DATA
+#define DTCM_BSS
+#define SRAM2_DMA
+#define SDRAM_DATA
+#define QSPI_TEXT
+#define QSPI_RODATA
+#else
+#define ITCM_TEXT       __attribute__((section(".itcm_text"), noinline))
+#define DTCM_DATA       __attribute__((section(".dtcm_data")))
+#define DTCM_BSS        __attribute__((section(".dtcm_bss")))
+#define SRAM2_DMA       __attribute__((section(".sram2_dma")))
+#define SDRAM_DATA      __attribute__((section(".sdram")))
+#define QSPI_TEXT       __attribute__((section(".qspi.text"), noinline))
+#define QSPI_RODATA     __attribute__((section(".qspi.rodata")))
+#endif
+
+#endif /* __MEM_SECTION_H */
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    mpu_regions.h
+  * @brief   MPU region table generation for mpu_armv7.h ARM_MPU_Load().
+  *
+  *          MpuRegions_Build() turns (base, size, memory type) descriptors
+  *          into RBAR/RASR pairs. A range that is not a naturally aligned
+  *          power of two is covered by the smallest enclosing region with the
+  *          unused eighths masked out through the sub-region disable bits.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MPU_REGIONS_H
+#define __MPU_REGIONS_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	MPU_REGIONS_STRONGLY_ORDERED = 0,
+	MPU_REGIONS_DEVICE,
+	MPU_REGIONS_NORMAL_NONCACHEABLE,
+	MPU_REGIONS_NORMAL_WRITE_THROUGH,
+	MPU_REGIONS_NORMAL_WRITE_BACK           /*!< write-back, read and write allocate */
+} MpuRegions_MemoryTypeDef;
+
+typedef struct
+{
+	uint32_t base;
+	uint32_t size;                          /*!< bytes, 32 minimum */
+	MpuRegions_MemoryTypeDef type;
+	uint8_t accessPermission;               /*!< ARM_MPU_AP_xxx */
+	uint8_t executeNever;
+	uint8_t shareable;
+} MpuRegions_DescTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t MpuRegions_Build(const MpuRegions_DescTypeDef *desc, uint32_t count, uint32_t firstRegion,
+		ARM_MPU_Region_t *table);
+void MpuRegions_Load(const ARM_MPU_Region_t *table, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU_REGIONS_H */
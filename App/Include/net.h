@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    net.h
+  * @brief   Minimal IPv4 stack on the EthIf interface: ARP, ICMP echo and
+  *          UDP, built for streaming datagrams with no copy.
+  *
+  *          - ARP: a static cache of NET_ARP_CACHE_SIZE entries, permanent
+  *            ones set with Net_ArpAdd() and learned ones filled from the
+  *            ARP traffic addressed to this host, replaced round robin.
+  *            No aging and no queueing: a send to an unresolved address
+  *            broadcasts a request and returns HAL_BUSY.
+  *          - IPv4: one address, netmask and gateway; no options on send,
+  *            fragments dropped on receive.
+  *          - ICMP: echo requests answered in place in the received buffer.
+  *          - UDP: a connected socket keeps its Ethernet/IPv4/UDP header
+  *            precomputed, sending a datagram copies those 42 bytes into
+  *            the headroom of the payload pbuf and patches three length
+  *            fields and the IP ID. Net_UdpSendBatch() queues several
+  *            datagrams in one EthIf_TransmitBatch() call. Received
+  *            datagrams are handed to the socket callback in the RX DMA
+  *            buffer itself, payload and length narrowed to the UDP data.
+  *          Checksums are left to the MAC (eth_if.h); a frame whose
+  *          ETH_PBUF_FLAG_x_CSUM_OK flag is missing is checked in software.
+  *
+  *          Net_Receive() runs in the EthIf poll task, the send functions
+  *          from any task; a socket is used by one task at a time.
+  *          Addresses and ports are in host byte order.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NET_H
+#define __NET_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "eth_pbuf.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define NET_ARP_CACHE_SIZE          8U
+#define NET_ETH_HEADER              14U
+#define NET_IP_HEADER               20U
+#define NET_UDP_HEADER              8U
+#define NET_UDP_HEADROOM            (NET_ETH_HEADER + NET_IP_HEADER + NET_UDP_HEADER)
+#define NET_UDP_MAX_PAYLOAD         1472U   /*!< 1500-byte MTU, no fragmentation */
+#define NET_UDP_BATCH_MAX           8U      /*!< datagrams per Net_UdpSendBatch(), interrupts masked meanwhile */
+#define NET_IP_TTL                  64U
+
+#define NET_IP_ADDR(a, b, c, d)     (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+#define NET_IP_BROADCAST            0xFFFFFFFFUL
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Net_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint32_t address;
+	uint16_t port;
+} Net_EndpointTypeDef;
+
+/**
+ * @brief  Datagram received on a bound port.
+ * @param  context: given to Net_UdpBind()
+ * @param  datagram: the RX buffer, payload/length/totalLength set to the
+ *         UDP data; owned by the callback, which frees it or keeps it
+ * @param  from: sender
+ */
+typedef void (*Net_UdpRecvTypeDef)(void *context, EthPbuf_TypeDef *datagram, const Net_EndpointTypeDef *from);
+
+typedef struct Net_UdpSocket
+{
+	struct Net_UdpSocket *next;         /*!< bound sockets */
+	uint16_t localPort;
+	Net_UdpRecvTypeDef recv;
+	void *context;
+	Net_EndpointTypeDef remote;         /*!< set by Net_UdpConnect() */
+	uint16_t ipId;
+	uint8_t connected;
+	uint8_t header[NET_UDP_HEADROOM];   /*!< to the remote, length fields and IP ID patched per datagram */
+} Net_UdpSocketTypeDef;
+
+typedef struct
+{
+	uint32_t arpRequests;               /*!< ARP requests sent */
+	uint32_t arpReplies;                /*!< ARP replies sent */
+	uint32_t arpUnresolved;             /*!< sends refused for want of an ARP entry */
+	uint32_t icmpEchoes;                /*!< echo replies sent */
+	uint32_t ipDropped;                 /*!< malformed, fragmented, other host, unknown protocol */
+	uint32_t checksumSoftware;          /*!< headers checked in software, no MAC verdict */
+	uint32_t udpRx;
+	uint32_t udpNoPort;                 /*!< datagrams to an unbound port */
+	uint32_t udpTx;
+	uint32_t txBusy;                    /*!< datagrams refused: TX ring full, no headroom or pbuf */
+} Net_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef Net_Init(uint32_t address, uint32_t netmask, uint32_t gateway);
+void Net_Receive(EthPbuf_TypeDef *frame);
+
+HAL_StatusTypeDef Net_ArpAdd(uint32_t address, const uint8_t *mac);
+uint32_t Net_ArpLookup(uint32_t address, uint8_t *mac);
+
+HAL_StatusTypeDef Net_UdpBind(Net_UdpSocketTypeDef *socket, uint16_t port, Net_UdpRecvTypeDef recv, void *context);
+void Net_UdpUnbind(Net_UdpSocketTypeDef *socket);
+HAL_StatusTypeDef Net_UdpConnect(Net_UdpSocketTypeDef *socket, uint32_t address, uint16_t port);
+EthPbuf_TypeDef *Net_UdpAlloc(void);
+HAL_StatusTypeDef Net_UdpSend(Net_UdpSocketTypeDef *socket, EthPbuf_TypeDef *datagram);
+uint32_t Net_UdpSendBatch(Net_UdpSocketTypeDef *socket, EthPbuf_TypeDef *const *datagrams, uint32_t count);
+HAL_StatusTypeDef Net_UdpSendTo(Net_UdpSocketTypeDef *socket, const Net_EndpointTypeDef *to,
+		EthPbuf_TypeDef *datagram);
+
+void Net_GetStats(Net_StatsTypeDef *stats);
+void Net_Dump(Net_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_H */
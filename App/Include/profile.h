@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    profile.h
+  * @brief   DWT cycle-counter profiling probes and latency histograms.
+  *
+  *          PROFILE_BEGIN(id)/PROFILE_END(id) bracket a code region and add
+  *          the elapsed DWT->CYCCNT cycles to the histogram of probe id.
+  *          Histograms use 4 sub-buckets per power of two (<= 25% error on
+  *          percentiles) and report count/min/max/p50/p99.
+  *          The probes compile to nothing unless PROFILE_ENABLE is 1.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief  Probe identifiers, one histogram each.
+ * @note   A probe must only be recorded from one execution context
+ *         (thread or one IRQ priority): updates are not atomic.
+ */
+typedef enum
+{
+	PROFILE_ID_SYSTICK_IRQ = 0,
+	PROFILE_ID_USART1_ENQUEUE,          /*!< one character into the TX ring, waits for room included */
+	PROFILE_ID_USART1_IRQ,
+	PROFILE_ID_USART1_RX_DMA_IRQ,
+	PROFILE_ID_USART1_TX_DMA_IRQ,
+	PROFILE_ID_GPIO_TOGGLE,
+	PROFILE_ID_COUNT
+} Profile_IdTypeDef;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t p50;
+	uint32_t p99;
+	uint64_t total;
+} Profile_StatsTypeDef;
+
+typedef void (*Profile_PutCharTypeDef)(char c);
+
+/* Exported constants --------------------------------------------------------*/
+#define PROFILE_SUB_BUCKETS     4U
+#define PROFILE_BUCKETS         124U    /*!< covers the full 32-bit cycle range */
+
+/* Exported macro ------------------------------------------------------------*/
+#if defined(PROFILE_ENABLE) && (PROFILE_ENABLE == 1)
+#define PROFILE_BEGIN(id)       uint32_t profileStart_##id = Profile_GetCycles()
+#define PROFILE_END(id)         Profile_Record((id), Profile_GetCycles() - profileStart_##id)
+#else
+#define PROFILE_BEGIN(id)       ((void)0)
+#define PROFILE_END(id)         ((void)0)
+#endif /* PROFILE_ENABLE */
+
+/* Exported functions ------------------------------------------------------- */
+/**
+ * @brief  Read the free-running cycle counter.
+ * @retval Core clock cycles since Profile_Init() (wraps every ~19.9 s @ 216 MHz)
+ */
+static inline uint32_t Profile_GetCycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+void Profile_Init(void);
+void Profile_Reset(void);
+void Profile_Record(Profile_IdTypeDef id, uint32_t cycles);
+void Profile_GetStats(Profile_IdTypeDef id, Profile_StatsTypeDef *stats);
+void Profile_Dump(Profile_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILE_H */
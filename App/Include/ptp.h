@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file    ptp.h
+  * @brief   IEEE 1588-2008 ordinary clock, slave only, on the ETH MAC time
+  *          stamp unit.
+  *
+  *          PTP over Ethernet (ethertype 0x88F7), end-to-end delay
+  *          mechanism, one- and two-step masters. The first master heard
+  *          in an Announce is followed until its Announce messages stop;
+  *          there is no best master clock algorithm.
+  *          The MAC time stamps Sync on receive and the Delay_Req frames
+  *          sent here. Receive time stamps are read with
+  *          HAL_ETH_PTP_GetRxTimestamp() right after the frame left the
+  *          ring. Transmit time stamps come from the HAL TX PTP callback
+  *          when the frame is reclaimed and wait in a capture ring until
+  *          the matching Delay_Resp comes in.
+  *          Each Sync/Follow_Up pair gives an offset sample for the PI
+  *          servo of ptp_servo.h, which trims the time stamp addend (fine
+  *          correction) or steps the clock with HAL_ETH_PTP_AddTimeOffset().
+  *          A Delay_Req follows each sample.
+  *
+  *          Ptp_Receive() and Ptp_Tick() must run in the same task as
+  *          EthIf_Poll().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PTP_H
+#define __PTP_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "eth_pbuf.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define PTP_ETHERTYPE               0x88F7U
+#define PTP_DOMAIN                  0U
+#define PTP_UPDATE_HZ               100000000U  /*!< time stamp counter update rate: 10 ns steps */
+#define PTP_TX_RING_SIZE            8U          /*!< transmit time stamps awaiting their Delay_Resp */
+#define PTP_ANNOUNCE_RECEIPT_TIMEOUT 3U         /*!< Announce intervals without one before the master is dropped */
+#define PTP_HEADER_SIZE             34U
+#define PTP_DELAY_REQ_SIZE          44U
+
+/* Message types (messageType field) */
+#define PTP_MSG_SYNC                0x0U
+#define PTP_MSG_DELAY_REQ           0x1U
+#define PTP_MSG_FOLLOW_UP           0x8U
+#define PTP_MSG_DELAY_RESP          0x9U
+#define PTP_MSG_ANNOUNCE            0xBU
+
+#define PTP_FLAG_TWO_STEP           0x0200U     /*!< flagField: a Follow_Up carries the origin time */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Ptp_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint8_t clockIdentity[8];
+	uint16_t portNumber;
+} Ptp_PortIdentityTypeDef;
+
+typedef struct
+{
+	uint8_t type;                       /*!< PTP_MSG_x */
+	uint8_t domain;
+	uint16_t length;                    /*!< messageLength */
+	uint16_t flags;                     /*!< flagField, octet 0 in the high byte */
+	int64_t correction;                 /*!< correctionField, ns (2^-16 ns dropped) */
+	Ptp_PortIdentityTypeDef source;
+	uint16_t sequenceId;
+	int8_t logInterval;                 /*!< logMessageInterval */
+	int64_t timestamp;                  /*!< origin, precise origin or receive timestamp, ns */
+	Ptp_PortIdentityTypeDef requesting; /*!< Delay_Resp only */
+} Ptp_MessageTypeDef;
+
+typedef enum
+{
+	PTP_STATE_LISTENING = 0,            /*!< no master */
+	PTP_STATE_UNCALIBRATED,             /*!< master chosen, servo not locked */
+	PTP_STATE_SLAVE                     /*!< servo locked */
+} Ptp_StateTypeDef;
+
+typedef struct
+{
+	Ptp_StateTypeDef state;
+	uint32_t announces;
+	uint32_t syncs;
+	uint32_t followUps;
+	uint32_t delayReqs;
+	uint32_t delayResps;
+	uint32_t ignored;                   /*!< other domain or master, unmatched or malformed */
+	uint32_t txTimestampMissing;        /*!< Delay_Resp without the Delay_Req time stamp */
+	uint32_t steps;                     /*!< clock steps */
+	uint32_t samples;                   /*!< locked offset samples since Ptp_ClearStats() */
+	int64_t offset;                     /*!< last offset from the master, ns */
+	int64_t offsetMin;                  /*!< over the locked samples */
+	int64_t offsetMax;
+	int64_t offsetMean;
+	uint32_t offsetRms;                 /*!< ns, root mean square of the locked offsets */
+	uint32_t jitter;                    /*!< ns, standard deviation of the locked offsets */
+	int64_t pathDelay;                  /*!< mean path delay, ns */
+	int32_t ppb;                        /*!< frequency correction applied */
+} Ptp_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef Ptp_Init(void);
+void Ptp_Receive(EthPbuf_TypeDef *frame);
+void Ptp_Tick(uint32_t nowMs);
+int64_t Ptp_GetTime(void);
+void Ptp_GetStats(Ptp_StatsTypeDef *stats);
+void Ptp_ClearStats(void);
+void Ptp_Dump(Ptp_PutCharTypeDef putChar);
+
+uint32_t Ptp_ParseMessage(const uint8_t *data, uint32_t length, Ptp_MessageTypeDef *message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PTP_H */
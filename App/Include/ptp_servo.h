@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    ptp_servo.h
+  * @brief   PI clock servo of the PTP slave: turns the measured offset from
+  *          the master into a frequency correction in ppb, or a time step.
+  *
+  *          The loop follows the linuxptp PI servo. The first sample is
+  *          only stored; the second gives the frequency error from the
+  *          offset drift between the two and, if the offset is past the
+  *          step threshold, asks for a step of the clock. From then on
+  *          each sample runs the PI controller:
+  *              ppb = -(kp * offset + integral), integral += ki * offset
+  *          with the integral starting at the measured frequency error.
+  *          A locked servo that sees an offset past the step threshold
+  *          goes back to the first state.
+  *          Pure integer arithmetic, no hardware access: the caller applies
+  *          the result.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PTP_SERVO_H
+#define __PTP_SERVO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define PTP_SERVO_KP                45875   /*!< 0.7 in Q16, per 1 s sample interval */
+#define PTP_SERVO_KI                19661   /*!< 0.3 in Q16, per 1 s sample interval */
+#define PTP_SERVO_MAX_PPB           500000  /*!< +-500 ppm, a crystal far out of spec */
+#define PTP_SERVO_STEP_THRESHOLD    20000LL /*!< ns, larger offsets are stepped */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	PTP_SERVO_UNLOCKED = 0,             /*!< collecting the first two samples */
+	PTP_SERVO_JUMP,                     /*!< step the clock by -offset, then apply ppb */
+	PTP_SERVO_LOCKED                    /*!< apply ppb */
+} PtpServo_StateTypeDef;
+
+typedef struct
+{
+	int64_t kp;                         /*!< Q16 ppb per ns of offset */
+	int64_t ki;                         /*!< Q16 ppb per ns of offset */
+	int64_t stepThreshold;              /*!< ns, 0: never step once locked */
+	int32_t maxPpb;
+	PtpServo_StateTypeDef state;
+	uint32_t count;                     /*!< samples since unlocked, up to 2 */
+	int64_t offset0;                    /*!< first sample */
+	int64_t local0;
+	int64_t drift;                      /*!< integral term, Q16 ppb */
+} PtpServo_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void PtpServo_Init(PtpServo_TypeDef *servo, int32_t logInterval);
+void PtpServo_Reset(PtpServo_TypeDef *servo);
+PtpServo_StateTypeDef PtpServo_Sample(PtpServo_TypeDef *servo, int64_t offset, int64_t localTime,
+		int32_t *ppb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PTP_SERVO_H */
@@ -0,0 +1,134 @@
+/**
+  ******************************************************************************
+  * @file    qspi_flash.h
+  * @brief   External QSPI NOR flash, memory-mapped at 0x90000000.
+  *
+  *          The geometry and the fast read commands come from the SFDP
+  *          tables of the part (JESD216): QspiFlash_ParseSfdp() decodes the
+  *          basic flash parameter table, QspiFlash_CalcRead() picks the read
+  *          command, quad I/O DTR when both the part and its
+  *          QspiFlash_ConfigTypeDef allow it, else quad I/O or quad output
+  *          SDR, and the QUADSPI settings for the HCLK in use. Both are pure
+  *          functions; QspiFlash_Init() reads the tables and programs their
+  *          result.
+  *
+  *          Once initialized the flash stays memory-mapped: what the linker
+  *          places in .qspi (QSPI_RODATA, QSPI_TEXT) is read and executed in
+  *          place, cached through MPU region QSPI_FLASH_MPU_REGION + 1. The
+  *          rest of the 256 MB window is no-access under region
+  *          QSPI_FLASH_MPU_REGION: a speculative read beyond the part would
+  *          stall the bus. Indirect reads, erase and program leave the
+  *          memory-mapped mode for their duration; nothing may run from or
+  *          read the window meanwhile, interrupt handlers included.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __QSPI_FLASH_H
+#define __QSPI_FLASH_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "mpu_regions.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define QSPI_FLASH_BASE             0x90000000UL    /*!< memory-mapped window */
+#define QSPI_FLASH_WINDOW           0x10000000UL    /*!< 256 MB */
+#define QSPI_FLASH_MPU_REGION       2U              /*!< and the next one, after the SDRAM one */
+#define QSPI_FLASH_TIMEOUT_MS       100U
+#define QSPI_FLASH_ERASE_TIMEOUT_MS 5000U
+#define QSPI_FLASH_SFDP_SIZE        256U            /*!< bytes of SFDP read, headers and tables */
+#define QSPI_FLASH_SFDP_CLOCK_HZ    50000000U       /*!< JESD216 Read SFDP limit */
+#define QSPI_FLASH_FIFO_THRESHOLD   4U              /*!< a word, for the DMA */
+
+/* QspiFlash_SfdpTypeDef addressBytes */
+#define QSPI_FLASH_ADDRESS_3        0U
+#define QSPI_FLASH_ADDRESS_3_OR_4   1U
+#define QSPI_FLASH_ADDRESS_4        2U
+
+/* QspiFlash_SfdpTypeDef enter4Byte */
+#define QSPI_FLASH_ENTER4_NONE      0U
+#define QSPI_FLASH_ENTER4_B7        1U              /*!< instruction B7h */
+#define QSPI_FLASH_ENTER4_WREN_B7   2U              /*!< write enable, then B7h */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*QspiFlash_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	const char *name;
+	uint32_t maxClockHz;                /*!< SDR fast read, at the dummy clocks of the SFDP table */
+	uint32_t dtrMaxClockHz;             /*!< quad I/O DTR fast read */
+	uint32_t dtrOpcode;                 /*!< quad I/O DTR fast read, 0: SDR only */
+	uint32_t dtrDummyClocks;            /*!< as the part leaves them after reset */
+	uint32_t csHighNs;                  /*!< chip select high between two commands */
+} QspiFlash_ConfigTypeDef;
+
+typedef struct
+{
+	uint32_t revision;                  /*!< of the basic flash parameter table, major << 8 | minor */
+	uint32_t size;                      /*!< bytes */
+	uint32_t pageSize;                  /*!< program page, 256 before JESD216A */
+	uint32_t eraseSize;                 /*!< smallest erase type */
+	uint32_t eraseOpcode;
+	uint32_t addressBytes;              /*!< QSPI_FLASH_ADDRESS_xxx */
+	uint32_t enter4Byte;                /*!< QSPI_FLASH_ENTER4_xxx */
+	uint32_t quadEnable;                /*!< JESD216A quad enable requirements, 0: none or not given */
+	uint32_t dtr;                       /*!< DTR clocking supported */
+	uint32_t read144Opcode;             /*!< quad I/O fast read, 0: not supported */
+	uint32_t read144ModeClocks;
+	uint32_t read144DummyClocks;
+	uint32_t read114Opcode;             /*!< quad output fast read, 0: not supported */
+	uint32_t read114ModeClocks;
+	uint32_t read114DummyClocks;
+} QspiFlash_SfdpTypeDef;
+
+typedef struct
+{
+	QSPI_InitTypeDef init;
+	QSPI_CommandTypeDef command;        /*!< fast read, memory-mapped and indirect */
+	uint32_t clockHz;
+	uint32_t size;                      /*!< bytes addressed and mapped */
+	uint32_t enter4Byte;                /*!< QSPI_FLASH_ENTER4_xxx to send first */
+} QspiFlash_ReadTypeDef;
+
+typedef struct
+{
+	uint32_t reads;                     /*!< indirect, polled and DMA */
+	uint32_t readBytes;
+	uint32_t erases;
+	uint32_t programs;                  /*!< pages */
+	uint32_t errors;
+} QspiFlash_StatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern const QspiFlash_ConfigTypeDef qspiFlashN25q128a;     /*!< STM32F746G-DISCO */
+extern const QspiFlash_ConfigTypeDef qspiFlashMx25l51245g;  /*!< STM32F769I-DISCO */
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef QspiFlash_ParseSfdp(const uint8_t *sfdp, uint32_t length, QspiFlash_SfdpTypeDef *info);
+HAL_StatusTypeDef QspiFlash_CalcRead(const QspiFlash_ConfigTypeDef *config, const QspiFlash_SfdpTypeDef *info,
+		uint32_t hclkHz, QspiFlash_ReadTypeDef *read);
+HAL_StatusTypeDef QspiFlash_Init(const QspiFlash_ConfigTypeDef *config);
+HAL_StatusTypeDef QspiFlash_SetCache(MpuRegions_MemoryTypeDef type);
+HAL_StatusTypeDef QspiFlash_Read(uint32_t address, void *buffer, uint32_t length);
+HAL_StatusTypeDef QspiFlash_ReadDma(uint32_t address, void *buffer, uint32_t length);
+HAL_StatusTypeDef QspiFlash_Erase(uint32_t address);
+HAL_StatusTypeDef QspiFlash_Program(uint32_t address, const void *data, uint32_t length);
+const QspiFlash_SfdpTypeDef *QspiFlash_GetInfo(void);
+const QspiFlash_ReadTypeDef *QspiFlash_GetRead(void);
+void QspiFlash_GetStats(QspiFlash_StatsTypeDef *stats);
+void QspiFlash_Dump(QspiFlash_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __QSPI_FLASH_H */
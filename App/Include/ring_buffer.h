@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    ring_buffer.h
+  * @brief   Single-producer/single-consumer lock-free byte ring buffer.
+  *
+  *          head is only written by the producer, tail only by the
+  *          consumer; both are free-running and the storage size is a
+  *          power of two. The producer and the consumer may each be a
+  *          thread or an interrupt handler without further locking.
+  *          The block API exposes the contiguous part of the ring so DMA
+  *          can read from / write into the storage directly.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	uint8_t *buffer;
+	uint32_t size;                  /*!< power of two */
+	volatile uint32_t head;         /*!< producer index */
+	volatile uint32_t tail;         /*!< consumer index */
+} RingBuffer_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void RingBuffer_Init(RingBuffer_TypeDef *ring, uint8_t *buffer, uint32_t size);
+
+/* Producer side */
+uint32_t RingBuffer_Write(RingBuffer_TypeDef *ring, const void *data, uint32_t length);
+uint32_t RingBuffer_GetWriteBlock(RingBuffer_TypeDef *ring, uint8_t **block);
+void RingBuffer_Produce(RingBuffer_TypeDef *ring, uint32_t length);
+
+/* Consumer side */
+uint32_t RingBuffer_Read(RingBuffer_TypeDef *ring, void *data, uint32_t length);
+uint32_t RingBuffer_GetReadBlock(RingBuffer_TypeDef *ring, uint8_t **block);
+void RingBuffer_Consume(RingBuffer_TypeDef *ring, uint32_t length);
+
+static inline uint32_t RingBuffer_Count(const RingBuffer_TypeDef *ring)
+{
+	return ring->head - ring->tail;
+}
+
+static inline uint32_t RingBuffer_Free(const RingBuffer_TypeDef *ring)
+{
+	return ring->size - (ring->head - ring->tail);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RING_BUFFER_H */
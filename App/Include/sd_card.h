@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    sd_card.h
+  * @brief   SD card on SDMMC1, 4-bit bus at 24 MHz, multi-block transfers
+  *          with the HAL SD driver and DMA2 (stream 3 RX, stream 6 TX,
+  *          channel 4).
+  *
+  *          SdCard_Read()/SdCard_Write() only start a transfer and return;
+  *          its end is reported to the done callback given to SdCard_Init(),
+  *          from the SDMMC1 interrupt. A card still programming the blocks
+  *          of the last write answers HAL_BUSY, the caller tries again
+  *          later. Buffers are handed over with the dma_buffer.h calls and
+  *          must be 32-bit aligned.
+  *
+  *          The SDMMC1 and DMA interrupts run at SD_CARD_IRQ_PRIORITY, the
+  *          USB one: the mass storage class driving the card from its
+  *          callbacks and from the done callback never preempts itself.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SD_CARD_H
+#define __SD_CARD_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SD_CARD_BLOCK_SIZE          512U
+#define SD_CARD_IRQ_PRIORITY        7U      /*!< USB_DEVICE_IRQ_PRIORITY */
+#define SD_CARD_CLOCK_DIV           0U      /*!< 48 MHz / (0 + 2) */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*SdCard_DoneTypeDef)(HAL_StatusTypeDef status);
+typedef void (*SdCard_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint32_t reads;                     /*!< multi-block reads started */
+	uint32_t readBlocks;
+	uint32_t writes;
+	uint32_t writeBlocks;
+	uint32_t busy;                      /*!< transfers refused, card programming */
+	uint32_t errors;                    /*!< transfers ended in error */
+} SdCard_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef SdCard_Init(SdCard_DoneTypeDef done);
+HAL_StatusTypeDef SdCard_GetBlockCount(uint32_t *blocks);
+HAL_StatusTypeDef SdCard_Read(uint8_t *buffer, uint32_t block, uint32_t count);
+HAL_StatusTypeDef SdCard_Write(const uint8_t *buffer, uint32_t block, uint32_t count);
+void SdCard_GetStats(SdCard_StatsTypeDef *stats);
+void SdCard_Dump(SdCard_PutCharTypeDef putChar);
+
+void SdCard_IRQHandler(void);
+void SdCard_RxDmaIRQHandler(void);
+void SdCard_TxDmaIRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_CARD_H */
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    sdram.h
+  * @brief   External SDRAM on FMC SDRAM bank 1 (SDNE0/SDCKE0, 0xC0000000).
+  *
+  *          The part is described by a Sdram_ConfigTypeDef in datasheet
+  *          units, nanoseconds and clocks; Sdram_CalcTiming() turns it into
+  *          the controller registers for the HCLK in use: SDCLK at HCLK/2 or
+  *          HCLK/3, every delay rounded up to whole SDCLK periods, the
+  *          refresh timer count (RM0385 FMC SDRAM refresh timer). It has no
+  *          side effect, Sdram_Init() programs its result and runs the JEDEC
+  *          power-up sequence.
+  *
+  *          The Cortex-M7 default memory map makes 0xC0000000 Device memory,
+  *          execute never, where unaligned accesses fault: Sdram_Init() maps
+  *          the part as normal write-back memory with MPU region
+  *          SDRAM_MPU_REGION. What the linker places in .sdram (SDRAM_DATA)
+  *          comes first, the rest of the region is a heap, Sdram_Alloc().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SDRAM_H
+#define __SDRAM_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+#include "mem_heap.h"
+#include "mpu_regions.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SDRAM_BASE                  0xC0000000UL    /*!< FMC SDRAM bank 1 */
+#define SDRAM_MPU_REGION            1U              /*!< after the dma_buffer.c one */
+#define SDRAM_TIMEOUT_MS            100U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Sdram_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	const char *name;
+	uint32_t rowBits;                   /*!< 11 to 13 */
+	uint32_t columnBits;                /*!< 8 to 11 */
+	uint32_t internalBanks;             /*!< 2 or 4 */
+	uint32_t busWidth;                  /*!< data lines wired, 8, 16 or 32 */
+	uint32_t casLatency;                /*!< 1 to 3 clocks */
+	uint32_t maxClockHz;                /*!< at that CAS latency */
+	uint32_t tRCD;                      /*!< ns, active to read or write */
+	uint32_t tRP;                       /*!< ns, precharge */
+	uint32_t tRAS;                      /*!< ns, active to precharge, minimum */
+	uint32_t tRC;                       /*!< ns, active to active */
+	uint32_t tWR;                       /*!< ns, write recovery */
+	uint32_t tXSR;                      /*!< ns, self refresh exit */
+	uint32_t tMRD;                      /*!< clocks, load mode register to active */
+	uint32_t refreshMs;                 /*!< every row refreshed within */
+	uint32_t refreshRows;               /*!< auto refresh commands per refreshMs */
+	uint32_t autoRefreshes;             /*!< at power-up, 1 to 15 */
+	uint32_t powerUpUs;                 /*!< stable clock before the first command */
+} Sdram_ConfigTypeDef;
+
+typedef struct
+{
+	FMC_SDRAM_InitTypeDef init;         /*!< SDCR */
+	FMC_SDRAM_TimingTypeDef timing;     /*!< SDTR, clocks */
+	uint32_t clockHz;                   /*!< SDCLK */
+	uint32_t refreshCount;              /*!< SDRTR COUNT */
+	uint32_t modeRegister;              /*!< load mode register operand */
+	uint32_t size;                      /*!< bytes */
+} Sdram_TimingTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern const Sdram_ConfigTypeDef sdramMt48lc4m32b2;     /*!< -6A, STM32F746G-DISCO, 16 of its 32 bits */
+extern const Sdram_ConfigTypeDef sdramIs42s16400j;      /*!< -7, STM32F429I-DISCO */
+extern const Sdram_ConfigTypeDef sdramIs42s32800g;      /*!< -6, STM32F769I-DISCO, 16 of its 32 bits */
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef Sdram_CalcTiming(const Sdram_ConfigTypeDef *config, uint32_t hclkHz, Sdram_TimingTypeDef *timing);
+HAL_StatusTypeDef Sdram_Init(const Sdram_ConfigTypeDef *config);
+HAL_StatusTypeDef Sdram_SetCache(MpuRegions_MemoryTypeDef type);
+void *Sdram_Alloc(uint32_t size);
+void Sdram_Free(void *buffer);
+SDRAM_HandleTypeDef *Sdram_GetHandle(void);
+const Sdram_TimingTypeDef *Sdram_GetTiming(void);
+void Sdram_GetHeapStats(MemHeap_StatsTypeDef *stats);
+void Sdram_Dump(Sdram_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SDRAM_H */
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    timebase.h
+  * @brief   1 ms SysTick timebase driving the application timer wheel,
+  *          with tickless idle.
+  *
+  *          SysTick_Handler only counts ticks; expired timer callbacks run
+  *          in thread context from Timebase_Poll(). Timebase_Idle() stretches
+  *          the SysTick period up to the next timer event and sleeps in WFI.
+  *          Under the kernel the polls run in a high priority timer task,
+  *          woken by Timebase_TicksToNextExpiry(), and the sleep in its idle
+  *          task (Kernel_IdleHook()); timers are then started and stopped
+  *          only from that task's callbacks or before Kernel_Start().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TIMEBASE_H
+#define __TIMEBASE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "timer_wheel.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define TIMEBASE_TICK_HZ        1000U
+
+/* Exported functions ------------------------------------------------------- */
+void Timebase_Init(void);
+void Timebase_IRQHandler(void);
+void Timebase_Poll(void);
+uint32_t Timebase_TicksToNextExpiry(void);
+void Timebase_Idle(void);
+void Timebase_IdleFor(uint32_t maxTicks);
+uint32_t Timebase_GetTick(void);
+void Timebase_StartTimer(TimerWheel_TimerTypeDef *timer, uint32_t delayMs, uint32_t periodMs,
+		TimerWheel_CallbackTypeDef callback, void *arg);
+void Timebase_StopTimer(TimerWheel_TimerTypeDef *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMEBASE_H */
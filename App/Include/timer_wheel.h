@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    timer_wheel.h
+  * @brief   Hierarchical timer wheel (6 levels x 64 slots).
+  *
+  *          Pure tick-driven logic without any hardware access: the caller
+  *          feeds elapsed ticks with TimerWheel_Advance(), which runs the
+  *          expired callbacks in the caller's context. Start/stop are O(1),
+  *          TimerWheel_TicksToNextExpiry() is O(levels) and lets the caller
+  *          sleep until the next event (tickless idle). A wheel must only be
+  *          used from one execution context.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TIMER_WHEEL_H
+#define __TIMER_WHEEL_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define TIMER_WHEEL_SLOT_BITS   6U
+#define TIMER_WHEEL_SLOTS       (1U << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS      6U      /*!< 36 bits >= any 32-bit delay */
+#define TIMER_WHEEL_NO_EXPIRY   UINT32_MAX
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*TimerWheel_CallbackTypeDef)(void *arg);
+
+typedef struct TimerWheel_Timer
+{
+	struct TimerWheel_Timer *next;
+	struct TimerWheel_Timer **pprev;    /*!< NULL while the timer is not armed */
+	uint32_t expiry;                    /*!< absolute tick */
+	uint32_t period;                    /*!< 0 for one-shot timers */
+	uint16_t slot;                      /*!< level * TIMER_WHEEL_SLOTS + index */
+	TimerWheel_CallbackTypeDef callback;
+	void *arg;
+} TimerWheel_TimerTypeDef;
+
+typedef struct
+{
+	uint32_t ticks;                     /*!< ticks processed so far */
+	uint64_t occupied[TIMER_WHEEL_LEVELS];
+	TimerWheel_TimerTypeDef *slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void TimerWheel_Init(TimerWheel_TypeDef *wheel, uint32_t ticks);
+void TimerWheel_Start(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer, uint32_t delay,
+		uint32_t period, TimerWheel_CallbackTypeDef callback, void *arg);
+void TimerWheel_Stop(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer);
+void TimerWheel_Advance(TimerWheel_TypeDef *wheel, uint32_t ticks);
+uint32_t TimerWheel_TicksToNextExpiry(const TimerWheel_TypeDef *wheel);
+
+static inline uint32_t TimerWheel_GetTicks(const TimerWheel_TypeDef *wheel)
+{
+	return wheel->ticks;
+}
+
+static inline int TimerWheel_IsActive(const TimerWheel_TimerTypeDef *timer)
+{
+	return timer->pprev != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMER_WHEEL_H */
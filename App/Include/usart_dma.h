@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usart_dma.h
+  * @brief   USART1 DMA transmit/receive engine.
+  *
+  *          RX: DMA2 Stream2 (channel 4) runs in circular mode into a small
+  *          DMA buffer; the USART IDLE line, DMA half and full transfer
+  *          interrupts move the new bytes into the RX ring buffer.
+  *          TX: DMA2 Stream7 (channel 4) reads straight out of the TX ring
+  *          buffer, one contiguous block per transfer; the transfer-complete
+  *          interrupt chains the next block until the ring is empty.
+  *          UsartDma_TxSuspend() lends the stream to the QUADSPI, its only
+  *          DMA request on the STM32F74x; UsartDma_TxResume() takes it back.
+  *
+  *          Write/Read are non-blocking and must each be called from a single
+  *          thread context (single producer / single consumer).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USART_DMA_H
+#define __USART_DMA_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define USART_DMA_RX_DMA_SIZE       256U    /*!< circular DMA buffer, multiple of 32 */
+#define USART_DMA_RX_RING_SIZE      1024U   /*!< power of two */
+#define USART_DMA_TX_RING_SIZE      2048U   /*!< power of two */
+#define USART_DMA_FRAME_MAX         256U    /*!< largest payload for UsartDma_WriteFrame() */
+#define USART_DMA_IRQ_PRIORITY      5U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t rxBytes;
+	uint32_t rxDropped;                 /*!< bytes lost because the RX ring was full */
+	uint32_t txBytes;
+	uint32_t txTransfers;               /*!< DMA blocks started */
+} UsartDma_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void UsartDma_Init(uint32_t baudrate);
+uint32_t UsartDma_Write(const void *data, uint32_t length);
+uint32_t UsartDma_WriteFrame(const void *payload, uint32_t length);
+uint32_t UsartDma_Read(void *data, uint32_t length);
+void UsartDma_GetStats(UsartDma_StatsTypeDef *stats);
+void UsartDma_TxSuspend(void);
+void UsartDma_TxResume(void);
+
+void UsartDma_IRQHandler(void);
+void UsartDma_RxDmaIRQHandler(void);
+void UsartDma_TxDmaIRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USART_DMA_H */
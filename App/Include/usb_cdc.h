@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.h
+  * @brief   USB CDC-ACM (virtual COM port) class on the usb_device core,
+  *          a byte stream to the host beside USART1.
+  *
+  *          Interface 0 (communication) has the notification endpoint 0x82,
+  *          interface 1 (data) the bulk endpoints 0x01 and 0x81, 64-byte
+  *          packets at full speed and 512-byte ones at high speed.
+  *          RX: two transfer buffers of USB_CDC_RX_BUFFER_SIZE take turns on
+  *          the OUT endpoint; the next one is armed before the completed
+  *          one is copied to the RX ring, so the endpoint never NAKs while
+  *          the CPU works. When the ring has no room for a buffer it is
+  *          held and the endpoint stays unarmed once both are: the host
+  *          sees NAKs, no byte is dropped. UsbCdc_Read() moves the held
+  *          buffers in and rearms.
+  *          TX: UsbCdc_Write() queues into the TX ring; each contiguous ring
+  *          block goes out as one multi-packet transfer, chained from the
+  *          transfer complete callback, a zero-length packet after a block
+  *          ending on a packet boundary with nothing behind it. The IN
+  *          FIFO holds two packets or more, the core loads one while the
+  *          other is on the bus.
+  *
+  *          Write/Read are non-blocking and must each be called from a single
+  *          thread context (single producer / single consumer), as with
+  *          usart_dma.h. Line coding and control line state are kept for
+  *          the application, no UART sits behind them.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_CDC_H
+#define __USB_CDC_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "usb_device.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_CDC_RX_BUFFER_SIZE      1024U   /*!< per OUT transfer, multiple of 512 */
+#define USB_CDC_RX_RING_SIZE        2048U   /*!< power of two */
+#define USB_CDC_TX_RING_SIZE        4096U   /*!< power of two */
+#define USB_CDC_CONFIG_LENGTH       67U
+
+#define USB_CDC_EP_NOTIFY           0x82U
+#define USB_CDC_EP_OUT              0x01U
+#define USB_CDC_EP_IN               0x81U
+#define USB_CDC_COMM_INTERFACE      0U
+
+/* Class requests */
+#define USB_CDC_SET_LINE_CODING     0x20U
+#define USB_CDC_GET_LINE_CODING     0x21U
+#define USB_CDC_SET_CONTROL_LINE_STATE 0x22U
+#define USB_CDC_SEND_BREAK          0x23U
+
+#define USB_CDC_LINE_DTR            0x01U   /*!< control line state: terminal present */
+#define USB_CDC_LINE_RTS            0x02U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*UsbCdc_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	uint32_t baudrate;
+	uint8_t stopBits;                   /*!< 0: 1, 1: 1.5, 2: 2 */
+	uint8_t parity;                     /*!< 0: none, 1: odd, 2: even, 3: mark, 4: space */
+	uint8_t dataBits;
+} UsbCdc_LineCodingTypeDef;
+
+typedef struct
+{
+	uint32_t rxBytes;
+	uint32_t rxTransfers;               /*!< OUT transfers completed */
+	uint32_t rxHeld;                    /*!< buffers held for want of RX ring room */
+	uint32_t txBytes;
+	uint32_t txTransfers;               /*!< IN transfers started, zero-length ones apart */
+	uint32_t txZlps;
+	uint32_t lineCodings;               /*!< SET_LINE_CODING requests */
+} UsbCdc_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef UsbCdc_Init(PCD_HandleTypeDef *hpcd, const char *serial);
+uint32_t UsbCdc_Write(const void *data, uint32_t length);
+uint32_t UsbCdc_Read(void *data, uint32_t length);
+uint32_t UsbCdc_IsOpen(void);
+void UsbCdc_GetLineCoding(UsbCdc_LineCodingTypeDef *lineCoding);
+void UsbCdc_GetStats(UsbCdc_StatsTypeDef *stats);
+void UsbCdc_Dump(UsbCdc_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_CDC_H */
@@ -0,0 +1,180 @@
+/**
+  ******************************************************************************
+  * @file    usb_device.h
+  * @brief   USB device core on the HAL PCD driver: enumeration, endpoint 0
+  *          control transfers and the standard requests, for one class.
+  *
+  *          The class hands over its descriptors and callbacks in a
+  *          UsbDevice_ClassTypeDef. The core answers GET_DESCRIPTOR from
+  *          them, building the string descriptors from ASCII and, on a
+  *          high-speed capable core (ULPI PHY), the device qualifier and
+  *          other-speed configuration descriptors from the device and
+  *          configuration descriptors. SET_CONFIGURATION walks the
+  *          configuration descriptor of the current speed and opens every
+  *          endpoint it declares, then tells the class. Class and vendor
+  *          requests go to the class once their data stage is in.
+  *          The FIFO RAM is planned with usb_fifo.h from the endpoints of
+  *          the configuration descriptor, at the fastest speed of the core.
+  *
+  *          Endpoint 0 data stages move through a USB_DEVICE_EP0_SIZE buffer
+  *          one packet at a time, as the OTG core allows on endpoint 0.
+  *          The other endpoints take multi-packet transfers. With the core
+  *          DMA on (OTG HS), transfer buffers must be 32-bit aligned and are
+  *          handed over with the dma_buffer.h calls.
+  *
+  *          Device state follows USB 2.0 chapter 9: powered, default after a
+  *          bus reset, addressed, configured; suspended on top of any.
+  *          Everything but UsbDevice_GetStats()/UsbDevice_Dump() runs in the
+  *          OTG interrupt.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_DEVICE_H
+#define __USB_DEVICE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+#include "usb_fifo.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_DEVICE_EP0_SIZE         256U    /*!< largest control data stage, descriptors included */
+#define USB_DEVICE_EP0_MPS          64U
+#define USB_DEVICE_MAX_ENDPOINTS    USB_FIFO_MAX_ENDPOINTS  /*!< OTG FS: endpoint 0 to 5 each way */
+#define USB_DEVICE_IRQ_PRIORITY     7U
+
+/* bmRequestType */
+#define USB_REQ_DIR_IN              0x80U
+#define USB_REQ_TYPE_MASK           0x60U
+#define USB_REQ_TYPE_STANDARD       0x00U
+#define USB_REQ_TYPE_CLASS          0x20U
+#define USB_REQ_TYPE_VENDOR         0x40U
+#define USB_REQ_RECIPIENT_MASK      0x1FU
+#define USB_REQ_RECIPIENT_DEVICE    0x00U
+#define USB_REQ_RECIPIENT_INTERFACE 0x01U
+#define USB_REQ_RECIPIENT_ENDPOINT  0x02U
+
+/* bRequest, standard */
+#define USB_REQ_GET_STATUS          0x00U
+#define USB_REQ_CLEAR_FEATURE       0x01U
+#define USB_REQ_SET_FEATURE         0x03U
+#define USB_REQ_SET_ADDRESS         0x05U
+#define USB_REQ_GET_DESCRIPTOR      0x06U
+#define USB_REQ_SET_DESCRIPTOR      0x07U
+#define USB_REQ_GET_CONFIGURATION   0x08U
+#define USB_REQ_SET_CONFIGURATION   0x09U
+#define USB_REQ_GET_INTERFACE       0x0AU
+#define USB_REQ_SET_INTERFACE       0x0BU
+
+#define USB_FEATURE_ENDPOINT_HALT   0x00U
+#define USB_FEATURE_REMOTE_WAKEUP   0x01U
+
+/* bDescriptorType */
+#define USB_DESC_DEVICE             0x01U
+#define USB_DESC_CONFIGURATION      0x02U
+#define USB_DESC_STRING             0x03U
+#define USB_DESC_INTERFACE          0x04U
+#define USB_DESC_ENDPOINT           0x05U
+#define USB_DESC_DEVICE_QUALIFIER   0x06U
+#define USB_DESC_OTHER_SPEED        0x07U
+#define USB_DESC_IAD                0x0BU
+#define USB_DESC_CS_INTERFACE       0x24U
+
+#define USB_DESC_DEVICE_LENGTH      18U
+#define USB_DESC_CONFIG_LENGTH      9U
+#define USB_DESC_QUALIFIER_LENGTH   10U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*UsbDevice_PutCharTypeDef)(char c);
+
+typedef enum
+{
+	USB_DEVICE_STATE_POWERED = 0,       /*!< started, no bus reset yet */
+	USB_DEVICE_STATE_DEFAULT,
+	USB_DEVICE_STATE_ADDRESSED,
+	USB_DEVICE_STATE_CONFIGURED,
+	USB_DEVICE_STATE_SUSPENDED
+} UsbDevice_StateTypeDef;
+
+typedef struct
+{
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} UsbDevice_SetupTypeDef;
+
+typedef struct
+{
+	const uint8_t *device;              /*!< device descriptor */
+	/**
+	 * @brief  Configuration descriptor with all its interface, class and
+	 *         endpoint descriptors, for a speed.
+	 * @param  highSpeed: 1 for the high-speed packet sizes
+	 * @param  length: set to wTotalLength
+	 */
+	const uint8_t *(*configuration)(uint32_t highSpeed, uint32_t *length);
+	const char *const *strings;         /*!< string descriptors 1 to stringCount, ASCII */
+	uint32_t stringCount;
+	/**
+	 * @brief  Configuration selected, its endpoints open, or 0 on
+	 *         deconfiguration and bus reset, its endpoints closed.
+	 */
+	void (*configured)(uint8_t configuration, uint32_t highSpeed);
+	/**
+	 * @brief  Class or vendor request, after its data stage for the
+	 *         host-to-device ones.
+	 * @param  data: USB_DEVICE_EP0_SIZE buffer, holding the data stage of
+	 *         a host-to-device request; a device-to-host answer goes there
+	 * @param  length: data stage length; set to the answer length
+	 * @retval HAL_OK, HAL_ERROR to stall the request
+	 */
+	HAL_StatusTypeDef (*request)(const UsbDevice_SetupTypeDef *setup, uint8_t *data, uint32_t *length);
+	void (*dataIn)(uint8_t epAddress);  /*!< transfer done on an IN endpoint */
+	void (*dataOut)(uint8_t epAddress, uint32_t length);  /*!< transfer done on an OUT endpoint */
+	/**
+	 * @brief  Halt of an endpoint of the configuration cleared by the host
+	 *         (CLEAR_FEATURE), optional. The class may halt it again.
+	 */
+	void (*clearHalt)(uint8_t epAddress);
+} UsbDevice_ClassTypeDef;
+
+typedef struct
+{
+	uint32_t resets;                    /*!< bus resets */
+	uint32_t setups;                    /*!< setup packets */
+	uint32_t stalls;                    /*!< requests refused with a STALL */
+	uint32_t suspends;
+	uint32_t configurations;            /*!< SET_CONFIGURATION with a non-zero value */
+	uint32_t ep0Bytes;                  /*!< control data stage bytes, both ways */
+} UsbDevice_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef UsbDevice_Init(PCD_HandleTypeDef *hpcd, const UsbDevice_ClassTypeDef *usbClass);
+void UsbDevice_IRQHandler(void);
+
+HAL_StatusTypeDef UsbDevice_Transmit(uint8_t epAddress, const uint8_t *data, uint32_t length);
+HAL_StatusTypeDef UsbDevice_Receive(uint8_t epAddress, uint8_t *buffer, uint32_t length);
+HAL_StatusTypeDef UsbDevice_Stall(uint8_t epAddress);
+HAL_StatusTypeDef UsbDevice_Abort(uint8_t epAddress);
+uint32_t UsbDevice_MaxPacket(uint8_t epAddress);
+UsbDevice_StateTypeDef UsbDevice_GetState(void);
+
+const uint8_t *UsbDevice_FindDescriptor(const uint8_t *descriptors, uint32_t length, const uint8_t *after,
+		uint8_t type);
+
+void UsbDevice_GetStats(UsbDevice_StatsTypeDef *stats);
+void UsbDevice_Dump(UsbDevice_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_DEVICE_H */
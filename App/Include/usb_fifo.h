@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    usb_fifo.h
+  * @brief   OTG device FIFO RAM planner: GRXFSIZ and the DIEPTXFx depths
+  *          for an endpoint list, within the RAM of the core.
+  *
+  *          All OUT endpoints share the RX FIFO, sized with the RM0385
+  *          rule: 5 words per control endpoint + 8 for the setup packets,
+  *          the largest packet + 1 status word, 2 words per OUT endpoint
+  *          and 1 for the global OUT NAK. Every IN endpoint has its own
+  *          TX FIFO of at least one packet and 16 words. A high-bandwidth
+  *          endpoint (wMaxPacketSize bits 12:11) counts all the packets
+  *          of its (micro)frame as one.
+  *          The rest of the RAM then goes one packet at a time, up to
+  *          USB_FIFO_MAX_PACKETS, to the endpoints that stream: the
+  *          isochronous ones first, which cannot retry an underrun or an
+  *          overrun, then the bulk ones, IN before OUT each round. The
+  *          core loads a packet while the one before is on the bus, and
+  *          every extra packet is one less FIFO interrupt per transfer.
+  *          Interrupt endpoints keep a single packet.
+  *
+  *          UsbFifo_Plan() touches no register: usb_device.c applies the
+  *          plan with HAL_PCDEx_SetRxFiFo()/HAL_PCDEx_SetTxFiFo().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_FIFO_H
+#define __USB_FIFO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_FIFO_MAX_ENDPOINTS      6U      /*!< TX FIFOs planned: OTG FS endpoints 0 to 5 */
+#define USB_FIFO_MAX_PACKETS        8U      /*!< per streaming endpoint */
+#define USB_FIFO_MIN_TX_WORDS       16U     /*!< smallest DIEPTXFx depth */
+#define USB_FIFO_FS_WORDS           320U    /*!< OTG FS: 1.25 KB */
+#define USB_FIFO_HS_WORDS           1024U   /*!< OTG HS: 4 KB */
+#define USB_FIFO_HS_DMA_WORDS       16U     /*!< OTG HS with DMA: endpoint DMA addresses at the top */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	uint8_t address;                    /*!< bEndpointAddress */
+	uint8_t type;                       /*!< EP_TYPE_CTRL/ISOC/BULK/INTR */
+	uint16_t maxPacket;                 /*!< wMaxPacketSize, additional transactions in bits 12:11 */
+} UsbFifo_EndpointTypeDef;
+
+typedef struct
+{
+	uint16_t rxWords;                   /*!< GRXFSIZ */
+	uint16_t txWords[USB_FIFO_MAX_ENDPOINTS];  /*!< IN endpoint n FIFO, 0: unused */
+	uint16_t usedWords;                 /*!< of the RAM given */
+} UsbFifo_PlanTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef UsbFifo_Plan(uint32_t ep0MaxPacket, const UsbFifo_EndpointTypeDef *endpoints, uint32_t count,
+		uint32_t ramWords, UsbFifo_PlanTypeDef *plan);
+uint32_t UsbFifo_PacketWords(uint16_t maxPacket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_FIFO_H */
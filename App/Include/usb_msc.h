@@ -0,0 +1,103 @@
+/**
+  ******************************************************************************
+  * @file    usb_msc.h
+  * @brief   USB mass storage class, bulk-only transport (BOT) with the SCSI
+  *          transparent command set, on the usb_device core: one logical
+  *          unit of 512-byte blocks behind a storage interface.
+  *
+  *          Interface 0 has the bulk endpoints 0x01 and 0x81, 64-byte
+  *          packets at full speed and 512-byte ones at high speed.
+  *          READ(10) and WRITE(10) stream through two slots of
+  *          USB_MSC_SLOT_SIZE taking turns: a producer fills one while a
+  *          consumer drains the other. On a read the storage fills and the
+  *          IN endpoint drains, so the next multi-block read is started as
+  *          soon as a slot is free, while the previous one is still going
+  *          out on the bus; on a write the OUT endpoint fills and the
+  *          storage drains. Each side is chained from the completion of the
+  *          other, no task is involved.
+  *
+  *          Storage calls only start an operation. Its end is reported with
+  *          UsbMsc_StorageDone(), from an interrupt at the USB priority or
+  *          from within the call itself (a RAM disk). A storage busy with a
+  *          previous operation answers HAL_BUSY: UsbMsc_Poll(), from a
+  *          periodic timer, tries it again.
+  *
+  *          Sense data follows SPC: a failed command answers CHECK
+  *          CONDITION in its CSW, REQUEST SENSE then tells why. A CBW that
+  *          is not valid halts both endpoints until a BOT reset.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_MSC_H
+#define __USB_MSC_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "usb_device.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define USB_MSC_BLOCK_SIZE          512U
+#define USB_MSC_SLOT_SIZE           4096U   /*!< per ping-pong slot, multiple of USB_MSC_BLOCK_SIZE */
+#define USB_MSC_COMMAND_SIZE        512U    /*!< CBW, CSW and short answers; one HS packet */
+#define USB_MSC_CONFIG_LENGTH       32U
+#define USB_MSC_POLL_MS             1U      /*!< UsbMsc_Poll() period */
+
+#define USB_MSC_EP_OUT              0x01U
+#define USB_MSC_EP_IN               0x81U
+#define USB_MSC_INTERFACE           0U
+
+/* Class requests */
+#define USB_MSC_GET_MAX_LUN         0xFEU
+#define USB_MSC_RESET               0xFFU
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*UsbMsc_PutCharTypeDef)(char c);
+
+typedef struct
+{
+	/**
+	 * @brief  Medium size.
+	 * @param  blocks: set to the number of USB_MSC_BLOCK_SIZE blocks
+	 * @retval HAL_OK, HAL_ERROR without a medium
+	 */
+	HAL_StatusTypeDef (*capacity)(uint32_t *blocks);
+	/**
+	 * @brief  Start a multi-block read or write, at most USB_MSC_SLOT_SIZE.
+	 * @retval HAL_OK: UsbMsc_StorageDone() to come; HAL_BUSY: not started,
+	 *         try again; HAL_ERROR
+	 */
+	HAL_StatusTypeDef (*read)(uint8_t *buffer, uint32_t block, uint32_t count);
+	HAL_StatusTypeDef (*write)(const uint8_t *buffer, uint32_t block, uint32_t count);
+} UsbMsc_StorageTypeDef;
+
+typedef struct
+{
+	uint32_t commands;                  /*!< valid CBWs */
+	uint32_t failed;                    /*!< CSWs with command failed */
+	uint32_t phaseErrors;               /*!< CSWs with phase error */
+	uint32_t invalid;                   /*!< CBWs not valid, endpoints halted */
+	uint32_t resets;                    /*!< BOT resets */
+	uint32_t readBlocks;
+	uint32_t writeBlocks;
+	uint32_t overlapped;                /*!< slot transfers started while the other slot was moving */
+	uint32_t retries;                   /*!< storage operations refused busy */
+} UsbMsc_StatsTypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef UsbMsc_Init(PCD_HandleTypeDef *hpcd, const UsbMsc_StorageTypeDef *storage, const char *serial);
+void UsbMsc_StorageDone(HAL_StatusTypeDef status);
+void UsbMsc_Poll(void);
+void UsbMsc_GetStats(UsbMsc_StatsTypeDef *stats);
+void UsbMsc_Dump(UsbMsc_PutCharTypeDef putChar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_MSC_H */
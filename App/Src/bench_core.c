@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file    bench_core.c
+  * @brief   CoreMark-style CPU benchmark for the flash interface settings.
+  *
+  *          The kernels follow the CoreMark structure (list, matrix, state
+  *          machine, CRC) but are not CoreMark: the scores only compare
+  *          configurations of this board with each other.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdio.h>
+
+#include "stm32f7xx_ll_system.h"
+
+#include "bench_core.h"
+#include "profile.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_CORE_LIST_NODES       32U
+#define BENCH_CORE_LIST_FINDS       4U
+#define BENCH_CORE_MATRIX_N         8U
+#define BENCH_CORE_CRC_POLY         0x1021U     /* CRC-16/CCITT */
+
+#ifndef ART_ACCELERATOR_ENABLE
+#define ART_ACCELERATOR_ENABLE      0
+#endif
+#ifndef PREFETCH_ENABLE
+#define PREFETCH_ENABLE             0
+#endif
+
+#if defined(FLASH_BUS_ITCM)
+#define BENCH_CORE_FLASH_BUS        "ITCM"
+#else
+#define BENCH_CORE_FLASH_BUS        "AXIM"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct BenchCore_Node
+{
+	struct BenchCore_Node *next;
+	int16_t key;
+	int16_t value;
+} BenchCore_NodeTypeDef;
+
+typedef enum
+{
+	BENCH_CORE_STATE_START = 0,
+	BENCH_CORE_STATE_SIGN,
+	BENCH_CORE_STATE_INT,
+	BENCH_CORE_STATE_DOT,
+	BENCH_CORE_STATE_FRACTION,
+	BENCH_CORE_STATE_EXPONENT,
+	BENCH_CORE_STATE_EXPONENT_SIGN,
+	BENCH_CORE_STATE_SCIENTIFIC,
+	BENCH_CORE_STATE_INVALID,
+	BENCH_CORE_STATE_COUNT
+} BenchCore_StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static BenchCore_NodeTypeDef benchCoreNodes[BENCH_CORE_LIST_NODES];
+static int16_t benchCoreMatrixA[BENCH_CORE_MATRIX_N][BENCH_CORE_MATRIX_N];
+static int16_t benchCoreMatrixB[BENCH_CORE_MATRIX_N][BENCH_CORE_MATRIX_N];
+static int32_t benchCoreMatrixC[BENCH_CORE_MATRIX_N][BENCH_CORE_MATRIX_N];
+static char benchCoreInput[] =
+	"5012,1.23,-110.700,+0.64e-1,x21,-,7e,3.,+,98765432,0.5E+3,12e4.5,-.5,42,";
+
+/* Private functions ---------------------------------------------------------*/
+static uint16_t BenchCore_Crc8(uint8_t data, uint16_t crc)
+{
+	crc ^= (uint16_t)data << 8;
+	for (uint32_t i = 0; i < 8U; i++)
+	{
+		crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ BENCH_CORE_CRC_POLY) : (uint16_t)(crc << 1);
+	}
+	return crc;
+}
+
+static uint16_t BenchCore_Crc16(uint16_t data, uint16_t crc)
+{
+	crc = BenchCore_Crc8((uint8_t)data, crc);
+	return BenchCore_Crc8((uint8_t)(data >> 8), crc);
+}
+
+static uint16_t BenchCore_Crc32(uint32_t data, uint16_t crc)
+{
+	crc = BenchCore_Crc16((uint16_t)data, crc);
+	return BenchCore_Crc16((uint16_t)(data >> 16), crc);
+}
+
+static BenchCore_NodeTypeDef *BenchCore_ListInit(uint16_t seed)
+{
+	uint32_t value = seed;
+
+	for (uint32_t i = 0; i < BENCH_CORE_LIST_NODES; i++)
+	{
+		value = value * 1103515245U + 12345U;
+		benchCoreNodes[i].key = (int16_t)i;
+		benchCoreNodes[i].value = (int16_t)(value >> 16);
+		benchCoreNodes[i].next = (i + 1U < BENCH_CORE_LIST_NODES) ? &benchCoreNodes[i + 1U] : NULL;
+	}
+	return benchCoreNodes;
+}
+
+static BenchCore_NodeTypeDef *BenchCore_ListReverse(BenchCore_NodeTypeDef *list)
+{
+	BenchCore_NodeTypeDef *reversed = NULL;
+
+	while (list != NULL)
+	{
+		BenchCore_NodeTypeDef *next = list->next;
+		list->next = reversed;
+		reversed = list;
+		list = next;
+	}
+	return reversed;
+}
+
+static const BenchCore_NodeTypeDef *BenchCore_ListFind(const BenchCore_NodeTypeDef *list, int16_t key)
+{
+	while ((list != NULL) && (list->key != key))
+	{
+		list = list->next;
+	}
+	return list;
+}
+
+/**
+ * @brief  Bottom-up merge sort of a singly linked list by value.
+ */
+static BenchCore_NodeTypeDef *BenchCore_ListSort(BenchCore_NodeTypeDef *list)
+{
+	for (uint32_t width = 1; ; width *= 2U)
+	{
+		BenchCore_NodeTypeDef *p = list;
+		BenchCore_NodeTypeDef *tail = NULL;
+		uint32_t merges = 0;
+
+		list = NULL;
+		while (p != NULL)
+		{
+			BenchCore_NodeTypeDef *q = p;
+			uint32_t pSize = 0;
+			uint32_t qSize = width;
+
+			merges++;
+			while ((pSize < width) && (q != NULL))
+			{
+				pSize++;
+				q = q->next;
+			}
+
+			while ((pSize > 0U) || ((qSize > 0U) && (q != NULL)))
+			{
+				BenchCore_NodeTypeDef *e;
+
+				if ((pSize == 0U) || ((qSize > 0U) && (q != NULL) && (q->value < p->value)))
+				{
+					e = q;
+					q = q->next;
+					qSize--;
+				}
+				else
+				{
+					e = p;
+					p = p->next;
+					pSize--;
+				}
+
+				if (tail != NULL)
+				{
+					tail->next = e;
+				}
+				else
+				{
+					list = e;
+				}
+				tail = e;
+			}
+			p = q;
+		}
+		tail->next = NULL;
+
+		if (merges <= 1U)
+		{
+			return list;
+		}
+	}
+}
+
+static uint16_t BenchCore_List(uint16_t seed, uint16_t crc)
+{
+	BenchCore_NodeTypeDef *list = BenchCore_ListReverse(BenchCore_ListInit(seed));
+
+	for (uint32_t i = 0; i < BENCH_CORE_LIST_FINDS; i++)
+	{
+		const BenchCore_NodeTypeDef *node = BenchCore_ListFind(list, (int16_t)((seed + i * 7U) % BENCH_CORE_LIST_NODES));
+		crc = BenchCore_Crc16((uint16_t)node->value, crc);
+	}
+
+	for (list = BenchCore_ListSort(list); list != NULL; list = list->next)
+	{
+		crc = BenchCore_Crc16((uint16_t)list->key, crc);
+	}
+	return crc;
+}
+
+static uint16_t BenchCore_Matrix(uint16_t seed, uint16_t crc)
+{
+	const uint32_t n = BENCH_CORE_MATRIX_N;
+	int32_t sum = 0;
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		for (uint32_t j = 0; j < n; j++)
+		{
+			benchCoreMatrixA[i][j] = (int16_t)((seed + i * n + j) & 0x0FFFU);
+			benchCoreMatrixB[i][j] = (int16_t)(((seed ^ (j * n + i)) & 0x0FFFU) - 0x0800);
+		}
+	}
+
+	/* matrix times matrix, then matrix plus and times constant */
+	for (uint32_t i = 0; i < n; i++)
+	{
+		for (uint32_t j = 0; j < n; j++)
+		{
+			int32_t acc = 0;
+			for (uint32_t k = 0; k < n; k++)
+			{
+				acc += (int32_t)benchCoreMatrixA[i][k] * benchCoreMatrixB[k][j];
+			}
+			benchCoreMatrixC[i][j] = acc;
+		}
+	}
+	for (uint32_t i = 0; i < n; i++)
+	{
+		for (uint32_t j = 0; j < n; j++)
+		{
+			benchCoreMatrixA[i][j] = (int16_t)(benchCoreMatrixA[i][j] + (int16_t)seed);
+			benchCoreMatrixC[i][j] += (int32_t)benchCoreMatrixA[i][j] * (int16_t)seed;
+			sum += benchCoreMatrixC[i][j] >> 4;
+		}
+	}
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		crc = BenchCore_Crc32((uint32_t)benchCoreMatrixC[i][i], crc);
+	}
+	return BenchCore_Crc32((uint32_t)sum, crc);
+}
+
+static BenchCore_StateTypeDef BenchCore_Next(BenchCore_StateTypeDef state, char c)
+{
+	int digit = (c >= '0') && (c <= '9');
+	int sign = (c == '+') || (c == '-');
+
+	switch (state)
+	{
+		case BENCH_CORE_STATE_START:
+			return digit ? BENCH_CORE_STATE_INT : sign ? BENCH_CORE_STATE_SIGN
+				: (c == '.') ? BENCH_CORE_STATE_DOT : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_SIGN:
+			return digit ? BENCH_CORE_STATE_INT : (c == '.') ? BENCH_CORE_STATE_DOT : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_INT:
+			return digit ? BENCH_CORE_STATE_INT : (c == '.') ? BENCH_CORE_STATE_FRACTION
+				: ((c == 'e') || (c == 'E')) ? BENCH_CORE_STATE_EXPONENT : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_DOT:
+			return digit ? BENCH_CORE_STATE_FRACTION : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_FRACTION:
+			return digit ? BENCH_CORE_STATE_FRACTION
+				: ((c == 'e') || (c == 'E')) ? BENCH_CORE_STATE_EXPONENT : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_EXPONENT:
+			return digit ? BENCH_CORE_STATE_SCIENTIFIC : sign ? BENCH_CORE_STATE_EXPONENT_SIGN : BENCH_CORE_STATE_INVALID;
+		case BENCH_CORE_STATE_EXPONENT_SIGN:
+		case BENCH_CORE_STATE_SCIENTIFIC:
+			return digit ? BENCH_CORE_STATE_SCIENTIFIC : BENCH_CORE_STATE_INVALID;
+		default:
+			return BENCH_CORE_STATE_INVALID;
+	}
+}
+
+static uint16_t BenchCore_StateMachine(uint16_t seed, uint16_t crc)
+{
+	uint32_t finalCount[BENCH_CORE_STATE_COUNT] = { 0 };
+	uint32_t transitions = 0;
+	BenchCore_StateTypeDef state = BENCH_CORE_STATE_START;
+	uint32_t length = sizeof(benchCoreInput) - 1U;
+	uint32_t corrupt = seed % length;
+	char saved = benchCoreInput[corrupt];
+
+	/* Vary the input per iteration, CoreMark style */
+	if (saved != ',')
+	{
+		benchCoreInput[corrupt] = (char)('0' + (seed % 10U));
+	}
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		char c = benchCoreInput[i];
+
+		if (c == ',')
+		{
+			finalCount[state]++;
+			state = BENCH_CORE_STATE_START;
+			continue;
+		}
+
+		BenchCore_StateTypeDef next = BenchCore_Next(state, c);
+		transitions += (next != state) ? 1U : 0U;
+		state = next;
+	}
+	benchCoreInput[corrupt] = saved;
+
+	for (uint32_t i = 0; i < BENCH_CORE_STATE_COUNT; i++)
+	{
+		crc = BenchCore_Crc16((uint16_t)finalCount[i], crc);
+	}
+	return BenchCore_Crc32(transitions, crc);
+}
+
+static void BenchCore_SetFlashMode(uint32_t icache, uint32_t art, uint32_t prefetch)
+{
+	if (icache)
+	{
+		SCB_EnableICache();
+	}
+	else
+	{
+		SCB_DisableICache();
+	}
+
+	LL_FLASH_DisableART();
+	if (art)
+	{
+		/* The ART cache must be reset while it is disabled */
+		LL_FLASH_EnableARTReset();
+		LL_FLASH_DisableARTReset();
+		LL_FLASH_EnableART();
+	}
+
+	if (prefetch)
+	{
+		LL_FLASH_EnablePrefetch();
+	}
+	else
+	{
+		LL_FLASH_DisablePrefetch();
+	}
+}
+
+static void BenchCore_Print(BenchCore_PutCharTypeDef putChar, const char *line)
+{
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
+
+/**
+ * @brief  Run one benchmark iteration.
+ * @param  seed: input variation, pass the previous result to chain
+ * @retval CRC-16 over all kernel results
+ */
+uint16_t BenchCore_Iterate(uint16_t seed)
+{
+	uint16_t crc = 0;
+
+	crc = BenchCore_List(seed, crc);
+	crc = BenchCore_Matrix(seed, crc);
+	crc = BenchCore_StateMachine(seed, crc);
+	return crc;
+}
+
+/**
+ * @brief  Time chained iterations with interrupts masked.
+ * @note   Needs the DWT cycle counter, see Profile_Init().
+ * @param  iterations: number of iterations, not 0
+ * @param  crc: in: seed, out: result of the last iteration
+ * @retval Cycles per iteration
+ */
+uint32_t BenchCore_Measure(uint32_t iterations, uint16_t *crc)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint16_t value = *crc;
+	uint32_t start;
+	uint32_t cycles;
+
+	__disable_irq();
+	start = Profile_GetCycles();
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		value = BenchCore_Iterate(value);
+	}
+	cycles = Profile_GetCycles() - start;
+	__set_PRIMASK(primask);
+
+	*crc = value;
+	return cycles / iterations;
+}
+
+/**
+ * @brief  Measure every I-cache/ART/prefetch combination and print a table,
+ *         then restore the build configuration.
+ * @param  bootCycles: cycles from reset to main(), 0 if not measured
+ * @param  putChar: output function
+ * @retval None
+ */
+void BenchCore_Report(uint32_t bootCycles, BenchCore_PutCharTypeDef putChar)
+{
+	char line[80];
+
+	snprintf(line, sizeof(line), "bench_core: flash=%s boot=%lu cycles, %lu iterations\r\n",
+		BENCH_CORE_FLASH_BUS, (unsigned long)bootCycles, (unsigned long)BENCH_CORE_ITERATIONS);
+	BenchCore_Print(putChar, line);
+	BenchCore_Print(putChar, "icache art prefetch  cycles/iter     crc\r\n");
+
+	for (uint32_t mode = 0; mode < 8U; mode++)
+	{
+		uint32_t icache = (mode >> 2) & 1U;
+		uint32_t art = (mode >> 1) & 1U;
+		uint32_t prefetch = mode & 1U;
+		uint16_t crc = 0;
+		uint32_t cycles;
+
+		BenchCore_SetFlashMode(icache, art, prefetch);
+		/* warm up caches, then measure */
+		BenchCore_Measure(1U, &crc);
+		crc = 0;
+		cycles = BenchCore_Measure(BENCH_CORE_ITERATIONS, &crc);
+
+		snprintf(line, sizeof(line), "%6lu %3lu %8lu  %11lu  0x%04x\r\n", (unsigned long)icache,
+			(unsigned long)art, (unsigned long)prefetch, (unsigned long)cycles, crc);
+		BenchCore_Print(putChar, line);
+	}
+
+	BenchCore_SetFlashMode(1U, ART_ACCELERATOR_ENABLE, PREFETCH_ENABLE);
+}
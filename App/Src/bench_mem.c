@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    bench_mem.c
+  * @brief   External SDRAM bandwidth benchmark.
+  *
+  *          Both DMA paths use a DMA2 stream (only DMA2 does memory to
+  *          memory) with its FIFO and 4-beat bursts on both ports: stream 4
+  *          programmed through LL and polled, stream 1 behind the HAL SDRAM
+  *          handle. The HAL stream interrupt stays disabled in the NVIC and
+  *          HAL_DMA_IRQHandler() is polled instead: the same HAL code runs,
+  *          no vector is taken for a benchmark.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+#include "stm32f7xx_ll_dma.h"
+
+#include "bench_mem.h"
+#include "dma_buffer.h"
+#include "profile.h"
+#include "sdram.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_MEM_DMA               DMA2
+#define BENCH_MEM_DMA_STREAM        LL_DMA_STREAM_4
+#define BENCH_MEM_HAL_STREAM        DMA2_Stream1
+#define BENCH_MEM_WORDS             (BENCH_MEM_WINDOW / 4U)
+#define BENCH_MEM_BLOCK_WORDS       (BENCH_MEM_BLOCK / 4U)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	const char *name;
+	MpuRegions_MemoryTypeDef type;
+} BenchMem_MappingTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const BenchMem_MappingTypeDef benchMemMappings[] =
+{
+	{ "nocache", MPU_REGIONS_NORMAL_NONCACHEABLE },
+	{ "wthrough", MPU_REGIONS_NORMAL_WRITE_THROUGH },
+	{ "wback", MPU_REGIONS_NORMAL_WRITE_BACK }
+};
+static uint32_t benchMemBlock[BENCH_MEM_BLOCK_WORDS] __attribute__((aligned(DMA_BUFFER_LINE)));
+static DMA_HandleTypeDef benchMemDma;
+static volatile uint32_t benchMemSink;
+
+/* Private functions ---------------------------------------------------------*/
+static void BenchMem_Print(BenchMem_PutCharTypeDef putChar, const char *line)
+{
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
+
+static uint32_t BenchMem_MBps(uint32_t bytes, uint32_t cycles)
+{
+	return (cycles != 0U) ? (uint32_t)(((uint64_t)bytes * SystemCoreClock) / ((uint64_t)cycles * 1000000U)) : 0U;
+}
+
+/**
+ * @brief  Writes of a cached mapping reach the SDRAM.
+ */
+static void BenchMem_Flush(MpuRegions_MemoryTypeDef type, uint32_t *window)
+{
+	if (type == MPU_REGIONS_NORMAL_WRITE_BACK)
+	{
+		SCB_CleanDCache_by_Addr(window, BENCH_MEM_WINDOW);
+	}
+}
+
+static uint32_t BenchMem_SeqRead(const uint32_t *window)
+{
+	uint32_t start = Profile_GetCycles();
+	uint32_t sum = 0U;
+
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += 4U)
+	{
+		sum += window[i] + window[i + 1U] + window[i + 2U] + window[i + 3U];
+	}
+	benchMemSink = sum;
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchMem_SeqWrite(MpuRegions_MemoryTypeDef type, uint32_t *window)
+{
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += 4U)
+	{
+		window[i] = i;
+		window[i + 1U] = i;
+		window[i + 2U] = i;
+		window[i + 3U] = i;
+	}
+	BenchMem_Flush(type, window);
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchMem_Memcpy(MpuRegions_MemoryTypeDef type, uint32_t *window)
+{
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += BENCH_MEM_BLOCK_WORDS)
+	{
+		memcpy(&window[i], benchMemBlock, BENCH_MEM_BLOCK);
+	}
+	BenchMem_Flush(type, window);
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchMem_RandomRead(const uint32_t *window)
+{
+	uint32_t start = Profile_GetCycles();
+	uint32_t seed = 1U;
+	uint32_t sum = 0U;
+
+	for (uint32_t i = 0; i < BENCH_MEM_RANDOM_READS; i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		sum += window[(seed >> 8) & (BENCH_MEM_WORDS - 1U)];
+	}
+	benchMemSink = sum;
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchMem_DmaWrite(uint32_t *window)
+{
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += BENCH_MEM_BLOCK_WORDS)
+	{
+		LL_DMA_SetPeriphAddress(BENCH_MEM_DMA, BENCH_MEM_DMA_STREAM, (uint32_t)benchMemBlock);
+		LL_DMA_SetMemoryAddress(BENCH_MEM_DMA, BENCH_MEM_DMA_STREAM, (uint32_t)&window[i]);
+		LL_DMA_SetDataLength(BENCH_MEM_DMA, BENCH_MEM_DMA_STREAM, BENCH_MEM_BLOCK_WORDS);
+		LL_DMA_EnableStream(BENCH_MEM_DMA, BENCH_MEM_DMA_STREAM);
+		while (LL_DMA_IsActiveFlag_TC4(BENCH_MEM_DMA) == 0U)
+		{
+		}
+		LL_DMA_ClearFlag_TC4(BENCH_MEM_DMA);
+		LL_DMA_ClearFlag_HT4(BENCH_MEM_DMA);
+		LL_DMA_ClearFlag_FE4(BENCH_MEM_DMA);
+	}
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchMem_HalWrite(uint32_t *window)
+{
+	SDRAM_HandleTypeDef *hsdram = Sdram_GetHandle();
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += BENCH_MEM_BLOCK_WORDS)
+	{
+		if (HAL_SDRAM_Write_DMA(hsdram, &window[i], benchMemBlock, BENCH_MEM_BLOCK_WORDS) != HAL_OK)
+		{
+			return 0U;
+		}
+		while (HAL_SDRAM_GetState(hsdram) == HAL_SDRAM_STATE_BUSY)
+		{
+			HAL_DMA_IRQHandler(&benchMemDma);
+		}
+	}
+	return Profile_GetCycles() - start;
+}
+
+static HAL_StatusTypeDef BenchMem_DmaInit(void)
+{
+	LL_DMA_InitTypeDef dmaConfig;
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+
+	LL_DMA_StructInit(&dmaConfig);
+	dmaConfig.Direction = LL_DMA_DIRECTION_MEMORY_TO_MEMORY;
+	dmaConfig.PeriphOrM2MSrcIncMode = LL_DMA_PERIPH_INCREMENT;
+	dmaConfig.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+	dmaConfig.PeriphOrM2MSrcDataSize = LL_DMA_PDATAALIGN_WORD;
+	dmaConfig.MemoryOrM2MDstDataSize = LL_DMA_MDATAALIGN_WORD;
+	dmaConfig.Mode = LL_DMA_MODE_NORMAL;
+	dmaConfig.Priority = LL_DMA_PRIORITY_HIGH;
+	dmaConfig.FIFOMode = LL_DMA_FIFOMODE_ENABLE;
+	dmaConfig.FIFOThreshold = LL_DMA_FIFOTHRESHOLD_FULL;
+	dmaConfig.MemBurst = LL_DMA_MBURST_INC4;
+	dmaConfig.PeriphBurst = LL_DMA_PBURST_INC4;
+	LL_DMA_Init(BENCH_MEM_DMA, BENCH_MEM_DMA_STREAM, &dmaConfig);
+
+	memset(&benchMemDma, 0, sizeof(benchMemDma));
+	benchMemDma.Instance = BENCH_MEM_HAL_STREAM;
+	benchMemDma.Init.Channel = DMA_CHANNEL_0;
+	benchMemDma.Init.Direction = DMA_MEMORY_TO_MEMORY;
+	benchMemDma.Init.PeriphInc = DMA_PINC_ENABLE;
+	benchMemDma.Init.MemInc = DMA_MINC_ENABLE;
+	benchMemDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	benchMemDma.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	benchMemDma.Init.Mode = DMA_NORMAL;
+	benchMemDma.Init.Priority = DMA_PRIORITY_HIGH;
+	benchMemDma.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+	benchMemDma.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	benchMemDma.Init.MemBurst = DMA_MBURST_INC4;
+	benchMemDma.Init.PeriphBurst = DMA_PBURST_INC4;
+	__HAL_LINKDMA(Sdram_GetHandle(), hdma, benchMemDma);
+	return HAL_DMA_Init(&benchMemDma);
+}
+
+/**
+ * @brief  The window holds the SRAM block over and over.
+ */
+static uint32_t BenchMem_Verify(const uint32_t *window)
+{
+	for (uint32_t i = 0; i < BENCH_MEM_WORDS; i += BENCH_MEM_BLOCK_WORDS)
+	{
+		if (memcmp(&window[i], benchMemBlock, BENCH_MEM_BLOCK) != 0)
+		{
+			return 0U;
+		}
+	}
+	return 1U;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Measure every access type under every mapping and print a table,
+ *         then map the SDRAM write-back again.
+ * @note   Each measure starts with a cold D-cache. The window is taken from
+ *         the SDRAM heap and given back.
+ * @param  putChar: output function
+ * @retval None
+ */
+void BenchMem_Report(BenchMem_PutCharTypeDef putChar)
+{
+	const Sdram_TimingTypeDef *timing = Sdram_GetTiming();
+	uint32_t *window = Sdram_Alloc(BENCH_MEM_WINDOW);
+	char line[96];
+
+	if ((window == NULL) || (BenchMem_DmaInit() != HAL_OK))
+	{
+		BenchMem_Print(putChar, "bench_mem: no SDRAM\r\n");
+		Sdram_Free(window);
+		return;
+	}
+	for (uint32_t i = 0; i < BENCH_MEM_BLOCK_WORDS; i++)
+	{
+		benchMemBlock[i] = i * 0x9E3779B9U;
+	}
+	DmaBuffer_PrepareTx(benchMemBlock, BENCH_MEM_BLOCK);
+
+	snprintf(line, sizeof(line), "bench_mem: SDCLK %lu MHz, %lu KB window, MB/s\r\n",
+		(unsigned long)(timing->clockHz / 1000000U), (unsigned long)(BENCH_MEM_WINDOW / 1024U));
+	BenchMem_Print(putChar, line);
+	BenchMem_Print(putChar, "mapping   seq-rd seq-wr memcpy rand-rd dma-wr hal-wr check\r\n");
+
+	for (uint32_t m = 0; m < sizeof(benchMemMappings) / sizeof(benchMemMappings[0]); m++)
+	{
+		MpuRegions_MemoryTypeDef type = benchMemMappings[m].type;
+		uint32_t cycles[6];
+
+		/* Sdram_SetCache() also leaves the D-cache cold */
+		(void)Sdram_SetCache(type);
+		cycles[1] = BenchMem_SeqWrite(type, window);
+		SCB_CleanInvalidateDCache();
+		cycles[0] = BenchMem_SeqRead(window);
+		SCB_CleanInvalidateDCache();
+		cycles[2] = BenchMem_Memcpy(type, window);
+		SCB_CleanInvalidateDCache();
+		cycles[3] = BenchMem_RandomRead(window);
+		/* Nothing of the window is cached after this: the DMA writes need
+		   no maintenance and the check reads the SDRAM */
+		SCB_CleanInvalidateDCache();
+		cycles[4] = BenchMem_DmaWrite(window);
+		cycles[5] = BenchMem_HalWrite(window);
+
+		snprintf(line, sizeof(line), "%-9s %6lu %6lu %6lu %7lu %6lu %6lu %s\r\n", benchMemMappings[m].name,
+			(unsigned long)BenchMem_MBps(BENCH_MEM_WINDOW, cycles[0]),
+			(unsigned long)BenchMem_MBps(BENCH_MEM_WINDOW, cycles[1]),
+			(unsigned long)BenchMem_MBps(BENCH_MEM_WINDOW, cycles[2]),
+			(unsigned long)BenchMem_MBps(BENCH_MEM_RANDOM_READS * 4U, cycles[3]),
+			(unsigned long)BenchMem_MBps(BENCH_MEM_WINDOW, cycles[4]),
+			(unsigned long)BenchMem_MBps(BENCH_MEM_WINDOW, cycles[5]),
+			BenchMem_Verify(window) ? "ok" : "FAIL");
+		BenchMem_Print(putChar, line);
+	}
+
+	(void)Sdram_SetCache(MPU_REGIONS_NORMAL_WRITE_BACK);
+	Sdram_Free(window);
+}
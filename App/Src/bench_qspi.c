@@ -0,0 +1,271 @@
+/**
+  ******************************************************************************
+  * @file    bench_qspi.c
+  * @brief   External QSPI flash read benchmark.
+  *
+  *          The DMA reads borrow DMA2 Stream7 from USART1 TX: the transmit
+  *          side is suspended around them and nothing is printed meanwhile.
+  *          The executed in place function is placed in .qspi by QSPI_TEXT
+  *          and needs the _qspi.bin image programmed into the part; the line
+  *          is skipped on an erased part.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_qspi.h"
+#include "dma_buffer.h"
+#include "mem_section.h"
+#include "profile.h"
+#include "qspi_flash.h"
+#include "usart_dma.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_QSPI_BLOCK_WORDS      (BENCH_QSPI_BLOCK / 4U)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	const char *name;
+	MpuRegions_MemoryTypeDef type;
+} BenchQspi_MappingTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const BenchQspi_MappingTypeDef benchQspiMappings[] =
+{
+	{ "nocache", MPU_REGIONS_NORMAL_NONCACHEABLE },
+	{ "wthrough", MPU_REGIONS_NORMAL_WRITE_THROUGH }
+};
+static uint32_t benchQspiBlock[BENCH_QSPI_BLOCK_WORDS] __attribute__((aligned(DMA_BUFFER_LINE)));
+static uint32_t benchQspiKernelData[BENCH_QSPI_KERNEL_WORDS];
+static volatile uint32_t benchQspiSink;
+
+/* Private functions ---------------------------------------------------------*/
+static void BenchQspi_Print(BenchQspi_PutCharTypeDef putChar, const char *line)
+{
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
+
+static uint32_t BenchQspi_MBps(uint32_t bytes, uint32_t cycles)
+{
+	return (cycles != 0U) ? (uint32_t)(((uint64_t)bytes * SystemCoreClock) / ((uint64_t)cycles * 1000000U)) : 0U;
+}
+
+static uint32_t BenchQspi_SeqRead(const uint32_t *window, uint32_t size)
+{
+	uint32_t start = Profile_GetCycles();
+	uint32_t sum = 0U;
+
+	for (uint32_t i = 0; i < size / 4U; i += 4U)
+	{
+		sum += window[i] + window[i + 1U] + window[i + 2U] + window[i + 3U];
+	}
+	benchQspiSink = sum;
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchQspi_Memcpy(const uint32_t *window, uint32_t size)
+{
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t i = 0; i < size / 4U; i += BENCH_QSPI_BLOCK_WORDS)
+	{
+		memcpy(benchQspiBlock, &window[i], BENCH_QSPI_BLOCK);
+	}
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchQspi_RandomRead(const uint32_t *window, uint32_t size)
+{
+	uint32_t start = Profile_GetCycles();
+	uint32_t seed = 1U;
+	uint32_t sum = 0U;
+
+	for (uint32_t i = 0; i < BENCH_QSPI_RANDOM_READS; i++)
+	{
+		seed = seed * 1664525U + 1013904223U;
+		sum += window[(seed >> 8) & (size / 4U - 1U)];
+	}
+	benchQspiSink = sum;
+	return Profile_GetCycles() - start;
+}
+
+static uint32_t BenchQspi_IndirectRead(uint32_t size)
+{
+	uint32_t start = Profile_GetCycles();
+
+	for (uint32_t offset = 0; offset < size; offset += BENCH_QSPI_BLOCK)
+	{
+		if (QspiFlash_Read(offset, benchQspiBlock, BENCH_QSPI_BLOCK) != HAL_OK)
+		{
+			return 0U;
+		}
+	}
+	return Profile_GetCycles() - start;
+}
+
+/**
+ * @brief  Time the DMA reads of the window, then compare every block with
+ *         the memory-mapped data.
+ * @param  cycles: time of the reads, 0 on an error
+ * @retval 1 when the data matches
+ */
+static uint32_t BenchQspi_DmaRead(const uint32_t *window, uint32_t size, uint32_t *cycles)
+{
+	uint32_t start;
+	uint32_t match = 1U;
+
+	UsartDma_TxSuspend();
+	start = Profile_GetCycles();
+	*cycles = 0U;
+	for (uint32_t offset = 0; offset < size; offset += BENCH_QSPI_BLOCK)
+	{
+		if (QspiFlash_ReadDma(offset, benchQspiBlock, BENCH_QSPI_BLOCK) != HAL_OK)
+		{
+			match = 0U;
+			break;
+		}
+	}
+	if (match != 0U)
+	{
+		*cycles = Profile_GetCycles() - start;
+	}
+	for (uint32_t offset = 0; (match != 0U) && (offset < size); offset += BENCH_QSPI_BLOCK)
+	{
+		match = (QspiFlash_ReadDma(offset, benchQspiBlock, BENCH_QSPI_BLOCK) == HAL_OK)
+			&& (memcmp(benchQspiBlock, &window[offset / 4U], BENCH_QSPI_BLOCK) == 0);
+	}
+	UsartDma_TxResume();
+	return match;
+}
+
+/**
+ * @brief  The same code is compiled into both placements.
+ */
+static inline __attribute__((always_inline)) uint32_t BenchQspi_Hash(const uint32_t *data, uint32_t words)
+{
+	uint32_t hash = 2166136261U;
+
+	for (uint32_t i = 0; i < words; i++)
+	{
+		hash = (hash ^ data[i]) * 16777619U;
+		hash ^= hash >> 13;
+	}
+	return hash;
+}
+
+static __attribute__((noinline)) uint32_t BenchQspi_HashFlash(const uint32_t *data, uint32_t words)
+{
+	return BenchQspi_Hash(data, words);
+}
+
+QSPI_TEXT static uint32_t BenchQspi_HashXip(const uint32_t *data, uint32_t words)
+{
+	return BenchQspi_Hash(data, words);
+}
+
+static uint32_t BenchQspi_Time(uint32_t (*hash)(const uint32_t *data, uint32_t words), uint32_t *result)
+{
+	uint32_t start = Profile_GetCycles();
+
+	*result = hash(benchQspiKernelData, BENCH_QSPI_KERNEL_WORDS);
+	return Profile_GetCycles() - start;
+}
+
+/**
+ * @brief  Run the hash from the internal flash, then from the QSPI flash
+ *         with a cold and a warm I-cache, and print the cycles.
+ */
+static void BenchQspi_Xip(BenchQspi_PutCharTypeDef putChar)
+{
+	const uint32_t *code = (const uint32_t *)((uintptr_t)BenchQspi_HashXip & ~(uintptr_t)1U);
+	uint32_t results[3];
+	uint32_t cycles[3];
+	char line[96];
+
+	if (*code == 0xFFFFFFFFU)
+	{
+		BenchQspi_Print(putChar, "xip: .qspi not programmed\r\n");
+		return;
+	}
+	for (uint32_t i = 0; i < BENCH_QSPI_KERNEL_WORDS; i++)
+	{
+		benchQspiKernelData[i] = i * 0x9E3779B9U;
+	}
+
+	cycles[0] = BenchQspi_Time(BenchQspi_HashFlash, &results[0]);
+	SCB_InvalidateICache();
+	cycles[1] = BenchQspi_Time(BenchQspi_HashXip, &results[1]);
+	cycles[2] = BenchQspi_Time(BenchQspi_HashXip, &results[2]);
+
+	snprintf(line, sizeof(line), "xip: %lu words, cycles flash %lu, qspi cold %lu warm %lu %s\r\n",
+		(unsigned long)BENCH_QSPI_KERNEL_WORDS, (unsigned long)cycles[0], (unsigned long)cycles[1],
+		(unsigned long)cycles[2], ((results[1] == results[0]) && (results[2] == results[0])) ? "ok" : "FAIL");
+	BenchQspi_Print(putChar, line);
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Measure every read path under every mapping and print a table,
+ *         then map the part write-through again.
+ * @note   Each mapped measure starts with a cold D-cache. The part is only
+ *         read, whatever it holds.
+ * @param  putChar: output function
+ * @retval None
+ */
+void BenchQspi_Report(BenchQspi_PutCharTypeDef putChar)
+{
+	const QspiFlash_ReadTypeDef *read = QspiFlash_GetRead();
+	const uint32_t *window = (const uint32_t *)QSPI_FLASH_BASE;
+	uint32_t size = BENCH_QSPI_WINDOW;
+	char line[96];
+
+	if (read->size == 0U)
+	{
+		BenchQspi_Print(putChar, "bench_qspi: no QSPI flash\r\n");
+		return;
+	}
+	if (size > read->size)
+	{
+		size = read->size;
+	}
+
+	snprintf(line, sizeof(line), "bench_qspi: CLK %lu MHz %s, %lu KB window, MB/s\r\n",
+		(unsigned long)(read->clockHz / 1000000U), (read->command.DdrMode != QSPI_DDR_MODE_DISABLE) ? "DTR" : "SDR",
+		(unsigned long)(size / 1024U));
+	BenchQspi_Print(putChar, line);
+	BenchQspi_Print(putChar, "mapping   seq-rd memcpy rand-rd ind-rd dma-rd check\r\n");
+
+	for (uint32_t m = 0; m < sizeof(benchQspiMappings) / sizeof(benchQspiMappings[0]); m++)
+	{
+		uint32_t cycles[5];
+		uint32_t match;
+
+		/* QspiFlash_SetCache() also leaves the D-cache cold */
+		(void)QspiFlash_SetCache(benchQspiMappings[m].type);
+		cycles[0] = BenchQspi_SeqRead(window, size);
+		SCB_CleanInvalidateDCache();
+		cycles[1] = BenchQspi_Memcpy(window, size);
+		SCB_CleanInvalidateDCache();
+		cycles[2] = BenchQspi_RandomRead(window, size);
+		cycles[3] = BenchQspi_IndirectRead(size);
+		match = BenchQspi_DmaRead(window, size, &cycles[4]);
+
+		snprintf(line, sizeof(line), "%-9s %6lu %6lu %7lu %6lu %6lu %s\r\n", benchQspiMappings[m].name,
+			(unsigned long)BenchQspi_MBps(size, cycles[0]),
+			(unsigned long)BenchQspi_MBps(size, cycles[1]),
+			(unsigned long)BenchQspi_MBps(BENCH_QSPI_RANDOM_READS * 4U, cycles[2]),
+			(unsigned long)BenchQspi_MBps(size, cycles[3]),
+			(unsigned long)BenchQspi_MBps(size, cycles[4]),
+			match ? "ok" : "FAIL");
+		BenchQspi_Print(putChar, line);
+	}
+
+	(void)QspiFlash_SetCache(MPU_REGIONS_NORMAL_WRITE_THROUGH);
+	BenchQspi_Xip(putChar);
+}
@@ -0,0 +1,743 @@
+/**
+  ******************************************************************************
+  * @file    block_dev.c
+  * @brief   Block device layer: request queue and write-back cache.
+  *
+  *          One device operation at a time, filling or writing back a run
+  *          of blocks of one line; the line it moves is left alone by the
+  *          requests until it ends, the other lines keep serving them. The
+  *          lines are few (BLOCK_DEV_MAX_LINES), lookups and the LRU victim
+  *          are a scan of them.
+  *
+  *          The queue is served by a pump run from the calls and from the
+  *          device completion, one at a time: a pump entered while another
+  *          runs only asks it to go round again, so the block copies run
+  *          with the interrupts enabled.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "block_dev.h"
+#include "dma_buffer.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BLOCK_DEV_NONE              0xFFFFFFFFU
+#define BLOCK_DEV_LINE_FULL         (0xFFFFFFFFU >> (32U - BLOCK_DEV_LINE_BLOCKS))
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+	BLOCK_DEV_READ = 0,
+	BLOCK_DEV_WRITE,
+	BLOCK_DEV_FLUSH
+} BlockDev_OpTypeDef;
+
+typedef enum
+{
+	BLOCK_DEV_IDLE = 0,
+	BLOCK_DEV_FILL,                     /* device to line */
+	BLOCK_DEV_WRITEBACK                 /* line to device */
+} BlockDev_StateTypeDef;
+
+typedef struct
+{
+	BlockDev_OpTypeDef op;
+	uint8_t *destination;
+	const uint8_t *source;
+	uint32_t block;
+	uint32_t count;
+	uint32_t done;                      /* blocks served */
+	BlockDev_DoneTypeDef callback;
+	void *arg;
+} BlockDev_RequestTypeDef;
+
+typedef struct
+{
+	uint32_t first;                     /* first block, BLOCK_DEV_NONE when free */
+	uint32_t valid;                     /* blocks holding data, bit n for first + n */
+	uint32_t dirty;                     /* of those, blocks not written back */
+	uint32_t used;                      /* LRU stamp */
+	uint8_t *data;
+} BlockDev_LineTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const BlockDev_DeviceTypeDef *blockDevDevice;
+static uint32_t blockDevBlocks;
+static BlockDev_LineTypeDef blockDevLines[BLOCK_DEV_MAX_LINES];
+static uint32_t blockDevLineCount;
+static uint32_t blockDevClock;
+
+/* Queue: the tail moves with the calls, the head with the pump */
+static BlockDev_RequestTypeDef blockDevQueue[BLOCK_DEV_QUEUE_DEPTH];
+static uint32_t blockDevHead;
+static uint32_t blockDevTail;
+
+/* Device operation in progress */
+static BlockDev_StateTypeDef blockDevState;
+static BlockDev_LineTypeDef *blockDevOpLine;
+static uint32_t blockDevOpMask;
+static uint32_t blockDevOpAhead;
+static volatile uint32_t blockDevDone;      /* ended, BlockDev_Finish() to come */
+static volatile HAL_StatusTypeDef blockDevDoneStatus;
+static volatile uint32_t blockDevStalled;   /* device answered busy, until BlockDev_Poll() */
+
+static uint32_t blockDevWriteError;         /* a write-back failed since the last flush */
+static uint32_t blockDevNextRead;           /* block following the last read */
+static uint32_t blockDevAhead;              /* next line to read ahead */
+static uint32_t blockDevAheadLeft;
+
+static uint32_t blockDevPumping;
+static volatile uint32_t blockDevPumpAgain;
+static BlockDev_StatsTypeDef blockDevStats;
+
+/* Private functions ---------------------------------------------------------*/
+static BlockDev_LineTypeDef *BlockDev_Find(uint32_t block)
+{
+	uint32_t first = block - (block % BLOCK_DEV_LINE_BLOCKS);
+
+	for (uint32_t i = 0; i < blockDevLineCount; i++)
+	{
+		if (blockDevLines[i].first == first)
+		{
+			return &blockDevLines[i];
+		}
+	}
+	return NULL;
+}
+
+/* Blocks of the line inside the medium */
+static uint32_t BlockDev_InRange(const BlockDev_LineTypeDef *line)
+{
+	uint32_t left = blockDevBlocks - line->first;
+
+	return (left >= BLOCK_DEV_LINE_BLOCKS) ? BLOCK_DEV_LINE_FULL : (0xFFFFFFFFU >> (32U - left));
+}
+
+/* Run of contiguous set bits of mask around bit start */
+static uint32_t BlockDev_Run(uint32_t mask, uint32_t start)
+{
+	uint32_t end = start;
+
+	while ((start > 0U) && ((mask & (1UL << (start - 1U))) != 0U))
+	{
+		start--;
+	}
+	while ((end + 1U < BLOCK_DEV_LINE_BLOCKS) && ((mask & (1UL << (end + 1U))) != 0U))
+	{
+		end++;
+	}
+	return (0xFFFFFFFFU >> (31U - (end - start))) << start;
+}
+
+static uint32_t BlockDev_CanStart(void)
+{
+	return (blockDevState == BLOCK_DEV_IDLE) && (blockDevStalled == 0U);
+}
+
+/* Start a fill or a write-back of the run mask of a line */
+static void BlockDev_Start(BlockDev_StateTypeDef state, BlockDev_LineTypeDef *line, uint32_t mask, uint32_t ahead)
+{
+	uint32_t start = (uint32_t)__builtin_ctz(mask);
+	uint32_t count = (uint32_t)__builtin_ctz(~(mask >> start));
+	uint8_t *data = &line->data[start * BLOCK_DEV_BLOCK_SIZE];
+	HAL_StatusTypeDef status;
+
+	/* Set first: the completion may come from within the call */
+	blockDevState = state;
+	blockDevOpLine = line;
+	blockDevOpMask = mask;
+	blockDevOpAhead = ahead;
+	if (state == BLOCK_DEV_FILL)
+	{
+		status = blockDevDevice->read(data, line->first + start, count);
+	}
+	else
+	{
+		status = blockDevDevice->write(data, line->first + start, count);
+	}
+
+	if (status == HAL_BUSY)
+	{
+		blockDevState = BLOCK_DEV_IDLE;
+		blockDevOpLine = NULL;
+		blockDevStalled = 1U;
+		blockDevStats.busy++;
+		return;
+	}
+	if (state == BLOCK_DEV_FILL)
+	{
+		blockDevStats.fills++;
+		blockDevStats.fillBlocks += count;
+		blockDevStats.aheadFills += ahead;
+	}
+	else
+	{
+		blockDevStats.writebacks++;
+		blockDevStats.writebackBlocks += count;
+	}
+	if (status != HAL_OK)
+	{
+		/* Ended at once: finished by the pump going round again */
+		blockDevDoneStatus = HAL_ERROR;
+		blockDevDone = 1U;
+		blockDevPumpAgain = 1U;
+	}
+}
+
+/* Write back the first dirty run of a line */
+static void BlockDev_WriteBack(BlockDev_LineTypeDef *line)
+{
+	BlockDev_Start(BLOCK_DEV_WRITEBACK, line, BlockDev_Run(line->dirty, (uint32_t)__builtin_ctz(line->dirty)), 0U);
+}
+
+/**
+ * @brief  Line for the line of block: a free one, else the least recently
+ *         used clean one. With only dirty ones left, the least recently
+ *         used starts its write-back when dirty is set and the device idle.
+ * @retval Line emptied, NULL if none yet
+ */
+static BlockDev_LineTypeDef *BlockDev_Allocate(uint32_t block, uint32_t dirty)
+{
+	BlockDev_LineTypeDef *clean = NULL;
+	BlockDev_LineTypeDef *written = NULL;
+
+	for (uint32_t i = 0; i < blockDevLineCount; i++)
+	{
+		BlockDev_LineTypeDef *line = &blockDevLines[i];
+
+		if (line == blockDevOpLine)
+		{
+			continue;
+		}
+		if (line->first == BLOCK_DEV_NONE)
+		{
+			clean = line;
+			break;
+		}
+		if (line->dirty == 0U)
+		{
+			if ((clean == NULL) || (line->used < clean->used))
+			{
+				clean = line;
+			}
+		}
+		else if ((written == NULL) || (line->used < written->used))
+		{
+			written = line;
+		}
+	}
+
+	if (clean != NULL)
+	{
+		clean->first = block - (block % BLOCK_DEV_LINE_BLOCKS);
+		clean->valid = 0U;
+		clean->used = ++blockDevClock;
+		return clean;
+	}
+	if ((dirty != 0U) && (written != NULL) && (BlockDev_CanStart() != 0U))
+	{
+		BlockDev_WriteBack(written);
+	}
+	return NULL;
+}
+
+/* Pop the head request and call its callback */
+static void BlockDev_Complete(HAL_StatusTypeDef status)
+{
+	BlockDev_RequestTypeDef *request = &blockDevQueue[blockDevHead % BLOCK_DEV_QUEUE_DEPTH];
+	BlockDev_DoneTypeDef callback = request->callback;
+	void *arg = request->arg;
+
+	if (request->op == BLOCK_DEV_READ)
+	{
+		/* Following on from the last read: read ahead of this one */
+		if (request->block == blockDevNextRead)
+		{
+			uint32_t last = request->block + request->count - 1U;
+
+			blockDevAhead = last - (last % BLOCK_DEV_LINE_BLOCKS) + BLOCK_DEV_LINE_BLOCKS;
+			blockDevAheadLeft = BLOCK_DEV_READ_AHEAD;
+		}
+		blockDevNextRead = request->block + request->count;
+	}
+
+	blockDevHead++;
+	if (callback != NULL)
+	{
+		callback(status, arg);
+	}
+}
+
+static void BlockDev_Finish(HAL_StatusTypeDef status)
+{
+	BlockDev_StateTypeDef state = blockDevState;
+	BlockDev_LineTypeDef *line = blockDevOpLine;
+	uint32_t mask = blockDevOpMask;
+
+	blockDevState = BLOCK_DEV_IDLE;
+	blockDevOpLine = NULL;
+	if (status != HAL_OK)
+	{
+		blockDevStats.errors++;
+	}
+
+	if (state == BLOCK_DEV_WRITEBACK)
+	{
+		/* A block that did not make it is lost: reported by the next flush */
+		line->dirty &= ~mask;
+		if (status != HAL_OK)
+		{
+			line->valid &= ~mask;
+			blockDevWriteError = 1U;
+		}
+	}
+	else if (status == HAL_OK)
+	{
+		line->valid |= mask;
+	}
+	else if (blockDevOpAhead == 0U)
+	{
+		/* The fill was for the read at the head */
+		BlockDev_Complete(HAL_ERROR);
+	}
+	else
+	{
+		blockDevAheadLeft = 0U;
+	}
+
+	if ((line->valid == 0U) && (line->dirty == 0U))
+	{
+		line->first = BLOCK_DEV_NONE;
+	}
+}
+
+/**
+ * @brief  Serve the blocks of the read or write at the head.
+ * @retval 1 when all of them are, 0 waiting for the device
+ */
+static uint32_t BlockDev_ServeBlocks(BlockDev_RequestTypeDef *request)
+{
+	while (request->done < request->count)
+	{
+		uint32_t block = request->block + request->done;
+		uint32_t index = block % BLOCK_DEV_LINE_BLOCKS;
+		uint32_t bit = 1UL << index;
+		BlockDev_LineTypeDef *line = BlockDev_Find(block);
+
+		if ((line != NULL) && (line == blockDevOpLine))
+		{
+			return 0U;
+		}
+
+		if (request->op == BLOCK_DEV_READ)
+		{
+			if ((line == NULL) || ((line->valid & bit) == 0U))
+			{
+				if (BlockDev_CanStart() == 0U)
+				{
+					return 0U;
+				}
+				if (line == NULL)
+				{
+					line = BlockDev_Allocate(block, 1U);
+				}
+				if (line != NULL)
+				{
+					/* The blocks missing around this one, at once */
+					BlockDev_Start(BLOCK_DEV_FILL, line, BlockDev_Run(~line->valid & BlockDev_InRange(line), index),
+						0U);
+				}
+				return 0U;
+			}
+			memcpy(&request->destination[request->done * BLOCK_DEV_BLOCK_SIZE],
+				&line->data[index * BLOCK_DEV_BLOCK_SIZE], BLOCK_DEV_BLOCK_SIZE);
+			blockDevStats.hits++;
+		}
+		else
+		{
+			if (line == NULL)
+			{
+				line = BlockDev_Allocate(block, 1U);
+				if (line == NULL)
+				{
+					return 0U;
+				}
+			}
+			memcpy(&line->data[index * BLOCK_DEV_BLOCK_SIZE],
+				&request->source[request->done * BLOCK_DEV_BLOCK_SIZE], BLOCK_DEV_BLOCK_SIZE);
+			if ((line->dirty & bit) != 0U)
+			{
+				blockDevStats.merged++;
+			}
+			line->valid |= bit;
+			line->dirty |= bit;
+		}
+		line->used = ++blockDevClock;
+		request->done++;
+	}
+	return 1U;
+}
+
+/**
+ * @brief  Serve the flush at the head: every dirty line written back, in
+ *         block order.
+ * @retval 1 when none is left, 0 waiting for the device
+ */
+static uint32_t BlockDev_ServeFlush(void)
+{
+	BlockDev_LineTypeDef *dirty = NULL;
+
+	if (blockDevState != BLOCK_DEV_IDLE)
+	{
+		return 0U;
+	}
+	for (uint32_t i = 0; i < blockDevLineCount; i++)
+	{
+		BlockDev_LineTypeDef *line = &blockDevLines[i];
+
+		if ((line->dirty != 0U) && ((dirty == NULL) || (line->first < dirty->first)))
+		{
+			dirty = line;
+		}
+	}
+	if (dirty == NULL)
+	{
+		return 1U;
+	}
+	if (blockDevStalled == 0U)
+	{
+		BlockDev_WriteBack(dirty);
+	}
+	return 0U;
+}
+
+/* Queue idle: write back the lines written whole, then read ahead */
+static void BlockDev_Background(void)
+{
+	BlockDev_LineTypeDef *full = NULL;
+
+	if (BlockDev_CanStart() == 0U)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < blockDevLineCount; i++)
+	{
+		BlockDev_LineTypeDef *line = &blockDevLines[i];
+
+		if ((line->first != BLOCK_DEV_NONE) && (line->dirty == BlockDev_InRange(line))
+				&& ((full == NULL) || (line->first < full->first)))
+		{
+			full = line;
+		}
+	}
+	if (full != NULL)
+	{
+		BlockDev_WriteBack(full);
+		return;
+	}
+
+	while (blockDevAheadLeft != 0U)
+	{
+		BlockDev_LineTypeDef *line;
+		uint32_t missing;
+
+		if (blockDevAhead >= blockDevBlocks)
+		{
+			blockDevAheadLeft = 0U;
+			return;
+		}
+		line = BlockDev_Find(blockDevAhead);
+		if (line == NULL)
+		{
+			/* Never at the cost of a write-back */
+			line = BlockDev_Allocate(blockDevAhead, 0U);
+			if (line == NULL)
+			{
+				blockDevAheadLeft = 0U;
+				return;
+			}
+		}
+		missing = ~line->valid & BlockDev_InRange(line);
+		if (missing != 0U)
+		{
+			BlockDev_Start(BLOCK_DEV_FILL, line, BlockDev_Run(missing, (uint32_t)__builtin_ctz(missing)), 1U);
+			return;
+		}
+		blockDevAhead += BLOCK_DEV_LINE_BLOCKS;
+		blockDevAheadLeft--;
+	}
+}
+
+static void BlockDev_PumpOnce(void)
+{
+	if (blockDevDone != 0U)
+	{
+		blockDevDone = 0U;
+		BlockDev_Finish(blockDevDoneStatus);
+	}
+
+	while (blockDevHead != blockDevTail)
+	{
+		BlockDev_RequestTypeDef *request = &blockDevQueue[blockDevHead % BLOCK_DEV_QUEUE_DEPTH];
+
+		if (request->op != BLOCK_DEV_FLUSH)
+		{
+			if (BlockDev_ServeBlocks(request) == 0U)
+			{
+				return;
+			}
+			BlockDev_Complete(HAL_OK);
+			continue;
+		}
+
+		if (BlockDev_ServeFlush() == 0U)
+		{
+			return;
+		}
+		BlockDev_Complete((blockDevWriteError != 0U) ? HAL_ERROR : HAL_OK);
+		blockDevWriteError = 0U;
+	}
+
+	BlockDev_Background();
+}
+
+static void BlockDev_Pump(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (blockDevPumping != 0U)
+	{
+		blockDevPumpAgain = 1U;
+		__set_PRIMASK(primask);
+		return;
+	}
+	blockDevPumping = 1U;
+	do
+	{
+		blockDevPumpAgain = 0U;
+		__set_PRIMASK(primask);
+		BlockDev_PumpOnce();
+		__disable_irq();
+	} while (blockDevPumpAgain != 0U);
+	blockDevPumping = 0U;
+	__set_PRIMASK(primask);
+}
+
+static HAL_StatusTypeDef BlockDev_Submit(BlockDev_OpTypeDef op, uint8_t *destination, const uint8_t *source,
+		uint32_t block, uint32_t count, BlockDev_DoneTypeDef done, void *arg)
+{
+	BlockDev_RequestTypeDef *request;
+	uint32_t primask;
+
+	if (blockDevDevice == NULL)
+	{
+		return HAL_ERROR;
+	}
+	if ((op != BLOCK_DEV_FLUSH) && ((count == 0U) || (block >= blockDevBlocks) || (count > blockDevBlocks - block)))
+	{
+		return HAL_ERROR;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (blockDevTail - blockDevHead >= BLOCK_DEV_QUEUE_DEPTH)
+	{
+		__set_PRIMASK(primask);
+		return HAL_BUSY;
+	}
+	request = &blockDevQueue[blockDevTail % BLOCK_DEV_QUEUE_DEPTH];
+	request->op = op;
+	request->destination = destination;
+	request->source = source;
+	request->block = block;
+	request->count = count;
+	request->done = 0U;
+	request->callback = done;
+	request->arg = arg;
+	blockDevTail++;
+	if (op == BLOCK_DEV_READ)
+	{
+		blockDevStats.reads++;
+	}
+	else if (op == BLOCK_DEV_WRITE)
+	{
+		blockDevStats.writes++;
+	}
+	else
+	{
+		blockDevStats.flushes++;
+	}
+	__set_PRIMASK(primask);
+
+	BlockDev_Pump();
+	return HAL_OK;
+}
+
+/**
+ * @brief  Take a device and a cache buffer, the cache emptied.
+ * @note   No device operation may be in progress.
+ * @param  device: device calls, its completion reported to
+ *         BlockDev_DeviceDone()
+ * @param  cache: DMA_BUFFER_LINE aligned, at least two lines
+ * @param  size: bytes, lines beyond BLOCK_DEV_MAX_LINES are left unused
+ * @retval HAL_OK, HAL_ERROR without a medium or with a cache too small
+ */
+HAL_StatusTypeDef BlockDev_Init(const BlockDev_DeviceTypeDef *device, uint8_t *cache, uint32_t size)
+{
+	uint32_t lines = size / BLOCK_DEV_LINE_SIZE;
+	uint32_t blocks;
+
+	blockDevDevice = NULL;
+	if ((lines < 2U) || (((uintptr_t)cache % DMA_BUFFER_LINE) != 0U) || (device->capacity(&blocks) != HAL_OK)
+			|| (blocks == 0U))
+	{
+		return HAL_ERROR;
+	}
+
+	blockDevBlocks = blocks;
+	blockDevLineCount = (lines < BLOCK_DEV_MAX_LINES) ? lines : BLOCK_DEV_MAX_LINES;
+	for (uint32_t i = 0; i < blockDevLineCount; i++)
+	{
+		blockDevLines[i].first = BLOCK_DEV_NONE;
+		blockDevLines[i].valid = 0U;
+		blockDevLines[i].dirty = 0U;
+		blockDevLines[i].used = 0U;
+		blockDevLines[i].data = &cache[i * BLOCK_DEV_LINE_SIZE];
+	}
+	blockDevClock = 0U;
+	blockDevHead = blockDevTail = 0U;
+	blockDevState = BLOCK_DEV_IDLE;
+	blockDevOpLine = NULL;
+	blockDevDone = 0U;
+	blockDevStalled = 0U;
+	blockDevWriteError = 0U;
+	blockDevNextRead = BLOCK_DEV_NONE;
+	blockDevAheadLeft = 0U;
+	blockDevPumping = 0U;
+	memset(&blockDevStats, 0, sizeof(blockDevStats));
+	blockDevDevice = device;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Medium size found by BlockDev_Init().
+ * @retval Blocks, 0 before a successful BlockDev_Init()
+ */
+uint32_t BlockDev_GetBlockCount(void)
+{
+	return (blockDevDevice != NULL) ? blockDevBlocks : 0U;
+}
+
+/**
+ * @brief  Queue a read.
+ * @param  buffer: count * BLOCK_DEV_BLOCK_SIZE bytes
+ * @param  block: first block
+ * @param  count: number of blocks
+ * @param  done: called with the outcome, possibly before the call returns
+ * @param  arg: passed to done
+ * @retval HAL_OK: queued; HAL_BUSY: queue full; HAL_ERROR: out of the medium
+ */
+HAL_StatusTypeDef BlockDev_Read(uint8_t *buffer, uint32_t block, uint32_t count, BlockDev_DoneTypeDef done,
+		void *arg)
+{
+	return BlockDev_Submit(BLOCK_DEV_READ, buffer, NULL, block, count, done, arg);
+}
+
+/**
+ * @brief  Queue a write. The buffer is copied into the cache: it is free
+ *         again once done is called, before the blocks reach the device.
+ * @retval As BlockDev_Read()
+ */
+HAL_StatusTypeDef BlockDev_Write(const uint8_t *buffer, uint32_t block, uint32_t count, BlockDev_DoneTypeDef done,
+		void *arg)
+{
+	return BlockDev_Submit(BLOCK_DEV_WRITE, NULL, buffer, block, count, done, arg);
+}
+
+/**
+ * @brief  Queue a barrier: done is called once every write queued before
+ *         it is on the device.
+ * @param  done: called with HAL_ERROR when a write-back failed since the
+ *         previous flush, those blocks lost; HAL_OK otherwise
+ * @param  arg: passed to done
+ * @retval HAL_OK: queued; HAL_BUSY: queue full
+ */
+HAL_StatusTypeDef BlockDev_Flush(BlockDev_DoneTypeDef done, void *arg)
+{
+	return BlockDev_Submit(BLOCK_DEV_FLUSH, NULL, NULL, 0U, 0U, done, arg);
+}
+
+/**
+ * @brief  End of the device operation, from its completion interrupt or
+ *         from within the device call.
+ * @param  status: HAL_OK, HAL_ERROR
+ * @retval None
+ */
+void BlockDev_DeviceDone(HAL_StatusTypeDef status)
+{
+	if (blockDevState == BLOCK_DEV_IDLE)
+	{
+		return;
+	}
+	blockDevDoneStatus = status;
+	blockDevDone = 1U;
+	BlockDev_Pump();
+}
+
+/**
+ * @brief  Start again the device operation refused busy, every
+ *         BLOCK_DEV_POLL_MS.
+ * @retval None
+ */
+void BlockDev_Poll(void)
+{
+	if (blockDevStalled == 0U)
+	{
+		return;
+	}
+	blockDevStalled = 0U;
+	BlockDev_Pump();
+}
+
+/**
+ * @brief  Copy the counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void BlockDev_GetStats(BlockDev_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = blockDevStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void BlockDev_Dump(BlockDev_PutCharTypeDef putChar)
+{
+	BlockDev_StatsTypeDef stats;
+	char line[192];
+
+	BlockDev_GetStats(&stats);
+	snprintf(line, sizeof(line),
+		"blk rd=%lu wr=%lu fl=%lu hit=%lu merge=%lu fill=%lu/%lu ahead=%lu wb=%lu/%lu busy=%lu err=%lu\r\n",
+		(unsigned long)stats.reads, (unsigned long)stats.writes, (unsigned long)stats.flushes,
+		(unsigned long)stats.hits, (unsigned long)stats.merged, (unsigned long)stats.fills,
+		(unsigned long)stats.fillBlocks, (unsigned long)stats.aheadFills, (unsigned long)stats.writebacks,
+		(unsigned long)stats.writebackBlocks, (unsigned long)stats.busy, (unsigned long)stats.errors);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,550 @@
+/**
+  ******************************************************************************
+  * @file    crc_stream.c
+  * @brief   Streaming CRC: CRC peripheral fed by memory-to-memory DMA, with
+  *          a bit-exact software engine (slice-by-8 tables or bitwise).
+  *
+  *          The peripheral always runs the normal (MSB-first) register with
+  *          REV_OUT off, output reflection is done in CrcStream_Final() so
+  *          the raw DR value can be saved and reloaded as INIT. Reflected
+  *          input uses REV_IN by word on little-endian words (byte 0 first,
+  *          LSB first) and by byte on single bytes. Normal input is fed as
+  *          bytes by the DMA and as byte-swapped words by the CPU.
+  *          The software engines keep reflected CRCs in a reflected,
+  *          right-aligned register and normal CRCs in a left-aligned one,
+  *          so one table shape serves every width.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+#include "stm32f7xx_ll_bus.h"
+#include "stm32f7xx_ll_crc.h"
+#include "stm32f7xx_ll_dma.h"
+
+#include "crc_stream.h"
+#include "dma_buffer.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define CRC_STREAM_DMA              DMA2    /* only DMA2 does memory-to-memory */
+#define CRC_STREAM_DMA_STREAM       LL_DMA_STREAM_0
+#define CRC_STREAM_DMA_MAX_ITEMS    0xFFFFU
+
+/* Exported variables --------------------------------------------------------*/
+const CrcStream_ConfigTypeDef crcStreamCrc32 = { 0x04C11DB7UL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 32U, 1U, 1U };
+const CrcStream_ConfigTypeDef crcStreamCrc32C = { 0x1EDC6F41UL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 32U, 1U, 1U };
+const CrcStream_ConfigTypeDef crcStreamCrc32Mpeg2 = { 0x04C11DB7UL, 0xFFFFFFFFUL, 0x00000000UL, 32U, 0U, 0U };
+const CrcStream_ConfigTypeDef crcStreamCrc16Ccitt = { 0x1021U, 0xFFFFU, 0x0000U, 16U, 0U, 0U };
+const CrcStream_ConfigTypeDef crcStreamCrc16Modbus = { 0x8005U, 0xFFFFU, 0x0000U, 16U, 1U, 1U };
+const CrcStream_ConfigTypeDef crcStreamCrc8 = { 0x07U, 0x00U, 0x00U, 8U, 0U, 0U };
+
+/* Private variables ---------------------------------------------------------*/
+#if (CRC_STREAM_HARDWARE == 1)
+static CrcStream_TypeDef *crcStreamOwner;   /* stream whose register is in CRC->DR */
+static uint32_t crcStreamDmaBusy;
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t CrcStream_Mask(uint32_t width)
+{
+	return (width == 32U) ? 0xFFFFFFFFUL : ((1UL << width) - 1U);
+}
+
+/* Reflect the low width bits */
+static inline uint32_t CrcStream_Reflect(uint32_t value, uint32_t width)
+{
+	return __RBIT(value) >> (32U - width);
+}
+
+static inline uint32_t CrcStream_Load32(const uint8_t *p)
+{
+	uint32_t value;
+
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/**
+ * @brief  Bitwise engine, one bit per step.
+ * @param  config: CRC parameters
+ * @param  crc: register, reflected right-aligned or normal left-aligned
+ * @param  p: data
+ * @param  length: bytes
+ * @retval register
+ */
+static uint32_t CrcStream_UpdateBitwise(const CrcStream_ConfigTypeDef *config, uint32_t crc,
+		const uint8_t *p, uint32_t length)
+{
+	if (config->reflectIn != 0U)
+	{
+		uint32_t poly = CrcStream_Reflect(config->poly, config->width);
+
+		while (length-- != 0U)
+		{
+			crc ^= *p++;
+			for (uint32_t bit = 0; bit < 8U; bit++)
+			{
+				crc = ((crc & 1U) != 0U) ? ((crc >> 1) ^ poly) : (crc >> 1);
+			}
+		}
+	}
+	else
+	{
+		uint32_t poly = config->poly << (32U - config->width);
+
+		while (length-- != 0U)
+		{
+			crc ^= (uint32_t)*p++ << 24;
+			for (uint32_t bit = 0; bit < 8U; bit++)
+			{
+				crc = ((crc & 0x80000000UL) != 0U) ? ((crc << 1) ^ poly) : (crc << 1);
+			}
+		}
+	}
+
+	return crc;
+}
+
+/**
+ * @brief  Slice-by-8 engine, eight bytes per step.
+ * @param  table: tables of the stream configuration
+ * @param  crc: register, reflected right-aligned or normal left-aligned
+ * @param  p: data
+ * @param  length: bytes
+ * @retval register
+ */
+static uint32_t CrcStream_UpdateTable(const CrcStream_TableTypeDef *table, uint32_t crc,
+		const uint8_t *p, uint32_t length)
+{
+	const uint32_t (*t)[256] = table->entry;
+	uint32_t lo;
+	uint32_t hi;
+
+	if (table->config->reflectIn != 0U)
+	{
+		for (; length >= 8U; length -= 8U, p += 8)
+		{
+			lo = CrcStream_Load32(p) ^ crc;
+			hi = CrcStream_Load32(p + 4);
+			crc = t[7][lo & 0xFFU] ^ t[6][(lo >> 8) & 0xFFU] ^ t[5][(lo >> 16) & 0xFFU] ^ t[4][lo >> 24]
+				^ t[3][hi & 0xFFU] ^ t[2][(hi >> 8) & 0xFFU] ^ t[1][(hi >> 16) & 0xFFU] ^ t[0][hi >> 24];
+		}
+		while (length-- != 0U)
+		{
+			crc = t[0][(crc ^ *p++) & 0xFFU] ^ (crc >> 8);
+		}
+	}
+	else
+	{
+		for (; length >= 8U; length -= 8U, p += 8)
+		{
+			lo = __REV(CrcStream_Load32(p)) ^ crc;
+			hi = __REV(CrcStream_Load32(p + 4));
+			crc = t[7][lo >> 24] ^ t[6][(lo >> 16) & 0xFFU] ^ t[5][(lo >> 8) & 0xFFU] ^ t[4][lo & 0xFFU]
+				^ t[3][hi >> 24] ^ t[2][(hi >> 16) & 0xFFU] ^ t[1][(hi >> 8) & 0xFFU] ^ t[0][hi & 0xFFU];
+		}
+		while (length-- != 0U)
+		{
+			crc = t[0][(crc >> 24) ^ *p++] ^ (crc << 8);
+		}
+	}
+
+	return crc;
+}
+
+#if (CRC_STREAM_HARDWARE == 1)
+static inline int CrcStream_IsPeripheralWidth(uint32_t width)
+{
+	return (width == 7U) || (width == 8U) || (width == 16U) || (width == 32U);
+}
+
+static void CrcStream_SetInputReverse(const CrcStream_TypeDef *stream, int words)
+{
+	uint32_t mode = LL_CRC_INDATA_REVERSE_NONE;
+
+	if (stream->config->reflectIn != 0U)
+	{
+		mode = words ? LL_CRC_INDATA_REVERSE_WORD : LL_CRC_INDATA_REVERSE_BYTE;
+	}
+	LL_CRC_SetInputDataReverseMode(CRC, mode);
+}
+
+/**
+ * @brief  Wait for the DMA feeding the peripheral, if any.
+ * @retval None
+ */
+static void CrcStream_WaitDma(void)
+{
+	if (crcStreamDmaBusy == 0U)
+	{
+		return;
+	}
+
+	while ((LL_DMA_IsActiveFlag_TC0(CRC_STREAM_DMA) == 0U) && (LL_DMA_IsActiveFlag_TE0(CRC_STREAM_DMA) == 0U))
+	{
+	}
+	assert_param(LL_DMA_IsActiveFlag_TE0(CRC_STREAM_DMA) == 0U);
+	LL_DMA_ClearFlag_TC0(CRC_STREAM_DMA);
+	LL_DMA_ClearFlag_HT0(CRC_STREAM_DMA);
+	LL_DMA_ClearFlag_TE0(CRC_STREAM_DMA);
+	LL_DMA_ClearFlag_FE0(CRC_STREAM_DMA);
+	crcStreamDmaBusy = 0;
+}
+
+/**
+ * @brief  Feed bytes by the CPU: words while there are four, then bytes.
+ * @param  stream: owner of the peripheral
+ * @param  p: data
+ * @param  length: bytes
+ * @retval None
+ */
+static void CrcStream_FeedCpu(const CrcStream_TypeDef *stream, const uint8_t *p, uint32_t length)
+{
+	if (length >= 4U)
+	{
+		CrcStream_SetInputReverse(stream, 1);
+		for (; length >= 4U; length -= 4U, p += 4)
+		{
+			uint32_t word = CrcStream_Load32(p);
+
+			LL_CRC_FeedData32(CRC, (stream->config->reflectIn != 0U) ? word : __REV(word));
+		}
+	}
+	if (length != 0U)
+	{
+		CrcStream_SetInputReverse(stream, 0);
+		while (length-- != 0U)
+		{
+			LL_CRC_FeedData8(CRC, *p++);
+		}
+	}
+}
+
+/**
+ * @brief  Start a memory-to-CRC->DR transfer on DMA2 Stream0.
+ * @param  p: source
+ * @param  items: transfers, at most CRC_STREAM_DMA_MAX_ITEMS
+ * @param  words: 1 for 32-bit items (aligned source), 0 for bytes
+ * @retval None
+ */
+static void CrcStream_StartDma(const uint8_t *p, uint32_t items, int words)
+{
+	uint32_t size = words ? LL_DMA_PDATAALIGN_WORD : LL_DMA_PDATAALIGN_BYTE;
+
+	/* Memory-to-memory: the peripheral port reads the source, the memory port writes DR */
+	LL_DMA_DisableStream(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM);
+	while (LL_DMA_IsEnabledStream(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM) != 0U)
+	{
+	}
+	LL_DMA_SetPeriphSize(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, size);
+	LL_DMA_SetMemorySize(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, words ? LL_DMA_MDATAALIGN_WORD : LL_DMA_MDATAALIGN_BYTE);
+	LL_DMA_SetPeriphAddress(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, (uint32_t)p);
+	LL_DMA_SetMemoryAddress(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, (uint32_t)&CRC->DR);
+	LL_DMA_SetDataLength(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, items);
+
+	crcStreamDmaBusy = 1;
+	LL_DMA_EnableStream(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM);
+}
+
+/**
+ * @brief  Give the peripheral to a stream: wait for the DMA, save the
+ *         register of the previous owner and load the stream's.
+ * @note   The unaligned tail left by the last DMA chunk is fed here, to
+ *         its own stream before the register is saved.
+ * @param  stream: stream to run
+ * @retval None
+ */
+static void CrcStream_Acquire(CrcStream_TypeDef *stream)
+{
+	CrcStream_WaitDma();
+
+	if ((crcStreamOwner != NULL) && (crcStreamOwner->pendingLength != 0U))
+	{
+		CrcStream_FeedCpu(crcStreamOwner, crcStreamOwner->pending, crcStreamOwner->pendingLength);
+		crcStreamOwner->pendingLength = 0;
+	}
+
+	if (crcStreamOwner != stream)
+	{
+		if (crcStreamOwner != NULL)
+		{
+			crcStreamOwner->state = LL_CRC_ReadData32(CRC);
+		}
+
+		/* LL equivalent of HAL_CRCEx_Polynomial_Set() plus the init value */
+		LL_CRC_SetPolynomialCoef(CRC, stream->config->poly);
+		LL_CRC_SetPolynomialSize(CRC, (stream->config->width == 32U) ? LL_CRC_POLYLENGTH_32B
+			: (stream->config->width == 16U) ? LL_CRC_POLYLENGTH_16B
+			: (stream->config->width == 8U) ? LL_CRC_POLYLENGTH_8B : LL_CRC_POLYLENGTH_7B);
+		LL_CRC_SetOutputDataReverseMode(CRC, LL_CRC_OUTDATA_REVERSE_NONE);
+		LL_CRC_SetInitialData(CRC, stream->state);
+		LL_CRC_ResetCRCCalculationUnit(CRC);
+		crcStreamOwner = stream;
+	}
+
+}
+
+/**
+ * @brief  Feed a chunk to the peripheral, the DMA part left running.
+ * @param  stream: stream owning the peripheral
+ * @param  p: data
+ * @param  length: bytes
+ * @retval None
+ */
+static void CrcStream_UpdatePeripheral(CrcStream_TypeDef *stream, const uint8_t *p, uint32_t length)
+{
+	uint32_t head;
+	uint32_t items;
+	int words = (stream->config->reflectIn != 0U);
+
+	CrcStream_Acquire(stream);
+
+	if (length < CRC_STREAM_DMA_MIN)
+	{
+		CrcStream_FeedCpu(stream, p, length);
+		return;
+	}
+
+	/* The DMA reads the source behind the D-cache */
+	DmaBuffer_PrepareTx(p, length);
+
+	if (words)
+	{
+		/* Word items need an aligned source: bytes up to it by the CPU */
+		head = (uint32_t)(-(uintptr_t)p & 3U);
+		CrcStream_FeedCpu(stream, p, head);
+		p += head;
+		length -= head;
+		CrcStream_SetInputReverse(stream, 1);
+	}
+	else
+	{
+		CrcStream_SetInputReverse(stream, 0);
+	}
+
+	for (;;)
+	{
+		items = words ? (length / 4U) : length;
+		if (items > CRC_STREAM_DMA_MAX_ITEMS)
+		{
+			items = CRC_STREAM_DMA_MAX_ITEMS;
+		}
+		CrcStream_StartDma(p, items, words);
+		if (words)
+		{
+			items *= 4U;
+		}
+		p += items;
+		length -= items;
+		if (length < 4U)
+		{
+			break;
+		}
+		CrcStream_WaitDma();
+	}
+
+	/* Fed after the transfer, by the next call on the peripheral */
+	memcpy(stream->pending, p, length);
+	stream->pendingLength = (uint8_t)length;
+}
+#endif /* CRC_STREAM_HARDWARE */
+
+/**
+ * @brief  Enable the CRC peripheral and prepare DMA2 Stream0.
+ * @retval None
+ */
+void CrcStream_Init(void)
+{
+#if (CRC_STREAM_HARDWARE == 1)
+	LL_DMA_InitTypeDef dmaConfig;
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+
+	LL_DMA_StructInit(&dmaConfig);
+	dmaConfig.Direction = LL_DMA_DIRECTION_MEMORY_TO_MEMORY;
+	dmaConfig.PeriphOrM2MSrcIncMode = LL_DMA_PERIPH_INCREMENT;
+	dmaConfig.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_NOINCREMENT;
+	dmaConfig.Mode = LL_DMA_MODE_NORMAL;
+	dmaConfig.Priority = LL_DMA_PRIORITY_LOW;
+	/* Direct mode is not allowed memory-to-memory */
+	dmaConfig.FIFOMode = LL_DMA_FIFOMODE_ENABLE;
+	dmaConfig.FIFOThreshold = LL_DMA_FIFOTHRESHOLD_FULL;
+	LL_DMA_Init(CRC_STREAM_DMA, CRC_STREAM_DMA_STREAM, &dmaConfig);
+
+	crcStreamOwner = NULL;
+	crcStreamDmaBusy = 0;
+#endif
+}
+
+/**
+ * @brief  Build the slice-by-8 tables of a CRC configuration.
+ * @param  table: table storage
+ * @param  config: CRC parameters
+ * @retval None
+ */
+void CrcStream_TableInit(CrcStream_TableTypeDef *table, const CrcStream_ConfigTypeDef *config)
+{
+	uint32_t crc;
+
+	table->config = config;
+	for (uint32_t i = 0; i < 256U; i++)
+	{
+		uint8_t byte = (uint8_t)i;
+
+		crc = CrcStream_UpdateBitwise(config, 0, &byte, 1U);
+		table->entry[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256U; i++)
+	{
+		crc = table->entry[0][i];
+		for (uint32_t k = 1; k < 8U; k++)
+		{
+			if (config->reflectIn != 0U)
+			{
+				crc = (crc >> 8) ^ table->entry[0][crc & 0xFFU];
+			}
+			else
+			{
+				crc = (crc << 8) ^ table->entry[0][crc >> 24];
+			}
+			table->entry[k][i] = crc;
+		}
+	}
+}
+
+/**
+ * @brief  Start a CRC computation.
+ * @param  stream: stream storage
+ * @param  config: CRC parameters
+ * @param  table: slice-by-8 tables of config for the software engine, NULL
+ *         for the peripheral (bitwise software where it is not available)
+ * @retval None
+ */
+void CrcStream_Begin(CrcStream_TypeDef *stream, const CrcStream_ConfigTypeDef *config,
+		const CrcStream_TableTypeDef *table)
+{
+	assert_param((config->width >= 1U) && (config->width <= 32U));
+	assert_param((table == NULL) || (table->config == config));
+
+	stream->config = config;
+	stream->table = table;
+	stream->length = 0;
+	stream->pendingLength = 0;
+
+	stream->engine = (table != NULL) ? CRC_STREAM_TABLE : CRC_STREAM_BITWISE;
+#if (CRC_STREAM_HARDWARE == 1)
+	if ((table == NULL) && CrcStream_IsPeripheralWidth(config->width))
+	{
+		stream->engine = CRC_STREAM_PERIPHERAL;
+	}
+#endif
+
+	if (stream->engine == CRC_STREAM_PERIPHERAL)
+	{
+		stream->state = config->init & CrcStream_Mask(config->width);
+	}
+	else if (config->reflectIn != 0U)
+	{
+		stream->state = CrcStream_Reflect(config->init, config->width);
+	}
+	else
+	{
+		stream->state = config->init << (32U - config->width);
+	}
+}
+
+/**
+ * @brief  Add a chunk of any length and alignment to the CRC.
+ * @note   With the peripheral, data must stay unchanged until the next
+ *         CrcStream_Update()/CrcStream_Final() call of any stream.
+ * @param  stream: stream started by CrcStream_Begin()
+ * @param  data: chunk
+ * @param  length: bytes
+ * @retval None
+ */
+void CrcStream_Update(CrcStream_TypeDef *stream, const void *data, uint32_t length)
+{
+	stream->length += length;
+
+	switch (stream->engine)
+	{
+#if (CRC_STREAM_HARDWARE == 1)
+	case CRC_STREAM_PERIPHERAL:
+		CrcStream_UpdatePeripheral(stream, data, length);
+		break;
+#endif
+	case CRC_STREAM_TABLE:
+		stream->state = CrcStream_UpdateTable(stream->table, stream->state, data, length);
+		break;
+	default:
+		stream->state = CrcStream_UpdateBitwise(stream->config, stream->state, data, length);
+		break;
+	}
+}
+
+/**
+ * @brief  Finish the CRC: output reflection and final XOR.
+ * @param  stream: stream started by CrcStream_Begin(), may be restarted after
+ * @retval CRC, in the low width bits
+ */
+uint32_t CrcStream_Final(CrcStream_TypeDef *stream)
+{
+	const CrcStream_ConfigTypeDef *config = stream->config;
+	uint32_t crc = stream->state;
+
+#if (CRC_STREAM_HARDWARE == 1)
+	if (stream->engine == CRC_STREAM_PERIPHERAL)
+	{
+		CrcStream_Acquire(stream);
+		crc = LL_CRC_ReadData32(CRC);
+		crcStreamOwner = NULL;
+	}
+	else
+#endif
+	if (config->reflectIn != 0U)
+	{
+		/* Back to the normal register */
+		crc = CrcStream_Reflect(crc, config->width);
+	}
+	else
+	{
+		crc >>= 32U - config->width;
+	}
+
+	crc &= CrcStream_Mask(config->width);
+	if (config->reflectOut != 0U)
+	{
+		crc = CrcStream_Reflect(crc, config->width);
+	}
+
+	return (crc ^ config->xorOut) & CrcStream_Mask(config->width);
+}
+
+/**
+ * @brief  One-shot CRC of a buffer.
+ * @param  config: CRC parameters
+ * @param  table: see CrcStream_Begin()
+ * @param  data: buffer
+ * @param  length: bytes
+ * @retval CRC
+ */
+uint32_t CrcStream_Compute(const CrcStream_ConfigTypeDef *config, const CrcStream_TableTypeDef *table,
+		const void *data, uint32_t length)
+{
+	CrcStream_TypeDef stream;
+
+	CrcStream_Begin(&stream, config, table);
+	CrcStream_Update(&stream, data, length);
+
+	return CrcStream_Final(&stream);
+}
@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file    damage.c
+  * @brief   Damage tracking.
+  *
+  *          The merge rule is the one of the redraw cost: a bounding box no
+  *          larger than the two rectangles added up costs no more pixels
+  *          than drawing them apart, and one DMA2D command less.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx.h"
+
+#include "damage.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t x0;
+	uint32_t y0;
+	uint32_t x1;                    /* excluded */
+	uint32_t y1;
+} Damage_EdgesTypeDef;
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Damage_EdgesArea(const Damage_EdgesTypeDef *e)
+{
+	return (e->x1 - e->x0) * (e->y1 - e->y0);
+}
+
+static void Damage_ToEdges(const Damage_RectTypeDef *rect, Damage_EdgesTypeDef *e)
+{
+	e->x0 = rect->x;
+	e->y0 = rect->y;
+	e->x1 = rect->x + rect->width;
+	e->y1 = rect->y + rect->height;
+}
+
+static void Damage_Bound(const Damage_EdgesTypeDef *a, const Damage_EdgesTypeDef *b, Damage_EdgesTypeDef *box)
+{
+	box->x0 = (a->x0 < b->x0) ? a->x0 : b->x0;
+	box->y0 = (a->y0 < b->y0) ? a->y0 : b->y0;
+	box->x1 = (a->x1 > b->x1) ? a->x1 : b->x1;
+	box->y1 = (a->y1 > b->y1) ? a->y1 : b->y1;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Empty damage of a screen.
+ * @param  damage: damage handle
+ * @param  width: screen, pixels
+ * @param  height: screen, lines
+ * @param  tile: rectangles grown to multiples of it, a power of two
+ * @retval None
+ */
+void Damage_Init(Damage_TypeDef *damage, uint32_t width, uint32_t height, uint32_t tile)
+{
+	assert_param((tile != 0U) && ((tile & (tile - 1U)) == 0U));
+
+	damage->count = 0U;
+	damage->width = width;
+	damage->height = height;
+	damage->tile = tile;
+	damage->merges = 0U;
+	damage->forced = 0U;
+}
+
+/**
+ * @brief  Add a rectangle to redraw.
+ * @param  damage: damage handle
+ * @param  rect: screen coordinates, the part off screen ignored
+ * @retval None
+ */
+void Damage_Add(Damage_TypeDef *damage, const Damage_RectTypeDef *rect)
+{
+	Damage_EdgesTypeDef add;
+	Damage_EdgesTypeDef box;
+	Damage_EdgesTypeDef e;
+	uint32_t mask = damage->tile - 1U;
+	uint32_t i;
+
+	if ((rect->x >= damage->width) || (rect->y >= damage->height) || (rect->width == 0U) || (rect->height == 0U))
+	{
+		return;
+	}
+	add.x0 = rect->x & ~mask;
+	add.y0 = rect->y & ~mask;
+	add.x1 = (rect->width < damage->width - rect->x) ? ((rect->x + rect->width + mask) & ~mask) : damage->width;
+	add.y1 = (rect->height < damage->height - rect->y) ? ((rect->y + rect->height + mask) & ~mask) : damage->height;
+	add.x1 = (add.x1 < damage->width) ? add.x1 : damage->width;
+	add.y1 = (add.y1 < damage->height) ? add.y1 : damage->height;
+
+	i = 0U;
+	while (i < damage->count)
+	{
+		Damage_ToEdges(&damage->rects[i], &e);
+		Damage_Bound(&add, &e, &box);
+		if (Damage_EdgesArea(&box) <= Damage_EdgesArea(&add) + Damage_EdgesArea(&e))
+		{
+			/* The box may now merge with a rectangle passed over: again from
+			   the start */
+			damage->rects[i] = damage->rects[--damage->count];
+			damage->merges++;
+			add = box;
+			i = 0U;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (damage->count == DAMAGE_MAX_RECTS)
+	{
+		Damage_RectTypeDef merged;
+		uint32_t best = 0U;
+		uint32_t bestGrowth = UINT32_MAX;
+
+		for (i = 0U; i < damage->count; i++)
+		{
+			uint32_t growth;
+
+			Damage_ToEdges(&damage->rects[i], &e);
+			Damage_Bound(&add, &e, &box);
+			growth = Damage_EdgesArea(&box) - Damage_EdgesArea(&e);
+			if (growth < bestGrowth)
+			{
+				best = i;
+				bestGrowth = growth;
+			}
+		}
+		Damage_ToEdges(&damage->rects[best], &e);
+		Damage_Bound(&add, &e, &add);
+		damage->rects[best] = damage->rects[--damage->count];
+		damage->merges++;
+		damage->forced++;
+		/* The box is added as any other, merging on */
+		merged.x = add.x0;
+		merged.y = add.y0;
+		merged.width = add.x1 - add.x0;
+		merged.height = add.y1 - add.y0;
+		Damage_Add(damage, &merged);
+		return;
+	}
+
+	damage->rects[damage->count].x = add.x0;
+	damage->rects[damage->count].y = add.y0;
+	damage->rects[damage->count].width = add.x1 - add.x0;
+	damage->rects[damage->count].height = add.y1 - add.y0;
+	damage->count++;
+}
+
+/**
+ * @brief  All of the screen to redraw.
+ * @param  damage: damage handle
+ * @retval None
+ */
+void Damage_AddAll(Damage_TypeDef *damage)
+{
+	damage->rects[0].x = 0U;
+	damage->rects[0].y = 0U;
+	damage->rects[0].width = damage->width;
+	damage->rects[0].height = damage->height;
+	damage->count = 1U;
+}
+
+/**
+ * @brief  Pixels the list redraws, overlaps counted twice.
+ * @param  damage: damage handle
+ * @retval Pixels
+ */
+uint32_t Damage_Area(const Damage_TypeDef *damage)
+{
+	uint32_t area = 0U;
+
+	for (uint32_t i = 0; i < damage->count; i++)
+	{
+		area += damage->rects[i].width * damage->rects[i].height;
+	}
+	return area;
+}
@@ -0,0 +1,337 @@
+/**
+  ******************************************************************************
+  * @file    dma_buffer.c
+  * @brief   Cache-coherent DMA buffer allocator.
+  *
+  *          Each pool tracks its cache lines with two bitmaps: "used" marks
+  *          allocated lines and "start" the first line of each allocation,
+  *          so a buffer is freed by pointer alone. Allocation is first fit.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "dma_buffer.h"
+#include "mem_section.h"
+#include "mpu_regions.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define DMA_BUFFER_SRAM2_SIZE       (16U * 1024U)
+#define DMA_BUFFER_DTCM_SIZE        (64U * 1024U)
+#define DMA_BUFFER_MPU_REGION       0U
+
+#define DMA_BUFFER_BIT_TEST(map, n)     (((map)[(n) / 32U] >> ((n) % 32U)) & 1U)
+#define DMA_BUFFER_BIT_SET(map, n)      ((map)[(n) / 32U] |= (1UL << ((n) % 32U)))
+#define DMA_BUFFER_BIT_CLEAR(map, n)    ((map)[(n) / 32U] &= ~(1UL << ((n) % 32U)))
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t coherentMemory[DMA_BUFFER_COHERENT_SIZE] SRAM2_DMA __attribute__((aligned(DMA_BUFFER_LINE)));
+static uint8_t cachedMemory[DMA_BUFFER_CACHED_SIZE] __attribute__((aligned(DMA_BUFFER_LINE)));
+
+static DmaBuffer_PoolTypeDef coherentPool;
+static DmaBuffer_PoolTypeDef cachedPool;
+
+#if DMA_BUFFER_SRAM2_WRITE_THROUGH
+static const MpuRegions_DescTypeDef dmaBufferRegion =
+	{ SRAM2_BASE, DMA_BUFFER_SRAM2_SIZE, MPU_REGIONS_NORMAL_WRITE_THROUGH, ARM_MPU_AP_FULL, 1U, 0U };
+#define DMA_BUFFER_SRAM2_CACHE      DMA_BUFFER_WRITE_THROUGH
+#else
+static const MpuRegions_DescTypeDef dmaBufferRegion =
+	{ SRAM2_BASE, DMA_BUFFER_SRAM2_SIZE, MPU_REGIONS_NORMAL_NONCACHEABLE, ARM_MPU_AP_FULL, 1U, 1U };
+#define DMA_BUFFER_SRAM2_CACHE      DMA_BUFFER_NONCACHEABLE
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+static int DmaBuffer_PoolContains(const DmaBuffer_PoolTypeDef *pool, const void *buffer)
+{
+	return ((const uint8_t *)buffer >= pool->memory)
+		&& ((const uint8_t *)buffer < pool->memory + (pool->lines * DMA_BUFFER_LINE));
+}
+
+/**
+ * @brief  Cache policy of the memory holding an address.
+ */
+static DmaBuffer_CacheTypeDef DmaBuffer_CacheOf(const void *buffer)
+{
+	uintptr_t address = (uintptr_t)buffer;
+
+	if (DmaBuffer_PoolContains(&coherentPool, buffer))
+	{
+		return coherentPool.cache;
+	}
+	if (DmaBuffer_PoolContains(&cachedPool, buffer))
+	{
+		return cachedPool.cache;
+	}
+	if ((address >= SRAM2_BASE) && (address < SRAM2_BASE + DMA_BUFFER_SRAM2_SIZE))
+	{
+		return DMA_BUFFER_SRAM2_CACHE;
+	}
+	if ((address >= RAMDTCM_BASE) && (address < RAMDTCM_BASE + DMA_BUFFER_DTCM_SIZE))
+	{
+		/* DTCM is never cached */
+		return DMA_BUFFER_NONCACHEABLE;
+	}
+	return DMA_BUFFER_WRITE_BACK;
+}
+
+/**
+ * @brief  Widen [buffer, buffer + length) to whole cache lines.
+ */
+static int32_t DmaBuffer_Lines(const void *buffer, uint32_t length, uint32_t **lineStart)
+{
+	uintptr_t offset = (uintptr_t)buffer & (DMA_BUFFER_LINE - 1U);
+
+	*lineStart = (uint32_t *)((uintptr_t)buffer - offset);
+	return (int32_t)((length + offset + DMA_BUFFER_LINE - 1U) & ~(DMA_BUFFER_LINE - 1U));
+}
+
+/**
+ * @brief  Initialize a pool over caller-provided memory.
+ * @param  pool: pool handle
+ * @param  memory: storage, DMA_BUFFER_LINE aligned
+ * @param  size: storage size, whole lines, at most DMA_BUFFER_POOL_MAX_LINES
+ * @param  cache: cache policy of the storage
+ * @retval None
+ */
+void DmaBuffer_PoolInit(DmaBuffer_PoolTypeDef *pool, void *memory, uint32_t size, DmaBuffer_CacheTypeDef cache)
+{
+	assert_param(((uintptr_t)memory & (DMA_BUFFER_LINE - 1U)) == 0U);
+	assert_param((size / DMA_BUFFER_LINE) <= DMA_BUFFER_POOL_MAX_LINES);
+
+	memset(pool, 0, sizeof(*pool));
+	pool->memory = memory;
+	pool->lines = size / DMA_BUFFER_LINE;
+	pool->cache = cache;
+	pool->freeLines = pool->lines;
+}
+
+/**
+ * @brief  Allocate a buffer of whole cache lines, first fit.
+ * @param  pool: pool handle
+ * @param  size: bytes, rounded up to DMA_BUFFER_LINE
+ * @retval Line-aligned buffer, NULL if no run of free lines is long enough
+ */
+void *DmaBuffer_PoolAlloc(DmaBuffer_PoolTypeDef *pool, uint32_t size)
+{
+	uint32_t count = (size + DMA_BUFFER_LINE - 1U) / DMA_BUFFER_LINE;
+	uint32_t primask;
+	uint32_t run = 0;
+	uint32_t line = 0;
+	void *buffer = NULL;
+
+	if ((count == 0U) || (count > pool->freeLines))
+	{
+		return NULL;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	while (line < pool->lines)
+	{
+		if (((line % 32U) == 0U) && (pool->used[line / 32U] == 0xFFFFFFFFUL))
+		{
+			/* Skip a fully allocated word */
+			run = 0;
+			line += 32U;
+			continue;
+		}
+		if (((line % 32U) == 0U) && (pool->used[line / 32U] == 0U) && ((count - run) > 32U))
+		{
+			/* A free word that does not complete the run */
+			run += 32U;
+			line += 32U;
+			continue;
+		}
+
+		if (DMA_BUFFER_BIT_TEST(pool->used, line))
+		{
+			run = 0;
+		}
+		else if (++run == count)
+		{
+			uint32_t first = line + 1U - count;
+
+			for (uint32_t i = first; i <= line; i++)
+			{
+				DMA_BUFFER_BIT_SET(pool->used, i);
+			}
+			DMA_BUFFER_BIT_SET(pool->start, first);
+			pool->freeLines -= count;
+			buffer = pool->memory + (first * DMA_BUFFER_LINE);
+			break;
+		}
+		line++;
+	}
+
+	__set_PRIMASK(primask);
+	return buffer;
+}
+
+/**
+ * @brief  Return a buffer to its pool.
+ * @param  pool: pool handle
+ * @param  buffer: pointer returned by DmaBuffer_PoolAlloc(), NULL is ignored
+ * @retval None
+ */
+void DmaBuffer_PoolFree(DmaBuffer_PoolTypeDef *pool, void *buffer)
+{
+	uint32_t primask;
+	uint32_t line;
+
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	assert_param(DmaBuffer_PoolContains(pool, buffer));
+	line = (uint32_t)((uint8_t *)buffer - pool->memory) / DMA_BUFFER_LINE;
+	assert_param(DMA_BUFFER_BIT_TEST(pool->start, line));
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	DMA_BUFFER_BIT_CLEAR(pool->start, line);
+	do
+	{
+		DMA_BUFFER_BIT_CLEAR(pool->used, line);
+		pool->freeLines++;
+		line++;
+	} while ((line < pool->lines) && DMA_BUFFER_BIT_TEST(pool->used, line) && !DMA_BUFFER_BIT_TEST(pool->start, line));
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Set up both pools and map SRAM2 through the MPU.
+ * @note   Must run before the D-cache is enabled.
+ * @retval None
+ */
+void DmaBuffer_Init(void)
+{
+	ARM_MPU_Region_t table[1];
+	uint32_t count;
+
+	DmaBuffer_PoolInit(&coherentPool, coherentMemory, sizeof(coherentMemory), DMA_BUFFER_SRAM2_CACHE);
+	DmaBuffer_PoolInit(&cachedPool, cachedMemory, sizeof(cachedMemory), DMA_BUFFER_WRITE_BACK);
+
+	count = MpuRegions_Build(&dmaBufferRegion, 1U, DMA_BUFFER_MPU_REGION, table);
+	assert_param(count == 1U);
+	MpuRegions_Load(table, count);
+}
+
+/**
+ * @brief  Allocate from the coherent (SRAM2) pool.
+ * @param  size: bytes
+ * @retval Buffer, NULL when the pool is exhausted
+ */
+void *DmaBuffer_Alloc(uint32_t size)
+{
+	return DmaBuffer_PoolAlloc(&coherentPool, size);
+}
+
+/**
+ * @brief  Allocate from the cached pool, use the handoff functions around
+ *         every DMA transfer.
+ * @param  size: bytes
+ * @retval Buffer, NULL when the pool is exhausted
+ */
+void *DmaBuffer_AllocCached(uint32_t size)
+{
+	return DmaBuffer_PoolAlloc(&cachedPool, size);
+}
+
+/**
+ * @brief  Free a buffer from either pool.
+ * @param  buffer: pointer returned by DmaBuffer_Alloc/AllocCached, or NULL
+ * @retval None
+ */
+void DmaBuffer_Free(void *buffer)
+{
+	if (DmaBuffer_PoolContains(&cachedPool, buffer))
+	{
+		DmaBuffer_PoolFree(&cachedPool, buffer);
+	}
+	else
+	{
+		DmaBuffer_PoolFree(&coherentPool, buffer);
+	}
+}
+
+/**
+ * @brief  Free space of the coherent pool.
+ * @retval Bytes, not necessarily contiguous
+ */
+uint32_t DmaBuffer_FreeBytes(void)
+{
+	return coherentPool.freeLines * DMA_BUFFER_LINE;
+}
+
+/**
+ * @brief  Hand a buffer the CPU has written to a DMA that will read it.
+ * @param  buffer: start of the data
+ * @param  length: bytes
+ * @retval None
+ */
+void DmaBuffer_PrepareTx(const void *buffer, uint32_t length)
+{
+	uint32_t *lineStart;
+	int32_t lineBytes;
+
+	if (DmaBuffer_CacheOf(buffer) == DMA_BUFFER_WRITE_BACK)
+	{
+		lineBytes = DmaBuffer_Lines(buffer, length, &lineStart);
+		SCB_CleanDCache_by_Addr(lineStart, lineBytes);
+	}
+}
+
+/**
+ * @brief  Hand a buffer to a DMA that will write it.
+ * @note   Dirty lines are written back now so that a later eviction cannot
+ *         overwrite what the DMA stores.
+ * @param  buffer: start of the receive area
+ * @param  length: bytes
+ * @retval None
+ */
+void DmaBuffer_PrepareRx(void *buffer, uint32_t length)
+{
+	uint32_t *lineStart;
+	int32_t lineBytes;
+
+	if (DmaBuffer_CacheOf(buffer) == DMA_BUFFER_WRITE_BACK)
+	{
+		lineBytes = DmaBuffer_Lines(buffer, length, &lineStart);
+		SCB_CleanInvalidateDCache_by_Addr(lineStart, lineBytes);
+	}
+}
+
+/**
+ * @brief  Take back a buffer the DMA has written, before the CPU reads it.
+ * @note   The area should cover whole lines: CPU writes to the rest of a
+ *         partially covered write-back line are discarded.
+ * @param  buffer: start of the received data
+ * @param  length: bytes
+ * @retval None
+ */
+void DmaBuffer_CompleteRx(void *buffer, uint32_t length)
+{
+	uint32_t *lineStart;
+	int32_t lineBytes;
+
+	if (DmaBuffer_CacheOf(buffer) != DMA_BUFFER_NONCACHEABLE)
+	{
+		lineBytes = DmaBuffer_Lines(buffer, length, &lineStart);
+		SCB_InvalidateDCache_by_Addr(lineStart, lineBytes);
+	}
+}
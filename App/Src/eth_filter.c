@@ -0,0 +1,331 @@
+/**
+  ******************************************************************************
+  * @file    eth_filter.c
+  * @brief   ETH MAC receive address filter manager.
+  *
+  *          The HAL setters are not used: HAL_ETH_SetSourceMACAddrMatch()
+  *          programs source address slots and the others wait with
+  *          HAL_Delay(), which does not return with interrupts masked. The
+  *          register set is written here directly, each register once, so
+  *          the MAC needs no settling delay between two writes of the same
+  *          register. Address slot high halves go before the low halves,
+  *          whose write latches the slot.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "crc_stream.h"
+#include "eth_filter.h"
+
+/* Private define ------------------------------------------------------------*/
+#define ETH_FILTER_MODES            (ETH_MACFFR_PM | ETH_MACFFR_HU | ETH_MACFFR_HM | ETH_MACFFR_DAIF \
+									| ETH_MACFFR_PAM | ETH_MACFFR_BFD | ETH_MACFFR_HPF)
+#define ETH_FILTER_VLAN_TYPE        0x8100U
+#define ETH_FILTER_VLAN_ID          0x0FFFU
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	uint8_t address[6];
+	uint8_t bin;                        /* hash table bin, computed once */
+	uint8_t refCount;                   /* 0: free */
+} EthFilter_EntryTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static ETH_HandleTypeDef *ethFilterHandle;
+static EthFilter_EntryTypeDef ethFilterEntry[ETH_FILTER_MAX_ADDRESSES];
+static uint32_t ethFilterBroadcast;
+static uint32_t ethFilterPromiscuous;
+static uint16_t ethFilterVlan;
+static EthFilter_StatsTypeDef ethFilterStats;
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t EthFilter_IsMulticast(const uint8_t *address)
+{
+	return (address[0] & 0x01U) != 0U;
+}
+
+/* Interrupts masked by the caller */
+static EthFilter_EntryTypeDef *EthFilter_Find(const uint8_t *address)
+{
+	for (uint32_t i = 0U; i < ETH_FILTER_MAX_ADDRESSES; i++)
+	{
+		if ((ethFilterEntry[i].refCount != 0U) && (memcmp(ethFilterEntry[i].address, address, 6U) == 0))
+		{
+			return &ethFilterEntry[i];
+		}
+	}
+	return NULL;
+}
+
+/* Rebuild and write the whole register set; interrupts masked by the caller */
+static void EthFilter_Apply(void)
+{
+	ETH_TypeDef *mac = ethFilterHandle->Instance;
+	__IO uint32_t *const slotHigh[ETH_FILTER_PERFECT_SLOTS] = { &mac->MACA1HR, &mac->MACA2HR, &mac->MACA3HR };
+	__IO uint32_t *const slotLow[ETH_FILTER_PERFECT_SLOTS] = { &mac->MACA1LR, &mac->MACA2LR, &mac->MACA3LR };
+	uint32_t high[ETH_FILTER_PERFECT_SLOTS] = { 0U };
+	uint32_t low[ETH_FILTER_PERFECT_SLOTS] = { 0U };
+	uint32_t table[2] = { 0U, 0U };     /* MACHTLR, MACHTHR */
+	uint32_t modes = 0U;
+	uint32_t slot = 0U;
+	uint32_t addresses = 0U;
+
+	/* Unicast first: hashing unicast would let in the traffic of every
+	   station sharing a bin, a busy switch port floods little multicast */
+	for (uint32_t multicast = 0U; multicast < 2U; multicast++)
+	{
+		for (uint32_t i = 0U; i < ETH_FILTER_MAX_ADDRESSES; i++)
+		{
+			const EthFilter_EntryTypeDef *entry = &ethFilterEntry[i];
+
+			if ((entry->refCount == 0U) || (EthFilter_IsMulticast(entry->address) != multicast))
+			{
+				continue;
+			}
+			addresses++;
+			if (slot < ETH_FILTER_PERFECT_SLOTS)
+			{
+				high[slot] = ETH_MACA1HR_AE | ((uint32_t)entry->address[5] << 8) | entry->address[4];
+				low[slot] = ((uint32_t)entry->address[3] << 24) | ((uint32_t)entry->address[2] << 16)
+					| ((uint32_t)entry->address[1] << 8) | entry->address[0];
+				slot++;
+			}
+			else
+			{
+				table[entry->bin >> 5] |= 1UL << (entry->bin & 31U);
+				modes |= (multicast != 0U) ? (ETH_MACFFR_HM | ETH_MACFFR_HPF) : (ETH_MACFFR_HU | ETH_MACFFR_HPF);
+			}
+		}
+	}
+	if (ethFilterPromiscuous != 0U)
+	{
+		modes |= ETH_MACFFR_PM;
+	}
+	if (ethFilterBroadcast == 0U)
+	{
+		modes |= ETH_MACFFR_BFD;
+	}
+
+	for (uint32_t i = 0U; i < ETH_FILTER_PERFECT_SLOTS; i++)
+	{
+		*slotHigh[i] = high[i];
+		*slotLow[i] = low[i];
+	}
+	mac->MACHTHR = table[1];
+	mac->MACHTLR = table[0];
+	mac->MACVLANTR = (ethFilterVlan != 0U) ? (ETH_MACVLANTR_VLANTC | ethFilterVlan) : 0U;
+	mac->MACFFR = (mac->MACFFR & ~ETH_FILTER_MODES) | modes;
+
+	ethFilterStats.addresses = addresses;
+	ethFilterStats.perfect = slot;
+	ethFilterStats.hashed = addresses - slot;
+	ethFilterStats.hashTable[0] = table[1];
+	ethFilterStats.hashTable[1] = table[0];
+	ethFilterStats.updates++;
+}
+
+static void EthFilter_Update(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	EthFilter_Apply();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Take over the address filter of a MAC: no subscription,
+ *         broadcast accepted, no VLAN.
+ * @note   Called by EthIf_Init() after HAL_ETH_Init().
+ * @param  heth: ETH handle, the station address in MAC address 0
+ * @retval None
+ */
+void EthFilter_Init(ETH_HandleTypeDef *heth)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	ethFilterHandle = heth;
+	memset(ethFilterEntry, 0, sizeof(ethFilterEntry));
+	ethFilterBroadcast = 1U;
+	ethFilterPromiscuous = 0U;
+	ethFilterVlan = 0U;
+	memset(&ethFilterStats, 0, sizeof(ethFilterStats));
+	EthFilter_Apply();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Receive the frames sent to an address.
+ * @param  address: unicast or multicast MAC address, 6 bytes
+ * @retval HAL_OK, HAL_ERROR if ETH_FILTER_MAX_ADDRESSES are subscribed
+ */
+HAL_StatusTypeDef EthFilter_Subscribe(const uint8_t *address)
+{
+	uint32_t bin = EthFilter_Hash(address);
+	EthFilter_EntryTypeDef *entry;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	entry = EthFilter_Find(address);
+	if (entry != NULL)
+	{
+		if (entry->refCount == UINT8_MAX)
+		{
+			__set_PRIMASK(primask);
+			return HAL_ERROR;
+		}
+		entry->refCount++;
+		__set_PRIMASK(primask);
+		return HAL_OK;
+	}
+	for (uint32_t i = 0U; i < ETH_FILTER_MAX_ADDRESSES; i++)
+	{
+		if (ethFilterEntry[i].refCount == 0U)
+		{
+			entry = &ethFilterEntry[i];
+			break;
+		}
+	}
+	if (entry == NULL)
+	{
+		__set_PRIMASK(primask);
+		return HAL_ERROR;
+	}
+	memcpy(entry->address, address, 6U);
+	entry->bin = (uint8_t)bin;
+	entry->refCount = 1U;
+	EthFilter_Apply();
+	__set_PRIMASK(primask);
+
+	return HAL_OK;
+}
+
+/**
+ * @brief  Drop one subscription to an address, the MAC stops receiving it
+ *         with the last one.
+ * @param  address: as given to EthFilter_Subscribe()
+ * @retval HAL_OK, HAL_ERROR if not subscribed
+ */
+HAL_StatusTypeDef EthFilter_Unsubscribe(const uint8_t *address)
+{
+	EthFilter_EntryTypeDef *entry;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	entry = EthFilter_Find(address);
+	if (entry != NULL)
+	{
+		if (--entry->refCount == 0U)
+		{
+			EthFilter_Apply();
+		}
+	}
+	__set_PRIMASK(primask);
+
+	return (entry != NULL) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief  Accept or drop the broadcast frames.
+ * @param  enable: 0 to drop them
+ * @retval None
+ */
+void EthFilter_SetBroadcast(uint32_t enable)
+{
+	ethFilterBroadcast = (enable != 0U);
+	EthFilter_Update();
+}
+
+/**
+ * @brief  Pass every frame, whatever its destination, for capture.
+ * @param  enable: 0 to filter again
+ * @retval None
+ */
+void EthFilter_SetPromiscuous(uint32_t enable)
+{
+	ethFilterPromiscuous = (enable != 0U);
+	EthFilter_Update();
+}
+
+/**
+ * @brief  Select the VLAN whose tagged frames are received.
+ * @param  vlanId: 1 to 4095, 0 to receive every VLAN
+ * @retval None
+ */
+void EthFilter_SetVlan(uint16_t vlanId)
+{
+	ethFilterVlan = vlanId & ETH_FILTER_VLAN_ID;
+	EthFilter_Update();
+}
+
+/**
+ * @brief  Software part of the filter, for EthIf_Poll(): the VLAN check
+ *         the MAC does not drop on.
+ * @param  frame: received frame
+ * @retval 1 to pass the frame up, 0 to drop it
+ */
+uint32_t EthFilter_Accept(const EthPbuf_TypeDef *frame)
+{
+	const uint8_t *p = frame->payload;
+
+	if ((ethFilterVlan == 0U) || (frame->length < 16U)
+			|| ((((uint32_t)p[12] << 8) | p[13]) != ETH_FILTER_VLAN_TYPE)
+			|| (((((uint32_t)p[14] << 8) | p[15]) & ETH_FILTER_VLAN_ID) == ethFilterVlan))
+	{
+		return 1U;
+	}
+	ethFilterStats.vlanDropped++;
+	return 0U;
+}
+
+/**
+ * @brief  Hash table bin of an address, as the MAC computes it on the
+ *         destination address of a frame.
+ * @param  address: MAC address, 6 bytes
+ * @retval bin, 0 to 63: bit (bin - 32) of MACHTHR or bit bin of MACHTLR
+ */
+uint32_t EthFilter_Hash(const uint8_t *address)
+{
+	return __RBIT(CrcStream_Compute(&crcStreamCrc32, NULL, address, 6U)) >> 26;
+}
+
+/**
+ * @brief  Snapshot of the filter state and counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void EthFilter_GetStats(EthFilter_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = ethFilterStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the filter state on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void EthFilter_Dump(EthFilter_PutCharTypeDef putChar)
+{
+	EthFilter_StatsTypeDef stats;
+	char line[128];
+
+	EthFilter_GetStats(&stats);
+	snprintf(line, sizeof(line), "eth filter addr=%lu perfect=%lu hashed=%lu hash=%08lx%08lx vlan=%u vdrop=%lu\r\n",
+		(unsigned long)stats.addresses, (unsigned long)stats.perfect, (unsigned long)stats.hashed,
+		(unsigned long)stats.hashTable[0], (unsigned long)stats.hashTable[1], (unsigned)ethFilterVlan,
+		(unsigned long)stats.vlanDropped);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,461 @@
+/**
+  ******************************************************************************
+  * @file    eth_if.c
+  * @brief   ETH network interface with NAPI-style polled reception.
+  *
+  *          Interrupt masking and the poll request are idempotent: the
+  *          first completion interrupt masks, schedules once and returns;
+  *          the poll is the only place that unmasks. Before unmasking it
+  *          clears the status raised while masked, reclaims TX once more
+  *          and looks at the RX ring: a frame completed after the last
+  *          HAL_ETH_ReadData() but before the clear would otherwise wait
+  *          for the next one.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "dma_buffer.h"
+#include "eth_filter.h"
+#include "eth_if.h"
+#include "kernel.h"
+#include "mem_section.h"
+
+#ifdef HOST_BUILD
+#include "eth_dma_host.h"
+#endif
+
+#if DMA_BUFFER_SRAM2_WRITE_THROUGH
+#error "the ETH DMA descriptors need the coherent DMA pool mapped non-cacheable"
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define ETH_IF_POLL_IT              (ETH_DMAIER_RIE | ETH_DMAIER_TIE | ETH_DMAIER_RBUIE)
+#define ETH_IF_POLL_STATUS          (ETH_DMASR_RS | ETH_DMASR_TS | ETH_DMASR_RBUS | ETH_DMASR_NIS)
+
+/* Private macro -------------------------------------------------------------*/
+/* DMAMFBOCR clears on read, a read the host register model cannot see */
+#ifdef HOST_BUILD
+#define ETH_IF_READ_MISSED()        HostEthDma_ReadMissed()
+#else
+#define ETH_IF_READ_MISSED()        (ethIfHandle.Instance->DMAMFBOCR)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static ETH_HandleTypeDef ethIfHandle;
+static ETH_DMADescTypeDef *ethIfRxDesc;     /* ETH_RX_DESC_CNT, coherent pool */
+static ETH_DMADescTypeDef *ethIfTxDesc;     /* ETH_TX_DESC_CNT, coherent pool */
+static uint8_t ethIfMacAddress[6];
+static EthIf_RxHandlerTypeDef ethIfRxHandler;
+static EthIf_ScheduleTypeDef ethIfSchedule;
+static volatile uint32_t ethIfPollPending;  /* interrupts masked, poll requested */
+static uint32_t ethIfBurst;                 /* frames received since the last unmask */
+static EthIf_StatsTypeDef ethIfStats;
+
+/* Private functions ---------------------------------------------------------*/
+/* Interrupt context: hand the work over to the poll */
+static void EthIf_Mask(ETH_HandleTypeDef *heth)
+{
+	__HAL_ETH_DMA_DISABLE_IT(heth, ETH_IF_POLL_IT);
+	if (ethIfPollPending == 0U)
+	{
+		ethIfPollPending = 1U;
+		ethIfSchedule();
+	}
+}
+
+/* HAL_ETH_IRQHandler(): RS or TS with its interrupt enabled */
+static void EthIf_Complete(ETH_HandleTypeDef *heth)
+{
+	EthIf_Mask(heth);
+}
+
+/* HAL_ETH_IRQHandler(): abnormal summary, RBUS when the ring ran dry */
+static void EthIf_Error(ETH_HandleTypeDef *heth)
+{
+	if ((heth->DMAErrorCode & ETH_DMASR_RBUS) != 0U)
+	{
+		ethIfStats.rxBufferUnavailable++;
+		EthIf_Mask(heth);
+	}
+}
+
+/* HAL_ETH_Transmit_IT() and HAL_ETH_ReleaseTxPacket() share the TX list */
+static void EthIf_TxReclaim(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	HAL_ETH_ReleaseTxPacket(&ethIfHandle);
+	__set_PRIMASK(primask);
+}
+
+/* Time stamp request of the next frame on its first descriptor. The HAL
+   sets TTSE but never clears it, the descriptor would keep stamping. */
+static void EthIf_TxTimestamp(const EthPbuf_TypeDef *frame)
+{
+	ETH_DMADescTypeDef *desc = (ETH_DMADescTypeDef *)ethIfHandle.TxDescList.TxDesc[ethIfHandle.TxDescList.CurTxDesc];
+
+	if ((desc->DESC0 & ETH_DMATXDESC_OWN) != 0U)
+	{
+		return;
+	}
+	if (((frame->flags & ETH_PBUF_FLAG_TX_TIMESTAMP) == 0U)
+			|| (HAL_ETH_PTP_InsertTxTimestamp(&ethIfHandle) != HAL_OK))
+	{
+		desc->DESC0 &= ~ETH_DMATXDESC_TTSE;
+	}
+}
+
+/* Next RX descriptor closed by the DMA, valid with the whole ring built */
+static inline int EthIf_RxReady(void)
+{
+	const ETH_DMADescTypeDef *desc =
+		(const ETH_DMADescTypeDef *)ethIfHandle.RxDescList.RxDesc[ethIfHandle.RxDescList.RxDescIdx];
+
+	return (desc->DESC0 & ETH_DMARXDESC_OWN) == 0U;
+}
+
+/* Count a received frame, 0 if it must not reach the handler */
+static uint32_t EthIf_RxAccept(const EthPbuf_TypeDef *frame)
+{
+	ethIfStats.rxFrames++;
+	ethIfStats.rxBytes += frame->totalLength;
+
+	if ((frame->flags & ETH_PBUF_FLAG_RX_ERROR) != 0U)
+	{
+		ethIfStats.rxErrors++;
+		return 0U;
+	}
+	if ((frame->flags & ETH_PBUF_FLAG_CSUM_ERROR) != 0U)
+	{
+		ethIfStats.rxChecksumErrors++;
+		return 0U;
+	}
+	if (EthFilter_Accept(frame) == 0U)
+	{
+		return 0U;
+	}
+	if ((frame->flags & (ETH_PBUF_FLAG_IP_CSUM_OK | ETH_PBUF_FLAG_L4_CSUM_OK)) != 0U)
+	{
+		ethIfStats.rxChecksumOk++;
+	}
+	return 1U;
+}
+
+/* Frames dropped before the ring: the counters clear on read. An overflow
+   bit adds one wrap of its counter, more wraps are lost. */
+static void EthIf_CountMissed(void)
+{
+	uint32_t missed = ETH_IF_READ_MISSED();
+
+	if (missed == 0U)
+	{
+		return;
+	}
+	ethIfStats.rxMissed += missed & ETH_DMAMFBOCR_MFC;
+	if ((missed & ETH_DMAMFBOCR_OMFC) != 0U)
+	{
+		ethIfStats.rxMissed += ETH_DMAMFBOCR_MFC + 1U;
+	}
+	ethIfStats.rxOverflows += (missed & ETH_DMAMFBOCR_MFA) >> ETH_DMAMFBOCR_MFA_Pos;
+	if ((missed & ETH_DMAMFBOCR_OFOC) != 0U)
+	{
+		ethIfStats.rxOverflows += (ETH_DMAMFBOCR_MFA >> ETH_DMAMFBOCR_MFA_Pos) + 1U;
+	}
+}
+
+/**
+ * @brief  Start the MAC and DMA on the pbuf pool, interrupts enabled.
+ * @note   The RMII pins must already be in alternate function mode and
+ *         DmaBuffer_Init() and EthPbuf_Init() must have run. The MAC keeps
+ *         the HAL default 100 Mbit/s full duplex configuration, with
+ *         checksum offload and enhanced descriptors. The address filter
+ *         starts with the station address and broadcast, see eth_filter.h.
+ * @param  macAddress: 6 bytes, copied
+ * @param  rxHandler: called from EthIf_Poll() with each good received
+ *         frame, it owns the frame's reference
+ * @param  schedule: called from the ETH interrupt when EthIf_Poll() has
+ *         work, at most once per poll cycle
+ * @retval HAL status
+ */
+HAL_StatusTypeDef EthIf_Init(const uint8_t *macAddress, EthIf_RxHandlerTypeDef rxHandler,
+		EthIf_ScheduleTypeDef schedule)
+{
+	ETH_DMAConfigTypeDef dmaConfig;
+
+	if (ethIfRxDesc == NULL)
+	{
+		ethIfRxDesc = DmaBuffer_Alloc(ETH_RX_DESC_CNT * sizeof(ETH_DMADescTypeDef));
+		ethIfTxDesc = DmaBuffer_Alloc(ETH_TX_DESC_CNT * sizeof(ETH_DMADescTypeDef));
+	}
+
+	memcpy(ethIfMacAddress, macAddress, sizeof(ethIfMacAddress));
+	ethIfRxHandler = rxHandler;
+	ethIfSchedule = schedule;
+	ethIfPollPending = 0;
+	ethIfBurst = 0;
+	memset(&ethIfStats, 0, sizeof(ethIfStats));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_ETHMAC | LL_AHB1_GRP1_PERIPH_ETHMACTX
+		| LL_AHB1_GRP1_PERIPH_ETHMACRX);
+
+	memset(&ethIfHandle, 0, sizeof(ethIfHandle));
+	ethIfHandle.Instance = ETH;
+	ethIfHandle.Init.MACAddr = ethIfMacAddress;
+	ethIfHandle.Init.MediaInterface = HAL_ETH_RMII_MODE;
+	ethIfHandle.Init.RxDesc = ethIfRxDesc;
+	ethIfHandle.Init.TxDesc = ethIfTxDesc;
+	ethIfHandle.Init.RxBuffLen = ETH_PBUF_SIZE;
+
+	/* HAL_ETH_Init() resets the callbacks, register them afterwards.
+	   The MAC checks checksums (IPCO) by default but would drop the bad
+	   frames without counting them: pass them up instead */
+	if ((HAL_ETH_Init(&ethIfHandle) != HAL_OK)
+			|| (HAL_ETH_GetDMAConfig(&ethIfHandle, &dmaConfig) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	dmaConfig.DropTCPIPChecksumErrorFrame = DISABLE;
+	EthFilter_Init(&ethIfHandle);
+	if ((HAL_ETH_SetDMAConfig(&ethIfHandle, &dmaConfig) != HAL_OK)
+			|| (EthPbuf_Attach(&ethIfHandle) != HAL_OK)
+			|| (HAL_ETH_RegisterCallback(&ethIfHandle, HAL_ETH_RX_COMPLETE_CB_ID, EthIf_Complete) != HAL_OK)
+			|| (HAL_ETH_RegisterCallback(&ethIfHandle, HAL_ETH_TX_COMPLETE_CB_ID, EthIf_Complete) != HAL_OK)
+			|| (HAL_ETH_RegisterCallback(&ethIfHandle, HAL_ETH_ERROR_CB_ID, EthIf_Error) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+
+	NVIC_SetPriority(ETH_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), ETH_IF_IRQ_PRIORITY, 0));
+	NVIC_EnableIRQ(ETH_IRQn);
+
+	return HAL_ETH_Start_IT(&ethIfHandle);
+}
+
+/**
+ * @brief  ETH global interrupt body, called from ETH_IRQHandler().
+ * @retval None
+ */
+ITCM_TEXT void EthIf_IRQHandler(void)
+{
+	ethIfStats.irqs++;
+	HAL_ETH_IRQHandler(&ethIfHandle);
+}
+
+/**
+ * @brief  Reclaim the sent frames and pass up to budget received frames
+ *         to the RX handler.
+ * @note   Call after each schedule request until it returns
+ *         ETH_IF_POLL_DONE, from a single task, see EthIf_Drain().
+ * @param  budget: most frames handled by this call
+ * @retval ETH_IF_POLL_DONE: ring empty, interrupts unmasked;
+ *         ETH_IF_POLL_AGAIN: more frames may be waiting, give up the CPU
+ *         and call again;
+ *         ETH_IF_POLL_STARVED: the pool could not refill the RX ring,
+ *         interrupts stay masked, call again once frames were freed
+ */
+EthIf_PollTypeDef EthIf_Poll(uint32_t budget)
+{
+	uint32_t frames = 0U;
+	uint32_t primask;
+	void *frame;
+
+	ethIfStats.polls++;
+	EthIf_TxReclaim();
+
+	while ((frames < budget) && (HAL_ETH_ReadData(&ethIfHandle, &frame) == HAL_OK))
+	{
+		if (EthIf_RxAccept(frame) != 0U)
+		{
+			ethIfRxHandler(frame);
+		}
+		else
+		{
+			EthPbuf_Free(frame);
+		}
+		frames++;
+	}
+	ethIfBurst += frames;
+	EthIf_CountMissed();
+
+	if (frames == budget)
+	{
+		ethIfStats.budgetExhausted++;
+		return ETH_IF_POLL_AGAIN;
+	}
+	if (ethIfHandle.RxDescList.RxBuildDescCnt != 0U)
+	{
+		/* No interrupt would come for the descriptors left unbuilt */
+		ethIfStats.starved++;
+		return ETH_IF_POLL_STARVED;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	__HAL_ETH_DMA_CLEAR_IT(&ethIfHandle, ETH_IF_POLL_STATUS);
+	HAL_ETH_ReleaseTxPacket(&ethIfHandle);
+	if (EthIf_RxReady())
+	{
+		/* Completed before the clear: its interrupt is gone, stay masked */
+		__set_PRIMASK(primask);
+		return ETH_IF_POLL_AGAIN;
+	}
+	ethIfPollPending = 0U;
+	__HAL_ETH_DMA_ENABLE_IT(&ethIfHandle, ETH_IF_POLL_IT);
+	__set_PRIMASK(primask);
+
+	if (ethIfBurst > ethIfStats.rxBurstMax)
+	{
+		ethIfStats.rxBurstMax = ethIfBurst;
+	}
+	ethIfBurst = 0U;
+
+	return ETH_IF_POLL_DONE;
+}
+
+/**
+ * @brief  Poll until the RX ring is drained, from the task woken by the
+ *         schedule callback.
+ * @note   Between two polls the task sleeps until the next tick, also after
+ *         ETH_IF_POLL_AGAIN: during a flood the tasks of every lower
+ *         priority still run, the budget bounds the frames per tick.
+ * @param  budget: most frames handled per poll
+ * @retval None
+ */
+void EthIf_Drain(uint32_t budget)
+{
+	while (EthIf_Poll(budget) != ETH_IF_POLL_DONE)
+	{
+		Kernel_Delay(1U);
+	}
+}
+
+/**
+ * @brief  Queue a frame for transmission without copy, FCS, padding and
+ *         checksums added by the MAC.
+ * @note   The MAC fills in the IPv4 header checksum and the TCP/UDP/ICMP
+ *         checksum, pseudo-header included: leave both fields zero. Other
+ *         frames go out unchanged.
+ * @note   ETH_PBUF_FLAG_TX_TIMESTAMP in the head's flags has the MAC time
+ *         stamp the frame, handed to the TX PTP callback when reclaimed.
+ * @note   On HAL_OK the caller's reference on frame goes to the driver,
+ *         otherwise (TX ring full, chain too long) the caller keeps it.
+ * @param  frame: pbuf chain, destination MAC onwards
+ * @retval HAL status
+ */
+HAL_StatusTypeDef EthIf_Transmit(EthPbuf_TypeDef *frame)
+{
+	return (EthIf_TransmitBatch(&frame, 1U) == 1U) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief  Queue several frames as EthIf_Transmit() does, in one critical
+ *         section with at most one reclaim of the sent frames.
+ * @note   The HAL queues one frame per HAL_ETH_Transmit_IT() call; what a
+ *         batch saves is the per-frame interrupt masking, statistics
+ *         update and reclaim attempt. Interrupts stay masked while the
+ *         whole batch is queued, keep it short.
+ * @param  frames: pbuf chains, sent in order
+ * @param  count: frames
+ * @retval frames queued: the first ones, the caller keeps the others
+ */
+uint32_t EthIf_TransmitBatch(EthPbuf_TypeDef *const *frames, uint32_t count)
+{
+	ETH_TxPacketConfig config;
+	uint32_t sent = 0U;
+	uint32_t bytes = 0U;
+	uint32_t reclaimed = 0U;
+	uint32_t primask;
+
+	memset(&config, 0, sizeof(config));
+	config.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
+	config.ChecksumCtrl = ETH_CHECKSUM_IPHDR_PAYLOAD_INSERT_PHDR_CALC;
+	config.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	while (sent < count)
+	{
+		EthIf_TxTimestamp(frames[sent]);
+		if (EthPbuf_Transmit(&ethIfHandle, &config, frames[sent]) == HAL_OK)
+		{
+			bytes += frames[sent]->totalLength;
+			sent++;
+		}
+		else if (reclaimed == 0U)
+		{
+			/* The ring may only hold frames sent since the last poll */
+			HAL_ETH_ReleaseTxPacket(&ethIfHandle);
+			reclaimed = 1U;
+		}
+		else
+		{
+			ethIfStats.txBusy++;
+			break;
+		}
+	}
+	ethIfStats.txFrames += sent;
+	ethIfStats.txBytes += bytes;
+	__set_PRIMASK(primask);
+
+	return sent;
+}
+
+/**
+ * @brief  The HAL handle, for the HAL_ETH_* services not wrapped here.
+ * @retval ETH handle
+ */
+ETH_HandleTypeDef *EthIf_GetHandle(void)
+{
+	return &ethIfHandle;
+}
+
+/**
+ * @brief  Snapshot of the interface counters, taken with interrupts masked
+ *         so that it is consistent.
+ * @param  stats: destination
+ * @retval None
+ */
+void EthIf_GetStats(EthIf_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = ethIfStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the interface counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void EthIf_Dump(EthIf_PutCharTypeDef putChar)
+{
+	EthIf_StatsTypeDef stats;
+	uint32_t perIrq;
+	char line[280];
+
+	EthIf_GetStats(&stats);
+	perIrq = (stats.irqs != 0U) ? (uint32_t)(((uint64_t)stats.rxFrames * 100U) / stats.irqs) : 0U;
+
+	snprintf(line, sizeof(line),
+		"eth rx=%lu/%luB irq=%lu rx/irq=%lu.%02lu burst=%lu budget=%lu starved=%lu csum=%lu csumerr=%lu"
+		" err=%lu missed=%lu ovf=%lu rbu=%lu tx=%lu/%luB busy=%lu\r\n",
+		(unsigned long)stats.rxFrames, (unsigned long)stats.rxBytes, (unsigned long)stats.irqs,
+		(unsigned long)(perIrq / 100U), (unsigned long)(perIrq % 100U), (unsigned long)stats.rxBurstMax,
+		(unsigned long)stats.budgetExhausted, (unsigned long)stats.starved, (unsigned long)stats.rxChecksumOk,
+		(unsigned long)stats.rxChecksumErrors, (unsigned long)stats.rxErrors, (unsigned long)stats.rxMissed,
+		(unsigned long)stats.rxOverflows, (unsigned long)stats.rxBufferUnavailable,
+		(unsigned long)stats.txFrames, (unsigned long)stats.txBytes, (unsigned long)stats.txBusy);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
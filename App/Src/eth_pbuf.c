@@ -0,0 +1,388 @@
+/**
+  ******************************************************************************
+  * @file    eth_pbuf.c
+  * @brief   Zero-copy packet buffer pool of the ETH MAC and its HAL ETH
+  *          buffer hooks.
+  *
+  *          The pool is a LIFO free list: the buffer freed last, still warm
+  *          in the D-cache tags, is handed out first. Alloc and free are
+  *          short critical sections, the TX free hook runs wherever
+  *          HAL_ETH_ReleaseTxPacket() is called, interrupts included.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dma_buffer.h"
+#include "eth_pbuf.h"
+#include "mem_section.h"
+
+#if (ETH_PBUF_SIZE != ETH_RX_BUF_SIZE) || ((ETH_PBUF_SIZE % DMA_BUFFER_LINE) != 0U)
+#error "ETH_RX_BUF_SIZE must be ETH_PBUF_SIZE, a multiple of the cache line"
+#endif
+
+/* Private define ------------------------------------------------------------*/
+/* RDES0 bits of enhanced descriptors, given other names by the HAL */
+#define ETH_PBUF_RDES0_ESA          (1UL << 0)  /* extended status available in RDES4 */
+#define ETH_PBUF_RDES0_TSV          (1UL << 7)  /* time stamp valid in RDES6/RDES7 */
+
+/* Private variables ---------------------------------------------------------*/
+static EthPbuf_TypeDef ethPbufPool[ETH_PBUF_COUNT] DTCM_BSS;
+static EthPbuf_TypeDef *ethPbufFree DTCM_BSS;
+static uint32_t ethPbufFreeCount DTCM_BSS;
+static uint32_t ethPbufMinFree DTCM_BSS;
+static uint8_t ethPbufData[ETH_PBUF_COUNT][ETH_PBUF_SIZE] __attribute__((aligned(DMA_BUFFER_LINE)));
+static ETH_HandleTypeDef *ethPbufHandle;
+
+/* Private functions ---------------------------------------------------------*/
+static inline EthPbuf_TypeDef *EthPbuf_FromData(const uint8_t *data)
+{
+	uint32_t index = (uint32_t)(data - &ethPbufData[0][0]) / ETH_PBUF_SIZE;
+
+	assert_param(index < ETH_PBUF_COUNT);
+	return &ethPbufPool[index];
+}
+
+/* HAL_ETH_ReadData()/ETH_UpdateDescriptor(): a buffer for an RX descriptor,
+   NULL leaves the descriptor unbuilt until the next ReadData() */
+static void EthPbuf_RxAllocate(uint8_t **buff)
+{
+	EthPbuf_TypeDef *pbuf = EthPbuf_Alloc();
+
+	if (pbuf == NULL)
+	{
+		*buff = NULL;
+		return;
+	}
+	DmaBuffer_PrepareRx(pbuf->payload, ETH_PBUF_SIZE);
+	*buff = pbuf->payload;
+}
+
+/* The descriptor HAL_ETH_ReadData() is linking: the HAL parks its buffer
+   address in BackupAddr0 meanwhile, the DMA write-back is still intact */
+static const ETH_DMADescTypeDef *EthPbuf_RxDesc(const uint8_t *buff)
+{
+	uint32_t index = ethPbufHandle->RxDescList.RxDescIdx;
+
+	for (uint32_t n = 0U; n < ETH_RX_DESC_CNT; n++)
+	{
+		const ETH_DMADescTypeDef *desc = (const ETH_DMADescTypeDef *)ethPbufHandle->RxDescList.RxDesc[index];
+
+		if (desc->BackupAddr0 == (uint32_t)(uintptr_t)buff)
+		{
+			return desc;
+		}
+		index = (index + 1U) % ETH_RX_DESC_CNT;
+	}
+	return NULL;
+}
+
+/* RDES0 of the last descriptor and, with enhanced descriptors, RDES4 */
+static uint16_t EthPbuf_RxFlags(const ETH_DMADescTypeDef *desc)
+{
+	uint32_t status = desc->DESC0;
+	uint32_t extended = 0U;
+	uint16_t flags = 0U;
+
+	if ((status & ETH_PBUF_RDES0_ESA) != 0U)
+	{
+		extended = desc->DESC4;
+	}
+	if ((extended & (ETH_DMAPTPRXDESC_IPHE | ETH_DMAPTPRXDESC_IPPE)) != 0U)
+	{
+		flags |= ETH_PBUF_FLAG_CSUM_ERROR;
+	}
+	else if ((extended & ETH_DMAPTPRXDESC_IPCB) == 0U)
+	{
+		if ((extended & ETH_DMAPTPRXDESC_IPV4PR) != 0U)
+		{
+			flags |= ETH_PBUF_FLAG_IP_CSUM_OK;
+		}
+		if ((extended & ETH_DMAPTPRXDESC_IPPT) != 0U)
+		{
+			flags |= ETH_PBUF_FLAG_L4_CSUM_OK;
+		}
+	}
+	if ((status & (ETH_DMARXDESC_DE | ETH_DMARXDESC_OE | ETH_DMARXDESC_LC | ETH_DMARXDESC_RWT
+			| ETH_DMARXDESC_RE | ETH_DMARXDESC_CE)) != 0U)
+	{
+		flags |= ETH_PBUF_FLAG_RX_ERROR;
+	}
+	/* TSV is the IPv4 header checksum error bit until the time stamp unit runs */
+	if (((status & ETH_PBUF_RDES0_TSV) != 0U) && (ethPbufHandle->IsPtpConfigured == HAL_ETH_PTP_CONFIGURATED))
+	{
+		flags |= ETH_PBUF_FLAG_RX_TIMESTAMP;
+	}
+	return flags;
+}
+
+/* HAL_ETH_ReadData(): one received buffer, appended to the frame chain */
+static void EthPbuf_RxLink(void **pStart, void **pEnd, uint8_t *buff, uint16_t Length)
+{
+	EthPbuf_TypeDef *pbuf = EthPbuf_FromData(buff);
+	const ETH_DMADescTypeDef *desc = EthPbuf_RxDesc(buff);
+
+	DmaBuffer_CompleteRx(buff, Length);
+	pbuf->next = NULL;
+	pbuf->length = Length;
+	pbuf->totalLength = Length;
+
+	if (*pStart == NULL)
+	{
+		*pStart = pbuf;
+	}
+	else
+	{
+		((EthPbuf_TypeDef *)*pEnd)->next = pbuf;
+		for (EthPbuf_TypeDef *p = *pStart; p != pbuf; p = p->next)
+		{
+			p->totalLength += Length;
+		}
+	}
+	*pEnd = pbuf;
+
+	if ((desc != NULL) && ((desc->DESC0 & ETH_DMARXDESC_LS) != 0U))
+	{
+		((EthPbuf_TypeDef *)*pStart)->flags = EthPbuf_RxFlags(desc);
+	}
+}
+
+/* HAL_ETH_ReleaseTxPacket(): the frame given as pData is sent */
+static void EthPbuf_TxFree(uint32_t *buff)
+{
+	EthPbuf_Free((EthPbuf_TypeDef *)buff);
+}
+
+/**
+ * @brief  Put every pbuf in the free list.
+ * @retval None
+ */
+void EthPbuf_Init(void)
+{
+	ethPbufFree = NULL;
+	for (uint32_t i = ETH_PBUF_COUNT; i > 0U; i--)
+	{
+		EthPbuf_TypeDef *pbuf = &ethPbufPool[i - 1U];
+
+		pbuf->index = (uint16_t)(i - 1U);
+		pbuf->refCount = 0U;
+		pbuf->next = ethPbufFree;
+		ethPbufFree = pbuf;
+	}
+	ethPbufFreeCount = ETH_PBUF_COUNT;
+	ethPbufMinFree = ETH_PBUF_COUNT;
+}
+
+/**
+ * @brief  Take a pbuf from the pool.
+ * @retval pbuf with one reference, payload at the start of its data area
+ *         and no data; NULL if the pool is empty
+ */
+ITCM_TEXT EthPbuf_TypeDef *EthPbuf_Alloc(void)
+{
+	EthPbuf_TypeDef *pbuf;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	pbuf = ethPbufFree;
+	if (pbuf != NULL)
+	{
+		ethPbufFree = pbuf->next;
+		ethPbufFreeCount--;
+		if (ethPbufFreeCount < ethPbufMinFree)
+		{
+			ethPbufMinFree = ethPbufFreeCount;
+		}
+		pbuf->refCount = 1U;
+	}
+	__set_PRIMASK(primask);
+
+	if (pbuf != NULL)
+	{
+		pbuf->next = NULL;
+		pbuf->payload = ethPbufData[pbuf->index];
+		pbuf->length = 0U;
+		pbuf->totalLength = 0U;
+		pbuf->flags = 0U;
+	}
+	return pbuf;
+}
+
+/**
+ * @brief  Take one more reference on a pbuf (not on the rest of its chain).
+ * @param  pbuf: pbuf in use
+ * @retval None
+ */
+void EthPbuf_Ref(EthPbuf_TypeDef *pbuf)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	assert_param(pbuf->refCount != 0U);
+	__disable_irq();
+	pbuf->refCount++;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Drop a reference on a chain: the head loses one, each pbuf
+ *         reaching zero goes back to the pool and passes the drop on to
+ *         the next one.
+ * @param  pbuf: head of the chain, NULL is ignored
+ * @retval None
+ */
+ITCM_TEXT void EthPbuf_Free(EthPbuf_TypeDef *pbuf)
+{
+	while (pbuf != NULL)
+	{
+		EthPbuf_TypeDef *next = pbuf->next;
+		uint32_t released = 0U;
+		uint32_t primask = __get_PRIMASK();
+
+		__disable_irq();
+		assert_param(pbuf->refCount != 0U);
+		if (--pbuf->refCount == 0U)
+		{
+			pbuf->next = ethPbufFree;
+			ethPbufFree = pbuf;
+			ethPbufFreeCount++;
+			released = 1U;
+		}
+		__set_PRIMASK(primask);
+
+		pbuf = (released != 0U) ? next : NULL;
+	}
+}
+
+/**
+ * @brief  Append a chain to another one, the caller's reference on tail
+ *         moves to the head chain.
+ * @param  head: first chain, its totalLength fields grow
+ * @param  tail: chain appended after the last pbuf of head
+ * @retval None
+ */
+void EthPbuf_Cat(EthPbuf_TypeDef *head, EthPbuf_TypeDef *tail)
+{
+	EthPbuf_TypeDef *p = head;
+
+	for (;;)
+	{
+		p->totalLength += tail->totalLength;
+		if (p->next == NULL)
+		{
+			break;
+		}
+		p = p->next;
+	}
+	p->next = tail;
+}
+
+/**
+ * @brief  Move the start of a pbuf's data to add or strip a header in
+ *         place, the room in front of payload being the headroom left by
+ *         the previous owner.
+ * @param  pbuf: head of a chain
+ * @param  size: bytes to expose in front of payload, negative to hide
+ * @retval HAL_OK, HAL_ERROR if the data area or the pbuf's data is too
+ *         short (nothing changed)
+ */
+HAL_StatusTypeDef EthPbuf_Header(EthPbuf_TypeDef *pbuf, int32_t size)
+{
+	int32_t headroom = (int32_t)(pbuf->payload - ethPbufData[pbuf->index]);
+
+	if ((size > headroom) || ((size < 0) && ((uint32_t)-size > pbuf->length)))
+	{
+		return HAL_ERROR;
+	}
+	pbuf->payload -= size;
+	pbuf->length = (uint16_t)(pbuf->length + size);
+	pbuf->totalLength = (uint16_t)(pbuf->totalLength + size);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Pbufs in the pool.
+ * @retval count
+ */
+uint32_t EthPbuf_GetFree(void)
+{
+	return ethPbufFreeCount;
+}
+
+/**
+ * @brief  Lowest count of pbufs in the pool since EthPbuf_Init().
+ * @retval count
+ */
+uint32_t EthPbuf_GetMinFree(void)
+{
+	return ethPbufMinFree;
+}
+
+/**
+ * @brief  Make a HAL ETH handle receive into and free to the pool.
+ * @note   Call after HAL_ETH_Init(), which resets the hooks, and before
+ *         HAL_ETH_Start_IT(), which builds the RX descriptors.
+ * @param  heth: ETH handle
+ * @retval HAL status
+ */
+HAL_StatusTypeDef EthPbuf_Attach(ETH_HandleTypeDef *heth)
+{
+	if ((HAL_ETH_RegisterRxAllocateCallback(heth, EthPbuf_RxAllocate) != HAL_OK)
+			|| (HAL_ETH_RegisterRxLinkCallback(heth, EthPbuf_RxLink) != HAL_OK)
+			|| (HAL_ETH_RegisterTxFreeCallback(heth, EthPbuf_TxFree) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	ethPbufHandle = heth;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Queue a frame for transmission without copy, one TX descriptor
+ *         per non-empty pbuf of the chain.
+ * @note   On HAL_OK the caller's reference on frame goes to the driver, it
+ *         is dropped by HAL_ETH_ReleaseTxPacket() once the frame is sent.
+ *         Otherwise (ring full, chain too long) the caller keeps it.
+ * @param  heth: started ETH handle with EthPbuf_Attach() done
+ * @param  config: packet attributes, checksum and CRC/pad controls;
+ *         Length, TxBuffer and pData are filled in here
+ * @param  frame: chain of at most ETH_PBUF_TX_SEGMENTS pbufs
+ * @retval HAL status
+ */
+HAL_StatusTypeDef EthPbuf_Transmit(ETH_HandleTypeDef *heth, ETH_TxPacketConfig *config, EthPbuf_TypeDef *frame)
+{
+	ETH_BufferTypeDef segment[ETH_PBUF_TX_SEGMENTS];
+	uint32_t count = 0U;
+
+	for (EthPbuf_TypeDef *p = frame; p != NULL; p = p->next)
+	{
+		if (p->length == 0U)
+		{
+			continue;
+		}
+		if (count == ETH_PBUF_TX_SEGMENTS)
+		{
+			return HAL_ERROR;
+		}
+		DmaBuffer_PrepareTx(p->payload, p->length);
+		segment[count].buffer = p->payload;
+		segment[count].len = p->length;
+		segment[count].next = NULL;
+		if (count != 0U)
+		{
+			segment[count - 1U].next = &segment[count];
+		}
+		count++;
+	}
+	if (count == 0U)
+	{
+		return HAL_ERROR;
+	}
+
+	/* The HAL copies the list into the descriptors, it may live on the stack */
+	config->Length = frame->totalLength;
+	config->TxBuffer = segment;
+	config->pData = frame;
+	return HAL_ETH_Transmit_IT(heth, config);
+}
@@ -0,0 +1,164 @@
+/**
+  ******************************************************************************
+  * @file    frame.c
+  * @brief   COBS framing for the serial link.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "frame.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FRAME_COBS_MAX_CODE     0xFFU
+
+/* Private functions ---------------------------------------------------------*/
+static void Frame_DecoderReset(Frame_DecoderTypeDef *decoder)
+{
+	decoder->length = 0;
+	decoder->code = 0;
+	decoder->remaining = 0;
+	decoder->discard = 0;
+}
+
+static void Frame_DecoderFail(Frame_DecoderTypeDef *decoder)
+{
+	decoder->errors++;
+	decoder->discard = 1;
+}
+
+static void Frame_DecoderAppend(Frame_DecoderTypeDef *decoder, uint8_t byte)
+{
+	if (decoder->length >= decoder->size)
+	{
+		Frame_DecoderFail(decoder);
+		return;
+	}
+	decoder->buffer[decoder->length++] = byte;
+}
+
+/**
+ * @brief  COBS-encode a payload and append the frame delimiter.
+ * @param  payload: data to encode
+ * @param  length: payload length
+ * @param  out: encoded frame
+ * @param  outSize: size of out, FRAME_ENCODED_MAX(length) always fits
+ * @retval Encoded length including the delimiter, 0 if out is too small
+ */
+uint32_t Frame_Encode(const uint8_t *payload, uint32_t length, uint8_t *out, uint32_t outSize)
+{
+	uint32_t codeIndex = 0;
+	uint32_t index = 1;
+	uint8_t code = 1;
+
+	if (outSize < 2U)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		if (index >= outSize - 1U)
+		{
+			return 0;
+		}
+
+		if (payload[i] == 0U)
+		{
+			out[codeIndex] = code;
+			codeIndex = index++;
+			code = 1;
+		}
+		else
+		{
+			out[index++] = payload[i];
+			if (++code == FRAME_COBS_MAX_CODE)
+			{
+				out[codeIndex] = code;
+				codeIndex = index++;
+				code = 1;
+			}
+		}
+	}
+
+	if (index >= outSize)
+	{
+		return 0;
+	}
+	out[codeIndex] = code;
+	out[index++] = FRAME_DELIMITER;
+
+	return index;
+}
+
+/**
+ * @brief  Initialize a streaming decoder.
+ * @param  decoder: decoder handle
+ * @param  buffer: storage for one decoded payload
+ * @param  size: size of buffer, longer frames are dropped
+ * @retval None
+ */
+void Frame_DecoderInit(Frame_DecoderTypeDef *decoder, uint8_t *buffer, uint32_t size)
+{
+	decoder->buffer = buffer;
+	decoder->size = size;
+	decoder->frames = 0;
+	decoder->errors = 0;
+	Frame_DecoderReset(decoder);
+}
+
+/**
+ * @brief  Feed received bytes, handler is called once per complete frame.
+ * @param  decoder: decoder handle
+ * @param  data: received bytes, any split across calls
+ * @param  length: number of bytes
+ * @param  handler: frame callback, the payload is only valid during the call
+ * @param  context: handler argument
+ * @retval None
+ */
+void Frame_DecoderPush(Frame_DecoderTypeDef *decoder, const uint8_t *data, uint32_t length,
+		Frame_HandlerTypeDef handler, void *context)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		uint8_t byte = data[i];
+
+		if (byte == FRAME_DELIMITER)
+		{
+			if (!decoder->discard && (decoder->code != 0U))
+			{
+				if (decoder->remaining == 0U)
+				{
+					decoder->frames++;
+					handler(context, decoder->buffer, decoder->length);
+				}
+				else
+				{
+					/* Truncated block */
+					decoder->errors++;
+				}
+			}
+			Frame_DecoderReset(decoder);
+		}
+		else if (decoder->discard)
+		{
+			continue;
+		}
+		else if (decoder->remaining == 0U)
+		{
+			/* Code byte: the previous block ended with an implicit zero */
+			if ((decoder->code != 0U) && (decoder->code != FRAME_COBS_MAX_CODE))
+			{
+				Frame_DecoderAppend(decoder, 0U);
+			}
+			decoder->code = byte;
+			decoder->remaining = byte - 1U;
+		}
+		else
+		{
+			Frame_DecoderAppend(decoder, byte);
+			decoder->remaining--;
+		}
+	}
+}
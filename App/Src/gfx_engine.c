@@ -0,0 +1,462 @@
+/**
+  ******************************************************************************
+  * @file    gfx_engine.c
+  * @brief   DMA2D command queue.
+  *
+  *          The queue holds register images: starting a command is a run of
+  *          register writes ending with START, short enough for the
+  *          interrupt. The submitter that finds the engine stopped starts
+  *          it, with interrupts enabled; from then on each completion
+  *          interrupt retires the command and starts the next one, markers
+  *          being retired on the way, until the queue is empty.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "gfx_engine.h"
+#include "mem_section.h"
+
+/* Private define ------------------------------------------------------------*/
+#define GFX_ENGINE_TRANSFER         0U
+#define GFX_ENGINE_CLUT             1U
+#define GFX_ENGINE_MARKER           2U
+
+#define GFX_ENGINE_ERROR_FLAGS      (DMA2D_ISR_TEIF | DMA2D_ISR_CEIF | DMA2D_ISR_CAEIF)
+#define GFX_ENGINE_DONE_FLAGS       (DMA2D_ISR_TCIF | DMA2D_ISR_CTCIF | GFX_ENGINE_ERROR_FLAGS)
+#define GFX_ENGINE_CLEAR_FLAGS      (DMA2D_IFCR_CTEIF | DMA2D_IFCR_CTCIF | DMA2D_IFCR_CTWIF | DMA2D_IFCR_CAECIF \
+		| DMA2D_IFCR_CCTCIF | DMA2D_IFCR_CCEIF)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	uint32_t kind;
+	uint32_t cr;                        /* MODE */
+	uint32_t fgmar;                     /* a CLUT load: FGCMAR */
+	uint32_t fgor;
+	uint32_t fgpfccr;
+	uint32_t fgcolr;
+	uint32_t bgmar;
+	uint32_t bgor;
+	uint32_t bgpfccr;
+	uint32_t opfccr;
+	uint32_t ocolr;
+	uint32_t omar;
+	uint32_t oor;
+	uint32_t nlr;
+	GfxEngine_DoneTypeDef done;         /* a marker */
+	void *arg;
+} GfxEngine_CommandTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static GfxEngine_CommandTypeDef gfxEngineQueue[GFX_ENGINE_QUEUE_DEPTH];
+static volatile uint32_t gfxEngineHead;     /* retired, by the engine */
+static volatile uint32_t gfxEngineTail;     /* queued, interrupts masked */
+static volatile uint32_t gfxEngineRunning;  /* a command started or being started */
+static uint32_t gfxEngineSoftware;
+static uint32_t gfxEngineClut;              /* CCM and CS of the last CLUT load queued */
+static DMA2D_TypeDef gfxEngineShadow;       /* register block of the software mode */
+static GfxEngine_StatsTypeDef gfxEngineStats;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Address and line offset of a rectangle of a buffer.
+ * @retval 1, 0 if the rectangle is empty, out of the buffer or beyond the
+ *         DMA2D counters, or splits the bytes of a 4-bit format
+ */
+static uint32_t GfxEngine_Area(const GfxEngine_BufferTypeDef *buffer, uint32_t x, uint32_t y, uint32_t width,
+		uint32_t height, uint32_t *address, uint32_t *offset)
+{
+	uint32_t bits = GfxSoft_Bits(buffer->format);
+
+	if ((bits == 0U) || (width == 0U) || (height == 0U) || (width > GFX_ENGINE_MAX_WIDTH)
+		|| (height > GFX_ENGINE_MAX_HEIGHT) || (x > buffer->width) || (width > buffer->width - x)
+		|| (y > buffer->height) || (height > buffer->height - y) || (buffer->width - width > GFX_ENGINE_MAX_WIDTH))
+	{
+		return 0U;
+	}
+	if ((bits == 4U) && (((x | buffer->width) & 1U) != 0U))
+	{
+		return 0U;
+	}
+	*address = (uint32_t)(uintptr_t)buffer->address + ((((y * buffer->width) + x) * bits) / 8U);
+	*offset = buffer->width - width;
+	return 1U;
+}
+
+/* Foreground alpha mode of a layer color: its alpha combined unless opaque */
+static uint32_t GfxEngine_Alpha(uint32_t color)
+{
+	uint32_t alpha = color >> 24;
+
+	if (alpha == 0xFFU)
+	{
+		return GFX_ALPHA_KEEP << DMA2D_FGPFCCR_AM_Pos;
+	}
+	return (GFX_ALPHA_COMBINE << DMA2D_FGPFCCR_AM_Pos) | (alpha << DMA2D_FGPFCCR_ALPHA_Pos);
+}
+
+static void GfxEngine_Program(DMA2D_TypeDef *dma2d, const GfxEngine_CommandTypeDef *command)
+{
+	if (command->kind == GFX_ENGINE_CLUT)
+	{
+		dma2d->CR = DMA2D_CR_CTCIE | DMA2D_CR_CAEIE;
+		dma2d->FGCMAR = command->fgmar;
+		dma2d->FGPFCCR = command->fgpfccr | DMA2D_FGPFCCR_START;
+		return;
+	}
+	dma2d->FGMAR = command->fgmar;
+	dma2d->FGOR = command->fgor;
+	dma2d->FGPFCCR = command->fgpfccr;
+	dma2d->FGCOLR = command->fgcolr;
+	dma2d->BGMAR = command->bgmar;
+	dma2d->BGOR = command->bgor;
+	dma2d->BGPFCCR = command->bgpfccr;
+	dma2d->OPFCCR = command->opfccr;
+	dma2d->OCOLR = command->ocolr;
+	dma2d->OMAR = command->omar;
+	dma2d->OOR = command->oor;
+	dma2d->NLR = command->nlr;
+	dma2d->CR = command->cr | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE | DMA2D_CR_START;
+}
+
+/* Command at the head over, with the DMA2D flags it ended on */
+static void GfxEngine_Retire(uint32_t isr)
+{
+	const GfxEngine_CommandTypeDef *command = &gfxEngineQueue[gfxEngineHead % GFX_ENGINE_QUEUE_DEPTH];
+
+	if ((isr & GFX_ENGINE_ERROR_FLAGS) != 0U)
+	{
+		gfxEngineStats.errors++;
+	}
+	else if (command->kind == GFX_ENGINE_CLUT)
+	{
+		gfxEngineStats.cluts++;
+	}
+	else
+	{
+		gfxEngineStats.transfers++;
+		gfxEngineStats.pixels += ((command->nlr & DMA2D_NLR_PL) >> DMA2D_NLR_PL_Pos) * (command->nlr & DMA2D_NLR_NL);
+	}
+	gfxEngineHead++;
+}
+
+/**
+ * @brief  Start the command at the head, retiring the markers before it;
+ *         in software mode, run the commands until the queue is empty.
+ * @note   Called by the owner of gfxEngineRunning only: the submitter that
+ *         set it, then the completion interrupt.
+ */
+static void GfxEngine_Pump(void)
+{
+	for (;;)
+	{
+		GfxEngine_CommandTypeDef *command;
+		uint32_t primask = __get_PRIMASK();
+
+		__disable_irq();
+		if (gfxEngineHead == gfxEngineTail)
+		{
+			gfxEngineRunning = 0U;
+			__set_PRIMASK(primask);
+			return;
+		}
+		__set_PRIMASK(primask);
+
+		command = &gfxEngineQueue[gfxEngineHead % GFX_ENGINE_QUEUE_DEPTH];
+		if (command->kind == GFX_ENGINE_MARKER)
+		{
+			GfxEngine_DoneTypeDef done = command->done;
+			void *arg = command->arg;
+
+			gfxEngineStats.markers++;
+			gfxEngineHead++;
+			if (done != NULL)
+			{
+				done(arg);
+			}
+			continue;
+		}
+		if (gfxEngineSoftware == 0U)
+		{
+			/* Nothing of the command may be touched past this point: the
+			   interrupt may already be retiring it */
+			GfxEngine_Program(DMA2D, command);
+			return;
+		}
+		GfxEngine_Program(&gfxEngineShadow, command);
+		GfxSoft_Execute(&gfxEngineShadow);
+		GfxEngine_Retire(gfxEngineShadow.ISR);
+		gfxEngineShadow.ISR = 0U;
+	}
+}
+
+static HAL_StatusTypeDef GfxEngine_Submit(const GfxEngine_CommandTypeDef *command)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t depth;
+	uint32_t start;
+
+	__disable_irq();
+	if (gfxEngineTail - gfxEngineHead >= GFX_ENGINE_QUEUE_DEPTH)
+	{
+		gfxEngineStats.full++;
+		__set_PRIMASK(primask);
+		return HAL_BUSY;
+	}
+	gfxEngineQueue[gfxEngineTail % GFX_ENGINE_QUEUE_DEPTH] = *command;
+	if (command->kind == GFX_ENGINE_CLUT)
+	{
+		gfxEngineClut = command->fgpfccr & (DMA2D_FGPFCCR_CCM | DMA2D_FGPFCCR_CS);
+	}
+	gfxEngineTail++;
+	gfxEngineStats.commands++;
+	depth = gfxEngineTail - gfxEngineHead;
+	if (depth > gfxEngineStats.maxDepth)
+	{
+		gfxEngineStats.maxDepth = depth;
+	}
+	start = (gfxEngineRunning == 0U) ? 1U : 0U;
+	gfxEngineRunning = 1U;
+	__set_PRIMASK(primask);
+
+	if (start != 0U)
+	{
+		GfxEngine_Pump();
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Transfer from src to (x, y) of dst, src and rect checked.
+ * @param  mode: GFX_MODE_M2M .. GFX_MODE_M2M_BLEND
+ * @param  fgpfccr: alpha mode and value of the source
+ */
+static HAL_StatusTypeDef GfxEngine_Transfer(uint32_t mode, const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t fgpfccr, uint32_t color)
+{
+	GfxEngine_CommandTypeDef command;
+
+	memset(&command, 0, sizeof(command));
+	if ((GfxEngine_Area(src, rect->x, rect->y, rect->width, rect->height, &command.fgmar, &command.fgor) == 0U)
+		|| (GfxEngine_Area(dst, x, y, rect->width, rect->height, &command.omar, &command.oor) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	command.kind = GFX_ENGINE_TRANSFER;
+	command.cr = mode << DMA2D_CR_MODE_Pos;
+	command.fgpfccr = src->format | gfxEngineClut | fgpfccr;
+	command.fgcolr = color & 0x00FFFFFFU;
+	command.opfccr = dst->format;
+	command.nlr = (rect->width << DMA2D_NLR_PL_Pos) | rect->height;
+	if (mode == GFX_MODE_M2M_BLEND)
+	{
+		/* The background is the destination itself */
+		command.bgmar = command.omar;
+		command.bgor = command.oor;
+		command.bgpfccr = dst->format;
+	}
+	return GfxEngine_Submit(&command);
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Empty the queue and take the DMA2D, or the software renderer.
+ * @note   No command may be in progress.
+ * @param  mode: GFX_ENGINE_HARDWARE, GFX_ENGINE_SOFTWARE
+ * @retval HAL_OK, HAL_ERROR for an unknown mode
+ */
+HAL_StatusTypeDef GfxEngine_Init(uint32_t mode)
+{
+	if (mode > GFX_ENGINE_SOFTWARE)
+	{
+		return HAL_ERROR;
+	}
+	gfxEngineHead = 0U;
+	gfxEngineTail = 0U;
+	gfxEngineRunning = 0U;
+	gfxEngineClut = 0U;
+	gfxEngineSoftware = mode;
+	memset(&gfxEngineShadow, 0, sizeof(gfxEngineShadow));
+	memset(&gfxEngineStats, 0, sizeof(gfxEngineStats));
+	if (mode == GFX_ENGINE_HARDWARE)
+	{
+		LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2D);
+		DMA2D->CR = 0U;
+		DMA2D->IFCR = GFX_ENGINE_CLEAR_FLAGS;
+		NVIC_SetPriority(DMA2D_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), GFX_ENGINE_IRQ_PRIORITY, 0));
+		NVIC_EnableIRQ(DMA2D_IRQn);
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Queue a fill of a rectangle with a color.
+ * @param  dst: output format
+ * @param  argb: ARGB8888, converted to the format of dst
+ * @retval HAL_OK: queued; HAL_BUSY: queue full; HAL_ERROR: rectangle or
+ *         format not valid
+ */
+HAL_StatusTypeDef GfxEngine_Fill(const GfxEngine_BufferTypeDef *dst, const GfxEngine_RectTypeDef *rect, uint32_t argb)
+{
+	GfxEngine_CommandTypeDef command;
+
+	memset(&command, 0, sizeof(command));
+	if ((dst->format >= GFX_OUTPUT_FORMATS)
+		|| (GfxEngine_Area(dst, rect->x, rect->y, rect->width, rect->height, &command.omar, &command.oor) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	command.kind = GFX_ENGINE_TRANSFER;
+	command.cr = GFX_MODE_R2M << DMA2D_CR_MODE_Pos;
+	command.opfccr = dst->format;
+	command.ocolr = GfxSoft_FromArgb(argb, dst->format);
+	command.nlr = (rect->width << DMA2D_NLR_PL_Pos) | rect->height;
+	return GfxEngine_Submit(&command);
+}
+
+/**
+ * @brief  Queue a copy of a rectangle of src to (x, y) of dst, both of the
+ *         same format.
+ * @retval As GfxEngine_Fill()
+ */
+HAL_StatusTypeDef GfxEngine_Copy(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect)
+{
+	if (src->format != dst->format)
+	{
+		return HAL_ERROR;
+	}
+	return GfxEngine_Transfer(GFX_MODE_M2M, dst, x, y, src, rect, 0U, 0U);
+}
+
+/**
+ * @brief  Queue a copy of a rectangle of src to (x, y) of dst, converted to
+ *         the format of dst.
+ * @param  dst: output format
+ * @param  src: any format, L8, L4, AL44 and AL88 through the CLUT loaded
+ * @param  color: ARGB8888, its alpha combined with the source one, its RGB
+ *         the color of an A8 or A4 source
+ * @retval As GfxEngine_Fill()
+ */
+HAL_StatusTypeDef GfxEngine_Convert(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t color)
+{
+	if (dst->format >= GFX_OUTPUT_FORMATS)
+	{
+		return HAL_ERROR;
+	}
+	return GfxEngine_Transfer(GFX_MODE_M2M_PFC, dst, x, y, src, rect, GfxEngine_Alpha(color), color);
+}
+
+/**
+ * @brief  Queue a blend of a rectangle of src over (x, y) of dst.
+ * @param  color: as GfxEngine_Convert()
+ * @retval As GfxEngine_Fill()
+ */
+HAL_StatusTypeDef GfxEngine_Blend(const GfxEngine_BufferTypeDef *dst, uint32_t x, uint32_t y,
+		const GfxEngine_BufferTypeDef *src, const GfxEngine_RectTypeDef *rect, uint32_t color)
+{
+	if (dst->format >= GFX_OUTPUT_FORMATS)
+	{
+		return HAL_ERROR;
+	}
+	return GfxEngine_Transfer(GFX_MODE_M2M_BLEND, dst, x, y, src, rect, GfxEngine_Alpha(color), color);
+}
+
+/**
+ * @brief  Queue a load of the CLUT the sources of the commands queued
+ *         after it go through.
+ * @param  clut: entries of format, held until loaded (a marker)
+ * @param  entries: 1 to 256
+ * @param  format: GFX_ARGB8888, GFX_RGB888
+ * @retval As GfxEngine_Fill()
+ */
+HAL_StatusTypeDef GfxEngine_LoadClut(const void *clut, uint32_t entries, uint32_t format)
+{
+	GfxEngine_CommandTypeDef command;
+
+	if ((clut == NULL) || (entries == 0U) || (entries > 256U) || (format > GFX_RGB888))
+	{
+		return HAL_ERROR;
+	}
+	memset(&command, 0, sizeof(command));
+	command.kind = GFX_ENGINE_CLUT;
+	command.fgmar = (uint32_t)(uintptr_t)clut;
+	command.fgpfccr = GFX_L8 | (format << DMA2D_FGPFCCR_CCM_Pos) | ((entries - 1U) << DMA2D_FGPFCCR_CS_Pos);
+	return GfxEngine_Submit(&command);
+}
+
+/**
+ * @brief  Queue a marker: done is called once the commands queued before
+ *         it are over.
+ * @param  done: called from the DMA2D interrupt, or before the call
+ *         returns when they already are
+ * @retval HAL_OK, HAL_BUSY: queue full
+ */
+HAL_StatusTypeDef GfxEngine_Marker(GfxEngine_DoneTypeDef done, void *arg)
+{
+	GfxEngine_CommandTypeDef command;
+
+	memset(&command, 0, sizeof(command));
+	command.kind = GFX_ENGINE_MARKER;
+	command.done = done;
+	command.arg = arg;
+	return GfxEngine_Submit(&command);
+}
+
+/**
+ * @brief  Every command queued over.
+ * @retval 1 if idle, 0 otherwise
+ */
+uint32_t GfxEngine_IsIdle(void)
+{
+	return (gfxEngineRunning == 0U) ? 1U : 0U;
+}
+
+/**
+ * @brief  DMA2D interrupt body, called from DMA2D_IRQHandler().
+ * @retval None
+ */
+ITCM_TEXT void GfxEngine_IRQHandler(void)
+{
+	uint32_t isr = DMA2D->ISR;
+
+	DMA2D->IFCR = isr & GFX_ENGINE_CLEAR_FLAGS;
+	if ((gfxEngineSoftware != 0U) || (gfxEngineRunning == 0U) || ((isr & GFX_ENGINE_DONE_FLAGS) == 0U))
+	{
+		return;
+	}
+	GfxEngine_Retire(isr);
+	GfxEngine_Pump();
+}
+
+void GfxEngine_GetStats(GfxEngine_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = gfxEngineStats;
+	__set_PRIMASK(primask);
+}
+
+void GfxEngine_Dump(GfxEngine_PutCharTypeDef putChar)
+{
+	GfxEngine_StatsTypeDef stats;
+	char line[160];
+
+	GfxEngine_GetStats(&stats);
+	snprintf(line, sizeof(line), "gfx %s cmd=%lu xfer=%lu px=%lu clut=%lu mark=%lu full=%lu err=%lu depth=%lu\r\n",
+		(gfxEngineSoftware != 0U) ? "sw" : "dma2d", (unsigned long)stats.commands, (unsigned long)stats.transfers,
+		(unsigned long)stats.pixels, (unsigned long)stats.cluts, (unsigned long)stats.markers,
+		(unsigned long)stats.full, (unsigned long)stats.errors, (unsigned long)stats.maxDepth);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,342 @@
+/**
+  ******************************************************************************
+  * @file    gfx_soft.c
+  * @brief   Software DMA2D, one pixel at a time through ARGB8888.
+  *
+  *          Addresses are read from the 32-bit address registers: on the
+  *          host the buffers must sit in the low 4 GB, as the statics of an
+  *          image linked -no-pie do.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "gfx_soft.h"
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t GfxSoft_Expand5(uint32_t c)
+{
+	return (c << 3) | (c >> 2);
+}
+
+static uint32_t GfxSoft_Expand6(uint32_t c)
+{
+	return (c << 2) | (c >> 4);
+}
+
+static uint32_t GfxSoft_Expand4(uint32_t c)
+{
+	return (c << 4) | c;
+}
+
+/* Pixel index from base, bits per pixel */
+static uint32_t GfxSoft_Load(const uint8_t *base, uint32_t bits, uint32_t index)
+{
+	const uint8_t *p;
+
+	switch (bits)
+	{
+	case 32U:
+		p = &base[index * 4U];
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	case 24U:
+		p = &base[index * 3U];
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+	case 16U:
+		p = &base[index * 2U];
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+	case 8U:
+		return base[index];
+	default:
+		return (uint32_t)(base[index / 2U] >> ((index & 1U) * 4U)) & 0xFU;
+	}
+}
+
+static void GfxSoft_Store(uint8_t *base, uint32_t bits, uint32_t index, uint32_t value)
+{
+	uint8_t *p;
+
+	switch (bits)
+	{
+	case 32U:
+		p = &base[index * 4U];
+		p[3] = (uint8_t)(value >> 24);
+		p[2] = (uint8_t)(value >> 16);
+		p[1] = (uint8_t)(value >> 8);
+		p[0] = (uint8_t)value;
+		break;
+	case 24U:
+		p = &base[index * 3U];
+		p[2] = (uint8_t)(value >> 16);
+		p[1] = (uint8_t)(value >> 8);
+		p[0] = (uint8_t)value;
+		break;
+	case 16U:
+		p = &base[index * 2U];
+		p[1] = (uint8_t)(value >> 8);
+		p[0] = (uint8_t)value;
+		break;
+	case 8U:
+		base[index] = (uint8_t)value;
+		break;
+	default:
+		p = &base[index / 2U];
+		if ((index & 1U) != 0U)
+		{
+			*p = (uint8_t)((*p & 0x0FU) | ((value & 0xFU) << 4));
+		}
+		else
+		{
+			*p = (uint8_t)((*p & 0xF0U) | (value & 0xFU));
+		}
+		break;
+	}
+}
+
+/* Layer pixel as ARGB8888 after the alpha mode of its PFC control register */
+static uint32_t GfxSoft_Layer(const uint8_t *base, uint32_t index, uint32_t pfccr, const volatile uint32_t *clut,
+		uint32_t color)
+{
+	uint32_t format = pfccr & DMA2D_FGPFCCR_CM;
+	uint32_t argb = GfxSoft_ToArgb(GfxSoft_Load(base, GfxSoft_Bits(format), index), format, clut, color);
+	uint32_t alpha = (pfccr & DMA2D_FGPFCCR_ALPHA) >> DMA2D_FGPFCCR_ALPHA_Pos;
+
+	switch ((pfccr & DMA2D_FGPFCCR_AM) >> DMA2D_FGPFCCR_AM_Pos)
+	{
+	case GFX_ALPHA_REPLACE:
+		return (alpha << 24) | (argb & 0x00FFFFFFU);
+	case GFX_ALPHA_COMBINE:
+		return ((((argb >> 24) * alpha) / 255U) << 24) | (argb & 0x00FFFFFFU);
+	default:
+		return argb;
+	}
+}
+
+/* CLUT load started by the START bit of a PFC control register */
+static void GfxSoft_LoadClut(volatile uint32_t *clut, uint32_t address, volatile uint32_t *pfccr)
+{
+	const uint8_t *source = (const uint8_t *)(uintptr_t)address;
+	uint32_t entries = ((*pfccr & DMA2D_FGPFCCR_CS) >> DMA2D_FGPFCCR_CS_Pos) + 1U;
+
+	for (uint32_t i = 0; i < entries; i++)
+	{
+		if ((*pfccr & DMA2D_FGPFCCR_CCM) != 0U)
+		{
+			clut[i] = 0xFF000000U | GfxSoft_Load(source, 24U, i);
+		}
+		else
+		{
+			clut[i] = GfxSoft_Load(source, 32U, i);
+		}
+	}
+	*pfccr &= ~DMA2D_FGPFCCR_START;
+}
+
+static uint32_t GfxSoft_IsConfigured(const DMA2D_TypeDef *dma2d, uint32_t mode)
+{
+	uint32_t output = dma2d->OPFCCR & DMA2D_OPFCCR_CM;
+
+	if (((dma2d->NLR & DMA2D_NLR_NL) == 0U) || ((dma2d->NLR & DMA2D_NLR_PL) == 0U))
+	{
+		return 0U;
+	}
+	if ((mode != GFX_MODE_R2M) && ((dma2d->FGPFCCR & DMA2D_FGPFCCR_CM) >= GFX_FORMATS))
+	{
+		return 0U;
+	}
+	if ((mode == GFX_MODE_M2M_BLEND) && ((dma2d->BGPFCCR & DMA2D_BGPFCCR_CM) >= GFX_FORMATS))
+	{
+		return 0U;
+	}
+	return ((mode == GFX_MODE_M2M) || (output < GFX_OUTPUT_FORMATS)) ? 1U : 0U;
+}
+
+static void GfxSoft_Transfer(DMA2D_TypeDef *dma2d, uint32_t mode)
+{
+	uint32_t width = (dma2d->NLR & DMA2D_NLR_PL) >> DMA2D_NLR_PL_Pos;
+	uint32_t lines = dma2d->NLR & DMA2D_NLR_NL;
+	uint32_t output = dma2d->OPFCCR & DMA2D_OPFCCR_CM;
+	uint32_t fgFormat = dma2d->FGPFCCR & DMA2D_FGPFCCR_CM;
+	uint32_t fgBits = GfxSoft_Bits(fgFormat);
+	uint32_t outBits = (mode == GFX_MODE_M2M) ? fgBits : GfxSoft_Bits(output);
+	const uint8_t *fg = (const uint8_t *)(uintptr_t)dma2d->FGMAR;
+	const uint8_t *bg = (const uint8_t *)(uintptr_t)dma2d->BGMAR;
+	uint8_t *out = (uint8_t *)(uintptr_t)dma2d->OMAR;
+	uint32_t fgPitch = width + (dma2d->FGOR & DMA2D_FGOR_LO);
+	uint32_t bgPitch = width + (dma2d->BGOR & DMA2D_BGOR_LO);
+	uint32_t outPitch = width + (dma2d->OOR & DMA2D_OOR_LO);
+	uint32_t fill = dma2d->OCOLR;
+
+	if (outBits < 32U)
+	{
+		fill &= (1U << outBits) - 1U;
+	}
+	for (uint32_t y = 0; y < lines; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t fgIndex = (y * fgPitch) + x;
+			uint32_t outIndex = (y * outPitch) + x;
+			uint32_t pixel;
+
+			switch (mode)
+			{
+			case GFX_MODE_R2M:
+				pixel = fill;
+				break;
+			case GFX_MODE_M2M:
+				pixel = GfxSoft_Load(fg, fgBits, fgIndex);
+				break;
+			case GFX_MODE_M2M_PFC:
+				pixel = GfxSoft_FromArgb(GfxSoft_Layer(fg, fgIndex, dma2d->FGPFCCR, dma2d->FGCLUT, dma2d->FGCOLR),
+					output);
+				break;
+			default:
+				pixel = GfxSoft_FromArgb(GfxSoft_Blend(
+					GfxSoft_Layer(fg, fgIndex, dma2d->FGPFCCR, dma2d->FGCLUT, dma2d->FGCOLR),
+					GfxSoft_Layer(bg, (y * bgPitch) + x, dma2d->BGPFCCR, dma2d->BGCLUT, dma2d->BGCOLR)), output);
+				break;
+			}
+			GfxSoft_Store(out, outBits, outIndex, pixel);
+		}
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Size of a pixel.
+ * @param  format: GFX_ARGB8888 .. GFX_A4
+ * @retval Bits per pixel, 0 for an unknown format
+ */
+uint32_t GfxSoft_Bits(uint32_t format)
+{
+	static const uint8_t bits[GFX_FORMATS] = { 32U, 24U, 16U, 16U, 16U, 8U, 8U, 16U, 4U, 8U, 4U };
+
+	return (format < GFX_FORMATS) ? bits[format] : 0U;
+}
+
+/**
+ * @brief  Expand a pixel to ARGB8888, as the DMA2D PFC does before the
+ *         alpha mode.
+ * @param  pixel: pixel in format, right aligned
+ * @param  clut: ARGB8888 CLUT of L8, L4, AL44 and AL88
+ * @param  color: layer color register, RGB of A8 and A4
+ * @retval ARGB8888 pixel
+ */
+uint32_t GfxSoft_ToArgb(uint32_t pixel, uint32_t format, const volatile uint32_t *clut, uint32_t color)
+{
+	switch (format)
+	{
+	case GFX_ARGB8888:
+		return pixel;
+	case GFX_RGB888:
+		return 0xFF000000U | pixel;
+	case GFX_RGB565:
+		return 0xFF000000U | (GfxSoft_Expand5(pixel >> 11) << 16) | (GfxSoft_Expand6((pixel >> 5) & 0x3FU) << 8)
+			| GfxSoft_Expand5(pixel & 0x1FU);
+	case GFX_ARGB1555:
+		return (((pixel & 0x8000U) != 0U) ? 0xFF000000U : 0U) | (GfxSoft_Expand5((pixel >> 10) & 0x1FU) << 16)
+			| (GfxSoft_Expand5((pixel >> 5) & 0x1FU) << 8) | GfxSoft_Expand5(pixel & 0x1FU);
+	case GFX_ARGB4444:
+		return (GfxSoft_Expand4(pixel >> 12) << 24) | (GfxSoft_Expand4((pixel >> 8) & 0xFU) << 16)
+			| (GfxSoft_Expand4((pixel >> 4) & 0xFU) << 8) | GfxSoft_Expand4(pixel & 0xFU);
+	case GFX_L8:
+	case GFX_L4:
+		return clut[pixel];
+	case GFX_AL44:
+		return (GfxSoft_Expand4(pixel >> 4) << 24) | (clut[pixel & 0xFU] & 0x00FFFFFFU);
+	case GFX_AL88:
+		return ((pixel >> 8) << 24) | (clut[pixel & 0xFFU] & 0x00FFFFFFU);
+	case GFX_A8:
+		return (pixel << 24) | (color & 0x00FFFFFFU);
+	default:
+		return (GfxSoft_Expand4(pixel) << 24) | (color & 0x00FFFFFFU);
+	}
+}
+
+/**
+ * @brief  Convert an ARGB8888 pixel to an output format, truncating.
+ * @param  format: GFX_ARGB8888 .. GFX_ARGB4444
+ * @retval Pixel in format, right aligned
+ */
+uint32_t GfxSoft_FromArgb(uint32_t argb, uint32_t format)
+{
+	uint32_t a = argb >> 24;
+	uint32_t r = (argb >> 16) & 0xFFU;
+	uint32_t g = (argb >> 8) & 0xFFU;
+	uint32_t b = argb & 0xFFU;
+
+	switch (format)
+	{
+	case GFX_ARGB8888:
+		return argb;
+	case GFX_RGB888:
+		return argb & 0x00FFFFFFU;
+	case GFX_RGB565:
+		return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+	case GFX_ARGB1555:
+		return ((a >> 7) << 15) | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+	default:
+		return ((a >> 4) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+	}
+}
+
+/**
+ * @brief  Blend two ARGB8888 pixels as the DMA2D blender does.
+ * @retval ARGB8888 pixel, 0 when both are transparent
+ */
+uint32_t GfxSoft_Blend(uint32_t foreground, uint32_t background)
+{
+	uint32_t alphaFg = foreground >> 24;
+	uint32_t alphaBg = background >> 24;
+	uint32_t alphaMult = (alphaFg * alphaBg) / 255U;
+	uint32_t alphaOut = alphaFg + alphaBg - alphaMult;
+	uint32_t argb = alphaOut << 24;
+
+	if (alphaOut == 0U)
+	{
+		return 0U;
+	}
+	for (uint32_t shift = 0; shift < 24U; shift += 8U)
+	{
+		uint32_t fg = (foreground >> shift) & 0xFFU;
+		uint32_t bg = (background >> shift) & 0xFFU;
+
+		argb |= (((fg * alphaFg) + (bg * alphaBg) - (bg * alphaMult)) / alphaOut) << shift;
+	}
+	return argb;
+}
+
+/**
+ * @brief  Run what is started in a DMA2D register block: the foreground,
+ *         then the background CLUT loads, then the transfer. Flags and
+ *         START bits end as the hardware leaves them, interrupts aside.
+ * @param  dma2d: DMA2D or a shadow register block
+ * @retval None
+ */
+void GfxSoft_Execute(DMA2D_TypeDef *dma2d)
+{
+	uint32_t mode = (dma2d->CR & DMA2D_CR_MODE) >> DMA2D_CR_MODE_Pos;
+
+	if ((dma2d->FGPFCCR & DMA2D_FGPFCCR_START) != 0U)
+	{
+		GfxSoft_LoadClut(dma2d->FGCLUT, dma2d->FGCMAR, &dma2d->FGPFCCR);
+		dma2d->ISR |= DMA2D_ISR_CTCIF;
+	}
+	if ((dma2d->BGPFCCR & DMA2D_BGPFCCR_START) != 0U)
+	{
+		GfxSoft_LoadClut(dma2d->BGCLUT, dma2d->BGCMAR, &dma2d->BGPFCCR);
+		dma2d->ISR |= DMA2D_ISR_CTCIF;
+	}
+	if ((dma2d->CR & DMA2D_CR_START) == 0U)
+	{
+		return;
+	}
+	dma2d->CR &= ~DMA2D_CR_START;
+	if (GfxSoft_IsConfigured(dma2d, mode) == 0U)
+	{
+		dma2d->ISR |= DMA2D_ISR_CEIF;
+		return;
+	}
+	GfxSoft_Transfer(dma2d, mode);
+	dma2d->ISR |= DMA2D_ISR_TCIF;
+}
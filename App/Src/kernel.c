@@ -0,0 +1,536 @@
+/**
+  ******************************************************************************
+  * @file    kernel.c
+  * @brief   Small priority-based preemptive task kernel: scheduler core,
+  *          ready queue and timeout list.
+  *
+  *          The running task is the head of the ready ring of its priority;
+  *          time slicing and Kernel_Yield() rotate the ring. The core only
+  *          picks kernelNext and asks the port for the switch, on the target
+  *          it happens in PendSV once the critical section is left.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdio.h>
+
+#include "stm32f7xx.h"
+
+#include "kernel.h"
+#include "kernel_port.h"
+#include "mem_section.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+Kernel_TaskTypeDef *volatile kernelCurrent DTCM_BSS;
+Kernel_TaskTypeDef *volatile kernelNext DTCM_BSS;
+
+/* Private variables ---------------------------------------------------------*/
+static Kernel_TaskTypeDef *kernelReady[KERNEL_PRIORITIES] DTCM_BSS;
+static uint32_t kernelReadyMask DTCM_BSS;
+static Kernel_TaskTypeDef *kernelTimeouts DTCM_BSS;
+static Kernel_TaskTypeDef *kernelTasks;
+static uint32_t kernelRunning;
+static uint32_t kernelSliceTick;
+
+static Kernel_TaskTypeDef kernelIdleTask;
+static uint32_t kernelIdleStack[KERNEL_IDLE_STACK_WORDS] DTCM_BSS __attribute__((aligned(8)));
+
+/* Private functions ---------------------------------------------------------*/
+static inline int Kernel_IsExpired(uint32_t now, uint32_t tick)
+{
+	return (int32_t)(now - tick) >= 0;
+}
+
+/**
+ * @brief  Append a task to the ready ring of its priority.
+ * @note   Interrupts must be disabled.
+ * @param  task: task to make ready
+ * @retval None
+ */
+static void Kernel_ReadyInsert(Kernel_TaskTypeDef *task)
+{
+	Kernel_TaskTypeDef *head = kernelReady[task->priority];
+
+	if (head == NULL)
+	{
+		task->next = task;
+		task->prev = task;
+		kernelReady[task->priority] = task;
+		kernelReadyMask |= 1UL << task->priority;
+	}
+	else
+	{
+		task->next = head;
+		task->prev = head->prev;
+		head->prev->next = task;
+		head->prev = task;
+	}
+	task->state = KERNEL_TASK_READY;
+}
+
+/**
+ * @brief  Unlink a task from the ready ring of its priority.
+ * @note   Interrupts must be disabled.
+ * @param  task: ready task
+ * @retval None
+ */
+static void Kernel_ReadyRemove(Kernel_TaskTypeDef *task)
+{
+	if (task->next == task)
+	{
+		kernelReady[task->priority] = NULL;
+		kernelReadyMask &= ~(1UL << task->priority);
+	}
+	else
+	{
+		task->prev->next = task->next;
+		task->next->prev = task->prev;
+		if (kernelReady[task->priority] == task)
+		{
+			kernelReady[task->priority] = task->next;
+		}
+	}
+}
+
+/**
+ * @brief  Insert a task in the timeout list, sorted by wake-up tick.
+ * @note   Interrupts must be disabled. Equal wake-up ticks keep FIFO order.
+ * @param  task: task to wake up
+ * @param  ticks: delay from now
+ * @retval None
+ */
+static void Kernel_TimeoutInsert(Kernel_TaskTypeDef *task, uint32_t ticks)
+{
+	Kernel_TaskTypeDef **link = &kernelTimeouts;
+
+	task->wakeTick = KernelPort_GetTick() + ticks;
+	while ((*link != NULL) && ((int32_t)((*link)->wakeTick - task->wakeTick) <= 0))
+	{
+		link = &(*link)->timeoutNext;
+	}
+	task->timeoutNext = *link;
+	*link = task;
+}
+
+/**
+ * @brief  Remove a task from the timeout list, if it is on it.
+ * @note   Interrupts must be disabled.
+ * @param  task: task to remove
+ * @retval None
+ */
+static void Kernel_TimeoutRemove(Kernel_TaskTypeDef *task)
+{
+	for (Kernel_TaskTypeDef **link = &kernelTimeouts; *link != NULL; link = &(*link)->timeoutNext)
+	{
+		if (*link == task)
+		{
+			*link = task->timeoutNext;
+			task->timeoutNext = NULL;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief  Select the highest priority ready task and request the switch.
+ * @note   Interrupts must be disabled. kernelNext is always refreshed so a
+ *         switch already pending in PendSV goes to the latest choice.
+ * @retval None
+ */
+static void Kernel_Schedule(void)
+{
+	if (kernelRunning == 0U)
+	{
+		return;
+	}
+
+	/* The idle task is always ready: the mask is never empty */
+	kernelNext = kernelReady[31U - __CLZ(kernelReadyMask)];
+	if (kernelNext != kernelCurrent)
+	{
+		KernelPort_Switch();
+	}
+}
+
+/**
+ * @brief  Return address of every task entry function.
+ * @retval None
+ */
+static void Kernel_TaskExit(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	Kernel_ReadyRemove(kernelCurrent);
+	kernelCurrent->state = KERNEL_TASK_DONE;
+	Kernel_Schedule();
+	__set_PRIMASK(primask);
+
+	for (;;)
+	{
+	}
+}
+
+/**
+ * @brief  Idle task: lowest priority, always ready.
+ * @param  arg: unused
+ * @retval None
+ */
+static void Kernel_IdleTask(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		Kernel_IdleHook(Kernel_TicksToNextTimeout());
+		/* Catch up with ticks accounted during a tickless sleep */
+		Kernel_Tick();
+	}
+}
+
+/**
+ * @brief  Work done by the idle task, may sleep up to the next timeout.
+ * @note   Weak default, the application overrides it to run its own
+ *         background work and tickless idle (see main.c).
+ * @param  ticks: ticks to the next task timeout, KERNEL_WAIT_FOREVER if none
+ * @retval None
+ */
+__attribute__((weak)) void Kernel_IdleHook(uint32_t ticks)
+{
+	(void)ticks;
+
+	__DSB();
+	__WFI();
+}
+
+/**
+ * @brief  Reset the kernel and create the idle task.
+ * @retval None
+ */
+void Kernel_Init(void)
+{
+	for (uint32_t i = 0; i < KERNEL_PRIORITIES; i++)
+	{
+		kernelReady[i] = NULL;
+	}
+	kernelReadyMask = 0;
+	kernelTimeouts = NULL;
+	kernelTasks = NULL;
+	kernelCurrent = NULL;
+	kernelNext = NULL;
+	kernelRunning = 0;
+
+	Kernel_TaskCreate(&kernelIdleTask, "idle", Kernel_IdleTask, NULL, KERNEL_IDLE_PRIORITY,
+		kernelIdleStack, KERNEL_IDLE_STACK_WORDS);
+}
+
+/**
+ * @brief  Create a task, ready to run.
+ * @note   May be called before Kernel_Start() or from a running task; a
+ *         task of higher priority than the caller preempts it at once.
+ * @param  task: task control block storage
+ * @param  name: task name, for Kernel_Dump()
+ * @param  entry: task function, the task ends when it returns
+ * @param  arg: argument of entry
+ * @param  priority: 1 to KERNEL_PRIORITIES - 1, higher runs first
+ * @param  stack: stack storage, 8-byte aligned
+ * @param  stackWords: stack size in 32-bit words
+ * @retval None
+ */
+void Kernel_TaskCreate(Kernel_TaskTypeDef *task, const char *name, Kernel_EntryTypeDef entry, void *arg,
+		uint32_t priority, uint32_t *stack, uint32_t stackWords)
+{
+	uint32_t primask;
+
+	assert_param(priority < KERNEL_PRIORITIES);
+	assert_param(((uintptr_t)stack & 7U) == 0U);
+
+	for (uint32_t i = 0; i < stackWords; i++)
+	{
+		stack[i] = KERNEL_STACK_FILL;
+	}
+
+	task->timeoutNext = NULL;
+	task->priority = priority;
+	task->notify = 0;
+	task->stack = stack;
+	task->stackWords = stackWords;
+	task->entry = entry;
+	task->arg = arg;
+	task->name = name;
+	task->switches = 0;
+	KernelPort_StackInit(task, Kernel_TaskExit);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	task->link = kernelTasks;
+	kernelTasks = task;
+	Kernel_ReadyInsert(task);
+	Kernel_Schedule();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Switch to the highest priority task.
+ * @note   Does not return on the target. The host port returns once a task
+ *         calls KernelPort_HostStop().
+ * @retval None
+ */
+void Kernel_Start(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	kernelCurrent = kernelReady[31U - __CLZ(kernelReadyMask)];
+	kernelNext = kernelCurrent;
+	kernelCurrent->switches++;
+	kernelSliceTick = KernelPort_GetTick();
+	kernelRunning = 1;
+
+	KernelPort_Start();
+
+	kernelRunning = 0;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Make kernelNext the running task, called by the port.
+ * @note   Interrupts are disabled.
+ * @retval None
+ */
+ITCM_TEXT void Kernel_SwitchContext(void)
+{
+	kernelCurrent = kernelNext;
+	kernelCurrent->switches++;
+}
+
+/**
+ * @brief  Running task.
+ * @retval task, NULL before Kernel_Start()
+ */
+Kernel_TaskTypeDef *Kernel_GetCurrent(void)
+{
+	return kernelCurrent;
+}
+
+/**
+ * @brief  Idle task, created by Kernel_Init().
+ * @retval task
+ */
+Kernel_TaskTypeDef *Kernel_GetIdleTask(void)
+{
+	return &kernelIdleTask;
+}
+
+/**
+ * @brief  Kernel time, the port tick (Timebase_GetTick() on the target).
+ * @retval ticks
+ */
+uint32_t Kernel_GetTick(void)
+{
+	return KernelPort_GetTick();
+}
+
+/**
+ * @brief  Let the other ready tasks of the same priority run.
+ * @retval None
+ */
+void Kernel_Yield(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	kernelReady[kernelCurrent->priority] = kernelCurrent->next;
+	Kernel_Schedule();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Block the running task for a number of ticks.
+ * @param  ticks: delay, 0 only yields
+ * @retval None
+ */
+void Kernel_Delay(uint32_t ticks)
+{
+	uint32_t primask;
+	Kernel_TaskTypeDef *task;
+
+	if (ticks == 0U)
+	{
+		Kernel_Yield();
+		return;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	task = kernelCurrent;
+	Kernel_ReadyRemove(task);
+	task->state = KERNEL_TASK_DELAYED;
+	Kernel_TimeoutInsert(task, ticks);
+	Kernel_Schedule();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Wait for notifications sent to the running task.
+ * @param  timeout: ticks to wait at most, 0 to poll, KERNEL_WAIT_FOREVER
+ * @retval notifications received since the last call, 0 on timeout
+ */
+uint32_t Kernel_NotifyWait(uint32_t timeout)
+{
+	uint32_t primask = __get_PRIMASK();
+	Kernel_TaskTypeDef *task;
+	uint32_t count;
+
+	__disable_irq();
+	task = kernelCurrent;
+	if ((task->notify == 0U) && (timeout != 0U))
+	{
+		Kernel_ReadyRemove(task);
+		task->state = KERNEL_TASK_WAITING;
+		if (timeout != KERNEL_WAIT_FOREVER)
+		{
+			Kernel_TimeoutInsert(task, timeout);
+		}
+		Kernel_Schedule();
+
+		/* The switch happens here on the target, when PendSV gets unmasked */
+		__set_PRIMASK(primask);
+		__disable_irq();
+	}
+	count = task->notify;
+	task->notify = 0;
+	__set_PRIMASK(primask);
+
+	return count;
+}
+
+/**
+ * @brief  Send a notification to a task, waking it if it waits.
+ * @note   Callable from interrupts.
+ * @param  task: task to notify
+ * @retval None
+ */
+void Kernel_Notify(Kernel_TaskTypeDef *task)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	task->notify++;
+	if (task->state == KERNEL_TASK_WAITING)
+	{
+		Kernel_TimeoutRemove(task);
+		Kernel_ReadyInsert(task);
+		Kernel_Schedule();
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Wake the tasks whose timeout expired and time-slice the running
+ *         priority, called from SysTick_Handler() and the idle task.
+ * @note   Callable from interrupts. The running task goes to the back of
+ *         its ready ring once per tick.
+ * @retval None
+ */
+ITCM_TEXT void Kernel_Tick(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t now;
+	Kernel_TaskTypeDef *task;
+
+	if (kernelRunning == 0U)
+	{
+		return;
+	}
+
+	__disable_irq();
+	now = KernelPort_GetTick();
+	while ((kernelTimeouts != NULL) && Kernel_IsExpired(now, kernelTimeouts->wakeTick))
+	{
+		task = kernelTimeouts;
+		kernelTimeouts = task->timeoutNext;
+		task->timeoutNext = NULL;
+		Kernel_ReadyInsert(task);
+	}
+
+	task = kernelCurrent;
+	if ((now != kernelSliceTick) && (task->state == KERNEL_TASK_READY)
+		&& (kernelReady[task->priority] == task))
+	{
+		kernelReady[task->priority] = task->next;
+	}
+	kernelSliceTick = now;
+
+	Kernel_Schedule();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Ticks until the first task timeout.
+ * @retval ticks, 0 if already due, KERNEL_WAIT_FOREVER if none
+ */
+uint32_t Kernel_TicksToNextTimeout(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t ticks = KERNEL_WAIT_FOREVER;
+	uint32_t now;
+
+	__disable_irq();
+	if (kernelTimeouts != NULL)
+	{
+		now = KernelPort_GetTick();
+		ticks = Kernel_IsExpired(now, kernelTimeouts->wakeTick) ? 0U : (kernelTimeouts->wakeTick - now);
+	}
+	__set_PRIMASK(primask);
+
+	return ticks;
+}
+
+/**
+ * @brief  Stack watermark: bytes never written since the task was created.
+ * @param  task: task to inspect
+ * @retval unused stack bytes, 0 when the stack was exhausted
+ */
+uint32_t Kernel_GetStackFree(const Kernel_TaskTypeDef *task)
+{
+	uint32_t words = 0;
+
+	while ((words < task->stackWords) && (task->stack[words] == KERNEL_STACK_FILL))
+	{
+		words++;
+	}
+
+	return words * sizeof(uint32_t);
+}
+
+/**
+ * @brief  Print one line per task: priority, state, switches, stack use.
+ * @param  putChar: character output, e.g. blocking USART1 transmit
+ * @retval None
+ */
+void Kernel_Dump(Kernel_PutCharTypeDef putChar)
+{
+	static const char stateName[] = { 'R', 'D', 'W', 'X' };
+	char line[80];
+
+	for (const Kernel_TaskTypeDef *task = kernelTasks; task != NULL; task = task->link)
+	{
+		snprintf(line, sizeof(line), "%-12s pri=%lu %c sw=%lu stack=%lu/%lu\r\n",
+			task->name, (unsigned long)task->priority, stateName[task->state], (unsigned long)task->switches,
+			(unsigned long)(task->stackWords * sizeof(uint32_t) - Kernel_GetStackFree(task)),
+			(unsigned long)(task->stackWords * sizeof(uint32_t)));
+
+		for (const char *p = line; *p != '\0'; p++)
+		{
+			putChar(*p);
+		}
+	}
+}
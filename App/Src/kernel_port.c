@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * @file    kernel_port.c
+  * @brief   Cortex-M7 port of the kernel: PendSV context switch with lazy
+  *          FPU stacking, SVC start of the first task.
+  *
+  *          Tasks run in thread mode on the PSP, interrupts on the MSP.
+  *          A task stack holds, from its saved sp upwards:
+  *            r4-r11, EXC_RETURN              saved by PendSV_Handler
+  *            [s16-s31]                       only if the task used the FPU
+  *            r0-r3, r12, lr, pc, xPSR        hardware exception frame
+  *            [s0-s15, FPSCR, reserved]       only if the task used the FPU
+  *          With FPCCR.ASPEN/LSPEN set the hardware only reserves room for
+  *          s0-s15 on exception entry and writes them when the FPU is next
+  *          used: the VSTM of PendSV_Handler for a switched-out FPU task.
+  *          EXC_RETURN bit 4 tells whether the frame is the extended one.
+  *
+  *          Not part of the host build: App/Host/Src/kernel_port_host.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx.h"
+
+#include "kernel.h"
+#include "kernel_port.h"
+#include "mem_section.h"
+#include "timebase.h"
+
+/* Private define ------------------------------------------------------------*/
+#define KERNEL_PORT_PENDSV_PRIORITY     15U             /* lowest, same as SysTick */
+#define KERNEL_PORT_INITIAL_XPSR        0x01000000UL    /* Thumb state */
+#define KERNEL_PORT_EXC_RETURN          0xFFFFFFFDUL    /* thread mode, PSP, basic frame */
+
+/**
+ * @brief  Build the initial stack frame of a task, as PendSV_Handler would
+ *         have saved it: the first switch-in "returns" to the entry point.
+ * @param  task: task with stack, entry and arg set
+ * @param  exit: return address of the entry function
+ * @retval None
+ */
+void KernelPort_StackInit(Kernel_TaskTypeDef *task, void (*exit)(void))
+{
+	/* AAPCS: 8-byte aligned stack at the exception frame */
+	uint32_t *sp = (uint32_t *)((uintptr_t)(task->stack + task->stackWords) & ~(uintptr_t)7U);
+
+	*--sp = KERNEL_PORT_INITIAL_XPSR;
+	*--sp = (uint32_t)task->entry & ~1UL;           /* pc, the Thumb bit comes from xPSR */
+	*--sp = (uint32_t)exit;                         /* lr */
+	*--sp = 0;                                      /* r12 */
+	*--sp = 0;                                      /* r3 */
+	*--sp = 0;                                      /* r2 */
+	*--sp = 0;                                      /* r1 */
+	*--sp = (uint32_t)task->arg;                    /* r0 */
+
+	*--sp = KERNEL_PORT_EXC_RETURN;
+	for (uint32_t i = 0; i < 8U; i++)
+	{
+		*--sp = 0;                                  /* r11 to r4 */
+	}
+
+	task->sp = sp;
+}
+
+/**
+ * @brief  Start kernelCurrent through SVC 0.
+ * @note   The main stack is reset to its top: main() never gets control back
+ *         and the whole DTCM stack is left to the interrupts.
+ * @retval None
+ */
+void KernelPort_Start(void)
+{
+	NVIC_SetPriority(PendSV_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), KERNEL_PORT_PENDSV_PRIORITY, 0));
+
+	/* Lazy stacking: reserve the FP frame, write it only when needed */
+	FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+
+	__asm volatile (
+		"	msr msp, %0			\n"
+		"	cpsie i				\n"
+		"	dsb					\n"
+		"	isb					\n"
+		"	svc 0				\n"
+		"	b .					\n"
+		: : "r" (*(volatile uint32_t *)SCB->VTOR) : "memory");
+}
+
+/**
+ * @brief  Request a switch to kernelNext, taken in PendSV once no other
+ *         interrupt is active and interrupts are enabled.
+ * @retval None
+ */
+ITCM_TEXT void KernelPort_Switch(void)
+{
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	__DSB();
+}
+
+/**
+ * @brief  Kernel time source.
+ * @retval milliseconds since Timebase_Init()
+ */
+uint32_t KernelPort_GetTick(void)
+{
+	return Timebase_GetTick();
+}
+
+/**
+ * @brief  This function handles System service call via SWI instruction:
+ *         SVC 0 restores the first task, never returns to main().
+ */
+__attribute__((naked)) void SVC_Handler(void)
+{
+	__asm volatile (
+		"	movw r3, #:lower16:kernelCurrent	\n"
+		"	movt r3, #:upper16:kernelCurrent	\n"
+		"	ldr r1, [r3]						\n"
+		"	ldr r0, [r1]						\n" /* kernelCurrent->sp */
+		"	ldmia r0!, {r4-r11, lr}				\n"
+		"	msr psp, r0							\n"
+		"	isb									\n"
+		"	bx lr								\n");
+}
+
+/**
+ * @brief  This function handles Pendable request for system service:
+ *         save the running task, switch to kernelNext.
+ */
+ITCM_TEXT __attribute__((naked)) void PendSV_Handler(void)
+{
+	__asm volatile (
+		"	mrs r0, psp							\n"
+		"	isb									\n"
+		"	movw r3, #:lower16:kernelCurrent	\n"
+		"	movt r3, #:upper16:kernelCurrent	\n"
+		"	ldr r2, [r3]						\n"
+		"	tst lr, #0x10						\n" /* extended frame: the task used the FPU */
+		"	it eq								\n"
+		"	vstmdbeq r0!, {s16-s31}				\n"
+		"	stmdb r0!, {r4-r11, lr}				\n"
+		"	str r0, [r2]						\n" /* kernelCurrent->sp */
+		"	cpsid i								\n"
+		"	bl Kernel_SwitchContext				\n"
+		"	cpsie i								\n"
+		"	movw r3, #:lower16:kernelCurrent	\n"
+		"	movt r3, #:upper16:kernelCurrent	\n"
+		"	ldr r1, [r3]						\n"
+		"	ldr r0, [r1]						\n"
+		"	ldmia r0!, {r4-r11, lr}				\n"
+		"	tst lr, #0x10						\n"
+		"	it eq								\n"
+		"	vldmiaeq r0!, {s16-s31}				\n"
+		"	msr psp, r0							\n"
+		"	isb									\n"
+		"	bx lr								\n");
+}
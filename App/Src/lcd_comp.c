@@ -0,0 +1,449 @@
+/**
+  ******************************************************************************
+  * @file    lcd_comp.c
+  * @brief   Partial-refresh compositor of the two LTDC layers.
+  *
+  *          A damaged rectangle is redrawn from the topmost opaque surface
+  *          covering all of it, or from the background color: the surfaces
+  *          under it are not read. The redraw of a rectangle does not depend
+  *          on what the buffer held, so rectangles of the damage may overlap.
+  *
+  *          The sprite window is written with the HAL _NoReload calls and
+  *          reloaded in the vertical blanking, interrupts masked so the line
+  *          event of lcd_fb does not run between them: both go to the
+  *          shadow registers of the same refresh.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "lcd_comp.h"
+#include "lcd_fb.h"
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+	const GfxEngine_BufferTypeDef *buffer;  /* NULL: not drawn into yet */
+	Damage_TypeDef damage;              /* since the buffer was drawn */
+} LcdComp_SlotTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static LTDC_HandleTypeDef *lcdCompHandle;
+static uint32_t lcdCompWidth;
+static uint32_t lcdCompHeight;
+static uint32_t lcdCompBackground;
+static LcdComp_SurfaceTypeDef lcdCompSurfaces[LCD_COMP_MAX_SURFACES];
+static uint8_t lcdCompSet[LCD_COMP_MAX_SURFACES];
+static LcdComp_SlotTypeDef lcdCompSlots[LCD_FB_MAX_BUFFERS];
+static uint32_t lcdCompDirty;               /* damage since the last frame */
+static GfxEngine_BufferTypeDef lcdCompSprite;
+static LcdComp_StatsTypeDef lcdCompStats;
+
+/* Private functions ---------------------------------------------------------*/
+/* Damage of a buffer; all of it the first time */
+static Damage_TypeDef *LcdComp_Damage(const GfxEngine_BufferTypeDef *buffer)
+{
+	for (uint32_t i = 0; i < LCD_FB_MAX_BUFFERS; i++)
+	{
+		if (lcdCompSlots[i].buffer == buffer)
+		{
+			return &lcdCompSlots[i].damage;
+		}
+	}
+	for (uint32_t i = 0; i < LCD_FB_MAX_BUFFERS; i++)
+	{
+		if (lcdCompSlots[i].buffer == NULL)
+		{
+			lcdCompSlots[i].buffer = buffer;
+			Damage_Init(&lcdCompSlots[i].damage, lcdCompWidth, lcdCompHeight, LCD_COMP_TILE);
+			Damage_AddAll(&lcdCompSlots[i].damage);
+			return &lcdCompSlots[i].damage;
+		}
+	}
+	return NULL;
+}
+
+static void LcdComp_Damaged(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	Damage_RectTypeDef rect = { x, y, width, height };
+
+	for (uint32_t i = 0; i < LCD_FB_MAX_BUFFERS; i++)
+	{
+		if (lcdCompSlots[i].buffer != NULL)
+		{
+			Damage_Add(&lcdCompSlots[i].damage, &rect);
+		}
+	}
+	lcdCompDirty = 1U;
+}
+
+static void LcdComp_DamageSurface(uint32_t id)
+{
+	if (lcdCompSet[id] != 0U)
+	{
+		LcdComp_Damaged(lcdCompSurfaces[id].x, lcdCompSurfaces[id].y, lcdCompSurfaces[id].image.width,
+			lcdCompSurfaces[id].image.height);
+	}
+}
+
+/* 1 to queue the command again, the DMA2D queue full */
+static uint32_t LcdComp_Retry(HAL_StatusTypeDef status)
+{
+	if (status == HAL_BUSY)
+	{
+		lcdCompStats.stalls++;
+		return 1U;
+	}
+	if (status != HAL_OK)
+	{
+		lcdCompStats.errors++;
+	}
+	return 0U;
+}
+
+/* Part of surface id in rect, in the coordinates of the surface; 0 if none */
+static uint32_t LcdComp_Clip(uint32_t id, const Damage_RectTypeDef *rect, GfxEngine_RectTypeDef *part)
+{
+	const LcdComp_SurfaceTypeDef *s = &lcdCompSurfaces[id];
+	uint32_t x0 = (s->x > rect->x) ? s->x : rect->x;
+	uint32_t y0 = (s->y > rect->y) ? s->y : rect->y;
+	uint32_t x1 = (s->x + s->image.width < rect->x + rect->width) ? (s->x + s->image.width) : (rect->x + rect->width);
+	uint32_t y1 = (s->y + s->image.height < rect->y + rect->height) ? (s->y + s->image.height)
+		: (rect->y + rect->height);
+
+	if ((lcdCompSet[id] == 0U) || (x1 <= x0) || (y1 <= y0))
+	{
+		return 0U;
+	}
+	part->x = x0 - s->x;
+	part->y = y0 - s->y;
+	part->width = x1 - x0;
+	part->height = y1 - y0;
+	return 1U;
+}
+
+static void LcdComp_Redraw(const GfxEngine_BufferTypeDef *back, const Damage_RectTypeDef *rect)
+{
+	GfxEngine_RectTypeDef part;
+	uint32_t first = LCD_COMP_MAX_SURFACES;
+
+	for (uint32_t i = LCD_COMP_MAX_SURFACES; i-- > 0U;)
+	{
+		if ((LcdComp_Clip(i, rect, &part) != 0U) && (lcdCompSurfaces[i].mode == LCD_COMP_OPAQUE)
+			&& (part.width == rect->width) && (part.height == rect->height))
+		{
+			first = i;
+			break;
+		}
+	}
+	if (first == LCD_COMP_MAX_SURFACES)
+	{
+		part.x = rect->x;
+		part.y = rect->y;
+		part.width = rect->width;
+		part.height = rect->height;
+		while (LcdComp_Retry(GfxEngine_Fill(back, &part, lcdCompBackground)) != 0U)
+		{
+		}
+		lcdCompStats.fills++;
+		first = 0U;
+	}
+
+	for (uint32_t i = first; i < LCD_COMP_MAX_SURFACES; i++)
+	{
+		const LcdComp_SurfaceTypeDef *s = &lcdCompSurfaces[i];
+		uint32_t x;
+		uint32_t y;
+
+		if (LcdComp_Clip(i, rect, &part) == 0U)
+		{
+			continue;
+		}
+		x = s->x + part.x;
+		y = s->y + part.y;
+		if (s->mode == LCD_COMP_BLEND)
+		{
+			while (LcdComp_Retry(GfxEngine_Blend(back, x, y, &s->image, &part, s->color)) != 0U)
+			{
+			}
+			lcdCompStats.blends++;
+		}
+		else if (s->image.format == back->format)
+		{
+			while (LcdComp_Retry(GfxEngine_Copy(back, x, y, &s->image, &part)) != 0U)
+			{
+			}
+			lcdCompStats.copies++;
+		}
+		else
+		{
+			while (LcdComp_Retry(GfxEngine_Convert(back, x, y, &s->image, &part, s->color)) != 0U)
+			{
+			}
+			lcdCompStats.copies++;
+		}
+	}
+}
+
+/* Marker of the last command of a frame, from the DMA2D interrupt */
+static void LcdComp_Present(void *arg)
+{
+	(void)LcdFb_Present(arg);
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Start compositing into the buffers of lcd_fb, no surface, no
+ *         sprite; the first frames are redrawn whole.
+ * @param  hltdc: handle given to LcdFb_Init()
+ * @param  background: ARGB8888, under the surfaces
+ * @retval HAL_OK, HAL_ERROR before LcdFb_Init() or with a layer format the
+ *         DMA2D cannot write
+ */
+HAL_StatusTypeDef LcdComp_Init(LTDC_HandleTypeDef *hltdc, uint32_t background)
+{
+	const GfxEngine_BufferTypeDef *front = LcdFb_GetFront();
+
+	lcdCompHandle = NULL;
+	if ((front == NULL) || (front->format >= GFX_OUTPUT_FORMATS))
+	{
+		return HAL_ERROR;
+	}
+	lcdCompWidth = front->width;
+	lcdCompHeight = front->height;
+	lcdCompBackground = background;
+	memset(lcdCompSet, 0, sizeof(lcdCompSet));
+	memset(lcdCompSlots, 0, sizeof(lcdCompSlots));
+	memset(&lcdCompSprite, 0, sizeof(lcdCompSprite));
+	memset(&lcdCompStats, 0, sizeof(lcdCompStats));
+	lcdCompDirty = 1U;
+	lcdCompHandle = hltdc;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Set, replace or remove a surface of layer 1.
+ * @param  id: 0 to LCD_COMP_MAX_SURFACES - 1, the higher on top
+ * @param  surface: copied; NULL removes the surface
+ * @retval HAL_OK, HAL_ERROR with an id or a mode not valid
+ */
+HAL_StatusTypeDef LcdComp_SetSurface(uint32_t id, const LcdComp_SurfaceTypeDef *surface)
+{
+	if ((id >= LCD_COMP_MAX_SURFACES) || ((surface != NULL) && (surface->mode > LCD_COMP_BLEND)))
+	{
+		return HAL_ERROR;
+	}
+	LcdComp_DamageSurface(id);
+	lcdCompSet[id] = (surface != NULL) ? 1U : 0U;
+	if (surface != NULL)
+	{
+		lcdCompSurfaces[id] = *surface;
+		LcdComp_DamageSurface(id);
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Move a surface: where it was and where it goes damaged.
+ * @retval HAL_OK, HAL_ERROR for a surface not set
+ */
+HAL_StatusTypeDef LcdComp_MoveSurface(uint32_t id, uint32_t x, uint32_t y)
+{
+	if ((id >= LCD_COMP_MAX_SURFACES) || (lcdCompSet[id] == 0U))
+	{
+		return HAL_ERROR;
+	}
+	if ((x != lcdCompSurfaces[id].x) || (y != lcdCompSurfaces[id].y))
+	{
+		LcdComp_DamageSurface(id);
+		lcdCompSurfaces[id].x = x;
+		lcdCompSurfaces[id].y = y;
+		LcdComp_DamageSurface(id);
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Damage a rectangle of the screen, a surface drawn into.
+ * @param  rect: screen coordinates
+ * @retval None
+ */
+void LcdComp_Invalidate(const GfxEngine_RectTypeDef *rect)
+{
+	LcdComp_Damaged(rect->x, rect->y, rect->width, rect->height);
+}
+
+/**
+ * @brief  Redraw the damage of the buffer acquired, then present it once
+ *         the DMA2D is done.
+ * @note   The DMA2D queue full, waits for room: not from an interrupt
+ *         above GFX_ENGINE_IRQ_PRIORITY.
+ * @retval HAL_OK: frame queued, or nothing to redraw; HAL_BUSY: no buffer
+ *         free, try again on the freed callback; HAL_ERROR before
+ *         LcdComp_Init()
+ */
+HAL_StatusTypeDef LcdComp_Render(void)
+{
+	GfxEngine_BufferTypeDef *back;
+	Damage_TypeDef *damage;
+
+	if (lcdCompHandle == NULL)
+	{
+		return HAL_ERROR;
+	}
+	if (lcdCompDirty == 0U)
+	{
+		lcdCompStats.idle++;
+		return HAL_OK;
+	}
+	back = LcdFb_Acquire();
+	if (back == NULL)
+	{
+		lcdCompStats.busy++;
+		return HAL_BUSY;
+	}
+	damage = LcdComp_Damage(back);
+	for (uint32_t i = 0; i < damage->count; i++)
+	{
+		LcdComp_Redraw(back, &damage->rects[i]);
+		lcdCompStats.rects++;
+		lcdCompStats.pixels += damage->rects[i].width * damage->rects[i].height;
+	}
+	Damage_Clear(damage);
+	lcdCompDirty = 0U;
+	while (LcdComp_Retry(GfxEngine_Marker(LcdComp_Present, back)) != 0U)
+	{
+	}
+	lcdCompStats.frames++;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Show an image on layer 2, blended by the LTDC with its alpha.
+ * @param  image: LTDC pixel format, GFX_ARGB8888 .. GFX_AL88; NULL hides
+ *         the sprite
+ * @param  x: screen position, may be off screen in part or whole
+ * @param  y: screen position
+ * @retval HAL_OK, HAL_ERROR with a format the LTDC cannot read
+ */
+HAL_StatusTypeDef LcdComp_SetSprite(const GfxEngine_BufferTypeDef *image, int32_t x, int32_t y)
+{
+	LTDC_LayerCfgTypeDef config;
+	uint32_t primask;
+	HAL_StatusTypeDef status;
+
+	if ((lcdCompHandle == NULL) || ((image != NULL) && (image->format > GFX_AL88)))
+	{
+		return HAL_ERROR;
+	}
+	if (image == NULL)
+	{
+		lcdCompSprite.address = NULL;
+		primask = __get_PRIMASK();
+		__disable_irq();
+		__HAL_LTDC_LAYER_DISABLE(lcdCompHandle, LCD_COMP_SPRITE_LAYER);
+		status = HAL_LTDC_Reload(lcdCompHandle, LTDC_RELOAD_VERTICAL_BLANKING);
+		__set_PRIMASK(primask);
+		return status;
+	}
+
+	memset(&config, 0, sizeof(config));
+	config.WindowX1 = image->width;
+	config.WindowY1 = image->height;
+	config.PixelFormat = image->format;
+	config.Alpha = 255U;
+	config.BlendingFactor1 = LTDC_BLENDING_FACTOR1_PAxCA;
+	config.BlendingFactor2 = LTDC_BLENDING_FACTOR2_PAxCA;
+	config.FBStartAdress = (uint32_t)(uintptr_t)image->address;
+	config.ImageWidth = image->width;
+	config.ImageHeight = image->height;
+	primask = __get_PRIMASK();
+	__disable_irq();
+	status = HAL_LTDC_ConfigLayer_NoReload(lcdCompHandle, &config, LCD_COMP_SPRITE_LAYER);
+	__set_PRIMASK(primask);
+	if (status != HAL_OK)
+	{
+		return status;
+	}
+	lcdCompSprite = *image;
+	return LcdComp_MoveSprite(x, y);
+}
+
+/**
+ * @brief  Move the sprite from the next vertical blanking, the window
+ *         clipped to the screen.
+ * @param  x: screen position, may be off screen in part or whole
+ * @param  y: screen position
+ * @retval HAL_OK, HAL_ERROR with no sprite
+ */
+HAL_StatusTypeDef LcdComp_MoveSprite(int32_t x, int32_t y)
+{
+	int64_t x0 = (x > 0) ? x : 0;
+	int64_t y0 = (y > 0) ? y : 0;
+	int64_t x1 = (int64_t)x + lcdCompSprite.width;
+	int64_t y1 = (int64_t)y + lcdCompSprite.height;
+	uint32_t address;
+	uint32_t primask;
+	HAL_StatusTypeDef status = HAL_OK;
+
+	if ((lcdCompHandle == NULL) || (lcdCompSprite.address == NULL))
+	{
+		return HAL_ERROR;
+	}
+	x1 = (x1 < (int64_t)lcdCompWidth) ? x1 : (int64_t)lcdCompWidth;
+	y1 = (y1 < (int64_t)lcdCompHeight) ? y1 : (int64_t)lcdCompHeight;
+	/* First pixel shown, the window starting within the image */
+	address = (uint32_t)(uintptr_t)lcdCompSprite.address + (uint32_t)(((y0 - y) * lcdCompSprite.width) + (x0 - x))
+		* (GfxSoft_Bits(lcdCompSprite.format) / 8U);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if ((x1 <= x0) || (y1 <= y0))
+	{
+		__HAL_LTDC_LAYER_DISABLE(lcdCompHandle, LCD_COMP_SPRITE_LAYER);
+	}
+	/* The window size sets the pitch to the window width too: the pitch of
+	   the image last */
+	else if ((HAL_LTDC_SetWindowSize_NoReload(lcdCompHandle, (uint32_t)(x1 - x0), (uint32_t)(y1 - y0),
+			LCD_COMP_SPRITE_LAYER) != HAL_OK)
+		|| (HAL_LTDC_SetWindowPosition_NoReload(lcdCompHandle, (uint32_t)x0, (uint32_t)y0, LCD_COMP_SPRITE_LAYER)
+			!= HAL_OK)
+		|| (HAL_LTDC_SetAddress_NoReload(lcdCompHandle, address, LCD_COMP_SPRITE_LAYER) != HAL_OK)
+		|| (HAL_LTDC_SetPitch_NoReload(lcdCompHandle, lcdCompSprite.width, LCD_COMP_SPRITE_LAYER) != HAL_OK))
+	{
+		status = HAL_ERROR;
+	}
+	if (status == HAL_OK)
+	{
+		status = HAL_LTDC_Reload(lcdCompHandle, LTDC_RELOAD_VERTICAL_BLANKING);
+	}
+	lcdCompStats.spriteMoves++;
+	__set_PRIMASK(primask);
+	return status;
+}
+
+void LcdComp_GetStats(LcdComp_StatsTypeDef *stats)
+{
+	*stats = lcdCompStats;
+}
+
+void LcdComp_Dump(LcdComp_PutCharTypeDef putChar)
+{
+	LcdComp_StatsTypeDef stats;
+	char line[192];
+
+	LcdComp_GetStats(&stats);
+	snprintf(line, sizeof(line),
+		"comp frame=%lu idle=%lu busy=%lu rect=%lu px=%lu fill=%lu copy=%lu blend=%lu stall=%lu err=%lu sprite=%lu\r\n",
+		(unsigned long)stats.frames, (unsigned long)stats.idle, (unsigned long)stats.busy,
+		(unsigned long)stats.rects, (unsigned long)stats.pixels, (unsigned long)stats.fills,
+		(unsigned long)stats.copies, (unsigned long)stats.blends, (unsigned long)stats.stalls,
+		(unsigned long)stats.errors, (unsigned long)stats.spriteMoves);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
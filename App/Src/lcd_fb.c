@@ -0,0 +1,362 @@
+/**
+  ******************************************************************************
+  * @file    lcd_fb.c
+  * @brief   LTDC framebuffer manager.
+  *
+  *          At most one buffer is READY, one PENDING and one SCANNING; the
+  *          states change with interrupts masked, the HAL LTDC calls of the
+  *          line event are made after. HAL_LTDC_IRQHandler() disables the
+  *          line interrupt each time it fires: the line event re-enables
+  *          it, LIPCR keeps the line programmed by LcdFb_Init().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "lcd_fb.h"
+#include "mem_section.h"
+#include "profile.h"
+
+/* Private variables ---------------------------------------------------------*/
+static LTDC_HandleTypeDef *lcdFbHandle;
+static uint32_t lcdFbLayer;
+static uint32_t lcdFbCount;
+static GfxEngine_BufferTypeDef lcdFbBuffers[LCD_FB_MAX_BUFFERS];
+static volatile uint8_t lcdFbState[LCD_FB_MAX_BUFFERS];
+static uint32_t lcdFbAcquired[LCD_FB_MAX_BUFFERS];  /* DWT cycles */
+static uint32_t lcdFbOnScreen;                      /* refreshes of the SCANNING buffer so far */
+static LcdFb_FreedTypeDef lcdFbFreed;
+static LcdFb_StatsTypeDef lcdFbStats;
+
+/* Private functions ---------------------------------------------------------*/
+/* Buffer in state, interrupts masked; -1 if none */
+static int32_t LcdFb_Find(LcdFb_StateTypeDef state)
+{
+	for (uint32_t i = 0; i < lcdFbCount; i++)
+	{
+		if (lcdFbState[i] == state)
+		{
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+static int32_t LcdFb_Index(const GfxEngine_BufferTypeDef *buffer)
+{
+	for (uint32_t i = 0; i < lcdFbCount; i++)
+	{
+		if (buffer == &lcdFbBuffers[i])
+		{
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief  Line event, once a refresh: the newest READY buffer goes to the
+ *         shadow registers, reloaded in the coming vertical blanking.
+ */
+static void LcdFb_LineEvent(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	int32_t ready;
+
+	__disable_irq();
+	lcdFbStats.refreshes++;
+	lcdFbOnScreen++;
+	ready = (LcdFb_Find(LCD_FB_PENDING) < 0) ? LcdFb_Find(LCD_FB_READY) : -1;
+	if (ready >= 0)
+	{
+		lcdFbState[ready] = LCD_FB_PENDING;
+	}
+	else if ((LcdFb_Find(LCD_FB_PENDING) < 0) && (LcdFb_Find(LCD_FB_DRAWING) >= 0))
+	{
+		lcdFbStats.late++;
+	}
+	__set_PRIMASK(primask);
+
+	if ((ready >= 0)
+		&& ((HAL_LTDC_SetAddress_NoReload(lcdFbHandle, (uint32_t)(uintptr_t)lcdFbBuffers[ready].address, lcdFbLayer)
+			!= HAL_OK) || (HAL_LTDC_Reload(lcdFbHandle, LTDC_RELOAD_VERTICAL_BLANKING) != HAL_OK)))
+	{
+		/* Next refresh, unless a newer frame came meanwhile */
+		primask = __get_PRIMASK();
+		__disable_irq();
+		lcdFbStats.deferred++;
+		if (LcdFb_Find(LCD_FB_READY) >= 0)
+		{
+			lcdFbState[ready] = LCD_FB_FREE;
+			lcdFbStats.dropped++;
+			ready = -2;
+		}
+		else
+		{
+			lcdFbState[ready] = LCD_FB_READY;
+		}
+		__set_PRIMASK(primask);
+		if ((ready == -2) && (lcdFbFreed != NULL))
+		{
+			lcdFbFreed();
+		}
+	}
+	__HAL_LTDC_ENABLE_IT(lcdFbHandle, LTDC_IT_LI);
+}
+
+/**
+ * @brief  Reload done, in the vertical blanking: the PENDING buffer is on
+ *         screen, the one it replaces free.
+ */
+static void LcdFb_ReloadEvent(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	int32_t pending;
+	int32_t scanning;
+
+	__disable_irq();
+	pending = LcdFb_Find(LCD_FB_PENDING);
+	scanning = LcdFb_Find(LCD_FB_SCANNING);
+	if (pending >= 0)
+	{
+		if (scanning >= 0)
+		{
+			lcdFbState[scanning] = LCD_FB_FREE;
+		}
+		lcdFbState[pending] = LCD_FB_SCANNING;
+		lcdFbStats.flips++;
+		lcdFbStats.frameTime[(lcdFbOnScreen >= LCD_FB_HISTOGRAM) ? (LCD_FB_HISTOGRAM - 1U)
+			: ((lcdFbOnScreen != 0U) ? (lcdFbOnScreen - 1U) : 0U)]++;
+		lcdFbOnScreen = 0U;
+	}
+	__set_PRIMASK(primask);
+
+	if ((pending >= 0) && (scanning >= 0) && (lcdFbFreed != NULL))
+	{
+		lcdFbFreed();
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Initialize the LTDC, carve the buffers out of memory and show the
+ *         first one on a layer.
+ * @note   The LTDC pins must already be in alternate function mode and the
+ *         pixel clock (PLLSAI) running.
+ * @param  hltdc: Instance and Init filled with the panel timings
+ * @param  layer: layer configuration, its FBStartAdress ignored; the image
+ *         size and pixel format give the buffer size
+ * @param  layerIdx: 0 or 1
+ * @param  memory: external SDRAM
+ * @param  size: bytes
+ * @param  count: 2 or 3 buffers
+ * @param  freed: called when a buffer is free again, may be NULL
+ * @retval HAL_OK, HAL_ERROR with a layer or a memory not valid
+ */
+HAL_StatusTypeDef LcdFb_Init(LTDC_HandleTypeDef *hltdc, const LTDC_LayerCfgTypeDef *layer, uint32_t layerIdx,
+		uint8_t *memory, uint32_t size, uint32_t count, LcdFb_FreedTypeDef freed)
+{
+	LTDC_LayerCfgTypeDef config = *layer;
+	uintptr_t base = ((uintptr_t)memory + LCD_FB_ALIGN - 1U) & ~(uintptr_t)(LCD_FB_ALIGN - 1U);
+	uint32_t bits = (layer->PixelFormat <= LTDC_PIXEL_FORMAT_AL88) ? GfxSoft_Bits(layer->PixelFormat) : 0U;
+	uint32_t bytes = (((layer->ImageWidth * layer->ImageHeight * bits) / 8U) + LCD_FB_ALIGN - 1U)
+		& ~(LCD_FB_ALIGN - 1U);
+
+	lcdFbHandle = NULL;
+	lcdFbCount = 0U;
+	if ((count < 2U) || (count > LCD_FB_MAX_BUFFERS) || (layerIdx > 1U) || (bytes == 0U)
+		|| (base - (uintptr_t)memory + ((uintptr_t)count * bytes) > size))
+	{
+		return HAL_ERROR;
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		lcdFbBuffers[i].address = (void *)(base + (i * bytes));
+		lcdFbBuffers[i].width = layer->ImageWidth;
+		lcdFbBuffers[i].height = layer->ImageHeight;
+		/* LTDC pixel formats are the DMA2D color modes */
+		lcdFbBuffers[i].format = layer->PixelFormat;
+		lcdFbState[i] = (i == 0U) ? LCD_FB_SCANNING : LCD_FB_FREE;
+	}
+	lcdFbLayer = layerIdx;
+	lcdFbFreed = freed;
+	lcdFbOnScreen = 0U;
+	memset(&lcdFbStats, 0, sizeof(lcdFbStats));
+
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_LTDC);
+	config.FBStartAdress = (uint32_t)base;
+	if ((HAL_LTDC_Init(hltdc) != HAL_OK) || (HAL_LTDC_ConfigLayer(hltdc, &config, layerIdx) != HAL_OK)
+		|| (HAL_LTDC_ProgramLineEvent(hltdc, (hltdc->Instance->AWCR & LTDC_AWCR_AAH) - LCD_FB_FLIP_LINES) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	lcdFbHandle = hltdc;
+	lcdFbCount = count;
+	__HAL_LTDC_ENABLE_IT(hltdc, LTDC_IT_FU | LTDC_IT_TE);
+
+	NVIC_SetPriority(LTDC_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), LCD_FB_IRQ_PRIORITY, 0));
+	NVIC_SetPriority(LTDC_ER_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), LCD_FB_IRQ_PRIORITY, 0));
+	NVIC_EnableIRQ(LTDC_IRQn);
+	NVIC_EnableIRQ(LTDC_ER_IRQn);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Take a free buffer to draw the next frame into.
+ * @retval Buffer, NULL if none is free: wait for the freed callback
+ */
+GfxEngine_BufferTypeDef *LcdFb_Acquire(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	int32_t i;
+
+	__disable_irq();
+	i = LcdFb_Find(LCD_FB_FREE);
+	if (i >= 0)
+	{
+		lcdFbState[i] = LCD_FB_DRAWING;
+		lcdFbAcquired[i] = Profile_GetCycles();
+	}
+	__set_PRIMASK(primask);
+	return (i >= 0) ? &lcdFbBuffers[i] : NULL;
+}
+
+/**
+ * @brief  Frame drawn: on screen from the next vertical blanking after the
+ *         line event. A frame READY and not shown yet is dropped.
+ * @param  buffer: from LcdFb_Acquire(), all of its drawing in memory
+ * @retval HAL_OK, HAL_ERROR if buffer is not being drawn
+ */
+HAL_StatusTypeDef LcdFb_Present(const GfxEngine_BufferTypeDef *buffer)
+{
+	int32_t i = LcdFb_Index(buffer);
+	uint32_t primask;
+	uint32_t cycles;
+	int32_t ready;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if ((i < 0) || (lcdFbState[i] != LCD_FB_DRAWING))
+	{
+		__set_PRIMASK(primask);
+		return HAL_ERROR;
+	}
+	cycles = Profile_GetCycles() - lcdFbAcquired[i];
+	if ((lcdFbStats.presented == 0U) || (cycles < lcdFbStats.renderMin))
+	{
+		lcdFbStats.renderMin = cycles;
+	}
+	if (cycles > lcdFbStats.renderMax)
+	{
+		lcdFbStats.renderMax = cycles;
+	}
+	lcdFbStats.renderLast = cycles;
+	lcdFbStats.presented++;
+	ready = LcdFb_Find(LCD_FB_READY);
+	if (ready >= 0)
+	{
+		lcdFbState[ready] = LCD_FB_FREE;
+		lcdFbStats.dropped++;
+	}
+	lcdFbState[i] = LCD_FB_READY;
+	__set_PRIMASK(primask);
+
+	if ((ready >= 0) && (lcdFbFreed != NULL))
+	{
+		lcdFbFreed();
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Buffer scanned out now, the reference of a partial redraw.
+ * @retval Buffer, NULL before LcdFb_Init()
+ */
+const GfxEngine_BufferTypeDef *LcdFb_GetFront(void)
+{
+	int32_t i = LcdFb_Find(LCD_FB_SCANNING);
+
+	return (i >= 0) ? &lcdFbBuffers[i] : NULL;
+}
+
+/**
+ * @brief  State of a buffer.
+ * @retval LCD_FB_FREE for a buffer not of the manager
+ */
+LcdFb_StateTypeDef LcdFb_GetState(const GfxEngine_BufferTypeDef *buffer)
+{
+	int32_t i = LcdFb_Index(buffer);
+
+	return (i >= 0) ? (LcdFb_StateTypeDef)lcdFbState[i] : LCD_FB_FREE;
+}
+
+/**
+ * @brief  LTDC global and error interrupt body, called from
+ *         LTDC_IRQHandler() and LTDC_ER_IRQHandler().
+ * @retval None
+ */
+ITCM_TEXT void LcdFb_IRQHandler(void)
+{
+	if (lcdFbHandle != NULL)
+	{
+		HAL_LTDC_IRQHandler(lcdFbHandle);
+	}
+}
+
+void HAL_LTDC_LineEventCallback(LTDC_HandleTypeDef *hltdc)
+{
+	if (hltdc == lcdFbHandle)
+	{
+		LcdFb_LineEvent();
+	}
+}
+
+void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef *hltdc)
+{
+	if (hltdc == lcdFbHandle)
+	{
+		LcdFb_ReloadEvent();
+	}
+}
+
+void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *hltdc)
+{
+	/* The HAL disables the interrupt of the error: keep counting */
+	lcdFbStats.errors++;
+	hltdc->ErrorCode = HAL_LTDC_ERROR_NONE;
+	hltdc->State = HAL_LTDC_STATE_READY;
+	__HAL_LTDC_ENABLE_IT(hltdc, LTDC_IT_FU | LTDC_IT_TE);
+}
+
+void LcdFb_GetStats(LcdFb_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = lcdFbStats;
+	__set_PRIMASK(primask);
+}
+
+void LcdFb_Dump(LcdFb_PutCharTypeDef putChar)
+{
+	LcdFb_StatsTypeDef stats;
+	char line[224];
+
+	LcdFb_GetStats(&stats);
+	snprintf(line, sizeof(line),
+		"fb ref=%lu pres=%lu flip=%lu drop=%lu late=%lu defer=%lu err=%lu time=%lu/%lu/%lu/%lu render=%lu..%lu\r\n",
+		(unsigned long)stats.refreshes, (unsigned long)stats.presented, (unsigned long)stats.flips,
+		(unsigned long)stats.dropped, (unsigned long)stats.late, (unsigned long)stats.deferred,
+		(unsigned long)stats.errors, (unsigned long)stats.frameTime[0], (unsigned long)stats.frameTime[1],
+		(unsigned long)stats.frameTime[2], (unsigned long)stats.frameTime[3], (unsigned long)stats.renderMin,
+		(unsigned long)stats.renderMax);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -15,6 +15,29 @@
 
 #include "stm32f7xx_hal_cortex.h"
 
+#include "bench_core.h"
+#include "bench_mem.h"
+#include "bench_qspi.h"
+#include "block_dev.h"
+#include "crc_stream.h"
+#include "dma_buffer.h"
+#include "eth_filter.h"
+#include "eth_if.h"
+#include "eth_pbuf.h"
+#include "kernel.h"
+#include "mem_section.h"
+#include "net.h"
+#include "profile.h"
+#include "qspi_flash.h"
+#include "ptp.h"
+#include "sd_card.h"
+#include "sdram.h"
+#include "timebase.h"
+#include "usart_dma.h"
+#include "usb_cdc.h"
+#include "usb_device.h"
+#include "usb_msc.h"
+
 #define LD1_GPIO_PIN 		LL_GPIO_PIN_0
 #define LD1_GPIO_PORT 		GPIOB
 #define LD2_GPIO_PIN 		LL_GPIO_PIN_7
@@ -22,9 +45,160 @@
 #define LD3_GPIO_PIN 		LL_GPIO_PIN_14
 #define LD3_GPIO_PORT 		GPIOB
 
+#define USART1_TX_GPIO_PIN 	LL_GPIO_PIN_9
+#define USART1_RX_GPIO_PIN 	LL_GPIO_PIN_10
+#define USART1_GPIO_PORT 	GPIOA
+#define USART1_BAUDRATE 	921600
+
+/* RMII to the LAN8742A PHY, AF11 */
+#define ETH_RMII_GPIOA_PINS 	(LL_GPIO_PIN_1 | LL_GPIO_PIN_2 | LL_GPIO_PIN_7)    /* REF_CLK, MDIO, CRS_DV */
+#define ETH_RMII_GPIOB_PINS 	LL_GPIO_PIN_13                                      /* TXD1 */
+#define ETH_RMII_GPIOC_PINS 	(LL_GPIO_PIN_1 | LL_GPIO_PIN_4 | LL_GPIO_PIN_5)    /* MDC, RXD0, RXD1 */
+#define ETH_RMII_GPIOG_PINS 	(LL_GPIO_PIN_11 | LL_GPIO_PIN_13)                  /* TX_EN, TXD0 */
+
+/* USB device on OTG FS, PA11/PA12 AF10 to the user USB connector. 1: OTG HS
+   with its DMA through an external ULPI PHY instead, AF10 on the pins below;
+   not fitted on the Nucleo, where PB0 is LD1 and PB13 RMII TXD1 */
+#ifndef USB_DEVICE_HS
+#define USB_DEVICE_HS 			0
+#endif
+#define USB_FS_GPIO_PINS 		(LL_GPIO_PIN_11 | LL_GPIO_PIN_12)                  /* DM, DP */
+#define USB_ULPI_GPIOA_PINS 	(LL_GPIO_PIN_3 | LL_GPIO_PIN_5)                    /* D0, CK */
+#define USB_ULPI_GPIOB_PINS 	(LL_GPIO_PIN_0 | LL_GPIO_PIN_1 | LL_GPIO_PIN_5 | LL_GPIO_PIN_10 \
+								| LL_GPIO_PIN_11 | LL_GPIO_PIN_12 | LL_GPIO_PIN_13) /* D1, D2, D7, D3-D6 */
+#define USB_ULPI_GPIOC_PINS 	(LL_GPIO_PIN_0 | LL_GPIO_PIN_2 | LL_GPIO_PIN_3)    /* STP, DIR, NXT */
+
+/* USB class: 0 CDC-ACM virtual COM port, 1 mass storage on an SD card wired
+   to the SDMMC1 pins below (CN8 on the Nucleo, no slot fitted), AF12 */
+#ifndef USB_DEVICE_MSC
+#define USB_DEVICE_MSC 			0
+#endif
+#define SDMMC1_GPIOC_PINS 		(LL_GPIO_PIN_8 | LL_GPIO_PIN_9 | LL_GPIO_PIN_10 | LL_GPIO_PIN_11 \
+								| LL_GPIO_PIN_12)                                   /* D0-D3, CK */
+#define SDMMC1_GPIOD_PINS 		LL_GPIO_PIN_2                                       /* CMD */
+
+/* SD card on the SDMMC1 pins above as the application block device, behind
+   the block_dev.c cache of BOARD_SD_CACHE_LINES lines: 1 when a board has
+   one and the USB class does not take it */
+#ifndef BOARD_SD
+#define BOARD_SD 				0
+#endif
+#define BOARD_SD_CACHE_LINES 	8U
+#if (BOARD_SD != 0) && (USB_DEVICE_MSC != 0)
+#error "BOARD_SD and USB_DEVICE_MSC both drive the SD card"
+#endif
+#if (SD_CARD_BLOCK_SIZE != BLOCK_DEV_BLOCK_SIZE)
+#error "The block device and the SD card disagree on the block size"
+#endif
+
+/* External SDRAM on FMC bank 1, 16-bit bus, AF12: 1 when a board wires one
+   to the pins below (not fitted on the Nucleo), the part in BOARD_SDRAM_PART.
+   PC0/PC2/PC3 are also ULPI pins of USB_DEVICE_HS */
+#ifndef BOARD_SDRAM
+#define BOARD_SDRAM 			0
+#endif
+#define BOARD_SDRAM_PART 		sdramMt48lc4m32b2
+#define FMC_GPIOC_PINS 			(LL_GPIO_PIN_0 | LL_GPIO_PIN_2 | LL_GPIO_PIN_3)    /* SDNWE, SDNE0, SDCKE0 */
+#define FMC_GPIOD_PINS 			(LL_GPIO_PIN_0 | LL_GPIO_PIN_1 | LL_GPIO_PIN_8 | LL_GPIO_PIN_9 \
+								| LL_GPIO_PIN_10 | LL_GPIO_PIN_14 | LL_GPIO_PIN_15) /* D2, D3, D13-D15, D0, D1 */
+#define FMC_GPIOE_PINS 			(LL_GPIO_PIN_0 | LL_GPIO_PIN_1 | LL_GPIO_PIN_7 | LL_GPIO_PIN_8 \
+								| LL_GPIO_PIN_9 | LL_GPIO_PIN_10 | LL_GPIO_PIN_11 | LL_GPIO_PIN_12 \
+								| LL_GPIO_PIN_13 | LL_GPIO_PIN_14 | LL_GPIO_PIN_15) /* NBL0, NBL1, D4-D12 */
+#define FMC_GPIOF_PINS 			(LL_GPIO_PIN_0 | LL_GPIO_PIN_1 | LL_GPIO_PIN_2 | LL_GPIO_PIN_3 \
+								| LL_GPIO_PIN_4 | LL_GPIO_PIN_5 | LL_GPIO_PIN_11 | LL_GPIO_PIN_12 \
+								| LL_GPIO_PIN_13 | LL_GPIO_PIN_14 | LL_GPIO_PIN_15) /* A0-A5, SDNRAS, A6-A9 */
+#define FMC_GPIOG_PINS 			(LL_GPIO_PIN_0 | LL_GPIO_PIN_1 | LL_GPIO_PIN_4 | LL_GPIO_PIN_5 \
+								| LL_GPIO_PIN_8 | LL_GPIO_PIN_15)                   /* A10, A11, BA0, BA1, SDCLK, SDNCAS */
+#if (BOARD_SDRAM != 0) && (USB_DEVICE_HS != 0)
+#error "BOARD_SDRAM and USB_DEVICE_HS share PC0, PC2 and PC3"
+#endif
+
+/* External quad SPI NOR flash on QUADSPI bank 1, wired as on the
+   STM32F746G-DISCO: 1 when a board has one (not fitted on the Nucleo), the
+   part in BOARD_QSPI_PART, the geometry read from its SFDP tables */
+#ifndef BOARD_QSPI
+#define BOARD_QSPI 				0
+#endif
+#define BOARD_QSPI_PART 		qspiFlashN25q128a
+#define QSPI_GPIOB_AF9_PINS 	LL_GPIO_PIN_2                                       /* CLK */
+#define QSPI_GPIOB_AF10_PINS 	LL_GPIO_PIN_6                                       /* BK1_NCS */
+#define QSPI_GPIOD_PINS 		(LL_GPIO_PIN_11 | LL_GPIO_PIN_12 | LL_GPIO_PIN_13) /* BK1_IO0, IO1, IO3 */
+#define QSPI_GPIOE_PINS 		LL_GPIO_PIN_2                                       /* BK1_IO2 */
+
+#define LED_TOGGLE_PERIOD_MS 	300
+#define PROFILE_DUMP_PERIOD_MS 	3000
+
+#define STATS_TASK_PRIORITY 	1U
+#define TIMER_TASK_PRIORITY 	16U     /* above every task a timer callback serves */
+#define TIMER_TASK_STACK_WORDS 	512U
+#define STATS_TASK_STACK_WORDS 	512U
+#define ETH_TASK_PRIORITY 		8U
+#define ETH_TASK_STACK_WORDS 	512U
+#define ETH_TASK_TICK_MS 		100U    /* PTP Announce timeout check */
+#define NET_ADDRESS 			NET_IP_ADDR(192, 168, 1, 10)
+#define NET_NETMASK 			NET_IP_ADDR(255, 255, 255, 0)
+#define NET_GATEWAY 			NET_IP_ADDR(192, 168, 1, 1)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	GPIO_TypeDef *port;
+	uint32_t pin;
+} Board_Led_TypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const Board_Led_TypeDef boardLed[] =
+{
+	{ LD1_GPIO_PORT, LD1_GPIO_PIN },
+	{ LD2_GPIO_PORT, LD2_GPIO_PIN },
+	{ LD3_GPIO_PORT, LD3_GPIO_PIN },
+};
+static TimerWheel_TimerTypeDef ledTimer[sizeof(boardLed) / sizeof(boardLed[0])];
+static Kernel_TaskTypeDef timerTask;
+static uint32_t timerTaskStack[TIMER_TASK_STACK_WORDS] DTCM_BSS __attribute__((aligned(8)));
+static Kernel_TaskTypeDef statsTask;
+static uint32_t statsTaskStack[STATS_TASK_STACK_WORDS] DTCM_BSS __attribute__((aligned(8)));
+static Kernel_TaskTypeDef ethTask;
+static uint32_t ethTaskStack[ETH_TASK_STACK_WORDS] DTCM_BSS __attribute__((aligned(8)));
+static PCD_HandleTypeDef usbPcdHandle;
+static char usbSerial[25];
+#if (USB_DEVICE_MSC != 0)
+static const UsbMsc_StorageTypeDef usbMscSdCard =
+{
+	.capacity = SdCard_GetBlockCount,
+	.read = SdCard_Read,
+	.write = SdCard_Write
+};
+static TimerWheel_TimerTypeDef usbMscTimer;
+#endif
+#if (BOARD_SD != 0)
+static const BlockDev_DeviceTypeDef blockDevSdCard =
+{
+	.capacity = SdCard_GetBlockCount,
+	.read = SdCard_Read,
+	.write = SdCard_Write
+};
+static uint8_t blockDevCache[BOARD_SD_CACHE_LINES * BLOCK_DEV_LINE_SIZE] __attribute__((aligned(DMA_BUFFER_LINE)));
+static TimerWheel_TimerTypeDef blockDevTimer;
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 static void SystemClock_Config(void);
 static void Board_Led_Init(void);
+static void Board_Usart_Init(void);
+static void Board_Eth_Init(void);
+static void Board_Usb_Init(void);
+#if (USB_DEVICE_MSC != 0) || (BOARD_SD != 0)
+static void Board_Sd_Init(void);
+#endif
+#if (BOARD_SDRAM != 0)
+static void Board_Sdram_Init(void);
+#endif
+#if (BOARD_QSPI != 0)
+static void Board_Qspi_Init(void);
+#endif
+static void Error_Handler(void);
+static void Usart1_PutChar(char c);
 extern uint32_t SystemCoreClock;
 
 
@@ -43,13 +217,184 @@ static void CPU_CACHE_Enable(void)
 }
 
 
-static void Delay_Ms(unsigned long ms)
+/**
+ * @brief  Timer callback toggling one board LED.
+ * @param  arg: LED descriptor
+ * @retval None
+ */
+static void Led_Toggle(void *arg)
+{
+	const Board_Led_TypeDef *led = arg;
+
+	PROFILE_BEGIN(PROFILE_ID_GPIO_TOGGLE);
+	LL_GPIO_TogglePin(led->port, led->pin);
+	PROFILE_END(PROFILE_ID_GPIO_TOGGLE);
+}
+
+/**
+ * @brief  Task running the timer wheel callbacks as they expire, whatever
+ *         the load of the tasks below.
+ * @param  arg: unused
+ * @retval None
+ */
+static void Timer_Task(void *arg)
+{
+	uint32_t ticks;
+
+	(void)arg;
+
+	for (;;)
+	{
+		Timebase_Poll();
+		/* KERNEL_WAIT_FOREVER is TIMER_WHEEL_NO_EXPIRY, kernel timeouts
+		   are compared as signed tick differences */
+		ticks = Timebase_TicksToNextExpiry();
+		if ((ticks != KERNEL_WAIT_FOREVER) && (ticks > (uint32_t)INT32_MAX))
+		{
+			ticks = (uint32_t)INT32_MAX;
+		}
+		(void)Kernel_NotifyWait(ticks);
+	}
+}
+
+/**
+ * @brief  Task printing the profiling histograms and the kernel task list.
+ * @param  arg: unused
+ * @retval None
+ */
+static void Stats_Task(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		Kernel_Delay(PROFILE_DUMP_PERIOD_MS);
+		Profile_Dump(Usart1_PutChar);
+		Kernel_Dump(Usart1_PutChar);
+		EthIf_Dump(Usart1_PutChar);
+		EthFilter_Dump(Usart1_PutChar);
+		Ptp_Dump(Usart1_PutChar);
+		Net_Dump(Usart1_PutChar);
+		UsbDevice_Dump(Usart1_PutChar);
+#if (USB_DEVICE_MSC != 0)
+		UsbMsc_Dump(Usart1_PutChar);
+		SdCard_Dump(Usart1_PutChar);
+#else
+		UsbCdc_Dump(Usart1_PutChar);
+#endif
+#if (BOARD_SD != 0)
+		BlockDev_Dump(Usart1_PutChar);
+		SdCard_Dump(Usart1_PutChar);
+#endif
+#if (BOARD_SDRAM != 0)
+		Sdram_Dump(Usart1_PutChar);
+#endif
+#if (BOARD_QSPI != 0)
+		QspiFlash_Dump(Usart1_PutChar);
+#endif
+	}
+}
+
+#if (USB_DEVICE_MSC != 0)
+/**
+ * @brief  Timer callback starting again the SD card transfers the mass
+ *         storage class found the card busy for.
+ * @param  arg: unused
+ * @retval None
+ */
+static void UsbMsc_PollTimer(void *arg)
+{
+	(void)arg;
+
+	UsbMsc_Poll();
+}
+#endif
+
+#if (BOARD_SD != 0)
+/**
+ * @brief  Timer callback starting again the SD card transfer the block
+ *         device found the card busy for.
+ * @param  arg: unused
+ * @retval None
+ */
+static void BlockDev_PollTimer(void *arg)
+{
+	(void)arg;
+
+	BlockDev_Poll();
+}
+#endif
+
+/**
+ * @brief  ETH interrupt: wake the ETH task for a poll.
+ * @retval None
+ */
+static void Eth_Schedule(void)
+{
+	Kernel_Notify(&ethTask);
+}
+
+/**
+ * @brief  Received frame, from EthIf_Poll().
+ * @param  frame: pbuf chain, owned here
+ * @retval None
+ */
+static void Eth_Receive(EthPbuf_TypeDef *frame)
 {
-	while (ms--)
+	if ((frame->length > 14U) && ((((uint32_t)frame->payload[12] << 8) | frame->payload[13]) == PTP_ETHERTYPE))
 	{
-		for (int i = 0; i < (SystemCoreClock/9000); i++)
-		{}
+		Ptp_Receive(frame);
+		return;
 	}
+	Net_Receive(frame);
+}
+
+/**
+ * @brief  Task starting the ETH interface and running its polls.
+ * @note   It sits above the application tasks, EthIf_Drain() sleeps a tick
+ *         between two polls: a flood leaves them the CPU between budgets.
+ * @param  arg: unused
+ * @retval None
+ */
+static void Eth_Task(void *arg)
+{
+	uint8_t macAddress[6];
+	uint32_t uid = LL_GetUID_Word0() ^ LL_GetUID_Word1() ^ LL_GetUID_Word2();
+
+	(void)arg;
+
+	/* Locally administered unicast address from the device ID */
+	macAddress[0] = 0x02U;
+	macAddress[1] = 0x80U;
+	macAddress[2] = (uint8_t)(uid >> 24);
+	macAddress[3] = (uint8_t)(uid >> 16);
+	macAddress[4] = (uint8_t)(uid >> 8);
+	macAddress[5] = (uint8_t)uid;
+
+	/* Without the PHY reference clock the MAC reset times out: run on without network */
+	if ((EthIf_Init(macAddress, Eth_Receive, Eth_Schedule) != HAL_OK) || (Ptp_Init() != HAL_OK)
+			|| (Net_Init(NET_ADDRESS, NET_NETMASK, NET_GATEWAY) != HAL_OK))
+	{
+		return;
+	}
+
+	for (;;)
+	{
+		Kernel_NotifyWait(ETH_TASK_TICK_MS);
+		Ptp_Tick(Kernel_GetTick());
+		EthIf_Drain(ETH_IF_POLL_BUDGET);
+	}
+}
+
+/**
+ * @brief  Idle task work: tickless sleep up to the next timer or task
+ *         timeout, the timer task runs the callbacks.
+ * @param  ticks: ticks to the next task timeout
+ * @retval None
+ */
+void Kernel_IdleHook(uint32_t ticks)
+{
+	Timebase_IdleFor(ticks);
 }
 
 /**
@@ -58,6 +403,13 @@ static void Delay_Ms(unsigned long ms)
  */
 int main(void)
 {
+#if defined(BENCH_CORE) && (BENCH_CORE == 1)
+	/* Cycles since reset, counted from Reset_Handler at the HSI clock */
+	uint32_t bootCycles = DWT->CYCCNT;
+#endif
+
+	/* MPU regions for the DMA buffers must be in place before the D-cache is on */
+	DmaBuffer_Init();
 	CPU_CACHE_Enable();
 
 	/* MCU Configuration--------------------------------------------------------*/
@@ -76,17 +428,58 @@ int main(void)
 
 	/* Initialize all configured peripherals */
 	Board_Led_Init();
+	Board_Usart_Init();
+	Board_Eth_Init();
+#if (USB_DEVICE_MSC != 0) || (BOARD_SD != 0)
+	Board_Sd_Init();
+#endif
+#if (BOARD_SDRAM != 0)
+	Board_Sdram_Init();
+#endif
+#if (BOARD_QSPI != 0)
+	Board_Qspi_Init();
+#endif
+	Board_Usb_Init();
+	CrcStream_Init();
+	EthPbuf_Init();
 	LL_GPIO_SetOutputPin(LD1_GPIO_PORT,LD1_GPIO_PIN);
 
-	/* Infinite loop */
+#if defined(BENCH_CORE) && (BENCH_CORE == 1)
+	BenchCore_Report(bootCycles, Usart1_PutChar);
+#if (BOARD_SDRAM != 0)
+	BenchMem_Report(Usart1_PutChar);
+#endif
+#if (BOARD_QSPI != 0)
+	BenchQspi_Report(Usart1_PutChar);
+#endif
+#endif
+
+	/* The LEDs toggle one after the other, 100 ms apart */
+	for (uint32_t i = 0; i < sizeof(boardLed) / sizeof(boardLed[0]); i++)
+	{
+		Timebase_StartTimer(&ledTimer[i], (i + 1U) * (LED_TOGGLE_PERIOD_MS / 3U), LED_TOGGLE_PERIOD_MS,
+			Led_Toggle, (void *)&boardLed[i]);
+	}
+#if (USB_DEVICE_MSC != 0)
+	Timebase_StartTimer(&usbMscTimer, USB_MSC_POLL_MS, USB_MSC_POLL_MS, UsbMsc_PollTimer, NULL);
+#endif
+#if (BOARD_SD != 0)
+	Timebase_StartTimer(&blockDevTimer, BLOCK_DEV_POLL_MS, BLOCK_DEV_POLL_MS, BlockDev_PollTimer, NULL);
+#endif
+
+	/* The timer wheel runs in the timer task, see Timer_Task() */
+	Kernel_Init();
+	Kernel_TaskCreate(&timerTask, "timer", Timer_Task, NULL, TIMER_TASK_PRIORITY,
+		timerTaskStack, TIMER_TASK_STACK_WORDS);
+	Kernel_TaskCreate(&statsTask, "stats", Stats_Task, NULL, STATS_TASK_PRIORITY,
+		statsTaskStack, STATS_TASK_STACK_WORDS);
+	Kernel_TaskCreate(&ethTask, "eth", Eth_Task, NULL, ETH_TASK_PRIORITY,
+		ethTaskStack, ETH_TASK_STACK_WORDS);
+	Kernel_Start();
+
+	/* Not reached */
 	while (1)
 	{
-		Delay_Ms(100);
-		LL_GPIO_TogglePin(LD1_GPIO_PORT,LD1_GPIO_PIN);
-		Delay_Ms(100);
-		LL_GPIO_TogglePin(LD2_GPIO_PORT,LD2_GPIO_PIN);
-		Delay_Ms(100);
-		LL_GPIO_TogglePin(LD3_GPIO_PORT,LD3_GPIO_PIN);
 	}
 }
 
@@ -99,6 +492,16 @@ static void SystemClock_Config(void)
 	LL_FLASH_SetLatency(LL_FLASH_LATENCY_7);
 	while (LL_FLASH_GetLatency() != LL_FLASH_LATENCY_7){}
 
+	/* ART accelerator and prefetch serve ITCM-bus fetches (Makefile FLASH_BUS) */
+#if (ART_ACCELERATOR_ENABLE != 0)
+	LL_FLASH_EnableARTReset();
+	LL_FLASH_DisableARTReset();
+	LL_FLASH_EnableART();
+#endif
+#if (PREFETCH_ENABLE != 0)
+	LL_FLASH_EnablePrefetch();
+#endif
+
 	LL_PWR_SetRegulVoltageScaling(LL_PWR_REGU_VOLTAGE_SCALE1);
 	LL_PWR_EnableOverDriveMode();
 	LL_RCC_HSI_SetCalibTrimming(16);
@@ -106,6 +509,8 @@ static void SystemClock_Config(void)
 	while (LL_RCC_HSI_IsReady() != 1){} /* Wait till HSI is ready */
 
 	LL_RCC_PLL_ConfigDomain_SYS(LL_RCC_PLLSOURCE_HSI, LL_RCC_PLLM_DIV_8, 216, LL_RCC_PLLP_DIV_2);
+	/* 432 MHz VCO / 9: the 48 MHz the OTG FS core and its PHY need */
+	LL_RCC_PLL_ConfigDomain_48M(LL_RCC_PLLSOURCE_HSI, LL_RCC_PLLM_DIV_8, 216, LL_RCC_PLLQ_DIV_9);
 	LL_RCC_PLL_Enable();
 	while (LL_RCC_PLL_IsReady() != 1){} /* Wait till PLL is ready */
 
@@ -116,9 +521,13 @@ static void SystemClock_Config(void)
 	/* Wait till System clock is ready */
 	while(LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_PLL){}
 
-	// LL_Init1msTick(96000000);
 	LL_SetSystemCoreClock(216000000);
+	Timebase_Init();
 	LL_RCC_SetUSARTClockSource(LL_RCC_USART1_CLKSOURCE_SYSCLK);
+	LL_RCC_SetCK48MClockSource(LL_RCC_CK48M_CLKSOURCE_PLL);
+
+	/* Start the DWT cycle counter used by the profiling probes */
+	Profile_Init();
 }
 
 static void Board_Led_Init(void)
@@ -143,6 +552,225 @@ static void Board_Led_Init(void)
 	LL_GPIO_Init(LD3_GPIO_PORT, &gpioConfig);
 }
 
+static void Board_Usart_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOA);
+
+	gpioConfig.Pin = USART1_TX_GPIO_PIN | USART1_RX_GPIO_PIN;
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_UP;
+	gpioConfig.Alternate = LL_GPIO_AF_7;
+	LL_GPIO_Init(USART1_GPIO_PORT, &gpioConfig);
+
+	UsartDma_Init(USART1_BAUDRATE);
+}
+
+static void Board_Eth_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOA | LL_AHB1_GRP1_PERIPH_GPIOB
+		| LL_AHB1_GRP1_PERIPH_GPIOC | LL_AHB1_GRP1_PERIPH_GPIOG);
+
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_NO;
+	gpioConfig.Alternate = LL_GPIO_AF_11;
+
+	gpioConfig.Pin = ETH_RMII_GPIOA_PINS;
+	LL_GPIO_Init(GPIOA, &gpioConfig);
+
+	gpioConfig.Pin = ETH_RMII_GPIOB_PINS;
+	LL_GPIO_Init(GPIOB, &gpioConfig);
+
+	gpioConfig.Pin = ETH_RMII_GPIOC_PINS;
+	LL_GPIO_Init(GPIOC, &gpioConfig);
+
+	gpioConfig.Pin = ETH_RMII_GPIOG_PINS;
+	LL_GPIO_Init(GPIOG, &gpioConfig);
+}
+
+static void Board_Usb_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	uint32_t uid[3] = { LL_GetUID_Word0(), LL_GetUID_Word1(), LL_GetUID_Word2() };
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_NO;
+	gpioConfig.Alternate = LL_GPIO_AF_10;
+
+	memset(&usbPcdHandle, 0, sizeof(usbPcdHandle));
+#if (USB_DEVICE_HS != 0)
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOA | LL_AHB1_GRP1_PERIPH_GPIOB
+		| LL_AHB1_GRP1_PERIPH_GPIOC);
+	gpioConfig.Pin = USB_ULPI_GPIOA_PINS;
+	LL_GPIO_Init(GPIOA, &gpioConfig);
+	gpioConfig.Pin = USB_ULPI_GPIOB_PINS;
+	LL_GPIO_Init(GPIOB, &gpioConfig);
+	gpioConfig.Pin = USB_ULPI_GPIOC_PINS;
+	LL_GPIO_Init(GPIOC, &gpioConfig);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_OTGHS | LL_AHB1_GRP1_PERIPH_OTGHSULPI);
+
+	usbPcdHandle.Instance = USB_OTG_HS;
+	usbPcdHandle.Init.speed = PCD_SPEED_HIGH;
+	usbPcdHandle.Init.phy_itface = PCD_PHY_ULPI;
+	usbPcdHandle.Init.dma_enable = 1U;
+#else
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOA);
+	gpioConfig.Pin = USB_FS_GPIO_PINS;
+	LL_GPIO_Init(GPIOA, &gpioConfig);
+	LL_AHB2_GRP1_EnableClock(LL_AHB2_GRP1_PERIPH_OTGFS);
+
+	/* The FS core has no DMA, its FIFOs are loaded by the CPU */
+	usbPcdHandle.Instance = USB_OTG_FS;
+	usbPcdHandle.Init.speed = PCD_SPEED_FULL;
+	usbPcdHandle.Init.phy_itface = PCD_PHY_EMBEDDED;
+	usbPcdHandle.Init.dma_enable = 0U;
+#endif
+	usbPcdHandle.Init.dev_endpoints = USB_DEVICE_MAX_ENDPOINTS;
+	usbPcdHandle.Init.ep0_mps = USB_DEVICE_EP0_MPS;
+	usbPcdHandle.Init.Sof_enable = 0U;
+	usbPcdHandle.Init.low_power_enable = 0U;
+	usbPcdHandle.Init.lpm_enable = 0U;
+	usbPcdHandle.Init.vbus_sensing_enable = 0U;
+	usbPcdHandle.Init.use_dedicated_ep1 = 0U;
+	if (HAL_PCD_Init(&usbPcdHandle) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	/* iSerialNumber: the 96-bit unique device ID in hex */
+	for (uint32_t i = 0; i < 24U; i++)
+	{
+		uint32_t nibble = (uid[i / 8U] >> (28U - 4U * (i % 8U))) & 0xFU;
+		usbSerial[i] = (char)((nibble < 10U) ? ('0' + nibble) : ('A' + nibble - 10U));
+	}
+	usbSerial[24] = '\0';
+#if (USB_DEVICE_MSC != 0)
+	if (UsbMsc_Init(&usbPcdHandle, &usbMscSdCard, usbSerial) != HAL_OK)
+#else
+	if (UsbCdc_Init(&usbPcdHandle, usbSerial) != HAL_OK)
+#endif
+	{
+		Error_Handler();
+	}
+}
+
+#if (USB_DEVICE_MSC != 0) || (BOARD_SD != 0)
+static void Board_Sd_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOC | LL_AHB1_GRP1_PERIPH_GPIOD);
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_UP;
+	gpioConfig.Alternate = LL_GPIO_AF_12;
+	gpioConfig.Pin = SDMMC1_GPIOC_PINS;
+	LL_GPIO_Init(GPIOC, &gpioConfig);
+	gpioConfig.Pin = SDMMC1_GPIOD_PINS;
+	LL_GPIO_Init(GPIOD, &gpioConfig);
+
+#if (USB_DEVICE_MSC != 0)
+	/* No card: the class answers NOT READY, the host sees an empty drive */
+	(void)SdCard_Init(UsbMsc_StorageDone);
+#else
+	/* No card: the block device stays without a medium, its requests fail */
+	if (SdCard_Init(BlockDev_DeviceDone) == HAL_OK)
+	{
+		(void)BlockDev_Init(&blockDevSdCard, blockDevCache, sizeof(blockDevCache));
+	}
+#endif
+}
+#endif
+
+#if (BOARD_SDRAM != 0)
+static void Board_Sdram_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOC | LL_AHB1_GRP1_PERIPH_GPIOD | LL_AHB1_GRP1_PERIPH_GPIOE
+		| LL_AHB1_GRP1_PERIPH_GPIOF | LL_AHB1_GRP1_PERIPH_GPIOG);
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_NO;
+	gpioConfig.Alternate = LL_GPIO_AF_12;
+	gpioConfig.Pin = FMC_GPIOC_PINS;
+	LL_GPIO_Init(GPIOC, &gpioConfig);
+	gpioConfig.Pin = FMC_GPIOD_PINS;
+	LL_GPIO_Init(GPIOD, &gpioConfig);
+	gpioConfig.Pin = FMC_GPIOE_PINS;
+	LL_GPIO_Init(GPIOE, &gpioConfig);
+	gpioConfig.Pin = FMC_GPIOF_PINS;
+	LL_GPIO_Init(GPIOF, &gpioConfig);
+	gpioConfig.Pin = FMC_GPIOG_PINS;
+	LL_GPIO_Init(GPIOG, &gpioConfig);
+
+	if (Sdram_Init(&BOARD_SDRAM_PART) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+#endif
+
+#if (BOARD_QSPI != 0)
+static void Board_Qspi_Init(void)
+{
+	LL_GPIO_InitTypeDef gpioConfig;
+	memset(&gpioConfig, 0, sizeof(gpioConfig));
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOB | LL_AHB1_GRP1_PERIPH_GPIOD | LL_AHB1_GRP1_PERIPH_GPIOE);
+	gpioConfig.Mode = LL_GPIO_MODE_ALTERNATE;
+	gpioConfig.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+	gpioConfig.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+	gpioConfig.Pull = LL_GPIO_PULL_NO;
+	gpioConfig.Alternate = LL_GPIO_AF_9;
+	gpioConfig.Pin = QSPI_GPIOB_AF9_PINS;
+	LL_GPIO_Init(GPIOB, &gpioConfig);
+	gpioConfig.Pin = QSPI_GPIOD_PINS;
+	LL_GPIO_Init(GPIOD, &gpioConfig);
+	gpioConfig.Pin = QSPI_GPIOE_PINS;
+	LL_GPIO_Init(GPIOE, &gpioConfig);
+	/* Chip select high while the controller is off */
+	gpioConfig.Pull = LL_GPIO_PULL_UP;
+	gpioConfig.Alternate = LL_GPIO_AF_10;
+	gpioConfig.Pin = QSPI_GPIOB_AF10_PINS;
+	LL_GPIO_Init(GPIOB, &gpioConfig);
+
+	if (QspiFlash_Init(&BOARD_QSPI_PART) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+#endif
+
+static void Usart1_PutChar(char c)
+{
+	uint32_t queued;
+
+	/* The TX DMA interrupt drains the ring, wait for room when it is full */
+	PROFILE_BEGIN(PROFILE_ID_USART1_ENQUEUE);
+	do
+	{
+		queued = UsartDma_Write(&c, 1);
+	} while (queued == 0U);
+	PROFILE_END(PROFILE_ID_USART1_ENQUEUE);
+}
+
 /**
  * @brief  This function is executed in case of error occurrence.
  * @retval None
@@ -0,0 +1,258 @@
+/**
+  ******************************************************************************
+  * @file    mem_heap.c
+  * @brief   General purpose heap over a caller-provided memory region.
+  *
+  *          Every block starts with a one-line header holding its size and
+  *          the size of the block before it, so both neighbours of a block
+  *          being freed are found in constant time. Free blocks are chained
+  *          through their header, most recently freed first; allocation
+  *          takes the front of the first block large enough and gives the
+  *          rest back to the list.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "mem_heap.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define MEM_HEAP_USED               1U
+/* A remainder smaller than a header and one line stays in the block */
+#define MEM_HEAP_MIN_SPLIT          (2U * MEM_HEAP_ALIGN)
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t MemHeap_BlockSize(const MemHeap_BlockTypeDef *block)
+{
+	return block->size & ~MEM_HEAP_USED;
+}
+
+static MemHeap_BlockTypeDef *MemHeap_Next(const MemHeap_TypeDef *heap, MemHeap_BlockTypeDef *block)
+{
+	uint8_t *next = (uint8_t *)block + MemHeap_BlockSize(block);
+
+	return (next < heap->memory + heap->size) ? (MemHeap_BlockTypeDef *)next : NULL;
+}
+
+static MemHeap_BlockTypeDef *MemHeap_Prev(MemHeap_BlockTypeDef *block)
+{
+	return (block->prevSize != 0U) ? (MemHeap_BlockTypeDef *)((uint8_t *)block - block->prevSize) : NULL;
+}
+
+static void MemHeap_Push(MemHeap_TypeDef *heap, MemHeap_BlockTypeDef *block)
+{
+	block->prev = NULL;
+	block->next = heap->freeList;
+	if (heap->freeList != NULL)
+	{
+		heap->freeList->prev = block;
+	}
+	heap->freeList = block;
+}
+
+static void MemHeap_Unlink(MemHeap_TypeDef *heap, MemHeap_BlockTypeDef *block)
+{
+	if (block->prev != NULL)
+	{
+		block->prev->next = block->next;
+	}
+	else
+	{
+		heap->freeList = block->next;
+	}
+	if (block->next != NULL)
+	{
+		block->next->prev = block->prev;
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Initialize a heap over a memory region, all of it free.
+ * @param  heap: heap handle
+ * @param  memory: region, trimmed to MEM_HEAP_ALIGN boundaries
+ * @param  size: bytes
+ * @retval None
+ */
+void MemHeap_Init(MemHeap_TypeDef *heap, void *memory, uint32_t size)
+{
+	uint32_t skip = (uint32_t)(-(uintptr_t)memory & (MEM_HEAP_ALIGN - 1U));
+
+	memset(heap, 0, sizeof(*heap));
+	heap->memory = (uint8_t *)memory + skip;
+	heap->size = (size > skip) ? ((size - skip) & ~(MEM_HEAP_ALIGN - 1U)) : 0U;
+	if (heap->size < MEM_HEAP_MIN_SPLIT)
+	{
+		heap->size = 0U;
+		return;
+	}
+
+	heap->freeList = (MemHeap_BlockTypeDef *)heap->memory;
+	heap->freeList->size = heap->size;
+	heap->freeList->prevSize = 0U;
+	heap->freeList->next = NULL;
+	heap->freeList->prev = NULL;
+	heap->freeBytes = heap->size;
+	heap->minFreeBytes = heap->size;
+}
+
+/**
+ * @brief  Allocate a buffer, first fit.
+ * @param  heap: heap handle
+ * @param  size: bytes
+ * @retval MEM_HEAP_ALIGN aligned buffer, NULL if no free block is large
+ *         enough or size is 0
+ */
+void *MemHeap_Alloc(MemHeap_TypeDef *heap, uint32_t size)
+{
+	MemHeap_BlockTypeDef *block;
+	uint32_t need;
+	uint32_t primask;
+
+	if (size == 0U)
+	{
+		return NULL;
+	}
+	if (size > heap->size)
+	{
+		heap->failures++;
+		return NULL;
+	}
+	need = ((size + MEM_HEAP_ALIGN - 1U) & ~(MEM_HEAP_ALIGN - 1U)) + MEM_HEAP_ALIGN;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	block = heap->freeList;
+	while ((block != NULL) && (block->size < need))
+	{
+		block = block->next;
+	}
+	if (block == NULL)
+	{
+		heap->failures++;
+		__set_PRIMASK(primask);
+		return NULL;
+	}
+
+	MemHeap_Unlink(heap, block);
+	if ((block->size - need) >= MEM_HEAP_MIN_SPLIT)
+	{
+		MemHeap_BlockTypeDef *rest = (MemHeap_BlockTypeDef *)((uint8_t *)block + need);
+		MemHeap_BlockTypeDef *next;
+
+		rest->size = block->size - need;
+		rest->prevSize = need;
+		next = MemHeap_Next(heap, rest);
+		if (next != NULL)
+		{
+			next->prevSize = rest->size;
+		}
+		block->size = need;
+		MemHeap_Push(heap, rest);
+	}
+	heap->freeBytes -= block->size;
+	if (heap->freeBytes < heap->minFreeBytes)
+	{
+		heap->minFreeBytes = heap->freeBytes;
+	}
+	heap->allocs++;
+	block->size |= MEM_HEAP_USED;
+
+	__set_PRIMASK(primask);
+	return (uint8_t *)block + MEM_HEAP_ALIGN;
+}
+
+/**
+ * @brief  Return a buffer to its heap, merged with its free neighbours.
+ * @param  heap: heap handle
+ * @param  buffer: pointer returned by MemHeap_Alloc(), NULL is ignored
+ * @retval None
+ */
+void MemHeap_Free(MemHeap_TypeDef *heap, void *buffer)
+{
+	MemHeap_BlockTypeDef *block;
+	MemHeap_BlockTypeDef *next;
+	MemHeap_BlockTypeDef *prev;
+	uint32_t primask;
+
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	block = (MemHeap_BlockTypeDef *)((uint8_t *)buffer - MEM_HEAP_ALIGN);
+	assert_param(((uint8_t *)block >= heap->memory) && ((uint8_t *)block < heap->memory + heap->size));
+	assert_param((block->size & MEM_HEAP_USED) != 0U);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	block->size &= ~MEM_HEAP_USED;
+	heap->freeBytes += block->size;
+	heap->frees++;
+
+	next = MemHeap_Next(heap, block);
+	if ((next != NULL) && ((next->size & MEM_HEAP_USED) == 0U))
+	{
+		MemHeap_Unlink(heap, next);
+		block->size += next->size;
+	}
+	prev = MemHeap_Prev(block);
+	if ((prev != NULL) && ((prev->size & MEM_HEAP_USED) == 0U))
+	{
+		MemHeap_Unlink(heap, prev);
+		prev->size += block->size;
+		block = prev;
+	}
+	next = MemHeap_Next(heap, block);
+	if (next != NULL)
+	{
+		next->prevSize = block->size;
+	}
+	MemHeap_Push(heap, block);
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Usage and fragmentation of a heap.
+ * @param  heap: heap handle
+ * @param  stats: filled in
+ * @retval None
+ */
+void MemHeap_GetStats(MemHeap_TypeDef *heap, MemHeap_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+
+	stats->size = heap->size;
+	stats->freeBytes = heap->freeBytes;
+	stats->minFreeBytes = heap->minFreeBytes;
+	stats->largestFree = 0U;
+	stats->freeBlocks = 0U;
+	for (const MemHeap_BlockTypeDef *block = heap->freeList; block != NULL; block = block->next)
+	{
+		if (block->size - MEM_HEAP_ALIGN > stats->largestFree)
+		{
+			stats->largestFree = block->size - MEM_HEAP_ALIGN;
+		}
+		stats->freeBlocks++;
+	}
+	stats->allocs = heap->allocs;
+	stats->frees = heap->frees;
+	stats->failures = heap->failures;
+
+	__set_PRIMASK(primask);
+}
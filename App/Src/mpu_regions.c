@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file    mpu_regions.c
+  * @brief   MPU region table generation for mpu_armv7.h ARM_MPU_Load().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mpu_regions.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MPU_REGIONS_MIN_LOG2        5U      /* 32 bytes */
+#define MPU_REGIONS_MIN_SRD_LOG2    8U      /* sub-regions need 256 bytes or more */
+#define MPU_REGIONS_SUBREGIONS      8U
+#define MPU_REGIONS_COUNT           8U      /* Cortex-M7 with MPU, MPU->TYPE DREGION */
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Find the smallest region enclosing [base, base + size).
+ * @retval 1 on success, 0 if no single region can describe the range
+ */
+static int MpuRegions_Fit(uint32_t base, uint32_t size, uint32_t *regionBase, uint32_t *log2Size,
+		uint32_t *srd)
+{
+	uint64_t end = (uint64_t)base + size;
+
+	if ((size == 0U) || (end > 0x100000000ULL))
+	{
+		return 0;
+	}
+
+	for (uint32_t log2 = MPU_REGIONS_MIN_LOG2; log2 <= 32U; log2++)
+	{
+		uint64_t regionSize = 1ULL << log2;
+		uint64_t start = (uint64_t)base & ~(regionSize - 1U);
+		uint64_t sub = regionSize / MPU_REGIONS_SUBREGIONS;
+
+		if (start + regionSize < end)
+		{
+			continue;
+		}
+
+		if ((start == base) && (regionSize == size))
+		{
+			*regionBase = (uint32_t)start;
+			*log2Size = log2;
+			*srd = 0;
+			return 1;
+		}
+
+		if ((log2 >= MPU_REGIONS_MIN_SRD_LOG2) && ((((uint64_t)base - start) % sub) == 0U) && ((size % sub) == 0U))
+		{
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < MPU_REGIONS_SUBREGIONS; i++)
+			{
+				uint64_t subStart = start + (i * sub);
+				if ((subStart < base) || (subStart >= end))
+				{
+					mask |= 1UL << i;
+				}
+			}
+			*regionBase = (uint32_t)start;
+			*log2Size = log2;
+			*srd = mask;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t MpuRegions_Attributes(MpuRegions_MemoryTypeDef type, uint32_t shareable)
+{
+	switch (type)
+	{
+		case MPU_REGIONS_STRONGLY_ORDERED:
+			return ARM_MPU_ACCESS_(0U, 1U, 0U, 0U);
+		case MPU_REGIONS_DEVICE:
+			return ARM_MPU_ACCESS_(0U, 1U, 0U, 1U);
+		case MPU_REGIONS_NORMAL_NONCACHEABLE:
+			return ARM_MPU_ACCESS_(1U, shareable, 0U, 0U);
+		case MPU_REGIONS_NORMAL_WRITE_THROUGH:
+			return ARM_MPU_ACCESS_(0U, shareable, 1U, 0U);
+		case MPU_REGIONS_NORMAL_WRITE_BACK:
+		default:
+			return ARM_MPU_ACCESS_(1U, shareable, 1U, 1U);
+	}
+}
+
+/**
+ * @brief  Generate one RBAR/RASR pair per descriptor.
+ * @note   Later regions take precedence where they overlap earlier ones.
+ * @param  desc: region descriptors
+ * @param  count: number of descriptors
+ * @param  firstRegion: MPU region number of desc[0]
+ * @param  table: output, count entries
+ * @retval Number of entries written, 0 when a descriptor cannot be mapped
+ *         or the regions do not fit the MPU
+ */
+uint32_t MpuRegions_Build(const MpuRegions_DescTypeDef *desc, uint32_t count, uint32_t firstRegion,
+		ARM_MPU_Region_t *table)
+{
+	uint32_t regionBase;
+	uint32_t log2Size;
+	uint32_t srd;
+
+	if ((firstRegion + count) > MPU_REGIONS_COUNT)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!MpuRegions_Fit(desc[i].base, desc[i].size, &regionBase, &log2Size, &srd))
+		{
+			return 0;
+		}
+
+		table[i].RBAR = ARM_MPU_RBAR(firstRegion + i, regionBase);
+		table[i].RASR = ARM_MPU_RASR_EX(desc[i].executeNever, desc[i].accessPermission,
+				MpuRegions_Attributes(desc[i].type, desc[i].shareable), srd, log2Size - 1U)
+			| ((srd << MPU_RASR_SRD_Pos) & MPU_RASR_SRD_Msk)
+			| (((log2Size - 1U) << MPU_RASR_SIZE_Pos) & MPU_RASR_SIZE_Msk)
+			| MPU_RASR_ENABLE_Msk;
+	}
+
+	return count;
+}
+
+/**
+ * @brief  Program a region table and enable the MPU, default memory map
+ *         kept as background for privileged code.
+ * @param  table: entries from MpuRegions_Build()
+ * @param  count: number of entries
+ * @retval None
+ */
+void MpuRegions_Load(const ARM_MPU_Region_t *table, uint32_t count)
+{
+	ARM_MPU_Disable();
+	ARM_MPU_Load(table, count);
+	ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+}
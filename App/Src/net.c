@@ -0,0 +1,851 @@
+/**
+  ******************************************************************************
+  * @file    net.c
+  * @brief   ARP, IPv4, ICMP echo and UDP on the EthIf interface.
+  *
+  *          Received frames are parsed in their RX buffer and either
+  *          answered in place (ARP request, echo request), handed on (UDP)
+  *          or freed. The header fields are read byte by byte: the IP
+  *          header of a frame sits 14 bytes into the buffer, 2 bytes off a
+  *          word boundary.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "eth_if.h"
+#include "net.h"
+
+/* Private define ------------------------------------------------------------*/
+#define NET_ETHERTYPE_IP            0x0800U
+#define NET_ETHERTYPE_ARP           0x0806U
+#define NET_ARP_SIZE                28U
+#define NET_ARP_REQUEST             1U
+#define NET_ARP_REPLY               2U
+#define NET_PROTO_ICMP              1U
+#define NET_PROTO_UDP               17U
+#define NET_ICMP_ECHO_REPLY         0U
+#define NET_ICMP_ECHO_REQUEST       8U
+#define NET_IP_DF                   0x4000U
+#define NET_IP_FRAGMENT             0x3FFFU     /* MF and fragment offset */
+
+#define NET_ARP_VALID               0x01U
+#define NET_ARP_STATIC              0x02U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	uint32_t address;
+	uint8_t mac[6];
+	uint8_t flags;                      /* NET_ARP_x */
+} Net_ArpEntryTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t netBroadcastMac[6] = { 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU };
+
+static const uint8_t *netMac;
+static uint32_t netAddress;
+static uint32_t netNetmask;
+static uint32_t netGateway;
+static Net_ArpEntryTypeDef netArpCache[NET_ARP_CACHE_SIZE];
+static uint32_t netArpVictim;
+static Net_UdpSocketTypeDef *netSockets;
+static Net_StatsTypeDef netStats;
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t Net_Get16(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t Net_Get32(const uint8_t *p)
+{
+	return (Net_Get16(p) << 16) | Net_Get16(&p[2]);
+}
+
+static inline void Net_Put16(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)(value >> 8);
+	p[1] = (uint8_t)value;
+}
+
+static inline void Net_Put32(uint8_t *p, uint32_t value)
+{
+	Net_Put16(p, value >> 16);
+	Net_Put16(&p[2], value);
+}
+
+/* Counters shared by the poll task and the sending tasks */
+static inline void Net_Count(uint32_t *counter)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	(*counter)++;
+	__set_PRIMASK(primask);
+}
+
+/* RFC 1071 sum of big-endian 16-bit words, not folded */
+static uint32_t Net_Sum(const uint8_t *data, uint32_t length, uint32_t sum)
+{
+	uint32_t i;
+
+	for (i = 0U; (i + 1U) < length; i += 2U)
+	{
+		sum += Net_Get16(&data[i]);
+	}
+	if (i < length)
+	{
+		sum += (uint32_t)data[i] << 8;
+	}
+	return sum;
+}
+
+/* Folded sum over data holding its own checksum: good if all ones */
+static uint32_t Net_ChecksumOk(const uint8_t *data, uint32_t length, uint32_t sum)
+{
+	sum = Net_Sum(data, length, sum);
+	sum = (sum & 0xFFFFU) + (sum >> 16);
+	sum = (sum & 0xFFFFU) + (sum >> 16);
+	return sum == 0xFFFFU;
+}
+
+static inline uint32_t Net_IsBroadcast(uint32_t address)
+{
+	return (address == NET_IP_BROADCAST) || (address == (netAddress | ~netNetmask));
+}
+
+/* Interrupts masked by the caller */
+static Net_ArpEntryTypeDef *Net_ArpFind(uint32_t address)
+{
+	for (uint32_t i = 0U; i < NET_ARP_CACHE_SIZE; i++)
+	{
+		if (((netArpCache[i].flags & NET_ARP_VALID) != 0U) && (netArpCache[i].address == address))
+		{
+			return &netArpCache[i];
+		}
+	}
+	return NULL;
+}
+
+/* A free entry, else the next learned one round robin; interrupts masked by the caller */
+static Net_ArpEntryTypeDef *Net_ArpSlot(void)
+{
+	for (uint32_t i = 0U; i < NET_ARP_CACHE_SIZE; i++)
+	{
+		if ((netArpCache[i].flags & NET_ARP_VALID) == 0U)
+		{
+			return &netArpCache[i];
+		}
+	}
+	for (uint32_t i = 0U; i < NET_ARP_CACHE_SIZE; i++)
+	{
+		Net_ArpEntryTypeDef *entry = &netArpCache[netArpVictim];
+
+		netArpVictim = (netArpVictim + 1U) % NET_ARP_CACHE_SIZE;
+		if ((entry->flags & NET_ARP_STATIC) == 0U)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/* RFC 826 merge: refresh a known sender, add it if the packet was for us */
+static void Net_ArpLearn(uint32_t address, const uint8_t *mac, uint32_t create)
+{
+	uint32_t primask = __get_PRIMASK();
+	Net_ArpEntryTypeDef *entry;
+
+	__disable_irq();
+	entry = Net_ArpFind(address);
+	if ((entry == NULL) && (create != 0U))
+	{
+		entry = Net_ArpSlot();
+		if (entry != NULL)
+		{
+			entry->address = address;
+			entry->flags = NET_ARP_VALID;
+		}
+	}
+	if ((entry != NULL) && ((entry->flags & NET_ARP_STATIC) == 0U))
+	{
+		memcpy(entry->mac, mac, 6U);
+	}
+	__set_PRIMASK(primask);
+}
+
+static void Net_ArpRequest(uint32_t address)
+{
+	EthPbuf_TypeDef *frame = EthPbuf_Alloc();
+	uint8_t *p;
+
+	if (frame == NULL)
+	{
+		return;
+	}
+	p = frame->payload;
+	memcpy(p, netBroadcastMac, 6U);
+	memcpy(&p[6], netMac, 6U);
+	Net_Put16(&p[12], NET_ETHERTYPE_ARP);
+	p += NET_ETH_HEADER;
+	Net_Put16(&p[0], 1U);
+	Net_Put16(&p[2], NET_ETHERTYPE_IP);
+	p[4] = 6U;
+	p[5] = 4U;
+	Net_Put16(&p[6], NET_ARP_REQUEST);
+	memcpy(&p[8], netMac, 6U);
+	Net_Put32(&p[14], netAddress);
+	memset(&p[18], 0, 6U);
+	Net_Put32(&p[24], address);
+
+	frame->length = frame->totalLength = NET_ETH_HEADER + NET_ARP_SIZE;
+	if (EthIf_Transmit(frame) != HAL_OK)
+	{
+		EthPbuf_Free(frame);
+		return;
+	}
+	Net_Count(&netStats.arpRequests);
+}
+
+/* Destination MAC of an IP address: broadcast, on-link host or gateway */
+static uint32_t Net_Resolve(uint32_t address, uint8_t *mac)
+{
+	uint32_t hop = address;
+
+	if (Net_IsBroadcast(address))
+	{
+		memcpy(mac, netBroadcastMac, 6U);
+		return 1U;
+	}
+	if (((address ^ netAddress) & netNetmask) != 0U)
+	{
+		hop = netGateway;
+	}
+	if (Net_ArpLookup(hop, mac) != 0U)
+	{
+		return 1U;
+	}
+	Net_Count(&netStats.arpUnresolved);
+	Net_ArpRequest(hop);
+	return 0U;
+}
+
+/* Transmit a received frame turned around in place */
+static void Net_Reply(EthPbuf_TypeDef *frame, uint32_t length)
+{
+	memcpy(frame->payload, &frame->payload[6], 6U);
+	memcpy(&frame->payload[6], netMac, 6U);
+	frame->length = frame->totalLength = (uint16_t)length;
+	frame->flags = 0U;
+	if (EthIf_Transmit(frame) != HAL_OK)
+	{
+		EthPbuf_Free(frame);
+	}
+}
+
+static void Net_ArpInput(EthPbuf_TypeDef *frame)
+{
+	uint8_t *arp = &frame->payload[NET_ETH_HEADER];
+	uint32_t sender;
+	uint32_t target;
+
+	if ((frame->length < (NET_ETH_HEADER + NET_ARP_SIZE)) || (Net_Get16(&arp[0]) != 1U)
+			|| (Net_Get16(&arp[2]) != NET_ETHERTYPE_IP) || (arp[4] != 6U) || (arp[5] != 4U))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	sender = Net_Get32(&arp[14]);
+	target = Net_Get32(&arp[24]);
+	Net_ArpLearn(sender, &arp[8], target == netAddress);
+
+	if ((target != netAddress) || (Net_Get16(&arp[6]) != NET_ARP_REQUEST))
+	{
+		EthPbuf_Free(frame);
+		return;
+	}
+	Net_Put16(&arp[6], NET_ARP_REPLY);
+	memcpy(&arp[18], &arp[8], 10U);
+	memcpy(&arp[8], netMac, 6U);
+	Net_Put32(&arp[14], netAddress);
+	Net_Count(&netStats.arpReplies);
+	Net_Reply(frame, NET_ETH_HEADER + NET_ARP_SIZE);
+}
+
+static void Net_IcmpInput(EthPbuf_TypeDef *frame, uint8_t *ip, uint32_t headerLength, uint32_t total)
+{
+	uint8_t *icmp = &ip[headerLength];
+	uint32_t length = total - headerLength;
+
+	if ((length < 8U) || (icmp[0] != NET_ICMP_ECHO_REQUEST) || (Net_Get32(&ip[16]) != netAddress))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	if ((frame->flags & ETH_PBUF_FLAG_L4_CSUM_OK) == 0U)
+	{
+		netStats.checksumSoftware++;
+		if (!Net_ChecksumOk(icmp, length, 0U))
+		{
+			netStats.ipDropped++;
+			EthPbuf_Free(frame);
+			return;
+		}
+	}
+
+	/* Same data back, both checksums left to the MAC */
+	memcpy(&ip[16], &ip[12], 4U);
+	Net_Put32(&ip[12], netAddress);
+	ip[8] = NET_IP_TTL;
+	Net_Put16(&ip[10], 0U);
+	icmp[0] = NET_ICMP_ECHO_REPLY;
+	Net_Put16(&icmp[2], 0U);
+	Net_Count(&netStats.icmpEchoes);
+	Net_Reply(frame, NET_ETH_HEADER + total);
+}
+
+static void Net_UdpInput(EthPbuf_TypeDef *frame, uint8_t *ip, uint32_t headerLength, uint32_t total)
+{
+	uint8_t *udp = &ip[headerLength];
+	uint32_t length = Net_Get16(&udp[4]);
+	uint32_t port;
+	Net_UdpSocketTypeDef *socket;
+	Net_UdpRecvTypeDef recv = NULL;
+	void *context = NULL;
+	Net_EndpointTypeDef from;
+	uint32_t primask;
+
+	if (((total - headerLength) < NET_UDP_HEADER) || (length < NET_UDP_HEADER) || (length > (total - headerLength)))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	if (((frame->flags & ETH_PBUF_FLAG_L4_CSUM_OK) == 0U) && (Net_Get16(&udp[6]) != 0U))
+	{
+		/* Pseudo-header: addresses, protocol, UDP length */
+		uint32_t sum = Net_Sum(&ip[12], 8U, NET_PROTO_UDP + length);
+
+		netStats.checksumSoftware++;
+		if (!Net_ChecksumOk(udp, length, sum))
+		{
+			netStats.ipDropped++;
+			EthPbuf_Free(frame);
+			return;
+		}
+	}
+
+	port = Net_Get16(&udp[2]);
+	primask = __get_PRIMASK();
+	__disable_irq();
+	for (socket = netSockets; socket != NULL; socket = socket->next)
+	{
+		if (socket->localPort == port)
+		{
+			recv = socket->recv;
+			context = socket->context;
+			break;
+		}
+	}
+	__set_PRIMASK(primask);
+	if (recv == NULL)
+	{
+		netStats.udpNoPort++;
+		EthPbuf_Free(frame);
+		return;
+	}
+
+	from.address = Net_Get32(&ip[12]);
+	from.port = (uint16_t)Net_Get16(&udp[0]);
+	frame->payload = &udp[NET_UDP_HEADER];
+	frame->length = frame->totalLength = (uint16_t)(length - NET_UDP_HEADER);
+	netStats.udpRx++;
+	recv(context, frame, &from);
+}
+
+static void Net_IpInput(EthPbuf_TypeDef *frame)
+{
+	uint8_t *ip = &frame->payload[NET_ETH_HEADER];
+	uint32_t available = frame->length - NET_ETH_HEADER;
+	uint32_t headerLength;
+	uint32_t total;
+	uint32_t destination;
+
+	if ((available < NET_IP_HEADER) || ((ip[0] >> 4) != 4U))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	headerLength = (ip[0] & 0x0FU) * 4U;
+	total = Net_Get16(&ip[2]);
+	destination = Net_Get32(&ip[16]);
+	if ((headerLength < NET_IP_HEADER) || (total < headerLength) || (total > available)
+			|| ((Net_Get16(&ip[6]) & NET_IP_FRAGMENT) != 0U)
+			|| ((destination != netAddress) && !Net_IsBroadcast(destination)))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	if ((frame->flags & ETH_PBUF_FLAG_IP_CSUM_OK) == 0U)
+	{
+		netStats.checksumSoftware++;
+		if (!Net_ChecksumOk(ip, headerLength, 0U))
+		{
+			netStats.ipDropped++;
+			EthPbuf_Free(frame);
+			return;
+		}
+	}
+
+	switch (ip[9])
+	{
+	case NET_PROTO_ICMP:
+		Net_IcmpInput(frame, ip, headerLength, total);
+		break;
+	case NET_PROTO_UDP:
+		Net_UdpInput(frame, ip, headerLength, total);
+		break;
+	default:
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		break;
+	}
+}
+
+static void Net_UdpHeader(uint8_t *header, const uint8_t *mac, uint32_t address, uint16_t localPort, uint16_t port)
+{
+	uint8_t *ip = &header[NET_ETH_HEADER];
+	uint8_t *udp = &ip[NET_IP_HEADER];
+
+	memset(header, 0, NET_UDP_HEADROOM);
+	memcpy(header, mac, 6U);
+	memcpy(&header[6], netMac, 6U);
+	Net_Put16(&header[12], NET_ETHERTYPE_IP);
+	ip[0] = 0x45U;
+	Net_Put16(&ip[6], NET_IP_DF);
+	ip[8] = NET_IP_TTL;
+	ip[9] = NET_PROTO_UDP;
+	Net_Put32(&ip[12], netAddress);
+	Net_Put32(&ip[16], address);
+	Net_Put16(&udp[0], localPort);
+	Net_Put16(&udp[2], port);
+}
+
+/* Header in front of the datagram: in its headroom, else (none left, or a
+   payload shared with other frames) in a pbuf of its own */
+static EthPbuf_TypeDef *Net_UdpFrame(Net_UdpSocketTypeDef *socket, const uint8_t *header,
+		EthPbuf_TypeDef *datagram)
+{
+	uint32_t length = datagram->totalLength;
+	EthPbuf_TypeDef *frame = datagram;
+	uint8_t *p;
+
+	if (length > NET_UDP_MAX_PAYLOAD)
+	{
+		return NULL;
+	}
+	if ((datagram->refCount > 1U) || (EthPbuf_Header(datagram, (int32_t)NET_UDP_HEADROOM) != HAL_OK))
+	{
+		frame = EthPbuf_Alloc();
+		if (frame == NULL)
+		{
+			return NULL;
+		}
+		frame->length = frame->totalLength = NET_UDP_HEADROOM;
+		EthPbuf_Cat(frame, datagram);
+	}
+	p = frame->payload;
+	memcpy(p, header, NET_UDP_HEADROOM);
+	Net_Put16(&p[NET_ETH_HEADER + 2U], NET_IP_HEADER + NET_UDP_HEADER + length);
+	Net_Put16(&p[NET_ETH_HEADER + 4U], socket->ipId++);
+	Net_Put16(&p[NET_ETH_HEADER + NET_IP_HEADER + 4U], NET_UDP_HEADER + length);
+	frame->flags = 0U;
+	return frame;
+}
+
+/* Give a datagram back as it came in, after a refused send */
+static void Net_UdpUnframe(EthPbuf_TypeDef *frame, EthPbuf_TypeDef *datagram)
+{
+	if (frame == datagram)
+	{
+		(void)EthPbuf_Header(datagram, -(int32_t)NET_UDP_HEADROOM);
+	}
+	else
+	{
+		frame->next = NULL;
+		EthPbuf_Free(frame);
+	}
+}
+
+static HAL_StatusTypeDef Net_UdpTransmit(Net_UdpSocketTypeDef *socket, const uint8_t *header,
+		EthPbuf_TypeDef *datagram)
+{
+	EthPbuf_TypeDef *frame = Net_UdpFrame(socket, header, datagram);
+
+	if (frame == NULL)
+	{
+		Net_Count(&netStats.txBusy);
+		return HAL_ERROR;
+	}
+	if (EthIf_Transmit(frame) != HAL_OK)
+	{
+		Net_UdpUnframe(frame, datagram);
+		Net_Count(&netStats.txBusy);
+		return HAL_BUSY;
+	}
+	Net_Count(&netStats.udpTx);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Start the stack on the EthIf interface and announce the address
+ *         with a gratuitous ARP request.
+ * @note   Call after EthIf_Init(), then give the frames of type IPv4 and
+ *         ARP to Net_Receive().
+ * @param  address: own IPv4 address
+ * @param  netmask: on-link prefix
+ * @param  gateway: next hop off the prefix, 0 if none
+ * @retval HAL status
+ */
+HAL_StatusTypeDef Net_Init(uint32_t address, uint32_t netmask, uint32_t gateway)
+{
+	if ((address == 0U) || Net_IsBroadcast(address))
+	{
+		return HAL_ERROR;
+	}
+	netMac = EthIf_GetHandle()->Init.MACAddr;
+	netAddress = address;
+	netNetmask = netmask;
+	netGateway = gateway;
+	memset(netArpCache, 0, sizeof(netArpCache));
+	netArpVictim = 0U;
+	netSockets = NULL;
+	memset(&netStats, 0, sizeof(netStats));
+
+	Net_ArpRequest(address);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Handle a received frame.
+ * @param  frame: Ethernet frame from the EthIf RX handler, owned here
+ * @retval None
+ */
+void Net_Receive(EthPbuf_TypeDef *frame)
+{
+	uint32_t type;
+
+	if ((frame->length < NET_ETH_HEADER) || (frame->next != NULL))
+	{
+		netStats.ipDropped++;
+		EthPbuf_Free(frame);
+		return;
+	}
+	type = Net_Get16(&frame->payload[12]);
+	if (type == NET_ETHERTYPE_IP)
+	{
+		Net_IpInput(frame);
+	}
+	else if (type == NET_ETHERTYPE_ARP)
+	{
+		Net_ArpInput(frame);
+	}
+	else
+	{
+		EthPbuf_Free(frame);
+	}
+}
+
+/**
+ * @brief  Add a permanent ARP entry, or make an existing one permanent.
+ * @param  address: IPv4 address
+ * @param  mac: its MAC address
+ * @retval HAL_OK, HAL_ERROR if every entry is permanent already
+ */
+HAL_StatusTypeDef Net_ArpAdd(uint32_t address, const uint8_t *mac)
+{
+	uint32_t primask = __get_PRIMASK();
+	Net_ArpEntryTypeDef *entry;
+
+	__disable_irq();
+	entry = Net_ArpFind(address);
+	if (entry == NULL)
+	{
+		entry = Net_ArpSlot();
+	}
+	if (entry != NULL)
+	{
+		entry->address = address;
+		memcpy(entry->mac, mac, 6U);
+		entry->flags = NET_ARP_VALID | NET_ARP_STATIC;
+	}
+	__set_PRIMASK(primask);
+
+	return (entry != NULL) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief  Look an address up in the ARP cache, without sending a request.
+ * @param  address: IPv4 address
+ * @param  mac: its MAC address, if found
+ * @retval 1 if found, 0 otherwise
+ */
+uint32_t Net_ArpLookup(uint32_t address, uint8_t *mac)
+{
+	uint32_t primask = __get_PRIMASK();
+	const Net_ArpEntryTypeDef *entry;
+
+	__disable_irq();
+	entry = Net_ArpFind(address);
+	if (entry != NULL)
+	{
+		memcpy(mac, entry->mac, 6U);
+	}
+	__set_PRIMASK(primask);
+
+	return entry != NULL;
+}
+
+/**
+ * @brief  Receive the datagrams sent to a local port.
+ * @param  socket: caller-owned socket, unbound
+ * @param  port: local port, not 0
+ * @param  recv: called in the EthIf poll task per datagram, NULL drops them
+ *         (a send-only socket)
+ * @param  context: passed to recv
+ * @retval HAL_OK, HAL_ERROR if the port is taken
+ */
+HAL_StatusTypeDef Net_UdpBind(Net_UdpSocketTypeDef *socket, uint16_t port, Net_UdpRecvTypeDef recv, void *context)
+{
+	uint32_t primask;
+
+	if (port == 0U)
+	{
+		return HAL_ERROR;
+	}
+	socket->localPort = port;
+	socket->recv = recv;
+	socket->context = context;
+	socket->connected = 0U;
+	socket->ipId = 0U;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	for (const Net_UdpSocketTypeDef *s = netSockets; s != NULL; s = s->next)
+	{
+		if (s->localPort == port)
+		{
+			__set_PRIMASK(primask);
+			return HAL_ERROR;
+		}
+	}
+	socket->next = netSockets;
+	netSockets = socket;
+	__set_PRIMASK(primask);
+
+	return HAL_OK;
+}
+
+/**
+ * @brief  Release the local port of a socket.
+ * @param  socket: bound socket
+ * @retval None
+ */
+void Net_UdpUnbind(Net_UdpSocketTypeDef *socket)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	for (Net_UdpSocketTypeDef **link = &netSockets; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == socket)
+		{
+			*link = socket->next;
+			break;
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Fix the destination of Net_UdpSend() and precompute its header.
+ * @note   The destination MAC is resolved now: connect again after an ARP
+ *         change.
+ * @param  socket: bound socket
+ * @param  address: destination address, broadcast allowed
+ * @param  port: destination port
+ * @retval HAL_OK; HAL_BUSY if the next hop is not in the ARP cache, a
+ *         request is sent and the call can be repeated
+ */
+HAL_StatusTypeDef Net_UdpConnect(Net_UdpSocketTypeDef *socket, uint32_t address, uint16_t port)
+{
+	uint8_t mac[6];
+
+	socket->connected = 0U;
+	if (Net_Resolve(address, mac) == 0U)
+	{
+		return HAL_BUSY;
+	}
+	Net_UdpHeader(socket->header, mac, address, socket->localPort, port);
+	socket->remote.address = address;
+	socket->remote.port = port;
+	socket->connected = 1U;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Take a pbuf for a datagram, with room for the headers in front.
+ * @retval pbuf with NET_UDP_HEADROOM bytes before payload and no data,
+ *         NULL if the pool is empty
+ */
+EthPbuf_TypeDef *Net_UdpAlloc(void)
+{
+	EthPbuf_TypeDef *pbuf = EthPbuf_Alloc();
+
+	if (pbuf != NULL)
+	{
+		pbuf->payload += NET_UDP_HEADROOM;
+	}
+	return pbuf;
+}
+
+/**
+ * @brief  Send a datagram to the connected destination.
+ * @note   A datagram from Net_UdpAlloc() gets its headers in place; any
+ *         other pbuf chain (a shared payload) gets a header pbuf in front.
+ *         On HAL_OK the caller's reference goes to the stack, otherwise
+ *         the datagram is given back unchanged.
+ * @param  socket: connected socket
+ * @param  datagram: UDP data, at most NET_UDP_MAX_PAYLOAD bytes
+ * @retval HAL_OK; HAL_BUSY: TX ring full; HAL_ERROR: not connected, too
+ *         long or no pbuf for the header
+ */
+HAL_StatusTypeDef Net_UdpSend(Net_UdpSocketTypeDef *socket, EthPbuf_TypeDef *datagram)
+{
+	if (socket->connected == 0U)
+	{
+		return HAL_ERROR;
+	}
+	return Net_UdpTransmit(socket, socket->header, datagram);
+}
+
+/**
+ * @brief  Send several datagrams to the connected destination, queued
+ *         NET_UDP_BATCH_MAX at a time by EthIf_TransmitBatch().
+ * @param  socket: connected socket
+ * @param  datagrams: as for Net_UdpSend()
+ * @param  count: datagrams
+ * @retval datagrams sent: the first ones, the caller keeps the others
+ */
+uint32_t Net_UdpSendBatch(Net_UdpSocketTypeDef *socket, EthPbuf_TypeDef *const *datagrams, uint32_t count)
+{
+	EthPbuf_TypeDef *frames[NET_UDP_BATCH_MAX];
+	uint32_t sent = 0U;
+
+	if (socket->connected == 0U)
+	{
+		return 0U;
+	}
+	while (sent < count)
+	{
+		uint32_t built = 0U;
+		uint32_t queued;
+
+		while ((built < NET_UDP_BATCH_MAX) && ((sent + built) < count))
+		{
+			frames[built] = Net_UdpFrame(socket, socket->header, datagrams[sent + built]);
+			if (frames[built] == NULL)
+			{
+				break;
+			}
+			built++;
+		}
+		queued = (built != 0U) ? EthIf_TransmitBatch(frames, built) : 0U;
+		for (uint32_t i = queued; i < built; i++)
+		{
+			Net_UdpUnframe(frames[i], datagrams[sent + i]);
+		}
+		sent += queued;
+		if ((queued < built) || (built < NET_UDP_BATCH_MAX))
+		{
+			break;
+		}
+	}
+
+	{
+		uint32_t primask = __get_PRIMASK();
+
+		__disable_irq();
+		netStats.udpTx += sent;
+		netStats.txBusy += count - sent;
+		__set_PRIMASK(primask);
+	}
+	return sent;
+}
+
+/**
+ * @brief  Send a datagram to any destination, the header built on the
+ *         way: for replies and occasional traffic.
+ * @param  socket: bound socket, its local port is the source port
+ * @param  to: destination
+ * @param  datagram: as for Net_UdpSend()
+ * @retval as Net_UdpSend(), HAL_BUSY also while the next hop is resolved
+ */
+HAL_StatusTypeDef Net_UdpSendTo(Net_UdpSocketTypeDef *socket, const Net_EndpointTypeDef *to,
+		EthPbuf_TypeDef *datagram)
+{
+	uint8_t header[NET_UDP_HEADROOM];
+	uint8_t mac[6];
+
+	if (Net_Resolve(to->address, mac) == 0U)
+	{
+		return HAL_BUSY;
+	}
+	Net_UdpHeader(header, mac, to->address, socket->localPort, to->port);
+	return Net_UdpTransmit(socket, header, datagram);
+}
+
+/**
+ * @brief  Snapshot of the stack counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void Net_GetStats(Net_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = netStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the stack counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void Net_Dump(Net_PutCharTypeDef putChar)
+{
+	Net_StatsTypeDef stats;
+	char line[200];
+
+	Net_GetStats(&stats);
+	snprintf(line, sizeof(line),
+		"net udp rx=%lu tx=%lu noport=%lu busy=%lu icmp=%lu arp req=%lu rep=%lu unres=%lu drop=%lu swcsum=%lu\r\n",
+		(unsigned long)stats.udpRx, (unsigned long)stats.udpTx, (unsigned long)stats.udpNoPort,
+		(unsigned long)stats.txBusy, (unsigned long)stats.icmpEchoes, (unsigned long)stats.arpRequests,
+		(unsigned long)stats.arpReplies, (unsigned long)stats.arpUnresolved, (unsigned long)stats.ipDropped,
+		(unsigned long)stats.checksumSoftware);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file    profile.c
+  * @brief   DWT cycle-counter profiling probes and latency histograms.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "mem_section.h"
+#include "profile.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t bucket[PROFILE_BUCKETS];
+} Profile_HistTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define DWT_LAR_UNLOCK_KEY      0xC5ACCE55U
+
+/* Private variables ---------------------------------------------------------*/
+static Profile_HistTypeDef profileHist[PROFILE_ID_COUNT] DTCM_BSS;
+
+static const char * const profileName[PROFILE_ID_COUNT] =
+{
+	[PROFILE_ID_SYSTICK_IRQ]       = "SysTick_IRQ",
+	[PROFILE_ID_USART1_ENQUEUE]    = "USART1_Enqueue",
+	[PROFILE_ID_USART1_IRQ]        = "USART1_IRQ",
+	[PROFILE_ID_USART1_RX_DMA_IRQ] = "USART1_RxDMA_IRQ",
+	[PROFILE_ID_USART1_TX_DMA_IRQ] = "USART1_TxDMA_IRQ",
+	[PROFILE_ID_GPIO_TOGGLE]       = "GPIO_Toggle",
+};
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Profile_BucketIndex(uint32_t cycles)
+{
+	uint32_t msb;
+
+	if (cycles < PROFILE_SUB_BUCKETS)
+	{
+		return cycles;
+	}
+
+	msb = 31U - __CLZ(cycles);
+	return ((msb - 1U) << 2) + ((cycles >> (msb - 2U)) & (PROFILE_SUB_BUCKETS - 1U));
+}
+
+static uint32_t Profile_BucketUpper(uint32_t index)
+{
+	uint32_t shift;
+
+	if (index < PROFILE_SUB_BUCKETS)
+	{
+		return index;
+	}
+
+	shift = (index >> 2) - 1U;
+	return ((PROFILE_SUB_BUCKETS + (index & 3U) + 1U) << shift) - 1U;
+}
+
+static uint32_t Profile_Percentile(const Profile_HistTypeDef *hist, uint32_t percent)
+{
+	uint32_t rank = (uint32_t)(((uint64_t)hist->count * percent + 99U) / 100U);
+	uint32_t seen = 0;
+	uint32_t value = hist->max;
+
+	for (uint32_t i = 0; i < PROFILE_BUCKETS; i++)
+	{
+		seen += hist->bucket[i];
+		if (seen >= rank)
+		{
+			value = Profile_BucketUpper(i);
+			break;
+		}
+	}
+
+	/* The bucket bound is only an estimate, never report outside [min, max] */
+	if (value > hist->max)
+	{
+		value = hist->max;
+	}
+	if (value < hist->min)
+	{
+		value = hist->min;
+	}
+	return value;
+}
+
+/**
+ * @brief  Enable the DWT cycle counter and clear all histograms.
+ * @note   Called from SystemClock_Config() once the core clock is final.
+ * @retval None
+ */
+void Profile_Init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = DWT_LAR_UNLOCK_KEY;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Profile_Reset();
+}
+
+/**
+ * @brief  Clear all histograms.
+ * @retval None
+ */
+void Profile_Reset(void)
+{
+	memset(profileHist, 0, sizeof(profileHist));
+	for (uint32_t i = 0; i < PROFILE_ID_COUNT; i++)
+	{
+		profileHist[i].min = UINT32_MAX;
+	}
+}
+
+/**
+ * @brief  Add one latency sample to a probe histogram.
+ * @param  id: probe identifier
+ * @param  cycles: measured duration in core clock cycles
+ * @retval None
+ */
+ITCM_TEXT void Profile_Record(Profile_IdTypeDef id, uint32_t cycles)
+{
+	Profile_HistTypeDef *hist = &profileHist[id];
+
+	hist->count++;
+	hist->total += cycles;
+	if (cycles < hist->min)
+	{
+		hist->min = cycles;
+	}
+	if (cycles > hist->max)
+	{
+		hist->max = cycles;
+	}
+	hist->bucket[Profile_BucketIndex(cycles)]++;
+}
+
+/**
+ * @brief  Aggregate a probe histogram.
+ * @param  id: probe identifier
+ * @param  stats: filled with count/min/max/p50/p99/total, all zero if empty
+ * @retval None
+ */
+void Profile_GetStats(Profile_IdTypeDef id, Profile_StatsTypeDef *stats)
+{
+	const Profile_HistTypeDef *hist = &profileHist[id];
+
+	memset(stats, 0, sizeof(*stats));
+	if (hist->count == 0U)
+	{
+		return;
+	}
+
+	stats->count = hist->count;
+	stats->min = hist->min;
+	stats->max = hist->max;
+	stats->total = hist->total;
+	stats->p50 = Profile_Percentile(hist, 50U);
+	stats->p99 = Profile_Percentile(hist, 99U);
+}
+
+/**
+ * @brief  Print one line of statistics per probe.
+ * @param  putChar: character output, e.g. blocking USART1 transmit
+ * @retval None
+ */
+void Profile_Dump(Profile_PutCharTypeDef putChar)
+{
+	Profile_StatsTypeDef stats;
+	char line[96];
+
+	for (uint32_t i = 0; i < PROFILE_ID_COUNT; i++)
+	{
+		Profile_GetStats((Profile_IdTypeDef)i, &stats);
+		snprintf(line, sizeof(line), "%-16s n=%lu min=%lu p50=%lu p99=%lu max=%lu\r\n",
+			profileName[i], (unsigned long)stats.count, (unsigned long)stats.min,
+			(unsigned long)stats.p50, (unsigned long)stats.p99, (unsigned long)stats.max);
+
+		for (const char *p = line; *p != '\0'; p++)
+		{
+			putChar(*p);
+		}
+	}
+}
@@ -0,0 +1,725 @@
+/**
+  ******************************************************************************
+  * @file    ptp.c
+  * @brief   IEEE 1588 ordinary clock slave on the ETH MAC time stamp unit.
+  *
+  *          The time stamp counter runs in digital rollover mode (the
+  *          subsecond register counts nanoseconds) with fine update: it
+  *          adds PTP_UPDATE_HZ increments of 10 ns per second when the
+  *          addend is ptpAddendBase, so a correction of ppb parts per
+  *          billion is an addend of ptpAddendBase * (1 + ppb / 1e9).
+  *          Times are handled as signed 64-bit nanoseconds since the PTP
+  *          epoch.
+  *          The offset and delay of a sample follow IEEE 1588 11.3:
+  *              offset = t2 - t1 - meanPathDelay
+  *              delay  = ((t2 - t1) + (t4 - t3)) / 2
+  *          with t1/t2 the Sync origin/receive times (corrections added to
+  *          t1) and t3/t4 the Delay_Req send/receive times (corrections
+  *          removed from t4). A step moves the stored t2 with the clock, so
+  *          the pending delay measurement stays consistent.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "eth_filter.h"
+#include "eth_if.h"
+#include "ptp.h"
+#include "ptp_servo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PTP_NS_PER_S                1000000000LL
+#define PTP_VERSION                 2U
+#define PTP_ETH_HEADER              14U
+#define PTP_DELAY_RESP_SIZE         54U
+#define PTP_ANNOUNCE_SIZE           64U
+#define PTP_CONTROL_DELAY_REQ       1U
+#define PTP_LOG_INTERVAL_NONE       0x7FU
+#define PTP_TIMEOUT_MS              10U     /* time stamp unit command bits */
+#define PTP_DELAY_FILTER_SHIFT      3U      /* mean path delay: average with weight 1/8 */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	int64_t timestamp;
+	uint16_t sequenceId;
+	uint8_t type;
+} Ptp_CaptureTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t ptpMulticast[6] = { 0x01U, 0x1BU, 0x19U, 0x00U, 0x00U, 0x00U };
+
+static ETH_HandleTypeDef *ptpHandle;
+static uint32_t ptpAddendBase;
+static Ptp_PortIdentityTypeDef ptpPort;
+static Ptp_PortIdentityTypeDef ptpMaster;
+static PtpServo_TypeDef ptpServo;
+static int32_t ptpServoLogInterval;
+static Ptp_StatsTypeDef ptpStats;
+static int64_t ptpOffsetSum;                /* locked samples, for the statistics */
+static uint64_t ptpOffsetSquares;
+static uint32_t ptpAnnounceTimeout;         /* ms */
+static uint32_t ptpAnnounceAge;             /* ms since the master's last Announce */
+static uint32_t ptpLastTick;
+
+/* Two-step Sync waiting for its Follow_Up */
+static uint32_t ptpSyncPending;
+static uint16_t ptpSyncSequence;
+static int64_t ptpSyncCorrection;
+static int64_t ptpSyncReceive;
+
+/* Last sample, master to slave leg of the delay measurement */
+static uint32_t ptpSampleValid;
+static int64_t ptpT1;
+static int64_t ptpT2;
+
+/* Delay_Req in flight */
+static uint32_t ptpDelayPending;
+static uint16_t ptpDelaySequence;
+static uint32_t ptpDelayValid;
+
+/* Transmit time stamps, written by the TX PTP callback */
+static Ptp_CaptureTypeDef ptpTxRing[PTP_TX_RING_SIZE];
+static volatile uint32_t ptpTxHead;
+static volatile uint32_t ptpTxTail;
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint16_t Ptp_Get16(const uint8_t *p)
+{
+	return (uint16_t)(((uint32_t)p[0] << 8) | p[1]);
+}
+
+static inline void Ptp_Put16(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)(value >> 8);
+	p[1] = (uint8_t)value;
+}
+
+static inline uint32_t Ptp_Get32(const uint8_t *p)
+{
+	return ((uint32_t)Ptp_Get16(p) << 16) | Ptp_Get16(&p[2]);
+}
+
+/* Timestamp: 48-bit seconds, 32-bit nanoseconds */
+static int64_t Ptp_GetTimestamp(const uint8_t *p)
+{
+	uint64_t seconds = ((uint64_t)Ptp_Get16(p) << 32) | Ptp_Get32(&p[2]);
+
+	return ((int64_t)seconds * PTP_NS_PER_S) + Ptp_Get32(&p[6]);
+}
+
+static inline int64_t Ptp_Time(uint32_t seconds, uint32_t nanoseconds)
+{
+	return ((int64_t)seconds * PTP_NS_PER_S) + nanoseconds;
+}
+
+static inline int Ptp_SamePort(const Ptp_PortIdentityTypeDef *a, const Ptp_PortIdentityTypeDef *b)
+{
+	return (a->portNumber == b->portNumber) && (memcmp(a->clockIdentity, b->clockIdentity, 8U) == 0);
+}
+
+static uint32_t Ptp_Sqrt(uint64_t value)
+{
+	uint64_t root = 0U;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value)
+	{
+		bit >>= 2;
+	}
+	while (bit != 0U)
+	{
+		if (value >= (root + bit))
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)root;
+}
+
+/* A time stamp unit command is done when its bit reads back clear */
+static HAL_StatusTypeDef Ptp_WaitCommand(uint32_t bits)
+{
+	uint32_t tickstart = HAL_GetTick();
+
+	while ((ptpHandle->Instance->PTPTSCR & bits) != 0U)
+	{
+		if ((HAL_GetTick() - tickstart) > PTP_TIMEOUT_MS)
+		{
+			return HAL_TIMEOUT;
+		}
+	}
+	return HAL_OK;
+}
+
+/* Fine correction: the addend sets the counter rate */
+static void Ptp_ClockAdjust(int32_t ppb)
+{
+	int64_t addend = (int64_t)ptpAddendBase + (((int64_t)ptpAddendBase * ppb) / PTP_NS_PER_S);
+
+	if (Ptp_WaitCommand(ETH_PTPTSCR_TSARU) != HAL_OK)
+	{
+		return;
+	}
+	ptpHandle->Instance->PTPTSAR = (uint32_t)addend;
+	__HAL_ETH_SET_PTP_CONTROL(ptpHandle, ETH_PTPTSCR_TSARU);
+	ptpStats.ppb = ppb;
+}
+
+static void Ptp_ClockStep(int64_t delta)
+{
+	uint64_t magnitude = (uint64_t)((delta < 0) ? -delta : delta);
+	ETH_TimeTypeDef offset;
+
+	offset.Seconds = (uint32_t)(magnitude / PTP_NS_PER_S);
+	offset.NanoSeconds = (uint32_t)(magnitude % PTP_NS_PER_S);
+	if ((Ptp_WaitCommand(ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU) != HAL_OK)
+			|| (HAL_ETH_PTP_AddTimeOffset(ptpHandle, (delta < 0) ? HAL_ETH_PTP_NEGATIVE_UPDATE
+				: HAL_ETH_PTP_POSITIVE_UPDATE, &offset) != HAL_OK))
+	{
+		return;
+	}
+	/* AddTimeOffset() only loads the update registers */
+	__HAL_ETH_SET_PTP_CONTROL(ptpHandle, ETH_PTPTSCR_TSSTU);
+	(void)Ptp_WaitCommand(ETH_PTPTSCR_TSSTU);
+	ptpStats.steps++;
+}
+
+/* HAL TX PTP callback: the frame is sent, timestamp holds TDES6/TDES7 */
+static void Ptp_TxTimestamp(uint32_t *buff, ETH_TimeStampTypeDef *timestamp)
+{
+	const EthPbuf_TypeDef *frame = (const EthPbuf_TypeDef *)buff;
+	uint32_t head = ptpTxHead;
+	Ptp_CaptureTypeDef *capture;
+
+	if (((frame->flags & ETH_PBUF_FLAG_TX_TIMESTAMP) == 0U) || ((head - ptpTxTail) == PTP_TX_RING_SIZE))
+	{
+		return;
+	}
+	capture = &ptpTxRing[head % PTP_TX_RING_SIZE];
+	capture->type = frame->payload[PTP_ETH_HEADER] & 0x0FU;
+	capture->sequenceId = Ptp_Get16(&frame->payload[PTP_ETH_HEADER + 30U]);
+	capture->timestamp = Ptp_Time(timestamp->TimeStampHigh, timestamp->TimeStampLow);
+	ptpTxHead = head + 1U;
+}
+
+/* Send time of a Delay_Req, older captures are dropped on the way */
+static uint32_t Ptp_TakeTxTimestamp(uint16_t sequenceId, int64_t *timestamp)
+{
+	while (ptpTxTail != ptpTxHead)
+	{
+		const Ptp_CaptureTypeDef *capture = &ptpTxRing[ptpTxTail % PTP_TX_RING_SIZE];
+
+		ptpTxTail++;
+		if ((capture->type == PTP_MSG_DELAY_REQ) && (capture->sequenceId == sequenceId))
+		{
+			*timestamp = capture->timestamp;
+			return 1U;
+		}
+	}
+	return 0U;
+}
+
+static void Ptp_Unlock(void)
+{
+	ptpSyncPending = 0U;
+	ptpSampleValid = 0U;
+	ptpDelayPending = 0U;
+	ptpDelayValid = 0U;
+	ptpStats.pathDelay = 0;
+	PtpServo_Reset(&ptpServo);
+}
+
+static void Ptp_SendDelayReq(void)
+{
+	EthPbuf_TypeDef *frame = EthPbuf_Alloc();
+	uint8_t *p;
+
+	if (frame == NULL)
+	{
+		return;
+	}
+	p = frame->payload;
+	memset(p, 0, PTP_ETH_HEADER + PTP_DELAY_REQ_SIZE);
+	memcpy(p, ptpMulticast, sizeof(ptpMulticast));
+	memcpy(&p[6], ptpHandle->Init.MACAddr, 6U);
+	Ptp_Put16(&p[12], PTP_ETHERTYPE);
+
+	p += PTP_ETH_HEADER;
+	p[0] = PTP_MSG_DELAY_REQ;
+	p[1] = PTP_VERSION;
+	Ptp_Put16(&p[2], PTP_DELAY_REQ_SIZE);
+	p[4] = PTP_DOMAIN;
+	memcpy(&p[20], ptpPort.clockIdentity, 8U);
+	Ptp_Put16(&p[28], ptpPort.portNumber);
+	Ptp_Put16(&p[30], (uint16_t)(ptpDelaySequence + 1U));
+	p[32] = PTP_CONTROL_DELAY_REQ;
+	p[33] = PTP_LOG_INTERVAL_NONE;
+	/* originTimestamp stays zero, the time stamp unit gives t3 */
+
+	frame->length = frame->totalLength = PTP_ETH_HEADER + PTP_DELAY_REQ_SIZE;
+	frame->flags = ETH_PBUF_FLAG_TX_TIMESTAMP;
+	if (EthIf_Transmit(frame) != HAL_OK)
+	{
+		EthPbuf_Free(frame);
+		return;
+	}
+	ptpDelaySequence++;
+	ptpDelayPending = 1U;
+	ptpStats.delayReqs++;
+}
+
+static void Ptp_Accumulate(int64_t offset)
+{
+	int64_t mean;
+	uint64_t meanSquare;
+
+	if ((ptpStats.samples == 0U) || (offset < ptpStats.offsetMin))
+	{
+		ptpStats.offsetMin = offset;
+	}
+	if ((ptpStats.samples == 0U) || (offset > ptpStats.offsetMax))
+	{
+		ptpStats.offsetMax = offset;
+	}
+	ptpStats.samples++;
+	ptpOffsetSum += offset;
+	ptpOffsetSquares += (uint64_t)(offset * offset);
+
+	mean = ptpOffsetSum / (int64_t)ptpStats.samples;
+	meanSquare = ptpOffsetSquares / ptpStats.samples;
+	ptpStats.offsetMean = mean;
+	ptpStats.offsetRms = Ptp_Sqrt(meanSquare);
+	ptpStats.jitter = Ptp_Sqrt((meanSquare > (uint64_t)(mean * mean)) ? (meanSquare - (uint64_t)(mean * mean)) : 0U);
+}
+
+/* One offset measurement: t1 master time, t2 slave time */
+static void Ptp_Sample(int64_t t1, int64_t t2, int8_t logInterval)
+{
+	int64_t offset = t2 - t1 - ptpStats.pathDelay;
+	int32_t ppb = ptpStats.ppb;
+
+	if (logInterval != ptpServoLogInterval)
+	{
+		int64_t drift = ptpServo.drift;
+
+		PtpServo_Init(&ptpServo, logInterval);
+		ptpServo.drift = drift;
+		ptpServoLogInterval = logInterval;
+	}
+
+	ptpStats.offset = offset;
+	ptpT1 = t1;
+	ptpT2 = t2;
+	ptpSampleValid = 1U;
+
+	switch (PtpServo_Sample(&ptpServo, offset, t2, &ppb))
+	{
+	case PTP_SERVO_JUMP:
+		Ptp_ClockStep(-offset);
+		ptpT2 -= offset;
+		ptpDelayPending = 0U;
+		Ptp_ClockAdjust(ppb);
+		ptpStats.state = PTP_STATE_UNCALIBRATED;
+		break;
+
+	case PTP_SERVO_LOCKED:
+		Ptp_ClockAdjust(ppb);
+		ptpStats.state = PTP_STATE_SLAVE;
+		Ptp_Accumulate(offset);
+		break;
+
+	default:
+		ptpStats.state = PTP_STATE_UNCALIBRATED;
+		break;
+	}
+
+	Ptp_SendDelayReq();
+}
+
+static void Ptp_Announce(const Ptp_MessageTypeDef *message)
+{
+	int32_t log = message->logInterval;
+
+	if (ptpStats.state == PTP_STATE_LISTENING)
+	{
+		ptpMaster = message->source;
+		Ptp_Unlock();
+		ptpStats.state = PTP_STATE_UNCALIBRATED;
+	}
+	else if (!Ptp_SamePort(&message->source, &ptpMaster))
+	{
+		ptpStats.ignored++;
+		return;
+	}
+	ptpStats.announces++;
+	ptpAnnounceAge = 0U;
+
+	log = (log < -3) ? -3 : ((log > 4) ? 4 : log);
+	ptpAnnounceTimeout = PTP_ANNOUNCE_RECEIPT_TIMEOUT * ((log >= 0) ? (1000UL << log) : (1000UL >> -log));
+}
+
+static void Ptp_Sync(const Ptp_MessageTypeDef *message, int64_t receive)
+{
+	ptpStats.syncs++;
+	if ((message->flags & PTP_FLAG_TWO_STEP) != 0U)
+	{
+		ptpSyncPending = 1U;
+		ptpSyncSequence = message->sequenceId;
+		ptpSyncCorrection = message->correction;
+		ptpSyncReceive = receive;
+		return;
+	}
+	ptpSyncPending = 0U;
+	Ptp_Sample(message->timestamp + message->correction, receive, message->logInterval);
+}
+
+static void Ptp_FollowUp(const Ptp_MessageTypeDef *message)
+{
+	if ((ptpSyncPending == 0U) || (message->sequenceId != ptpSyncSequence))
+	{
+		ptpStats.ignored++;
+		return;
+	}
+	ptpStats.followUps++;
+	ptpSyncPending = 0U;
+	Ptp_Sample(message->timestamp + message->correction + ptpSyncCorrection, ptpSyncReceive,
+		message->logInterval);
+}
+
+static void Ptp_DelayResp(const Ptp_MessageTypeDef *message)
+{
+	int64_t t3;
+	int64_t t4 = message->timestamp - message->correction;
+	int64_t delay;
+
+	if ((ptpDelayPending == 0U) || (message->sequenceId != ptpDelaySequence)
+			|| !Ptp_SamePort(&message->requesting, &ptpPort))
+	{
+		ptpStats.ignored++;
+		return;
+	}
+	ptpStats.delayResps++;
+	ptpDelayPending = 0U;
+	if (Ptp_TakeTxTimestamp(message->sequenceId, &t3) == 0U)
+	{
+		ptpStats.txTimestampMissing++;
+		return;
+	}
+	if (ptpSampleValid == 0U)
+	{
+		return;
+	}
+
+	delay = ((ptpT2 - ptpT1) + (t4 - t3)) / 2;
+	if (ptpDelayValid == 0U)
+	{
+		ptpStats.pathDelay = delay;
+		ptpDelayValid = 1U;
+	}
+	else
+	{
+		ptpStats.pathDelay += (delay - ptpStats.pathDelay) / (1 << PTP_DELAY_FILTER_SHIFT);
+	}
+}
+
+/**
+ * @brief  Start the time stamp unit and the slave port on the EthIf
+ *         interface.
+ * @note   Call after EthIf_Init(), with SystemCoreClock set. The PTP
+ *         group address is subscribed in the MAC address filter.
+ * @retval HAL status
+ */
+HAL_StatusTypeDef Ptp_Init(void)
+{
+	ETH_PTP_ConfigTypeDef config;
+	const uint8_t *mac;
+
+	ptpHandle = EthIf_GetHandle();
+	if (SystemCoreClock <= PTP_UPDATE_HZ)
+	{
+		return HAL_ERROR;
+	}
+	ptpAddendBase = (uint32_t)(((uint64_t)PTP_UPDATE_HZ << 32) / SystemCoreClock);
+
+	/* EUI-64 clock identity from the MAC address */
+	mac = ptpHandle->Init.MACAddr;
+	ptpPort.clockIdentity[0] = mac[0];
+	ptpPort.clockIdentity[1] = mac[1];
+	ptpPort.clockIdentity[2] = mac[2];
+	ptpPort.clockIdentity[3] = 0xFFU;
+	ptpPort.clockIdentity[4] = 0xFEU;
+	ptpPort.clockIdentity[5] = mac[3];
+	ptpPort.clockIdentity[6] = mac[4];
+	ptpPort.clockIdentity[7] = mac[5];
+	ptpPort.portNumber = 1U;
+
+	memset(&ptpStats, 0, sizeof(ptpStats));
+	ptpOffsetSum = 0;
+	ptpOffsetSquares = 0U;
+	ptpAnnounceAge = 0U;
+	ptpLastTick = 0U;
+	ptpDelaySequence = 0U;
+	ptpTxHead = 0U;
+	ptpTxTail = 0U;
+	PtpServo_Init(&ptpServo, 0);
+	ptpServoLogInterval = 0;
+	Ptp_Unlock();
+
+	memset(&config, 0, sizeof(config));
+	config.Timestamp = ENABLE;
+	config.TimestampUpdateMode = ENABLE;            /* fine update through the addend */
+	config.TimestampUpdate = ENABLE;
+	config.TimestampRolloverMode = ENABLE;          /* subseconds in ns */
+	config.TimestampV2 = ENABLE;
+	config.TimestampEthernet = ENABLE;
+	config.TimestampEvent = ENABLE;
+	config.TimestampAddend = ptpAddendBase;
+	config.TimestampSubsecondInc = (uint32_t)(PTP_NS_PER_S / PTP_UPDATE_HZ);
+	/* The HAL waits on TSARU without a timeout: latch the addend here */
+	config.TimestampAddendUpdate = DISABLE;
+
+	if ((HAL_ETH_PTP_SetConfig(ptpHandle, &config) != HAL_OK)
+			|| (EthFilter_Subscribe(ptpMulticast) != HAL_OK)
+			|| (HAL_ETH_RegisterTxPtpCallback(ptpHandle, Ptp_TxTimestamp) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	Ptp_ClockAdjust(0);
+
+	return HAL_OK;
+}
+
+/**
+ * @brief  Decode a PTP message.
+ * @param  data: PTP header onwards
+ * @param  length: bytes at data
+ * @param  message: decoded fields; the body fields of the types not
+ *         listed in ptp.h are left zero
+ * @retval 1 if data is a well-formed PTPv2 message, 0 otherwise
+ */
+uint32_t Ptp_ParseMessage(const uint8_t *data, uint32_t length, Ptp_MessageTypeDef *message)
+{
+	uint32_t needed = PTP_HEADER_SIZE;
+
+	memset(message, 0, sizeof(*message));
+	if ((length < PTP_HEADER_SIZE) || ((data[1] & 0x0FU) != PTP_VERSION))
+	{
+		return 0U;
+	}
+	message->type = data[0] & 0x0FU;
+	message->length = Ptp_Get16(&data[2]);
+	message->domain = data[4];
+	message->flags = Ptp_Get16(&data[6]);
+	/* 2^-16 ns units, the arithmetic shift floors */
+	message->correction = (int64_t)(((uint64_t)Ptp_Get32(&data[8]) << 32) | Ptp_Get32(&data[12])) >> 16;
+	memcpy(message->source.clockIdentity, &data[20], 8U);
+	message->source.portNumber = Ptp_Get16(&data[28]);
+	message->sequenceId = Ptp_Get16(&data[30]);
+	message->logInterval = (int8_t)data[33];
+
+	switch (message->type)
+	{
+	case PTP_MSG_SYNC:
+	case PTP_MSG_DELAY_REQ:
+	case PTP_MSG_FOLLOW_UP:
+		needed = PTP_DELAY_REQ_SIZE;
+		break;
+	case PTP_MSG_DELAY_RESP:
+		needed = PTP_DELAY_RESP_SIZE;
+		break;
+	case PTP_MSG_ANNOUNCE:
+		needed = PTP_ANNOUNCE_SIZE;
+		break;
+	default:
+		break;
+	}
+	if ((message->length < needed) || (message->length > length))
+	{
+		return 0U;
+	}
+	if (needed >= PTP_DELAY_REQ_SIZE)
+	{
+		message->timestamp = Ptp_GetTimestamp(&data[PTP_HEADER_SIZE]);
+	}
+	if (message->type == PTP_MSG_DELAY_RESP)
+	{
+		memcpy(message->requesting.clockIdentity, &data[44], 8U);
+		message->requesting.portNumber = Ptp_Get16(&data[52]);
+	}
+	return 1U;
+}
+
+/**
+ * @brief  Handle a received PTP frame.
+ * @note   Call from the EthIf RX handler, before the next frame is read:
+ *         the receive time stamp is the one of the last frame the HAL
+ *         took from the ring.
+ * @param  frame: Ethernet frame of type PTP_ETHERTYPE, freed here
+ * @retval None
+ */
+void Ptp_Receive(EthPbuf_TypeDef *frame)
+{
+	Ptp_MessageTypeDef message;
+	ETH_TimeStampTypeDef stamp;
+	int64_t receive = 0;
+	uint32_t stamped = 0U;
+
+	if (((frame->flags & ETH_PBUF_FLAG_RX_TIMESTAMP) != 0U)
+			&& (HAL_ETH_PTP_GetRxTimestamp(ptpHandle, &stamp) == HAL_OK))
+	{
+		/* HAL_ETH_ReadData() keeps RDES6 (ns) as TimeStampHigh and RDES7
+		   (seconds) as TimeStampLow, the other way round from TX */
+		receive = Ptp_Time(stamp.TimeStampLow, stamp.TimeStampHigh);
+		stamped = 1U;
+	}
+
+	if ((frame->length <= PTP_ETH_HEADER)
+			|| (Ptp_ParseMessage(&frame->payload[PTP_ETH_HEADER], frame->length - PTP_ETH_HEADER, &message) == 0U)
+			|| (message.domain != PTP_DOMAIN)
+			|| ((message.type != PTP_MSG_ANNOUNCE) && ((ptpStats.state == PTP_STATE_LISTENING)
+				|| !Ptp_SamePort(&message.source, &ptpMaster))))
+	{
+		ptpStats.ignored++;
+		EthPbuf_Free(frame);
+		return;
+	}
+
+	switch (message.type)
+	{
+	case PTP_MSG_ANNOUNCE:
+		Ptp_Announce(&message);
+		break;
+	case PTP_MSG_SYNC:
+		if (stamped != 0U)
+		{
+			Ptp_Sync(&message, receive);
+		}
+		else
+		{
+			ptpStats.ignored++;
+		}
+		break;
+	case PTP_MSG_FOLLOW_UP:
+		Ptp_FollowUp(&message);
+		break;
+	case PTP_MSG_DELAY_RESP:
+		Ptp_DelayResp(&message);
+		break;
+	default:
+		ptpStats.ignored++;
+		break;
+	}
+	EthPbuf_Free(frame);
+}
+
+/**
+ * @brief  Announce receipt timeout: drop a master gone silent.
+ * @param  nowMs: millisecond tick, called at least once per Announce
+ *         interval
+ * @retval None
+ */
+void Ptp_Tick(uint32_t nowMs)
+{
+	uint32_t elapsed = nowMs - ptpLastTick;
+
+	ptpLastTick = nowMs;
+	if (ptpStats.state == PTP_STATE_LISTENING)
+	{
+		return;
+	}
+	ptpAnnounceAge += elapsed;
+	if (ptpAnnounceAge > ptpAnnounceTimeout)
+	{
+		Ptp_Unlock();
+		ptpStats.state = PTP_STATE_LISTENING;
+	}
+}
+
+/**
+ * @brief  Current time of the PTP clock.
+ * @retval ns since the PTP epoch, 0 before Ptp_Init()
+ */
+int64_t Ptp_GetTime(void)
+{
+	ETH_TimeTypeDef time;
+
+	if ((ptpHandle == NULL) || (HAL_ETH_PTP_GetTime(ptpHandle, &time) != HAL_OK))
+	{
+		return 0;
+	}
+	/* Two register reads: take them again across a second boundary */
+	if (ptpHandle->Instance->PTPTSHR != time.Seconds)
+	{
+		(void)HAL_ETH_PTP_GetTime(ptpHandle, &time);
+	}
+	return Ptp_Time(time.Seconds, time.NanoSeconds);
+}
+
+/**
+ * @brief  Snapshot of the port state and offset statistics.
+ * @param  stats: destination
+ * @retval None
+ */
+void Ptp_GetStats(Ptp_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = ptpStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Restart the offset statistics (samples, min/max, mean, RMS,
+ *         jitter), the message counters keep running.
+ * @retval None
+ */
+void Ptp_ClearStats(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	ptpStats.samples = 0U;
+	ptpStats.offsetMin = 0;
+	ptpStats.offsetMax = 0;
+	ptpStats.offsetMean = 0;
+	ptpStats.offsetRms = 0U;
+	ptpStats.jitter = 0U;
+	ptpOffsetSum = 0;
+	ptpOffsetSquares = 0U;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the port state and statistics on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void Ptp_Dump(Ptp_PutCharTypeDef putChar)
+{
+	static const char *const state[] = { "listening", "uncalibrated", "slave" };
+	Ptp_StatsTypeDef stats;
+	char line[200];
+
+	Ptp_GetStats(&stats);
+	snprintf(line, sizeof(line),
+		"ptp %s offset=%ld mean=%ld min=%ld max=%ld rms=%lu jitter=%lu delay=%ld ppb=%ld sync=%lu"
+		" steps=%lu\r\n",
+		state[stats.state], (long)stats.offset, (long)stats.offsetMean, (long)stats.offsetMin,
+		(long)stats.offsetMax, (unsigned long)stats.offsetRms, (unsigned long)stats.jitter,
+		(long)stats.pathDelay, (long)stats.ppb, (unsigned long)stats.syncs, (unsigned long)stats.steps);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    ptp_servo.c
+  * @brief   PI clock servo of the PTP slave.
+  *
+  *          The gains follow the linuxptp defaults for hardware time
+  *          stamps: kp = min(0.7 * T^-0.3, 0.7 / T) and
+  *          ki = min(0.3 * T^0.4, 0.3 / T) for a sample interval of T
+  *          seconds, tabulated in Q16 for T = 2^-4 to 2^2. The integral is
+  *          kept in Q16 ppb so that sub-ppb steps of a locked loop add up.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ptp_servo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PTP_SERVO_LOG_MIN           (-4)
+#define PTP_SERVO_LOG_MAX           2
+#define PTP_SERVO_NS_PER_S          1000000000LL
+#define PTP_SERVO_MAX_DIFF          (1LL << 33)     /* ns, keeps diff * 1e9 in range */
+
+/* Private variables ---------------------------------------------------------*/
+/* { kp, ki } in Q16 by log2 of the sample interval */
+static const int32_t ptpServoGain[PTP_SERVO_LOG_MAX - PTP_SERVO_LOG_MIN + 1][2] =
+{
+	{ 105394, 6486 },
+	{ 85606, 8558 },
+	{ 69534, 11292 },
+	{ 56479, 14900 },
+	{ PTP_SERVO_KP, PTP_SERVO_KI },
+	{ 22938, 9830 },
+	{ 11469, 4915 },
+};
+
+/* Private functions ---------------------------------------------------------*/
+static inline int64_t PtpServo_Clamp(int64_t value, int64_t limit)
+{
+	return (value > limit) ? limit : ((value < -limit) ? -limit : value);
+}
+
+static inline int64_t PtpServo_Abs(int64_t value)
+{
+	return (value < 0) ? -value : value;
+}
+
+/* Q16 ppb to ppb, rounded to nearest */
+static inline int32_t PtpServo_Round(int64_t q16)
+{
+	return (int32_t)((q16 + ((q16 < 0) ? -32768 : 32768)) / 65536);
+}
+
+/**
+ * @brief  Set the gains for a sample interval and forget the frequency
+ *         estimate.
+ * @param  servo: servo state
+ * @param  logInterval: log2 of the seconds between samples, the PTP
+ *         logSyncInterval; clamped to -4..2
+ * @retval None
+ */
+void PtpServo_Init(PtpServo_TypeDef *servo, int32_t logInterval)
+{
+	if (logInterval < PTP_SERVO_LOG_MIN)
+	{
+		logInterval = PTP_SERVO_LOG_MIN;
+	}
+	if (logInterval > PTP_SERVO_LOG_MAX)
+	{
+		logInterval = PTP_SERVO_LOG_MAX;
+	}
+	servo->kp = ptpServoGain[logInterval - PTP_SERVO_LOG_MIN][0];
+	servo->ki = ptpServoGain[logInterval - PTP_SERVO_LOG_MIN][1];
+	servo->stepThreshold = PTP_SERVO_STEP_THRESHOLD;
+	servo->maxPpb = PTP_SERVO_MAX_PPB;
+	servo->drift = 0;
+	PtpServo_Reset(servo);
+}
+
+/**
+ * @brief  Go back to the first state, keeping the frequency estimate: the
+ *         next two samples measure the error left with it applied.
+ * @param  servo: servo state
+ * @retval None
+ */
+void PtpServo_Reset(PtpServo_TypeDef *servo)
+{
+	servo->state = PTP_SERVO_UNLOCKED;
+	servo->count = 0U;
+}
+
+/**
+ * @brief  Feed one offset measurement.
+ * @param  servo: servo state
+ * @param  offset: slave time minus master time, ns
+ * @param  localTime: slave time of the measurement, ns
+ * @param  ppb: frequency correction to apply to the slave clock, positive
+ *         makes it run faster; unchanged in PTP_SERVO_UNLOCKED
+ * @retval PTP_SERVO_JUMP: step the clock by -offset, then apply ppb;
+ *         otherwise apply ppb if locked
+ */
+PtpServo_StateTypeDef PtpServo_Sample(PtpServo_TypeDef *servo, int64_t offset, int64_t localTime,
+		int32_t *ppb)
+{
+	int64_t maxQ16 = (int64_t)servo->maxPpb << 16;
+	int64_t kiTerm;
+	int64_t total;
+
+	switch (servo->count)
+	{
+	case 0U:
+		servo->offset0 = offset;
+		servo->local0 = localTime;
+		servo->count = 1U;
+		servo->state = PTP_SERVO_UNLOCKED;
+		break;
+
+	case 1U:
+		if (localTime <= servo->local0)
+		{
+			/* Clock stepped under us or a stale sample: start over */
+			servo->count = 0U;
+			break;
+		}
+		servo->drift += (PtpServo_Clamp(offset - servo->offset0, PTP_SERVO_MAX_DIFF) * PTP_SERVO_NS_PER_S
+			/ (localTime - servo->local0)) * 65536;
+		servo->drift = PtpServo_Clamp(servo->drift, maxQ16);
+		*ppb = -PtpServo_Round(servo->drift);
+		servo->count = 2U;
+		servo->state = (PtpServo_Abs(offset) > PTP_SERVO_STEP_THRESHOLD) ? PTP_SERVO_JUMP : PTP_SERVO_LOCKED;
+		break;
+
+	default:
+		if ((servo->stepThreshold != 0) && (PtpServo_Abs(offset) > servo->stepThreshold))
+		{
+			PtpServo_Reset(servo);
+			break;
+		}
+		kiTerm = servo->ki * offset;
+		total = (servo->kp * offset) + servo->drift + kiTerm;
+		if (total > maxQ16)
+		{
+			total = maxQ16;
+		}
+		else if (total < -maxQ16)
+		{
+			total = -maxQ16;
+		}
+		else
+		{
+			/* Anti-windup: the integral only moves while unsaturated */
+			servo->drift += kiTerm;
+		}
+		*ppb = -PtpServo_Round(total);
+		servo->state = PTP_SERVO_LOCKED;
+		break;
+	}
+
+	return servo->state;
+}
@@ -0,0 +1,864 @@
+/**
+  ******************************************************************************
+  * @file    qspi_flash.c
+  * @brief   External QSPI NOR flash, memory-mapped at 0x90000000.
+  *
+  *          Bring-up: software reset, JEDEC ID and SFDP read in single line
+  *          mode below the 50 MHz of Read SFDP, then the quad enable bit the
+  *          basic flash parameter table asks for, the final clock and 4-byte
+  *          addressing for the parts above 16 MB. Erase and program stay
+  *          single line, only the reads are worth the quad and DTR phases.
+  *
+  *          The DMA read uses DMA2 Stream7 channel 3, the only QUADSPI
+  *          request of the STM32F74x, also the USART1 TX stream: the caller
+  *          frees it first (UsartDma_TxSuspend()). Its interrupt is off in the
+  *          NVIC and the HAL DMA and QUADSPI handlers are polled.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "dma_buffer.h"
+#include "qspi_flash.h"
+
+/* Private define ------------------------------------------------------------*/
+#define QSPI_FLASH_SFDP_SIGNATURE   0x50444653U     /* "SFDP", little-endian */
+#define QSPI_FLASH_SFDP_HEADER      8U              /* SFDP header and each parameter header */
+#define QSPI_FLASH_BFPT_ID          0xFF00U         /* basic flash parameter table */
+#define QSPI_FLASH_BFPT_MIN_DWORDS  9U              /* JESD216 */
+#define QSPI_FLASH_PAGE_DEFAULT     256U
+#define QSPI_FLASH_3BYTE_LIMIT      0x01000000UL    /* 16 MB */
+#define QSPI_FLASH_NO_ADDRESS       0xFFFFFFFFU
+#define QSPI_FLASH_MAX_CS_HIGH      8U              /* DCR CSHT */
+#define QSPI_FLASH_MAX_DIVIDER      256U            /* CR PRESCALER + 1 */
+#define QSPI_FLASH_MAX_DUMMY        31U
+#define QSPI_FLASH_MAP_TIMEOUT      64U             /* clocks idle before the chip select is released */
+#define QSPI_FLASH_POLL_INTERVAL    16U             /* clocks between two status reads */
+#define QSPI_FLASH_DMA_MAX          (0xFFFFU * 4U)  /* NDTR, words */
+
+#define QSPI_FLASH_CMD_READ_SFDP    0x5AU
+#define QSPI_FLASH_SFDP_DUMMY       8U
+#define QSPI_FLASH_CMD_READ_ID      0x9FU
+#define QSPI_FLASH_CMD_RESET_ENABLE 0x66U
+#define QSPI_FLASH_CMD_RESET        0x99U
+#define QSPI_FLASH_CMD_WRITE_ENABLE 0x06U
+#define QSPI_FLASH_CMD_READ_STATUS  0x05U
+#define QSPI_FLASH_CMD_ENTER_4BYTE  0xB7U
+#define QSPI_FLASH_CMD_PAGE_PROGRAM 0x02U
+#define QSPI_FLASH_STATUS_WIP       0x01U
+#define QSPI_FLASH_STATUS_WEL       0x02U
+
+/* Private typedef -----------------------------------------------------------*/
+/* How to set the quad enable bit, JESD216A DWORD15 bits 22:20 */
+typedef struct
+{
+	uint8_t readLow;                    /* status byte written first, 0: one byte written */
+	uint8_t readHigh;                   /* status byte holding QE, 0: not readable */
+	uint8_t write;
+	uint8_t mask;
+} QspiFlash_QuadEnableTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+const QspiFlash_ConfigTypeDef qspiFlashN25q128a =
+{
+	.name = "N25Q128A", .maxClockHz = 108000000U, .dtrMaxClockHz = 54000000U,
+	.dtrOpcode = 0xEDU, .dtrDummyClocks = 8U, .csHighNs = 50U
+};
+
+const QspiFlash_ConfigTypeDef qspiFlashMx25l51245g =
+{
+	.name = "MX25L51245G", .maxClockHz = 84000000U, .dtrMaxClockHz = 0U,
+	.dtrOpcode = 0U, .dtrDummyClocks = 0U, .csHighNs = 30U
+};
+
+/* Private variables ---------------------------------------------------------*/
+static const QspiFlash_QuadEnableTypeDef qspiQuadEnable[] =
+{
+	{ 0x05U, 0x00U, 0x01U, 0x02U },     /* 1: SR2 bit 1, two bytes written, SR2 not readable */
+	{ 0x00U, 0x05U, 0x01U, 0x40U },     /* 2: SR1 bit 6 */
+	{ 0x00U, 0x3FU, 0x3EU, 0x80U },     /* 3: SR2 bit 7, 3Fh/3Eh */
+	{ 0x05U, 0x35U, 0x01U, 0x02U },     /* 4: SR2 bit 1, two bytes written */
+	{ 0x05U, 0x35U, 0x01U, 0x02U },     /* 5: same, one byte would not clear SR2 */
+	{ 0x00U, 0x35U, 0x31U, 0x02U },     /* 6: SR2 bit 1, 35h/31h */
+};
+
+static QSPI_HandleTypeDef qspiHandle;
+static DMA_HandleTypeDef qspiDma;
+static const QspiFlash_ConfigTypeDef *qspiConfig;
+static QspiFlash_SfdpTypeDef qspiInfo;
+static QspiFlash_ReadTypeDef qspiRead;
+static QspiFlash_StatsTypeDef qspiStats;
+static uint32_t qspiAddressSize = QSPI_ADDRESS_24_BITS;
+static uint32_t qspiJedecId;
+static uint8_t qspiSfdp[QSPI_FLASH_SFDP_SIZE];
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t QspiFlash_Dword(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief  Smallest n with 2^n >= value.
+ */
+static uint32_t QspiFlash_Log2(uint32_t value)
+{
+	uint32_t n = 0;
+
+	while ((n < 32U) && ((1ULL << n) < value))
+	{
+		n++;
+	}
+	return n;
+}
+
+/**
+ * @brief  A single line command: instruction, optional address, dummy
+ *         clocks and data.
+ * @param  address: QSPI_FLASH_NO_ADDRESS for none
+ */
+static void QspiFlash_SingleLine(QSPI_CommandTypeDef *command, uint32_t instruction, uint32_t address,
+		uint32_t dummyClocks, uint32_t length)
+{
+	memset(command, 0, sizeof(*command));
+	command->Instruction = instruction;
+	command->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	command->Address = (address != QSPI_FLASH_NO_ADDRESS) ? address : 0U;
+	command->AddressMode = (address != QSPI_FLASH_NO_ADDRESS) ? QSPI_ADDRESS_1_LINE : QSPI_ADDRESS_NONE;
+	command->AddressSize = qspiAddressSize;
+	command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	command->DummyCycles = dummyClocks;
+	command->DataMode = (length != 0U) ? QSPI_DATA_1_LINE : QSPI_DATA_NONE;
+	command->NbData = length;
+	command->DdrMode = QSPI_DDR_MODE_DISABLE;
+	command->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	command->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+}
+
+static HAL_StatusTypeDef QspiFlash_Command(uint32_t instruction, uint32_t address, uint32_t dummyClocks,
+		uint8_t *data, uint32_t length, uint32_t write)
+{
+	QSPI_CommandTypeDef command;
+
+	QspiFlash_SingleLine(&command, instruction, address, dummyClocks, length);
+	if (HAL_QSPI_Command(&qspiHandle, &command, QSPI_FLASH_TIMEOUT_MS) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	if (length == 0U)
+	{
+		return HAL_OK;
+	}
+	return (write != 0U) ? HAL_QSPI_Transmit(&qspiHandle, data, QSPI_FLASH_TIMEOUT_MS)
+		: HAL_QSPI_Receive(&qspiHandle, data, QSPI_FLASH_TIMEOUT_MS);
+}
+
+/**
+ * @brief  Poll status register 1 in the controller until (SR & mask) == match.
+ */
+static HAL_StatusTypeDef QspiFlash_WaitStatus(uint32_t mask, uint32_t match, uint32_t timeoutMs)
+{
+	QSPI_CommandTypeDef command;
+	QSPI_AutoPollingTypeDef polling;
+
+	QspiFlash_SingleLine(&command, QSPI_FLASH_CMD_READ_STATUS, QSPI_FLASH_NO_ADDRESS, 0U, 1U);
+	polling.Match = match;
+	polling.Mask = mask;
+	polling.Interval = QSPI_FLASH_POLL_INTERVAL;
+	polling.StatusBytesSize = 1U;
+	polling.MatchMode = QSPI_MATCH_MODE_AND;
+	polling.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+	return HAL_QSPI_AutoPolling(&qspiHandle, &command, &polling, timeoutMs);
+}
+
+static HAL_StatusTypeDef QspiFlash_WriteEnable(void)
+{
+	if (QspiFlash_Command(QSPI_FLASH_CMD_WRITE_ENABLE, QSPI_FLASH_NO_ADDRESS, 0U, NULL, 0U, 0U) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	return QspiFlash_WaitStatus(QSPI_FLASH_STATUS_WEL, QSPI_FLASH_STATUS_WEL, QSPI_FLASH_TIMEOUT_MS);
+}
+
+/**
+ * @brief  Set the quad enable bit the way the SFDP table says, non-volatile
+ *         on most parts: written only when not already set.
+ */
+static HAL_StatusTypeDef QspiFlash_QuadEnable(uint32_t requirement)
+{
+	const QspiFlash_QuadEnableTypeDef *qe;
+	uint8_t status[2] = { 0U, 0U };
+
+	if (requirement == 0U)
+	{
+		return HAL_OK;
+	}
+	if (requirement > (sizeof(qspiQuadEnable) / sizeof(qspiQuadEnable[0])))
+	{
+		return HAL_ERROR;
+	}
+	qe = &qspiQuadEnable[requirement - 1U];
+
+	if (((qe->readLow != 0U) && (QspiFlash_Command(qe->readLow, QSPI_FLASH_NO_ADDRESS, 0U, &status[0], 1U, 0U) != HAL_OK))
+			|| ((qe->readHigh != 0U) && (QspiFlash_Command(qe->readHigh, QSPI_FLASH_NO_ADDRESS, 0U, &status[1], 1U, 0U) != HAL_OK)))
+	{
+		return HAL_ERROR;
+	}
+	if ((qe->readHigh != 0U) && ((status[1] & qe->mask) != 0U))
+	{
+		return HAL_OK;
+	}
+	status[1] |= qe->mask;
+	if ((QspiFlash_WriteEnable() != HAL_OK)
+			|| (QspiFlash_Command(qe->write, QSPI_FLASH_NO_ADDRESS, 0U, (qe->readLow != 0U) ? status : &status[1],
+				(qe->readLow != 0U) ? 2U : 1U, 1U) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	return QspiFlash_WaitStatus(QSPI_FLASH_STATUS_WIP, 0U, QSPI_FLASH_ERASE_TIMEOUT_MS);
+}
+
+static HAL_StatusTypeDef QspiFlash_Map(void)
+{
+	QSPI_CommandTypeDef command = qspiRead.command;
+	QSPI_MemoryMappedTypeDef map;
+
+	map.TimeOutPeriod = QSPI_FLASH_MAP_TIMEOUT;
+	map.TimeOutActivation = QSPI_TIMEOUT_COUNTER_ENABLE;
+	return HAL_QSPI_MemoryMapped(&qspiHandle, &command, &map);
+}
+
+/**
+ * @brief  Leave the memory-mapped mode for an indirect command.
+ */
+static HAL_StatusTypeDef QspiFlash_Unmap(uint32_t address, uint32_t length)
+{
+	if ((qspiConfig == NULL) || (address >= qspiRead.size) || (length > qspiRead.size - address))
+	{
+		qspiStats.errors++;
+		return HAL_ERROR;
+	}
+	return HAL_QSPI_Abort(&qspiHandle);
+}
+
+/**
+ * @brief  Back to memory-mapped mode, the stale cache lines of what was
+ *         written dropped.
+ */
+static HAL_StatusTypeDef QspiFlash_Remap(HAL_StatusTypeDef status, uint32_t address, uint32_t length)
+{
+	if (length != 0U)
+	{
+		uint32_t start = address & ~(DMA_BUFFER_LINE - 1U);
+
+		SCB_InvalidateDCache_by_Addr((void *)(QSPI_FLASH_BASE + start), (int32_t)(address + length - start));
+		SCB_InvalidateICache();
+	}
+	if (QspiFlash_Map() != HAL_OK)
+	{
+		status = HAL_ERROR;
+	}
+	if (status != HAL_OK)
+	{
+		qspiStats.errors++;
+	}
+	return status;
+}
+
+static void QspiFlash_ReadCommand(QSPI_CommandTypeDef *command, uint32_t address, uint32_t length)
+{
+	*command = qspiRead.command;
+	command->Address = address;
+	command->NbData = length;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Decode the SFDP header and the basic flash parameter table.
+ * @note   Of several basic tables of major revision 1 the latest is used.
+ *         The fields JESD216 left out default to a 256-byte page, no quad
+ *         enable bit and, for a 3 or 4-byte part, write enable then B7h to
+ *         enter 4-byte addressing. Pure function.
+ * @param  sfdp: what Read SFDP returned from address 0
+ * @param  length: bytes of sfdp
+ * @param  info: filled in
+ * @retval HAL_OK, HAL_ERROR on a bad signature, no usable basic table
+ *         within length or a density beyond 2 GB
+ */
+HAL_StatusTypeDef QspiFlash_ParseSfdp(const uint8_t *sfdp, uint32_t length, QspiFlash_SfdpTypeDef *info)
+{
+	const uint8_t *bfpt = NULL;
+	uint32_t bfptDwords = 0;
+	uint32_t headers;
+	uint32_t dword[16];
+	uint32_t density;
+
+	memset(info, 0, sizeof(*info));
+	if ((length < (2U * QSPI_FLASH_SFDP_HEADER)) || (QspiFlash_Dword(sfdp) != QSPI_FLASH_SFDP_SIGNATURE)
+			|| (sfdp[5] != 1U))
+	{
+		return HAL_ERROR;
+	}
+
+	headers = (uint32_t)sfdp[6] + 1U;
+	for (uint32_t i = 0; (i < headers) && ((QSPI_FLASH_SFDP_HEADER * (i + 2U)) <= length); i++)
+	{
+		const uint8_t *header = &sfdp[QSPI_FLASH_SFDP_HEADER * (i + 1U)];
+		uint32_t id = ((uint32_t)header[7] << 8) | header[0];
+		uint32_t revision = ((uint32_t)header[2] << 8) | header[1];
+		uint32_t dwords = header[3];
+		uint32_t pointer = QspiFlash_Dword(&header[4]) & 0x00FFFFFFU;
+
+		/* A later major revision would not be compatible */
+		if ((id != QSPI_FLASH_BFPT_ID) || (header[2] != 1U) || (dwords < QSPI_FLASH_BFPT_MIN_DWORDS)
+				|| ((pointer % 4U) != 0U) || (pointer > length) || ((dwords * 4U) > (length - pointer)))
+		{
+			continue;
+		}
+		if ((bfpt == NULL) || (revision > info->revision))
+		{
+			bfpt = &sfdp[pointer];
+			bfptDwords = dwords;
+			info->revision = revision;
+		}
+	}
+	if (bfpt == NULL)
+	{
+		return HAL_ERROR;
+	}
+	for (uint32_t i = 0; i < (sizeof(dword) / sizeof(dword[0])); i++)
+	{
+		dword[i] = (i < bfptDwords) ? QspiFlash_Dword(&bfpt[4U * i]) : 0U;
+	}
+
+	/* DWORD2: bits - 1, or 2^N bits */
+	density = dword[1];
+	if ((density & 0x80000000U) != 0U)
+	{
+		density &= 0x7FFFFFFFU;
+		if ((density < 3U) || (density > 34U))
+		{
+			return HAL_ERROR;
+		}
+		info->size = 1UL << (density - 3U);
+	}
+	else
+	{
+		if (((density + 1U) % 8U) != 0U)
+		{
+			return HAL_ERROR;
+		}
+		info->size = (density / 8U) + 1U;
+	}
+
+	/* DWORD1: address bytes, DTR, fast reads supported; DWORD3 their commands */
+	info->addressBytes = (dword[0] >> 17) & 0x3U;
+	if (info->addressBytes > QSPI_FLASH_ADDRESS_4)
+	{
+		return HAL_ERROR;
+	}
+	info->dtr = (dword[0] >> 19) & 0x1U;
+	if ((dword[0] & (1UL << 21)) != 0U)
+	{
+		info->read144Opcode = (dword[2] >> 8) & 0xFFU;
+		info->read144ModeClocks = (dword[2] >> 5) & 0x7U;
+		info->read144DummyClocks = dword[2] & 0x1FU;
+	}
+	if ((dword[0] & (1UL << 22)) != 0U)
+	{
+		info->read114Opcode = (dword[2] >> 24) & 0xFFU;
+		info->read114ModeClocks = (dword[2] >> 21) & 0x7U;
+		info->read114DummyClocks = (dword[2] >> 16) & 0x1FU;
+	}
+
+	/* DWORD8-9: erase types 1 to 4 as 2^N and opcode, else DWORD1 4 KB erase */
+	for (uint32_t type = 0; type < 4U; type++)
+	{
+		uint32_t field = dword[7U + (type / 2U)] >> (16U * (type % 2U));
+		uint32_t exponent = field & 0xFFU;
+
+		if ((exponent != 0U) && (exponent < 32U) && ((info->eraseSize == 0U) || ((1UL << exponent) < info->eraseSize)))
+		{
+			info->eraseSize = 1UL << exponent;
+			info->eraseOpcode = (field >> 8) & 0xFFU;
+		}
+	}
+	if ((info->eraseSize == 0U) && ((dword[0] & 0x3U) == 0x1U))
+	{
+		info->eraseSize = 4096U;
+		info->eraseOpcode = (dword[0] >> 8) & 0xFFU;
+	}
+
+	/* JESD216A: DWORD11 page size, DWORD15 quad enable, DWORD16 4-byte entry */
+	info->pageSize = (bfptDwords >= 11U) ? (1UL << ((dword[10] >> 4) & 0xFU)) : QSPI_FLASH_PAGE_DEFAULT;
+	info->quadEnable = (bfptDwords >= 15U) ? ((dword[14] >> 20) & 0x7U) : 0U;
+	if (info->addressBytes != QSPI_FLASH_ADDRESS_3_OR_4)
+	{
+		info->enter4Byte = QSPI_FLASH_ENTER4_NONE;
+	}
+	else if (bfptDwords < 16U)
+	{
+		info->enter4Byte = QSPI_FLASH_ENTER4_WREN_B7;
+	}
+	else
+	{
+		info->enter4Byte = ((dword[15] & (1UL << 24)) != 0U) ? QSPI_FLASH_ENTER4_B7
+			: (((dword[15] & (1UL << 25)) != 0U) ? QSPI_FLASH_ENTER4_WREN_B7 : QSPI_FLASH_ENTER4_NONE);
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Read command and controller settings of a part at a given HCLK.
+ * @note   Quad I/O DTR when the part supports DTR clocking and config names
+ *         its command, else quad I/O, else quad output SDR. The clock is the
+ *         fastest HCLK/n the read mode takes, samples are shifted half a
+ *         cycle in SDR. The mode clocks of the SFDP table are sent as
+ *         alternate bytes of all ones (no continuous read) when they make
+ *         whole bytes, else added to the dummy clocks. Parts above 16 MB
+ *         need 4-byte addressing, else only their first 16 MB are mapped;
+ *         at most the 256 MB of the window are. Pure function.
+ * @param  config: part
+ * @param  info: QspiFlash_ParseSfdp() result
+ * @param  hclkHz: AHB clock
+ * @param  read: filled in
+ * @retval HAL_OK, HAL_ERROR when no quad read is supported, no divider is
+ *         large enough or the chip select high time exceeds 8 clocks
+ */
+HAL_StatusTypeDef QspiFlash_CalcRead(const QspiFlash_ConfigTypeDef *config, const QspiFlash_SfdpTypeDef *info,
+		uint32_t hclkHz, QspiFlash_ReadTypeDef *read)
+{
+	QSPI_CommandTypeDef *command = &read->command;
+	uint32_t dtr = ((config->dtrOpcode != 0U) && (info->dtr != 0U)) ? 1U : 0U;
+	uint32_t maxClockHz = (dtr != 0U) ? config->dtrMaxClockHz : config->maxClockHz;
+	uint32_t divider;
+	uint32_t csHigh;
+
+	memset(read, 0, sizeof(*read));
+	if ((maxClockHz == 0U) || (hclkHz == 0U) || (info->size < 2U))
+	{
+		return HAL_ERROR;
+	}
+
+	read->size = info->size;
+	command->AddressSize = QSPI_ADDRESS_24_BITS;
+	if (read->size > QSPI_FLASH_3BYTE_LIMIT)
+	{
+		if ((info->addressBytes == QSPI_FLASH_ADDRESS_4)
+				|| ((info->addressBytes == QSPI_FLASH_ADDRESS_3_OR_4) && (info->enter4Byte != QSPI_FLASH_ENTER4_NONE)))
+		{
+			command->AddressSize = QSPI_ADDRESS_32_BITS;
+			read->enter4Byte = info->enter4Byte;
+		}
+		else
+		{
+			read->size = QSPI_FLASH_3BYTE_LIMIT;
+		}
+	}
+	if (read->size > QSPI_FLASH_WINDOW)
+	{
+		read->size = QSPI_FLASH_WINDOW;
+	}
+
+	divider = (hclkHz + maxClockHz - 1U) / maxClockHz;
+	if (divider > QSPI_FLASH_MAX_DIVIDER)
+	{
+		return HAL_ERROR;
+	}
+	read->clockHz = hclkHz / divider;
+	csHigh = (uint32_t)(((uint64_t)config->csHighNs * read->clockHz + 999999999ULL) / 1000000000ULL);
+	if (csHigh == 0U)
+	{
+		csHigh = 1U;
+	}
+	if (csHigh > QSPI_FLASH_MAX_CS_HIGH)
+	{
+		return HAL_ERROR;
+	}
+
+	read->init.ClockPrescaler = divider - 1U;
+	read->init.FifoThreshold = QSPI_FLASH_FIFO_THRESHOLD;
+	read->init.SampleShifting = (dtr != 0U) ? QSPI_SAMPLE_SHIFTING_NONE : QSPI_SAMPLE_SHIFTING_HALFCYCLE;
+	read->init.FlashSize = QspiFlash_Log2(read->size) - 1U;
+	read->init.ChipSelectHighTime = (csHigh - 1U) << QUADSPI_DCR_CSHT_Pos;
+	read->init.ClockMode = QSPI_CLOCK_MODE_0;
+	read->init.FlashID = QSPI_FLASH_ID_1;
+	read->init.DualFlash = QSPI_DUALFLASH_DISABLE;
+
+	command->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	command->DataMode = QSPI_DATA_4_LINES;
+	command->DdrMode = QSPI_DDR_MODE_DISABLE;
+	command->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	command->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	if (dtr != 0U)
+	{
+		command->Instruction = config->dtrOpcode;
+		command->AddressMode = QSPI_ADDRESS_4_LINES;
+		command->DummyCycles = config->dtrDummyClocks;
+		command->DdrMode = QSPI_DDR_MODE_ENABLE;
+	}
+	else if (info->read144Opcode != 0U)
+	{
+		uint32_t modeBytes = ((info->read144ModeClocks % 2U) == 0U) ? (info->read144ModeClocks / 2U) : 0U;
+
+		command->Instruction = info->read144Opcode;
+		command->AddressMode = QSPI_ADDRESS_4_LINES;
+		command->DummyCycles = info->read144DummyClocks + ((modeBytes == 0U) ? info->read144ModeClocks : 0U);
+		if (modeBytes != 0U)
+		{
+			command->AlternateByteMode = QSPI_ALTERNATE_BYTES_4_LINES;
+			command->AlternateBytesSize = (modeBytes - 1U) << QUADSPI_CCR_ABSIZE_Pos;
+			command->AlternateBytes = 0xFFFFFFFFU >> (32U - (8U * modeBytes));
+		}
+	}
+	else if (info->read114Opcode != 0U)
+	{
+		command->Instruction = info->read114Opcode;
+		command->AddressMode = QSPI_ADDRESS_1_LINE;
+		command->DummyCycles = info->read114DummyClocks + info->read114ModeClocks;
+	}
+	else
+	{
+		return HAL_ERROR;
+	}
+	if (command->DummyCycles > QSPI_FLASH_MAX_DUMMY)
+	{
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Bring up the part, map it and cache it.
+ * @note   The QUADSPI pins must already be in alternate function mode and
+ *         the system clock final: the read is set up for the HCLK of now.
+ * @param  config: part fitted
+ * @retval HAL_OK, HAL_ERROR when the part does not answer, its SFDP tables
+ *         are not usable or it does not fit this HCLK
+ */
+HAL_StatusTypeDef QspiFlash_Init(const QspiFlash_ConfigTypeDef *config)
+{
+	uint32_t hclkHz = HAL_RCC_GetHCLKFreq();
+	uint8_t id[3];
+
+	LL_AHB3_GRP1_EnableClock(LL_AHB3_GRP1_PERIPH_QSPI);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+	LL_AHB3_GRP1_ForceReset(LL_AHB3_GRP1_PERIPH_QSPI);
+	LL_AHB3_GRP1_ReleaseReset(LL_AHB3_GRP1_PERIPH_QSPI);
+
+	qspiConfig = NULL;
+	memset(&qspiStats, 0, sizeof(qspiStats));
+	memset(&qspiHandle, 0, sizeof(qspiHandle));
+	qspiHandle.Instance = QUADSPI;
+	qspiHandle.Init.ClockPrescaler = ((hclkHz + QSPI_FLASH_SFDP_CLOCK_HZ - 1U) / QSPI_FLASH_SFDP_CLOCK_HZ) - 1U;
+	qspiHandle.Init.FifoThreshold = QSPI_FLASH_FIFO_THRESHOLD;
+	qspiHandle.Init.SampleShifting = QSPI_SAMPLE_SHIFTING_NONE;
+	qspiHandle.Init.FlashSize = 31U;
+	qspiHandle.Init.ChipSelectHighTime = QSPI_CS_HIGH_TIME_8_CYCLE;
+	qspiHandle.Init.ClockMode = QSPI_CLOCK_MODE_0;
+	qspiHandle.Init.FlashID = QSPI_FLASH_ID_1;
+	qspiHandle.Init.DualFlash = QSPI_DUALFLASH_DISABLE;
+	qspiAddressSize = QSPI_ADDRESS_24_BITS;
+
+	/* The reset also leaves a 4-byte mode a previous run entered */
+	if ((HAL_QSPI_Init(&qspiHandle) != HAL_OK)
+			|| (QspiFlash_Command(QSPI_FLASH_CMD_RESET_ENABLE, QSPI_FLASH_NO_ADDRESS, 0U, NULL, 0U, 0U) != HAL_OK)
+			|| (QspiFlash_Command(QSPI_FLASH_CMD_RESET, QSPI_FLASH_NO_ADDRESS, 0U, NULL, 0U, 0U) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	/* The tick is the millisecond: longer than the reset recovery of any part */
+	HAL_Delay(1U);
+	if ((QspiFlash_Command(QSPI_FLASH_CMD_READ_ID, QSPI_FLASH_NO_ADDRESS, 0U, id, sizeof(id), 0U) != HAL_OK)
+			|| (QspiFlash_Command(QSPI_FLASH_CMD_READ_SFDP, 0U, QSPI_FLASH_SFDP_DUMMY, qspiSfdp, sizeof(qspiSfdp), 0U) != HAL_OK)
+			|| (QspiFlash_ParseSfdp(qspiSfdp, sizeof(qspiSfdp), &qspiInfo) != HAL_OK)
+			|| (QspiFlash_CalcRead(config, &qspiInfo, hclkHz, &qspiRead) != HAL_OK)
+			|| (QspiFlash_QuadEnable(qspiInfo.quadEnable) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	qspiJedecId = ((uint32_t)id[0] << 16) | ((uint32_t)id[1] << 8) | id[2];
+
+	qspiHandle.Init = qspiRead.init;
+	if (HAL_QSPI_Init(&qspiHandle) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	if (qspiRead.enter4Byte != QSPI_FLASH_ENTER4_NONE)
+	{
+		if (((qspiRead.enter4Byte == QSPI_FLASH_ENTER4_WREN_B7) && (QspiFlash_WriteEnable() != HAL_OK))
+				|| (QspiFlash_Command(QSPI_FLASH_CMD_ENTER_4BYTE, QSPI_FLASH_NO_ADDRESS, 0U, NULL, 0U, 0U) != HAL_OK))
+		{
+			return HAL_ERROR;
+		}
+	}
+	qspiAddressSize = qspiRead.command.AddressSize;
+	qspiConfig = config;
+
+	if ((QspiFlash_Map() != HAL_OK) || (QspiFlash_SetCache(MPU_REGIONS_NORMAL_WRITE_THROUGH) != HAL_OK))
+	{
+		qspiConfig = NULL;
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Map the part with a memory type, the rest of the window no-access.
+ * @note   Read-only, executable. Leaves the D-cache cold.
+ * @param  type: MPU_REGIONS_NORMAL_WRITE_THROUGH for cached reads
+ * @retval HAL_OK, HAL_ERROR before QspiFlash_Init()
+ */
+HAL_StatusTypeDef QspiFlash_SetCache(MpuRegions_MemoryTypeDef type)
+{
+	MpuRegions_DescTypeDef regions[2] =
+	{
+		{ QSPI_FLASH_BASE, QSPI_FLASH_WINDOW, MPU_REGIONS_STRONGLY_ORDERED, ARM_MPU_AP_NONE, 1U, 0U },
+		{ QSPI_FLASH_BASE, qspiRead.size, type, ARM_MPU_AP_RO, 0U, 0U }
+	};
+	ARM_MPU_Region_t table[2];
+
+	if ((qspiRead.size == 0U) || (MpuRegions_Build(regions, 2U, QSPI_FLASH_MPU_REGION, table) != 2U))
+	{
+		return HAL_ERROR;
+	}
+	SCB_CleanInvalidateDCache();
+	MpuRegions_Load(table, 2U);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Read with the fast read command, the FIFO polled by the CPU.
+ * @param  address: offset in the part
+ * @param  buffer: destination, not in the QSPI window
+ * @param  length: bytes
+ * @retval HAL_OK, HAL_ERROR out of the mapped size or on a controller error
+ */
+HAL_StatusTypeDef QspiFlash_Read(uint32_t address, void *buffer, uint32_t length)
+{
+	QSPI_CommandTypeDef command;
+	HAL_StatusTypeDef status;
+
+	if (QspiFlash_Unmap(address, length) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	QspiFlash_ReadCommand(&command, address, length);
+	status = HAL_QSPI_Command(&qspiHandle, &command, QSPI_FLASH_TIMEOUT_MS);
+	if (status == HAL_OK)
+	{
+		status = HAL_QSPI_Receive(&qspiHandle, buffer, QSPI_FLASH_TIMEOUT_MS);
+	}
+	qspiStats.reads++;
+	qspiStats.readBytes += length;
+	return QspiFlash_Remap(status, address, 0U);
+}
+
+/**
+ * @brief  Read with the fast read command through HAL_QSPI_Receive_DMA(),
+ *         waiting for the end.
+ * @note   DMA2 Stream7 must be free and its NVIC interrupt disabled, see
+ *         the file header.
+ * @param  address: offset in the part
+ * @param  buffer: destination, not in the QSPI window
+ * @param  length: bytes, multiple of 4
+ * @retval HAL_OK, HAL_ERROR out of the mapped size, on a DMA or controller
+ *         error or after QSPI_FLASH_TIMEOUT_MS per 256 KB
+ */
+HAL_StatusTypeDef QspiFlash_ReadDma(uint32_t address, void *buffer, uint32_t length)
+{
+	HAL_StatusTypeDef status = HAL_OK;
+	uint8_t *destination = buffer;
+
+	if (((length % 4U) != 0U) || (QspiFlash_Unmap(address, length) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+
+	/* Set up again every time: the stream is shared */
+	memset(&qspiDma, 0, sizeof(qspiDma));
+	qspiDma.Instance = DMA2_Stream7;
+	qspiDma.Init.Channel = DMA_CHANNEL_3;
+	qspiDma.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	qspiDma.Init.PeriphInc = DMA_PINC_DISABLE;
+	qspiDma.Init.MemInc = DMA_MINC_ENABLE;
+	qspiDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	qspiDma.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	qspiDma.Init.Mode = DMA_NORMAL;
+	qspiDma.Init.Priority = DMA_PRIORITY_HIGH;
+	qspiDma.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+	qspiDma.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	qspiDma.Init.MemBurst = DMA_MBURST_SINGLE;
+	qspiDma.Init.PeriphBurst = DMA_PBURST_SINGLE;
+	__HAL_LINKDMA(&qspiHandle, hdma, qspiDma);
+	if (HAL_DMA_Init(&qspiDma) != HAL_OK)
+	{
+		return QspiFlash_Remap(HAL_ERROR, address, 0U);
+	}
+
+	DmaBuffer_PrepareRx(buffer, length);
+	for (uint32_t offset = 0; (offset < length) && (status == HAL_OK); offset += QSPI_FLASH_DMA_MAX)
+	{
+		uint32_t chunk = ((length - offset) < QSPI_FLASH_DMA_MAX) ? (length - offset) : QSPI_FLASH_DMA_MAX;
+		QSPI_CommandTypeDef command;
+		uint32_t start;
+
+		QspiFlash_ReadCommand(&command, address + offset, chunk);
+		if ((HAL_QSPI_Command(&qspiHandle, &command, QSPI_FLASH_TIMEOUT_MS) != HAL_OK)
+				|| (HAL_QSPI_Receive_DMA(&qspiHandle, &destination[offset]) != HAL_OK))
+		{
+			status = HAL_ERROR;
+			break;
+		}
+		start = HAL_GetTick();
+		while (HAL_QSPI_GetState(&qspiHandle) != HAL_QSPI_STATE_READY)
+		{
+			HAL_DMA_IRQHandler(&qspiDma);
+			HAL_QSPI_IRQHandler(&qspiHandle);
+			if ((HAL_GetTick() - start) > QSPI_FLASH_TIMEOUT_MS)
+			{
+				(void)HAL_QSPI_Abort(&qspiHandle);
+				status = HAL_ERROR;
+				break;
+			}
+		}
+		if (HAL_QSPI_GetError(&qspiHandle) != HAL_QSPI_ERROR_NONE)
+		{
+			status = HAL_ERROR;
+		}
+	}
+	DmaBuffer_CompleteRx(buffer, length);
+	qspiStats.reads++;
+	qspiStats.readBytes += length;
+	return QspiFlash_Remap(status, address, 0U);
+}
+
+/**
+ * @brief  Erase the smallest erase block holding an address.
+ * @param  address: offset in the part
+ * @retval HAL_OK, HAL_ERROR out of the mapped size, with no erase type or
+ *         after QSPI_FLASH_ERASE_TIMEOUT_MS
+ */
+HAL_StatusTypeDef QspiFlash_Erase(uint32_t address)
+{
+	HAL_StatusTypeDef status;
+	uint32_t block;
+
+	if (qspiInfo.eraseSize == 0U)
+	{
+		return HAL_ERROR;
+	}
+	block = address & ~(qspiInfo.eraseSize - 1U);
+	if (QspiFlash_Unmap(block, qspiInfo.eraseSize) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	status = QspiFlash_WriteEnable();
+	if (status == HAL_OK)
+	{
+		status = QspiFlash_Command(qspiInfo.eraseOpcode, block, 0U, NULL, 0U, 0U);
+	}
+	if (status == HAL_OK)
+	{
+		status = QspiFlash_WaitStatus(QSPI_FLASH_STATUS_WIP, 0U, QSPI_FLASH_ERASE_TIMEOUT_MS);
+	}
+	qspiStats.erases++;
+	return QspiFlash_Remap(status, block, qspiInfo.eraseSize);
+}
+
+/**
+ * @brief  Program erased flash, split at the page boundaries.
+ * @param  address: offset in the part
+ * @param  data: source, not in the QSPI window
+ * @param  length: bytes
+ * @retval HAL_OK, HAL_ERROR out of the mapped size or when a page program
+ *         does not complete
+ */
+HAL_StatusTypeDef QspiFlash_Program(uint32_t address, const void *data, uint32_t length)
+{
+	HAL_StatusTypeDef status = HAL_OK;
+	const uint8_t *source = data;
+	uint32_t done = 0;
+
+	if ((length == 0U) || (QspiFlash_Unmap(address, length) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	while ((done < length) && (status == HAL_OK))
+	{
+		uint32_t chunk = qspiInfo.pageSize - ((address + done) % qspiInfo.pageSize);
+
+		if (chunk > length - done)
+		{
+			chunk = length - done;
+		}
+		status = QspiFlash_WriteEnable();
+		if (status == HAL_OK)
+		{
+			status = QspiFlash_Command(QSPI_FLASH_CMD_PAGE_PROGRAM, address + done, 0U, (uint8_t *)&source[done],
+				chunk, 1U);
+		}
+		if (status == HAL_OK)
+		{
+			status = QspiFlash_WaitStatus(QSPI_FLASH_STATUS_WIP, 0U, QSPI_FLASH_TIMEOUT_MS);
+		}
+		qspiStats.programs++;
+		done += chunk;
+	}
+	return QspiFlash_Remap(status, address, length);
+}
+
+/**
+ * @brief  SFDP information of the part.
+ * @retval Valid after QspiFlash_Init()
+ */
+const QspiFlash_SfdpTypeDef *QspiFlash_GetInfo(void)
+{
+	return &qspiInfo;
+}
+
+/**
+ * @brief  Read command and controller settings in use.
+ * @retval Valid after QspiFlash_Init()
+ */
+const QspiFlash_ReadTypeDef *QspiFlash_GetRead(void)
+{
+	return &qspiRead;
+}
+
+/**
+ * @brief  Copy the counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void QspiFlash_GetStats(QspiFlash_StatsTypeDef *stats)
+{
+	*stats = qspiStats;
+}
+
+/**
+ * @brief  Print the part, its read mode and the counters.
+ * @param  putChar: output function
+ * @retval None
+ */
+void QspiFlash_Dump(QspiFlash_PutCharTypeDef putChar)
+{
+	char line[160];
+
+	snprintf(line, sizeof(line), "qspi %s id=%06lx %s 0x%02lx %lu MHz %lu KB, read=%lu bytes=%lu erase=%lu"
+		" program=%lu err=%lu\r\n", (qspiConfig != NULL) ? qspiConfig->name : "-", (unsigned long)qspiJedecId,
+		(qspiRead.command.DdrMode == QSPI_DDR_MODE_ENABLE) ? "dtr" : "sdr",
+		(unsigned long)qspiRead.command.Instruction, (unsigned long)(qspiRead.clockHz / 1000000U),
+		(unsigned long)(qspiRead.size / 1024U), (unsigned long)qspiStats.reads, (unsigned long)qspiStats.readBytes,
+		(unsigned long)qspiStats.erases, (unsigned long)qspiStats.programs, (unsigned long)qspiStats.errors);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
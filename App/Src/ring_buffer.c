@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    ring_buffer.c
+  * @brief   Single-producer/single-consumer lock-free byte ring buffer.
+  *
+  *          __DMB() orders the data copy against the index publication:
+  *          a side never sees an index before the bytes it covers.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "mem_section.h"
+#include "ring_buffer.h"
+
+#ifdef  USE_FULL_ASSERT
+#include "stm32_assert.h"
+#else
+#define assert_param(expr) ((void)0U)
+#endif
+
+/**
+ * @brief  Attach storage to a ring and empty it.
+ * @param  ring: ring handle
+ * @param  buffer: storage
+ * @param  size: storage size, must be a power of two
+ * @retval None
+ */
+void RingBuffer_Init(RingBuffer_TypeDef *ring, uint8_t *buffer, uint32_t size)
+{
+	assert_param((size != 0U) && ((size & (size - 1U)) == 0U));
+
+	ring->buffer = buffer;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/**
+ * @brief  Copy data into the ring (producer).
+ * @param  ring: ring handle
+ * @param  data: source
+ * @param  length: bytes to write
+ * @retval Bytes written, less than length when the ring is full
+ */
+ITCM_TEXT uint32_t RingBuffer_Write(RingBuffer_TypeDef *ring, const void *data, uint32_t length)
+{
+	uint32_t head = ring->head;
+	uint32_t space = ring->size - (head - ring->tail);
+	uint32_t offset = head & (ring->size - 1U);
+	uint32_t first;
+
+	if (length > space)
+	{
+		length = space;
+	}
+
+	first = ring->size - offset;
+	if (first > length)
+	{
+		first = length;
+	}
+
+	/* The consumer has released the space before publishing tail */
+	__DMB();
+	memcpy(&ring->buffer[offset], data, first);
+	memcpy(ring->buffer, (const uint8_t *)data + first, length - first);
+	__DMB();
+	ring->head = head + length;
+
+	return length;
+}
+
+/**
+ * @brief  Contiguous free space at the write position (producer).
+ * @param  ring: ring handle
+ * @param  block: set to the start of the free block
+ * @retval Length of the block, fill it then call RingBuffer_Produce()
+ */
+uint32_t RingBuffer_GetWriteBlock(RingBuffer_TypeDef *ring, uint8_t **block)
+{
+	uint32_t head = ring->head;
+	uint32_t space = ring->size - (head - ring->tail);
+	uint32_t offset = head & (ring->size - 1U);
+	uint32_t linear = ring->size - offset;
+
+	__DMB();
+	*block = &ring->buffer[offset];
+	return (space < linear) ? space : linear;
+}
+
+/**
+ * @brief  Publish bytes written through RingBuffer_GetWriteBlock() (producer).
+ * @param  ring: ring handle
+ * @param  length: bytes written
+ * @retval None
+ */
+void RingBuffer_Produce(RingBuffer_TypeDef *ring, uint32_t length)
+{
+	__DMB();
+	ring->head += length;
+}
+
+/**
+ * @brief  Copy data out of the ring (consumer).
+ * @param  ring: ring handle
+ * @param  data: destination
+ * @param  length: maximum bytes to read
+ * @retval Bytes read
+ */
+ITCM_TEXT uint32_t RingBuffer_Read(RingBuffer_TypeDef *ring, void *data, uint32_t length)
+{
+	uint32_t tail = ring->tail;
+	uint32_t count = ring->head - tail;
+	uint32_t offset = tail & (ring->size - 1U);
+	uint32_t first;
+
+	if (length > count)
+	{
+		length = count;
+	}
+
+	first = ring->size - offset;
+	if (first > length)
+	{
+		first = length;
+	}
+
+	/* Read the bytes only after observing the head that covers them */
+	__DMB();
+	memcpy(data, &ring->buffer[offset], first);
+	memcpy((uint8_t *)data + first, ring->buffer, length - first);
+	__DMB();
+	ring->tail = tail + length;
+
+	return length;
+}
+
+/**
+ * @brief  Contiguous readable data at the read position (consumer).
+ * @param  ring: ring handle
+ * @param  block: set to the start of the readable block
+ * @retval Length of the block, release it with RingBuffer_Consume()
+ */
+ITCM_TEXT uint32_t RingBuffer_GetReadBlock(RingBuffer_TypeDef *ring, uint8_t **block)
+{
+	uint32_t tail = ring->tail;
+	uint32_t count = ring->head - tail;
+	uint32_t offset = tail & (ring->size - 1U);
+	uint32_t linear = ring->size - offset;
+
+	__DMB();
+	*block = &ring->buffer[offset];
+	return (count < linear) ? count : linear;
+}
+
+/**
+ * @brief  Release bytes obtained through RingBuffer_GetReadBlock() (consumer).
+ * @param  ring: ring handle
+ * @param  length: bytes consumed
+ * @retval None
+ */
+ITCM_TEXT void RingBuffer_Consume(RingBuffer_TypeDef *ring, uint32_t length)
+{
+	__DMB();
+	ring->tail += length;
+}
@@ -0,0 +1,297 @@
+/**
+  ******************************************************************************
+  * @file    sd_card.c
+  * @brief   SD card on SDMMC1 with multi-block DMA transfers.
+  *
+  *          The DMA streams run with their FIFO full threshold and 4-beat
+  *          bursts on both sides, and SDMMC hardware flow control stops
+  *          the card clock rather than underrun or overrun the data FIFO
+  *          when the bus matrix is busy (RM0385 SDMMC DMA note).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "dma_buffer.h"
+#include "mem_section.h"
+#include "sd_card.h"
+
+/* Private variables ---------------------------------------------------------*/
+static SD_HandleTypeDef sdCardHandle;
+static DMA_HandleTypeDef sdCardDmaRx;
+static DMA_HandleTypeDef sdCardDmaTx;
+static SdCard_DoneTypeDef sdCardDone;
+static uint32_t sdCardReady;                /* card identified, 4-bit bus */
+static uint8_t *sdCardRxBuffer;             /* read in progress, for DmaBuffer_CompleteRx() */
+static uint32_t sdCardRxLength;
+static SdCard_StatsTypeDef sdCardStats;
+
+/* Private functions ---------------------------------------------------------*/
+static HAL_StatusTypeDef SdCard_DmaInit(DMA_HandleTypeDef *hdma, DMA_Stream_TypeDef *stream, uint32_t direction)
+{
+	memset(hdma, 0, sizeof(*hdma));
+	hdma->Instance = stream;
+	hdma->Init.Channel = DMA_CHANNEL_4;
+	hdma->Init.Direction = direction;
+	hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma->Init.MemInc = DMA_MINC_ENABLE;
+	hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	/* The SDMMC ends the transfer, not the DMA counter */
+	hdma->Init.Mode = DMA_PFCTRL;
+	hdma->Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	hdma->Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+	hdma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	hdma->Init.MemBurst = DMA_MBURST_INC4;
+	hdma->Init.PeriphBurst = DMA_PBURST_INC4;
+	return HAL_DMA_Init(hdma);
+}
+
+static void SdCard_Complete(HAL_StatusTypeDef status)
+{
+	if (sdCardRxBuffer != NULL)
+	{
+		DmaBuffer_CompleteRx(sdCardRxBuffer, sdCardRxLength);
+		sdCardRxBuffer = NULL;
+	}
+	if (status != HAL_OK)
+	{
+		sdCardStats.errors++;
+	}
+	if (sdCardDone != NULL)
+	{
+		sdCardDone(status);
+	}
+}
+
+/* Card out of the programming state of the last write */
+static uint32_t SdCard_IsReady(void)
+{
+	return (HAL_SD_GetState(&sdCardHandle) == HAL_SD_STATE_READY)
+		&& (HAL_SD_GetCardState(&sdCardHandle) == HAL_SD_CARD_TRANSFER);
+}
+
+/**
+ * @brief  Identify the card and switch it to the 4-bit bus.
+ * @note   The SDMMC1 pins must already be in alternate function mode and
+ *         the 48 MHz clock running.
+ * @param  done: called from the SDMMC1 interrupt at the end of each
+ *         SdCard_Read()/SdCard_Write() transfer
+ * @retval HAL_OK, HAL_ERROR without a card or on a card error
+ */
+HAL_StatusTypeDef SdCard_Init(SdCard_DoneTypeDef done)
+{
+	sdCardDone = done;
+	sdCardReady = 0U;
+	sdCardRxBuffer = NULL;
+	memset(&sdCardStats, 0, sizeof(sdCardStats));
+
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_SDMMC1);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+
+	if ((SdCard_DmaInit(&sdCardDmaRx, DMA2_Stream3, DMA_PERIPH_TO_MEMORY) != HAL_OK)
+			|| (SdCard_DmaInit(&sdCardDmaTx, DMA2_Stream6, DMA_MEMORY_TO_PERIPH) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+
+	/* Identification at 400 kHz is done by HAL_SD_Init() whatever ClockDiv */
+	memset(&sdCardHandle, 0, sizeof(sdCardHandle));
+	sdCardHandle.Instance = SDMMC1;
+	sdCardHandle.Init.ClockEdge = SDMMC_CLOCK_EDGE_RISING;
+	sdCardHandle.Init.ClockBypass = SDMMC_CLOCK_BYPASS_DISABLE;
+	sdCardHandle.Init.ClockPowerSave = SDMMC_CLOCK_POWER_SAVE_DISABLE;
+	sdCardHandle.Init.BusWide = SDMMC_BUS_WIDE_1B;
+	sdCardHandle.Init.HardwareFlowControl = SDMMC_HARDWARE_FLOW_CONTROL_ENABLE;
+	sdCardHandle.Init.ClockDiv = SD_CARD_CLOCK_DIV;
+	__HAL_LINKDMA(&sdCardHandle, hdmarx, sdCardDmaRx);
+	__HAL_LINKDMA(&sdCardHandle, hdmatx, sdCardDmaTx);
+	if ((HAL_SD_Init(&sdCardHandle) != HAL_OK)
+			|| (HAL_SD_ConfigWideBusOperation(&sdCardHandle, SDMMC_BUS_WIDE_4B) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+
+	NVIC_SetPriority(SDMMC1_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), SD_CARD_IRQ_PRIORITY, 0));
+	NVIC_SetPriority(DMA2_Stream3_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), SD_CARD_IRQ_PRIORITY, 0));
+	NVIC_SetPriority(DMA2_Stream6_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), SD_CARD_IRQ_PRIORITY, 0));
+	NVIC_EnableIRQ(SDMMC1_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+
+	sdCardReady = 1U;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Card capacity.
+ * @param  blocks: set to the number of SD_CARD_BLOCK_SIZE blocks
+ * @retval HAL_OK, HAL_ERROR when no card was identified
+ */
+HAL_StatusTypeDef SdCard_GetBlockCount(uint32_t *blocks)
+{
+	HAL_SD_CardInfoTypeDef info;
+
+	if ((sdCardReady == 0U) || (HAL_SD_GetCardInfo(&sdCardHandle, &info) != HAL_OK)
+			|| (info.LogBlockSize != SD_CARD_BLOCK_SIZE))
+	{
+		return HAL_ERROR;
+	}
+	*blocks = info.LogBlockNbr;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Start a multi-block read.
+ * @param  buffer: count * SD_CARD_BLOCK_SIZE bytes, 32-bit aligned
+ * @param  block: first block
+ * @param  count: number of blocks
+ * @retval HAL_OK: started, done callback to come; HAL_BUSY: card or driver
+ *         busy, try again; HAL_ERROR, also without a card
+ */
+HAL_StatusTypeDef SdCard_Read(uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	uint32_t length = count * SD_CARD_BLOCK_SIZE;
+
+	if (sdCardReady == 0U)
+	{
+		return HAL_ERROR;
+	}
+	if (SdCard_IsReady() == 0U)
+	{
+		sdCardStats.busy++;
+		return HAL_BUSY;
+	}
+	sdCardRxBuffer = buffer;
+	sdCardRxLength = length;
+	DmaBuffer_PrepareRx(buffer, length);
+	if (HAL_SD_ReadBlocks_DMA(&sdCardHandle, buffer, block, count) != HAL_OK)
+	{
+		sdCardRxBuffer = NULL;
+		sdCardStats.errors++;
+		return HAL_ERROR;
+	}
+	sdCardStats.reads++;
+	sdCardStats.readBlocks += count;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Start a multi-block write.
+ * @param  buffer: count * SD_CARD_BLOCK_SIZE bytes, 32-bit aligned
+ * @param  block: first block
+ * @param  count: number of blocks
+ * @retval As SdCard_Read()
+ */
+HAL_StatusTypeDef SdCard_Write(const uint8_t *buffer, uint32_t block, uint32_t count)
+{
+	if (sdCardReady == 0U)
+	{
+		return HAL_ERROR;
+	}
+	if (SdCard_IsReady() == 0U)
+	{
+		sdCardStats.busy++;
+		return HAL_BUSY;
+	}
+	DmaBuffer_PrepareTx(buffer, count * SD_CARD_BLOCK_SIZE);
+	if (HAL_SD_WriteBlocks_DMA(&sdCardHandle, (uint8_t *)buffer, block, count) != HAL_OK)
+	{
+		sdCardStats.errors++;
+		return HAL_ERROR;
+	}
+	sdCardStats.writes++;
+	sdCardStats.writeBlocks += count;
+	return HAL_OK;
+}
+
+/**
+ * @brief  Copy the transfer counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void SdCard_GetStats(SdCard_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = sdCardStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the transfer counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void SdCard_Dump(SdCard_PutCharTypeDef putChar)
+{
+	SdCard_StatsTypeDef stats;
+	char line[128];
+
+	SdCard_GetStats(&stats);
+	snprintf(line, sizeof(line), "sd rd=%lu/%lu wr=%lu/%lu busy=%lu err=%lu\r\n",
+		(unsigned long)stats.reads, (unsigned long)stats.readBlocks, (unsigned long)stats.writes,
+		(unsigned long)stats.writeBlocks, (unsigned long)stats.busy, (unsigned long)stats.errors);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
+
+/**
+ * @brief  SDMMC1 global interrupt body, called from SDMMC1_IRQHandler().
+ * @retval None
+ */
+ITCM_TEXT void SdCard_IRQHandler(void)
+{
+	HAL_SD_IRQHandler(&sdCardHandle);
+}
+
+/**
+ * @brief  DMA2 stream 3 interrupt body (SDMMC1 RX).
+ * @retval None
+ */
+ITCM_TEXT void SdCard_RxDmaIRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&sdCardDmaRx);
+}
+
+/**
+ * @brief  DMA2 stream 6 interrupt body (SDMMC1 TX).
+ * @retval None
+ */
+ITCM_TEXT void SdCard_TxDmaIRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&sdCardDmaTx);
+}
+
+/* HAL SD callbacks ----------------------------------------------------------*/
+void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd)
+{
+	(void)hsd;
+	SdCard_Complete(HAL_OK);
+}
+
+void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd)
+{
+	(void)hsd;
+	SdCard_Complete(HAL_OK);
+}
+
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd)
+{
+	(void)hsd;
+	SdCard_Complete(HAL_ERROR);
+}
+
+void HAL_SD_AbortCallback(SD_HandleTypeDef *hsd)
+{
+	(void)hsd;
+	SdCard_Complete(HAL_ERROR);
+}
@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file    sdram.c
+  * @brief   External SDRAM on FMC SDRAM bank 1.
+  *
+  *          Power-up (JEDEC, RM0385 SDRAM initialization sequence): clock
+  *          enable, the stable clock delay of the part, precharge all, the
+  *          auto refresh cycles of the part, load mode register (burst of
+  *          one, the CAS latency, single location writes: the FMC splits
+  *          AHB bursts itself), then the refresh timer.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+
+#include "sdram.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SDRAM_MAX_CLOCKS            16U     /* SDTR fields */
+#define SDRAM_REFRESH_MARGIN        20U     /* RM0385: COUNT = period / rows - 20 */
+#define SDRAM_REFRESH_MIN           41U
+#define SDRAM_REFRESH_MAX           0x1FFFU
+#define SDRAM_MODE_CAS_POS          4U
+#define SDRAM_MODE_WRITE_SINGLE     0x0200U
+
+/* Exported variables --------------------------------------------------------*/
+const Sdram_ConfigTypeDef sdramMt48lc4m32b2 =
+{
+	.name = "MT48LC4M32B2", .rowBits = 12U, .columnBits = 8U, .internalBanks = 4U, .busWidth = 16U,
+	.casLatency = 3U, .maxClockHz = 166000000U,
+	.tRCD = 18U, .tRP = 18U, .tRAS = 42U, .tRC = 60U, .tWR = 12U, .tXSR = 70U, .tMRD = 2U,
+	.refreshMs = 64U, .refreshRows = 4096U, .autoRefreshes = 2U, .powerUpUs = 100U
+};
+
+const Sdram_ConfigTypeDef sdramIs42s16400j =
+{
+	.name = "IS42S16400J", .rowBits = 12U, .columnBits = 8U, .internalBanks = 4U, .busWidth = 16U,
+	.casLatency = 3U, .maxClockHz = 143000000U,
+	.tRCD = 15U, .tRP = 15U, .tRAS = 42U, .tRC = 63U, .tWR = 14U, .tXSR = 70U, .tMRD = 2U,
+	.refreshMs = 64U, .refreshRows = 4096U, .autoRefreshes = 8U, .powerUpUs = 200U
+};
+
+const Sdram_ConfigTypeDef sdramIs42s32800g =
+{
+	.name = "IS42S32800G", .rowBits = 12U, .columnBits = 9U, .internalBanks = 4U, .busWidth = 16U,
+	.casLatency = 3U, .maxClockHz = 166000000U,
+	.tRCD = 18U, .tRP = 18U, .tRAS = 42U, .tRC = 60U, .tWR = 12U, .tXSR = 70U, .tMRD = 2U,
+	.refreshMs = 64U, .refreshRows = 4096U, .autoRefreshes = 8U, .powerUpUs = 200U
+};
+
+/* Private variables ---------------------------------------------------------*/
+static SDRAM_HandleTypeDef sdramHandle;
+static Sdram_TimingTypeDef sdramTiming;
+static const Sdram_ConfigTypeDef *sdramConfig;
+static MemHeap_TypeDef sdramHeap;
+
+/* Heap: from the end of .sdram to the end of the SDRAM region, linker script */
+extern uint8_t _ssdram_heap[];
+extern uint8_t _esdram_heap[];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Whole clock periods covering a delay.
+ */
+static uint32_t Sdram_Clocks(uint32_t ns, uint32_t clockHz)
+{
+	uint32_t clocks = (uint32_t)(((uint64_t)ns * clockHz + 999999999ULL) / 1000000000ULL);
+
+	return (clocks != 0U) ? clocks : 1U;
+}
+
+static HAL_StatusTypeDef Sdram_Command(uint32_t mode, uint32_t autoRefreshes, uint32_t modeRegister)
+{
+	FMC_SDRAM_CommandTypeDef command;
+
+	command.CommandMode = mode;
+	command.CommandTarget = FMC_SDRAM_CMD_TARGET_BANK1;
+	command.AutoRefreshNumber = autoRefreshes;
+	command.ModeRegisterDefinition = modeRegister;
+	return HAL_SDRAM_SendCommand(&sdramHandle, &command, SDRAM_TIMEOUT_MS);
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Controller settings of a part at a given HCLK.
+ * @note   SDCLK is the fastest of HCLK/2 and HCLK/3 the part takes. The
+ *         write recovery is stretched to the two RM0385 SDTR constraints,
+ *         TWR >= TRAS - TRCD and TWR >= TRC - TRCD - TRP, the controller
+ *         closing rows by its own count. Pure function.
+ * @param  config: part
+ * @param  hclkHz: AHB clock
+ * @param  timing: filled in, SDBank FMC_SDRAM_BANK1
+ * @retval HAL_OK, HAL_ERROR when the geometry is not one of the controller,
+ *         no SDCLK is slow enough, a delay exceeds 16 clocks or the refresh
+ *         count is out of the 41 to 8191 range
+ */
+HAL_StatusTypeDef Sdram_CalcTiming(const Sdram_ConfigTypeDef *config, uint32_t hclkHz, Sdram_TimingTypeDef *timing)
+{
+	FMC_SDRAM_TimingTypeDef *t = &timing->timing;
+	uint32_t divider;
+	uint32_t rowClocks;
+
+	if ((config->rowBits < 11U) || (config->rowBits > 13U) || (config->columnBits < 8U)
+			|| (config->columnBits > 11U) || ((config->internalBanks != 2U) && (config->internalBanks != 4U))
+			|| ((config->busWidth != 8U) && (config->busWidth != 16U) && (config->busWidth != 32U))
+			|| (config->casLatency < 1U) || (config->casLatency > 3U) || (config->tMRD > SDRAM_MAX_CLOCKS)
+			|| (config->autoRefreshes < 1U) || (config->autoRefreshes > 15U) || (config->refreshRows == 0U))
+	{
+		return HAL_ERROR;
+	}
+
+	divider = ((hclkHz / 2U) <= config->maxClockHz) ? 2U : 3U;
+	timing->clockHz = hclkHz / divider;
+	if ((timing->clockHz > config->maxClockHz) || (timing->clockHz == 0U))
+	{
+		return HAL_ERROR;
+	}
+
+	memset(&timing->init, 0, sizeof(timing->init));
+	timing->init.SDBank = FMC_SDRAM_BANK1;
+	timing->init.ColumnBitsNumber = FMC_SDRAM_COLUMN_BITS_NUM_8 + (config->columnBits - 8U);
+	timing->init.RowBitsNumber = FMC_SDRAM_ROW_BITS_NUM_11 + ((config->rowBits - 11U) << 2);
+	timing->init.MemoryDataWidth = (config->busWidth == 8U) ? FMC_SDRAM_MEM_BUS_WIDTH_8
+		: ((config->busWidth == 16U) ? FMC_SDRAM_MEM_BUS_WIDTH_16 : FMC_SDRAM_MEM_BUS_WIDTH_32);
+	timing->init.InternalBankNumber = (config->internalBanks == 4U) ? FMC_SDRAM_INTERN_BANKS_NUM_4
+		: FMC_SDRAM_INTERN_BANKS_NUM_2;
+	timing->init.CASLatency = config->casLatency << FMC_SDCR1_CAS_Pos;
+	timing->init.WriteProtection = FMC_SDRAM_WRITE_PROTECTION_DISABLE;
+	timing->init.SDClockPeriod = (divider == 2U) ? FMC_SDRAM_CLOCK_PERIOD_2 : FMC_SDRAM_CLOCK_PERIOD_3;
+	timing->init.ReadBurst = FMC_SDRAM_RBURST_ENABLE;
+	timing->init.ReadPipeDelay = FMC_SDRAM_RPIPE_DELAY_0;
+
+	t->LoadToActiveDelay = (config->tMRD != 0U) ? config->tMRD : 1U;
+	t->ExitSelfRefreshDelay = Sdram_Clocks(config->tXSR, timing->clockHz);
+	t->SelfRefreshTime = Sdram_Clocks(config->tRAS, timing->clockHz);
+	t->RowCycleDelay = Sdram_Clocks(config->tRC, timing->clockHz);
+	t->WriteRecoveryTime = Sdram_Clocks(config->tWR, timing->clockHz);
+	t->RPDelay = Sdram_Clocks(config->tRP, timing->clockHz);
+	t->RCDDelay = Sdram_Clocks(config->tRCD, timing->clockHz);
+	if ((t->SelfRefreshTime > t->RCDDelay) && (t->WriteRecoveryTime < t->SelfRefreshTime - t->RCDDelay))
+	{
+		t->WriteRecoveryTime = t->SelfRefreshTime - t->RCDDelay;
+	}
+	if ((t->RowCycleDelay > t->RCDDelay + t->RPDelay)
+			&& (t->WriteRecoveryTime < t->RowCycleDelay - t->RCDDelay - t->RPDelay))
+	{
+		t->WriteRecoveryTime = t->RowCycleDelay - t->RCDDelay - t->RPDelay;
+	}
+	if ((t->ExitSelfRefreshDelay > SDRAM_MAX_CLOCKS) || (t->SelfRefreshTime > SDRAM_MAX_CLOCKS)
+			|| (t->RowCycleDelay > SDRAM_MAX_CLOCKS) || (t->WriteRecoveryTime > SDRAM_MAX_CLOCKS)
+			|| (t->RPDelay > SDRAM_MAX_CLOCKS) || (t->RCDDelay > SDRAM_MAX_CLOCKS))
+	{
+		return HAL_ERROR;
+	}
+
+	rowClocks = (uint32_t)(((uint64_t)config->refreshMs * timing->clockHz) / (1000ULL * config->refreshRows));
+	if ((rowClocks < SDRAM_REFRESH_MIN + SDRAM_REFRESH_MARGIN) || (rowClocks > SDRAM_REFRESH_MAX + SDRAM_REFRESH_MARGIN))
+	{
+		return HAL_ERROR;
+	}
+	timing->refreshCount = rowClocks - SDRAM_REFRESH_MARGIN;
+
+	timing->modeRegister = SDRAM_MODE_WRITE_SINGLE | (config->casLatency << SDRAM_MODE_CAS_POS);
+	timing->size = (1UL << (config->rowBits + config->columnBits)) * config->internalBanks * (config->busWidth / 8U);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Bring up the part, map it and set up the heap.
+ * @note   The FMC pins must already be in alternate function mode and the
+ *         system clock final: the timing is computed for the HCLK of now.
+ * @param  config: part fitted
+ * @retval HAL_OK, HAL_ERROR when the part does not fit this HCLK or a
+ *         command is refused
+ */
+HAL_StatusTypeDef Sdram_Init(const Sdram_ConfigTypeDef *config)
+{
+	if (Sdram_CalcTiming(config, HAL_RCC_GetHCLKFreq(), &sdramTiming) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	sdramConfig = config;
+
+	LL_AHB3_GRP1_EnableClock(LL_AHB3_GRP1_PERIPH_FMC);
+
+	memset(&sdramHandle, 0, sizeof(sdramHandle));
+	sdramHandle.Instance = FMC_SDRAM_DEVICE;
+	sdramHandle.Init = sdramTiming.init;
+	if ((HAL_SDRAM_Init(&sdramHandle, &sdramTiming.timing) != HAL_OK)
+			|| (Sdram_Command(FMC_SDRAM_CMD_CLK_ENABLE, 1U, 0U) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+	/* The tick is the millisecond: longer than the power-up delay of any part */
+	HAL_Delay((config->powerUpUs + 999U) / 1000U);
+	if ((Sdram_Command(FMC_SDRAM_CMD_PALL, 1U, 0U) != HAL_OK)
+			|| (Sdram_Command(FMC_SDRAM_CMD_AUTOREFRESH_MODE, config->autoRefreshes, 0U) != HAL_OK)
+			|| (Sdram_Command(FMC_SDRAM_CMD_LOAD_MODE, 1U, sdramTiming.modeRegister) != HAL_OK)
+			|| (HAL_SDRAM_ProgramRefreshRate(&sdramHandle, sdramTiming.refreshCount) != HAL_OK))
+	{
+		return HAL_ERROR;
+	}
+
+	if (Sdram_SetCache(MPU_REGIONS_NORMAL_WRITE_BACK) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	MemHeap_Init(&sdramHeap, _ssdram_heap, (uint32_t)(_esdram_heap - _ssdram_heap));
+	return HAL_OK;
+}
+
+/**
+ * @brief  Change the memory attributes of the SDRAM.
+ * @note   The whole D-cache is cleaned and invalidated first: lines of the
+ *         old mapping must neither be written back nor hit afterwards.
+ * @param  type: MPU_REGIONS_NORMAL_xxx
+ * @retval HAL_OK, HAL_ERROR when the region cannot be built
+ */
+HAL_StatusTypeDef Sdram_SetCache(MpuRegions_MemoryTypeDef type)
+{
+	MpuRegions_DescTypeDef region = { SDRAM_BASE, sdramTiming.size, type, ARM_MPU_AP_FULL, 1U, 0U };
+	ARM_MPU_Region_t table[1];
+
+	if (MpuRegions_Build(&region, 1U, SDRAM_MPU_REGION, table) != 1U)
+	{
+		return HAL_ERROR;
+	}
+	SCB_CleanInvalidateDCache();
+	MpuRegions_Load(table, 1U);
+	return HAL_OK;
+}
+
+/**
+ * @brief  Allocate from the SDRAM heap.
+ * @param  size: bytes
+ * @retval MEM_HEAP_ALIGN aligned buffer, NULL when no block is large enough
+ */
+void *Sdram_Alloc(uint32_t size)
+{
+	return MemHeap_Alloc(&sdramHeap, size);
+}
+
+/**
+ * @brief  Free a buffer of the SDRAM heap.
+ * @param  buffer: pointer returned by Sdram_Alloc(), or NULL
+ * @retval None
+ */
+void Sdram_Free(void *buffer)
+{
+	MemHeap_Free(&sdramHeap, buffer);
+}
+
+/**
+ * @brief  HAL handle, for HAL_SDRAM_Read/Write_xxx.
+ * @retval Handle
+ */
+SDRAM_HandleTypeDef *Sdram_GetHandle(void)
+{
+	return &sdramHandle;
+}
+
+/**
+ * @brief  Controller settings in use.
+ * @retval Settings, all zero before Sdram_Init()
+ */
+const Sdram_TimingTypeDef *Sdram_GetTiming(void)
+{
+	return &sdramTiming;
+}
+
+/**
+ * @brief  Snapshot of the heap usage.
+ * @param  stats: filled in
+ * @retval None
+ */
+void Sdram_GetHeapStats(MemHeap_StatsTypeDef *stats)
+{
+	MemHeap_GetStats(&sdramHeap, stats);
+}
+
+/**
+ * @brief  Print the part and the heap usage.
+ * @param  putChar: output function
+ * @retval None
+ */
+void Sdram_Dump(Sdram_PutCharTypeDef putChar)
+{
+	MemHeap_StatsTypeDef stats;
+	char line[160];
+
+	Sdram_GetHeapStats(&stats);
+	snprintf(line, sizeof(line), "sdram %s %lu MHz %lu KB, heap free=%lu min=%lu largest=%lu blocks=%lu"
+		" alloc=%lu free=%lu fail=%lu\r\n", (sdramConfig != NULL) ? sdramConfig->name : "-",
+		(unsigned long)(sdramTiming.clockHz / 1000000U), (unsigned long)(sdramTiming.size / 1024U),
+		(unsigned long)stats.freeBytes, (unsigned long)stats.minFreeBytes, (unsigned long)stats.largestFree,
+		(unsigned long)stats.freeBlocks, (unsigned long)stats.allocs, (unsigned long)stats.frees,
+		(unsigned long)stats.failures);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -18,6 +18,16 @@
 /* USER CODE END Header */
 
 /* Includes ------------------------------------------------------------------*/
+#include "eth_if.h"
+#include "gfx_engine.h"
+#include "kernel.h"
+#include "lcd_fb.h"
+#include "mem_section.h"
+#include "profile.h"
+#include "sd_card.h"
+#include "timebase.h"
+#include "usart_dma.h"
+#include "usb_device.h"
 
 /* Private includes ----------------------------------------------------------*/
 
@@ -78,44 +88,135 @@ void UsageFault_Handler(void)
 	while(1);
 }
 
+/* SVC_Handler and PendSV_Handler: kernel context switch, see kernel_port.c */
+
 /**
-  * @brief This function handles System service call via SWI instruction.
+  * @brief This function handles Debug monitor.
   */
-void SVC_Handler(void)
+void DebugMon_Handler(void)
 {
 
 }
 
 /**
-  * @brief This function handles Debug monitor.
+  * @brief This function handles System tick timer.
   */
-void DebugMon_Handler(void)
+ITCM_TEXT void SysTick_Handler(void)
+{
+	PROFILE_BEGIN(PROFILE_ID_SYSTICK_IRQ);
+	Timebase_IRQHandler();
+	Kernel_Tick();
+	PROFILE_END(PROFILE_ID_SYSTICK_IRQ);
+}
+
+/******************************************************************************/
+/* STM32F7xx Peripheral Interrupt Handlers                                    */
+/* Add here the Interrupt Handlers for the used peripherals.                  */
+/* For the available peripheral interrupt handler names,                      */
+/* please refer to the startup file (startup_stm32f7xx.s).                    */
+/******************************************************************************/
+
+/**
+  * @brief This function handles USART1 global interrupt.
+  */
+ITCM_TEXT void USART1_IRQHandler(void)
 {
+	PROFILE_BEGIN(PROFILE_ID_USART1_IRQ);
+	UsartDma_IRQHandler();
+	PROFILE_END(PROFILE_ID_USART1_IRQ);
+}
 
+/**
+  * @brief This function handles DMA2 stream2 global interrupt (USART1 RX).
+  */
+ITCM_TEXT void DMA2_Stream2_IRQHandler(void)
+{
+	PROFILE_BEGIN(PROFILE_ID_USART1_RX_DMA_IRQ);
+	UsartDma_RxDmaIRQHandler();
+	PROFILE_END(PROFILE_ID_USART1_RX_DMA_IRQ);
 }
 
 /**
-  * @brief This function handles Pendable request for system service.
+  * @brief This function handles DMA2 stream3 global interrupt (SDMMC1 RX).
   */
-void PendSV_Handler(void)
+ITCM_TEXT void DMA2_Stream3_IRQHandler(void)
 {
-	
+	SdCard_RxDmaIRQHandler();
 }
 
 /**
-  * @brief This function handles System tick timer.
+  * @brief This function handles DMA2 stream6 global interrupt (SDMMC1 TX).
   */
-void SysTick_Handler(void)
+ITCM_TEXT void DMA2_Stream6_IRQHandler(void)
 {
+	SdCard_TxDmaIRQHandler();
+}
 
+/**
+  * @brief This function handles DMA2 stream7 global interrupt (USART1 TX).
+  */
+ITCM_TEXT void DMA2_Stream7_IRQHandler(void)
+{
+	PROFILE_BEGIN(PROFILE_ID_USART1_TX_DMA_IRQ);
+	UsartDma_TxDmaIRQHandler();
+	PROFILE_END(PROFILE_ID_USART1_TX_DMA_IRQ);
 }
 
-/******************************************************************************/
-/* STM32F7xx Peripheral Interrupt Handlers                                    */
-/* Add here the Interrupt Handlers for the used peripherals.                  */
-/* For the available peripheral interrupt handler names,                      */
-/* please refer to the startup file (startup_stm32f7xx.s).                    */
-/******************************************************************************/
+/**
+  * @brief This function handles Ethernet global interrupt.
+  */
+ITCM_TEXT void ETH_IRQHandler(void)
+{
+	EthIf_IRQHandler();
+}
+
+/**
+  * @brief This function handles SDMMC1 global interrupt.
+  */
+ITCM_TEXT void SDMMC1_IRQHandler(void)
+{
+	SdCard_IRQHandler();
+}
+
+/**
+  * @brief This function handles USB On The Go FS global interrupt.
+  */
+ITCM_TEXT void OTG_FS_IRQHandler(void)
+{
+	UsbDevice_IRQHandler();
+}
+
+/**
+  * @brief This function handles USB On The Go HS global interrupt.
+  */
+ITCM_TEXT void OTG_HS_IRQHandler(void)
+{
+	UsbDevice_IRQHandler();
+}
+
+/**
+  * @brief This function handles LTDC global interrupt.
+  */
+ITCM_TEXT void LTDC_IRQHandler(void)
+{
+	LcdFb_IRQHandler();
+}
+
+/**
+  * @brief This function handles LTDC global error interrupt.
+  */
+ITCM_TEXT void LTDC_ER_IRQHandler(void)
+{
+	LcdFb_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA2D global interrupt.
+  */
+ITCM_TEXT void DMA2D_IRQHandler(void)
+{
+	GfxEngine_IRQHandler();
+}
 
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
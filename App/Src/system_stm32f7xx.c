@@ -83,7 +83,13 @@
 /*!< Uncomment the following line if you need to relocate your vector Table
      in Sram else user remap will be done in Flash. */
 /* #define VECT_TAB_SRAM */
-#if defined(VECT_TAB_SRAM)
+/*!< VECT_TAB_FLASH_ITCM: image linked for the ITCM-bus flash alias (Makefile FLASH_BUS=ITCM) */
+#if defined(VECT_TAB_FLASH_ITCM)
+#define VECT_TAB_BASE_ADDRESS   FLASHITCM_BASE  /*!< Vector Table base address field.
+                                                     This value must be a multiple of 0x200. */
+#define VECT_TAB_OFFSET         0x00000000U     /*!< Vector Table base offset field.
+                                                     This value must be a multiple of 0x200. */
+#elif defined(VECT_TAB_SRAM)
 #define VECT_TAB_BASE_ADDRESS   RAMDTCM_BASE    /*!< Vector Table base address field.
                                                      This value must be a multiple of 0x200. */
 #define VECT_TAB_OFFSET         0x00000000U     /*!< Vector Table base offset field.
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    timebase.c
+  * @brief   1 ms SysTick timebase driving the application timer wheel,
+  *          with tickless idle.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx.h"
+
+#include "mem_section.h"
+#include "timebase.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TIMEBASE_IRQ_PRIORITY   15U     /* lowest, preempted by every peripheral */
+
+/* Private variables ---------------------------------------------------------*/
+static TimerWheel_TypeDef timebaseWheel DTCM_BSS;
+static volatile uint32_t timebaseTicks;     /* ticks counted by SysTick and Timebase_IdleFor(), ISR-owned */
+static uint32_t timebaseCyclesPerTick;
+
+/* Private functions ---------------------------------------------------------*/
+static inline int Timebase_IsTickPending(void)
+{
+	return (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U;
+}
+
+/**
+ * @brief  Start SysTick at TIMEBASE_TICK_HZ from the current SystemCoreClock.
+ * @note   Replaces LL_Init1msTick(): same period, with the interrupt enabled.
+ * @retval None
+ */
+void Timebase_Init(void)
+{
+	timebaseCyclesPerTick = SystemCoreClock / TIMEBASE_TICK_HZ;
+	timebaseTicks = 0;
+	TimerWheel_Init(&timebaseWheel, 0);
+
+	NVIC_SetPriority(SysTick_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), TIMEBASE_IRQ_PRIORITY, 0));
+	SysTick->LOAD = timebaseCyclesPerTick - 1U;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+/**
+ * @brief  SysTick interrupt body, called from SysTick_Handler().
+ * @retval None
+ */
+ITCM_TEXT void Timebase_IRQHandler(void)
+{
+	timebaseTicks++;
+}
+
+/**
+ * @brief  Feed the elapsed ticks to the wheel and run expired callbacks.
+ * @note   The wheel catches up with the tick count, which stays the time
+ *         reference meanwhile: Timebase_GetTick() never goes backwards.
+ * @retval None
+ */
+void Timebase_Poll(void)
+{
+	uint32_t ticks = timebaseTicks - TimerWheel_GetTicks(&timebaseWheel);
+
+	if (ticks != 0U)
+	{
+		TimerWheel_Advance(&timebaseWheel, ticks);
+	}
+}
+
+/**
+ * @brief  Ticks from now until Timebase_Poll() has callbacks to run.
+ * @note   The wheel is behind the tick count between two polls.
+ * @retval ticks, 0 when due, TIMER_WHEEL_NO_EXPIRY when no timer is armed
+ */
+uint32_t Timebase_TicksToNextExpiry(void)
+{
+	uint32_t next = TimerWheel_TicksToNextExpiry(&timebaseWheel);
+	uint32_t behind = timebaseTicks - TimerWheel_GetTicks(&timebaseWheel);
+
+	if (next == TIMER_WHEEL_NO_EXPIRY)
+	{
+		return next;
+	}
+	return (behind >= next) ? 0U : (next - behind);
+}
+
+/**
+ * @brief  Sleep until the next timer event or any interrupt.
+ * @retval None
+ */
+void Timebase_Idle(void)
+{
+	Timebase_IdleFor(UINT32_MAX);
+}
+
+/**
+ * @brief  Sleep until the next timer event, any interrupt or at most
+ *         maxTicks (the next kernel task timeout, see Kernel_IdleHook()).
+ * @note   The SysTick reload is stretched over the idle ticks (limited by
+ *         its 24-bit counter, ~77 ms at 216 MHz). On wake-up the cycles
+ *         elapsed since the last tick boundary before the sleep are counted
+ *         as whole ticks and the partial tick is kept as the first period
+ *         of the restarted SysTick.
+ * @param  maxTicks: upper bound of the sleep, 0 returns at once
+ * @retval None
+ */
+void Timebase_IdleFor(uint32_t maxTicks)
+{
+	uint32_t idle;
+	uint32_t maxIdle = (SysTick_LOAD_RELOAD_Msk + 1U) / timebaseCyclesPerTick;
+	uint32_t remaining;
+	uint32_t reload;
+	uint32_t elapsed;
+
+	__disable_irq();
+
+	idle = Timebase_TicksToNextExpiry();
+	if ((idle == 0U) || (maxTicks == 0U))
+	{
+		/* A timer is already due, do not sleep */
+		__enable_irq();
+		return;
+	}
+	if (idle > maxTicks)
+	{
+		idle = maxTicks;
+	}
+	if (idle > maxIdle)
+	{
+		idle = maxIdle;
+	}
+
+	if (idle > 1U)
+	{
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		if (Timebase_IsTickPending())
+		{
+			/* The tick elapsed while stopping: let the ISR count it normally */
+			SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+			__enable_irq();
+			return;
+		}
+
+		/* Cycles left in the current tick, the stretch ends on a tick boundary */
+		remaining = SysTick->VAL;
+		reload = remaining + (timebaseCyclesPerTick * (idle - 1U));
+		SysTick->LOAD = reload;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+		__DSB();
+		__WFI();
+		__ISB();
+
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		if (Timebase_IsTickPending())
+		{
+			/* Slept the whole stretch: account it here instead of in the ISR,
+			   the counter restarted from reload at the wrap */
+			SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+			timebaseTicks += idle;
+			elapsed = reload - SysTick->VAL;
+		}
+		else
+		{
+			/* Woken early by another interrupt */
+			elapsed = (reload - SysTick->VAL) + (timebaseCyclesPerTick - remaining);
+		}
+		timebaseTicks += elapsed / timebaseCyclesPerTick;
+		SysTick->LOAD = timebaseCyclesPerTick - 1U - (elapsed % timebaseCyclesPerTick);
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		SysTick->LOAD = timebaseCyclesPerTick - 1U;
+	}
+	else
+	{
+		__DSB();
+		__WFI();
+		__ISB();
+	}
+
+	__enable_irq();
+}
+
+/**
+ * @brief  Milliseconds since Timebase_Init().
+ * @retval tick count
+ */
+uint32_t Timebase_GetTick(void)
+{
+	return timebaseTicks;
+}
+
+#ifndef HOST_BUILD
+/**
+ * @brief  HAL time base (overrides the weak one of stm32f7xx_hal.c): the
+ *         HAL drivers share this tick, HAL_InitTick() is never called.
+ * @note   The host model provides its own, see host_sim.c.
+ * @retval tick count
+ */
+uint32_t HAL_GetTick(void)
+{
+	return Timebase_GetTick();
+}
+#endif
+
+/**
+ * @brief  Arm a timer on the application wheel (thread context only).
+ * @param  timer: timer storage
+ * @param  delayMs: time to the first expiry
+ * @param  periodMs: reload period, 0 for one-shot
+ * @param  callback: function run from Timebase_Poll()
+ * @param  arg: callback argument
+ * @retval None
+ */
+void Timebase_StartTimer(TimerWheel_TimerTypeDef *timer, uint32_t delayMs, uint32_t periodMs,
+		TimerWheel_CallbackTypeDef callback, void *arg)
+{
+	TimerWheel_Start(&timebaseWheel, timer, delayMs, periodMs, callback, arg);
+}
+
+/**
+ * @brief  Disarm a timer on the application wheel (thread context only).
+ * @param  timer: timer to stop
+ * @retval None
+ */
+void Timebase_StopTimer(TimerWheel_TimerTypeDef *timer)
+{
+	TimerWheel_Stop(&timebaseWheel, timer);
+}
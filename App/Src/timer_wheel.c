@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file    timer_wheel.c
+  * @brief   Hierarchical timer wheel (6 levels x 64 slots).
+  *
+  *          A timer due in delta ticks lives in level delta / 64^level,
+  *          slot (expiry >> 6 * level) % 64. Whenever the level-0 index
+  *          wraps, the current slot of the next level is cascaded down.
+  *          One bitmap per level marks the non-empty slots, so the next
+  *          event is found with a rotate and a count-trailing-zeros.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "timer_wheel.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TIMER_WHEEL_SLOT_MASK   (TIMER_WHEEL_SLOTS - 1U)
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint64_t TimerWheel_Rotr(uint64_t value, uint32_t shift)
+{
+	return (shift == 0U) ? value : ((value >> shift) | (value << (64U - shift)));
+}
+
+static inline uint32_t TimerWheel_Ctz(uint64_t value)
+{
+	return (uint32_t)__builtin_ctzll(value);
+}
+
+static void TimerWheel_Insert(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer)
+{
+	uint32_t delta = timer->expiry - wheel->ticks;
+	uint32_t level = (delta == 0U) ? 0U : ((31U - (uint32_t)__builtin_clz(delta)) / TIMER_WHEEL_SLOT_BITS);
+	uint32_t index = (timer->expiry >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+	TimerWheel_TimerTypeDef **head = &wheel->slot[level][index];
+
+	timer->next = *head;
+	if (*head != NULL)
+	{
+		(*head)->pprev = &timer->next;
+	}
+	*head = timer;
+	timer->pprev = head;
+	timer->slot = (uint16_t)((level * TIMER_WHEEL_SLOTS) + index);
+	wheel->occupied[level] |= 1ULL << index;
+}
+
+static void TimerWheel_Unlink(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer)
+{
+	uint32_t level = timer->slot / TIMER_WHEEL_SLOTS;
+	uint32_t index = timer->slot & TIMER_WHEEL_SLOT_MASK;
+
+	*timer->pprev = timer->next;
+	if (timer->next != NULL)
+	{
+		timer->next->pprev = timer->pprev;
+	}
+	timer->next = NULL;
+	timer->pprev = NULL;
+
+	if (wheel->slot[level][index] == NULL)
+	{
+		wheel->occupied[level] &= ~(1ULL << index);
+	}
+}
+
+static void TimerWheel_Cascade(TimerWheel_TypeDef *wheel, uint32_t level, uint32_t index)
+{
+	TimerWheel_TimerTypeDef *timer;
+
+	while ((timer = wheel->slot[level][index]) != NULL)
+	{
+		TimerWheel_Unlink(wheel, timer);
+		TimerWheel_Insert(wheel, timer);
+	}
+}
+
+static void TimerWheel_ProcessTick(TimerWheel_TypeDef *wheel)
+{
+	TimerWheel_TimerTypeDef *timer;
+	uint32_t index = ++wheel->ticks & TIMER_WHEEL_SLOT_MASK;
+
+	if (index == 0U)
+	{
+		for (uint32_t level = 1; level < TIMER_WHEEL_LEVELS; level++)
+		{
+			uint32_t upper = (wheel->ticks >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+			TimerWheel_Cascade(wheel, level, upper);
+			if (upper != 0U)
+			{
+				break;
+			}
+		}
+	}
+
+	/* Re-read the head every time: a callback may stop any pending timer */
+	while ((timer = wheel->slot[0][index]) != NULL)
+	{
+		TimerWheel_Unlink(wheel, timer);
+		if (timer->period != 0U)
+		{
+			timer->expiry += timer->period;
+			TimerWheel_Insert(wheel, timer);
+		}
+		timer->callback(timer->arg);
+	}
+}
+
+/**
+ * @brief  Initialize an empty wheel.
+ * @param  wheel: wheel handle
+ * @param  ticks: current time in ticks
+ * @retval None
+ */
+void TimerWheel_Init(TimerWheel_TypeDef *wheel, uint32_t ticks)
+{
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->ticks = ticks;
+}
+
+/**
+ * @brief  Arm (or re-arm) a timer.
+ * @param  wheel: wheel handle
+ * @param  timer: timer storage, owned by the caller until stopped
+ * @param  delay: ticks until the first expiry, 0 is rounded up to 1
+ * @param  period: reload in ticks for periodic timers, 0 for one-shot
+ * @param  callback: function run from TimerWheel_Advance() on expiry
+ * @param  arg: callback argument
+ * @retval None
+ */
+void TimerWheel_Start(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer, uint32_t delay,
+		uint32_t period, TimerWheel_CallbackTypeDef callback, void *arg)
+{
+	if (TimerWheel_IsActive(timer))
+	{
+		TimerWheel_Unlink(wheel, timer);
+	}
+
+	timer->expiry = wheel->ticks + ((delay == 0U) ? 1U : delay);
+	timer->period = period;
+	timer->callback = callback;
+	timer->arg = arg;
+	TimerWheel_Insert(wheel, timer);
+}
+
+/**
+ * @brief  Disarm a timer, no-op if it is not armed.
+ * @param  wheel: wheel handle
+ * @param  timer: timer to stop
+ * @retval None
+ */
+void TimerWheel_Stop(TimerWheel_TypeDef *wheel, TimerWheel_TimerTypeDef *timer)
+{
+	if (TimerWheel_IsActive(timer))
+	{
+		TimerWheel_Unlink(wheel, timer);
+	}
+}
+
+/**
+ * @brief  Advance the wheel time and run every callback that expires.
+ * @note   Empty stretches are skipped in one step, so a long tickless
+ *         sleep costs one iteration per event rather than per tick.
+ * @param  wheel: wheel handle
+ * @param  ticks: elapsed ticks
+ * @retval None
+ */
+void TimerWheel_Advance(TimerWheel_TypeDef *wheel, uint32_t ticks)
+{
+	while (ticks != 0U)
+	{
+		uint32_t next = TimerWheel_TicksToNextExpiry(wheel);
+
+		if (next > ticks)
+		{
+			wheel->ticks += ticks;
+			return;
+		}
+
+		wheel->ticks += next - 1U;
+		ticks -= next;
+		TimerWheel_ProcessTick(wheel);
+	}
+}
+
+/**
+ * @brief  Ticks until the wheel next has work to do.
+ * @note   For timers in the upper levels this is the cascade tick, which
+ *         may precede the expiry: a sleep never overshoots a timer.
+ * @param  wheel: wheel handle
+ * @retval Ticks in [1, 2^32 - 1], TIMER_WHEEL_NO_EXPIRY when no timer is armed
+ */
+uint32_t TimerWheel_TicksToNextExpiry(const TimerWheel_TypeDef *wheel)
+{
+	uint32_t best = TIMER_WHEEL_NO_EXPIRY;
+
+	if (wheel->occupied[0] != 0U)
+	{
+		uint32_t start = (wheel->ticks + 1U) & TIMER_WHEEL_SLOT_MASK;
+		best = TimerWheel_Ctz(TimerWheel_Rotr(wheel->occupied[0], start)) + 1U;
+	}
+
+	for (uint32_t level = 1; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		if (wheel->occupied[level] != 0U)
+		{
+			uint32_t shift = level * TIMER_WHEEL_SLOT_BITS;
+			uint32_t unit = 1UL << shift;
+			/* First tick after now where this level cascades */
+			uint32_t boundary = (wheel->ticks + unit) & ~(unit - 1U);
+			uint32_t start = (boundary >> shift) & TIMER_WHEEL_SLOT_MASK;
+			uint32_t ahead = TimerWheel_Ctz(TimerWheel_Rotr(wheel->occupied[level], start));
+			uint32_t delta = boundary + (ahead * unit) - wheel->ticks;
+
+			if (delta < best)
+			{
+				best = delta;
+			}
+		}
+	}
+
+	return best;
+}
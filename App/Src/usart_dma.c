@@ -0,0 +1,354 @@
+/**
+  ******************************************************************************
+  * @file    usart_dma.c
+  * @brief   USART1 DMA transmit/receive engine.
+  *
+  *          The RX DMA buffer and the TX ring storage come from the
+  *          coherent DMA pool; the dma_buffer handoff calls keep them
+  *          correct should they move to cached memory.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "stm32f7xx_ll_bus.h"
+#include "stm32f7xx_ll_dma.h"
+#include "stm32f7xx_ll_usart.h"
+
+#include "dma_buffer.h"
+#include "frame.h"
+#include "mem_section.h"
+#include "ring_buffer.h"
+#include "usart_dma.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USART_DMA_INSTANCE          USART1
+#define USART_DMA_DMA               DMA2
+#define USART_DMA_CHANNEL           LL_DMA_CHANNEL_4
+#define USART_DMA_RX_STREAM         LL_DMA_STREAM_2
+#define USART_DMA_TX_STREAM         LL_DMA_STREAM_7
+#define USART_DMA_TX_MAX_BLOCK      0xFFFFU     /* NDTR is 16-bit */
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t *rxDmaBuffer;                /* USART_DMA_RX_DMA_SIZE, coherent pool */
+static uint8_t rxRingBuffer[USART_DMA_RX_RING_SIZE] DTCM_BSS;
+static uint8_t *txRingBuffer;               /* USART_DMA_TX_RING_SIZE, coherent pool */
+static uint8_t txFrameBuffer[FRAME_ENCODED_MAX(USART_DMA_FRAME_MAX)];
+
+static RingBuffer_TypeDef rxRing;
+static RingBuffer_TypeDef txRing;
+static uint32_t rxDmaPosition;              /* last DMA write offset handled */
+static volatile uint32_t txBlockLength;     /* bytes of the running transfer, 0 when idle */
+static volatile uint32_t txSuspended;       /* DMA2 Stream7 lent, see UsartDma_TxSuspend() */
+static UsartDma_StatsTypeDef usartDmaStats;
+
+/* Private functions ---------------------------------------------------------*/
+ITCM_TEXT static void UsartDma_RxStore(const uint8_t *data, uint32_t length)
+{
+	uint32_t stored = RingBuffer_Write(&rxRing, data, length);
+
+	usartDmaStats.rxBytes += stored;
+	usartDmaStats.rxDropped += length - stored;
+}
+
+/**
+ * @brief  Move the bytes written by the RX DMA since the last call.
+ * @note   Runs from the USART and DMA RX interrupts, which share one
+ *         priority, so it never preempts itself.
+ */
+ITCM_TEXT static void UsartDma_RxCheck(void)
+{
+	uint32_t position = USART_DMA_RX_DMA_SIZE - LL_DMA_GetDataLength(USART_DMA_DMA, USART_DMA_RX_STREAM);
+
+	if (position == USART_DMA_RX_DMA_SIZE)
+	{
+		position = 0;
+	}
+	if (position == rxDmaPosition)
+	{
+		return;
+	}
+
+	DmaBuffer_CompleteRx(rxDmaBuffer, USART_DMA_RX_DMA_SIZE);
+	if (position > rxDmaPosition)
+	{
+		UsartDma_RxStore(&rxDmaBuffer[rxDmaPosition], position - rxDmaPosition);
+	}
+	else
+	{
+		UsartDma_RxStore(&rxDmaBuffer[rxDmaPosition], USART_DMA_RX_DMA_SIZE - rxDmaPosition);
+		UsartDma_RxStore(rxDmaBuffer, position);
+	}
+	rxDmaPosition = position;
+}
+
+/**
+ * @brief  Start a DMA transfer of the next contiguous TX ring block.
+ * @note   Called with the TX DMA interrupt masked or from it.
+ */
+ITCM_TEXT static void UsartDma_TxStart(void)
+{
+	uint8_t *block;
+	uint32_t length = RingBuffer_GetReadBlock(&txRing, &block);
+
+	if ((length == 0U) || (txSuspended != 0U))
+	{
+		txBlockLength = 0;
+		return;
+	}
+	if (length > USART_DMA_TX_MAX_BLOCK)
+	{
+		length = USART_DMA_TX_MAX_BLOCK;
+	}
+
+	DmaBuffer_PrepareTx(block, length);
+
+	txBlockLength = length;
+	usartDmaStats.txTransfers++;
+
+	LL_DMA_ClearFlag_TC7(USART_DMA_DMA);
+	LL_DMA_ClearFlag_HT7(USART_DMA_DMA);
+	LL_DMA_ClearFlag_TE7(USART_DMA_DMA);
+	LL_DMA_ClearFlag_DME7(USART_DMA_DMA);
+	LL_DMA_ClearFlag_FE7(USART_DMA_DMA);
+	LL_DMA_SetMemoryAddress(USART_DMA_DMA, USART_DMA_TX_STREAM, (uint32_t)block);
+	LL_DMA_SetDataLength(USART_DMA_DMA, USART_DMA_TX_STREAM, length);
+	LL_DMA_EnableStream(USART_DMA_DMA, USART_DMA_TX_STREAM);
+}
+
+static void UsartDma_TxKick(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (txBlockLength == 0U)
+	{
+		UsartDma_TxStart();
+	}
+	__set_PRIMASK(primask);
+}
+
+static void UsartDma_DmaStreamInit(uint32_t stream, uint32_t direction, uint32_t mode,
+		uint32_t memory, uint32_t length, uint32_t priority)
+{
+	LL_DMA_InitTypeDef dmaConfig;
+
+	LL_DMA_StructInit(&dmaConfig);
+	dmaConfig.Channel = USART_DMA_CHANNEL;
+	dmaConfig.Direction = direction;
+	dmaConfig.Mode = mode;
+	dmaConfig.PeriphOrM2MSrcAddress = LL_USART_DMA_GetRegAddr(USART_DMA_INSTANCE,
+		(direction == LL_DMA_DIRECTION_PERIPH_TO_MEMORY) ? LL_USART_DMA_REG_DATA_RECEIVE : LL_USART_DMA_REG_DATA_TRANSMIT);
+	dmaConfig.MemoryOrM2MDstAddress = memory;
+	dmaConfig.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+	dmaConfig.NbData = length;
+	dmaConfig.Priority = priority;
+	LL_DMA_Init(USART_DMA_DMA, stream, &dmaConfig);
+}
+
+/**
+ * @brief  Configure USART1, both DMA streams and their interrupts, and
+ *         start receiving.
+ * @note   The USART1 pins must already be in alternate function mode and
+ *         DmaBuffer_Init() must have run.
+ * @param  baudrate: line rate, e.g. 921600
+ * @retval None
+ */
+void UsartDma_Init(uint32_t baudrate)
+{
+	LL_USART_InitTypeDef usartConfig;
+
+	if (rxDmaBuffer == NULL)
+	{
+		rxDmaBuffer = DmaBuffer_Alloc(USART_DMA_RX_DMA_SIZE);
+		txRingBuffer = DmaBuffer_Alloc(USART_DMA_TX_RING_SIZE);
+	}
+
+	RingBuffer_Init(&rxRing, rxRingBuffer, sizeof(rxRingBuffer));
+	RingBuffer_Init(&txRing, txRingBuffer, USART_DMA_TX_RING_SIZE);
+	memset(&usartDmaStats, 0, sizeof(usartDmaStats));
+	rxDmaPosition = 0;
+	txBlockLength = 0;
+	txSuspended = 0;
+
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+
+	UsartDma_DmaStreamInit(USART_DMA_RX_STREAM, LL_DMA_DIRECTION_PERIPH_TO_MEMORY, LL_DMA_MODE_CIRCULAR,
+		(uint32_t)rxDmaBuffer, USART_DMA_RX_DMA_SIZE, LL_DMA_PRIORITY_HIGH);
+	LL_DMA_EnableIT_HT(USART_DMA_DMA, USART_DMA_RX_STREAM);
+	LL_DMA_EnableIT_TC(USART_DMA_DMA, USART_DMA_RX_STREAM);
+
+	UsartDma_DmaStreamInit(USART_DMA_TX_STREAM, LL_DMA_DIRECTION_MEMORY_TO_PERIPH, LL_DMA_MODE_NORMAL,
+		(uint32_t)txRingBuffer, 0, LL_DMA_PRIORITY_MEDIUM);
+	LL_DMA_EnableIT_TC(USART_DMA_DMA, USART_DMA_TX_STREAM);
+
+	LL_USART_StructInit(&usartConfig);
+	usartConfig.BaudRate = baudrate;
+	LL_USART_Init(USART_DMA_INSTANCE, &usartConfig);
+	LL_USART_EnableDMAReq_RX(USART_DMA_INSTANCE);
+	LL_USART_EnableDMAReq_TX(USART_DMA_INSTANCE);
+	LL_USART_EnableIT_IDLE(USART_DMA_INSTANCE);
+
+	NVIC_SetPriority(USART1_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), USART_DMA_IRQ_PRIORITY, 0));
+	NVIC_SetPriority(DMA2_Stream2_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), USART_DMA_IRQ_PRIORITY, 0));
+	NVIC_SetPriority(DMA2_Stream7_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), USART_DMA_IRQ_PRIORITY, 0));
+	NVIC_EnableIRQ(USART1_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+	LL_DMA_EnableStream(USART_DMA_DMA, USART_DMA_RX_STREAM);
+	LL_USART_Enable(USART_DMA_INSTANCE);
+}
+
+/**
+ * @brief  Lend the TX DMA stream: finish the running block, start no other
+ *         and disable the stream interrupt. DMA2 Stream7 is also the QUADSPI
+ *         stream (qspi_flash.c).
+ * @note   Writes keep queueing until the TX ring is full.
+ * @retval None
+ */
+void UsartDma_TxSuspend(void)
+{
+	txSuspended = 1U;
+	while (txBlockLength != 0U)
+	{
+	}
+	NVIC_DisableIRQ(DMA2_Stream7_IRQn);
+}
+
+/**
+ * @brief  Take the TX DMA stream back, set it up again and send what was
+ *         queued meanwhile.
+ * @note   The borrower left the stream disabled.
+ * @retval None
+ */
+void UsartDma_TxResume(void)
+{
+	UsartDma_DmaStreamInit(USART_DMA_TX_STREAM, LL_DMA_DIRECTION_MEMORY_TO_PERIPH, LL_DMA_MODE_NORMAL,
+		(uint32_t)txRingBuffer, 0, LL_DMA_PRIORITY_MEDIUM);
+	LL_DMA_EnableIT_TC(USART_DMA_DMA, USART_DMA_TX_STREAM);
+	LL_DMA_ClearFlag_TC7(USART_DMA_DMA);
+	NVIC_ClearPendingIRQ(DMA2_Stream7_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+	txSuspended = 0U;
+	UsartDma_TxKick();
+}
+
+/**
+ * @brief  Queue bytes for transmission (single producer).
+ * @param  data: bytes to send
+ * @param  length: number of bytes
+ * @retval Bytes queued, less than length when the TX ring is full
+ */
+uint32_t UsartDma_Write(const void *data, uint32_t length)
+{
+	uint32_t written = RingBuffer_Write(&txRing, data, length);
+
+	if (written != 0U)
+	{
+		UsartDma_TxKick();
+	}
+	return written;
+}
+
+/**
+ * @brief  Queue one COBS frame, all or nothing (single producer).
+ * @param  payload: frame payload
+ * @param  length: payload length, at most USART_DMA_FRAME_MAX
+ * @retval Payload length on success, 0 if it does not fit right now
+ */
+uint32_t UsartDma_WriteFrame(const void *payload, uint32_t length)
+{
+	uint32_t encoded;
+
+	if (length > USART_DMA_FRAME_MAX)
+	{
+		return 0;
+	}
+
+	encoded = Frame_Encode(payload, length, txFrameBuffer, sizeof(txFrameBuffer));
+	if ((encoded == 0U) || (encoded > RingBuffer_Free(&txRing)))
+	{
+		return 0;
+	}
+
+	UsartDma_Write(txFrameBuffer, encoded);
+	return length;
+}
+
+/**
+ * @brief  Fetch received bytes (single consumer).
+ * @param  data: destination
+ * @param  length: maximum number of bytes
+ * @retval Bytes copied
+ */
+uint32_t UsartDma_Read(void *data, uint32_t length)
+{
+	return RingBuffer_Read(&rxRing, data, length);
+}
+
+/**
+ * @brief  Copy the transfer counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void UsartDma_GetStats(UsartDma_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = usartDmaStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  USART1 interrupt: IDLE line, flush the partially filled DMA buffer.
+ * @retval None
+ */
+ITCM_TEXT void UsartDma_IRQHandler(void)
+{
+	if (LL_USART_IsActiveFlag_IDLE(USART_DMA_INSTANCE))
+	{
+		LL_USART_ClearFlag_IDLE(USART_DMA_INSTANCE);
+		UsartDma_RxCheck();
+	}
+	if (LL_USART_IsActiveFlag_ORE(USART_DMA_INSTANCE))
+	{
+		LL_USART_ClearFlag_ORE(USART_DMA_INSTANCE);
+	}
+}
+
+/**
+ * @brief  RX DMA interrupt: half and full transfer of the circular buffer.
+ * @retval None
+ */
+ITCM_TEXT void UsartDma_RxDmaIRQHandler(void)
+{
+	if (LL_DMA_IsActiveFlag_HT2(USART_DMA_DMA))
+	{
+		LL_DMA_ClearFlag_HT2(USART_DMA_DMA);
+		UsartDma_RxCheck();
+	}
+	if (LL_DMA_IsActiveFlag_TC2(USART_DMA_DMA))
+	{
+		LL_DMA_ClearFlag_TC2(USART_DMA_DMA);
+		UsartDma_RxCheck();
+	}
+}
+
+/**
+ * @brief  TX DMA interrupt: release the sent block and chain the next one.
+ * @retval None
+ */
+ITCM_TEXT void UsartDma_TxDmaIRQHandler(void)
+{
+	if (LL_DMA_IsActiveFlag_TC7(USART_DMA_DMA))
+	{
+		LL_DMA_ClearFlag_TC7(USART_DMA_DMA);
+		RingBuffer_Consume(&txRing, txBlockLength);
+		usartDmaStats.txBytes += txBlockLength;
+		UsartDma_TxStart();
+	}
+}
@@ -0,0 +1,456 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.c
+  * @brief   USB CDC-ACM class.
+  *
+  *          The transfer buffers and the TX ring storage come from the
+  *          cached DMA pool: with the OTG HS core DMA the usb_device
+  *          transfer calls hand them over with the dma_buffer.h calls, the
+  *          FS core copies through its FIFO with the CPU.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "dma_buffer.h"
+#include "mem_section.h"
+#include "ring_buffer.h"
+#include "usb_cdc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_CDC_VID                 0x0483U /* ST Virtual COM Port */
+#define USB_CDC_PID                 0x5740U
+#define USB_CDC_NOTIFY_MPS          16U
+#define USB_CDC_LINE_CODING_LENGTH  7U
+#define USB_CDC_RX_NONE             2U      /* no buffer armed: the host sees NAKs */
+
+#define USB_CDC_LO(x)               (uint8_t)((x) & 0xFFU)
+#define USB_CDC_HI(x)               (uint8_t)(((x) >> 8) & 0xFFU)
+
+/* Configuration descriptor for a bulk packet size and a notification
+   bInterval, 16 ms either way: frames at full speed, 2^(n-1) microframes
+   at high speed */
+#define USB_CDC_CONFIGURATION(bulkMps, notifyInterval) \
+{ \
+	/* Configuration: 2 interfaces, bus powered, 100 mA */ \
+	9U, USB_DESC_CONFIGURATION, USB_CDC_LO(USB_CDC_CONFIG_LENGTH), USB_CDC_HI(USB_CDC_CONFIG_LENGTH), \
+	2U, 1U, 0U, 0x80U, 50U, \
+	/* Interface 0: communication, abstract control model, no protocol */ \
+	9U, USB_DESC_INTERFACE, USB_CDC_COMM_INTERFACE, 0U, 1U, 0x02U, 0x02U, 0x00U, 0U, \
+	/* Header functional descriptor, CDC 1.10 */ \
+	5U, USB_DESC_CS_INTERFACE, 0x00U, 0x10U, 0x01U, \
+	/* Call management: none, data interface 1 */ \
+	5U, USB_DESC_CS_INTERFACE, 0x01U, 0x00U, 1U, \
+	/* ACM: line coding, control line state, serial state; send break */ \
+	4U, USB_DESC_CS_INTERFACE, 0x02U, 0x06U, \
+	/* Union: interface 0 controls interface 1 */ \
+	5U, USB_DESC_CS_INTERFACE, 0x06U, USB_CDC_COMM_INTERFACE, 1U, \
+	/* Notification endpoint, interrupt */ \
+	7U, USB_DESC_ENDPOINT, USB_CDC_EP_NOTIFY, EP_TYPE_INTR, USB_CDC_NOTIFY_MPS, 0U, (notifyInterval), \
+	/* Interface 1: data */ \
+	9U, USB_DESC_INTERFACE, 1U, 0U, 2U, 0x0AU, 0x00U, 0x00U, 0U, \
+	/* Bulk OUT and IN */ \
+	7U, USB_DESC_ENDPOINT, USB_CDC_EP_OUT, EP_TYPE_BULK, USB_CDC_LO(bulkMps), USB_CDC_HI(bulkMps), 0U, \
+	7U, USB_DESC_ENDPOINT, USB_CDC_EP_IN, EP_TYPE_BULK, USB_CDC_LO(bulkMps), USB_CDC_HI(bulkMps), 0U \
+}
+
+/* Private function prototypes -----------------------------------------------*/
+static const uint8_t *UsbCdc_Configuration(uint32_t highSpeed, uint32_t *length);
+static void UsbCdc_Configured(uint8_t configuration, uint32_t highSpeed);
+static HAL_StatusTypeDef UsbCdc_Request(const UsbDevice_SetupTypeDef *setup, uint8_t *data, uint32_t *length);
+static void UsbCdc_DataIn(uint8_t epAddress);
+static void UsbCdc_DataOut(uint8_t epAddress, uint32_t length);
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t usbCdcDevice[USB_DESC_DEVICE_LENGTH] =
+{
+	USB_DESC_DEVICE_LENGTH, USB_DESC_DEVICE, 0x00U, 0x02U,     /* USB 2.0 */
+	0x02U, 0x00U, 0x00U, USB_DEVICE_EP0_MPS,                   /* CDC, class in the interfaces */
+	USB_CDC_LO(USB_CDC_VID), USB_CDC_HI(USB_CDC_VID), USB_CDC_LO(USB_CDC_PID), USB_CDC_HI(USB_CDC_PID),
+	0x00U, 0x02U, 1U, 2U, 3U, 1U                                /* bcdDevice 2.00, strings, 1 configuration */
+};
+
+static const uint8_t usbCdcConfigurationFs[USB_CDC_CONFIG_LENGTH] = USB_CDC_CONFIGURATION(USB_OTG_FS_MAX_PACKET_SIZE, 16U);
+static const uint8_t usbCdcConfigurationHs[USB_CDC_CONFIG_LENGTH] = USB_CDC_CONFIGURATION(USB_OTG_HS_MAX_PACKET_SIZE, 8U);
+
+static const char *usbCdcStrings[3] = { "STMicroelectronics", "STM32F746ZG Virtual COM Port", "0" };
+
+static const UsbDevice_ClassTypeDef usbCdcClass =
+{
+	.device = usbCdcDevice,
+	.configuration = UsbCdc_Configuration,
+	.strings = usbCdcStrings,
+	.stringCount = sizeof(usbCdcStrings) / sizeof(usbCdcStrings[0]),
+	.configured = UsbCdc_Configured,
+	.request = UsbCdc_Request,
+	.dataIn = UsbCdc_DataIn,
+	.dataOut = UsbCdc_DataOut
+};
+
+static uint8_t *usbCdcRxBuffer[2];          /* USB_CDC_RX_BUFFER_SIZE each, cached DMA pool */
+static uint32_t usbCdcRxLength[2];          /* bytes of a held buffer */
+static uint32_t usbCdcRxArmed;              /* buffer on the endpoint, USB_CDC_RX_NONE */
+static uint8_t usbCdcRxHeld[2];             /* held buffers, oldest first */
+static uint32_t usbCdcRxHeldCount;
+static uint8_t usbCdcRxRingBuffer[USB_CDC_RX_RING_SIZE] DTCM_BSS;
+static uint8_t *usbCdcTxRingBuffer;         /* USB_CDC_TX_RING_SIZE, cached DMA pool */
+static RingBuffer_TypeDef usbCdcRxRing;
+static RingBuffer_TypeDef usbCdcTxRing;
+static volatile uint32_t usbCdcTxBusy;      /* IN transfer running, zero-length ones included */
+static uint32_t usbCdcTxLength;             /* bytes of the running transfer */
+static volatile uint32_t usbCdcConfigured;
+static UsbCdc_LineCodingTypeDef usbCdcLineCoding;
+static uint16_t usbCdcLineState;
+static UsbCdc_StatsTypeDef usbCdcStats;
+
+/* Private functions ---------------------------------------------------------*/
+static const uint8_t *UsbCdc_Configuration(uint32_t highSpeed, uint32_t *length)
+{
+	*length = USB_CDC_CONFIG_LENGTH;
+	return (highSpeed != 0U) ? usbCdcConfigurationHs : usbCdcConfigurationFs;
+}
+
+static void UsbCdc_RxArm(uint32_t buffer)
+{
+	usbCdcRxArmed = buffer;
+	if (UsbDevice_Receive(USB_CDC_EP_OUT, usbCdcRxBuffer[buffer], USB_CDC_RX_BUFFER_SIZE) != HAL_OK)
+	{
+		usbCdcRxArmed = USB_CDC_RX_NONE;
+	}
+}
+
+/* Move the held buffers that fit into the RX ring, oldest first, and arm
+   the endpoint again if it had stopped; interrupts masked by the caller */
+static void UsbCdc_RxDrain(void)
+{
+	while (usbCdcRxHeldCount != 0U)
+	{
+		uint32_t buffer = usbCdcRxHeld[0];
+
+		if (usbCdcRxLength[buffer] > RingBuffer_Free(&usbCdcRxRing))
+		{
+			return;
+		}
+		(void)RingBuffer_Write(&usbCdcRxRing, usbCdcRxBuffer[buffer], usbCdcRxLength[buffer]);
+		usbCdcStats.rxBytes += usbCdcRxLength[buffer];
+		usbCdcRxLength[buffer] = 0U;
+		usbCdcRxHeld[0] = usbCdcRxHeld[1];
+		usbCdcRxHeldCount--;
+		if ((usbCdcRxArmed == USB_CDC_RX_NONE) && (usbCdcConfigured != 0U))
+		{
+			UsbCdc_RxArm(buffer);
+		}
+	}
+}
+
+/* Start the IN transfer of the next contiguous TX ring block; from the
+   transfer complete callback or with interrupts masked */
+static void UsbCdc_TxStart(void)
+{
+	uint8_t *block;
+	uint32_t length = RingBuffer_GetReadBlock(&usbCdcTxRing, &block);
+
+	usbCdcTxBusy = 0U;
+	if ((length == 0U) || (usbCdcConfigured == 0U))
+	{
+		return;
+	}
+	if (UsbDevice_Transmit(USB_CDC_EP_IN, block, length) == HAL_OK)
+	{
+		usbCdcTxLength = length;
+		usbCdcTxBusy = 1U;
+		usbCdcStats.txTransfers++;
+	}
+}
+
+static void UsbCdc_Configured(uint8_t configuration, uint32_t highSpeed)
+{
+	(void)highSpeed;
+
+	usbCdcConfigured = (configuration != 0U);
+	usbCdcRxHeldCount = 0U;
+	usbCdcRxLength[0] = 0U;
+	usbCdcRxLength[1] = 0U;
+	usbCdcRxArmed = USB_CDC_RX_NONE;
+	usbCdcTxBusy = 0U;
+	usbCdcLineState = 0U;
+	if (configuration == 0U)
+	{
+		/* Nobody to send the queued bytes to: the callbacks consume the
+		   TX ring, drop them */
+		RingBuffer_Consume(&usbCdcTxRing, RingBuffer_Count(&usbCdcTxRing));
+		return;
+	}
+	UsbCdc_RxArm(0U);
+}
+
+static HAL_StatusTypeDef UsbCdc_Request(const UsbDevice_SetupTypeDef *setup, uint8_t *data, uint32_t *length)
+{
+	if (((setup->bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_CLASS)
+			|| ((setup->bmRequestType & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_INTERFACE)
+			|| ((setup->wIndex & 0xFFU) != USB_CDC_COMM_INTERFACE))
+	{
+		return HAL_ERROR;
+	}
+
+	switch (setup->bRequest)
+	{
+	case USB_CDC_SET_LINE_CODING:
+		if (*length < USB_CDC_LINE_CODING_LENGTH)
+		{
+			return HAL_ERROR;
+		}
+		usbCdcLineCoding.baudrate = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16)
+			| ((uint32_t)data[3] << 24);
+		usbCdcLineCoding.stopBits = data[4];
+		usbCdcLineCoding.parity = data[5];
+		usbCdcLineCoding.dataBits = data[6];
+		usbCdcStats.lineCodings++;
+		return HAL_OK;
+
+	case USB_CDC_GET_LINE_CODING:
+		data[0] = (uint8_t)usbCdcLineCoding.baudrate;
+		data[1] = (uint8_t)(usbCdcLineCoding.baudrate >> 8);
+		data[2] = (uint8_t)(usbCdcLineCoding.baudrate >> 16);
+		data[3] = (uint8_t)(usbCdcLineCoding.baudrate >> 24);
+		data[4] = usbCdcLineCoding.stopBits;
+		data[5] = usbCdcLineCoding.parity;
+		data[6] = usbCdcLineCoding.dataBits;
+		*length = USB_CDC_LINE_CODING_LENGTH;
+		return HAL_OK;
+
+	case USB_CDC_SET_CONTROL_LINE_STATE:
+		usbCdcLineState = setup->wValue & (USB_CDC_LINE_DTR | USB_CDC_LINE_RTS);
+		return HAL_OK;
+
+	case USB_CDC_SEND_BREAK:
+		return HAL_OK;
+
+	default:
+		return HAL_ERROR;
+	}
+}
+
+static void UsbCdc_DataIn(uint8_t epAddress)
+{
+	uint32_t length = usbCdcTxLength;
+
+	if ((epAddress != USB_CDC_EP_IN) || (usbCdcTxBusy == 0U))
+	{
+		return;
+	}
+	usbCdcTxLength = 0U;
+	if (length == 0U)
+	{
+		UsbCdc_TxStart();
+		return;
+	}
+	RingBuffer_Consume(&usbCdcTxRing, length);
+	usbCdcStats.txBytes += length;
+
+	/* A transfer ending on a packet boundary leaves the host read pending:
+	   end it with a zero-length packet unless more data follows anyway */
+	if (((length % UsbDevice_MaxPacket(USB_CDC_EP_IN)) == 0U) && (RingBuffer_Count(&usbCdcTxRing) == 0U))
+	{
+		usbCdcStats.txZlps++;
+		if (UsbDevice_Transmit(USB_CDC_EP_IN, NULL, 0U) != HAL_OK)
+		{
+			usbCdcTxBusy = 0U;
+		}
+		return;
+	}
+	UsbCdc_TxStart();
+}
+
+static void UsbCdc_DataOut(uint8_t epAddress, uint32_t length)
+{
+	uint32_t buffer = usbCdcRxArmed;
+	uint32_t next = buffer ^ 1U;
+
+	if ((epAddress != USB_CDC_EP_OUT) || (buffer == USB_CDC_RX_NONE))
+	{
+		return;
+	}
+	usbCdcStats.rxTransfers++;
+
+	/* The other buffer goes on the endpoint first, the copy comes after */
+	usbCdcRxArmed = USB_CDC_RX_NONE;
+	if (usbCdcRxLength[next] == 0U)
+	{
+		UsbCdc_RxArm(next);
+	}
+	DmaBuffer_CompleteRx(usbCdcRxBuffer[buffer], USB_CDC_RX_BUFFER_SIZE);
+	if (length == 0U)
+	{
+		if (usbCdcRxArmed == USB_CDC_RX_NONE)
+		{
+			UsbCdc_RxArm(buffer);
+		}
+		return;
+	}
+	usbCdcRxLength[buffer] = length;
+	usbCdcRxHeld[usbCdcRxHeldCount++] = (uint8_t)buffer;
+	UsbCdc_RxDrain();
+	if (usbCdcRxLength[buffer] != 0U)
+	{
+		usbCdcStats.rxHeld++;
+	}
+}
+
+/**
+ * @brief  Reset the class state and start the device core with it.
+ * @note   hpcd as for UsbDevice_Init().
+ * @param  hpcd: PCD handle
+ * @param  serial: iSerialNumber string, ASCII, kept
+ * @retval HAL status
+ */
+HAL_StatusTypeDef UsbCdc_Init(PCD_HandleTypeDef *hpcd, const char *serial)
+{
+	if (usbCdcTxRingBuffer == NULL)
+	{
+		usbCdcRxBuffer[0] = DmaBuffer_AllocCached(USB_CDC_RX_BUFFER_SIZE);
+		usbCdcRxBuffer[1] = DmaBuffer_AllocCached(USB_CDC_RX_BUFFER_SIZE);
+		usbCdcTxRingBuffer = DmaBuffer_AllocCached(USB_CDC_TX_RING_SIZE);
+		if ((usbCdcRxBuffer[0] == NULL) || (usbCdcRxBuffer[1] == NULL) || (usbCdcTxRingBuffer == NULL))
+		{
+			return HAL_ERROR;
+		}
+	}
+
+	RingBuffer_Init(&usbCdcRxRing, usbCdcRxRingBuffer, sizeof(usbCdcRxRingBuffer));
+	RingBuffer_Init(&usbCdcTxRing, usbCdcTxRingBuffer, USB_CDC_TX_RING_SIZE);
+	usbCdcStrings[2] = serial;
+	usbCdcConfigured = 0U;
+	usbCdcRxArmed = USB_CDC_RX_NONE;
+	usbCdcRxHeldCount = 0U;
+	usbCdcRxLength[0] = 0U;
+	usbCdcRxLength[1] = 0U;
+	usbCdcTxBusy = 0U;
+	usbCdcTxLength = 0U;
+	usbCdcLineCoding.baudrate = 115200U;
+	usbCdcLineCoding.stopBits = 0U;
+	usbCdcLineCoding.parity = 0U;
+	usbCdcLineCoding.dataBits = 8U;
+	usbCdcLineState = 0U;
+	memset(&usbCdcStats, 0, sizeof(usbCdcStats));
+
+	return UsbDevice_Init(hpcd, &usbCdcClass);
+}
+
+/**
+ * @brief  Queue bytes for the host (single producer).
+ * @param  data: bytes to send
+ * @param  length: number of bytes
+ * @retval Bytes queued, less than length when the TX ring is full, 0
+ *         while the device is not configured
+ */
+uint32_t UsbCdc_Write(const void *data, uint32_t length)
+{
+	uint32_t written;
+	uint32_t primask;
+
+	if (usbCdcConfigured == 0U)
+	{
+		return 0U;
+	}
+	written = RingBuffer_Write(&usbCdcTxRing, data, length);
+	if (written != 0U)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		if (usbCdcTxBusy == 0U)
+		{
+			UsbCdc_TxStart();
+		}
+		__set_PRIMASK(primask);
+	}
+	return written;
+}
+
+/**
+ * @brief  Fetch bytes received from the host (single consumer).
+ * @param  data: destination
+ * @param  length: maximum number of bytes
+ * @retval Bytes copied
+ */
+uint32_t UsbCdc_Read(void *data, uint32_t length)
+{
+	uint32_t read = RingBuffer_Read(&usbCdcRxRing, data, length);
+	uint32_t primask;
+
+	if (usbCdcRxHeldCount != 0U)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		UsbCdc_RxDrain();
+		__set_PRIMASK(primask);
+	}
+	return read;
+}
+
+/**
+ * @brief  Whether a terminal has the port open on the host.
+ * @retval 1 when configured with DTR set
+ */
+uint32_t UsbCdc_IsOpen(void)
+{
+	return (usbCdcConfigured != 0U) && ((usbCdcLineState & USB_CDC_LINE_DTR) != 0U);
+}
+
+/**
+ * @brief  Line coding last set by the host, 115200 8N1 before that.
+ * @param  lineCoding: destination
+ * @retval None
+ */
+void UsbCdc_GetLineCoding(UsbCdc_LineCodingTypeDef *lineCoding)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*lineCoding = usbCdcLineCoding;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Copy the transfer counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void UsbCdc_GetStats(UsbCdc_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = usbCdcStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the port state and counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void UsbCdc_Dump(UsbCdc_PutCharTypeDef putChar)
+{
+	static const char parity[] = "NOEMS";
+	UsbCdc_StatsTypeDef stats;
+	UsbCdc_LineCodingTypeDef lineCoding;
+	char line[128];
+
+	UsbCdc_GetStats(&stats);
+	UsbCdc_GetLineCoding(&lineCoding);
+	snprintf(line, sizeof(line), "usb cdc %lu %u%c%s dtr=%u rx=%lu/%lu held=%lu tx=%lu/%lu zlp=%lu\r\n",
+		(unsigned long)lineCoding.baudrate, (unsigned)lineCoding.dataBits,
+		(lineCoding.parity < 5U) ? parity[lineCoding.parity] : '?',
+		(lineCoding.stopBits == 0U) ? "1" : ((lineCoding.stopBits == 1U) ? "1.5" : "2"),
+		(unsigned)((usbCdcLineState & USB_CDC_LINE_DTR) != 0U), (unsigned long)stats.rxBytes,
+		(unsigned long)stats.rxTransfers, (unsigned long)stats.rxHeld, (unsigned long)stats.txBytes,
+		(unsigned long)stats.txTransfers, (unsigned long)stats.txZlps);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
@@ -0,0 +1,962 @@
+/**
+  ******************************************************************************
+  * @file    usb_device.c
+  * @brief   USB device core on the HAL PCD driver.
+  *
+  *          The HAL_PCD_xxxCallback() hooks of the PCD interrupt handler are
+  *          implemented here. Control transfers follow the OTG core rule of
+  *          one packet per endpoint 0 transfer: the data stage is chained
+  *          packet by packet from the transfer complete callbacks, a
+  *          zero-length packet closes an IN data stage that ends on a packet
+  *          boundary short of wLength, and the status stage is a zero-length
+  *          transfer the other way. Answers are always built in the
+  *          endpoint 0 buffer, descriptors included, so the core DMA never
+  *          reads flash.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "dma_buffer.h"
+#include "mem_section.h"
+#include "usb_device.h"
+#include "usb_fifo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_DEVICE_DIR_IN           0x80U
+#define USB_DEVICE_EP_NUMBER        0x0FU
+#define USB_DEVICE_OPEN_BIT(ep)     (((ep) & USB_DEVICE_DIR_IN) ? (1UL << ((ep) & USB_DEVICE_EP_NUMBER)) \
+										: (1UL << (16U + ((ep) & USB_DEVICE_EP_NUMBER))))
+#define USB_DEVICE_ADDRESS_MAX      127U
+#define USB_DEVICE_STRING_MAX       254U    /* bLength is a byte, whole UTF-16 characters */
+#define USB_DEVICE_LANGID_EN_US     0x0409U
+#define USB_DEVICE_ATTR_SELF_POWERED 0x40U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+	USB_DEVICE_EP0_IDLE = 0,
+	USB_DEVICE_EP0_DATA_IN,
+	USB_DEVICE_EP0_DATA_OUT,
+	USB_DEVICE_EP0_STATUS_IN,
+	USB_DEVICE_EP0_STATUS_OUT
+} UsbDevice_Ep0StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static PCD_HandleTypeDef *usbDeviceHandle;
+static const UsbDevice_ClassTypeDef *usbDeviceClass;
+static uint8_t *usbDeviceEp0;               /* USB_DEVICE_EP0_SIZE, cached DMA pool */
+static UsbDevice_StateTypeDef usbDeviceState;
+static UsbDevice_StateTypeDef usbDeviceResumeState;
+static uint8_t usbDeviceConfiguration;
+static uint8_t usbDeviceRemoteWakeup;
+static uint32_t usbDeviceHighSpeed;         /* enumerated at high speed */
+static uint32_t usbDeviceOpen;              /* open endpoints: bit n IN n, bit 16 + n OUT n */
+static UsbDevice_SetupTypeDef usbDeviceSetup;
+static UsbDevice_Ep0StateTypeDef usbDeviceEp0State;
+static uint32_t usbDeviceEp0Length;         /* data stage bytes */
+static uint32_t usbDeviceEp0Offset;         /* of them sent or received */
+static uint32_t usbDeviceEp0Zlp;            /* a zero-length packet ends the IN data stage */
+static UsbDevice_StatsTypeDef usbDeviceStats;
+static UsbFifo_PlanTypeDef usbDeviceFifo;
+static uint32_t usbDeviceFifoWords;         /* FIFO RAM of the core */
+
+static const char *const usbDeviceStateName[] = { "powered", "default", "addressed", "configured", "suspended" };
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint16_t UsbDevice_Get16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | ((uint32_t)p[1] << 8));
+}
+
+static inline uint32_t UsbDevice_HighSpeedCapable(void)
+{
+	return usbDeviceHandle->Init.phy_itface == PCD_PHY_ULPI;
+}
+
+static void UsbDevice_Ep0Stall(void)
+{
+	usbDeviceStats.stalls++;
+	usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+	/* Stalling endpoint 0 also re-arms it for the next setup packet */
+	(void)HAL_PCD_EP_SetStall(usbDeviceHandle, USB_DEVICE_DIR_IN);
+	(void)HAL_PCD_EP_SetStall(usbDeviceHandle, 0x00U);
+}
+
+static void UsbDevice_Ep0SendStatus(void)
+{
+	usbDeviceEp0State = USB_DEVICE_EP0_STATUS_IN;
+	(void)HAL_PCD_EP_Transmit(usbDeviceHandle, USB_DEVICE_DIR_IN, NULL, 0U);
+}
+
+/* Next IN data stage packet, a zero-length one included */
+static void UsbDevice_Ep0SendNext(void)
+{
+	uint8_t *packet = &usbDeviceEp0[usbDeviceEp0Offset];
+	uint32_t length = usbDeviceEp0Length - usbDeviceEp0Offset;
+
+	if (length > USB_DEVICE_EP0_MPS)
+	{
+		length = USB_DEVICE_EP0_MPS;
+	}
+	usbDeviceEp0Offset += length;
+	if (length != 0U)
+	{
+		DmaBuffer_PrepareTx(packet, length);
+	}
+	(void)HAL_PCD_EP_Transmit(usbDeviceHandle, USB_DEVICE_DIR_IN, packet, length);
+}
+
+/* Answer of a device-to-host request, built in the endpoint 0 buffer */
+static void UsbDevice_Ep0Send(uint32_t length)
+{
+	if (length > usbDeviceSetup.wLength)
+	{
+		length = usbDeviceSetup.wLength;
+	}
+	usbDeviceStats.ep0Bytes += length;
+	usbDeviceEp0State = USB_DEVICE_EP0_DATA_IN;
+	usbDeviceEp0Length = length;
+	usbDeviceEp0Offset = 0U;
+	/* A short answer ending on a packet boundary needs a short packet to end */
+	usbDeviceEp0Zlp = (length < usbDeviceSetup.wLength) && (length != 0U) && ((length % USB_DEVICE_EP0_MPS) == 0U);
+	UsbDevice_Ep0SendNext();
+}
+
+static void UsbDevice_Ep0ReceiveNext(void)
+{
+	uint8_t *packet = &usbDeviceEp0[usbDeviceEp0Offset];
+	uint32_t length = usbDeviceEp0Length - usbDeviceEp0Offset;
+
+	if (length > USB_DEVICE_EP0_MPS)
+	{
+		length = USB_DEVICE_EP0_MPS;
+	}
+	DmaBuffer_PrepareRx(packet, length);
+	(void)HAL_PCD_EP_Receive(usbDeviceHandle, 0x00U, packet, length);
+}
+
+/* Class or vendor request: data stage first for the host-to-device ones */
+static void UsbDevice_ClassRequest(void)
+{
+	uint32_t length = usbDeviceSetup.wLength;
+
+	if ((usbDeviceState != USB_DEVICE_STATE_CONFIGURED) || (length > USB_DEVICE_EP0_SIZE)
+			|| (usbDeviceClass->request == NULL))
+	{
+		UsbDevice_Ep0Stall();
+		return;
+	}
+	if (((usbDeviceSetup.bmRequestType & USB_REQ_DIR_IN) == 0U) && (length != 0U))
+	{
+		usbDeviceEp0State = USB_DEVICE_EP0_DATA_OUT;
+		usbDeviceEp0Length = length;
+		usbDeviceEp0Offset = 0U;
+		UsbDevice_Ep0ReceiveNext();
+		return;
+	}
+	if (usbDeviceClass->request(&usbDeviceSetup, usbDeviceEp0, &length) != HAL_OK)
+	{
+		UsbDevice_Ep0Stall();
+	}
+	else if ((usbDeviceSetup.bmRequestType & USB_REQ_DIR_IN) != 0U)
+	{
+		UsbDevice_Ep0Send(length);
+	}
+	else
+	{
+		UsbDevice_Ep0SendStatus();
+	}
+}
+
+/* String descriptor from ASCII, UTF-16LE */
+static uint32_t UsbDevice_String(uint8_t *descriptor, const char *string)
+{
+	uint32_t length = 2U;
+
+	for (; (*string != '\0') && ((length + 2U) <= USB_DEVICE_STRING_MAX); string++)
+	{
+		descriptor[length++] = (uint8_t)*string;
+		descriptor[length++] = 0U;
+	}
+	descriptor[0] = (uint8_t)length;
+	descriptor[1] = USB_DESC_STRING;
+	return length;
+}
+
+/* Descriptor copied into the endpoint 0 buffer; length 0: none such */
+static uint32_t UsbDevice_GetDescriptor(uint8_t type, uint8_t index)
+{
+	const uint8_t *device = usbDeviceClass->device;
+	const uint8_t *source = NULL;
+	uint32_t length = 0U;
+
+	switch (type)
+	{
+	case USB_DESC_DEVICE:
+		source = device;
+		length = USB_DESC_DEVICE_LENGTH;
+		break;
+
+	case USB_DESC_CONFIGURATION:
+	case USB_DESC_OTHER_SPEED:
+		if ((index != 0U) || ((type == USB_DESC_OTHER_SPEED) && !UsbDevice_HighSpeedCapable()))
+		{
+			return 0U;
+		}
+		source = usbDeviceClass->configuration((type == USB_DESC_OTHER_SPEED) ? !usbDeviceHighSpeed
+			: usbDeviceHighSpeed, &length);
+		break;
+
+	case USB_DESC_DEVICE_QUALIFIER:
+		if (!UsbDevice_HighSpeedCapable())
+		{
+			return 0U;
+		}
+		/* bcdUSB, class, subclass, protocol, bMaxPacketSize0, configurations */
+		usbDeviceEp0[0] = USB_DESC_QUALIFIER_LENGTH;
+		usbDeviceEp0[1] = USB_DESC_DEVICE_QUALIFIER;
+		memcpy(&usbDeviceEp0[2], &device[2], 6U);
+		usbDeviceEp0[8] = device[17];
+		usbDeviceEp0[9] = 0U;
+		return USB_DESC_QUALIFIER_LENGTH;
+
+	case USB_DESC_STRING:
+		if (index == 0U)
+		{
+			usbDeviceEp0[0] = 4U;
+			usbDeviceEp0[1] = USB_DESC_STRING;
+			usbDeviceEp0[2] = (uint8_t)USB_DEVICE_LANGID_EN_US;
+			usbDeviceEp0[3] = (uint8_t)(USB_DEVICE_LANGID_EN_US >> 8);
+			return 4U;
+		}
+		if (index > usbDeviceClass->stringCount)
+		{
+			return 0U;
+		}
+		return UsbDevice_String(usbDeviceEp0, usbDeviceClass->strings[index - 1U]);
+
+	default:
+		return 0U;
+	}
+
+	if ((source == NULL) || (length == 0U))
+	{
+		return 0U;
+	}
+	if (length > USB_DEVICE_EP0_SIZE)
+	{
+		length = USB_DEVICE_EP0_SIZE;
+	}
+	memcpy(usbDeviceEp0, source, length);
+	if (type == USB_DESC_OTHER_SPEED)
+	{
+		usbDeviceEp0[1] = USB_DESC_OTHER_SPEED;
+	}
+	return length;
+}
+
+/* Close the endpoints of the configuration and tell the class */
+static void UsbDevice_Deconfigure(void)
+{
+	if (usbDeviceConfiguration == 0U)
+	{
+		return;
+	}
+	usbDeviceConfiguration = 0U;
+	for (uint32_t ep = 1U; ep < USB_DEVICE_MAX_ENDPOINTS; ep++)
+	{
+		if ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(ep | USB_DEVICE_DIR_IN)) != 0U)
+		{
+			(void)HAL_PCD_EP_Close(usbDeviceHandle, (uint8_t)(ep | USB_DEVICE_DIR_IN));
+		}
+		if ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(ep)) != 0U)
+		{
+			(void)HAL_PCD_EP_Close(usbDeviceHandle, (uint8_t)ep);
+		}
+	}
+	usbDeviceOpen = USB_DEVICE_OPEN_BIT(0x00U) | USB_DEVICE_OPEN_BIT(USB_DEVICE_DIR_IN);
+	if (usbDeviceClass->configured != NULL)
+	{
+		usbDeviceClass->configured(0U, usbDeviceHighSpeed);
+	}
+}
+
+/* Open every endpoint of the configuration descriptor of the current speed */
+static HAL_StatusTypeDef UsbDevice_Configure(uint8_t configuration)
+{
+	uint32_t length;
+	const uint8_t *descriptors = usbDeviceClass->configuration(usbDeviceHighSpeed, &length);
+	const uint8_t *endpoint = NULL;
+
+	usbDeviceConfiguration = configuration;
+	while ((endpoint = UsbDevice_FindDescriptor(descriptors, length, endpoint, USB_DESC_ENDPOINT)) != NULL)
+	{
+		uint8_t address = endpoint[2];
+
+		if ((endpoint[0] < 7U) || ((address & USB_DEVICE_EP_NUMBER) == 0U)
+				|| ((address & USB_DEVICE_EP_NUMBER) >= USB_DEVICE_MAX_ENDPOINTS))
+		{
+			UsbDevice_Deconfigure();
+			return HAL_ERROR;
+		}
+		(void)HAL_PCD_EP_Open(usbDeviceHandle, address, (uint16_t)(UsbDevice_Get16(&endpoint[4]) & 0x7FFU),
+			(uint8_t)(endpoint[3] & EP_TYPE_MSK));
+		usbDeviceOpen |= USB_DEVICE_OPEN_BIT(address);
+	}
+	/* Configured before the class hears of it: it starts its transfers there */
+	usbDeviceState = USB_DEVICE_STATE_CONFIGURED;
+	usbDeviceStats.configurations++;
+	if (usbDeviceClass->configured != NULL)
+	{
+		usbDeviceClass->configured(configuration, usbDeviceHighSpeed);
+	}
+	return HAL_OK;
+}
+
+static void UsbDevice_DeviceRequest(void)
+{
+	const UsbDevice_SetupTypeDef *setup = &usbDeviceSetup;
+	uint32_t length;
+
+	switch (setup->bRequest)
+	{
+	case USB_REQ_GET_DESCRIPTOR:
+		length = UsbDevice_GetDescriptor((uint8_t)(setup->wValue >> 8), (uint8_t)setup->wValue);
+		if (length == 0U)
+		{
+			break;
+		}
+		UsbDevice_Ep0Send(length);
+		return;
+
+	case USB_REQ_SET_ADDRESS:
+		if ((setup->wValue > USB_DEVICE_ADDRESS_MAX) || (setup->wIndex != 0U) || (setup->wLength != 0U)
+				|| (usbDeviceState == USB_DEVICE_STATE_CONFIGURED))
+		{
+			break;
+		}
+		/* The OTG core applies the address itself once the status stage is done */
+		(void)HAL_PCD_SetAddress(usbDeviceHandle, (uint8_t)setup->wValue);
+		usbDeviceState = (setup->wValue != 0U) ? USB_DEVICE_STATE_ADDRESSED : USB_DEVICE_STATE_DEFAULT;
+		UsbDevice_Ep0SendStatus();
+		return;
+
+	case USB_REQ_GET_CONFIGURATION:
+		if ((usbDeviceState != USB_DEVICE_STATE_ADDRESSED) && (usbDeviceState != USB_DEVICE_STATE_CONFIGURED))
+		{
+			break;
+		}
+		usbDeviceEp0[0] = usbDeviceConfiguration;
+		UsbDevice_Ep0Send(1U);
+		return;
+
+	case USB_REQ_SET_CONFIGURATION:
+		if (((usbDeviceState != USB_DEVICE_STATE_ADDRESSED) && (usbDeviceState != USB_DEVICE_STATE_CONFIGURED))
+				|| (setup->wValue > usbDeviceClass->device[17]))
+		{
+			break;
+		}
+		/* Selecting the current configuration again resets its endpoints */
+		UsbDevice_Deconfigure();
+		usbDeviceState = USB_DEVICE_STATE_ADDRESSED;
+		if (setup->wValue != 0U)
+		{
+			if (UsbDevice_Configure((uint8_t)setup->wValue) != HAL_OK)
+			{
+				break;
+			}
+		}
+		UsbDevice_Ep0SendStatus();
+		return;
+
+	case USB_REQ_GET_STATUS:
+		/* bmAttributes of the configuration descriptor tells self-powered */
+		usbDeviceEp0[0] = (uint8_t)(((usbDeviceClass->configuration(usbDeviceHighSpeed, &length)[7]
+			& USB_DEVICE_ATTR_SELF_POWERED) != 0U) | (usbDeviceRemoteWakeup << 1));
+		usbDeviceEp0[1] = 0U;
+		UsbDevice_Ep0Send(2U);
+		return;
+
+	case USB_REQ_SET_FEATURE:
+	case USB_REQ_CLEAR_FEATURE:
+		if (setup->wValue != USB_FEATURE_REMOTE_WAKEUP)
+		{
+			break;
+		}
+		usbDeviceRemoteWakeup = (setup->bRequest == USB_REQ_SET_FEATURE);
+		UsbDevice_Ep0SendStatus();
+		return;
+
+	default:
+		break;
+	}
+	UsbDevice_Ep0Stall();
+}
+
+static void UsbDevice_InterfaceRequest(void)
+{
+	const UsbDevice_SetupTypeDef *setup = &usbDeviceSetup;
+	uint32_t length;
+
+	if ((usbDeviceState != USB_DEVICE_STATE_CONFIGURED)
+			|| ((setup->wIndex & 0xFFU) >= usbDeviceClass->configuration(usbDeviceHighSpeed, &length)[4]))
+	{
+		UsbDevice_Ep0Stall();
+		return;
+	}
+
+	switch (setup->bRequest)
+	{
+	case USB_REQ_GET_STATUS:
+		usbDeviceEp0[0] = 0U;
+		usbDeviceEp0[1] = 0U;
+		UsbDevice_Ep0Send(2U);
+		return;
+
+	case USB_REQ_GET_INTERFACE:
+		/* No alternate settings */
+		usbDeviceEp0[0] = 0U;
+		UsbDevice_Ep0Send(1U);
+		return;
+
+	case USB_REQ_SET_INTERFACE:
+		if (setup->wValue != 0U)
+		{
+			break;
+		}
+		UsbDevice_Ep0SendStatus();
+		return;
+
+	default:
+		break;
+	}
+	UsbDevice_Ep0Stall();
+}
+
+static void UsbDevice_EndpointRequest(void)
+{
+	const UsbDevice_SetupTypeDef *setup = &usbDeviceSetup;
+	uint8_t address = (uint8_t)(setup->wIndex & (USB_DEVICE_DIR_IN | USB_DEVICE_EP_NUMBER));
+	PCD_EPTypeDef *ep = ((address & USB_DEVICE_DIR_IN) != 0U) ? &usbDeviceHandle->IN_ep[address & USB_DEVICE_EP_NUMBER]
+		: &usbDeviceHandle->OUT_ep[address & USB_DEVICE_EP_NUMBER];
+
+	/* Endpoint 0 answers from the addressed state, the others once configured */
+	if ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(address)) == 0U)
+	{
+		UsbDevice_Ep0Stall();
+		return;
+	}
+	if ((address & USB_DEVICE_EP_NUMBER) != 0U)
+	{
+		if (usbDeviceState != USB_DEVICE_STATE_CONFIGURED)
+		{
+			UsbDevice_Ep0Stall();
+			return;
+		}
+	}
+	else if ((usbDeviceState != USB_DEVICE_STATE_ADDRESSED) && (usbDeviceState != USB_DEVICE_STATE_CONFIGURED))
+	{
+		UsbDevice_Ep0Stall();
+		return;
+	}
+
+	switch (setup->bRequest)
+	{
+	case USB_REQ_GET_STATUS:
+		usbDeviceEp0[0] = ep->is_stall;
+		usbDeviceEp0[1] = 0U;
+		UsbDevice_Ep0Send(2U);
+		return;
+
+	case USB_REQ_SET_FEATURE:
+	case USB_REQ_CLEAR_FEATURE:
+		if (setup->wValue != USB_FEATURE_ENDPOINT_HALT)
+		{
+			break;
+		}
+		if ((address & USB_DEVICE_EP_NUMBER) != 0U)
+		{
+			/* Clearing a halt also resets the data toggle to DATA0 */
+			if (setup->bRequest == USB_REQ_SET_FEATURE)
+			{
+				(void)HAL_PCD_EP_SetStall(usbDeviceHandle, address);
+			}
+			else
+			{
+				(void)HAL_PCD_EP_ClrStall(usbDeviceHandle, address);
+				if (usbDeviceClass->clearHalt != NULL)
+				{
+					usbDeviceClass->clearHalt(address);
+				}
+			}
+		}
+		UsbDevice_Ep0SendStatus();
+		return;
+
+	default:
+		break;
+	}
+	UsbDevice_Ep0Stall();
+}
+
+/**
+ * @brief  Bind the core to an initialized PCD, partition its FIFO RAM for
+ *         the class and connect to the bus.
+ * @note   hpcd must have been through HAL_PCD_Init(), pins and 48 MHz
+ *         clock set up, and DmaBuffer_Init() must have run. It is kept:
+ *         with the core DMA its Setup words are written by the DMA, the
+ *         handle then lives in coherent memory.
+ * @param  hpcd: PCD handle, OTG FS or OTG HS
+ * @param  usbClass: class descriptors and callbacks, kept
+ * @retval HAL status
+ */
+HAL_StatusTypeDef UsbDevice_Init(PCD_HandleTypeDef *hpcd, const UsbDevice_ClassTypeDef *usbClass)
+{
+	uint32_t hs = (hpcd->Instance == USB_OTG_HS);
+	IRQn_Type irq = hs ? OTG_HS_IRQn : OTG_FS_IRQn;
+	UsbFifo_EndpointTypeDef endpoints[2U * (USB_DEVICE_MAX_ENDPOINTS - 1U)];
+	uint32_t count = 0U;
+	uint32_t length;
+	const uint8_t *descriptors;
+	const uint8_t *endpoint = NULL;
+
+	if (usbDeviceEp0 == NULL)
+	{
+		usbDeviceEp0 = DmaBuffer_AllocCached(USB_DEVICE_EP0_SIZE);
+		if (usbDeviceEp0 == NULL)
+		{
+			return HAL_ERROR;
+		}
+	}
+
+	usbDeviceHandle = hpcd;
+	usbDeviceClass = usbClass;
+	usbDeviceState = USB_DEVICE_STATE_POWERED;
+	usbDeviceConfiguration = 0U;
+	usbDeviceRemoteWakeup = 0U;
+	usbDeviceHighSpeed = 0U;
+	usbDeviceOpen = 0U;
+	usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+	memset(&usbDeviceStats, 0, sizeof(usbDeviceStats));
+
+	/* FIFO RAM planned for the endpoints of the configuration at the
+	   fastest speed of the core, before any enumeration */
+	descriptors = usbClass->configuration(hs, &length);
+	while (((endpoint = UsbDevice_FindDescriptor(descriptors, length, endpoint, USB_DESC_ENDPOINT)) != NULL)
+			&& (count < sizeof(endpoints) / sizeof(endpoints[0])))
+	{
+		endpoints[count].address = endpoint[2];
+		endpoints[count].type = endpoint[3] & EP_TYPE_MSK;
+		endpoints[count].maxPacket = UsbDevice_Get16(&endpoint[4]);
+		count++;
+	}
+	usbDeviceFifoWords = hs ? (USB_FIFO_HS_WORDS - ((hpcd->Init.dma_enable != 0U) ? USB_FIFO_HS_DMA_WORDS : 0U))
+		: USB_FIFO_FS_WORDS;
+	if (UsbFifo_Plan(usbClass->device[7], endpoints, count, usbDeviceFifoWords, &usbDeviceFifo) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+
+	/* TX FIFOs are laid out after the RX FIFO, in endpoint order */
+	if (HAL_PCDEx_SetRxFiFo(hpcd, usbDeviceFifo.rxWords) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	for (uint32_t i = 0U; i < USB_DEVICE_MAX_ENDPOINTS; i++)
+	{
+		if (HAL_PCDEx_SetTxFiFo(hpcd, (uint8_t)i, usbDeviceFifo.txWords[i]) != HAL_OK)
+		{
+			return HAL_ERROR;
+		}
+	}
+
+	NVIC_SetPriority(irq, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), USB_DEVICE_IRQ_PRIORITY, 0));
+	NVIC_EnableIRQ(irq);
+
+	return HAL_PCD_Start(hpcd);
+}
+
+/**
+ * @brief  OTG global interrupt body, called from OTG_FS_IRQHandler() or
+ *         OTG_HS_IRQHandler().
+ * @retval None
+ */
+ITCM_TEXT void UsbDevice_IRQHandler(void)
+{
+	HAL_PCD_IRQHandler(usbDeviceHandle);
+}
+
+/**
+ * @brief  Start a transfer on an IN endpoint of the configuration.
+ * @note   Interrupt context or interrupts masked: the class callbacks and
+ *         a task may both start transfers.
+ * @param  epAddress: 0x81 to 0x85
+ * @param  data: held until the class dataIn callback, 32-bit aligned
+ *         with the core DMA
+ * @param  length: any, packets of the endpoint size and a last short one
+ * @retval HAL_OK, HAL_ERROR if not configured or not an endpoint of the
+ *         configuration
+ */
+HAL_StatusTypeDef UsbDevice_Transmit(uint8_t epAddress, const uint8_t *data, uint32_t length)
+{
+	if ((usbDeviceState != USB_DEVICE_STATE_CONFIGURED) || ((epAddress & USB_DEVICE_EP_NUMBER) == 0U)
+			|| ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(epAddress | USB_DEVICE_DIR_IN)) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	if (length != 0U)
+	{
+		DmaBuffer_PrepareTx(data, length);
+	}
+	return HAL_PCD_EP_Transmit(usbDeviceHandle, (uint8_t)(epAddress | USB_DEVICE_DIR_IN), (uint8_t *)data, length);
+}
+
+/**
+ * @brief  Start a transfer on an OUT endpoint of the configuration.
+ * @note   The class dataOut callback gets the received length; it calls
+ *         DmaBuffer_CompleteRx() before reading the buffer.
+ * @param  epAddress: 0x01 to 0x05
+ * @param  buffer: a whole number of packets of the endpoint size, 32-bit
+ *         aligned with the core DMA
+ * @param  length: buffer size; the transfer ends early on a short packet
+ * @retval HAL_OK, HAL_ERROR if not configured or not an endpoint of the
+ *         configuration
+ */
+HAL_StatusTypeDef UsbDevice_Receive(uint8_t epAddress, uint8_t *buffer, uint32_t length)
+{
+	if ((usbDeviceState != USB_DEVICE_STATE_CONFIGURED) || ((epAddress & USB_DEVICE_EP_NUMBER) == 0U)
+			|| ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(epAddress & USB_DEVICE_EP_NUMBER)) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	DmaBuffer_PrepareRx(buffer, length);
+	return HAL_PCD_EP_Receive(usbDeviceHandle, (uint8_t)(epAddress & USB_DEVICE_EP_NUMBER), buffer, length);
+}
+
+/**
+ * @brief  Halt an endpoint of the configuration, until the host clears it.
+ * @param  epAddress: endpoint address, direction bit included
+ * @retval HAL status
+ */
+HAL_StatusTypeDef UsbDevice_Stall(uint8_t epAddress)
+{
+	if (((epAddress & USB_DEVICE_EP_NUMBER) == 0U) || ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(epAddress)) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	return HAL_PCD_EP_SetStall(usbDeviceHandle, epAddress);
+}
+
+/**
+ * @brief  Stop the transfer running on an endpoint of the configuration,
+ *         without its completion callback.
+ * @note   The data already moved is lost; the buffer is free on return.
+ * @param  epAddress: endpoint address, direction bit included
+ * @retval HAL status
+ */
+HAL_StatusTypeDef UsbDevice_Abort(uint8_t epAddress)
+{
+	if (((epAddress & USB_DEVICE_EP_NUMBER) == 0U) || ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(epAddress)) == 0U))
+	{
+		return HAL_ERROR;
+	}
+	return HAL_PCD_EP_Abort(usbDeviceHandle, epAddress);
+}
+
+/**
+ * @brief  Packet size an endpoint was opened with.
+ * @param  epAddress: endpoint address, direction bit included
+ * @retval wMaxPacketSize, 0 if not open
+ */
+uint32_t UsbDevice_MaxPacket(uint8_t epAddress)
+{
+	if ((usbDeviceOpen & USB_DEVICE_OPEN_BIT(epAddress)) == 0U)
+	{
+		return 0U;
+	}
+	return ((epAddress & USB_DEVICE_DIR_IN) != 0U) ? usbDeviceHandle->IN_ep[epAddress & USB_DEVICE_EP_NUMBER].maxpacket
+		: usbDeviceHandle->OUT_ep[epAddress & USB_DEVICE_EP_NUMBER].maxpacket;
+}
+
+/**
+ * @brief  Chapter 9 device state.
+ * @retval state
+ */
+UsbDevice_StateTypeDef UsbDevice_GetState(void)
+{
+	return usbDeviceState;
+}
+
+/**
+ * @brief  Walk a descriptor set, as found in a configuration descriptor.
+ * @param  descriptors: first descriptor
+ * @param  length: bytes of the set, wTotalLength for a configuration
+ * @param  after: descriptor of the set to search after, NULL for the start
+ * @param  type: bDescriptorType looked for
+ * @retval next descriptor of that type, NULL at the end of the set or at a
+ *         descriptor whose bLength is under 2 or runs past the end
+ */
+const uint8_t *UsbDevice_FindDescriptor(const uint8_t *descriptors, uint32_t length, const uint8_t *after,
+		uint8_t type)
+{
+	const uint8_t *end = descriptors + length;
+	const uint8_t *p = (after != NULL) ? after + after[0] : descriptors;
+
+	while ((p + 2) <= end)
+	{
+		if ((p[0] < 2U) || ((p + p[0]) > end))
+		{
+			return NULL;
+		}
+		if (p[1] == type)
+		{
+			return p;
+		}
+		p += p[0];
+	}
+	return NULL;
+}
+
+/**
+ * @brief  Snapshot of the device counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void UsbDevice_GetStats(UsbDevice_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = usbDeviceStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the device state and counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void UsbDevice_Dump(UsbDevice_PutCharTypeDef putChar)
+{
+	UsbDevice_StatsTypeDef stats;
+	char line[160];
+
+	UsbDevice_GetStats(&stats);
+	snprintf(line, sizeof(line), "usb %s cfg=%u %s resets=%lu setups=%lu stalls=%lu susp=%lu ep0=%lu fifo=%u/%luw\r\n",
+		usbDeviceStateName[usbDeviceState], (unsigned)usbDeviceConfiguration, usbDeviceHighSpeed ? "hs" : "fs",
+		(unsigned long)stats.resets, (unsigned long)stats.setups, (unsigned long)stats.stalls,
+		(unsigned long)stats.suspends, (unsigned long)stats.ep0Bytes, (unsigned)usbDeviceFifo.usedWords,
+		(unsigned long)usbDeviceFifoWords);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
+
+/* HAL PCD callbacks ---------------------------------------------------------*/
+/**
+ * @brief  Setup packet received on endpoint 0.
+ * @param  hpcd: PCD handle
+ * @retval None
+ */
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+{
+	const uint8_t *raw = (const uint8_t *)hpcd->Setup;
+
+	usbDeviceStats.setups++;
+	usbDeviceSetup.bmRequestType = raw[0];
+	usbDeviceSetup.bRequest = raw[1];
+	usbDeviceSetup.wValue = UsbDevice_Get16(&raw[2]);
+	usbDeviceSetup.wIndex = UsbDevice_Get16(&raw[4]);
+	usbDeviceSetup.wLength = UsbDevice_Get16(&raw[6]);
+	/* A setup packet aborts whatever control transfer was going on */
+	usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+
+	if ((usbDeviceSetup.bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_STANDARD)
+	{
+		UsbDevice_ClassRequest();
+		return;
+	}
+	switch (usbDeviceSetup.bmRequestType & USB_REQ_RECIPIENT_MASK)
+	{
+	case USB_REQ_RECIPIENT_DEVICE:
+		UsbDevice_DeviceRequest();
+		break;
+
+	case USB_REQ_RECIPIENT_INTERFACE:
+		UsbDevice_InterfaceRequest();
+		break;
+
+	case USB_REQ_RECIPIENT_ENDPOINT:
+		UsbDevice_EndpointRequest();
+		break;
+
+	default:
+		UsbDevice_Ep0Stall();
+		break;
+	}
+}
+
+/**
+ * @brief  OUT transfer complete.
+ * @param  hpcd: PCD handle
+ * @param  epnum: endpoint number
+ * @retval None
+ */
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	uint32_t count = HAL_PCD_EP_GetRxCount(hpcd, epnum);
+	uint32_t length;
+
+	if (epnum != 0U)
+	{
+		if (usbDeviceClass->dataOut != NULL)
+		{
+			usbDeviceClass->dataOut(epnum, count);
+		}
+		return;
+	}
+
+	if (usbDeviceEp0State == USB_DEVICE_EP0_STATUS_OUT)
+	{
+		usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+		return;
+	}
+	if (usbDeviceEp0State != USB_DEVICE_EP0_DATA_OUT)
+	{
+		return;
+	}
+	DmaBuffer_CompleteRx(&usbDeviceEp0[usbDeviceEp0Offset], USB_DEVICE_EP0_MPS);
+	usbDeviceEp0Offset += (count < (usbDeviceEp0Length - usbDeviceEp0Offset)) ? count
+		: (usbDeviceEp0Length - usbDeviceEp0Offset);
+	if ((usbDeviceEp0Offset < usbDeviceEp0Length) && (count == USB_DEVICE_EP0_MPS))
+	{
+		UsbDevice_Ep0ReceiveNext();
+		return;
+	}
+
+	/* Data stage in: the class takes the request now, a refusal stalls
+	   the status stage */
+	usbDeviceStats.ep0Bytes += usbDeviceEp0Offset;
+	length = usbDeviceEp0Offset;
+	if (usbDeviceClass->request(&usbDeviceSetup, usbDeviceEp0, &length) != HAL_OK)
+	{
+		UsbDevice_Ep0Stall();
+		return;
+	}
+	UsbDevice_Ep0SendStatus();
+}
+
+/**
+ * @brief  IN transfer complete.
+ * @param  hpcd: PCD handle
+ * @param  epnum: endpoint number
+ * @retval None
+ */
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	if (epnum != 0U)
+	{
+		if (usbDeviceClass->dataIn != NULL)
+		{
+			usbDeviceClass->dataIn((uint8_t)(epnum | USB_DEVICE_DIR_IN));
+		}
+		return;
+	}
+
+	switch (usbDeviceEp0State)
+	{
+	case USB_DEVICE_EP0_DATA_IN:
+		if (usbDeviceEp0Offset < usbDeviceEp0Length)
+		{
+			UsbDevice_Ep0SendNext();
+		}
+		else if (usbDeviceEp0Zlp != 0U)
+		{
+			usbDeviceEp0Zlp = 0U;
+			UsbDevice_Ep0SendNext();
+		}
+		else
+		{
+			usbDeviceEp0State = USB_DEVICE_EP0_STATUS_OUT;
+			(void)HAL_PCD_EP_Receive(hpcd, 0x00U, NULL, 0U);
+		}
+		break;
+
+	case USB_DEVICE_EP0_STATUS_IN:
+		usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+		break;
+
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief  Bus reset done, speed enumerated: back to the default state
+ *         with endpoint 0 only.
+ * @param  hpcd: PCD handle
+ * @retval None
+ */
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
+{
+	usbDeviceStats.resets++;
+	UsbDevice_Deconfigure();
+	usbDeviceHighSpeed = (hpcd->Init.speed == PCD_SPEED_HIGH);
+	usbDeviceState = USB_DEVICE_STATE_DEFAULT;
+	usbDeviceRemoteWakeup = 0U;
+	usbDeviceEp0State = USB_DEVICE_EP0_IDLE;
+
+	(void)HAL_PCD_EP_Open(hpcd, 0x00U, USB_DEVICE_EP0_MPS, EP_TYPE_CTRL);
+	(void)HAL_PCD_EP_Open(hpcd, USB_DEVICE_DIR_IN, USB_DEVICE_EP0_MPS, EP_TYPE_CTRL);
+	usbDeviceOpen = USB_DEVICE_OPEN_BIT(0x00U) | USB_DEVICE_OPEN_BIT(USB_DEVICE_DIR_IN);
+}
+
+/**
+ * @brief  Bus idle for 3 ms.
+ * @param  hpcd: PCD handle
+ * @retval None
+ */
+void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
+{
+	(void)hpcd;
+
+	if (usbDeviceState != USB_DEVICE_STATE_SUSPENDED)
+	{
+		usbDeviceResumeState = usbDeviceState;
+		usbDeviceState = USB_DEVICE_STATE_SUSPENDED;
+		usbDeviceStats.suspends++;
+	}
+}
+
+/**
+ * @brief  Bus activity again after a suspend.
+ * @param  hpcd: PCD handle
+ * @retval None
+ */
+void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
+{
+	(void)hpcd;
+
+	if (usbDeviceState == USB_DEVICE_STATE_SUSPENDED)
+	{
+		usbDeviceState = usbDeviceResumeState;
+	}
+}
+
+/**
+ * @brief  Session end: VBUS gone.
+ * @param  hpcd: PCD handle
+ * @retval None
+ */
+void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
+{
+	(void)hpcd;
+
+	UsbDevice_Deconfigure();
+	usbDeviceState = USB_DEVICE_STATE_POWERED;
+}
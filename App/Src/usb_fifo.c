@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file    usb_fifo.c
+  * @brief   OTG device FIFO RAM planner.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "usb_fifo.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_FIFO_DIR_IN             0x80U
+#define USB_FIFO_EP_NUMBER          0x0FU
+#define USB_FIFO_EP0_MPS_MAX        64U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+	uint32_t packetWords;               /* 0: endpoint not in the list */
+	uint32_t packets;
+	uint8_t type;
+} UsbFifo_TxTypeDef;
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t UsbFifo_TxDepth(uint32_t packetWords, uint32_t packets)
+{
+	uint32_t words = packetWords * packets;
+
+	return (words < USB_FIFO_MIN_TX_WORDS) ? USB_FIFO_MIN_TX_WORDS : words;
+}
+
+/**
+ * @brief  FIFO words one (micro)frame of an endpoint takes.
+ * @param  maxPacket: wMaxPacketSize, additional transactions in bits 12:11
+ * @retval words
+ */
+uint32_t UsbFifo_PacketWords(uint16_t maxPacket)
+{
+	uint32_t bytes = maxPacket & 0x7FFU;
+	uint32_t transactions = 1U + ((maxPacket >> 11) & 0x3U);
+
+	return ((bytes + 3U) / 4U) * transactions;
+}
+
+/**
+ * @brief  Lay out the FIFO RAM for an endpoint list.
+ * @note   Pure function. RAM left over after USB_FIFO_MAX_PACKETS for
+ *         every streaming endpoint stays unused.
+ * @param  ep0MaxPacket: endpoint 0 bMaxPacketSize0
+ * @param  endpoints: endpoints besides endpoint 0, as in the configuration
+ *         descriptor
+ * @param  count: number of endpoints
+ * @param  ramWords: FIFO RAM of the core, USB_FIFO_FS_WORDS or
+ *         USB_FIFO_HS_WORDS, less USB_FIFO_HS_DMA_WORDS with the DMA on
+ * @param  plan: result, zeroed on error
+ * @retval HAL_OK, HAL_ERROR for an endpoint number out of range, an IN
+ *         endpoint listed twice or too little RAM for one packet each
+ */
+HAL_StatusTypeDef UsbFifo_Plan(uint32_t ep0MaxPacket, const UsbFifo_EndpointTypeDef *endpoints, uint32_t count,
+		uint32_t ramWords, UsbFifo_PlanTypeDef *plan)
+{
+	UsbFifo_TxTypeDef tx[USB_FIFO_MAX_ENDPOINTS];
+	uint32_t controls = 1U;
+	uint32_t outs = 1U;
+	uint32_t largest;
+	uint32_t rxPacketWords = 0U;        /* largest streaming OUT packet, 0: none */
+	uint8_t rxType = EP_TYPE_BULK;      /* most urgent streaming OUT type */
+	uint32_t rxPackets = 1U;
+	uint32_t rxWords;
+	uint32_t used;
+
+	memset(plan, 0, sizeof(*plan));
+	memset(tx, 0, sizeof(tx));
+	if ((ep0MaxPacket == 0U) || (ep0MaxPacket > USB_FIFO_EP0_MPS_MAX))
+	{
+		return HAL_ERROR;
+	}
+	largest = UsbFifo_PacketWords((uint16_t)ep0MaxPacket);
+	tx[0].packetWords = largest;
+	tx[0].packets = 1U;
+	tx[0].type = EP_TYPE_CTRL;
+
+	for (uint32_t i = 0U; i < count; i++)
+	{
+		uint32_t number = endpoints[i].address & USB_FIFO_EP_NUMBER;
+		uint32_t words = UsbFifo_PacketWords(endpoints[i].maxPacket);
+		uint8_t type = endpoints[i].type & EP_TYPE_MSK;
+
+		if ((number == 0U) || (number >= USB_FIFO_MAX_ENDPOINTS))
+		{
+			return HAL_ERROR;
+		}
+		if (type == EP_TYPE_CTRL)
+		{
+			controls++;
+		}
+		if ((endpoints[i].address & USB_FIFO_DIR_IN) != 0U)
+		{
+			if (tx[number].packetWords != 0U)
+			{
+				return HAL_ERROR;
+			}
+			tx[number].packetWords = words;
+			tx[number].packets = 1U;
+			tx[number].type = type;
+			continue;
+		}
+
+		outs++;
+		if (words > largest)
+		{
+			largest = words;
+		}
+		if ((type == EP_TYPE_ISOC) || (type == EP_TYPE_BULK))
+		{
+			if (words > rxPacketWords)
+			{
+				rxPacketWords = words;
+			}
+			if (type == EP_TYPE_ISOC)
+			{
+				rxType = EP_TYPE_ISOC;
+			}
+		}
+	}
+
+	/* One packet everywhere first */
+	rxWords = 5U * controls + 8U + (largest + 1U) + 2U * outs + 1U;
+	used = rxWords;
+	for (uint32_t n = 0U; n < USB_FIFO_MAX_ENDPOINTS; n++)
+	{
+		if (tx[n].packetWords != 0U)
+		{
+			used += UsbFifo_TxDepth(tx[n].packetWords, 1U);
+		}
+	}
+	if (used > ramWords)
+	{
+		return HAL_ERROR;
+	}
+
+	/* Then one packet more per round, isochronous before bulk, each IN
+	   FIFO before the RX FIFO */
+	for (uint32_t packets = 2U; packets <= USB_FIFO_MAX_PACKETS; packets++)
+	{
+		static const uint8_t order[] = { EP_TYPE_ISOC, EP_TYPE_BULK };
+
+		for (uint32_t k = 0U; k < sizeof(order); k++)
+		{
+			for (uint32_t n = 1U; n < USB_FIFO_MAX_ENDPOINTS; n++)
+			{
+				uint32_t more;
+
+				if ((tx[n].packetWords == 0U) || (tx[n].type != order[k]) || (tx[n].packets >= packets))
+				{
+					continue;
+				}
+				more = UsbFifo_TxDepth(tx[n].packetWords, packets) - UsbFifo_TxDepth(tx[n].packetWords, tx[n].packets);
+				if (used + more <= ramWords)
+				{
+					used += more;
+					tx[n].packets = packets;
+				}
+			}
+			if ((rxPacketWords != 0U) && (rxType == order[k]) && (rxPackets < packets)
+					&& (used + rxPacketWords + 1U <= ramWords))
+			{
+				used += rxPacketWords + 1U;
+				rxWords += rxPacketWords + 1U;
+				rxPackets = packets;
+			}
+		}
+	}
+
+	plan->rxWords = (uint16_t)rxWords;
+	for (uint32_t n = 0U; n < USB_FIFO_MAX_ENDPOINTS; n++)
+	{
+		if (tx[n].packetWords != 0U)
+		{
+			plan->txWords[n] = (uint16_t)UsbFifo_TxDepth(tx[n].packetWords, tx[n].packets);
+		}
+	}
+	plan->usedWords = (uint16_t)used;
+	return HAL_OK;
+}
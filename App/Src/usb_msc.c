@@ -0,0 +1,898 @@
+/**
+  ******************************************************************************
+  * @file    usb_msc.c
+  * @brief   USB mass storage class, bulk-only transport.
+  *
+  *          The slots and the command buffer come from the cached DMA pool:
+  *          the storage DMA and, on OTG HS, the core DMA move them, each
+  *          handoff going through the dma_buffer.h calls.
+  *          A data stage the host expects longer than the command needs
+  *          ends short on IN (a zero-length packet when the data ends on a
+  *          packet boundary) and with a halt on OUT, the CSW residue telling
+  *          the difference (BOT 6.7).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "dma_buffer.h"
+#include "usb_msc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define USB_MSC_VID                 0x0483U /* ST Mass Storage */
+#define USB_MSC_PID                 0x5720U
+#define USB_MSC_SLOT_BLOCKS         (USB_MSC_SLOT_SIZE / USB_MSC_BLOCK_SIZE)
+
+#define USB_MSC_CBW_SIGNATURE       0x43425355U     /* "USBC" */
+#define USB_MSC_CSW_SIGNATURE       0x53425355U     /* "USBS" */
+#define USB_MSC_CBW_LENGTH          31U
+#define USB_MSC_CSW_LENGTH          13U
+#define USB_MSC_CBW_DIR_IN          0x80U
+#define USB_MSC_CB_MAX              16U
+
+/* bCSWStatus */
+#define USB_MSC_CSW_PASSED          0x00U
+#define USB_MSC_CSW_FAILED          0x01U
+#define USB_MSC_CSW_PHASE_ERROR     0x02U
+
+/* SCSI operation codes */
+#define USB_MSC_SCSI_TEST_UNIT_READY        0x00U
+#define USB_MSC_SCSI_REQUEST_SENSE          0x03U
+#define USB_MSC_SCSI_INQUIRY                0x12U
+#define USB_MSC_SCSI_MODE_SENSE_6           0x1AU
+#define USB_MSC_SCSI_START_STOP_UNIT        0x1BU
+#define USB_MSC_SCSI_PREVENT_ALLOW          0x1EU
+#define USB_MSC_SCSI_READ_FORMAT_CAPACITIES 0x23U
+#define USB_MSC_SCSI_READ_CAPACITY_10       0x25U
+#define USB_MSC_SCSI_READ_10                0x28U
+#define USB_MSC_SCSI_WRITE_10               0x2AU
+#define USB_MSC_SCSI_VERIFY_10              0x2FU
+#define USB_MSC_SCSI_SYNCHRONIZE_CACHE_10   0x35U
+#define USB_MSC_SCSI_MODE_SENSE_10          0x5AU
+
+/* Sense keys and additional sense codes */
+#define USB_MSC_SENSE_NONE          0x00U
+#define USB_MSC_SENSE_NOT_READY     0x02U
+#define USB_MSC_SENSE_MEDIUM_ERROR  0x03U
+#define USB_MSC_SENSE_ILLEGAL_REQUEST 0x05U
+#define USB_MSC_ASC_WRITE_ERROR     0x0CU
+#define USB_MSC_ASC_READ_ERROR      0x11U
+#define USB_MSC_ASC_INVALID_COMMAND 0x20U
+#define USB_MSC_ASC_LBA_OUT_OF_RANGE 0x21U
+#define USB_MSC_ASC_INVALID_FIELD   0x24U
+#define USB_MSC_ASC_NO_MEDIUM       0x3AU
+
+#define USB_MSC_SENSE_LENGTH        18U
+#define USB_MSC_INQUIRY_LENGTH      36U
+
+#define USB_MSC_LO(x)               (uint8_t)((x) & 0xFFU)
+#define USB_MSC_HI(x)               (uint8_t)(((x) >> 8) & 0xFFU)
+
+/* Configuration descriptor for a bulk packet size */
+#define USB_MSC_CONFIGURATION(bulkMps) \
+{ \
+	/* Configuration: 1 interface, bus powered, 100 mA */ \
+	9U, USB_DESC_CONFIGURATION, USB_MSC_LO(USB_MSC_CONFIG_LENGTH), USB_MSC_HI(USB_MSC_CONFIG_LENGTH), \
+	1U, 1U, 0U, 0x80U, 50U, \
+	/* Interface 0: mass storage, SCSI transparent command set, bulk-only */ \
+	9U, USB_DESC_INTERFACE, USB_MSC_INTERFACE, 0U, 2U, 0x08U, 0x06U, 0x50U, 0U, \
+	/* Bulk OUT and IN */ \
+	7U, USB_DESC_ENDPOINT, USB_MSC_EP_OUT, EP_TYPE_BULK, USB_MSC_LO(bulkMps), USB_MSC_HI(bulkMps), 0U, \
+	7U, USB_DESC_ENDPOINT, USB_MSC_EP_IN, EP_TYPE_BULK, USB_MSC_LO(bulkMps), USB_MSC_HI(bulkMps), 0U \
+}
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+	USB_MSC_STATE_IDLE = 0,             /* CBW receive armed */
+	USB_MSC_STATE_DATA,                 /* short answer going out */
+	USB_MSC_STATE_STREAM,               /* READ(10)/WRITE(10) through the slots */
+	USB_MSC_STATE_ZLP,                  /* zero-length packet ending an IN data stage */
+	USB_MSC_STATE_STATUS,               /* CSW going out */
+	USB_MSC_STATE_HALTED                /* CBW not valid, until a BOT reset */
+} UsbMsc_StateTypeDef;
+
+typedef enum
+{
+	USB_MSC_SLOT_FREE = 0,
+	USB_MSC_SLOT_FILLING,               /* producer at work */
+	USB_MSC_SLOT_FULL,
+	USB_MSC_SLOT_DRAINING               /* consumer at work */
+} UsbMsc_SlotStateTypeDef;
+
+typedef struct
+{
+	uint8_t *buffer;                    /* USB_MSC_SLOT_SIZE, cached DMA pool */
+	uint32_t block;
+	uint32_t count;
+	UsbMsc_SlotStateTypeDef state;
+} UsbMsc_SlotTypeDef;
+
+/* Private function prototypes -----------------------------------------------*/
+static const uint8_t *UsbMsc_Configuration(uint32_t highSpeed, uint32_t *length);
+static void UsbMsc_Configured(uint8_t configuration, uint32_t highSpeed);
+static HAL_StatusTypeDef UsbMsc_Request(const UsbDevice_SetupTypeDef *setup, uint8_t *data, uint32_t *length);
+static void UsbMsc_DataIn(uint8_t epAddress);
+static void UsbMsc_DataOut(uint8_t epAddress, uint32_t length);
+static void UsbMsc_ClearHalt(uint8_t epAddress);
+static void UsbMsc_Pump(void);
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t usbMscDevice[USB_DESC_DEVICE_LENGTH] =
+{
+	USB_DESC_DEVICE_LENGTH, USB_DESC_DEVICE, 0x00U, 0x02U,     /* USB 2.0 */
+	0x00U, 0x00U, 0x00U, USB_DEVICE_EP0_MPS,                   /* class in the interface */
+	USB_MSC_LO(USB_MSC_VID), USB_MSC_HI(USB_MSC_VID), USB_MSC_LO(USB_MSC_PID), USB_MSC_HI(USB_MSC_PID),
+	0x00U, 0x02U, 1U, 2U, 3U, 1U                                /* bcdDevice 2.00, strings, 1 configuration */
+};
+
+static const uint8_t usbMscConfigurationFs[USB_MSC_CONFIG_LENGTH] = USB_MSC_CONFIGURATION(USB_OTG_FS_MAX_PACKET_SIZE);
+static const uint8_t usbMscConfigurationHs[USB_MSC_CONFIG_LENGTH] = USB_MSC_CONFIGURATION(USB_OTG_HS_MAX_PACKET_SIZE);
+
+static const char *usbMscStrings[3] = { "STMicroelectronics", "STM32F746ZG Mass Storage", "0" };
+
+/* Direct access block device, removable, SPC-2 */
+static const uint8_t usbMscInquiry[USB_MSC_INQUIRY_LENGTH] =
+{
+	0x00U, 0x80U, 0x04U, 0x02U, USB_MSC_INQUIRY_LENGTH - 5U, 0x00U, 0x00U, 0x00U,
+	'S', 'T', 'M', 'i', 'c', 'r', 'o', ' ',
+	'S', 'T', 'M', '3', '2', 'F', '7', ' ', 'S', 'D', ' ', 'C', 'a', 'r', 'd', ' ',
+	'1', '.', '0', '0'
+};
+
+static const UsbDevice_ClassTypeDef usbMscClass =
+{
+	.device = usbMscDevice,
+	.configuration = UsbMsc_Configuration,
+	.strings = usbMscStrings,
+	.stringCount = sizeof(usbMscStrings) / sizeof(usbMscStrings[0]),
+	.configured = UsbMsc_Configured,
+	.request = UsbMsc_Request,
+	.dataIn = UsbMsc_DataIn,
+	.dataOut = UsbMsc_DataOut,
+	.clearHalt = UsbMsc_ClearHalt
+};
+
+static const UsbMsc_StorageTypeDef *usbMscStorage;
+static uint8_t *usbMscCommand;              /* USB_MSC_COMMAND_SIZE, cached DMA pool */
+static UsbMsc_SlotTypeDef usbMscSlot[2];
+static UsbMsc_StateTypeDef usbMscState;
+/* From the CBW */
+static uint32_t usbMscTag;
+static uint32_t usbMscDataLength;           /* dCBWDataTransferLength */
+static uint32_t usbMscDataIn;               /* host expects data in, if any */
+/* Command in progress */
+static uint32_t usbMscTransferred;          /* data stage bytes moved */
+static uint32_t usbMscAnswerLength;
+static uint8_t usbMscStatus;                /* bCSWStatus so far */
+static uint32_t usbMscStreamIn;             /* 1: READ(10), the storage fills; 0: WRITE(10), it drains */
+static uint32_t usbMscBlock;                /* next block to fill */
+static uint32_t usbMscFillLeft;             /* blocks no fill started for */
+static uint32_t usbMscDrainLeft;            /* blocks not drained yet */
+static uint32_t usbMscFill;                 /* slot filled next */
+static uint32_t usbMscDrain;                /* slot drained next */
+static uint32_t usbMscPumping;
+static uint32_t usbMscPumpAgain;
+static volatile uint32_t usbMscRetry;       /* storage refused busy, see UsbMsc_Poll() */
+static uint32_t usbMscStorageBusy;          /* UsbMsc_StorageDone() to come */
+static uint32_t usbMscStorageStale;         /* ... for a command given up, its slot still in use */
+static uint8_t usbMscSenseKey;
+static uint8_t usbMscSenseAsc;
+static UsbMsc_StatsTypeDef usbMscStats;
+
+/* Private functions ---------------------------------------------------------*/
+static inline uint32_t UsbMsc_Get16Be(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t UsbMsc_Get32Be(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void UsbMsc_Put32Be(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)(value >> 24);
+	p[1] = (uint8_t)(value >> 16);
+	p[2] = (uint8_t)(value >> 8);
+	p[3] = (uint8_t)value;
+}
+
+static inline uint32_t UsbMsc_Get32Le(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void UsbMsc_Put32Le(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+static inline uint32_t UsbMsc_Min(uint32_t a, uint32_t b)
+{
+	return (a < b) ? a : b;
+}
+
+static const uint8_t *UsbMsc_Configuration(uint32_t highSpeed, uint32_t *length)
+{
+	*length = USB_MSC_CONFIG_LENGTH;
+	return (highSpeed != 0U) ? usbMscConfigurationHs : usbMscConfigurationFs;
+}
+
+static void UsbMsc_ReceiveCbw(void)
+{
+	usbMscState = USB_MSC_STATE_IDLE;
+	(void)UsbDevice_Receive(USB_MSC_EP_OUT, usbMscCommand, USB_MSC_COMMAND_SIZE);
+}
+
+static void UsbMsc_SendCsw(void)
+{
+	uint8_t *csw = usbMscCommand;
+
+	if (usbMscStatus == USB_MSC_CSW_FAILED)
+	{
+		usbMscStats.failed++;
+	}
+	else if (usbMscStatus == USB_MSC_CSW_PHASE_ERROR)
+	{
+		usbMscStats.phaseErrors++;
+	}
+	UsbMsc_Put32Le(&csw[0], USB_MSC_CSW_SIGNATURE);
+	UsbMsc_Put32Le(&csw[4], usbMscTag);
+	UsbMsc_Put32Le(&csw[8], usbMscDataLength - usbMscTransferred);
+	csw[12] = usbMscStatus;
+	usbMscState = USB_MSC_STATE_STATUS;
+	(void)UsbDevice_Transmit(USB_MSC_EP_IN, csw, USB_MSC_CSW_LENGTH);
+}
+
+/* End the data stage after usbMscTransferred bytes, then the CSW */
+static void UsbMsc_EndData(uint8_t status)
+{
+	uint32_t maxPacket = UsbDevice_MaxPacket(USB_MSC_EP_IN);
+
+	usbMscStatus = status;
+	if (usbMscTransferred != usbMscDataLength)
+	{
+		if (usbMscDataIn == 0U)
+		{
+			/* The host has more to send: halt, it clears the halt and reads the CSW */
+			(void)UsbDevice_Stall(USB_MSC_EP_OUT);
+		}
+		else if ((maxPacket != 0U) && ((usbMscTransferred % maxPacket) == 0U))
+		{
+			/* Nothing sent or a last full packet: the host still waits for a short one */
+			usbMscState = USB_MSC_STATE_ZLP;
+			if (UsbDevice_Transmit(USB_MSC_EP_IN, NULL, 0U) == HAL_OK)
+			{
+				return;
+			}
+		}
+	}
+	UsbMsc_SendCsw();
+}
+
+static void UsbMsc_Fail(uint8_t key, uint8_t asc)
+{
+	usbMscSenseKey = key;
+	usbMscSenseAsc = asc;
+	UsbMsc_EndData(USB_MSC_CSW_FAILED);
+}
+
+/* The data stage the command needs against the one the host expects:
+   a direction mismatch or a host expecting less is a phase error */
+static HAL_StatusTypeDef UsbMsc_CheckPhase(uint32_t in, uint32_t length)
+{
+	if ((usbMscDataLength == 0U) || (usbMscDataIn != in) || (length > usbMscDataLength))
+	{
+		UsbMsc_EndData(USB_MSC_CSW_PHASE_ERROR);
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+/* Send an answer built in the command buffer */
+static void UsbMsc_Answer(uint32_t length)
+{
+	if (length == 0U)
+	{
+		UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		return;
+	}
+	if (UsbMsc_CheckPhase(1U, length) != HAL_OK)
+	{
+		return;
+	}
+	usbMscAnswerLength = length;
+	usbMscState = USB_MSC_STATE_DATA;
+	(void)UsbDevice_Transmit(USB_MSC_EP_IN, usbMscCommand, length);
+}
+
+static HAL_StatusTypeDef UsbMsc_Capacity(uint32_t *blocks)
+{
+	if (usbMscStorage->capacity(blocks) != HAL_OK)
+	{
+		UsbMsc_Fail(USB_MSC_SENSE_NOT_READY, USB_MSC_ASC_NO_MEDIUM);
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef UsbMsc_CheckRange(uint32_t block, uint32_t count)
+{
+	uint32_t blocks;
+
+	if (UsbMsc_Capacity(&blocks) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	if ((block >= blocks) || (count > (blocks - block)))
+	{
+		UsbMsc_Fail(USB_MSC_SENSE_ILLEGAL_REQUEST, USB_MSC_ASC_LBA_OUT_OF_RANGE);
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+/* Storage operation on a slot: read into it or write it out */
+static HAL_StatusTypeDef UsbMsc_StorageStart(UsbMsc_SlotTypeDef *slot)
+{
+	HAL_StatusTypeDef status;
+
+	usbMscStorageBusy = 1U;
+	status = (usbMscStreamIn != 0U) ? usbMscStorage->read(slot->buffer, slot->block, slot->count)
+		: usbMscStorage->write(slot->buffer, slot->block, slot->count);
+	if (status != HAL_OK)
+	{
+		usbMscStorageBusy = 0U;
+	}
+	return status;
+}
+
+/* A slot operation that did not start: try again later or give up */
+static void UsbMsc_Refused(HAL_StatusTypeDef status)
+{
+	if (status == HAL_BUSY)
+	{
+		usbMscRetry = 1U;
+		usbMscStats.retries++;
+		return;
+	}
+	usbMscSenseKey = USB_MSC_SENSE_MEDIUM_ERROR;
+	usbMscSenseAsc = (usbMscStreamIn != 0U) ? USB_MSC_ASC_READ_ERROR : USB_MSC_ASC_WRITE_ERROR;
+	usbMscStatus = USB_MSC_CSW_FAILED;
+}
+
+static void UsbMsc_FillDone(HAL_StatusTypeDef status, uint32_t length)
+{
+	UsbMsc_SlotTypeDef *slot = &usbMscSlot[usbMscFill];
+
+	if (usbMscStreamIn == 0U)
+	{
+		usbMscTransferred += length;
+		if ((status == HAL_OK) && (length != slot->count * USB_MSC_BLOCK_SIZE))
+		{
+			/* A short packet before the end of the blocks */
+			slot->state = USB_MSC_SLOT_FREE;
+			usbMscStatus = USB_MSC_CSW_PHASE_ERROR;
+			return;
+		}
+	}
+	if (status != HAL_OK)
+	{
+		slot->state = USB_MSC_SLOT_FREE;
+		UsbMsc_Refused(HAL_ERROR);
+		return;
+	}
+	slot->state = USB_MSC_SLOT_FULL;
+	usbMscFill ^= 1U;
+}
+
+static void UsbMsc_DrainDone(HAL_StatusTypeDef status)
+{
+	UsbMsc_SlotTypeDef *slot = &usbMscSlot[usbMscDrain];
+
+	slot->state = USB_MSC_SLOT_FREE;
+	if (status != HAL_OK)
+	{
+		UsbMsc_Refused(HAL_ERROR);
+		return;
+	}
+	if (usbMscStreamIn != 0U)
+	{
+		usbMscTransferred += slot->count * USB_MSC_BLOCK_SIZE;
+		usbMscStats.readBlocks += slot->count;
+	}
+	else
+	{
+		usbMscStats.writeBlocks += slot->count;
+	}
+	usbMscDrainLeft -= slot->count;
+	usbMscDrain ^= 1U;
+}
+
+/* One round of the slot pipeline: start what can start, end the data stage
+   once everything is drained or a failure has let the slots settle */
+static void UsbMsc_PumpOnce(void)
+{
+	UsbMsc_SlotTypeDef *fill = &usbMscSlot[usbMscFill];
+	UsbMsc_SlotTypeDef *drain = &usbMscSlot[usbMscDrain];
+	HAL_StatusTypeDef status;
+	uint32_t overlap;
+
+	if ((usbMscState != USB_MSC_STATE_STREAM) || (usbMscStorageStale != 0U))
+	{
+		return;
+	}
+
+	if ((usbMscStatus == USB_MSC_CSW_PASSED) && (usbMscFillLeft != 0U) && (fill->state == USB_MSC_SLOT_FREE))
+	{
+		overlap = (usbMscSlot[usbMscFill ^ 1U].state == USB_MSC_SLOT_DRAINING);
+		fill->block = usbMscBlock;
+		fill->count = UsbMsc_Min(usbMscFillLeft, USB_MSC_SLOT_BLOCKS);
+		fill->state = USB_MSC_SLOT_FILLING;
+		status = (usbMscStreamIn != 0U) ? UsbMsc_StorageStart(fill)
+			: UsbDevice_Receive(USB_MSC_EP_OUT, fill->buffer, fill->count * USB_MSC_BLOCK_SIZE);
+		if (status == HAL_OK)
+		{
+			usbMscBlock += fill->count;
+			usbMscFillLeft -= fill->count;
+			usbMscStats.overlapped += overlap;
+			usbMscPumpAgain = 1U;
+		}
+		else
+		{
+			fill->state = USB_MSC_SLOT_FREE;
+			UsbMsc_Refused(status);
+		}
+	}
+
+	if ((usbMscStatus == USB_MSC_CSW_PASSED) && (drain->state == USB_MSC_SLOT_FULL))
+	{
+		overlap = (usbMscSlot[usbMscDrain ^ 1U].state == USB_MSC_SLOT_FILLING);
+		drain->state = USB_MSC_SLOT_DRAINING;
+		status = (usbMscStreamIn != 0U) ? UsbDevice_Transmit(USB_MSC_EP_IN, drain->buffer, drain->count * USB_MSC_BLOCK_SIZE)
+			: UsbMsc_StorageStart(drain);
+		if (status == HAL_OK)
+		{
+			usbMscStats.overlapped += overlap;
+			usbMscPumpAgain = 1U;
+		}
+		else
+		{
+			drain->state = USB_MSC_SLOT_FULL;
+			UsbMsc_Refused(status);
+		}
+	}
+
+	for (uint32_t i = 0U; i < 2U; i++)
+	{
+		if ((usbMscSlot[i].state == USB_MSC_SLOT_FILLING) || (usbMscSlot[i].state == USB_MSC_SLOT_DRAINING))
+		{
+			return;
+		}
+	}
+	if ((usbMscStatus != USB_MSC_CSW_PASSED) || (usbMscDrainLeft == 0U))
+	{
+		UsbMsc_EndData(usbMscStatus);
+	}
+}
+
+/* Run the pipeline until it settles. Completions may come from within the
+   calls it makes (a storage finishing at once): they only pump again. */
+static void UsbMsc_Pump(void)
+{
+	if (usbMscPumping != 0U)
+	{
+		usbMscPumpAgain = 1U;
+		return;
+	}
+	usbMscPumping = 1U;
+	do
+	{
+		usbMscPumpAgain = 0U;
+		UsbMsc_PumpOnce();
+	} while (usbMscPumpAgain != 0U);
+	usbMscPumping = 0U;
+}
+
+static void UsbMsc_Stream(uint32_t in, uint32_t block, uint32_t count)
+{
+	if (UsbMsc_CheckRange(block, count) != HAL_OK)
+	{
+		return;
+	}
+	if (count == 0U)
+	{
+		UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		return;
+	}
+	if (UsbMsc_CheckPhase(in, count * USB_MSC_BLOCK_SIZE) != HAL_OK)
+	{
+		return;
+	}
+	usbMscSlot[0].state = USB_MSC_SLOT_FREE;
+	usbMscSlot[1].state = USB_MSC_SLOT_FREE;
+	usbMscFill = 0U;
+	usbMscDrain = 0U;
+	usbMscStreamIn = in;
+	usbMscBlock = block;
+	usbMscFillLeft = count;
+	usbMscDrainLeft = count;
+	usbMscState = USB_MSC_STATE_STREAM;
+	UsbMsc_Pump();
+}
+
+static void UsbMsc_Scsi(const uint8_t *cb)
+{
+	uint8_t *answer = usbMscCommand;
+	uint32_t blocks;
+
+	switch (cb[0])
+	{
+	case USB_MSC_SCSI_TEST_UNIT_READY:
+		if (UsbMsc_Capacity(&blocks) == HAL_OK)
+		{
+			UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		}
+		return;
+
+	case USB_MSC_SCSI_REQUEST_SENSE:
+		/* Fixed format, current error; reading it clears it */
+		memset(answer, 0, USB_MSC_SENSE_LENGTH);
+		answer[0] = 0x70U;
+		answer[2] = usbMscSenseKey;
+		answer[7] = USB_MSC_SENSE_LENGTH - 8U;
+		answer[12] = usbMscSenseAsc;
+		usbMscSenseKey = USB_MSC_SENSE_NONE;
+		usbMscSenseAsc = 0U;
+		UsbMsc_Answer(UsbMsc_Min(USB_MSC_SENSE_LENGTH, cb[4]));
+		return;
+
+	case USB_MSC_SCSI_INQUIRY:
+		if ((cb[1] & 0x01U) != 0U)
+		{
+			/* No vital product data pages */
+			UsbMsc_Fail(USB_MSC_SENSE_ILLEGAL_REQUEST, USB_MSC_ASC_INVALID_FIELD);
+			return;
+		}
+		memcpy(answer, usbMscInquiry, USB_MSC_INQUIRY_LENGTH);
+		UsbMsc_Answer(UsbMsc_Min(USB_MSC_INQUIRY_LENGTH, UsbMsc_Get16Be(&cb[3])));
+		return;
+
+	case USB_MSC_SCSI_MODE_SENSE_6:
+		/* Header only: no block descriptor, no page, not write protected */
+		memset(answer, 0, 4U);
+		answer[0] = 3U;
+		UsbMsc_Answer(UsbMsc_Min(4U, cb[4]));
+		return;
+
+	case USB_MSC_SCSI_MODE_SENSE_10:
+		memset(answer, 0, 8U);
+		answer[1] = 6U;
+		UsbMsc_Answer(UsbMsc_Min(8U, UsbMsc_Get16Be(&cb[7])));
+		return;
+
+	case USB_MSC_SCSI_START_STOP_UNIT:
+	case USB_MSC_SCSI_PREVENT_ALLOW:
+	case USB_MSC_SCSI_SYNCHRONIZE_CACHE_10:
+		/* Writes are through to the medium when their CSW goes out */
+		UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		return;
+
+	case USB_MSC_SCSI_READ_FORMAT_CAPACITIES:
+		if (UsbMsc_Capacity(&blocks) != HAL_OK)
+		{
+			return;
+		}
+		memset(answer, 0, 12U);
+		answer[3] = 8U;
+		UsbMsc_Put32Be(&answer[4], blocks);
+		UsbMsc_Put32Be(&answer[8], USB_MSC_BLOCK_SIZE);
+		answer[8] = 0x02U;              /* formatted media */
+		UsbMsc_Answer(UsbMsc_Min(12U, UsbMsc_Get16Be(&cb[7])));
+		return;
+
+	case USB_MSC_SCSI_READ_CAPACITY_10:
+		if (UsbMsc_Capacity(&blocks) != HAL_OK)
+		{
+			return;
+		}
+		UsbMsc_Put32Be(&answer[0], blocks - 1U);
+		UsbMsc_Put32Be(&answer[4], USB_MSC_BLOCK_SIZE);
+		UsbMsc_Answer(8U);
+		return;
+
+	case USB_MSC_SCSI_READ_10:
+	case USB_MSC_SCSI_WRITE_10:
+		UsbMsc_Stream(cb[0] == USB_MSC_SCSI_READ_10, UsbMsc_Get32Be(&cb[2]), UsbMsc_Get16Be(&cb[7]));
+		return;
+
+	case USB_MSC_SCSI_VERIFY_10:
+		if (UsbMsc_CheckRange(UsbMsc_Get32Be(&cb[2]), UsbMsc_Get16Be(&cb[7])) == HAL_OK)
+		{
+			UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		}
+		return;
+
+	default:
+		UsbMsc_Fail(USB_MSC_SENSE_ILLEGAL_REQUEST, USB_MSC_ASC_INVALID_COMMAND);
+		return;
+	}
+}
+
+static void UsbMsc_Command(uint32_t length)
+{
+	const uint8_t *cbw = usbMscCommand;
+	uint8_t cb[USB_MSC_CB_MAX];
+
+	/* Not valid or not meaningful (BOT 6.2): halt until a reset recovery */
+	if ((length != USB_MSC_CBW_LENGTH) || (UsbMsc_Get32Le(&cbw[0]) != USB_MSC_CBW_SIGNATURE)
+			|| (cbw[13] != 0U) || (cbw[14] == 0U) || (cbw[14] > USB_MSC_CB_MAX))
+	{
+		usbMscStats.invalid++;
+		usbMscState = USB_MSC_STATE_HALTED;
+		(void)UsbDevice_Stall(USB_MSC_EP_IN);
+		(void)UsbDevice_Stall(USB_MSC_EP_OUT);
+		return;
+	}
+	usbMscStats.commands++;
+	usbMscTag = UsbMsc_Get32Le(&cbw[4]);
+	usbMscDataLength = UsbMsc_Get32Le(&cbw[8]);
+	usbMscDataIn = ((cbw[12] & USB_MSC_CBW_DIR_IN) != 0U);
+	usbMscTransferred = 0U;
+	usbMscStatus = USB_MSC_CSW_PASSED;
+
+	/* The answers are built where the CBW came in */
+	memcpy(cb, &cbw[15], USB_MSC_CB_MAX);
+	UsbMsc_Scsi(cb);
+}
+
+/* Drop the command in progress: the slots go back to the next one, but for
+   the one a storage operation still works on */
+static void UsbMsc_Abandon(void)
+{
+	usbMscStorageStale = usbMscStorageBusy;
+	usbMscSlot[0].state = USB_MSC_SLOT_FREE;
+	usbMscSlot[1].state = USB_MSC_SLOT_FREE;
+	usbMscRetry = 0U;
+	usbMscState = USB_MSC_STATE_IDLE;
+}
+
+static void UsbMsc_Configured(uint8_t configuration, uint32_t highSpeed)
+{
+	(void)highSpeed;
+
+	UsbMsc_Abandon();
+	if (configuration != 0U)
+	{
+		UsbMsc_ReceiveCbw();
+	}
+}
+
+static HAL_StatusTypeDef UsbMsc_Request(const UsbDevice_SetupTypeDef *setup, uint8_t *data, uint32_t *length)
+{
+	if (((setup->bmRequestType & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_CLASS)
+			|| ((setup->bmRequestType & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_INTERFACE)
+			|| (setup->wIndex != USB_MSC_INTERFACE) || (setup->wValue != 0U))
+	{
+		return HAL_ERROR;
+	}
+
+	switch (setup->bRequest)
+	{
+	case USB_MSC_GET_MAX_LUN:
+		if (((setup->bmRequestType & USB_REQ_DIR_IN) == 0U) || (*length == 0U))
+		{
+			return HAL_ERROR;
+		}
+		data[0] = 0U;                   /* a single logical unit */
+		*length = 1U;
+		return HAL_OK;
+
+	case USB_MSC_RESET:
+		if (((setup->bmRequestType & USB_REQ_DIR_IN) != 0U) || (*length != 0U))
+		{
+			return HAL_ERROR;
+		}
+		/* Ready for a CBW again; the host clears the halts next */
+		(void)UsbDevice_Abort(USB_MSC_EP_IN);
+		(void)UsbDevice_Abort(USB_MSC_EP_OUT);
+		UsbMsc_Abandon();
+		usbMscStats.resets++;
+		UsbMsc_ReceiveCbw();
+		return HAL_OK;
+
+	default:
+		return HAL_ERROR;
+	}
+}
+
+static void UsbMsc_DataIn(uint8_t epAddress)
+{
+	if (epAddress != USB_MSC_EP_IN)
+	{
+		return;
+	}
+
+	switch (usbMscState)
+	{
+	case USB_MSC_STATE_DATA:
+		usbMscTransferred = usbMscAnswerLength;
+		UsbMsc_EndData(USB_MSC_CSW_PASSED);
+		return;
+
+	case USB_MSC_STATE_STREAM:
+		UsbMsc_DrainDone(HAL_OK);
+		UsbMsc_Pump();
+		return;
+
+	case USB_MSC_STATE_ZLP:
+		UsbMsc_SendCsw();
+		return;
+
+	case USB_MSC_STATE_STATUS:
+		UsbMsc_ReceiveCbw();
+		return;
+
+	default:
+		return;
+	}
+}
+
+static void UsbMsc_DataOut(uint8_t epAddress, uint32_t length)
+{
+	if (epAddress != USB_MSC_EP_OUT)
+	{
+		return;
+	}
+
+	if (usbMscState == USB_MSC_STATE_IDLE)
+	{
+		DmaBuffer_CompleteRx(usbMscCommand, USB_MSC_COMMAND_SIZE);
+		UsbMsc_Command(length);
+	}
+	else if ((usbMscState == USB_MSC_STATE_STREAM) && (usbMscStreamIn == 0U))
+	{
+		DmaBuffer_CompleteRx(usbMscSlot[usbMscFill].buffer, USB_MSC_SLOT_SIZE);
+		UsbMsc_FillDone(HAL_OK, length);
+		UsbMsc_Pump();
+	}
+}
+
+static void UsbMsc_ClearHalt(uint8_t epAddress)
+{
+	/* After a CBW not valid only a BOT reset clears the halts (BOT 6.6.1) */
+	if (usbMscState == USB_MSC_STATE_HALTED)
+	{
+		(void)UsbDevice_Stall(epAddress);
+	}
+}
+
+/**
+ * @brief  Reset the class state and start the device core with it.
+ * @note   hpcd as for UsbDevice_Init().
+ * @param  hpcd: PCD handle
+ * @param  storage: medium behind the logical unit, kept
+ * @param  serial: iSerialNumber string, ASCII, kept; at least 12 hex
+ *         digits for BOT compliance
+ * @retval HAL status
+ */
+HAL_StatusTypeDef UsbMsc_Init(PCD_HandleTypeDef *hpcd, const UsbMsc_StorageTypeDef *storage, const char *serial)
+{
+	if (usbMscCommand == NULL)
+	{
+		usbMscSlot[0].buffer = DmaBuffer_AllocCached(USB_MSC_SLOT_SIZE);
+		usbMscSlot[1].buffer = DmaBuffer_AllocCached(USB_MSC_SLOT_SIZE);
+		usbMscCommand = DmaBuffer_AllocCached(USB_MSC_COMMAND_SIZE);
+		if ((usbMscSlot[0].buffer == NULL) || (usbMscSlot[1].buffer == NULL) || (usbMscCommand == NULL))
+		{
+			usbMscCommand = NULL;
+			return HAL_ERROR;
+		}
+	}
+
+	usbMscStorage = storage;
+	usbMscStrings[2] = serial;
+	usbMscStorageBusy = 0U;
+	UsbMsc_Abandon();
+	usbMscStorageStale = 0U;
+	usbMscPumping = 0U;
+	usbMscSenseKey = USB_MSC_SENSE_NONE;
+	usbMscSenseAsc = 0U;
+	memset(&usbMscStats, 0, sizeof(usbMscStats));
+
+	return UsbDevice_Init(hpcd, &usbMscClass);
+}
+
+/**
+ * @brief  End of the storage operation last started.
+ * @note   From the storage interrupt, at the USB interrupt priority, or from
+ *         within the storage read/write call.
+ * @param  status: HAL_OK, HAL_ERROR for a failed transfer
+ * @retval None
+ */
+void UsbMsc_StorageDone(HAL_StatusTypeDef status)
+{
+	usbMscStorageBusy = 0U;
+	if (usbMscStorageStale != 0U)
+	{
+		usbMscStorageStale = 0U;
+		UsbMsc_Pump();
+		return;
+	}
+	if (usbMscState != USB_MSC_STATE_STREAM)
+	{
+		return;
+	}
+	if (usbMscStreamIn != 0U)
+	{
+		UsbMsc_FillDone(status, 0U);
+	}
+	else
+	{
+		UsbMsc_DrainDone(status);
+	}
+	UsbMsc_Pump();
+}
+
+/**
+ * @brief  Start again a storage operation refused busy.
+ * @note   Thread context, every USB_MSC_POLL_MS; cheap when nothing waits.
+ * @retval None
+ */
+void UsbMsc_Poll(void)
+{
+	uint32_t primask;
+
+	if (usbMscRetry == 0U)
+	{
+		return;
+	}
+	primask = __get_PRIMASK();
+	__disable_irq();
+	usbMscRetry = 0U;
+	UsbMsc_Pump();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Copy the command counters.
+ * @param  stats: destination
+ * @retval None
+ */
+void UsbMsc_GetStats(UsbMsc_StatsTypeDef *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = usbMscStats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Print the command counters on one line.
+ * @param  putChar: character output
+ * @retval None
+ */
+void UsbMsc_Dump(UsbMsc_PutCharTypeDef putChar)
+{
+	UsbMsc_StatsTypeDef stats;
+	char line[160];
+
+	UsbMsc_GetStats(&stats);
+	snprintf(line, sizeof(line), "usb msc cmd=%lu fail=%lu phase=%lu inv=%lu rst=%lu rd=%lu wr=%lu ovl=%lu retry=%lu\r\n",
+		(unsigned long)stats.commands, (unsigned long)stats.failed, (unsigned long)stats.phaseErrors,
+		(unsigned long)stats.invalid, (unsigned long)stats.resets, (unsigned long)stats.readBlocks,
+		(unsigned long)stats.writeBlocks, (unsigned long)stats.overlapped, (unsigned long)stats.retries);
+
+	for (const char *p = line; *p != '\0'; p++)
+	{
+		putChar(*p);
+	}
+}
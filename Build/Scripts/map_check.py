@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# ------------------------------------------------
+# map_check.py - verify code/data placement from a GNU ld map file
+#
+# Reports the usage of every memory region and checks that:
+#   - each allocated output section lies inside the region it belongs to
+#     (.itcm_text in ITCMRAM, .dtcm_* in DTCMRAM, .sram2_dma in SRAM2,
+#     .sdram in SDRAM, .qspi in QSPI, ...);
+#   - no .itcm_text/.dtcm_*/.sram2_dma/.sdram/.qspi input section was placed elsewhere
+#     (a typo in a section attribute would silently land in RAM/FLASH);
+#   - the given symbols sit in the expected region (--expect SYMBOL=REGION).
+#
+# Usage:
+#   > Build/Scripts/map_check.py Build/Obj/STM32F746ZG_APP.map
+#   > Build/Scripts/map_check.py app.map --expect Profile_Record=ITCMRAM
+# Exit status is 1 when a check fails.
+# ------------------------------------------------
+
+import argparse
+import re
+import sys
+
+# output section -> memory region it must be placed in
+SECTION_REGION = {
+    ".isr_vector": "FLASH",
+    ".text": "FLASH",
+    ".rodata": "FLASH",
+    ".data": "RAM",
+    ".bss": "RAM",
+    ".itcm_text": "ITCMRAM",
+    ".dtcm_data": "DTCMRAM",
+    ".dtcm_bss": "DTCMRAM",
+    "._dtcm_stack": "DTCMRAM",
+    ".sram2_dma": "SRAM2",
+    ".sdram": "SDRAM",
+    ".qspi": "QSPI",
+}
+
+# symbols placed with ITCM_TEXT (App/Include/mem_section.h)
+DEFAULT_EXPECT = [
+    "SysTick_Handler=ITCMRAM",
+    "PendSV_Handler=ITCMRAM",
+    "USART1_IRQHandler=ITCMRAM",
+    "DMA2_Stream2_IRQHandler=ITCMRAM",
+    "DMA2_Stream7_IRQHandler=ITCMRAM",
+    "ETH_IRQHandler=ITCMRAM",
+    "EthPbuf_Free=ITCMRAM",
+    "Profile_Record=ITCMRAM",
+    "RingBuffer_Write=ITCMRAM",
+]
+
+RE_REGION = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(\s+\S+)?\s*$")
+
+
+def is_hex(token):
+    return re.match(r"^0x[0-9a-fA-F]+$", token) is not None
+
+
+class MapFile:
+    def __init__(self, path):
+        self.regions = []       # (name, origin, length)
+        self.outputs = []       # (name, vma, size, lma)
+        self.inputs = []        # (section, vma, size, object, output)
+        self.symbols = {}       # name -> address
+        self._output = None
+        self._parse(path)
+
+    def _add_output(self, name, tokens):
+        vma = int(tokens[0], 16)
+        lma = int(tokens[-1], 16) if "load" in tokens else vma
+        self._output = name
+        self.outputs.append((name, vma, int(tokens[1], 16), lma))
+
+    def _add_input(self, name, tokens):
+        self.inputs.append((name, int(tokens[0], 16), int(tokens[1], 16), " ".join(tokens[2:]), self._output))
+
+    def _parse(self, path):
+        with open(path, errors="replace") as f:
+            lines = f.read().splitlines()
+
+        mode = None
+        pending = None
+        for line in lines:
+            if line.startswith("Memory Configuration"):
+                mode = "regions"
+                continue
+            if line.startswith("Linker script and memory map"):
+                mode = "map"
+                continue
+
+            if mode == "regions":
+                m = RE_REGION.match(line)
+                if m and m.group(1) not in ("Name", "*default*"):
+                    self.regions.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+                continue
+            if mode != "map":
+                continue
+
+            tokens = line.split()
+            if not tokens:
+                continue
+
+            if not line.startswith(" "):
+                # output section, name on its own line when too long
+                pending = None
+                if len(tokens) >= 3 and is_hex(tokens[1]) and is_hex(tokens[2]):
+                    self._add_output(tokens[0], tokens[1:])
+                elif len(tokens) == 1:
+                    pending = ("output", tokens[0])
+            elif not line.startswith("  "):
+                # input section; skip input patterns such as " *(.text*)" and " *fill*"
+                pending = None
+                if tokens[0].startswith("*"):
+                    continue
+                if len(tokens) >= 4 and is_hex(tokens[1]) and is_hex(tokens[2]):
+                    self._add_input(tokens[0], tokens[1:])
+                elif len(tokens) == 1:
+                    pending = ("input", tokens[0])
+            elif pending and len(tokens) >= 2 and is_hex(tokens[0]) and is_hex(tokens[1]):
+                if pending[0] == "output":
+                    self._add_output(pending[1], tokens)
+                else:
+                    self._add_input(pending[1], tokens)
+                pending = None
+            elif len(tokens) >= 2 and is_hex(tokens[0]) and re.match(r"^[A-Za-z_][\w.$]*$", tokens[1]):
+                # symbol, or symbol assignment "0x... name = expr"
+                if len(tokens) == 2 or tokens[2] == "=":
+                    self.symbols[tokens[1]] = int(tokens[0], 16)
+
+    def region_of(self, address, size=1):
+        for name, origin, length in self.regions:
+            if origin <= address and address + max(size, 1) <= origin + length:
+                return name
+        return None
+
+
+def base_section(name):
+    for prefix in (".itcm_text", ".dtcm_data", ".dtcm_bss", ".sram2_dma", ".sdram", ".qspi"):
+        if name == prefix or name.startswith(prefix + "."):
+            return prefix
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check code/data placement in a GNU ld map file")
+    parser.add_argument("map", help="linker map file (-Wl,-Map=...)")
+    parser.add_argument("--expect", action="append", default=None, metavar="SYMBOL=REGION",
+                        help="symbol that must be placed in REGION (repeatable, replaces the defaults)")
+    args = parser.parse_args()
+
+    mapfile = MapFile(args.map)
+    errors = []
+
+    if not mapfile.regions:
+        sys.exit("%s: no memory configuration found" % args.map)
+
+    print("%-10s %10s %10s %10s %6s" % ("Region", "Origin", "Used", "Size", "Use%"))
+    for name, origin, length in mapfile.regions:
+        used = sum(size for sec, vma, size, lma in mapfile.outputs
+                   if size and origin <= vma < origin + length)
+        print("%-10s 0x%08x %10d %10d %5.1f%%" % (name, origin, used, length, 100.0 * used / length))
+    print()
+
+    for name, vma, size, lma in mapfile.outputs:
+        expected = SECTION_REGION.get(name)
+        if expected is None or size == 0:
+            continue
+        region = mapfile.region_of(vma, size)
+        print("%-14s 0x%08x %8d  %s" % (name, vma, size, region))
+        if region != expected:
+            errors.append("%s at 0x%08x (%d bytes) is in %s, expected %s" % (name, vma, size, region, expected))
+    print()
+
+    for section, vma, size, obj, output in mapfile.inputs:
+        base = base_section(section)
+        if base and size and output != base:
+            errors.append("%s from %s landed in %s" % (section, obj, output))
+
+    for expect in args.expect if args.expect is not None else DEFAULT_EXPECT:
+        symbol, _, region = expect.partition("=")
+        if symbol not in mapfile.symbols:
+            errors.append("%s not found in map" % symbol)
+            continue
+        actual = mapfile.region_of(mapfile.symbols[symbol])
+        if actual != region:
+            errors.append("%s at 0x%08x is in %s, expected %s" % (symbol, mapfile.symbols[symbol], actual, region))
+
+    for error in errors:
+        print("error: " + error)
+    if errors:
+        sys.exit(1)
+    print("placement OK")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+# ------------------------------------------------
+# size_report.py - code size and stack usage report, regression check
+#
+# report:  parse the linker map (per output section and per input section,
+#          i.e. per function/object with -ffunction-sections -fdata-sections)
+#          and the -fstack-usage (.su) / -fcallgraph-info=su (.ci) files of
+#          a build directory into a JSON report. The worst-case stack of
+#          every call graph root (main, the handlers) is the deepest chain of
+#          static frames below it; recursion and dynamic frames are flagged.
+# compare: diff two reports, exit status 1 when .text (code in FLASH and
+#          ITCM) or a worst-case stack grew beyond the thresholds.
+#
+# Usage:
+#   > Build/Scripts/size_report.py report Build/Obj/debug/STM32F746ZG_APP.map Build/Obj/debug -o report.json
+#   > Build/Scripts/size_report.py compare base.json report.json [--text-bytes 0] [--stack-bytes 0]
+# ------------------------------------------------
+
+import argparse
+import json
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from map_check import MapFile, SECTION_REGION  # noqa: E402
+
+CODE_SECTIONS = (".text", ".itcm_text")
+TOP_SYMBOLS = 15
+
+RE_CI_NODE = re.compile(r'node:\s*\{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"')
+RE_CI_EDGE = re.compile(r'edge:\s*\{\s*sourcename:\s*"([^"]+)"\s*targetname:\s*"([^"]+)"')
+RE_CI_STACK = re.compile(r"(\d+) bytes? \(([\w,]+)\)")
+RE_LTRANS = re.compile(r"^\S*?(ltrans\d+)\S*$")
+
+
+def symbol_key(section, obj):
+    """Stable name of an input section across builds."""
+    parts = section.split(".", 2)
+    if len(parts) == 3 and parts[1] in ("text", "rodata", "data", "bss"):
+        return section
+    obj = os.path.basename(obj.split("(")[0])
+    m = RE_LTRANS.match(obj)
+    return "%s(%s)" % (section, m.group(1) if m else obj)
+
+
+def read_stack_usage(build_dir):
+    frames = {}
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(root, name), errors="replace") as f:
+                for line in f:
+                    fields = line.rstrip("\n").split("\t")
+                    if len(fields) < 3:
+                        continue
+                    function = fields[0].rsplit(":", 1)[-1]
+                    size = int(fields[1])
+                    if function not in frames or frames[function][0] < size:
+                        frames[function] = (size, fields[2])
+    return frames
+
+
+def read_call_graph(build_dir):
+    nodes = {}      # title -> (name, frame, qualifier)
+    edges = {}      # title -> set(title)
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith(".ci"):
+                continue
+            with open(os.path.join(root, name), errors="replace") as f:
+                text = f.read()
+            for m in RE_CI_NODE.finditer(text):
+                label = m.group(2).split("\\n")
+                stack = RE_CI_STACK.search(m.group(2))
+                frame = (int(stack.group(1)), stack.group(2)) if stack else (0, "external")
+                if m.group(1) not in nodes or nodes[m.group(1)][2] == "external":
+                    nodes[m.group(1)] = (label[0], frame[0], frame[1])
+            for m in RE_CI_EDGE.finditer(text):
+                edges.setdefault(m.group(1), set()).add(m.group(2))
+    return nodes, edges
+
+
+def worst_case_stack(nodes, edges):
+    """Deepest static chain below every root: {name: {bytes, path, flags}}."""
+    memo = {}
+
+    def walk(title, active):
+        if title in memo:
+            return memo[title]
+        if title in active:
+            return (0, [], {"recursion"})
+        name, frame, qualifier = nodes.get(title, (title, 0, "external"))
+        flags = set()
+        if "dynamic" in qualifier and "bounded" not in qualifier:
+            flags.add("dynamic")
+        if qualifier == "external":
+            flags.add("external")
+        active.add(title)
+        best = (0, [], set())
+        for callee in sorted(edges.get(title, ())):
+            depth, path, sub = walk(callee, active)
+            flags |= sub
+            if depth > best[0] or not best[1]:
+                best = (depth, path, sub)
+        active.discard(title)
+        result = (frame + best[0], [name] + best[1], flags)
+        if "recursion" not in flags:
+            memo[title] = result
+        return result
+
+    called = set()
+    for callees in edges.values():
+        called |= callees
+    result = {}
+    for title in nodes:
+        if title in called or nodes[title][2] == "external":
+            continue
+        depth, path, flags = walk(title, set())
+        result[nodes[title][0]] = {"bytes": depth, "path": path, "flags": sorted(flags)}
+    return result
+
+
+def report(args):
+    mapfile = MapFile(args.map)
+    sections = {}
+    for name, vma, size, lma in mapfile.outputs:
+        if name in SECTION_REGION and size:
+            sections[name] = sections.get(name, 0) + size
+
+    symbols = {}
+    for section, vma, size, obj, output in mapfile.inputs:
+        if size and output in SECTION_REGION:
+            key = symbol_key(section, obj)
+            symbols[key] = symbols.get(key, 0) + size
+
+    frames = read_stack_usage(args.build_dir)
+    nodes, edges = read_call_graph(args.build_dir)
+    worst = worst_case_stack(nodes, edges)
+
+    data = {
+        "map": args.map,
+        "sections": sections,
+        "text": sum(sections.get(name, 0) for name in CODE_SECTIONS),
+        "symbols": symbols,
+        "frames": {name: size for name, (size, qualifier) in frames.items()},
+        "stack_worst": worst,
+        "stack_max": max([entry["bytes"] for entry in worst.values()] + [0]),
+    }
+
+    print("%-16s %10s" % ("Section", "Bytes"))
+    for name in sorted(sections):
+        print("%-16s %10d" % (name, sections[name]))
+    print("%-16s %10d\n" % ("code total", data["text"]))
+
+    print("Largest input sections:")
+    for key, size in sorted(symbols.items(), key=lambda item: -item[1])[:TOP_SYMBOLS]:
+        print("  %8d  %s" % (size, key))
+    print()
+
+    print("Largest stack frames:")
+    for name, (size, qualifier) in sorted(frames.items(), key=lambda item: -item[1][0])[:TOP_SYMBOLS]:
+        print("  %8d  %s (%s)" % (size, name, qualifier))
+    print()
+
+    if worst:
+        print("Worst-case stack per call graph root:")
+        for name, entry in sorted(worst.items(), key=lambda item: -item[1]["bytes"])[:TOP_SYMBOLS]:
+            flags = (" [%s]" % ",".join(entry["flags"])) if entry["flags"] else ""
+            print("  %8d  %s%s" % (entry["bytes"], " > ".join(entry["path"]), flags))
+    else:
+        print("No .ci call graph files found (-fcallgraph-info=su), worst-case stack not computed")
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(data, f, indent=1, sort_keys=True)
+
+
+def compare(args):
+    with open(args.base) as f:
+        base = json.load(f)
+    with open(args.new) as f:
+        new = json.load(f)
+    errors = []
+
+    print("%-16s %10s %10s %8s" % ("Section", "Base", "New", "Delta"))
+    for name in sorted(set(base["sections"]) | set(new["sections"])):
+        old_size = base["sections"].get(name, 0)
+        new_size = new["sections"].get(name, 0)
+        print("%-16s %10d %10d %+8d" % (name, old_size, new_size, new_size - old_size))
+    print()
+
+    deltas = []
+    for key in set(base["symbols"]) | set(new["symbols"]):
+        delta = new["symbols"].get(key, 0) - base["symbols"].get(key, 0)
+        if delta:
+            deltas.append((delta, key))
+    if deltas:
+        print("Input section changes:")
+        for delta, key in sorted(deltas, key=lambda item: -abs(item[0]))[:TOP_SYMBOLS]:
+            print("  %+8d  %s" % (delta, key))
+        print()
+
+    for name in sorted(set(base["stack_worst"]) | set(new["stack_worst"])):
+        old_depth = base["stack_worst"].get(name, {}).get("bytes", 0)
+        new_depth = new["stack_worst"].get(name, {}).get("bytes", 0)
+        if old_depth != new_depth:
+            print("stack %-30s %6d -> %6d" % (name, old_depth, new_depth))
+
+    if new["text"] > base["text"] + args.text_bytes:
+        errors.append("code size grew %d -> %d bytes (+%d)" % (base["text"], new["text"], new["text"] - base["text"]))
+    if new["stack_max"] > base["stack_max"] + args.stack_bytes:
+        errors.append("worst-case stack grew %d -> %d bytes" % (base["stack_max"], new["stack_max"]))
+
+    for error in errors:
+        print("regression: " + error)
+    if errors:
+        sys.exit(1)
+    print("no regression (code %+d bytes, worst-case stack %+d bytes)"
+          % (new["text"] - base["text"], new["stack_max"] - base["stack_max"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Code size and stack usage report")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    parser_report = commands.add_parser("report", help="build a report from a map file and .su/.ci files")
+    parser_report.add_argument("map", help="linker map file")
+    parser_report.add_argument("build_dir", help="directory holding the .su/.ci files")
+    parser_report.add_argument("-o", "--output", help="JSON report to write")
+    parser_report.set_defaults(run=report)
+
+    parser_compare = commands.add_parser("compare", help="diff two JSON reports, fail on regression")
+    parser_compare.add_argument("base")
+    parser_compare.add_argument("new")
+    parser_compare.add_argument("--text-bytes", type=int, default=0, help="allowed code growth")
+    parser_compare.add_argument("--stack-bytes", type=int, default=0, help="allowed worst-case stack growth")
+    parser_compare.set_defaults(run=compare)
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
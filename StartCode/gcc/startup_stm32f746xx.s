@@ -43,6 +43,15 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* ITCM code and DTCM data sections. defined in linker script */
+.word  _siitcm_text
+.word  _sitcm_text
+.word  _eitcm_text
+.word  _sidtcm_data
+.word  _sdtcm_data
+.word  _edtcm_data
+.word  _sdtcm_bss
+.word  _edtcm_bss
 /* stack used for SystemInit_ExtMemCtl; always internal RAM used */
 
 /**
@@ -60,6 +69,22 @@ defined in linker script */
 Reset_Handler:  
   ldr   sp, =_estack      /* set stack pointer */
 
+#if defined(BENCH_CORE) && (BENCH_CORE == 1)
+/* Start the DWT cycle counter from zero to time the boot (App/Src/bench_core.c) */
+  ldr r0, =0xE000EDFC     /* CoreDebug->DEMCR */
+  ldr r1, [r0]
+  orr r1, r1, #0x01000000 /* TRCENA */
+  str r1, [r0]
+  ldr r0, =0xE0001000     /* DWT->CTRL */
+  ldr r1, =0xC5ACCE55
+  str r1, [r0, #0xFB0]    /* DWT->LAR unlock */
+  movs r1, #0
+  str r1, [r0, #4]        /* DWT->CYCCNT */
+  ldr r1, [r0]
+  orr r1, r1, #1          /* CYCCNTENA */
+  str r1, [r0]
+#endif
+
 /* Copy the data segment initializers from flash to SRAM */  
   ldr r0, =_sdata
   ldr r1, =_edata
@@ -91,6 +116,58 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* Copy the ITCM code from flash to ITCM */
+  ldr r0, =_sitcm_text
+  ldr r1, =_eitcm_text
+  ldr r2, =_siitcm_text
+  movs r3, #0
+  b LoopCopyItcmInit
+
+CopyItcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcmInit
+
+/* Copy the DTCM data initializers from flash to DTCM */
+  ldr r0, =_sdtcm_data
+  ldr r1, =_edtcm_data
+  ldr r2, =_sidtcm_data
+  movs r3, #0
+  b LoopCopyDtcmInit
+
+CopyDtcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcmInit
+
+/* Zero fill the DTCM bss segment. */
+  ldr r2, =_sdtcm_bss
+  ldr r4, =_edtcm_bss
+  movs r3, #0
+  b LoopFillZeroDtcmBss
+
+FillZeroDtcmBss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroDtcmBss:
+  cmp r2, r4
+  bcc FillZeroDtcmBss
+
+/* ITCM code was written through the data side: complete the stores before fetching it */
+  dsb
+  isb
+
 /* Call the clock system initialization function.*/
   bl  SystemInit   
 /* Call static constructors */